@@ -34,6 +34,9 @@ int alignment_write_padding_frame(struct burst_writer *writer, size_t padding_si
 int alignment_write_start_of_part_frame(struct burst_writer *writer,
                                         uint64_t uncompressed_offset);
 
+// Write zero marker frame: the Zstandard frame written next decompresses to zeros
+int alignment_write_zero_marker(struct burst_writer *writer);
+
 // Calculate current write position (offset + buffered)
 uint64_t alignment_get_write_position(struct burst_writer *writer);
 
@@ -0,0 +1,145 @@
+#ifndef ARCHIVE_SOURCE_H
+#define ARCHIVE_SOURCE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Where archive bytes come from.
+ *
+ * The tail fetch, central directory fetches and part downloads all issue
+ * byte-range requests through an archive_source, so the same concurrent
+ * pipeline restores from S3, from a local file (or NFS mount) and from any
+ * HTTP(S) server that honours Range requests.
+ *
+ * A request delivers headers(), then body() for each chunk in order, then
+ * finish(), never two at once. Callbacks may run on any thread. body() is
+ * only called while the request's read window is open: it starts at the
+ * source's read window and is reopened by source_request_open_window() as
+ * data is consumed.
+ */
+
+struct burst_downloader;
+struct archive_source;
+struct source_request;
+
+enum archive_source_kind {
+    ARCHIVE_SOURCE_S3,
+    ARCHIVE_SOURCE_FILE,
+    ARCHIVE_SOURCE_HTTP,
+};
+
+/**
+ * Response metadata, passed to headers().
+ */
+struct source_response {
+    int status;            // HTTP status (206 from a file source)
+    uint64_t range_start;  // First byte returned
+    uint64_t range_end;    // Last byte returned
+    uint64_t total_size;   // Size of the whole archive (0 if not reported)
+    const char *etag;      // Identifies this version of the archive; may be NULL
+};
+
+struct source_request_options {
+    uint64_t start;          // First byte to fetch
+    uint64_t end;            // Last byte to fetch (inclusive)
+    uint64_t suffix_length;  // If non-zero, fetch the last suffix_length bytes instead
+    const char *if_match;    // Fail with status 412 unless the archive has this ETag; NULL or "" for any
+
+    /** @return 0 to continue, -1 to abort the request */
+    int (*headers)(const struct source_response *response, void *user_data);
+    /** @return 0 to continue, -1 to abort the request */
+    int (*body)(struct source_request *request, const uint8_t *data, size_t len, void *user_data);
+    /** @param error_code 0 on success; see archive_source_error_str() */
+    void (*finish)(int error_code, int response_status, void *user_data);
+    void *user_data;
+};
+
+/**
+ * Operations of one kind of source.
+ */
+struct archive_source_ops {
+    struct source_request *(*request)(struct archive_source *source,
+                                      const struct source_request_options *options);
+    void (*open_window)(struct source_request *request, size_t len);
+    void (*cancel)(struct source_request *request);
+    void (*release)(struct source_request *request);
+    const char *(*error_str)(int error_code);
+    void (*destroy)(struct archive_source *source);
+};
+
+struct archive_source {
+    const struct archive_source_ops *ops;
+    enum archive_source_kind kind;
+};
+
+// Start of each kind of source's request structure
+struct source_request {
+    const struct archive_source_ops *ops;
+};
+
+/**
+ * Work out the kind of source an archive location names: http:// or https://
+ * URLs are HTTP sources, file:// URLs and plain paths are files.
+ *
+ * @param location URL or path
+ * @param out_path For files, the path with any file:// prefix removed (points into location)
+ * @return 0 on success, -1 for an unsupported URL scheme
+ */
+int archive_source_parse_location(const char *location, enum archive_source_kind *kind,
+                                  const char **out_path);
+
+/**
+ * Source reading a local file with pread(), one thread per request.
+ *
+ * @param path Archive file
+ * @param read_window Bytes a request may deliver ahead of source_request_open_window()
+ * @return Source, or NULL if the file cannot be opened
+ */
+struct archive_source *archive_source_new_file(const char *path, uint64_t read_window);
+
+/**
+ * Source fetching from S3 (downloader's bucket, key and region) through the
+ * downloader's aws-c-s3 client.
+ */
+struct archive_source *archive_source_new_s3(struct burst_downloader *downloader);
+
+/**
+ * Source fetching from an HTTP(S) URL through the downloader's aws-c-s3
+ * client, which must have been created without request signing.
+ */
+struct archive_source *archive_source_new_http(struct burst_downloader *downloader,
+                                               const char *url);
+
+/**
+ * Start a request. Callbacks may run before this returns.
+ *
+ * @return Request, to be released once finish() has run, or NULL on error
+ */
+struct source_request *archive_source_request(struct archive_source *source,
+                                              const struct source_request_options *options);
+
+/**
+ * Let the request deliver len more bytes.
+ */
+void source_request_open_window(struct source_request *request, size_t len);
+
+/**
+ * Stop the request early; finish() still runs, with an error.
+ */
+void source_request_cancel(struct source_request *request);
+
+/**
+ * Drop the caller's reference to a request.
+ */
+void source_request_release(struct source_request *request);
+
+/**
+ * Describe an error code passed to finish().
+ */
+const char *archive_source_error_str(const struct archive_source *source, int error_code);
+
+void archive_source_destroy(struct archive_source *source);
+
+#endif // ARCHIVE_SOURCE_H
@@ -5,8 +5,14 @@
 #include <stddef.h>
 #include <stdbool.h>
 
+#include "archive_source.h"
+
 // Forward declaration for body data segments
 struct body_data_segment;
+struct io_pool;
+struct restore_journal;
+struct part_prefetch;
+struct concurrency_controller;
 
 struct burst_downloader {
     // AWS components
@@ -18,33 +24,124 @@ struct burst_downloader {
     struct aws_s3_client *s3_client;
     struct aws_tls_ctx *tls_ctx;  // Required for SSO provider
 
-    // S3 object info
+    // S3 object info (NULL when the archive is given by URL)
     char *bucket;
     char *key;
     char *region;
+    char *source_url;  // http(s):// URL, file:// URL or local path; NULL for S3
+    enum archive_source_kind source_kind;
     uint64_t object_size;
+    char etag[128];  // From the tail fetch; empty if the response had none
 
     // Configuration
     size_t max_concurrent_connections;
     size_t max_concurrent_parts;  // Max concurrent part downloads (default: 8)
+    bool adaptive_concurrency;  // Vary the parts in flight up to max_concurrent_parts
+    size_t io_threads;  // Threads writing part data to disk (default: max_concurrent_parts)
     uint64_t part_size;  // Part size in bytes (8-64 MiB, must be multiple of 8 MiB)
+    uint64_t read_window;  // Bytes a part may receive ahead of what is written (read backpressure)
+    size_t prefetch_parts;  // Parts requested alongside the tail fetch (0 = none)
     char *output_dir;
     char *profile_name;  // AWS profile name for SSO and credentials
+    bool resume;  // Keep a journal of finished parts and skip them on rerun
+
+    // Every archive byte range is fetched through this
+    struct archive_source *source;
+
+    // Part data is processed here rather than on the S3 event loop threads
+    struct io_pool *io_pool;
+
+    // Parts already restored, when resume is set (NULL otherwise)
+    struct restore_journal *journal;
+
+    // Parts requested before the central directory was parsed (NULL if none)
+    struct part_prefetch *prefetch;
+
+    // Chooses the parts in flight when adaptive_concurrency is set (NULL otherwise)
+    struct concurrency_controller *concurrency;
+    uint64_t concurrency_bytes_done;  // Archive bytes of the parts it has seen finish
+    size_t concurrency_parts_done;
 };
 
 // Create/destroy
 struct burst_downloader *burst_downloader_create(
-    const char *bucket,
+    const char *bucket,  // bucket, key and region name an S3 archive...
     const char *key,
     const char *region,
+    const char *source_url,  // ...or this names an HTTP(S) or local one (else NULL)
     const char *output_dir,
     size_t max_connections,
     size_t max_concurrent_parts,  // Max concurrent part downloads (1-128, default: 8)
+    bool adaptive_concurrency,  // Start at BURST_ADAPTIVE_INITIAL_PARTS and adapt up to max_concurrent_parts
+    size_t io_threads,  // I/O worker threads (0 = one per concurrent part)
     uint64_t part_size,  // Part size in bytes (8-64 MiB, must be multiple of 8 MiB)
+    uint64_t read_window,  // Per-part read window from calculate_read_window()
+    size_t prefetch_parts,  // Parts to request while the tail is fetched (at most max_concurrent_parts)
+    bool resume,  // Skip parts recorded in the output directory's journal
     const char *profile_name  // Can be NULL
 );
 void burst_downloader_destroy(struct burst_downloader *downloader);
 
+/**
+ * Size the per-part read window for a memory budget.
+ *
+ * Each concurrent part may have at most this many bytes downloaded but not yet
+ * written to disk, so the budget is split evenly across parts in whole MiB.
+ *
+ * @param memory_limit Bytes of part data allowed in memory (0 = one part_size per part)
+ * @param max_concurrent_parts Concurrent part downloads
+ * @param part_size Part size in bytes
+ * @return Window in bytes (at most part_size), or 0 if the budget is under 1 MiB per part
+ */
+uint64_t calculate_read_window(
+    uint64_t memory_limit,
+    size_t max_concurrent_parts,
+    uint64_t part_size
+);
+
+/**
+ * Retries of a part download that fails part-way (connection reset, 5xx,
+ * throttling) before the restore is abandoned. Each retry resumes from the
+ * last frame boundary the part processor reached.
+ */
+#define BURST_PART_MAX_RETRIES 5
+
+/**
+ * Delay before retrying a failed part download: exponential backoff from
+ * 200 ms, doubling per attempt up to 20 s, with jitter.
+ *
+ * @param attempt Retry number, starting at 1
+ * @param random Any random value; picks the delay within the upper half of the step
+ * @return Delay in milliseconds
+ */
+uint64_t calculate_retry_delay_ms(uint32_t attempt, uint32_t random);
+
+/**
+ * Whether a part download that failed with this HTTP status may succeed if
+ * retried: no response at all, a body cut off after a 2xx, 408, 429 and 5xx.
+ * Other statuses (403, 404, ...) fail the same way again.
+ *
+ * @param response_status HTTP status of the failed request, 0 if none was received
+ */
+bool part_failure_is_transient(int response_status);
+
+/**
+ * With --max-concurrent-parts auto, the parts in flight start here and vary
+ * between 1 and BURST_ADAPTIVE_MAX_PARTS (see concurrency_controller.h).
+ */
+#define BURST_ADAPTIVE_INITIAL_PARTS 8
+#define BURST_ADAPTIVE_MAX_PARTS 32
+
+/**
+ * Number of parts to keep in flight after a part finished successfully.
+ * Feeds the concurrency controller when adaptive_concurrency is set; otherwise
+ * returns max_concurrent_parts. Call with the coordinator's mutex held.
+ *
+ * @param downloader Downloader
+ * @param part_index The part that finished
+ */
+size_t burst_downloader_adapt_concurrency(struct burst_downloader *downloader, uint32_t part_index);
+
 // Phase 1 test functions
 int burst_downloader_get_object_size(struct burst_downloader *downloader);
 int burst_downloader_test_range_get(
@@ -112,4 +209,34 @@ int burst_downloader_extract_concurrent(
     size_t num_body_segments
 );
 
+/**
+ * Create the directory tree and empty files of an archive from its central
+ * directory, split across the I/O worker threads. Blocks until done.
+ *
+ * Called while the first parts are downloading; the part processors skip
+ * what was created here. Other entries need their data and are left alone.
+ *
+ * @param downloader Downloader whose io_pool and output_dir are used
+ * @param cd_result  Parsed central directory
+ * @return 0 on success, -1 if any entry could not be created
+ */
+int burst_downloader_materialize_entries(
+    struct burst_downloader *downloader,
+    struct central_dir_parse_result *cd_result
+);
+
+/**
+ * Apply permissions and ownership once all data is on disk: regular files
+ * split across the I/O worker threads, then directories deepest first.
+ * Call after stream_processor_clone_duplicates(). Blocks until done.
+ *
+ * @param downloader Downloader whose io_pool and output_dir are used
+ * @param cd_result  Parsed (complete) central directory
+ * @return 0 on success, -1 on error (failures on individual files are warnings)
+ */
+int burst_downloader_apply_metadata(
+    struct burst_downloader *downloader,
+    struct central_dir_parse_result *cd_result
+);
+
 #endif // BURST_DOWNLOADER_H
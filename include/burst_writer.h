@@ -4,6 +4,7 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <sys/stat.h>
 #include <zstd.h>
 
 // Constants
@@ -11,6 +12,9 @@
 #define BURST_FRAME_SIZE (128 * 1024)       // 128 KiB (BTRFS maximum)
 #define BURST_MIN_SKIPPABLE_FRAME_SIZE 8
 #define BURST_MAGIC_NUMBER 0x184D2A5B       // "BURST" marker for skippable frames
+#define BURST_TYPE_ZERO_FRAME 0x02          // Skippable frame type: next Zstandard frame is all zeros
+#define BURST_ZERO_MARKER_SIZE 9            // Magic (4) + Frame Size (4) + Type (1)
+#define BURST_CONTENT_HASH_SIZE 32          // SHA-256 of a file's content
 
 // File entry metadata
 struct file_entry {
@@ -32,11 +36,56 @@ struct file_entry {
     uint32_t gid;
     // ZIP64 tracking
     bool used_zip64_descriptor;  // True if data descriptor used 64-bit sizes
+    // Archive name of the entry holding the data, for hardlinks (NULL otherwise)
+    char *hardlink_target;
+    // Content hash for the central directory (--content-hash, --dedup)
+    bool has_content_hash;
+    uint8_t content_hash_flags;  // BURST_CONTENT_HASH_FLAG_*
+    uint8_t content_hash[BURST_CONTENT_HASH_SIZE];
+    // Source file stat for the central directory, checked by later --base runs
+    bool has_source_stat;
+    int64_t mtime_sec;
+    uint32_t mtime_nsec;
+    int64_t ctime_sec;
+    uint32_t ctime_nsec;
+    uint64_t ino;
 };
 
+struct compress_pool;
+
+// One Zstandard frame of a file that was compressed ahead of time
+struct compressed_frame {
+    size_t offset;               // Offset of the frame within compressed_file.data
+    size_t compressed_size;
+    size_t uncompressed_size;
+    bool at_eof;                 // Last frame of the file (changes alignment decisions)
+    bool is_zero;                // Uncompressed data is all zeros
+};
+
+// All frames of a regular file, compressed off the writer thread
+struct compressed_file {
+    uint8_t *data;               // Concatenated frames
+    size_t data_size;
+    size_t data_capacity;
+    struct compressed_frame *frames;
+    size_t num_frames;
+    size_t frames_capacity;
+    uint32_t crc32;              // CRC32 of the uncompressed data
+    uint64_t uncompressed_size;
+    bool has_content_hash;       // Set if content_hash was computed alongside crc32
+    uint8_t content_hash[BURST_CONTENT_HASH_SIZE];
+};
+
+// Destination for archive bytes other than a FILE (e.g. an S3 multipart upload).
+// Called from burst_writer_flush with the bytes in archive order.
+// Returns 0 on success, -1 on error.
+typedef int (*burst_output_fn)(void *ctx, const uint8_t *data, size_t len);
+
 // BURST writer context
 struct burst_writer {
     FILE *output;
+    burst_output_fn output_fn;   // Used instead of output when set
+    void *output_ctx;
     uint64_t current_offset;
     ZSTD_CCtx *zstd_ctx;
     int compression_level;
@@ -58,15 +107,69 @@ struct burst_writer {
 
     // Phase 3: Alignment tracking
     uint64_t current_uncompressed_offset;  // Track uncompressed position within current file
+
+    // Parallel compression (NULL when compressing on the calling thread)
+    struct compress_pool *compress_pool;
+    int num_threads;
+
+    // Reuse zstd extents of BTRFS sources (BTRFS_IOC_ENCODED_READ)
+    bool encoded_read;
+    uint64_t encoded_frames_reused;
+    uint64_t encoded_frames_recompressed;
+
+    // Hash each file's data alongside its CRC32 (--content-hash, --dedup)
+    bool hash_content;
+
+    // Files whose frames were copied from a base archive (--base)
+    uint64_t base_files_reused;
+
+    // Entries stored as hardlinks to an earlier entry
+    uint64_t hardlinks;
+
+    // Entries whose content was already stored under another name (--dedup)
+    uint64_t duplicates;
+    uint64_t duplicate_bytes;
+
+    // All-zero chunks, stored behind a zero marker so the downloader can leave holes
+    uint8_t *zero_frame;         // Compressed BURST_FRAME_SIZE zeros, built on first use
+    size_t zero_frame_size;
+    uint32_t zero_chunk_crc;     // CRC32 of BURST_FRAME_SIZE zeros, 0 until needed
+    uint64_t zero_frames;
+    uint64_t hole_bytes;         // Bytes of holes skipped without reading them (SEEK_HOLE)
 };
 
-// Forward declaration
+// Forward declarations
 struct zip_local_header;
+struct base_frame_reader;
 
 // Writer API
 struct burst_writer* burst_writer_create(FILE *output, int compression_level);
+
+// Create a writer that hands its output to output_fn instead of a FILE.
+// The archive is written strictly sequentially, so any append-only sink works.
+struct burst_writer* burst_writer_create_with_sink(burst_output_fn output_fn, void *output_ctx,
+                                                   int compression_level);
 void burst_writer_destroy(struct burst_writer *writer);
 
+// Compress file data on num_threads worker threads (1 = serial, the default).
+// Frames are still laid out by the calling thread in file order, so the
+// resulting archive is byte-identical regardless of thread count.
+// Returns 0 on success, -1 on error.
+int burst_writer_set_threads(struct burst_writer *writer, int num_threads);
+
+// Read regular files with BTRFS_IOC_ENCODED_READ and copy zstd extents that
+// already fit the BURST frame rules into the archive without recompressing.
+// Other extents are compressed as usual. Falls back to normal reads (with a
+// warning) if the source filesystem or permissions do not allow encoded reads.
+// Returns 0 on success, -1 on error.
+int burst_writer_set_encoded_read(struct burst_writer *writer, bool enable);
+
+// Record the SHA-256 of every regular file's data as a content hash, computed
+// from the same buffers as its CRC32. Files copied from a base archive keep the
+// hash recorded there, if any.
+// Returns 0 on success, -1 on error.
+int burst_writer_set_content_hashing(struct burst_writer *writer, bool enable);
+
 // Add a file to the archive
 // input_file: Open file handle to read from (caller must close)
 // lfh: Fully-constructed local file header (caller allocates)
@@ -85,6 +188,80 @@ int burst_writer_add_file(struct burst_writer *writer,
                           uint32_t uid,
                           uint32_t gid);
 
+// Add a regular file whose frames were already compressed (e.g. by a prefetch worker)
+// Laid out exactly as burst_writer_add_file would lay out the same frames.
+// compressed: Frames, CRC and size of the file's data (caller keeps ownership)
+// Remaining parameters as for burst_writer_add_file.
+int burst_writer_add_compressed_file(struct burst_writer *writer,
+                                     const struct compressed_file *compressed,
+                                     struct zip_local_header *lfh,
+                                     int lfh_len,
+                                     uint32_t unix_mode,
+                                     uint32_t uid,
+                                     uint32_t gid);
+
+// Add a regular file by copying its frames from a base archive (incremental mode)
+// The frames are re-laid out with this archive's padding and Start-of-Part
+// frames, and the CRC recorded in the base is written to the data descriptor.
+// frames: Reader positioned at the start of the file's data (caller closes)
+// Remaining parameters as for burst_writer_add_file.
+int burst_writer_add_base_file(struct burst_writer *writer,
+                               struct base_frame_reader *frames,
+                               struct zip_local_header *lfh,
+                               int lfh_len,
+                               uint32_t unix_mode,
+                               uint32_t uid,
+                               uint32_t gid);
+
+// Add another name of a regular file that is already in the archive
+// The entry has no data (like an empty file); the central directory gives it a
+// BURST hardlink extra field naming target, so the downloader can link() it.
+// lfh: Fully-constructed local file header (STORE method, data descriptor flag set)
+// target: Archive name of the entry that holds the data
+// Remaining parameters as for burst_writer_add_file.
+int burst_writer_add_hardlink(struct burst_writer *writer,
+                              struct zip_local_header *lfh,
+                              int lfh_len,
+                              const char *target,
+                              uint32_t unix_mode,
+                              uint32_t uid,
+                              uint32_t gid);
+
+// Attach the SHA-256 of its content to the entry added last, so the central
+// directory carries a BURST content hash extra field for it.
+// Returns 0 on success, -1 if no entry has been added.
+int burst_writer_set_content_hash(struct burst_writer *writer,
+                                  const uint8_t hash[BURST_CONTENT_HASH_SIZE]);
+
+// SHA-256 of the content of the entry added last, or NULL if it has none.
+const uint8_t *burst_writer_content_hash(const struct burst_writer *writer);
+
+// Record the modification and change times (to the nanosecond) and inode of
+// the source of the entry added last, so the central directory carries a
+// BURST source stat extra field for it (see base_archive_find_unchanged()).
+// Returns 0 on success, -1 if no entry has been added.
+int burst_writer_set_source_stat(struct burst_writer *writer, const struct stat *st);
+
+// Add a regular file whose content is already in the archive under another name (--dedup)
+// The entry has no data (like an empty file); its content hash extra field is
+// marked as omitted, and the downloader clones the content from the entry with
+// the same hash.
+// lfh: Fully-constructed local file header (STORE method, data descriptor flag set)
+// hash: SHA-256 of the file's content
+// size: Size of the file's content (for statistics)
+// Remaining parameters as for burst_writer_add_file.
+int burst_writer_add_duplicate(struct burst_writer *writer,
+                               struct zip_local_header *lfh,
+                               int lfh_len,
+                               const uint8_t hash[BURST_CONTENT_HASH_SIZE],
+                               uint64_t size,
+                               uint32_t unix_mode,
+                               uint32_t uid,
+                               uint32_t gid);
+
+// True if len bytes at data are all zero (and len > 0)
+bool burst_buffer_is_zero(const uint8_t *data, size_t len);
+
 // Add a symlink to the archive
 // lfh: Fully-constructed local file header (with STORE method, CRC32 and sizes pre-filled)
 //      The LFH flags should NOT have bit 3 set (no data descriptor)
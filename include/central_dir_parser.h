@@ -4,6 +4,7 @@
 #include <stdint.h>
 #include <stddef.h>
 #include <stdbool.h>
+#include <stdatomic.h>
 
 /**
  * @file central_dir_parser.h
@@ -102,6 +103,9 @@
 #define BURST_EOCD_COMMENT_SIZE 8
 #define BURST_EOCD_NO_CDFH_IN_TAIL 0xFFFFFF  // Sentinel: no complete CDFH in tail
 
+// BURST content hash size (must match writer definition): SHA-256
+#define BURST_CONTENT_HASH_SIZE 32
+
 /**
  * File metadata extracted from the central directory.
  *
@@ -115,6 +119,8 @@ struct file_metadata {
     uint64_t uncompressed_size;
     uint32_t crc32;
     uint16_t compression_method;
+    uint16_t last_mod_time;            // DOS time, as stored in the central directory
+    uint16_t last_mod_date;            // DOS date
     uint32_t part_index;               // Derived: local_header_offset / 8MiB
 
     // Unix metadata from external_file_attributes and extra fields
@@ -125,6 +131,49 @@ struct file_metadata {
     bool has_unix_extra;               // True if uid/gid were extracted from extra field
     bool is_symlink;                   // True if (unix_mode & S_IFMT) == S_IFLNK
 
+    // Hardlinks (BURST 0x4C48 extra field): entry has no data of its own and
+    // is another name of this archive entry. Allocated, NULL for other entries.
+    char *hardlink_target;
+
+    // Content hash (BURST 0x4843 extra field, written with --content-hash or --dedup)
+    bool has_content_hash;
+    bool data_omitted;                 // Data stored only under another entry with this hash
+    uint8_t content_hash[BURST_CONTENT_HASH_SIZE];
+
+    // Source file stat (BURST 0x5453 extra field), compared by the writer's --base
+    bool has_source_stat;
+    int64_t mtime_sec;
+    uint32_t mtime_nsec;
+    int64_t ctime_sec;
+    uint32_t ctime_nsec;
+    uint64_t ino;
+
+    // Set when an earlier entry in files[] has the same content and carries
+    // its data. This entry's data is not written; stream_processor_clone_duplicates()
+    // copies it from dedup_source once all parts are done. NULL otherwise.
+    struct file_metadata *dedup_source;
+
+    // Index into dirs[] of the directory containing this entry (0 = top level)
+    size_t parent_dir;
+
+    // Set by whichever of stream_processor_materialize_entries() and the part
+    // processor creates this entry first, for entries that need no data
+    atomic_bool created;
+
+    // Parts holding this entry's data: the part of its local header plus each
+    // part it continues into (0 in results not built by the parser)
+    uint32_t num_parts_spanned;
+
+    // For files spanning several parts: one fd shared by the part processors
+    // writing the file (-1 until the first opens it), how many processors hold
+    // it and how many of the parts have yet to finish with it. Guarded by the
+    // stream processor's shared file lock. The fd is closed once every part is
+    // done; one left open after a failed extraction is closed by
+    // central_dir_parse_result_free().
+    int shared_fd;
+    int shared_fd_holders;
+    int parts_pending;
+
     // ZIP64 tracking
     bool uses_zip64_descriptor;        // True if ZIP64 extra field present (data descriptor is 24 bytes)
 };
@@ -158,6 +207,23 @@ struct part_files {
     struct file_metadata *continuing_file;  // File continuing from prev part, or NULL if none
 };
 
+/** Returned by central_dir_find_dir() for a path that is not in dirs[]. */
+#define CENTRAL_DIR_NO_DIR SIZE_MAX
+
+/**
+ * A directory that holds entries of the archive.
+ *
+ * Every directory named by an entry's path (explicitly, or as a parent) has
+ * one of these, so part processors running concurrently can share which
+ * directories already exist on disk instead of calling mkdir() for every
+ * path component of every file. dirs[0] is the output directory itself.
+ */
+struct archive_dir {
+    char *path;                        // Relative to the output directory, no trailing '/' (allocated)
+    size_t parent;                     // Index into dirs[] (CENTRAL_DIR_NO_DIR for dirs[0])
+    atomic_bool created;               // Set once the directory is known to exist
+};
+
 /**
  * Complete result of parsing a ZIP central directory.
  *
@@ -186,6 +252,13 @@ struct central_dir_parse_result {
     struct part_files *parts;
     size_t num_parts;
 
+    /**
+     * Directories holding the entries, sorted by path (dirs[0] is the
+     * output directory). NULL for results not built by the parser.
+     */
+    struct archive_dir *dirs;
+    size_t num_dirs;
+
     uint64_t central_dir_offset;       // Offset where central directory starts
     uint64_t central_dir_size;         // Size of central directory
     bool is_zip64;                     // Whether ZIP64 structures were detected
@@ -193,6 +266,17 @@ struct central_dir_parse_result {
     char error_message[256];           // Human-readable error message
 };
 
+/**
+ * Find a directory in dirs[].
+ *
+ * @param result Parse result
+ * @param path   Directory path relative to the output directory (need not be NUL-terminated)
+ * @param len    Length of path; 0 for the output directory itself
+ * @return Index into result->dirs, or CENTRAL_DIR_NO_DIR if not found
+ */
+size_t central_dir_find_dir(const struct central_dir_parse_result *result,
+                            const char *path, size_t len);
+
 /**
  * Parse only the EOCD structures to determine central directory location and size.
  * This is a lightweight operation that doesn't parse individual CD entries.
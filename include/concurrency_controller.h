@@ -0,0 +1,80 @@
+#ifndef CONCURRENCY_CONTROLLER_H
+#define CONCURRENCY_CONTROLLER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Chooses how many parts to download at once (--max-concurrent-parts auto).
+ *
+ * The best number depends on whether the network or the disk is the
+ * bottleneck, which varies from one machine to the next. Every sample window
+ * (at least a second, and at least as many finished parts as are in flight)
+ * the controller looks at the restore throughput and at how busy the I/O
+ * workers are:
+ *
+ * - If the workers are nearly always busy or their queues hold most of the
+ *   parts' read windows, the disk is the bottleneck and more parts only hold
+ *   more memory: the target drops by a quarter (multiplicative decrease).
+ * - Otherwise the network is, and the controller hill-climbs: one more part
+ *   each window (additive increase) while that raises throughput by at least
+ *   5%. When it does not, it steps back one part and holds there for a few
+ *   windows before probing again, so it follows conditions that change.
+ */
+
+struct concurrency_controller {
+    size_t min_parts;
+    size_t max_parts;
+    size_t target;  // Parts to keep in flight
+
+    // Current sample window
+    bool started;
+    uint64_t window_start_ns;
+    uint64_t window_bytes;
+    size_t window_parts;
+    uint64_t window_busy_ns;
+
+    double last_throughput;  // Bytes per second over the previous window (0 = none yet)
+    int last_step;  // +1 after an increase, -1 after a decrease, 0 otherwise
+    size_t hold_windows;  // Windows to wait before probing upwards again
+
+    // For reporting
+    size_t lowest;
+    size_t highest;
+    size_t adjustments;
+    double best_throughput;
+    size_t best_target;
+};
+
+/**
+ * One observation of the restore, taken when a part finishes.
+ */
+struct concurrency_sample {
+    uint64_t now_ns;  // Monotonic clock
+    uint64_t bytes_done;  // Archive bytes of parts finished so far
+    size_t parts_done;  // Parts finished so far
+    uint64_t io_busy_ns;  // Time I/O workers have spent processing, from io_pool_get_stats()
+    size_t io_threads;
+    uint64_t io_queued_bytes;  // Part data waiting for an I/O worker
+    uint64_t io_queue_limit;  // Most that can be waiting: target parts' read windows
+};
+
+#define CONCURRENCY_SAMPLE_NS 1000000000ULL  // Shortest sample window
+#define CONCURRENCY_HOLD_WINDOWS 4  // Windows to hold after an increase did not pay off
+
+/**
+ * @param min_parts Fewest parts in flight (at least 1)
+ * @param max_parts Most parts in flight
+ * @param initial_parts Starting target, clamped to [min_parts, max_parts]
+ */
+void concurrency_controller_init(struct concurrency_controller *ctl, size_t min_parts,
+                                 size_t max_parts, size_t initial_parts);
+
+/**
+ * Feed a sample and get the number of parts to keep in flight.
+ */
+size_t concurrency_controller_update(struct concurrency_controller *ctl,
+                                     const struct concurrency_sample *sample);
+
+#endif // CONCURRENCY_CONTROLLER_H
@@ -29,4 +29,19 @@
  */
 int parse_next_frame(const uint8_t *buffer, size_t buffer_len, struct frame_info *info);
 
+/**
+ * Number of bytes the frame at the start of buffer occupies, as far as the
+ * buffer_len bytes present tell.
+ *
+ * Used to complete a frame split across callbacks without copying more than
+ * it needs. When only a prefix of the frame is present the result can be a
+ * lower bound (e.g. up to the next Zstandard block header); ask again once
+ * that many bytes are present.
+ *
+ * @param buffer Start of the frame
+ * @param buffer_len Bytes of the frame present in buffer
+ * @return Bytes required before the frame can make further progress
+ */
+size_t frame_bytes_needed(const uint8_t *buffer, size_t buffer_len);
+
 #endif // FRAME_PARSER_H
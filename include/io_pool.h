@@ -0,0 +1,95 @@
+#ifndef IO_POOL_H
+#define IO_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Worker threads for the filesystem side of extraction.
+ *
+ * S3 body callbacks run on aws-c-s3 event loop threads, which also service
+ * TLS and socket reads for other connections. Rather than opening, writing
+ * and chowning files there, each part's data is copied into an io_stream and
+ * processed on an I/O worker. Chunks of one stream are processed one at a
+ * time in submission order; different streams run in parallel.
+ */
+
+struct io_pool;
+struct io_stream;
+
+/**
+ * Process one chunk of a stream. Runs on an I/O worker.
+ * @return 0 on success; any other value fails the stream
+ */
+typedef int (*io_chunk_fn)(void *ctx, const uint8_t *data, size_t len);
+
+/**
+ * Called on an I/O worker once every chunk submitted before io_stream_finish()
+ * has been processed.
+ * @param rc 0, or the first error returned by the chunk function
+ */
+typedef void (*io_done_fn)(void *ctx, int rc);
+
+/**
+ * Start an I/O pool.
+ *
+ * @param num_threads Number of worker threads (at least 1)
+ * @return Pool, or NULL on error
+ */
+struct io_pool *io_pool_create(size_t num_threads);
+
+/**
+ * Process all queued work, then stop the workers and free the pool.
+ * All streams must have been destroyed.
+ */
+void io_pool_destroy(struct io_pool *pool);
+
+/**
+ * Create a stream on pool. process and done are called with ctx.
+ *
+ * @return Stream, or NULL on allocation failure
+ */
+struct io_stream *io_stream_create(struct io_pool *pool, io_chunk_fn process,
+                                   io_done_fn done, void *ctx);
+
+/**
+ * Queue a copy of len bytes at data for processing.
+ *
+ * @return 0 on success, -1 if the stream has already failed or on allocation failure
+ */
+int io_stream_submit(struct io_stream *stream, const uint8_t *data, size_t len);
+
+/**
+ * Queue the stream's completion: done() runs after all chunks submitted so far.
+ * Call at most once, and submit nothing afterwards.
+ */
+void io_stream_finish(struct io_stream *stream);
+
+/**
+ * Let a stream whose done() has run take more chunks and another
+ * io_stream_finish(), e.g. for a request retried after a failure. May be
+ * called from done() itself. A failed stream stays failed.
+ *
+ * @return 0 on success, -1 on allocation failure
+ */
+int io_stream_reopen(struct io_stream *stream);
+
+/**
+ * Wait until every queued chunk has been processed (or dropped after an
+ * error) and no worker is using the stream, then free it.
+ */
+void io_stream_destroy(struct io_stream *stream);
+
+struct io_pool_stats {
+    uint64_t busy_ns;  // Time workers have spent processing chunks, summed over workers
+    uint64_t queued_bytes;  // Chunk data submitted but not yet processed
+    size_t num_threads;
+};
+
+/**
+ * Read the pool's counters, e.g. to tell whether writing keeps up with downloads.
+ */
+void io_pool_get_stats(struct io_pool *pool, struct io_pool_stats *stats);
+
+#endif // IO_POOL_H
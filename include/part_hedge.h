@@ -0,0 +1,116 @@
+#ifndef PART_HEDGE_H
+#define PART_HEDGE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "archive_source.h"
+
+struct part_prefetch;
+
+/**
+ * Part requests that can be duplicated when they fall behind.
+ *
+ * Near the end of a restore, one or two connections that stall at a
+ * fraction of the usual throughput can keep it running long after every
+ * other part is done. A hedged request wraps a part's request so that the
+ * download coordinator can issue a duplicate for the bytes not yet
+ * delivered, while the original carries on.
+ *
+ * Bytes the duplicate receives that the original has already delivered are
+ * dropped. As soon as the duplicate receives one the original has not, it
+ * takes over: the original is cancelled and the rest streams from the
+ * duplicate. If the original fails first, the duplicate takes over at once.
+ * If the original finishes first, the duplicate is cancelled. Either way the
+ * caller's callbacks see a single response whose body arrives in order,
+ * each byte once, so the part processor never has to rewind.
+ *
+ * finish() is passed on once neither request can call back any more.
+ */
+
+// Rate of parts that finished below which a part is a straggler, as a divisor
+#define PART_HEDGE_SLOWDOWN 4
+
+// Time a request must have run before its rate is judged
+#define PART_HEDGE_MIN_ELAPSED_NS (2 * 1000000000ULL)
+
+// Finished parts needed for a median rate to compare against
+#define PART_HEDGE_MIN_SAMPLES 3
+
+// How often the download coordinator looks for stragglers
+#define PART_HEDGE_CHECK_INTERVAL_NS (250 * 1000000ULL)
+
+/**
+ * A part in flight, as the download coordinator tracks it for hedging.
+ */
+struct hedge_candidate {
+    struct source_request *request;  // From hedged_request_start(); NULL while a retry waits
+    uint64_t sent_ns;                // When request was started (part_hedge_now_ns())
+    uint32_t part_index;
+    bool hedged;                     // Duplicated (or tried to be) since request was started
+};
+
+/**
+ * Start a request for options' range that hedged_request_hedge() can
+ * duplicate, adopting the prefetched request for it if there is one.
+ *
+ * @param prefetch Prefetch to adopt from, or NULL
+ * @return Request, owned by the caller as if from archive_source_request(),
+ *         or NULL on error
+ */
+struct source_request *hedged_request_start(struct archive_source *source,
+                                            struct part_prefetch *prefetch,
+                                            const struct source_request_options *options);
+
+/**
+ * Request the rest of the range again, from the first byte not yet
+ * delivered. Only one duplicate is issued per request.
+ *
+ * @param request Request from hedged_request_start()
+ * @return 0 if a duplicate was started, -1 if not (already hedged, finished,
+ *         cancelled, fully delivered, or the response was an error)
+ */
+int hedged_request_hedge(struct source_request *request);
+
+/**
+ * Body bytes passed to the caller so far.
+ *
+ * @param request Request from hedged_request_start()
+ */
+uint64_t hedged_request_progress(struct source_request *request);
+
+/**
+ * Median of rates (sorted in place).
+ *
+ * @return Median, or 0 if count < PART_HEDGE_MIN_SAMPLES
+ */
+double part_hedge_median_rate(double *rates, size_t count);
+
+/**
+ * Whether a request that has delivered bytes in elapsed_ns is a straggler:
+ * it has run at least PART_HEDGE_MIN_ELAPSED_NS at under 1/PART_HEDGE_SLOWDOWN
+ * of median_rate.
+ *
+ * @param median_rate Bytes per second of finished parts (0 = never)
+ */
+bool part_hedge_is_straggler(uint64_t bytes, uint64_t elapsed_ns, double median_rate);
+
+/**
+ * Duplicate the requests of the slowest stragglers among parts, slowest
+ * first, marking each as hedged.
+ *
+ * @param parts Parts in flight
+ * @param median_rate Bytes per second of finished parts (see part_hedge_median_rate())
+ * @param max_hedges Idle slots the duplicates may use
+ * @return Duplicates started
+ */
+size_t part_hedge_stragglers(struct hedge_candidate *const *parts, size_t count,
+                             double median_rate, uint64_t now_ns, size_t max_hedges);
+
+/**
+ * CLOCK_MONOTONIC in nanoseconds, for hedge_candidate::sent_ns.
+ */
+uint64_t part_hedge_now_ns(void);
+
+#endif // PART_HEDGE_H
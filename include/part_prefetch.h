@@ -0,0 +1,70 @@
+#ifndef PART_PREFETCH_H
+#define PART_PREFETCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "archive_source.h"
+
+/**
+ * Part requests started before the central directory is known.
+ *
+ * Nothing can be written until the tail of the archive has been fetched and
+ * its central directory parsed, which costs at least one round trip of idle
+ * bandwidth. Parts are laid out from offset 0, so the first parts can be
+ * requested alongside the tail without knowing the archive's size.
+ *
+ * Each prefetched part buffers what its request delivers within the
+ * source's read window and then stalls. Once the central directory is
+ * parsed, the download coordinator adopts the request in place of starting
+ * its own: the buffered response is replayed to the coordinator's callbacks
+ * and the rest streams through them as usual. Parts the coordinator will not
+ * download (covered by the tail, holding only central directory, or restored
+ * by an earlier run) are discarded.
+ */
+
+struct part_prefetch;
+
+/**
+ * Request parts 0 to num_parts - 1 of source.
+ *
+ * @param part_size Part size in bytes
+ * @return Prefetch, or NULL on error (nothing is left running)
+ */
+struct part_prefetch *part_prefetch_start(struct archive_source *source, uint64_t part_size,
+                                          uint32_t num_parts);
+
+/**
+ * Cancel the prefetch of part_index, if any; it will not be adopted.
+ */
+void part_prefetch_discard(struct part_prefetch *prefetch, uint32_t part_index);
+
+/**
+ * Cancel the prefetch of every part starting at or after offset.
+ */
+void part_prefetch_discard_from(struct part_prefetch *prefetch, uint64_t offset);
+
+/**
+ * Take over the prefetched request for the range options describes, in
+ * place of archive_source_request().
+ *
+ * The response so far is replayed to options' callbacks before this
+ * returns; later callbacks go to them directly. Nothing is adopted if the
+ * range is not a whole prefetched part, the prefetch failed, or its ETag is
+ * not options->if_match.
+ *
+ * @param prefetch Prefetch, or NULL
+ * @return Request, owned by the caller as if from archive_source_request(),
+ *         or NULL to request the range normally
+ */
+struct source_request *part_prefetch_adopt(struct part_prefetch *prefetch,
+                                           const struct source_request_options *options);
+
+/**
+ * Cancel the prefetches nobody adopted, wait for every prefetched request's
+ * finish callback to return, and free the prefetch.
+ */
+void part_prefetch_destroy(struct part_prefetch *prefetch);
+
+#endif // PART_PREFETCH_H
@@ -0,0 +1,75 @@
+#ifndef PART_SCHEDULE_H
+#define PART_SCHEDULE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "central_dir_parser.h"
+
+/**
+ * Order in which the download coordinators start parts.
+ *
+ * Parts cost very different amounts to restore. One holding thousands of
+ * small files spends its time in open/write/close syscalls; one holding a
+ * slice of a large file spends it decompressing and writing. Started in
+ * index order, runs of one kind leave the disk or the CPU idle, and an
+ * expensive part that happens to come last keeps the restore running long
+ * after every other part is done.
+ *
+ * The cost of a part is estimated from the central directory: the entries
+ * whose local header is in it, and the bytes it writes. Parts whose entries
+ * cost more than their bytes are inode-heavy, the others byte-heavy. Each
+ * kind is taken most expensive first, and the two are interleaved in
+ * proportion to their total cost so that both kinds are in flight for as
+ * long as possible.
+ */
+
+// Rough restore rates used to weigh entries against bytes
+#define PART_SCHEDULE_ENTRIES_PER_SEC 50000.0
+#define PART_SCHEDULE_BYTES_PER_SEC (1024.0 * 1024.0 * 1024.0)
+
+/**
+ * What restoring a part involves.
+ */
+struct part_cost {
+    uint64_t entries;  // Entries whose local header is in the part
+    uint64_t bytes;    // Bytes of file data the part writes
+};
+
+/**
+ * Estimate the cost of every part of cd.
+ *
+ * A file's bytes are spread over the parts its compressed data spans, in
+ * proportion to how much of it each holds. Hardlinks, symlinks and entries
+ * whose data is stored under another entry write no bytes.
+ *
+ * @param part_size Part size in bytes
+ * @param costs Array of cd->num_parts to fill
+ */
+void part_schedule_costs(const struct central_dir_parse_result *cd, uint64_t part_size,
+                         struct part_cost *costs);
+
+/**
+ * Estimated time to restore a part, in seconds.
+ */
+double part_cost_seconds(const struct part_cost *cost);
+
+/**
+ * Whether a part's entries cost more than its bytes.
+ */
+bool part_cost_inode_heavy(const struct part_cost *cost);
+
+/**
+ * Reorder parts for dispatch (see above). Parts below prefetched were
+ * requested before the central directory was read; they keep their place at
+ * the front, in the order given, so their responses are adopted first.
+ *
+ * @param parts Part indexes of cd to start, in index order
+ * @param part_size Part size in bytes
+ * @param prefetched Parts the prefetch requested (0 = none)
+ */
+void part_schedule_order(const struct central_dir_parse_result *cd, uint64_t part_size,
+                         uint32_t *parts, size_t count, size_t prefetched);
+
+#endif // PART_SCHEDULE_H
@@ -48,6 +48,21 @@ struct burst_profile_stats {
     atomic_uint_fast64_t s3_time_ns;        // Network time (total - callback processing)
     atomic_uint_fast64_t s3_bytes;          // Bytes downloaded from S3
 
+    // Frames split across S3 callbacks, reassembled in a part's frame buffer
+    atomic_uint_fast64_t frame_carry_bytes; // Bytes copied to reassemble them
+
+    // Part requests started alongside the tail fetch and adopted once the CD was parsed
+    atomic_uint_fast64_t prefetch_parts;    // Parts adopted
+    atomic_uint_fast64_t prefetch_bytes;    // Bytes they had buffered by then
+
+    // Parts in flight with --max-concurrent-parts auto
+    atomic_uint_fast64_t concurrency_adjustments;  // Times the target changed
+    atomic_uint_fast64_t concurrency_final_parts;  // Target when the last part finished
+
+    // Duplicate requests for straggling parts near the end of a restore
+    atomic_uint_fast64_t hedge_requests;    // Duplicates started
+    atomic_uint_fast64_t hedge_takeovers;   // Duplicates that overtook the original
+
     // Overall timing
     struct timespec start_time;             // Profiling start time
     struct timespec end_time;               // Profiling end time
@@ -0,0 +1,68 @@
+#ifndef RESTORE_JOURNAL_H
+#define RESTORE_JOURNAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Record of the parts of an archive already restored to an output directory.
+ *
+ * With --resume, each part is appended to a journal file in the output
+ * directory once its data has been written. If the downloader is stopped, a
+ * rerun into the same directory skips the parts listed there, so only the
+ * files covering unfinished parts are written again. The journal is tied to
+ * the archive's ETag and size; a journal for any other object is discarded.
+ *
+ * Part data is not synced to disk before it is recorded, so the journal
+ * survives the downloader being killed but not a power failure.
+ */
+
+#define RESTORE_JOURNAL_NAME ".burst-journal"
+
+struct restore_journal;
+
+/**
+ * Open the journal in output_dir, reading the parts it lists if it was written
+ * for the same archive, or starting a new one otherwise.
+ *
+ * @param output_dir Restore target
+ * @param etag ETag of the archive (non-empty)
+ * @param archive_size Size of the archive in bytes
+ * @param num_parts Parts in the archive; larger indices in the file are ignored
+ * @return Journal, or NULL on error
+ */
+struct restore_journal *restore_journal_open(const char *output_dir, const char *etag,
+                                             uint64_t archive_size, size_t num_parts);
+
+/**
+ * Whether part_index was recorded by this or an earlier run.
+ */
+bool restore_journal_has_part(const struct restore_journal *journal, uint32_t part_index);
+
+/**
+ * Number of parts recorded when the journal was opened.
+ */
+size_t restore_journal_resumed_parts(const struct restore_journal *journal);
+
+/**
+ * Append part_index to the journal. Safe to call from several threads.
+ *
+ * @return 0 on success, -1 on error
+ */
+int restore_journal_record(struct restore_journal *journal, uint32_t part_index);
+
+/**
+ * Delete the journal file once the restore is complete. The journal must
+ * still be closed.
+ *
+ * @return 0 on success, -1 on error
+ */
+int restore_journal_remove(struct restore_journal *journal);
+
+/**
+ * Close the journal and free it. The file is kept.
+ */
+void restore_journal_close(struct restore_journal *journal);
+
+#endif // RESTORE_JOURNAL_H
@@ -61,6 +61,7 @@ struct file_metadata;
 // BURST skippable frame type bytes
 #define BURST_TYPE_PADDING 0x00
 #define BURST_TYPE_START_OF_PART 0x01
+#define BURST_TYPE_ZERO_FRAME 0x02
 
 // State machine states
 enum processor_state {
@@ -78,8 +79,11 @@ enum processor_state {
  * Tracks file descriptor and write progress.
  */
 struct file_context {
-    char *filename;             // Full path to output file (allocated)
+    const char *filename;       // Archive name of the entry (owned by cd_result)
     int fd;                     // File descriptor (or -1 if not open)
+    struct file_metadata *shared_meta;  // Set when fd is shared_fd of this entry (file spans parts)
+    size_t parent_dir;          // Index into cd_result->dirs[] (SIZE_MAX without a directory table)
+    const char *name;           // Last component of filename, relative to parent_dir
     uint64_t uncompressed_offset;   // Next write position for BTRFS_IOC_ENCODED_WRITE
                                     // Initialized from Start-of-Part frame for continuing files,
                                     // or 0 for new files. Incremented by each frame's uncompressed size.
@@ -100,10 +104,37 @@ struct file_context {
     size_t symlink_buffer_size; // Allocated size
     size_t symlink_bytes_read;  // Bytes read so far
 
+    // Identical files (file_metadata.dedup_source): frames are consumed but not
+    // written; stream_processor_clone_duplicates() fills the file in afterwards
+    bool skip_data;
+
+    // Set by a zero marker: the next Zstandard frame is all zeros and becomes a hole
+    bool next_frame_zero;
+
+    // The part ended inside this file; the processor of the part holding its
+    // end sets the final size
+    bool continues_in_next_part;
+
     // ZIP64 tracking
     bool uses_zip64_descriptor; // True if data descriptor is 24 bytes (ZIP64), false if 16 bytes
 };
 
+// Directory fds each part processor keeps open
+#define DIR_FD_CACHE_SIZE 8
+
+/**
+ * O_PATH fds of recently used directories from the archive's directory table.
+ * Entries are created relative to them with the *at() calls, so the kernel
+ * looks up a directory's path once rather than once for every file in it.
+ */
+struct dir_fd_cache {
+    size_t dir_index[DIR_FD_CACHE_SIZE];  // Index into cd_result->dirs[]
+    int fd[DIR_FD_CACHE_SIZE];            // -1 for an unused slot
+    uint64_t last_used[DIR_FD_CACHE_SIZE];
+    uint64_t clock;
+    int root_fd;  // output_dir itself, for names outside the directory table (-1 until opened)
+};
+
 /**
  * State for processing a single part.
  * Handles frame boundary spanning and maintains context.
@@ -121,10 +152,17 @@ struct part_processor_state {
     // Current file being processed
     struct file_context *current_file;
 
+    // Parent directories of recent files (closed by finalize and destroy)
+    struct dir_fd_cache dir_fds;
+
+    bool is_root;                   // geteuid() == 0: restore symlink ownership
+
     // Frame buffer for handling partial frames across callbacks
     uint8_t *frame_buffer;
     size_t frame_buffer_capacity;
     size_t frame_buffer_used;
+    size_t frame_buffer_needed;     // Bytes the carried frame needs before it is processed
+    uint64_t frame_bytes_copied;    // Bytes copied into frame_buffer so far
 
     // Position tracking
     size_t next_entry_idx;          // Index into parts[part_index].entries[]
@@ -147,6 +185,7 @@ struct frame_info {
         FRAME_ZSTD_COMPRESSED,
         FRAME_BURST_PADDING,
         FRAME_BURST_START_OF_PART,
+        FRAME_BURST_ZERO,           // Next Zstandard frame decompresses to zeros
         FRAME_ZIP_LOCAL_HEADER,
         FRAME_ZIP_DATA_DESCRIPTOR,
         FRAME_ZIP_CENTRAL_DIRECTORY,
@@ -190,6 +229,21 @@ int part_processor_process_data(
     const uint8_t *data,
     size_t data_len);
 
+/**
+ * Prepare to continue a part from a new request after the previous one
+ * failed part-way.
+ *
+ * Drops the partial frame carried over from the last chunk; everything before
+ * it has been written and the state machine (open file, position within it)
+ * is kept. The data passed to part_processor_process_data() next must start
+ * at the returned archive offset.
+ *
+ * @param state Processor state
+ * @return Archive offset of the first byte not yet processed, which is always
+ *         a frame boundary
+ */
+uint64_t part_processor_rewind(struct part_processor_state *state);
+
 /**
  * Finalize part processing.
  *
@@ -218,4 +272,88 @@ void part_processor_destroy(struct part_processor_state *state);
  */
 const char *part_processor_get_error(const struct part_processor_state *state);
 
+/**
+ * Record that a part will not be processed (restored by an earlier run).
+ *
+ * Files spanning several parts keep one fd open until each of their parts
+ * has finished with it; this counts the part as finished for every file it
+ * holds some of, closing the fd if no other part still needs it.
+ *
+ * @param cd_result   Parse result the part's files come from
+ * @param part_index  Part that will be skipped
+ */
+void stream_processor_skip_part(struct central_dir_parse_result *cd_result, uint32_t part_index);
+
+/**
+ * Materialize files whose content is identical to another entry.
+ *
+ * Call once after every part has been processed with any result for the
+ * archive, passing the complete central directory. Each entry with a
+ * dedup_source is filled from the already-restored source file: with
+ * FICLONE where the filesystem shares extents (BTRFS, XFS), otherwise with
+ * copy_file_range(). Permissions and ownership are applied afterwards by
+ * stream_processor_apply_metadata(), as for files written from the archive.
+ *
+ * @param cd_result   Parse result of the complete central directory
+ * @param output_dir  Directory the archive was extracted to
+ * @return 0 on success, -1 if any file could not be written (details on stderr)
+ */
+int stream_processor_clone_duplicates(struct central_dir_parse_result *cd_result,
+                                      const char *output_dir);
+
+/**
+ * Create what the central directory alone describes, ahead of the part data.
+ *
+ * For files[first] .. files[first + count - 1], creates every directory
+ * (using the shared dirs[] table) and every empty regular file. Part
+ * processors skip the empty files created here. Symlinks, hardlinks and
+ * files with content are left to the part processors: a symlink's target is
+ * stored as its data.
+ *
+ * Safe to call on disjoint ranges from several threads while parts are being
+ * processed.
+ *
+ * @param cd_result   Parse result with the directory table (dirs != NULL)
+ * @param output_dir  Directory the archive is extracted to
+ * @param first       First index into files[]
+ * @param count       Number of entries
+ * @return 0 on success, -1 if any entry could not be created (details on stderr)
+ */
+int stream_processor_materialize_entries(struct central_dir_parse_result *cd_result,
+                                         const char *output_dir,
+                                         size_t first, size_t count);
+
+/**
+ * Apply permissions and ownership to regular files.
+ *
+ * Part processors only write data and set each file's final size, so a file
+ * that spans several parts is not chmod'ed once per part and a read-only mode
+ * cannot get in the way of a later part. Call once every file has been
+ * written and stream_processor_clone_duplicates() has run, then call
+ * stream_processor_apply_directory_metadata(). Ownership is applied (when
+ * running as root) before the mode, since chown() clears set-user-ID bits.
+ *
+ * Safe to call on disjoint ranges from several threads.
+ *
+ * @param cd_result   Parse result of the complete central directory
+ * @param output_dir  Directory the archive was extracted to
+ * @param first       First index into files[]
+ * @param count       Number of entries (directories, symlinks and hardlinks are skipped)
+ * @return 0 on success, -1 on invalid arguments (failures are warnings on stderr)
+ */
+int stream_processor_apply_metadata(struct central_dir_parse_result *cd_result,
+                                    const char *output_dir,
+                                    size_t first, size_t count);
+
+/**
+ * Apply permissions and ownership to directory entries, deepest first, so
+ * that a restrictive mode is only set once everything below it exists.
+ *
+ * @param cd_result   Parse result of the complete central directory
+ * @param output_dir  Directory the archive was extracted to
+ * @return 0 on success, -1 on invalid arguments or allocation failure
+ */
+int stream_processor_apply_directory_metadata(struct central_dir_parse_result *cd_result,
+                                              const char *output_dir);
+
 #endif // STREAM_PROCESSOR_H
@@ -37,6 +37,26 @@
 // ZIP extra field IDs
 #define ZIP_EXTRA_UNIX_7875_ID 0x7875  // Info-ZIP Unix extra field (uid/gid)
 #define ZIP_EXTRA_ZIP64_ID 0x0001      // ZIP64 extended information extra field
+#define ZIP_EXTRA_BURST_HARDLINK_ID 0x4C48  // BURST hardlink ("HL"): entry is another name of a file
+
+// BURST hardlink extra field: Header ID (2) + TSize (2) + Version (1) + target name
+#define BURST_HARDLINK_EXTRA_VERSION 1
+#define BURST_HARDLINK_EXTRA_HEADER_SIZE 5
+
+// BURST content hash extra field: Header ID (2) + TSize (2) + Version (1) +
+// Algorithm (1) + Flags (1) + Hash (32)
+#define ZIP_EXTRA_BURST_CONTENT_HASH_ID 0x4843  // BURST content hash ("CH")
+#define BURST_CONTENT_HASH_EXTRA_VERSION 1
+#define BURST_CONTENT_HASH_ALGO_SHA256 1
+#define BURST_CONTENT_HASH_FLAG_DATA_OMITTED 0x01  // Data is stored under another entry with this hash
+#define BURST_CONTENT_HASH_EXTRA_SIZE (7 + BURST_CONTENT_HASH_SIZE)
+
+// BURST source stat extra field: Header ID (2) + TSize (2) + Version (1) +
+// mtime seconds (8) + mtime nanoseconds (4) + ctime seconds (8) +
+// ctime nanoseconds (4) + inode (8)
+#define ZIP_EXTRA_BURST_SOURCE_STAT_ID 0x5453  // BURST source stat ("ST")
+#define BURST_SOURCE_STAT_EXTRA_VERSION 1
+#define BURST_SOURCE_STAT_EXTRA_SIZE 37
 
 // BURST EOCD comment format (8 bytes):
 // Bytes 0-3: Magic "BRST" (0x54535242 little-endian)
@@ -189,4 +209,22 @@ size_t build_zip64_extra_field(uint8_t *buffer, size_t buffer_size,
                                uint64_t uncompressed_size,
                                uint64_t local_header_offset);
 
+// Build BURST hardlink extra field (0x4C48) naming the archive entry that holds the data
+// Returns the size of the extra field written, or 0 on error
+// The buffer must be at least BURST_HARDLINK_EXTRA_HEADER_SIZE + strlen(target) bytes
+size_t build_hardlink_extra_field(uint8_t *buffer, size_t buffer_size, const char *target);
+
+// Build BURST content hash extra field (0x4843) holding a file's SHA-256
+// Returns the size of the extra field written (BURST_CONTENT_HASH_EXTRA_SIZE), or 0 on error
+// flags: BURST_CONTENT_HASH_FLAG_* bits
+size_t build_content_hash_extra_field(uint8_t *buffer, size_t buffer_size,
+                                      const uint8_t hash[BURST_CONTENT_HASH_SIZE],
+                                      uint8_t flags);
+
+// Build BURST source stat extra field (0x5453) recording when the source file
+// last changed, so a later --base run can tell whether it is unchanged
+// Returns the size of the extra field written (BURST_SOURCE_STAT_EXTRA_SIZE), or 0 on error
+size_t build_source_stat_extra_field(uint8_t *buffer, size_t buffer_size,
+                                     const struct file_entry *entry);
+
 #endif // ZIP_STRUCTURES_H
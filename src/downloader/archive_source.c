@@ -0,0 +1,75 @@
+#include "archive_source.h"
+
+#include <string.h>
+#include <strings.h>
+
+int archive_source_parse_location(const char *location, enum archive_source_kind *kind,
+                                  const char **out_path)
+{
+    if (!location || !kind || !out_path) {
+        return -1;
+    }
+
+    *out_path = NULL;
+    if (strncasecmp(location, "http://", 7) == 0 || strncasecmp(location, "https://", 8) == 0) {
+        *kind = ARCHIVE_SOURCE_HTTP;
+        return 0;
+    }
+    if (strncasecmp(location, "file://", 7) == 0) {
+        *kind = ARCHIVE_SOURCE_FILE;
+        *out_path = location + 7;
+        return **out_path == '/' ? 0 : -1;  // Only file:///path; no hosts
+    }
+
+    // Anything else with a scheme (s3://, ftp://) is not a path
+    const char *colon = strstr(location, "://");
+    if (colon && strcspn(location, "/") > (size_t)(colon - location)) {
+        return -1;
+    }
+
+    *kind = ARCHIVE_SOURCE_FILE;
+    *out_path = location;
+    return location[0] != '\0' ? 0 : -1;
+}
+
+struct source_request *archive_source_request(struct archive_source *source,
+                                              const struct source_request_options *options)
+{
+    if (!source || !options || !options->finish) {
+        return NULL;
+    }
+    return source->ops->request(source, options);
+}
+
+void source_request_open_window(struct source_request *request, size_t len)
+{
+    if (request) {
+        request->ops->open_window(request, len);
+    }
+}
+
+void source_request_cancel(struct source_request *request)
+{
+    if (request) {
+        request->ops->cancel(request);
+    }
+}
+
+void source_request_release(struct source_request *request)
+{
+    if (request) {
+        request->ops->release(request);
+    }
+}
+
+const char *archive_source_error_str(const struct archive_source *source, int error_code)
+{
+    return source->ops->error_str(error_code);
+}
+
+void archive_source_destroy(struct archive_source *source)
+{
+    if (source) {
+        source->ops->destroy(source);
+    }
+}
@@ -15,12 +15,13 @@
 // AWS-dependent code is conditionally compiled
 #ifdef BUILD_WITH_AWS
 #include "burst_downloader.h"
+#include "concurrency_controller.h"
 #include <aws/common/allocator.h>
 #include <aws/common/byte_buf.h>
 #include <aws/common/condition_variable.h>
 #include <aws/common/mutex.h>
-#include <aws/http/request_response.h>
-#include <aws/s3/s3_client.h>
+#include <aws/common/task_scheduler.h>
+#include <aws/io/event_loop.h>
 #endif
 
 int calculate_cd_fetch_ranges(
@@ -328,8 +329,8 @@ struct cd_range_fetch_context {
     int error_code;
     char error_message[256];
 
-    // Meta request handle
-    struct aws_s3_meta_request *meta_request;
+    // Request handle
+    struct source_request *request;
 
     // Coordinator reference
     struct cd_fetch_coordinator *coordinator;
@@ -369,18 +370,15 @@ static int start_range_fetch_async(struct cd_fetch_coordinator *coord, size_t ra
 
 // Body callback - accumulate response data
 static int cd_range_body_callback(
-    struct aws_s3_meta_request *meta_request,
-    const struct aws_byte_cursor *body,
-    uint64_t range_start,
+    struct source_request *request,
+    const uint8_t *data,
+    size_t len,
     void *user_data
 ) {
-    (void)meta_request;
-    (void)range_start;
-
     struct cd_range_fetch_context *ctx = user_data;
 
     // Expand buffer if needed
-    size_t new_size = ctx->buffer_size + body->len;
+    size_t new_size = ctx->buffer_size + len;
     if (new_size > ctx->buffer_capacity) {
         size_t new_capacity = ctx->buffer_capacity == 0 ? 4096 : ctx->buffer_capacity * 2;
         while (new_capacity < new_size) {
@@ -392,7 +390,7 @@ static int cd_range_body_callback(
             ctx->error_code = -1;
             snprintf(ctx->error_message, sizeof(ctx->error_message),
                     "Failed to allocate buffer (%zu bytes)", new_capacity);
-            return AWS_OP_ERR;
+            return -1;
         }
 
         ctx->buffer = new_buffer;
@@ -400,49 +398,40 @@ static int cd_range_body_callback(
     }
 
     // Append data
-    memcpy(ctx->buffer + ctx->buffer_size, body->ptr, body->len);
-    ctx->buffer_size += body->len;
+    memcpy(ctx->buffer + ctx->buffer_size, data, len);
+    ctx->buffer_size += len;
 
-    return AWS_OP_SUCCESS;
+    // Buffered whole, so let the next bytes in straight away
+    source_request_open_window(request, len);
+
+    return 0;
 }
 
 // Headers callback - check HTTP status
-static int cd_range_headers_callback(
-    struct aws_s3_meta_request *meta_request,
-    const struct aws_http_headers *headers,
-    int response_status,
-    void *user_data
-) {
-    (void)meta_request;
-    (void)headers;
-
+static int cd_range_headers_callback(const struct source_response *response, void *user_data) {
     struct cd_range_fetch_context *ctx = user_data;
 
-    if (response_status < 200 || response_status >= 300) {
+    if (response->status < 200 || response->status >= 300) {
         ctx->error_code = -1;
         snprintf(ctx->error_message, sizeof(ctx->error_message),
-                "HTTP error: status %d", response_status);
+                "HTTP error: status %d", response->status);
     }
 
-    return AWS_OP_SUCCESS;
+    return 0;
 }
 
 // Finish callback
-static void cd_range_finish_callback(
-    struct aws_s3_meta_request *meta_request,
-    const struct aws_s3_meta_request_result *result,
-    void *user_data
-) {
-    (void)meta_request;
+static void cd_range_finish_callback(int error_code, int response_status, void *user_data) {
+    (void)response_status;
 
     struct cd_range_fetch_context *ctx = user_data;
     struct cd_fetch_coordinator *coord = ctx->coordinator;
 
     // Record error if any
-    if (result->error_code != AWS_ERROR_SUCCESS && ctx->error_code == 0) {
-        ctx->error_code = result->error_code;
-        snprintf(ctx->error_message, sizeof(ctx->error_message),
-                "S3 request failed: %s", aws_error_debug_str(result->error_code));
+    if (error_code != 0 && ctx->error_code == 0) {
+        ctx->error_code = error_code;
+        snprintf(ctx->error_message, sizeof(ctx->error_message), "Request failed: %s",
+                 archive_source_error_str(ctx->downloader->source, error_code));
     }
 
     aws_mutex_lock(&coord->mutex);
@@ -462,8 +451,8 @@ static void cd_range_finish_callback(
             for (size_t i = 0; i < coord->total_ranges; i++) {
                 if (coord->contexts[i] &&
                     coord->contexts[i] != ctx &&
-                    coord->contexts[i]->meta_request) {
-                    aws_s3_meta_request_cancel(coord->contexts[i]->meta_request);
+                    coord->contexts[i]->request) {
+                    source_request_cancel(coord->contexts[i]->request);
                 }
             }
         }
@@ -524,66 +513,30 @@ static int start_range_fetch_async(struct cd_fetch_coordinator *coord, size_t ra
     ctx->error_code = 0;
     ctx->error_message[0] = '\0';
 
-    coord->contexts[range_index] = ctx;
-
-    // Build HTTP request
-    struct aws_http_message *message = aws_http_message_new_request(downloader->allocator);
-    if (!message) {
-        free(ctx);
-        coord->contexts[range_index] = NULL;
-        return -1;
-    }
-
-    aws_http_message_set_request_method(message, aws_http_method_get);
-
-    // Set path
-    struct aws_byte_buf path_buf;
-    aws_byte_buf_init(&path_buf, downloader->allocator, strlen(downloader->key) + 2);
-    aws_byte_buf_append_byte_dynamic(&path_buf, '/');
-    struct aws_byte_cursor key_cursor = aws_byte_cursor_from_c_str(downloader->key);
-    aws_byte_buf_append_dynamic(&path_buf, &key_cursor);
-    struct aws_byte_cursor path_cursor = aws_byte_cursor_from_buf(&path_buf);
-    aws_http_message_set_request_path(message, path_cursor);
-
-    // Set Host header
-    char host_value[256];
-    snprintf(host_value, sizeof(host_value), "%s.s3.%s.amazonaws.com",
-             downloader->bucket, downloader->region);
-    struct aws_http_header host_header = {
-        .name = aws_byte_cursor_from_c_str("Host"),
-        .value = aws_byte_cursor_from_c_str(host_value),
-    };
-    aws_http_message_add_header(message, host_header);
-
-    // Set Range header
-    char range_value[128];
-    snprintf(range_value, sizeof(range_value), "bytes=%llu-%llu",
-             (unsigned long long)range->start, (unsigned long long)range->end);
-    struct aws_http_header range_header = {
-        .name = aws_byte_cursor_from_c_str("Range"),
-        .value = aws_byte_cursor_from_c_str(range_value),
-    };
-    aws_http_message_add_header(message, range_header);
-
-    // Create meta request
-    struct aws_s3_meta_request_options options = {
-        .type = AWS_S3_META_REQUEST_TYPE_GET_OBJECT,
-        .message = message,
+    struct source_request_options options = {
+        .start = range->start,
+        .end = range->end,
+        .headers = cd_range_headers_callback,
+        .body = cd_range_body_callback,
+        .finish = cd_range_finish_callback,
         .user_data = ctx,
-        .headers_callback = cd_range_headers_callback,
-        .body_callback = cd_range_body_callback,
-        .finish_callback = cd_range_finish_callback,
     };
 
-    ctx->meta_request = aws_s3_client_make_meta_request(downloader->s3_client, &options);
-    aws_http_message_release(message);
-    aws_byte_buf_clean_up(&path_buf);
-
-    if (!ctx->meta_request) {
-        free(ctx);
+    // Published under the mutex, which the finish callback takes, so the
+    // range cannot complete before it is recorded
+    aws_mutex_lock(&coord->mutex);
+    coord->contexts[range_index] = ctx;
+    ctx->request = archive_source_request(downloader->source, &options);
+    if (!ctx->request) {
         coord->contexts[range_index] = NULL;
+        aws_mutex_unlock(&coord->mutex);
+        free(ctx);
         return -1;
     }
+    if (coord->cancel_requested) {
+        source_request_cancel(ctx->request);
+    }
+    aws_mutex_unlock(&coord->mutex);
 
     return 0;
 }
@@ -677,8 +630,8 @@ int burst_downloader_fetch_cd_ranges(
     // Cleanup contexts
     for (size_t i = 0; i < num_ranges; i++) {
         if (contexts[i]) {
-            if (contexts[i]->meta_request) {
-                aws_s3_meta_request_release(contexts[i]->meta_request);
+            if (contexts[i]->request) {
+                source_request_release(contexts[i]->request);
             }
             if (contexts[i]->buffer) {
                 free(contexts[i]->buffer);
@@ -714,6 +667,10 @@ int burst_downloader_fetch_cd_ranges(
 
 #include "central_dir_parser.h"
 #include "stream_processor.h"
+#include "io_pool.h"
+#include "restore_journal.h"
+#include "part_hedge.h"
+#include "part_schedule.h"
 
 // Context for hybrid part downloads (similar to stream_part_context)
 struct hybrid_part_context {
@@ -724,12 +681,27 @@ struct hybrid_part_context {
     int error_code;
     char error_message[256];
 
-    // Meta request handle
-    struct aws_s3_meta_request *meta_request;
+    // Request handle
+    struct source_request *request;
 
     // Coordinator reference
     struct hybrid_download_coordinator *coordinator;
     uint32_t part_index;
+
+    // Body data is processed on an I/O worker, in order
+    struct io_stream *io;
+    struct source_request *window_request;  // Read window opened as chunks are written
+    int source_error_code;  // From the finish callback, for the I/O worker
+    int response_status;  // HTTP status of the current request, 0 until headers arrive
+
+    // Retries of a request that failed part-way
+    uint32_t retries;
+    uint64_t resume_offset;  // Archive offset the next request starts at
+    struct aws_task retry_task;
+
+    // Progress of the current request, to hedge it if it straggles
+    struct hedge_candidate hedge;
+    uint64_t first_sent_ns;  // When the part's first request started
 };
 
 // Hybrid download coordinator structure
@@ -781,6 +753,11 @@ struct hybrid_download_coordinator {
     // Per-part contexts
     struct hybrid_part_context **part_contexts;
 
+    // Straggler hedging once no work is left to dispatch
+    double *part_rates;  // Bytes per second of each finished part
+    size_t num_part_rates;
+    struct hedge_candidate **hedge_candidates;  // Scratch, one per part
+
     // Concurrency tracking
     size_t in_flight;  // Total in-flight requests (CD + parts)
 
@@ -796,7 +773,9 @@ struct hybrid_download_coordinator {
 
 // Forward declarations
 static void hybrid_dispatch_next(struct hybrid_download_coordinator *coord);
-static int hybrid_start_part_download(struct hybrid_download_coordinator *coord, uint32_t part_index);
+static int hybrid_start_part_download(struct hybrid_download_coordinator *coord, uint32_t part_index,
+                                      struct central_dir_parse_result *cd);
+static int hybrid_send_part_request(struct hybrid_part_context *ctx);
 static int hybrid_start_cd_range_fetch(struct hybrid_download_coordinator *coord, size_t range_index);
 
 /**
@@ -873,7 +852,8 @@ static void build_early_part_queue(struct hybrid_download_coordinator *coord) {
 
 /**
  * Build the late part queue after full CD is parsed.
- * This adds all parts not already dispatched.
+ * This adds all parts not already dispatched, ordered by the cost the full CD
+ * gives them (see part_schedule.h).
  */
 static void build_late_part_queue(struct hybrid_download_coordinator *coord) {
     coord->late_queue_count = 0;
@@ -909,6 +889,10 @@ static void build_late_part_queue(struct hybrid_download_coordinator *coord) {
         }
     }
 
+    part_schedule_order(coord->full_cd, coord->downloader->part_size, coord->late_part_queue,
+                        coord->late_queue_count,
+                        coord->downloader->prefetch ? coord->downloader->prefetch_parts : 0);
+
     printf("Full CD: built late queue with %zu additional parts\n", coord->late_queue_count);
 }
 
@@ -998,20 +982,41 @@ static int hybrid_assemble_and_parse_cd(struct hybrid_download_coordinator *coor
     return 0;
 }
 
+/**
+ * Split each part between the two parse results once the full CD is in use
+ * (called with mutex held, as cd_complete is set).
+ *
+ * A file spanning parts keeps its shared fd open until every one of its parts
+ * has run against the same parse result. Parts dispatched so far (or restored
+ * by an earlier run) only ever run against partial_cd, and the rest only
+ * against full_cd, so each result counts the other's parts as skipped.
+ */
+static void hybrid_split_parts_between_cds(struct hybrid_download_coordinator *coord) {
+    size_t num_parts = coord->full_cd->num_parts;
+    if (coord->partial_cd->num_parts > num_parts) {
+        num_parts = coord->partial_cd->num_parts;
+    }
+
+    for (size_t p = 0; p < num_parts; p++) {
+        if (coord->part_dispatched[p]) {
+            stream_processor_skip_part(coord->full_cd, (uint32_t)p);
+        } else {
+            stream_processor_skip_part(coord->partial_cd, (uint32_t)p);
+        }
+    }
+}
+
 // CD range fetch callbacks for hybrid coordinator
 static int hybrid_cd_range_body_callback(
-    struct aws_s3_meta_request *meta_request,
-    const struct aws_byte_cursor *body,
-    uint64_t range_start,
+    struct source_request *request,
+    const uint8_t *data,
+    size_t len,
     void *user_data
 ) {
-    (void)meta_request;
-    (void)range_start;
-
     struct cd_range_fetch_context *ctx = user_data;
 
     // Expand buffer if needed
-    size_t new_size = ctx->buffer_size + body->len;
+    size_t new_size = ctx->buffer_size + len;
     if (new_size > ctx->buffer_capacity) {
         size_t new_capacity = ctx->buffer_capacity == 0 ? 4096 : ctx->buffer_capacity * 2;
         while (new_capacity < new_size) {
@@ -1023,7 +1028,7 @@ static int hybrid_cd_range_body_callback(
             ctx->error_code = -1;
             snprintf(ctx->error_message, sizeof(ctx->error_message),
                     "Failed to allocate buffer (%zu bytes)", new_capacity);
-            return AWS_OP_ERR;
+            return -1;
         }
 
         ctx->buffer = new_buffer;
@@ -1031,48 +1036,39 @@ static int hybrid_cd_range_body_callback(
     }
 
     // Append data
-    memcpy(ctx->buffer + ctx->buffer_size, body->ptr, body->len);
-    ctx->buffer_size += body->len;
+    memcpy(ctx->buffer + ctx->buffer_size, data, len);
+    ctx->buffer_size += len;
 
-    return AWS_OP_SUCCESS;
-}
+    // Buffered whole, so let the next bytes in straight away
+    source_request_open_window(request, len);
 
-static int hybrid_cd_range_headers_callback(
-    struct aws_s3_meta_request *meta_request,
-    const struct aws_http_headers *headers,
-    int response_status,
-    void *user_data
-) {
-    (void)meta_request;
-    (void)headers;
+    return 0;
+}
 
+static int hybrid_cd_range_headers_callback(const struct source_response *response, void *user_data) {
     struct cd_range_fetch_context *ctx = user_data;
 
-    if (response_status < 200 || response_status >= 300) {
+    if (response->status < 200 || response->status >= 300) {
         ctx->error_code = -1;
         snprintf(ctx->error_message, sizeof(ctx->error_message),
-                "HTTP error: status %d", response_status);
+                "HTTP error: status %d", response->status);
     }
 
-    return AWS_OP_SUCCESS;
+    return 0;
 }
 
-static void hybrid_cd_range_finish_callback(
-    struct aws_s3_meta_request *meta_request,
-    const struct aws_s3_meta_request_result *result,
-    void *user_data
-) {
-    (void)meta_request;
+static void hybrid_cd_range_finish_callback(int error_code, int response_status, void *user_data) {
+    (void)response_status;
 
     struct cd_range_fetch_context *ctx = user_data;
     struct hybrid_download_coordinator *coord =
         (struct hybrid_download_coordinator *)ctx->coordinator;
 
     // Record error if any
-    if (result->error_code != AWS_ERROR_SUCCESS && ctx->error_code == 0) {
-        ctx->error_code = result->error_code;
-        snprintf(ctx->error_message, sizeof(ctx->error_message),
-                "S3 request failed: %s", aws_error_debug_str(result->error_code));
+    if (error_code != 0 && ctx->error_code == 0) {
+        ctx->error_code = error_code;
+        snprintf(ctx->error_message, sizeof(ctx->error_message), "Request failed: %s",
+                 archive_source_error_str(ctx->downloader->source, error_code));
     }
 
     aws_mutex_lock(&coord->mutex);
@@ -1106,6 +1102,7 @@ static void hybrid_cd_range_finish_callback(
             aws_mutex_lock(&coord->mutex);
             if (rc == 0) {
                 coord->cd_complete = true;
+                hybrid_split_parts_between_cds(coord);
                 // Build late part queue with new full CD
                 build_late_part_queue(coord);
             } else {
@@ -1127,78 +1124,68 @@ static void hybrid_cd_range_finish_callback(
     aws_mutex_unlock(&coord->mutex);
 }
 
-// Part download callbacks for hybrid coordinator
-static int hybrid_part_body_callback(
-    struct aws_s3_meta_request *meta_request,
-    const struct aws_byte_cursor *body,
-    uint64_t range_start,
-    void *user_data
-) {
-    (void)meta_request;
-    (void)range_start;
-
+// Feed one chunk of body data to the stream processor (runs on an I/O worker)
+static int hybrid_process_part_chunk(void *user_data, const uint8_t *data, size_t len) {
     struct hybrid_part_context *ctx = user_data;
 
-    // Feed chunk directly to stream processor
-    int rc = part_processor_process_data(ctx->processor, body->ptr, body->len);
-
+    int rc = part_processor_process_data(ctx->processor, data, len);
     if (rc != STREAM_PROC_SUCCESS) {
         ctx->error_code = rc;
         snprintf(ctx->error_message, sizeof(ctx->error_message),
                  "Stream processor error: %s", part_processor_get_error(ctx->processor));
-        return AWS_OP_ERR;
+        return rc;
     }
 
-    return AWS_OP_SUCCESS;
+    // Written to disk, so the request may receive another len bytes
+    source_request_open_window(ctx->window_request, len);
+
+    return 0;
 }
 
-static int hybrid_part_headers_callback(
-    struct aws_s3_meta_request *meta_request,
-    const struct aws_http_headers *headers,
-    int response_status,
+// Part download callbacks for hybrid coordinator
+static int hybrid_part_body_callback(
+    struct source_request *request,
+    const uint8_t *data,
+    size_t len,
     void *user_data
 ) {
-    (void)meta_request;
-    (void)headers;
+    struct hybrid_part_context *ctx = user_data;
+    ctx->window_request = request;
 
+    // Copy the chunk for an I/O worker; the event loop goes back to networking
+    if (io_stream_submit(ctx->io, data, len) != 0) {
+        return -1;  // Processing already failed for this part
+    }
+
+    return 0;
+}
+
+static int hybrid_part_headers_callback(const struct source_response *response, void *user_data) {
     struct hybrid_part_context *ctx = user_data;
+    ctx->response_status = response->status;
 
-    if (response_status < 200 || response_status >= 300) {
+    if (response->status < 200 || response->status >= 300) {
         snprintf(ctx->error_message, sizeof(ctx->error_message),
-                "HTTP error: status code %d", response_status);
+                "HTTP error: status code %d", response->status);
         ctx->error_code = -1;
     }
 
-    return AWS_OP_SUCCESS;
+    return 0;
 }
 
-static void hybrid_part_finish_callback(
-    struct aws_s3_meta_request *meta_request,
-    const struct aws_s3_meta_request_result *result,
-    void *user_data
-) {
-    (void)meta_request;
+static void hybrid_part_finish_callback(int error_code, int response_status, void *user_data) {
+    (void)response_status;
 
     struct hybrid_part_context *ctx = user_data;
-    struct hybrid_download_coordinator *coord = ctx->coordinator;
 
-    // Record error in context
-    if (result->error_code != AWS_ERROR_SUCCESS && ctx->error_code == 0) {
-        ctx->error_code = result->error_code;
-        snprintf(ctx->error_message, sizeof(ctx->error_message),
-                "S3 request failed: %s", aws_error_debug_str(result->error_code));
-    }
+    // hybrid_finish_part() runs on the I/O worker once the part's data is written
+    ctx->source_error_code = error_code;
+    io_stream_finish(ctx->io);
+}
 
-    // Finalize the processor for this part (if no error)
-    if (ctx->error_code == 0 && ctx->processor) {
-        int finalize_rc = part_processor_finalize(ctx->processor);
-        if (finalize_rc != STREAM_PROC_SUCCESS) {
-            ctx->error_code = finalize_rc;
-            snprintf(ctx->error_message, sizeof(ctx->error_message),
-                    "Failed to finalize part %u: %s",
-                    ctx->part_index, part_processor_get_error(ctx->processor));
-        }
-    }
+// Count a part as done, stop dispatching if it failed, and dispatch more work
+static void hybrid_complete_part(struct hybrid_part_context *ctx) {
+    struct hybrid_download_coordinator *coord = ctx->coordinator;
 
     aws_mutex_lock(&coord->mutex);
 
@@ -1213,10 +1200,23 @@ static void hybrid_part_finish_callback(
                     sizeof(coord->first_error_message) - 1);
             coord->first_error_message[sizeof(coord->first_error_message) - 1] = '\0';
         }
+    } else {
+        coord->max_concurrent = burst_downloader_adapt_concurrency(coord->downloader,
+                                                                   ctx->part_index);
+        uint64_t elapsed_ns = part_hedge_now_ns() - ctx->first_sent_ns;
+        if (elapsed_ns > 0) {
+            coord->part_rates[coord->num_part_rates++] =
+                (double)ctx->downloader->part_size * 1e9 / (double)elapsed_ns;
+        }
     }
 
-    // Dispatch next work item
-    hybrid_dispatch_next(coord);
+    // Dispatch work items: one to replace this part, or more or none when
+    // the target changed
+    size_t prev_in_flight;
+    do {
+        prev_in_flight = coord->in_flight;
+        hybrid_dispatch_next(coord);
+    } while (coord->in_flight > prev_in_flight);
 
     // Signal if all done
     if (coord->in_flight == 0) {
@@ -1226,6 +1226,113 @@ static void hybrid_part_finish_callback(
     aws_mutex_unlock(&coord->mutex);
 }
 
+// Event loop task: re-request the rest of a part after its backoff delay
+static void hybrid_retry_part_task(struct aws_task *task, void *arg, enum aws_task_status status) {
+    (void)task;
+    struct hybrid_part_context *ctx = arg;
+
+    if (status == AWS_TASK_STATUS_RUN_READY && hybrid_send_part_request(ctx) == 0) {
+        return;
+    }
+
+    ctx->error_code = -1;
+    snprintf(ctx->error_message, sizeof(ctx->error_message),
+             "Failed to restart part %u download", ctx->part_index);
+    hybrid_complete_part(ctx);
+}
+
+// Schedule another request for the rest of a part whose request failed
+// part-way. Returns -1 if the failure is not worth retrying.
+static int hybrid_schedule_part_retry(struct hybrid_part_context *ctx) {
+    struct hybrid_download_coordinator *coord = ctx->coordinator;
+
+    // Retries wait on an event loop, which a local file source has none of
+    if (!ctx->downloader->event_loop_group || ctx->retries >= BURST_PART_MAX_RETRIES ||
+        !part_failure_is_transient(ctx->response_status)) {
+        return -1;
+    }
+
+    aws_mutex_lock(&coord->mutex);
+    bool cancelled = coord->cancel_requested;
+    if (!cancelled) {
+        // Finished; straggler hedging must not look at it again
+        source_request_release(ctx->request);
+        ctx->request = NULL;
+        ctx->hedge.request = NULL;
+    }
+    aws_mutex_unlock(&coord->mutex);
+    if (cancelled || io_stream_reopen(ctx->io) != 0) {
+        return -1;
+    }
+
+    ctx->retries++;
+    ctx->resume_offset = part_processor_rewind(ctx->processor);
+    uint64_t delay_ms = calculate_retry_delay_ms(ctx->retries, (uint32_t)rand());
+    fprintf(stderr, "Warning: part %u: %s; resuming at offset %llu in %llu ms (retry %u/%d)\n",
+            ctx->part_index, ctx->error_message, (unsigned long long)ctx->resume_offset,
+            (unsigned long long)delay_ms, ctx->retries, BURST_PART_MAX_RETRIES);
+
+    ctx->error_code = 0;
+    ctx->error_message[0] = '\0';
+    ctx->source_error_code = 0;
+    ctx->response_status = 0;
+
+    struct aws_event_loop *loop =
+        aws_event_loop_group_get_next_loop(ctx->downloader->event_loop_group);
+    uint64_t now_ns = 0;
+    aws_event_loop_current_clock_time(loop, &now_ns);
+    aws_task_init(&ctx->retry_task, hybrid_retry_part_task, ctx, "burst_part_retry");
+    aws_event_loop_schedule_task_future(loop, &ctx->retry_task, now_ns + delay_ms * 1000000ULL);
+    return 0;
+}
+
+// Finalize a part and dispatch more work (runs on an I/O worker after all of
+// the part's body data has been processed)
+static void hybrid_finish_part(void *user_data, int rc) {
+    struct hybrid_part_context *ctx = user_data;
+
+    // Record error in context
+    if (ctx->source_error_code != 0 && ctx->error_code == 0) {
+        ctx->error_code = ctx->source_error_code;
+        snprintf(ctx->error_message, sizeof(ctx->error_message), "Request failed: %s",
+                 archive_source_error_str(ctx->downloader->source, ctx->source_error_code));
+    }
+    if (rc != 0 && ctx->error_code == 0) {
+        ctx->error_code = rc;
+        snprintf(ctx->error_message, sizeof(ctx->error_message),
+                 "Failed to process part %u", ctx->part_index);
+    }
+
+    // A request that failed part-way continues where the processor stopped
+    if (rc == 0 && ctx->error_code != 0) {
+        uint64_t part_end = (uint64_t)(ctx->part_index + 1) * ctx->downloader->part_size;
+        if (ctx->processor->state == STATE_DONE ||
+            ctx->processor->part_start_offset + ctx->processor->bytes_processed >= part_end) {
+            // Failed after the part's last frame: nothing is missing
+            ctx->error_code = 0;
+            ctx->error_message[0] = '\0';
+        } else if (hybrid_schedule_part_retry(ctx) == 0) {
+            return;
+        }
+    }
+
+    // Finalize the processor for this part (if no error)
+    if (ctx->error_code == 0 && ctx->processor) {
+        int finalize_rc = part_processor_finalize(ctx->processor);
+        if (finalize_rc != STREAM_PROC_SUCCESS) {
+            ctx->error_code = finalize_rc;
+            snprintf(ctx->error_message, sizeof(ctx->error_message),
+                    "Failed to finalize part %u: %s",
+                    ctx->part_index, part_processor_get_error(ctx->processor));
+        }
+    }
+    if (ctx->error_code == 0 && ctx->downloader->journal) {
+        restore_journal_record(ctx->downloader->journal, ctx->part_index);
+    }
+
+    hybrid_complete_part(ctx);
+}
+
 /**
  * Dispatch next work item based on priority (called with mutex held).
  */
@@ -1265,9 +1372,12 @@ static void hybrid_dispatch_next(struct hybrid_download_coordinator *coord) {
             coord->part_dispatched[part] = true;
             coord->in_flight++;
 
+            // Once the full CD is parsed, the rest of the early queue runs against it
+            struct central_dir_parse_result *cd =
+                coord->cd_complete ? coord->full_cd : coord->partial_cd;
             aws_mutex_unlock(&coord->mutex);
             printf("Starting early part %u/%zu...\n", part + 1, coord->num_parts);
-            int rc = hybrid_start_part_download(coord, part);
+            int rc = hybrid_start_part_download(coord, part, cd);
             aws_mutex_lock(&coord->mutex);
 
             if (rc != 0) {
@@ -1291,7 +1401,7 @@ static void hybrid_dispatch_next(struct hybrid_download_coordinator *coord) {
 
                 aws_mutex_unlock(&coord->mutex);
                 printf("Starting late part %u/%zu...\n", part + 1, coord->num_parts);
-                int rc = hybrid_start_part_download(coord, part);
+                int rc = hybrid_start_part_download(coord, part, coord->full_cd);
                 aws_mutex_lock(&coord->mutex);
 
                 if (rc != 0) {
@@ -1307,6 +1417,42 @@ static void hybrid_dispatch_next(struct hybrid_download_coordinator *coord) {
     }
 }
 
+/**
+ * Once no work is left to dispatch, duplicate the requests of parts that fell
+ * far behind the others into the idle slots (called with mutex held).
+ */
+static void hybrid_hedge_stragglers(struct hybrid_download_coordinator *coord) {
+    if (coord->cancel_requested || !coord->cd_complete ||
+        coord->cd_ranges_dispatched < coord->cd_ranges_total ||
+        coord->early_queue_next < coord->early_queue_count ||
+        coord->late_queue_next < coord->late_queue_count) {
+        return;
+    }
+
+    // A hedged part takes a second slot
+    size_t max_parts = (size_t)((coord->archive_size + coord->downloader->part_size - 1) /
+                                 coord->downloader->part_size);
+    size_t busy = coord->in_flight;
+    size_t count = 0;
+    for (size_t i = 0; i < max_parts; i++) {
+        struct hybrid_part_context *ctx = coord->part_contexts[i];
+        if (!ctx || coord->part_complete[i]) {
+            continue;
+        }
+        if (ctx->hedge.hedged) {
+            busy++;
+        }
+        coord->hedge_candidates[count++] = &ctx->hedge;
+    }
+    if (busy >= coord->max_concurrent || count == 0) {
+        return;
+    }
+
+    double median_rate = part_hedge_median_rate(coord->part_rates, coord->num_part_rates);
+    part_hedge_stragglers(coord->hedge_candidates, count, median_rate, part_hedge_now_ns(),
+                          coord->max_concurrent - busy);
+}
+
 static int hybrid_start_cd_range_fetch(struct hybrid_download_coordinator *coord, size_t range_index) {
     struct burst_downloader *downloader = coord->downloader;
     const struct cd_part_range *range = &coord->cd_ranges[range_index];
@@ -1324,55 +1470,13 @@ static int hybrid_start_cd_range_fetch(struct hybrid_download_coordinator *coord
     ctx->error_code = 0;
     ctx->error_message[0] = '\0';
 
-    coord->cd_contexts[range_index] = ctx;
-
-    // Build HTTP request
-    struct aws_http_message *message = aws_http_message_new_request(downloader->allocator);
-    if (!message) {
-        free(ctx);
-        coord->cd_contexts[range_index] = NULL;
-        return -1;
-    }
-
-    aws_http_message_set_request_method(message, aws_http_method_get);
-
-    // Set path
-    struct aws_byte_buf path_buf;
-    aws_byte_buf_init(&path_buf, downloader->allocator, strlen(downloader->key) + 2);
-    aws_byte_buf_append_byte_dynamic(&path_buf, '/');
-    struct aws_byte_cursor key_cursor = aws_byte_cursor_from_c_str(downloader->key);
-    aws_byte_buf_append_dynamic(&path_buf, &key_cursor);
-    struct aws_byte_cursor path_cursor = aws_byte_cursor_from_buf(&path_buf);
-    aws_http_message_set_request_path(message, path_cursor);
-
-    // Set Host header
-    char host_value[256];
-    snprintf(host_value, sizeof(host_value), "%s.s3.%s.amazonaws.com",
-             downloader->bucket, downloader->region);
-    struct aws_http_header host_header = {
-        .name = aws_byte_cursor_from_c_str("Host"),
-        .value = aws_byte_cursor_from_c_str(host_value),
-    };
-    aws_http_message_add_header(message, host_header);
-
-    // Set Range header
-    char range_value[128];
-    snprintf(range_value, sizeof(range_value), "bytes=%llu-%llu",
-             (unsigned long long)range->start, (unsigned long long)range->end);
-    struct aws_http_header range_header = {
-        .name = aws_byte_cursor_from_c_str("Range"),
-        .value = aws_byte_cursor_from_c_str(range_value),
-    };
-    aws_http_message_add_header(message, range_header);
-
-    // Create meta request
-    struct aws_s3_meta_request_options options = {
-        .type = AWS_S3_META_REQUEST_TYPE_GET_OBJECT,
-        .message = message,
+    struct source_request_options options = {
+        .start = range->start,
+        .end = range->end,
+        .headers = hybrid_cd_range_headers_callback,
+        .body = hybrid_cd_range_body_callback,
+        .finish = hybrid_cd_range_finish_callback,
         .user_data = ctx,
-        .headers_callback = hybrid_cd_range_headers_callback,
-        .body_callback = hybrid_cd_range_body_callback,
-        .finish_callback = hybrid_cd_range_finish_callback,
     };
 
     printf("Fetching CD range %zu/%zu (bytes %llu-%llu)...\n",
@@ -1380,25 +1484,28 @@ static int hybrid_start_cd_range_fetch(struct hybrid_download_coordinator *coord
            (unsigned long long)range->start,
            (unsigned long long)range->end);
 
-    ctx->meta_request = aws_s3_client_make_meta_request(downloader->s3_client, &options);
-    aws_http_message_release(message);
-    aws_byte_buf_clean_up(&path_buf);
-
-    if (!ctx->meta_request) {
-        free(ctx);
+    // Published under the mutex, which the finish callback takes, so the
+    // range cannot complete before it is recorded
+    aws_mutex_lock(&coord->mutex);
+    coord->cd_contexts[range_index] = ctx;
+    ctx->request = archive_source_request(downloader->source, &options);
+    if (!ctx->request) {
         coord->cd_contexts[range_index] = NULL;
+        aws_mutex_unlock(&coord->mutex);
+        free(ctx);
         return -1;
     }
+    aws_mutex_unlock(&coord->mutex);
 
     return 0;
 }
 
-static int hybrid_start_part_download(struct hybrid_download_coordinator *coord, uint32_t part_index) {
+// cd is the parse result chosen when the part was dispatched (see
+// hybrid_split_parts_between_cds)
+static int hybrid_start_part_download(struct hybrid_download_coordinator *coord, uint32_t part_index,
+                                      struct central_dir_parse_result *cd) {
     struct burst_downloader *downloader = coord->downloader;
 
-    // Use partial_cd for early downloads, full_cd for late downloads
-    struct central_dir_parse_result *cd = coord->cd_complete ? coord->full_cd : coord->partial_cd;
-
     // Create processor for this part
     struct part_processor_state *processor =
         part_processor_create(part_index, cd, downloader->output_dir,
@@ -1422,70 +1529,67 @@ static int hybrid_start_part_download(struct hybrid_download_coordinator *coord,
     ctx->error_code = 0;
     ctx->error_message[0] = '\0';
 
-    coord->part_contexts[part_index] = ctx;
+    ctx->io = io_stream_create(downloader->io_pool, hybrid_process_part_chunk,
+                               hybrid_finish_part, ctx);
+    if (!ctx->io) {
+        part_processor_destroy(processor);
+        free(ctx);
+        return -1;
+    }
 
-    // Calculate byte range for this part
-    uint64_t start = (uint64_t)part_index * downloader->part_size;
-    uint64_t end = start + downloader->part_size - 1;
+    ctx->resume_offset = (uint64_t)part_index * downloader->part_size;
+    coord->part_contexts[part_index] = ctx;
 
-    // Build HTTP message
-    struct aws_http_message *message = aws_http_message_new_request(downloader->allocator);
-    if (!message) {
+    if (hybrid_send_part_request(ctx) != 0) {
         coord->part_contexts[part_index] = NULL;
+        io_stream_destroy(ctx->io);
         part_processor_destroy(processor);
         free(ctx);
         return -1;
     }
 
-    aws_http_message_set_request_method(message, aws_http_method_get);
-
-    // Set path
-    struct aws_byte_buf path_buf;
-    aws_byte_buf_init(&path_buf, downloader->allocator, strlen(downloader->key) + 2);
-    aws_byte_buf_append_byte_dynamic(&path_buf, '/');
-    struct aws_byte_cursor key_cursor = aws_byte_cursor_from_c_str(downloader->key);
-    aws_byte_buf_append_dynamic(&path_buf, &key_cursor);
-    struct aws_byte_cursor path_cursor = aws_byte_cursor_from_buf(&path_buf);
-    aws_http_message_set_request_path(message, path_cursor);
-
-    // Set Host header
-    char host_value[256];
-    snprintf(host_value, sizeof(host_value), "%s.s3.%s.amazonaws.com",
-             downloader->bucket, downloader->region);
-    struct aws_http_header host_header = {
-        .name = aws_byte_cursor_from_c_str("Host"),
-        .value = aws_byte_cursor_from_c_str(host_value),
-    };
-    aws_http_message_add_header(message, host_header);
-
-    // Set Range header
-    char range_value[128];
-    snprintf(range_value, sizeof(range_value), "bytes=%llu-%llu",
-             (unsigned long long)start, (unsigned long long)end);
-    struct aws_http_header range_header = {
-        .name = aws_byte_cursor_from_c_str("Range"),
-        .value = aws_byte_cursor_from_c_str(range_value),
-    };
-    aws_http_message_add_header(message, range_header);
+    return 0;
+}
 
-    // Create meta request
-    struct aws_s3_meta_request_options options = {
-        .type = AWS_S3_META_REQUEST_TYPE_GET_OBJECT,
-        .message = message,
+// Request the part's bytes from ctx->resume_offset to its end
+static int hybrid_send_part_request(struct hybrid_part_context *ctx) {
+    struct burst_downloader *downloader = ctx->downloader;
+    uint32_t part_index = ctx->part_index;
+
+    // Calculate byte range for this part
+    uint64_t start = ctx->resume_offset;
+    uint64_t end = (uint64_t)part_index * downloader->part_size + downloader->part_size - 1;
+
+    struct source_request_options options = {
+        .start = start,
+        .end = end,
+        // Only from the object version the central directory came from
+        .if_match = downloader->etag,
+        .headers = hybrid_part_headers_callback,
+        .body = hybrid_part_body_callback,
+        .finish = hybrid_part_finish_callback,
         .user_data = ctx,
-        .headers_callback = hybrid_part_headers_callback,
-        .body_callback = hybrid_part_body_callback,
-        .finish_callback = hybrid_part_finish_callback,
     };
 
-    ctx->meta_request = aws_s3_client_make_meta_request(downloader->s3_client, &options);
-    aws_http_message_release(message);
-    aws_byte_buf_clean_up(&path_buf);
+    // Published under the mutex, which completing the part takes, so the
+    // request cannot finish before it is recorded
+    struct hybrid_download_coordinator *coord = ctx->coordinator;
+    aws_mutex_lock(&coord->mutex);
+    ctx->request = hedged_request_start(downloader->source, downloader->prefetch, &options);
+    ctx->hedge = (struct hedge_candidate){
+        .request = ctx->request,
+        .sent_ns = part_hedge_now_ns(),
+        .part_index = part_index,
+    };
+    if (ctx->first_sent_ns == 0) {
+        ctx->first_sent_ns = ctx->hedge.sent_ns;
+    }
+    if (ctx->request && coord->cancel_requested) {
+        source_request_cancel(ctx->request);
+    }
+    aws_mutex_unlock(&coord->mutex);
 
-    if (!ctx->meta_request) {
-        coord->part_contexts[part_index] = NULL;
-        part_processor_destroy(processor);
-        free(ctx);
+    if (!ctx->request) {
         return -1;
     }
 
@@ -1517,7 +1621,8 @@ struct hybrid_download_coordinator *hybrid_coordinator_create(
     aws_condition_variable_init(&coord->cv);
 
     // Configuration
-    coord->max_concurrent = downloader->max_concurrent_parts;
+    coord->max_concurrent = downloader->concurrency ? downloader->concurrency->target
+                                                    : downloader->max_concurrent_parts;
     coord->downloader = downloader;
     coord->archive_size = archive_size;
     coord->is_zip64 = is_zip64;
@@ -1560,12 +1665,24 @@ struct hybrid_download_coordinator *hybrid_coordinator_create(
     coord->early_part_queue = calloc(max_parts, sizeof(uint32_t));
     coord->late_part_queue = calloc(max_parts, sizeof(uint32_t));
     coord->part_contexts = calloc(max_parts, sizeof(struct hybrid_part_context *));
+    coord->part_rates = calloc(max_parts, sizeof(double));
+    coord->hedge_candidates = calloc(max_parts, sizeof(struct hedge_candidate *));
 
     if (!coord->part_dispatched || !coord->part_complete ||
-        !coord->early_part_queue || !coord->late_part_queue || !coord->part_contexts) {
+        !coord->early_part_queue || !coord->late_part_queue || !coord->part_contexts ||
+        !coord->part_rates || !coord->hedge_candidates) {
         goto error;
     }
 
+    // Parts restored by an earlier run are neither downloaded nor taken from the buffer
+    for (size_t p = 0; p < max_parts; p++) {
+        if (restore_journal_has_part(downloader->journal, (uint32_t)p)) {
+            coord->part_dispatched[p] = true;
+            coord->part_complete[p] = true;
+            stream_processor_skip_part(partial_cd, (uint32_t)p);
+        }
+    }
+
     // Build early part queue from partial CD
     build_early_part_queue(coord);
 
@@ -1594,9 +1711,22 @@ int hybrid_coordinator_run(struct hybrid_download_coordinator *coord) {
         }
     }
 
-    // Wait for all work to complete
+    // Lay out the directories and empty files known so far while the first
+    // parts are in flight; entries only in the full CD are created by their parts
+    aws_mutex_unlock(&coord->mutex);
+    int materialize_rc = burst_downloader_materialize_entries(coord->downloader, coord->partial_cd);
+    aws_mutex_lock(&coord->mutex);
+    if (materialize_rc != 0 && !coord->cancel_requested) {
+        coord->cancel_requested = true;
+        coord->first_error_code = -1;
+        snprintf(coord->first_error_message, sizeof(coord->first_error_message),
+                 "Failed to create directories and empty files");
+    }
+
+    // Wait for all work to complete, hedging stragglers near the end
     while (coord->in_flight > 0) {
-        aws_condition_variable_wait(&coord->cv, &coord->mutex);
+        aws_condition_variable_wait_for(&coord->cv, &coord->mutex, PART_HEDGE_CHECK_INTERVAL_NS);
+        hybrid_hedge_stragglers(coord);
     }
 
     aws_mutex_unlock(&coord->mutex);
@@ -1669,12 +1799,26 @@ int hybrid_coordinator_run(struct hybrid_download_coordinator *coord) {
                     }
 
                     coord->part_complete[p] = true;
+                    if (coord->downloader->journal) {
+                        restore_journal_record(coord->downloader->journal, (uint32_t)p);
+                    }
                     break;
                 }
             }
         }
     }
 
+    // Identical files can only be filled in once their sources are complete
+    if (coord->full_cd &&
+        stream_processor_clone_duplicates(coord->full_cd, coord->downloader->output_dir) != 0) {
+        return -1;
+    }
+
+    if (coord->full_cd &&
+        burst_downloader_apply_metadata(coord->downloader, coord->full_cd) != 0) {
+        return -1;
+    }
+
     return 0;
 }
 
@@ -1687,8 +1831,8 @@ void hybrid_coordinator_destroy(struct hybrid_download_coordinator *coord) {
     if (coord->cd_contexts) {
         for (size_t i = 0; i < coord->cd_ranges_total; i++) {
             if (coord->cd_contexts[i]) {
-                if (coord->cd_contexts[i]->meta_request) {
-                    aws_s3_meta_request_release(coord->cd_contexts[i]->meta_request);
+                if (coord->cd_contexts[i]->request) {
+                    source_request_release(coord->cd_contexts[i]->request);
                 }
                 if (coord->cd_contexts[i]->buffer) {
                     free(coord->cd_contexts[i]->buffer);
@@ -1716,8 +1860,11 @@ void hybrid_coordinator_destroy(struct hybrid_download_coordinator *coord) {
     if (coord->part_contexts) {
         for (size_t i = 0; i < max_parts; i++) {
             if (coord->part_contexts[i]) {
-                if (coord->part_contexts[i]->meta_request) {
-                    aws_s3_meta_request_release(coord->part_contexts[i]->meta_request);
+                // Wait for the I/O worker to let go of the part before releasing
+                // its request and freeing its processor
+                io_stream_destroy(coord->part_contexts[i]->io);
+                if (coord->part_contexts[i]->request) {
+                    source_request_release(coord->part_contexts[i]->request);
                 }
                 if (coord->part_contexts[i]->processor) {
                     part_processor_destroy(coord->part_contexts[i]->processor);
@@ -1733,6 +1880,8 @@ void hybrid_coordinator_destroy(struct hybrid_download_coordinator *coord) {
     free(coord->part_complete);
     free(coord->early_part_queue);
     free(coord->late_part_queue);
+    free(coord->part_rates);
+    free(coord->hedge_candidates);
 
     // Free full CD result (owned by coordinator)
     if (coord->full_cd) {
@@ -4,6 +4,7 @@
 #include <string.h>
 #include <stdio.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
 // ZIP64 signatures and constants
 #define ZIP64_EOCD_LOCATOR_SIG 0x07064b50
@@ -84,6 +85,124 @@ static bool parse_unix_extra_field(const uint8_t *extra_field, uint16_t extra_le
     return false;
 }
 
+/**
+ * Parse BURST hardlink extra field (0x4C48) to extract the target entry name.
+ *
+ * @param extra_field    Pointer to extra field data (after fixed header)
+ * @param extra_len      Length of extra field data
+ * @param target         Output: allocated, null-terminated target name
+ * @return 0 if no valid field is present or it was parsed, -1 on allocation failure
+ */
+static int parse_hardlink_extra_field(const uint8_t *extra_field, uint16_t extra_len,
+                                      char **target) {
+    const uint8_t *ptr = extra_field;
+    const uint8_t *end = extra_field + extra_len;
+
+    while (ptr + 4 <= end) {
+        uint16_t header_id;
+        uint16_t data_size;
+        memcpy(&header_id, ptr, sizeof(uint16_t));
+        memcpy(&data_size, ptr + 2, sizeof(uint16_t));
+        ptr += 4;
+
+        if (ptr + data_size > end) {
+            break;
+        }
+
+        // Version (1 byte) followed by the target name, not null-terminated
+        if (header_id == ZIP_EXTRA_BURST_HARDLINK_ID) {
+            if (data_size < 2 || ptr[0] != BURST_HARDLINK_EXTRA_VERSION) {
+                return 0;  // Unknown version: restore as a plain (empty) file
+            }
+            *target = strndup((const char *)ptr + 1, data_size - 1);
+            return *target ? 0 : -1;
+        }
+
+        ptr += data_size;
+    }
+
+    return 0;
+}
+
+/**
+ * Parse BURST content hash extra field (0x4843).
+ *
+ * @param extra_field    Pointer to extra field data (after fixed header)
+ * @param extra_len      Length of extra field data
+ * @param file           Output: has_content_hash, data_omitted and content_hash
+ */
+static void parse_content_hash_extra_field(const uint8_t *extra_field, uint16_t extra_len,
+                                           struct file_metadata *file) {
+    const uint8_t *ptr = extra_field;
+    const uint8_t *end = extra_field + extra_len;
+
+    while (ptr + 4 <= end) {
+        uint16_t header_id;
+        uint16_t data_size;
+        memcpy(&header_id, ptr, sizeof(uint16_t));
+        memcpy(&data_size, ptr + 2, sizeof(uint16_t));
+        ptr += 4;
+
+        if (ptr + data_size > end) {
+            break;
+        }
+
+        // Version (1) + Algorithm (1) + Flags (1) + Hash (32)
+        if (header_id == ZIP_EXTRA_BURST_CONTENT_HASH_ID) {
+            if (data_size >= 3 + BURST_CONTENT_HASH_SIZE &&
+                ptr[0] == BURST_CONTENT_HASH_EXTRA_VERSION &&
+                ptr[1] == BURST_CONTENT_HASH_ALGO_SHA256) {
+                file->has_content_hash = true;
+                file->data_omitted = (ptr[2] & BURST_CONTENT_HASH_FLAG_DATA_OMITTED) != 0;
+                memcpy(file->content_hash, ptr + 3, BURST_CONTENT_HASH_SIZE);
+            }
+            return;
+        }
+
+        ptr += data_size;
+    }
+}
+
+/**
+ * Parse BURST source stat extra field (0x5453).
+ *
+ * @param extra_field    Pointer to extra field data (after fixed header)
+ * @param extra_len      Length of extra field data
+ * @param file           Output: has_source_stat, mtime, ctime and ino
+ */
+static void parse_source_stat_extra_field(const uint8_t *extra_field, uint16_t extra_len,
+                                          struct file_metadata *file) {
+    const uint8_t *ptr = extra_field;
+    const uint8_t *end = extra_field + extra_len;
+
+    while (ptr + 4 <= end) {
+        uint16_t header_id;
+        uint16_t data_size;
+        memcpy(&header_id, ptr, sizeof(uint16_t));
+        memcpy(&data_size, ptr + 2, sizeof(uint16_t));
+        ptr += 4;
+
+        if (ptr + data_size > end) {
+            break;
+        }
+
+        // Version (1) + Mtime (8) + Mtime nsec (4) + Ctime (8) + Ctime nsec (4) + Inode (8)
+        if (header_id == ZIP_EXTRA_BURST_SOURCE_STAT_ID) {
+            if (data_size >= 33 && ptr[0] == BURST_SOURCE_STAT_EXTRA_VERSION) {
+                file->has_source_stat = true;
+                memcpy(&file->mtime_sec, ptr + 1, 8);
+                memcpy(&file->mtime_nsec, ptr + 9, 4);
+                memcpy(&file->ctime_sec, ptr + 13, 8);
+                memcpy(&file->ctime_nsec, ptr + 21, 4);
+                memcpy(&file->ino, ptr + 25, 8);
+            }
+            return;
+        }
+
+        ptr += data_size;
+    }
+}
+
 /**
  * Parse ZIP64 extended information extra field (0x0001) from central directory.
  *
@@ -365,6 +484,8 @@ static int parse_central_directory(
         file_array[i].uncompressed_size = header->uncompressed_size;
         file_array[i].crc32 = header->crc32;
         file_array[i].compression_method = header->compression_method;
+        file_array[i].last_mod_time = header->last_mod_time;
+        file_array[i].last_mod_date = header->last_mod_date;
         file_array[i].uses_zip64_descriptor = false;  // Will be set if ZIP64 extra field found
 
         // Extract Unix mode from external_file_attributes
@@ -399,6 +520,7 @@ static int parse_central_directory(
             // Cleanup and return error
             for (size_t j = 0; j < i; j++) {
                 free(file_array[j].filename);
+                free(file_array[j].hardlink_target);
             }
             free(file_array);
             return CENTRAL_DIR_PARSE_ERR_TRUNCATED;
@@ -410,6 +532,7 @@ static int parse_central_directory(
             // Cleanup and return error
             for (size_t j = 0; j < i; j++) {
                 free(file_array[j].filename);
+                free(file_array[j].hardlink_target);
             }
             free(file_array);
             return CENTRAL_DIR_PARSE_ERR_MEMORY;
@@ -426,6 +549,25 @@ static int parse_central_directory(
                 extra_field_ptr, header->extra_field_length,
                 &file_array[i].uid, &file_array[i].gid);
 
+            // Parse hardlink target (0x4C48)
+            if (parse_hardlink_extra_field(extra_field_ptr, header->extra_field_length,
+                                           &file_array[i].hardlink_target) != 0) {
+                for (size_t j = 0; j <= i; j++) {
+                    free(file_array[j].filename);
+                    free(file_array[j].hardlink_target);
+                }
+                free(file_array);
+                return CENTRAL_DIR_PARSE_ERR_MEMORY;
+            }
+
+            // Parse content hash (0x4843)
+            parse_content_hash_extra_field(extra_field_ptr, header->extra_field_length,
+                                           &file_array[i]);
+
+            // Parse source stat (0x5453)
+            parse_source_stat_extra_field(extra_field_ptr, header->extra_field_length,
+                                          &file_array[i]);
+
             // Parse ZIP64 extra field (0x0001)
             // The presence of ZIP64 extra field indicates the file uses ZIP64 data descriptor
             file_array[i].uses_zip64_descriptor = parse_zip64_extra_field(
@@ -448,6 +590,251 @@ static int parse_central_directory(
     return CENTRAL_DIR_PARSE_SUCCESS;
 }
 
+/**
+ * Comparison function for sorting pointers into files[] by content hash,
+ * then by position in the array (central directory order).
+ */
+static int compare_content_hash(const void *a, const void *b) {
+    const struct file_metadata *fa = *(const struct file_metadata *const *)a;
+    const struct file_metadata *fb = *(const struct file_metadata *const *)b;
+    int cmp = memcmp(fa->content_hash, fb->content_hash, BURST_CONTENT_HASH_SIZE);
+    if (cmp != 0) {
+        return cmp;
+    }
+    return (fa > fb) - (fa < fb);
+}
+
+/**
+ * Group regular files with equal content hashes.
+ *
+ * Within each group the first entry (in central directory order) whose data
+ * is in the archive becomes the source; every other member gets dedup_source
+ * pointing at it. Entries with omitted data and no source in this result
+ * (e.g. a partial CD that starts after it) keep dedup_source NULL.
+ *
+ * @return CENTRAL_DIR_PARSE_SUCCESS, or CENTRAL_DIR_PARSE_ERR_MEMORY
+ */
+static int group_duplicate_files(struct file_metadata *files, size_t num_files) {
+    size_t num_hashed = 0;
+    for (size_t i = 0; i < num_files; i++) {
+        if (files[i].has_content_hash && !files[i].hardlink_target && !files[i].is_symlink) {
+            num_hashed++;
+        }
+    }
+    if (num_hashed < 2) {
+        return CENTRAL_DIR_PARSE_SUCCESS;
+    }
+
+    struct file_metadata **order = malloc(num_hashed * sizeof(struct file_metadata *));
+    if (!order) {
+        return CENTRAL_DIR_PARSE_ERR_MEMORY;
+    }
+    size_t n = 0;
+    for (size_t i = 0; i < num_files; i++) {
+        if (files[i].has_content_hash && !files[i].hardlink_target && !files[i].is_symlink) {
+            order[n++] = &files[i];
+        }
+    }
+    qsort(order, num_hashed, sizeof(struct file_metadata *), compare_content_hash);
+
+    size_t group_start = 0;
+    while (group_start < num_hashed) {
+        size_t group_end = group_start + 1;
+        while (group_end < num_hashed &&
+               memcmp(order[group_end]->content_hash, order[group_start]->content_hash,
+                      BURST_CONTENT_HASH_SIZE) == 0) {
+            group_end++;
+        }
+
+        // Members are in central directory order, so the first with data is the source
+        struct file_metadata *source = NULL;
+        for (size_t k = group_start; k < group_end; k++) {
+            struct file_metadata *file = order[k];
+            if (!file->data_omitted && file->uncompressed_size > 0) {
+                source = file;
+                break;
+            }
+        }
+        if (source) {
+            for (size_t k = group_start; k < group_end; k++) {
+                struct file_metadata *file = order[k];
+                if (file != source) {
+                    file->dedup_source = source;
+                }
+            }
+        }
+
+        group_start = group_end;
+    }
+
+    free(order);
+    return CENTRAL_DIR_PARSE_SUCCESS;
+}
+
+/**
+ * A directory path inside an entry's filename (not NUL-terminated).
+ */
+struct dir_slice {
+    const char *path;
+    size_t len;
+};
+
+static int compare_paths(const char *a, size_t a_len, const char *b, size_t b_len) {
+    int cmp = memcmp(a, b, a_len < b_len ? a_len : b_len);
+    if (cmp != 0) {
+        return cmp;
+    }
+    return (a_len > b_len) - (a_len < b_len);
+}
+
+static int compare_dir_slices(const void *a, const void *b) {
+    const struct dir_slice *da = (const struct dir_slice *)a;
+    const struct dir_slice *db = (const struct dir_slice *)b;
+    return compare_paths(da->path, da->len, db->path, db->len);
+}
+
+/**
+ * Length of the directory part of path[0..len), without the final '/'.
+ * 0 if path has no directory part.
+ */
+static size_t parent_dir_len(const char *path, size_t len) {
+    while (len > 0 && path[len - 1] != '/') {
+        len--;
+    }
+    return len > 0 ? len - 1 : 0;
+}
+
+// Sort slices and drop duplicates, returning the new count
+static size_t sort_unique_dir_slices(struct dir_slice *slices, size_t count) {
+    qsort(slices, count, sizeof(struct dir_slice), compare_dir_slices);
+    size_t n = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (n == 0 || compare_dir_slices(&slices[n - 1], &slices[i]) != 0) {
+            slices[n++] = slices[i];
+        }
+    }
+    return n;
+}
+
+static bool dir_slice_present(const struct dir_slice *slices, size_t count,
+                              const char *path, size_t len) {
+    struct dir_slice key = { path, len };
+    return bsearch(&key, slices, count, sizeof(struct dir_slice), compare_dir_slices) != NULL;
+}
+
+size_t central_dir_find_dir(const struct central_dir_parse_result *result,
+                            const char *path, size_t len) {
+    if (!result || !result->dirs) {
+        return CENTRAL_DIR_NO_DIR;
+    }
+
+    size_t lo = 0;
+    size_t hi = result->num_dirs;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        const char *mid_path = result->dirs[mid].path;
+        int cmp = compare_paths(path, len, mid_path, strlen(mid_path));
+        if (cmp == 0) {
+            return mid;
+        }
+        if (cmp < 0) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return CENTRAL_DIR_NO_DIR;
+}
+
+/**
+ * Build dirs[]: every directory an entry lives in or names, plus all of their
+ * ancestors, sorted by path. Sets parent_dir on every file.
+ *
+ * @return CENTRAL_DIR_PARSE_SUCCESS, or CENTRAL_DIR_PARSE_ERR_MEMORY
+ */
+static int build_dir_table(struct central_dir_parse_result *result) {
+    // The output directory, each entry's parent and each directory entry itself
+    size_t capacity = 1 + 2 * result->num_files;
+    struct dir_slice *slices = malloc(capacity * sizeof(struct dir_slice));
+    if (!slices) {
+        return CENTRAL_DIR_PARSE_ERR_MEMORY;
+    }
+
+    size_t count = 0;
+    slices[count++] = (struct dir_slice){ "", 0 };
+    for (size_t i = 0; i < result->num_files; i++) {
+        const char *name = result->files[i].filename;
+        size_t len = strlen(name);
+        if (len > 0 && name[len - 1] == '/') {
+            len--;
+            slices[count++] = (struct dir_slice){ name, len };
+        }
+        slices[count++] = (struct dir_slice){ name, parent_dir_len(name, len) };
+    }
+    count = sort_unique_dir_slices(slices, count);
+
+    // Add ancestors that no entry names directly (e.g. "a" when only "a/b/c" is stored)
+    size_t known = count;
+    for (size_t i = 0; i < known; i++) {
+        size_t len = parent_dir_len(slices[i].path, slices[i].len);
+        while (len > 0 && !dir_slice_present(slices, known, slices[i].path, len)) {
+            if (count == capacity) {
+                capacity *= 2;
+                struct dir_slice *grown = realloc(slices, capacity * sizeof(struct dir_slice));
+                if (!grown) {
+                    free(slices);
+                    return CENTRAL_DIR_PARSE_ERR_MEMORY;
+                }
+                slices = grown;
+            }
+            slices[count++] = (struct dir_slice){ slices[i].path, len };
+            len = parent_dir_len(slices[i].path, len);
+        }
+    }
+    if (count > known) {
+        count = sort_unique_dir_slices(slices, count);
+    }
+
+    struct archive_dir *dirs = calloc(count, sizeof(struct archive_dir));
+    if (!dirs) {
+        free(slices);
+        return CENTRAL_DIR_PARSE_ERR_MEMORY;
+    }
+    for (size_t i = 0; i < count; i++) {
+        dirs[i].path = strndup(slices[i].path, slices[i].len);
+        if (!dirs[i].path) {
+            for (size_t j = 0; j < i; j++) {
+                free(dirs[j].path);
+            }
+            free(dirs);
+            free(slices);
+            return CENTRAL_DIR_PARSE_ERR_MEMORY;
+        }
+        atomic_init(&dirs[i].created, false);
+    }
+    free(slices);
+
+    result->dirs = dirs;
+    result->num_dirs = count;
+
+    // "" sorts first, so dirs[0] is the output directory
+    dirs[0].parent = CENTRAL_DIR_NO_DIR;
+    for (size_t i = 1; i < count; i++) {
+        dirs[i].parent = central_dir_find_dir(result, dirs[i].path,
+                                              parent_dir_len(dirs[i].path, strlen(dirs[i].path)));
+    }
+    for (size_t i = 0; i < result->num_files; i++) {
+        const char *name = result->files[i].filename;
+        size_t len = strlen(name);
+        if (len > 0 && name[len - 1] == '/') {
+            len--;
+        }
+        result->files[i].parent_dir = central_dir_find_dir(result, name, parent_dir_len(name, len));
+    }
+
+    return CENTRAL_DIR_PARSE_SUCCESS;
+}
+
 /**
  * Comparison function for sorting part_file_entry by offset_in_part.
  */
@@ -573,11 +960,19 @@ static int build_part_map(
             if (file_start < part_start && file_data_end > part_start) {
                 // This file continues into this part
                 parts[part_idx].continuing_file = &files[i];
+                files[i].num_parts_spanned++;
                 break;
             }
         }
     }
 
+    // Files spanning parts share one fd between the processors of those parts
+    for (size_t i = 0; i < num_files; i++) {
+        files[i].num_parts_spanned++;  // The part holding the local header
+        files[i].shared_fd = -1;
+        files[i].parts_pending = (int)files[i].num_parts_spanned;
+    }
+
     *parts_out = parts;
     *num_parts_out = num_parts;
 
@@ -842,13 +1237,32 @@ int central_dir_parse_from_cd_buffer(const uint8_t *cd_buffer, size_t cd_buffer_
         return rc;
     }
 
+    // Link identical files to the entry whose data is written
+    rc = group_duplicate_files(result->files, result->num_files);
+
     // Build part mapping
-    rc = build_part_map(result->files, result->num_files, archive_size, part_size,
-                        &result->parts, &result->num_parts);
+    if (rc == CENTRAL_DIR_PARSE_SUCCESS) {
+        rc = build_part_map(result->files, result->num_files, archive_size, part_size,
+                            &result->parts, &result->num_parts);
+    }
+
+    // Index the directories entries are extracted into
+    if (rc == CENTRAL_DIR_PARSE_SUCCESS) {
+        rc = build_dir_table(result);
+        if (rc != CENTRAL_DIR_PARSE_SUCCESS) {
+            for (size_t i = 0; i < result->num_parts; i++) {
+                free(result->parts[i].entries);
+            }
+            free(result->parts);
+            result->parts = NULL;
+            result->num_parts = 0;
+        }
+    }
     if (rc != CENTRAL_DIR_PARSE_SUCCESS) {
         // Cleanup files on error
         for (size_t i = 0; i < result->num_files; i++) {
             free(result->files[i].filename);
+            free(result->files[i].hardlink_target);
         }
         free(result->files);
         result->files = NULL;
@@ -856,7 +1270,7 @@ int central_dir_parse_from_cd_buffer(const uint8_t *cd_buffer, size_t cd_buffer_
 
         result->error_code = rc;
         snprintf(result->error_message, sizeof(result->error_message),
-                "Failed to build part mapping");
+                "Failed to build part mapping or group identical files");
         return rc;
     }
 
@@ -954,6 +1368,12 @@ void central_dir_parse_result_free(struct central_dir_parse_result *result) {
     // Free each filename
     for (size_t i = 0; i < result->num_files; i++) {
         free(result->files[i].filename);
+        free(result->files[i].hardlink_target);
+
+        // Shared fd of a file whose parts did not all finish
+        if (result->files[i].num_parts_spanned > 1 && result->files[i].shared_fd >= 0) {
+            close(result->files[i].shared_fd);
+        }
     }
 
     // Free files array
@@ -967,6 +1387,12 @@ void central_dir_parse_result_free(struct central_dir_parse_result *result) {
     // Free parts array
     free(result->parts);
 
+    // Free directory table
+    for (size_t i = 0; i < result->num_dirs; i++) {
+        free(result->dirs[i].path);
+    }
+    free(result->dirs);
+
     // Zero out structure
     memset(result, 0, sizeof(*result));
 }
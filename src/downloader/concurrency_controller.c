@@ -0,0 +1,100 @@
+#include "concurrency_controller.h"
+
+#include <string.h>
+
+// Disk-bound when the I/O workers are busy this much of the window...
+#define DISK_BUSY_FRACTION 0.9
+// ...or this much of the parts' read windows is waiting to be written
+#define DISK_BACKLOG_FRACTION 0.75
+// An increase must raise throughput by this much to be kept
+#define MIN_GAIN 1.05
+
+void concurrency_controller_init(struct concurrency_controller *ctl, size_t min_parts,
+                                 size_t max_parts, size_t initial_parts)
+{
+    memset(ctl, 0, sizeof(*ctl));
+    ctl->min_parts = min_parts > 0 ? min_parts : 1;
+    ctl->max_parts = max_parts > ctl->min_parts ? max_parts : ctl->min_parts;
+    ctl->target = initial_parts;
+    if (ctl->target < ctl->min_parts) {
+        ctl->target = ctl->min_parts;
+    }
+    if (ctl->target > ctl->max_parts) {
+        ctl->target = ctl->max_parts;
+    }
+    ctl->lowest = ctl->target;
+    ctl->highest = ctl->target;
+    ctl->best_target = ctl->target;
+}
+
+static void start_window(struct concurrency_controller *ctl, const struct concurrency_sample *sample)
+{
+    ctl->started = true;
+    ctl->window_start_ns = sample->now_ns;
+    ctl->window_bytes = sample->bytes_done;
+    ctl->window_parts = sample->parts_done;
+    ctl->window_busy_ns = sample->io_busy_ns;
+}
+
+size_t concurrency_controller_update(struct concurrency_controller *ctl,
+                                     const struct concurrency_sample *sample)
+{
+    if (!ctl->started) {
+        start_window(ctl, sample);
+        return ctl->target;
+    }
+
+    uint64_t elapsed_ns = sample->now_ns - ctl->window_start_ns;
+    if (elapsed_ns < CONCURRENCY_SAMPLE_NS || sample->parts_done - ctl->window_parts < ctl->target) {
+        return ctl->target;
+    }
+
+    double seconds = (double)elapsed_ns / 1e9;
+    double throughput = (double)(sample->bytes_done - ctl->window_bytes) / seconds;
+    double busy = sample->io_threads > 0
+                  ? (double)(sample->io_busy_ns - ctl->window_busy_ns) /
+                    ((double)elapsed_ns * (double)sample->io_threads)
+                  : 0.0;
+    double backlog = sample->io_queue_limit > 0
+                     ? (double)sample->io_queued_bytes / (double)sample->io_queue_limit
+                     : 0.0;
+
+    if (throughput > ctl->best_throughput) {
+        ctl->best_throughput = throughput;
+        ctl->best_target = ctl->target;
+    }
+
+    size_t target = ctl->target;
+    if (busy >= DISK_BUSY_FRACTION || backlog >= DISK_BACKLOG_FRACTION) {
+        // Writing is the bottleneck: parts in flight only wait and hold memory
+        size_t step = target / 4 > 0 ? target / 4 : 1;
+        target = target > ctl->min_parts + step ? target - step : ctl->min_parts;
+        ctl->hold_windows = CONCURRENCY_HOLD_WINDOWS / 2;
+    } else if (ctl->last_step > 0 && throughput < ctl->last_throughput * MIN_GAIN) {
+        // The last part added did not pay for itself
+        if (target > ctl->min_parts) {
+            target--;
+        }
+        ctl->hold_windows = CONCURRENCY_HOLD_WINDOWS;
+    } else if (ctl->hold_windows > 0) {
+        ctl->hold_windows--;
+    } else if (target < ctl->max_parts) {
+        target++;
+    }
+
+    ctl->last_step = target > ctl->target ? 1 : (target < ctl->target ? -1 : 0);
+    if (target != ctl->target) {
+        ctl->adjustments++;
+    }
+    ctl->target = target;
+    if (target < ctl->lowest) {
+        ctl->lowest = target;
+    }
+    if (target > ctl->highest) {
+        ctl->highest = target;
+    }
+    ctl->last_throughput = throughput;
+    start_window(ctl, sample);
+
+    return ctl->target;
+}
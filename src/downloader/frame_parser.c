@@ -94,6 +94,8 @@ int parse_next_frame(const uint8_t *buffer, size_t buffer_len, struct frame_info
                 info->type = FRAME_BURST_START_OF_PART;
                 // Extract uncompressed offset (bytes 9-16)
                 memcpy(&info->start_of_part_offset, buffer + 9, sizeof(uint64_t));
+            } else if (type_byte == BURST_TYPE_ZERO_FRAME && payload_size == 1) {
+                info->type = FRAME_BURST_ZERO;
             } else {
                 info->type = FRAME_BURST_PADDING;
             }
@@ -107,3 +109,71 @@ int parse_next_frame(const uint8_t *buffer, size_t buffer_len, struct frame_info
     info->type = FRAME_UNKNOWN;
     return STREAM_PROC_ERR_INVALID_FRAME;
 }
+
+// Walk the Zstandard frame header and block headers present in buffer
+static size_t zstd_frame_bytes_needed(const uint8_t *buffer, size_t buffer_len)
+{
+    // Magic plus the Frame_Header_Descriptor, which sizes the rest of the header
+    if (buffer_len < 5) {
+        return 5;
+    }
+    uint8_t fhd = buffer[4];
+    unsigned fcs_flag = fhd >> 6;
+    bool single_segment = (fhd >> 5) & 1;
+    bool has_checksum = (fhd >> 2) & 1;
+    static const size_t did_sizes[4] = {0, 1, 2, 4};
+    static const size_t fcs_sizes[4] = {0, 2, 4, 8};
+
+    size_t pos = 5 + (single_segment ? 0 : 1) + did_sizes[fhd & 3] +
+                 ((fcs_flag == 0 && single_segment) ? 1 : fcs_sizes[fcs_flag]);
+
+    for (;;) {
+        if (buffer_len < pos + 3) {
+            return pos + 3;
+        }
+        uint32_t block_header = buffer[pos] | (buffer[pos + 1] << 8) |
+                                ((uint32_t)buffer[pos + 2] << 16);
+        bool last_block = block_header & 1;
+        unsigned block_type = (block_header >> 1) & 3;
+        size_t block_size = block_header >> 3;
+        pos += 3 + (block_type == 1 ? 1 : block_size);  // RLE blocks hold one byte
+        if (last_block) {
+            return pos + (has_checksum ? 4 : 0);
+        }
+    }
+}
+
+size_t frame_bytes_needed(const uint8_t *buffer, size_t buffer_len)
+{
+    if (buffer_len < MIN_FRAME_HEADER_SIZE) {
+        return MIN_FRAME_HEADER_SIZE;
+    }
+
+    uint32_t magic;
+    memcpy(&magic, buffer, sizeof(magic));
+
+    if (magic == ZIP_LOCAL_FILE_HEADER_SIG) {
+        if (buffer_len < sizeof(struct zip_local_header)) {
+            return sizeof(struct zip_local_header);
+        }
+        const struct zip_local_header *lfh = (const struct zip_local_header *)buffer;
+        return sizeof(struct zip_local_header) +
+               lfh->filename_length + lfh->extra_field_length;
+    }
+
+    if (magic == ZSTD_MAGIC_NUMBER) {
+        return zstd_frame_bytes_needed(buffer, buffer_len);
+    }
+
+    if (magic == BURST_SKIPPABLE_MAGIC) {
+        if (buffer_len < 8) {
+            return 8;
+        }
+        uint32_t payload_size;
+        memcpy(&payload_size, buffer + 4, sizeof(payload_size));
+        return 8 + (size_t)payload_size;
+    }
+
+    // Data descriptors and anything else: the fixed-size prefix decides
+    return sizeof(struct zip_data_descriptor);
+}
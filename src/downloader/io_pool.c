@@ -0,0 +1,290 @@
+#include "io_pool.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// One queued chunk, or the end-of-stream marker
+struct io_item {
+    struct io_item *next;
+    bool finish;
+    size_t len;
+    uint8_t data[];
+};
+
+struct io_stream {
+    struct io_pool *pool;
+    io_chunk_fn process;
+    io_done_fn done;
+    void *ctx;
+
+    // FIFO of items not yet processed (guarded by pool->mutex)
+    struct io_item *head;
+    struct io_item *tail;
+
+    // On the ready list or being processed by a worker (guarded by pool->mutex).
+    // A stream is only ever processed by one worker at a time.
+    bool scheduled;
+    struct io_stream *next_ready;
+
+    int error;  // First error from process(); later chunks are dropped
+
+    struct io_item *finish_item;  // Allocated up front so io_stream_finish() cannot fail
+};
+
+struct io_pool {
+    pthread_mutex_t mutex;
+    pthread_cond_t work_cv;   // Signalled when a stream becomes ready or on shutdown
+    pthread_cond_t idle_cv;   // Signalled when a stream stops being scheduled
+
+    // Streams with queued items, in the order they became ready
+    struct io_stream *ready_head;
+    struct io_stream *ready_tail;
+    bool shutdown;
+
+    pthread_t *threads;
+    size_t num_threads;
+
+    // For io_pool_get_stats()
+    uint64_t busy_ns;
+    uint64_t queued_bytes;
+};
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Append stream to the ready list (called with mutex held)
+static void push_ready(struct io_pool *pool, struct io_stream *stream) {
+    stream->next_ready = NULL;
+    if (pool->ready_tail) {
+        pool->ready_tail->next_ready = stream;
+    } else {
+        pool->ready_head = stream;
+    }
+    pool->ready_tail = stream;
+}
+
+static void *io_worker(void *arg) {
+    struct io_pool *pool = arg;
+
+    pthread_mutex_lock(&pool->mutex);
+    for (;;) {
+        while (!pool->ready_head && !pool->shutdown) {
+            pthread_cond_wait(&pool->work_cv, &pool->mutex);
+        }
+        if (!pool->ready_head) {
+            break;  // Shutdown with no queued work
+        }
+
+        struct io_stream *stream = pool->ready_head;
+        pool->ready_head = stream->next_ready;
+        if (!pool->ready_head) {
+            pool->ready_tail = NULL;
+        }
+
+        struct io_item *item = stream->head;
+        stream->head = item->next;
+        if (!stream->head) {
+            stream->tail = NULL;
+        }
+        int error = stream->error;
+        pthread_mutex_unlock(&pool->mutex);
+
+        uint64_t start_ns = now_ns();
+        size_t len = item->len;
+        if (item->finish) {
+            stream->done(stream->ctx, error);
+        } else if (error == 0) {
+            error = stream->process(stream->ctx, item->data, item->len);
+        }
+        free(item);
+        uint64_t elapsed_ns = now_ns() - start_ns;
+
+        pthread_mutex_lock(&pool->mutex);
+        pool->busy_ns += elapsed_ns;
+        pool->queued_bytes -= len;
+        if (error != 0 && stream->error == 0) {
+            stream->error = error;
+        }
+        if (stream->head) {
+            // One item per turn, so a busy part does not starve the others
+            push_ready(pool, stream);
+            pthread_cond_signal(&pool->work_cv);
+        } else {
+            stream->scheduled = false;
+            pthread_cond_broadcast(&pool->idle_cv);
+        }
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    return NULL;
+}
+
+struct io_pool *io_pool_create(size_t num_threads) {
+    if (num_threads < 1) {
+        return NULL;
+    }
+
+    struct io_pool *pool = calloc(1, sizeof(struct io_pool));
+    if (!pool) {
+        return NULL;
+    }
+
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->work_cv, NULL);
+    pthread_cond_init(&pool->idle_cv, NULL);
+
+    pool->threads = calloc(num_threads, sizeof(pthread_t));
+    if (!pool->threads) {
+        io_pool_destroy(pool);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < num_threads; i++) {
+        if (pthread_create(&pool->threads[i], NULL, io_worker, pool) != 0) {
+            fprintf(stderr, "Error: Failed to start I/O worker thread\n");
+            io_pool_destroy(pool);
+            return NULL;
+        }
+        pool->num_threads++;
+    }
+
+    return pool;
+}
+
+void io_pool_destroy(struct io_pool *pool) {
+    if (!pool) {
+        return;
+    }
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->shutdown = true;
+    pthread_cond_broadcast(&pool->work_cv);
+    pthread_mutex_unlock(&pool->mutex);
+
+    for (size_t i = 0; i < pool->num_threads; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    free(pool->threads);
+
+    pthread_mutex_destroy(&pool->mutex);
+    pthread_cond_destroy(&pool->work_cv);
+    pthread_cond_destroy(&pool->idle_cv);
+
+    free(pool);
+}
+
+struct io_stream *io_stream_create(struct io_pool *pool, io_chunk_fn process,
+                                   io_done_fn done, void *ctx) {
+    if (!pool || !process || !done) {
+        return NULL;
+    }
+
+    struct io_stream *stream = calloc(1, sizeof(struct io_stream));
+    if (!stream) {
+        return NULL;
+    }
+
+    stream->finish_item = calloc(1, sizeof(struct io_item));
+    if (!stream->finish_item) {
+        free(stream);
+        return NULL;
+    }
+    stream->finish_item->finish = true;
+
+    stream->pool = pool;
+    stream->process = process;
+    stream->done = done;
+    stream->ctx = ctx;
+    return stream;
+}
+
+// Queue item on stream and wake a worker if the stream was idle
+static int enqueue(struct io_stream *stream, struct io_item *item) {
+    struct io_pool *pool = stream->pool;
+
+    pthread_mutex_lock(&pool->mutex);
+    if (!item->finish && stream->error != 0) {
+        pthread_mutex_unlock(&pool->mutex);
+        free(item);
+        return -1;
+    }
+
+    item->next = NULL;
+    if (stream->tail) {
+        stream->tail->next = item;
+    } else {
+        stream->head = item;
+    }
+    stream->tail = item;
+    pool->queued_bytes += item->len;
+
+    if (!stream->scheduled) {
+        stream->scheduled = true;
+        push_ready(pool, stream);
+        pthread_cond_signal(&pool->work_cv);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    return 0;
+}
+
+int io_stream_submit(struct io_stream *stream, const uint8_t *data, size_t len) {
+    struct io_item *item = malloc(sizeof(struct io_item) + len);
+    if (!item) {
+        return -1;
+    }
+    item->finish = false;
+    item->len = len;
+    memcpy(item->data, data, len);
+
+    return enqueue(stream, item);
+}
+
+void io_stream_finish(struct io_stream *stream) {
+    struct io_item *item = stream->finish_item;
+    stream->finish_item = NULL;
+    enqueue(stream, item);
+}
+
+int io_stream_reopen(struct io_stream *stream) {
+    struct io_item *item = calloc(1, sizeof(struct io_item));
+    if (!item) {
+        return -1;
+    }
+    item->finish = true;
+
+    // The previous finish item was freed after done(); nothing else uses the slot
+    stream->finish_item = item;
+    return 0;
+}
+
+void io_stream_destroy(struct io_stream *stream) {
+    if (!stream) {
+        return;
+    }
+
+    // A stream with queued items stays scheduled, so once it is idle every
+    // item has been processed and freed
+    struct io_pool *pool = stream->pool;
+    pthread_mutex_lock(&pool->mutex);
+    while (stream->scheduled) {
+        pthread_cond_wait(&pool->idle_cv, &pool->mutex);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    free(stream->finish_item);  // Still here if the stream was never finished
+    free(stream);
+}
+
+void io_pool_get_stats(struct io_pool *pool, struct io_pool_stats *stats) {
+    pthread_mutex_lock(&pool->mutex);
+    stats->busy_ns = pool->busy_ns;
+    stats->queued_bytes = pool->queued_bytes;
+    stats->num_threads = pool->num_threads;
+    pthread_mutex_unlock(&pool->mutex);
+}
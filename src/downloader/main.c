@@ -3,7 +3,11 @@
 #include "central_dir_parser.h"
 #include "stream_processor.h"
 #include "cd_fetch.h"
+#include "io_pool.h"
 #include "profiling.h"
+#include "restore_journal.h"
+#include "part_prefetch.h"
+#include "concurrency_controller.h"
 
 #include <aws/common/allocator.h>
 
@@ -14,19 +18,32 @@
 
 static void print_usage(const char *program_name) {
     printf("Usage: %s [OPTIONS]\n", program_name);
-    printf("\nDownload and extract a BURST archive from S3.\n");
+    printf("\nDownload and extract a BURST archive from S3, an HTTP(S) server or a local file.\n");
     printf("\nRequired Options:\n");
     printf("  -b, --bucket BUCKET       S3 bucket name\n");
     printf("  -k, --key KEY             S3 object key\n");
     printf("  -r, --region REGION       AWS region (e.g., us-east-1)\n");
+    printf("  -u, --url URL             Archive at an http:// or https:// URL, a file:// URL\n");
+    printf("                            or a local path, instead of --bucket/--key/--region\n");
     printf("  -o, --output-dir DIR      Output directory for extracted files\n");
     printf("\nOptional:\n");
     printf("  -c, --connections NUM     Max concurrent connections (0=auto, max: 256)\n");
     printf("  -n, --max-concurrent-parts NUM\n");
-    printf("                            Max concurrent part downloads (1-128, default: 8)\n");
+    printf("                            Max concurrent part downloads (1-128, default: 8),\n");
+    printf("                            or 'auto' to adapt to network and disk (1-%d)\n",
+           BURST_ADAPTIVE_MAX_PARTS);
+    printf("  -i, --io-threads NUM      Threads writing downloaded data to disk\n");
+    printf("                            (1-256, default: one per concurrent part)\n");
     printf("  -s, --part-size NUM       Part size in MiB (8-64, must be multiple of 8,\n");
     printf("                            default: 8)\n");
+    printf("  -m, --memory-limit MB     Max downloaded data not yet written to disk\n");
+    printf("                            (default: one part per concurrent part)\n");
     printf("  -p, --profile PROFILE     AWS profile name (default: AWS_PROFILE env or 'default')\n");
+    printf("  -f, --prefetch NUM        Parts to start downloading while the central\n");
+    printf("                            directory is fetched (0-128, default and\n");
+    printf("                            maximum: max concurrent parts)\n");
+    printf("  -R, --resume              Record finished parts in DIR/%s and skip\n", RESTORE_JOURNAL_NAME);
+    printf("                            the ones an interrupted run already restored\n");
     printf("  -h, --help                Show this help message\n");
     printf("\nAWS Credentials:\n");
     printf("  Uses standard AWS credential chain:\n");
@@ -41,17 +58,30 @@ struct burst_downloader *burst_downloader_create(
     const char *bucket,
     const char *key,
     const char *region,
+    const char *source_url,
     const char *output_dir,
     size_t max_connections,
     size_t max_concurrent_parts,
+    bool adaptive_concurrency,
+    size_t io_threads,
     uint64_t part_size,
+    uint64_t read_window,
+    size_t prefetch_parts,
+    bool resume,
     const char *profile_name
 ) {
-    if (!bucket || !key || !region || !output_dir) {
+    if ((!source_url && (!bucket || !key || !region)) || !output_dir) {
         fprintf(stderr, "Error: All parameters required\n");
         return NULL;
     }
 
+    enum archive_source_kind source_kind = ARCHIVE_SOURCE_S3;
+    const char *file_path = NULL;
+    if (source_url && archive_source_parse_location(source_url, &source_kind, &file_path) != 0) {
+        fprintf(stderr, "Error: Unsupported archive URL: %s\n", source_url);
+        return NULL;
+    }
+
     struct burst_downloader *downloader = calloc(1, sizeof(struct burst_downloader));
     if (!downloader) {
         fprintf(stderr, "Error: Failed to allocate downloader\n");
@@ -59,23 +89,52 @@ struct burst_downloader *burst_downloader_create(
     }
 
     // Copy configuration strings
-    downloader->bucket = strdup(bucket);
-    downloader->key = strdup(key);
-    downloader->region = strdup(region);
+    downloader->bucket = bucket ? strdup(bucket) : NULL;
+    downloader->key = key ? strdup(key) : NULL;
+    downloader->region = region ? strdup(region) : NULL;
+    downloader->source_url = source_url ? strdup(source_url) : NULL;
+    downloader->source_kind = source_kind;
     downloader->output_dir = strdup(output_dir);
     downloader->profile_name = profile_name ? strdup(profile_name) : NULL;
     downloader->max_concurrent_connections = max_connections;
     downloader->max_concurrent_parts = max_concurrent_parts;
+    downloader->adaptive_concurrency = adaptive_concurrency;
+    downloader->io_threads = io_threads > 0 ? io_threads : max_concurrent_parts;
     downloader->part_size = part_size;
+    downloader->read_window = read_window;
+    // Prefetched parts count against the same memory budget as concurrent parts
+    downloader->prefetch_parts =
+        prefetch_parts < max_concurrent_parts ? prefetch_parts : max_concurrent_parts;
+    downloader->resume = resume;
     downloader->object_size = 0;
     downloader->tls_ctx = NULL;
 
-    if (!downloader->bucket || !downloader->key || !downloader->region || !downloader->output_dir) {
+    if ((bucket && !downloader->bucket) || (key && !downloader->key) ||
+        (region && !downloader->region) || (source_url && !downloader->source_url) ||
+        !downloader->output_dir) {
         fprintf(stderr, "Error: Failed to duplicate strings\n");
         burst_downloader_destroy(downloader);
         return NULL;
     }
 
+    if (adaptive_concurrency) {
+        downloader->concurrency = malloc(sizeof(struct concurrency_controller));
+        if (!downloader->concurrency) {
+            fprintf(stderr, "Error: Failed to allocate concurrency controller\n");
+            burst_downloader_destroy(downloader);
+            return NULL;
+        }
+        concurrency_controller_init(downloader->concurrency, 1, max_concurrent_parts,
+                                    BURST_ADAPTIVE_INITIAL_PARTS);
+    }
+
+    downloader->io_pool = io_pool_create(downloader->io_threads);
+    if (!downloader->io_pool) {
+        fprintf(stderr, "Error: Failed to start I/O threads\n");
+        burst_downloader_destroy(downloader);
+        return NULL;
+    }
+
     // Initialize S3 client
     if (s3_client_init(downloader) != 0) {
         fprintf(stderr, "Error: Failed to initialize S3 client\n");
@@ -83,6 +142,23 @@ struct burst_downloader *burst_downloader_create(
         return NULL;
     }
 
+    switch (source_kind) {
+        case ARCHIVE_SOURCE_S3:
+            downloader->source = archive_source_new_s3(downloader);
+            break;
+        case ARCHIVE_SOURCE_FILE:
+            downloader->source = archive_source_new_file(file_path, read_window);
+            break;
+        case ARCHIVE_SOURCE_HTTP:
+            downloader->source = archive_source_new_http(downloader, source_url);
+            break;
+    }
+    if (!downloader->source) {
+        fprintf(stderr, "Error: Failed to open archive source\n");
+        burst_downloader_destroy(downloader);
+        return NULL;
+    }
+
     return downloader;
 }
 
@@ -91,15 +167,24 @@ void burst_downloader_destroy(struct burst_downloader *downloader) {
         return;
     }
 
+    // Every request has been released by now; the source goes before its client
+    if (downloader->source) {
+        archive_source_destroy(downloader->source);
+    }
+
     // Clean up S3 client first
     s3_client_cleanup(downloader);
 
+    io_pool_destroy(downloader->io_pool);
+
     // Free allocated strings
     free(downloader->bucket);
     free(downloader->key);
     free(downloader->region);
+    free(downloader->source_url);
     free(downloader->output_dir);
     free(downloader->profile_name);
+    free(downloader->concurrency);
 
     free(downloader);
 }
@@ -174,6 +259,14 @@ int burst_downloader_extract(struct burst_downloader *downloader) {
     uint8_t *cd_buffer = NULL;
     size_t cd_buffer_size = 0;
 
+    // Request the first parts while the tail is in flight; the central
+    // directory decides which of them are kept
+    if (downloader->prefetch_parts > 0) {
+        printf("Prefetching %zu part(s) alongside the tail...\n", downloader->prefetch_parts);
+        downloader->prefetch = part_prefetch_start(downloader->source, downloader->part_size,
+                                                   (uint32_t)downloader->prefetch_parts);
+    }
+
     // 1. Fetch initial tail buffer (last 8 MiB)
     printf("Fetching tail buffer...\n");
     if (burst_downloader_fetch_cd_part(downloader, &initial_buffer, &initial_size,
@@ -184,6 +277,29 @@ int burst_downloader_extract(struct burst_downloader *downloader) {
     printf("Object size: %llu bytes (fetched %zu bytes starting at offset %llu)\n",
            (unsigned long long)object_size, initial_size, (unsigned long long)initial_start);
 
+    // Pick up the parts an interrupted run already restored
+    if (downloader->resume) {
+        if (downloader->etag[0] == '\0') {
+            fprintf(stderr, "Warning: archive has no ETag; cannot resume, restoring everything\n");
+        } else {
+            size_t total_parts =
+                (size_t)((object_size + downloader->part_size - 1) / downloader->part_size);
+            downloader->journal = restore_journal_open(downloader->output_dir, downloader->etag,
+                                                       object_size, total_parts);
+            if (downloader->journal) {
+                printf("Resuming: %zu of %zu parts already restored\n",
+                       restore_journal_resumed_parts(downloader->journal), total_parts);
+                for (size_t p = 0; p < downloader->prefetch_parts; p++) {
+                    if (restore_journal_has_part(downloader->journal, (uint32_t)p)) {
+                        part_prefetch_discard(downloader->prefetch, (uint32_t)p);
+                    }
+                }
+            } else {
+                fprintf(stderr, "Warning: cannot keep a resume journal; restoring everything\n");
+            }
+        }
+    }
+
     // 2. Parse EOCD only to determine CD extent
     uint64_t central_dir_offset = 0;
     uint64_t central_dir_size = 0;
@@ -208,6 +324,14 @@ int burst_downloader_extract(struct burst_downloader *downloader) {
            (unsigned long long)central_dir_size,
            is_zip64 ? "ZIP64" : "standard");
 
+    // Parts from here on come from the tail buffer or hold only central
+    // directory, which is fetched in whole parts from the one it starts in
+    uint64_t fetched_from = central_dir_offset - central_dir_offset % downloader->part_size;
+    if (initial_start < fetched_from) {
+        fetched_from = initial_start;
+    }
+    part_prefetch_discard_from(downloader->prefetch, fetched_from);
+
     // 3. Check if we need additional fetches for large CD
     if (central_dir_offset < initial_start) {
         // CD extends before our initial buffer - need to fetch more
@@ -343,6 +467,12 @@ int burst_downloader_extract(struct burst_downloader *downloader) {
     if (cd_result.num_parts <= 1) {
         result = process_single_part_archive(downloader, &cd_result,
                                               initial_buffer, initial_size);
+        if (result == 0) {
+            result = stream_processor_clone_duplicates(&cd_result, downloader->output_dir);
+        }
+        if (result == 0) {
+            result = burst_downloader_apply_metadata(downloader, &cd_result);
+        }
         if (result == 0) {
             printf("\nExtraction complete! %zu files extracted.\n", cd_result.num_files);
         }
@@ -367,6 +497,12 @@ int burst_downloader_extract(struct burst_downloader *downloader) {
     printf("Extracting with up to %zu concurrent parts...\n", downloader->max_concurrent_parts);
     result = burst_downloader_extract_concurrent(
         downloader, &cd_result, body_segments, num_body_segments);
+    if (result == 0) {
+        result = stream_processor_clone_duplicates(&cd_result, downloader->output_dir);
+    }
+    if (result == 0) {
+        result = burst_downloader_apply_metadata(downloader, &cd_result);
+    }
 
     if (result == 0) {
         printf("\nExtraction complete! %zu files extracted.\n", cd_result.num_files);
@@ -386,6 +522,19 @@ int burst_downloader_extract(struct burst_downloader *downloader) {
 #endif
 
 cleanup:
+    // Waits for the prefetched requests nobody adopted to stop
+    part_prefetch_destroy(downloader->prefetch);
+    downloader->prefetch = NULL;
+
+    // A finished restore leaves no journal behind
+    if (downloader->journal) {
+        if (result == 0) {
+            restore_journal_remove(downloader->journal);
+        }
+        restore_journal_close(downloader->journal);
+        downloader->journal = NULL;
+    }
+
     central_dir_parse_result_free(&cd_result);
 
     // Free body segments array (but not data pointers - they point into other buffers)
@@ -428,28 +577,39 @@ int main(int argc, char **argv) {
     const char *bucket = NULL;
     const char *key = NULL;
     const char *region = NULL;
+    const char *url = NULL;
     const char *output_dir = NULL;
     const char *profile = NULL;
     size_t max_connections = 0;
     size_t max_concurrent_parts = 8;
+    bool adaptive_concurrency = false;
+    size_t io_threads = 0;
     uint64_t part_size = 8 * 1024 * 1024;  // Default 8 MiB
+    uint64_t memory_limit = 0;  // 0 = one part_size per concurrent part
+    int prefetch_parts = -1;  // -1 = max_concurrent_parts
+    bool resume = false;
 
     // Parse command-line options
     static struct option long_options[] = {
         {"bucket", required_argument, 0, 'b'},
         {"key", required_argument, 0, 'k'},
         {"region", required_argument, 0, 'r'},
+        {"url", required_argument, 0, 'u'},
         {"output-dir", required_argument, 0, 'o'},
         {"connections", required_argument, 0, 'c'},
         {"max-concurrent-parts", required_argument, 0, 'n'},
+        {"io-threads", required_argument, 0, 'i'},
         {"part-size", required_argument, 0, 's'},
+        {"memory-limit", required_argument, 0, 'm'},
         {"profile", required_argument, 0, 'p'},
+        {"prefetch", required_argument, 0, 'f'},
+        {"resume", no_argument, 0, 'R'},
         {"help", no_argument, 0, 'h'},
         {0, 0, 0, 0}
     };
 
     int opt;
-    while ((opt = getopt_long(argc, argv, "b:k:r:o:c:n:s:p:h", long_options, NULL)) != -1) {
+    while ((opt = getopt_long(argc, argv, "b:k:r:u:o:c:n:i:s:m:p:f:Rh", long_options, NULL)) != -1) {
         switch (opt) {
             case 'b':
                 bucket = optarg;
@@ -460,6 +620,9 @@ int main(int argc, char **argv) {
             case 'r':
                 region = optarg;
                 break;
+            case 'u':
+                url = optarg;
+                break;
             case 'o':
                 output_dir = optarg;
                 break;
@@ -471,12 +634,25 @@ int main(int argc, char **argv) {
                 }
                 break;
             case 'n':
+                if (strcmp(optarg, "auto") == 0) {
+                    adaptive_concurrency = true;
+                    max_concurrent_parts = BURST_ADAPTIVE_MAX_PARTS;
+                    break;
+                }
+                adaptive_concurrency = false;
                 max_concurrent_parts = atoi(optarg);
                 if (max_concurrent_parts < 1 || max_concurrent_parts > 128) {
                     fprintf(stderr, "Error: Max concurrent parts must be between 1 and 128\n");
                     return 1;
                 }
                 break;
+            case 'i':
+                io_threads = atoi(optarg);
+                if (io_threads < 1 || io_threads > 256) {
+                    fprintf(stderr, "Error: I/O threads must be between 1 and 256\n");
+                    return 1;
+                }
+                break;
             case 's': {
                 int part_size_mib = atoi(optarg);
                 if (part_size_mib < 8 || part_size_mib > 64 || (part_size_mib % 8) != 0) {
@@ -486,9 +662,28 @@ int main(int argc, char **argv) {
                 part_size = (uint64_t)part_size_mib * 1024 * 1024;
                 break;
             }
+            case 'm': {
+                int memory_limit_mb = atoi(optarg);
+                if (memory_limit_mb < 1) {
+                    fprintf(stderr, "Error: Memory limit must be at least 1 MB\n");
+                    return 1;
+                }
+                memory_limit = (uint64_t)memory_limit_mb * 1024 * 1024;
+                break;
+            }
             case 'p':
                 profile = optarg;
                 break;
+            case 'f':
+                prefetch_parts = atoi(optarg);
+                if (prefetch_parts < 0 || prefetch_parts > 128) {
+                    fprintf(stderr, "Error: Prefetch parts must be between 0 and 128\n");
+                    return 1;
+                }
+                break;
+            case 'R':
+                resume = true;
+                break;
             case 'h':
                 print_usage(argv[0]);
                 return 0;
@@ -499,21 +694,59 @@ int main(int argc, char **argv) {
     }
 
     // Validate required arguments
-    if (!bucket || !key || !region || !output_dir) {
+    if ((!url && (!bucket || !key || !region)) || !output_dir) {
         fprintf(stderr, "Error: All required arguments must be provided\n\n");
         print_usage(argv[0]);
         return 1;
     }
+    if (url && (bucket || key)) {
+        fprintf(stderr, "Error: --url cannot be combined with --bucket or --key\n\n");
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    // Adaptive concurrency starts below its ceiling; so does the prefetch
+    size_t initial_parts = adaptive_concurrency ? BURST_ADAPTIVE_INITIAL_PARTS : max_concurrent_parts;
+    if (prefetch_parts < 0) {
+        prefetch_parts = (int)initial_parts;
+    }
+    if ((size_t)prefetch_parts > max_concurrent_parts) {
+        prefetch_parts = (int)max_concurrent_parts;
+    }
+
+    uint64_t read_window = calculate_read_window(memory_limit, max_concurrent_parts, part_size);
+    if (read_window == 0) {
+        fprintf(stderr, "Error: Memory limit must allow at least 1 MB per concurrent part (%zu MB)\n",
+                max_concurrent_parts);
+        return 1;
+    }
 
     printf("BURST Downloader\n");
     printf("================\n");
-    printf("Bucket:      %s\n", bucket);
-    printf("Key:         %s\n", key);
-    printf("Region:      %s\n", region);
+    if (url) {
+        printf("URL:         %s\n", url);
+    } else {
+        printf("Bucket:      %s\n", bucket);
+        printf("Key:         %s\n", key);
+        printf("Region:      %s\n", region);
+    }
     printf("Output Dir:  %s\n", output_dir);
     printf("Connections: %zu\n", max_connections);
-    printf("Concurrent Parts: %zu\n", max_concurrent_parts);
+    if (adaptive_concurrency) {
+        printf("Concurrent Parts: auto (%zu, adapting between 1 and %zu)\n",
+               initial_parts, max_concurrent_parts);
+    } else {
+        printf("Concurrent Parts: %zu\n", max_concurrent_parts);
+    }
+    printf("I/O Threads: %zu\n", io_threads > 0 ? io_threads : max_concurrent_parts);
     printf("Part Size:   %llu MiB\n", (unsigned long long)(part_size / (1024 * 1024)));
+    printf("Memory Limit: %llu MiB (%llu MiB per part)\n",
+           (unsigned long long)(read_window * max_concurrent_parts / (1024 * 1024)),
+           (unsigned long long)(read_window / (1024 * 1024)));
+    printf("Prefetch Parts: %d\n", prefetch_parts);
+    if (resume) {
+        printf("Resume:      yes\n");
+    }
     printf("\n");
 
     // Profile resolution: CLI arg > AWS_PROFILE env > NULL (defaults to "default")
@@ -522,10 +755,10 @@ int main(int argc, char **argv) {
     }
 
     // Create downloader
-    printf("Initializing AWS S3 client...\n");
+    printf("Initializing archive source...\n");
     struct burst_downloader *downloader = burst_downloader_create(
-        bucket, key, region, output_dir, max_connections, max_concurrent_parts,
-        part_size, profile
+        bucket, key, region, url, output_dir, max_connections, max_concurrent_parts,
+        adaptive_concurrency, io_threads, part_size, read_window, (size_t)prefetch_parts, resume, profile
     );
 
     if (!downloader) {
@@ -533,11 +766,22 @@ int main(int argc, char **argv) {
         return 1;
     }
 
-    printf("S3 client initialized.\n\n");
+    printf("Archive source ready.\n\n");
 
     // Run extraction
     int result = burst_downloader_extract(downloader);
 
+    if (downloader->concurrency) {
+        const struct concurrency_controller *ctl = downloader->concurrency;
+        printf("Adaptive concurrency: %zu parts in flight at the end (range %zu-%zu, %zu adjustments",
+               ctl->target, ctl->lowest, ctl->highest, ctl->adjustments);
+        if (ctl->best_throughput > 0) {
+            printf("; best %.1f MB/s at %zu parts",
+                   ctl->best_throughput / (1024.0 * 1024.0), ctl->best_target);
+        }
+        printf(")\n");
+    }
+
     // Clean up
     burst_downloader_destroy(downloader);
 
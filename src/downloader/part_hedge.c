@@ -0,0 +1,493 @@
+#include "part_hedge.h"
+#include "part_prefetch.h"
+#include "profiling.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+enum { LEG_ORIGINAL, LEG_DUPLICATE };
+
+// One of the requests behind a hedged request
+struct hedge_leg {
+    struct hedged_request *hedge;
+    struct source_request *request;  // NULL until the source has returned it
+    uint64_t next;                   // Archive offset of the next byte it receives
+    size_t pending_window;           // Window opened before request was known
+    bool running;                    // Started, and its finish callback has not run
+    int error_code;
+    int response_status;
+};
+
+struct hedged_request {
+    struct source_request base;
+    struct archive_source *source;
+    struct source_request_options sink;  // The caller's
+    char if_match[128];
+
+    // Held while the caller's callbacks run, so they never overlap and the
+    // legs' bytes reach them in order. Taken before mutex.
+    pthread_mutex_t deliver_mutex;
+    pthread_mutex_t mutex;
+
+    struct hedge_leg legs[2];
+    int leader;            // Leg whose bytes are passed on
+    bool hedged;
+    bool cancelled;
+    bool done;             // The leader finished; the other leg is cancelled
+    bool headers_sent;
+    int headers_status;
+    uint64_t delivered;    // Archive offset of the next byte passed on
+    uint64_t outstanding;  // Bytes passed on from the leader whose window is not reopened
+    uint64_t owed;         // The same for a leg that lost the lead; not reopened on it
+    int refs;              // Caller, running legs and hedged_request_hedge() calls
+};
+
+static const struct archive_source_ops hedged_request_ops;
+
+static bool status_ok(int status)
+{
+    return status >= 200 && status < 300;
+}
+
+static void hedged_request_unref(struct hedged_request *hedge)
+{
+    pthread_mutex_lock(&hedge->mutex);
+    int refs = --hedge->refs;
+    pthread_mutex_unlock(&hedge->mutex);
+
+    if (refs == 0) {
+        for (int i = 0; i < 2; i++) {
+            source_request_release(hedge->legs[i].request);
+        }
+        pthread_mutex_destroy(&hedge->deliver_mutex);
+        pthread_mutex_destroy(&hedge->mutex);
+        free(hedge);
+    }
+}
+
+// Pass the lead to the duplicate (mutex held). Returns the original's
+// request if it still has to be cancelled.
+static struct source_request *take_over(struct hedged_request *hedge)
+{
+    hedge->leader = LEG_DUPLICATE;
+    hedge->owed += hedge->outstanding;
+    hedge->outstanding = 0;
+    PROFILE_COUNT(g_profile_stats.hedge_takeovers);
+
+    struct hedge_leg *original = &hedge->legs[LEG_ORIGINAL];
+    return original->running ? original->request : NULL;
+}
+
+// Record window to open on leg once its request is known (mutex held)
+static struct source_request *leg_window(struct hedge_leg *leg, size_t len)
+{
+    if (!leg->request) {
+        leg->pending_window += len;
+        return NULL;
+    }
+    return leg->request;
+}
+
+static int hedge_headers_callback(const struct source_response *response, void *user_data)
+{
+    struct hedge_leg *leg = user_data;
+    struct hedged_request *hedge = leg->hedge;
+    int index = (int)(leg - hedge->legs);
+
+    pthread_mutex_lock(&hedge->deliver_mutex);
+    pthread_mutex_lock(&hedge->mutex);
+    leg->response_status = response->status;
+
+    // Only one response is passed on; a duplicate racing it must agree with it
+    if (hedge->headers_sent) {
+        int rc = index == LEG_DUPLICATE && status_ok(response->status) ? 0 : -1;
+        pthread_mutex_unlock(&hedge->mutex);
+        pthread_mutex_unlock(&hedge->deliver_mutex);
+        return rc;
+    }
+
+    // A duplicate answering before the original takes over
+    struct source_request *cancel = NULL;
+    if (index != hedge->leader) {
+        if (!status_ok(response->status) || hedge->done || hedge->cancelled) {
+            pthread_mutex_unlock(&hedge->mutex);
+            pthread_mutex_unlock(&hedge->deliver_mutex);
+            return -1;
+        }
+        cancel = take_over(hedge);
+    }
+
+    hedge->headers_sent = true;
+    hedge->headers_status = response->status;
+    pthread_mutex_unlock(&hedge->mutex);
+
+    if (cancel) {
+        source_request_cancel(cancel);
+    }
+    int rc = hedge->sink.headers ? hedge->sink.headers(response, hedge->sink.user_data) : 0;
+    pthread_mutex_unlock(&hedge->deliver_mutex);
+    return rc;
+}
+
+static int hedge_body_callback(struct source_request *request, const uint8_t *data, size_t len,
+                               void *user_data)
+{
+    (void)request;
+    struct hedge_leg *leg = user_data;
+    struct hedged_request *hedge = leg->hedge;
+    int index = (int)(leg - hedge->legs);
+
+    pthread_mutex_lock(&hedge->deliver_mutex);
+    pthread_mutex_lock(&hedge->mutex);
+    uint64_t offset = leg->next;
+    leg->next += len;
+
+    // A duplicate starts at or before the first byte not yet passed on
+    size_t skip = 0;
+    if (offset < hedge->delivered) {
+        skip = hedge->delivered - offset < len ? (size_t)(hedge->delivered - offset) : len;
+    }
+
+    struct source_request *cancel = NULL;
+    if (index != hedge->leader) {
+        // Lost the lead, or racing without a response to carry on
+        if (index == LEG_ORIGINAL || (skip < len && (hedge->done || hedge->cancelled ||
+                                                     !hedge->headers_sent ||
+                                                     !status_ok(hedge->headers_status)))) {
+            pthread_mutex_unlock(&hedge->mutex);
+            pthread_mutex_unlock(&hedge->deliver_mutex);
+            return -1;
+        }
+        if (skip < len) {
+            cancel = take_over(hedge);
+        }
+    }
+
+    // Bytes the caller already has are dropped, so they do not use up the window
+    struct source_request *reopen = skip > 0 ? leg_window(leg, skip) : NULL;
+    if (skip == len) {
+        pthread_mutex_unlock(&hedge->mutex);
+        pthread_mutex_unlock(&hedge->deliver_mutex);
+        source_request_open_window(reopen, skip);
+        return 0;
+    }
+
+    hedge->delivered = offset + len;
+    hedge->outstanding += len - skip;
+    pthread_mutex_unlock(&hedge->mutex);
+
+    if (cancel) {
+        source_request_cancel(cancel);
+    }
+    if (reopen) {
+        source_request_open_window(reopen, skip);
+    }
+    int rc = hedge->sink.body ? hedge->sink.body(&hedge->base, data + skip, len - skip,
+                                                 hedge->sink.user_data)
+                              : 0;
+    if (rc != 0) {
+        // The caller gave up on the response; the other leg must not carry on with it
+        pthread_mutex_lock(&hedge->mutex);
+        hedge->cancelled = true;
+        pthread_mutex_unlock(&hedge->mutex);
+    }
+    pthread_mutex_unlock(&hedge->deliver_mutex);
+    return rc;
+}
+
+static void hedge_finish_callback(int error_code, int response_status, void *user_data)
+{
+    struct hedge_leg *leg = user_data;
+    struct hedged_request *hedge = leg->hedge;
+    int index = (int)(leg - hedge->legs);
+
+    pthread_mutex_lock(&hedge->deliver_mutex);
+    pthread_mutex_lock(&hedge->mutex);
+    leg->running = false;
+    leg->error_code = error_code;
+    if (response_status != 0) {
+        leg->response_status = response_status;
+    }
+
+    struct source_request *cancel = NULL;
+    if (index == hedge->leader && !hedge->done) {
+        struct hedge_leg *duplicate = &hedge->legs[LEG_DUPLICATE];
+        if (error_code != 0 && index == LEG_ORIGINAL && duplicate->running && !hedge->cancelled &&
+            hedge->headers_sent && status_ok(hedge->headers_status)) {
+            // The original failed first: carry on from the duplicate
+            take_over(hedge);
+        } else {
+            hedge->done = true;
+            struct hedge_leg *other = &hedge->legs[1 - index];
+            cancel = other->running ? other->request : NULL;
+        }
+    }
+
+    // The last leg to finish passes on the leader's outcome
+    bool finish = hedge->done && !hedge->legs[LEG_ORIGINAL].running &&
+                  !hedge->legs[LEG_DUPLICATE].running;
+    struct hedge_leg *leader = &hedge->legs[hedge->leader];
+    pthread_mutex_unlock(&hedge->mutex);
+
+    if (cancel) {
+        source_request_cancel(cancel);
+    }
+    if (finish) {
+        hedge->sink.finish(leader->error_code, leader->response_status, hedge->sink.user_data);
+    }
+    pthread_mutex_unlock(&hedge->deliver_mutex);
+    hedged_request_unref(hedge);
+}
+
+static struct source_request_options leg_options(struct hedged_request *hedge, int index,
+                                                 uint64_t start)
+{
+    struct source_request_options options = {
+        .start = start,
+        .end = hedge->sink.end,
+        .if_match = hedge->if_match,
+        .headers = hedge_headers_callback,
+        .body = hedge_body_callback,
+        .finish = hedge_finish_callback,
+        .user_data = &hedge->legs[index],
+    };
+    return options;
+}
+
+// Publish a leg's request and open any window the caller opened meanwhile
+static void set_leg_request(struct hedged_request *hedge, struct hedge_leg *leg,
+                            struct source_request *request)
+{
+    pthread_mutex_lock(&hedge->mutex);
+    leg->request = request;
+    size_t window = leg->pending_window;
+    leg->pending_window = 0;
+    bool cancel = hedge->cancelled || (hedge->done && leg->running);
+    pthread_mutex_unlock(&hedge->mutex);
+
+    if (window > 0) {
+        source_request_open_window(request, window);
+    }
+    if (cancel) {
+        source_request_cancel(request);
+    }
+}
+
+struct source_request *hedged_request_start(struct archive_source *source,
+                                            struct part_prefetch *prefetch,
+                                            const struct source_request_options *options)
+{
+    if (!source || !options || !options->finish || options->suffix_length > 0) {
+        return NULL;
+    }
+
+    struct hedged_request *hedge = calloc(1, sizeof(struct hedged_request));
+    if (!hedge) {
+        return NULL;
+    }
+    hedge->base.ops = &hedged_request_ops;
+    hedge->source = source;
+    hedge->sink = *options;
+    snprintf(hedge->if_match, sizeof(hedge->if_match), "%s",
+             options->if_match ? options->if_match : "");
+    hedge->sink.if_match = hedge->if_match;
+    pthread_mutex_init(&hedge->deliver_mutex, NULL);
+    pthread_mutex_init(&hedge->mutex, NULL);
+    hedge->leader = LEG_ORIGINAL;
+    hedge->delivered = options->start;
+    for (int i = 0; i < 2; i++) {
+        hedge->legs[i].hedge = hedge;
+    }
+
+    struct hedge_leg *original = &hedge->legs[LEG_ORIGINAL];
+    original->next = options->start;
+    original->running = true;
+    hedge->refs = 2;
+
+    // An adopted prefetch replays its response before returning
+    struct source_request_options leg = leg_options(hedge, LEG_ORIGINAL, options->start);
+    struct source_request *request = part_prefetch_adopt(prefetch, &leg);
+    if (!request) {
+        request = archive_source_request(source, &leg);
+    }
+    if (!request) {
+        pthread_mutex_destroy(&hedge->deliver_mutex);
+        pthread_mutex_destroy(&hedge->mutex);
+        free(hedge);
+        return NULL;
+    }
+    set_leg_request(hedge, original, request);
+
+    return &hedge->base;
+}
+
+int hedged_request_hedge(struct source_request *base)
+{
+    if (!base || base->ops != &hedged_request_ops) {
+        return -1;
+    }
+    struct hedged_request *hedge = (struct hedged_request *)base;
+    struct hedge_leg *duplicate = &hedge->legs[LEG_DUPLICATE];
+
+    pthread_mutex_lock(&hedge->mutex);
+    if (hedge->hedged || hedge->done || hedge->cancelled || hedge->delivered > hedge->sink.end ||
+        (hedge->headers_sent && !status_ok(hedge->headers_status))) {
+        pthread_mutex_unlock(&hedge->mutex);
+        return -1;
+    }
+    hedge->hedged = true;
+    duplicate->next = hedge->delivered;
+    duplicate->running = true;
+    hedge->refs += 2;  // The leg's, and ours until its request is published
+    struct source_request_options options = leg_options(hedge, LEG_DUPLICATE, hedge->delivered);
+    pthread_mutex_unlock(&hedge->mutex);
+
+    PROFILE_COUNT(g_profile_stats.hedge_requests);
+    struct source_request *request = archive_source_request(hedge->source, &options);
+    if (!request) {
+        // Finishes the leg, which the original may already be waiting for
+        hedge_finish_callback(ECANCELED, 0, duplicate);
+        hedged_request_unref(hedge);
+        return -1;
+    }
+    set_leg_request(hedge, duplicate, request);
+    hedged_request_unref(hedge);
+
+    return 0;
+}
+
+uint64_t hedged_request_progress(struct source_request *base)
+{
+    if (!base || base->ops != &hedged_request_ops) {
+        return 0;
+    }
+    struct hedged_request *hedge = (struct hedged_request *)base;
+
+    pthread_mutex_lock(&hedge->mutex);
+    uint64_t progress = hedge->delivered - hedge->sink.start;
+    pthread_mutex_unlock(&hedge->mutex);
+    return progress;
+}
+
+static void hedged_request_open_window(struct source_request *base, size_t len)
+{
+    struct hedged_request *hedge = (struct hedged_request *)base;
+
+    // The caller reopens its window in the order bytes were passed on, so
+    // what it owes a leg that lost the lead comes first
+    pthread_mutex_lock(&hedge->mutex);
+    size_t paid = hedge->owed < len ? (size_t)hedge->owed : len;
+    hedge->owed -= paid;
+    len -= paid;
+    hedge->outstanding -= hedge->outstanding < len ? hedge->outstanding : len;
+    struct source_request *request = len > 0 ? leg_window(&hedge->legs[hedge->leader], len) : NULL;
+    pthread_mutex_unlock(&hedge->mutex);
+
+    if (request) {
+        source_request_open_window(request, len);
+    }
+}
+
+static void hedged_request_cancel(struct source_request *base)
+{
+    struct hedged_request *hedge = (struct hedged_request *)base;
+
+    pthread_mutex_lock(&hedge->mutex);
+    hedge->cancelled = true;
+    struct source_request *requests[2];
+    for (int i = 0; i < 2; i++) {
+        requests[i] = hedge->legs[i].running ? hedge->legs[i].request : NULL;
+    }
+    pthread_mutex_unlock(&hedge->mutex);
+
+    // A request published later is cancelled by set_leg_request()
+    for (int i = 0; i < 2; i++) {
+        source_request_cancel(requests[i]);
+    }
+}
+
+static void hedged_request_release(struct source_request *base)
+{
+    hedged_request_unref((struct hedged_request *)base);
+}
+
+static const struct archive_source_ops hedged_request_ops = {
+    .open_window = hedged_request_open_window,
+    .cancel = hedged_request_cancel,
+    .release = hedged_request_release,
+};
+
+static int compare_rates(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+double part_hedge_median_rate(double *rates, size_t count)
+{
+    if (!rates || count < PART_HEDGE_MIN_SAMPLES) {
+        return 0.0;
+    }
+    qsort(rates, count, sizeof(double), compare_rates);
+    return count % 2 ? rates[count / 2] : (rates[count / 2 - 1] + rates[count / 2]) / 2.0;
+}
+
+bool part_hedge_is_straggler(uint64_t bytes, uint64_t elapsed_ns, double median_rate)
+{
+    if (median_rate <= 0.0 || elapsed_ns < PART_HEDGE_MIN_ELAPSED_NS) {
+        return false;
+    }
+    double rate = (double)bytes * 1e9 / (double)elapsed_ns;
+    return rate * PART_HEDGE_SLOWDOWN < median_rate;
+}
+
+size_t part_hedge_stragglers(struct hedge_candidate *const *parts, size_t count,
+                             double median_rate, uint64_t now_ns, size_t max_hedges)
+{
+    size_t hedges = 0;
+    while (hedges < max_hedges) {
+        struct hedge_candidate *slowest = NULL;
+        double slowest_rate = 0.0;
+        for (size_t i = 0; i < count; i++) {
+            struct hedge_candidate *part = parts[i];
+            if (!part->request || part->hedged || now_ns < part->sent_ns) {
+                continue;
+            }
+            uint64_t bytes = hedged_request_progress(part->request);
+            uint64_t elapsed_ns = now_ns - part->sent_ns;
+            if (!part_hedge_is_straggler(bytes, elapsed_ns, median_rate)) {
+                continue;
+            }
+            double rate = (double)bytes * 1e9 / (double)elapsed_ns;
+            if (!slowest || rate < slowest_rate) {
+                slowest = part;
+                slowest_rate = rate;
+            }
+        }
+        if (!slowest) {
+            break;
+        }
+
+        // Not tried again for this request, whether or not it worked
+        slowest->hedged = true;
+        if (hedged_request_hedge(slowest->request) == 0) {
+            printf("Hedging part %u: %.1f MB/s against a median of %.1f MB/s\n",
+                   slowest->part_index + 1, slowest_rate / (1024.0 * 1024.0),
+                   median_rate / (1024.0 * 1024.0));
+            hedges++;
+        }
+    }
+    return hedges;
+}
+
+uint64_t part_hedge_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
@@ -0,0 +1,318 @@
+#include "part_prefetch.h"
+#include "profiling.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct prefetch_slot {
+    struct part_prefetch *prefetch;
+    struct source_request *request;
+
+    // Response so far, replayed on adoption
+    bool have_headers;
+    struct source_response response;
+    char etag[128];
+    uint8_t *data;
+    size_t len;
+    size_t capacity;
+    bool buffer_failed;
+
+    bool finished;  // The finish callback has returned (or, once adopted, been forwarded)
+    int error_code;
+    int response_status;
+
+    bool discarded;
+    bool adopted;
+    struct source_request_options sink;  // The adopter's callbacks
+    char if_match[128];
+};
+
+struct part_prefetch {
+    pthread_mutex_t mutex;
+    pthread_cond_t cv;  // Signalled when a slot finishes
+    uint64_t part_size;
+    uint32_t num_parts;
+    struct prefetch_slot *slots;
+};
+
+static int prefetch_headers_callback(const struct source_response *response, void *user_data)
+{
+    struct prefetch_slot *slot = user_data;
+    struct part_prefetch *prefetch = slot->prefetch;
+
+    pthread_mutex_lock(&prefetch->mutex);
+    if (slot->adopted) {
+        pthread_mutex_unlock(&prefetch->mutex);
+
+        // Adopted before the ETag was known: a different archive fails like If-Match would
+        if (slot->if_match[0] != '\0' &&
+            (!response->etag || strcmp(response->etag, slot->if_match) != 0)) {
+            struct source_response mismatch = *response;
+            mismatch.status = 412;
+            if (slot->sink.headers) {
+                slot->sink.headers(&mismatch, slot->sink.user_data);
+            }
+            return -1;
+        }
+        return slot->sink.headers ? slot->sink.headers(response, slot->sink.user_data) : 0;
+    }
+
+    slot->have_headers = true;
+    slot->response = *response;
+    slot->etag[0] = '\0';
+    if (response->etag) {
+        snprintf(slot->etag, sizeof(slot->etag), "%s", response->etag);
+    }
+    slot->response.etag = slot->etag;
+    pthread_mutex_unlock(&prefetch->mutex);
+    return 0;
+}
+
+static int prefetch_body_callback(struct source_request *request, const uint8_t *data, size_t len,
+                                  void *user_data)
+{
+    struct prefetch_slot *slot = user_data;
+    struct part_prefetch *prefetch = slot->prefetch;
+
+    pthread_mutex_lock(&prefetch->mutex);
+    if (slot->adopted) {
+        pthread_mutex_unlock(&prefetch->mutex);
+        return slot->sink.body ? slot->sink.body(request, data, len, slot->sink.user_data) : 0;
+    }
+    if (slot->discarded) {
+        pthread_mutex_unlock(&prefetch->mutex);
+        return -1;
+    }
+
+    // The read window is not reopened, so this holds at most one window
+    if (slot->len + len > slot->capacity) {
+        size_t capacity = slot->capacity > 0 ? slot->capacity : 1024 * 1024;
+        while (capacity < slot->len + len) {
+            capacity *= 2;
+        }
+        uint8_t *data_new = realloc(slot->data, capacity);
+        if (!data_new) {
+            slot->buffer_failed = true;
+            pthread_mutex_unlock(&prefetch->mutex);
+            return -1;
+        }
+        slot->data = data_new;
+        slot->capacity = capacity;
+    }
+    memcpy(slot->data + slot->len, data, len);
+    slot->len += len;
+    pthread_mutex_unlock(&prefetch->mutex);
+    return 0;
+}
+
+static void prefetch_finish_callback(int error_code, int response_status, void *user_data)
+{
+    struct prefetch_slot *slot = user_data;
+    struct part_prefetch *prefetch = slot->prefetch;
+
+    pthread_mutex_lock(&prefetch->mutex);
+    if (slot->adopted) {
+        pthread_mutex_unlock(&prefetch->mutex);
+        slot->sink.finish(error_code, response_status, slot->sink.user_data);
+        pthread_mutex_lock(&prefetch->mutex);
+    } else {
+        slot->error_code = error_code;
+        slot->response_status = response_status;
+    }
+    slot->finished = true;
+    pthread_cond_broadcast(&prefetch->cv);
+    pthread_mutex_unlock(&prefetch->mutex);
+}
+
+struct part_prefetch *part_prefetch_start(struct archive_source *source, uint64_t part_size,
+                                          uint32_t num_parts)
+{
+    if (!source || part_size == 0 || num_parts == 0) {
+        return NULL;
+    }
+
+    struct part_prefetch *prefetch = calloc(1, sizeof(struct part_prefetch));
+    if (!prefetch) {
+        return NULL;
+    }
+    prefetch->slots = calloc(num_parts, sizeof(struct prefetch_slot));
+    if (!prefetch->slots) {
+        free(prefetch);
+        return NULL;
+    }
+    pthread_mutex_init(&prefetch->mutex, NULL);
+    pthread_cond_init(&prefetch->cv, NULL);
+    prefetch->part_size = part_size;
+    prefetch->num_parts = num_parts;
+
+    for (uint32_t i = 0; i < num_parts; i++) {
+        struct prefetch_slot *slot = &prefetch->slots[i];
+        slot->prefetch = prefetch;
+
+        // The archive may turn out to have fewer parts; those are discarded
+        // once the tail gives its size
+        struct source_request_options options = {
+            .start = (uint64_t)i * part_size,
+            .end = (uint64_t)i * part_size + part_size - 1,
+            .headers = prefetch_headers_callback,
+            .body = prefetch_body_callback,
+            .finish = prefetch_finish_callback,
+            .user_data = slot,
+        };
+        slot->request = archive_source_request(source, &options);
+        if (!slot->request) {
+            fprintf(stderr, "Warning: failed to prefetch part %u\n", i);
+            break;
+        }
+    }
+
+    return prefetch;
+}
+
+// Stop a slot nobody will adopt. Returns its request if it still has to be
+// cancelled, which the caller does without the mutex held.
+static struct source_request *discard_slot(struct prefetch_slot *slot)
+{
+    if (!slot->request || slot->adopted || slot->discarded) {
+        return NULL;
+    }
+    slot->discarded = true;
+    free(slot->data);
+    slot->data = NULL;
+    slot->len = 0;
+    slot->capacity = 0;
+    return slot->finished ? NULL : slot->request;
+}
+
+void part_prefetch_discard(struct part_prefetch *prefetch, uint32_t part_index)
+{
+    if (!prefetch || part_index >= prefetch->num_parts) {
+        return;
+    }
+
+    pthread_mutex_lock(&prefetch->mutex);
+    struct source_request *request = discard_slot(&prefetch->slots[part_index]);
+    pthread_mutex_unlock(&prefetch->mutex);
+
+    if (request) {
+        source_request_cancel(request);
+    }
+}
+
+void part_prefetch_discard_from(struct part_prefetch *prefetch, uint64_t offset)
+{
+    if (!prefetch) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < prefetch->num_parts; i++) {
+        if ((uint64_t)i * prefetch->part_size >= offset) {
+            part_prefetch_discard(prefetch, i);
+        }
+    }
+}
+
+struct source_request *part_prefetch_adopt(struct part_prefetch *prefetch,
+                                           const struct source_request_options *options)
+{
+    if (!prefetch || !options || options->suffix_length > 0 ||
+        options->start % prefetch->part_size != 0 ||
+        options->end != options->start + prefetch->part_size - 1 ||
+        options->start / prefetch->part_size >= prefetch->num_parts) {
+        return NULL;
+    }
+
+    struct prefetch_slot *slot = &prefetch->slots[options->start / prefetch->part_size];
+    const char *if_match = options->if_match ? options->if_match : "";
+
+    pthread_mutex_lock(&prefetch->mutex);
+    if (!slot->request || slot->adopted || slot->discarded) {
+        pthread_mutex_unlock(&prefetch->mutex);
+        return NULL;
+    }
+
+    // Anything but a good response so far is left to a fresh request
+    bool usable = !slot->buffer_failed && !(slot->finished && slot->error_code != 0);
+    if (slot->have_headers) {
+        usable = usable && slot->response.status >= 200 && slot->response.status < 300 &&
+                 (if_match[0] == '\0' || strcmp(slot->etag, if_match) == 0);
+    }
+    if (!usable) {
+        struct source_request *request = discard_slot(slot);
+        pthread_mutex_unlock(&prefetch->mutex);
+        if (request) {
+            source_request_cancel(request);
+        }
+        return NULL;
+    }
+
+    slot->sink = *options;
+    snprintf(slot->if_match, sizeof(slot->if_match), "%s", if_match);
+    slot->sink.if_match = slot->if_match;
+
+    // Replay under the mutex, so the request's own callbacks wait until the
+    // adopter has seen everything before them
+    int rc = 0;
+    if (slot->have_headers && slot->sink.headers) {
+        rc = slot->sink.headers(&slot->response, slot->sink.user_data);
+    }
+    if (rc == 0 && slot->len > 0 && slot->sink.body) {
+        rc = slot->sink.body(slot->request, slot->data, slot->len, slot->sink.user_data);
+    }
+    if (slot->finished) {
+        slot->sink.finish(slot->error_code, slot->response_status, slot->sink.user_data);
+    }
+
+    PROFILE_COUNT(g_profile_stats.prefetch_parts);
+    PROFILE_ADD(g_profile_stats.prefetch_bytes, slot->len);
+
+    slot->adopted = true;
+    free(slot->data);
+    slot->data = NULL;
+    slot->len = 0;
+    slot->capacity = 0;
+    bool cancel = rc != 0 && !slot->finished;
+    struct source_request *request = slot->request;
+    pthread_mutex_unlock(&prefetch->mutex);
+
+    // The adopter rejected the response; its finish callback still follows
+    if (cancel) {
+        source_request_cancel(request);
+    }
+    return request;
+}
+
+void part_prefetch_destroy(struct part_prefetch *prefetch)
+{
+    if (!prefetch) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < prefetch->num_parts; i++) {
+        part_prefetch_discard(prefetch, i);
+    }
+
+    // Callbacks use the slots until finish returns
+    pthread_mutex_lock(&prefetch->mutex);
+    for (uint32_t i = 0; i < prefetch->num_parts; i++) {
+        while (prefetch->slots[i].request && !prefetch->slots[i].finished) {
+            pthread_cond_wait(&prefetch->cv, &prefetch->mutex);
+        }
+    }
+    pthread_mutex_unlock(&prefetch->mutex);
+
+    for (uint32_t i = 0; i < prefetch->num_parts; i++) {
+        struct prefetch_slot *slot = &prefetch->slots[i];
+        if (slot->request && !slot->adopted) {
+            source_request_release(slot->request);
+        }
+        free(slot->data);
+    }
+
+    pthread_mutex_destroy(&prefetch->mutex);
+    pthread_cond_destroy(&prefetch->cv);
+    free(prefetch->slots);
+    free(prefetch);
+}
@@ -0,0 +1,145 @@
+#include "part_schedule.h"
+
+#include <stdlib.h>
+
+// A part waiting to be placed in the dispatch order
+struct scheduled_part {
+    uint32_t part;
+    double seconds;
+};
+
+void part_schedule_costs(const struct central_dir_parse_result *cd, uint64_t part_size,
+                         struct part_cost *costs)
+{
+    for (size_t p = 0; p < cd->num_parts; p++) {
+        costs[p].entries = cd->parts[p].num_entries;
+        costs[p].bytes = 0;
+    }
+    if (part_size == 0) {
+        return;
+    }
+
+    for (size_t i = 0; i < cd->num_files; i++) {
+        const struct file_metadata *file = &cd->files[i];
+        if (file->hardlink_target || file->is_symlink || file->data_omitted ||
+            file->dedup_source || file->uncompressed_size == 0 || file->compressed_size == 0) {
+            continue;
+        }
+
+        uint64_t start = file->local_header_offset;
+        uint64_t end = start + file->compressed_size;
+        for (uint64_t p = start / part_size; p <= (end - 1) / part_size && p < cd->num_parts; p++) {
+            uint64_t part_start = p * part_size;
+            uint64_t from = start > part_start ? start : part_start;
+            uint64_t to = end < part_start + part_size ? end : part_start + part_size;
+            costs[p].bytes += (uint64_t)((double)file->uncompressed_size * (double)(to - from) /
+                                         (double)file->compressed_size);
+        }
+    }
+}
+
+double part_cost_seconds(const struct part_cost *cost)
+{
+    return (double)cost->entries / PART_SCHEDULE_ENTRIES_PER_SEC +
+           (double)cost->bytes / PART_SCHEDULE_BYTES_PER_SEC;
+}
+
+bool part_cost_inode_heavy(const struct part_cost *cost)
+{
+    return (double)cost->entries / PART_SCHEDULE_ENTRIES_PER_SEC >
+           (double)cost->bytes / PART_SCHEDULE_BYTES_PER_SEC;
+}
+
+// Most expensive first, then in index order
+static int compare_scheduled(const void *a, const void *b)
+{
+    const struct scheduled_part *x = a;
+    const struct scheduled_part *y = b;
+    if (x->seconds != y->seconds) {
+        return x->seconds > y->seconds ? -1 : 1;
+    }
+    return (x->part > y->part) - (x->part < y->part);
+}
+
+static double total_seconds(const struct scheduled_part *parts, size_t count)
+{
+    double total = 0.0;
+    for (size_t i = 0; i < count; i++) {
+        total += parts[i].seconds;
+    }
+    return total;
+}
+
+void part_schedule_order(const struct central_dir_parse_result *cd, uint64_t part_size,
+                         uint32_t *parts, size_t count, size_t prefetched)
+{
+    if (!cd || !parts || count < 2) {
+        return;
+    }
+
+    struct part_cost *costs = calloc(cd->num_parts, sizeof(struct part_cost));
+    struct scheduled_part *pending = calloc(count, sizeof(struct scheduled_part));
+    if (!costs || !pending) {
+        free(costs);
+        free(pending);
+        return;  // Index order will do
+    }
+    part_schedule_costs(cd, part_size, costs);
+
+    // Prefetched parts stay in front; the rest split into inode-heavy parts
+    // (from the start of pending) and byte-heavy ones (from the end)
+    size_t kept = 0;
+    size_t inode_heavy = 0;
+    size_t byte_heavy = 0;
+    for (size_t i = 0; i < count; i++) {
+        uint32_t p = parts[i];
+        if (p < prefetched || p >= cd->num_parts) {
+            parts[kept++] = p;
+            continue;
+        }
+        struct scheduled_part part = { .part = p, .seconds = part_cost_seconds(&costs[p]) };
+        if (part_cost_inode_heavy(&costs[p])) {
+            pending[inode_heavy++] = part;
+        } else {
+            pending[count - ++byte_heavy] = part;
+        }
+    }
+    free(costs);
+
+    struct scheduled_part *inodes = pending;
+    struct scheduled_part *bytes = pending + count - byte_heavy;
+    qsort(inodes, inode_heavy, sizeof(struct scheduled_part), compare_scheduled);
+    qsort(bytes, byte_heavy, sizeof(struct scheduled_part), compare_scheduled);
+
+    // Take next from whichever kind has had the smaller share of its total
+    // started, so both run out together; on a tie, the more expensive part
+    double inode_total = total_seconds(inodes, inode_heavy);
+    double byte_total = total_seconds(bytes, byte_heavy);
+    double inode_started = 0.0;
+    double byte_started = 0.0;
+    size_t i = 0;
+    size_t b = 0;
+    while (i < inode_heavy || b < byte_heavy) {
+        bool take_inode;
+        if (i == inode_heavy) {
+            take_inode = false;
+        } else if (b == byte_heavy) {
+            take_inode = true;
+        } else {
+            // inode_started / inode_total against byte_started / byte_total
+            double inode_share = inode_started * byte_total;
+            double byte_share = byte_started * inode_total;
+            take_inode = inode_share != byte_share ? inode_share < byte_share
+                                                   : compare_scheduled(&inodes[i], &bytes[b]) < 0;
+        }
+        if (take_inode) {
+            inode_started += inodes[i].seconds;
+            parts[kept++] = inodes[i++].part;
+        } else {
+            byte_started += bytes[b].seconds;
+            parts[kept++] = bytes[b++].part;
+        }
+    }
+
+    free(pending);
+}
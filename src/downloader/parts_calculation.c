@@ -41,3 +41,57 @@ void calculate_parts_to_download(
         *process_final_from_buffer = false;
     }
 }
+
+uint64_t calculate_read_window(
+    uint64_t memory_limit,
+    size_t max_concurrent_parts,
+    uint64_t part_size
+) {
+    const uint64_t mib = 1024 * 1024;
+
+    if (memory_limit == 0 || max_concurrent_parts == 0) {
+        return part_size;
+    }
+
+    // Split the budget evenly across parts, in whole MiB
+    uint64_t window = memory_limit / max_concurrent_parts;
+    window -= window % mib;
+
+    if (window < mib) {
+        return 0;  // Budget too small for this many parts
+    }
+    if (window > part_size) {
+        return part_size;  // A part never holds more than its own size
+    }
+    return window;
+}
+
+uint64_t calculate_retry_delay_ms(uint32_t attempt, uint32_t random) {
+    const uint64_t base_ms = 200;
+    const uint64_t max_ms = 20000;
+
+    if (attempt == 0) {
+        attempt = 1;
+    }
+
+    // Double per attempt, stopping at the cap (and before the shift overflows)
+    uint64_t delay = max_ms;
+    if (attempt <= 16) {
+        delay = base_ms << (attempt - 1);
+        if (delay > max_ms) {
+            delay = max_ms;
+        }
+    }
+
+    // Spread over the upper half so parts that failed together do not retry in step
+    return delay / 2 + random % (delay / 2 + 1);
+}
+
+bool part_failure_is_transient(int response_status) {
+    // No response, or the body was cut off after a good one
+    if (response_status == 0 || (response_status >= 200 && response_status < 300)) {
+        return true;
+    }
+    // Request timeout, throttling and server errors
+    return response_status == 408 || response_status == 429 || response_status >= 500;
+}
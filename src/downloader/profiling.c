@@ -72,6 +72,13 @@ void burst_profile_print_stats(void) {
     uint64_t s3_requests = atomic_load(&g_profile_stats.s3_requests);
     uint64_t s3_time = atomic_load(&g_profile_stats.s3_time_ns);
     uint64_t s3_bytes = atomic_load(&g_profile_stats.s3_bytes);
+    uint64_t carry_bytes = atomic_load(&g_profile_stats.frame_carry_bytes);
+    uint64_t prefetch_parts = atomic_load(&g_profile_stats.prefetch_parts);
+    uint64_t prefetch_bytes = atomic_load(&g_profile_stats.prefetch_bytes);
+    uint64_t concurrency_adjustments = atomic_load(&g_profile_stats.concurrency_adjustments);
+    uint64_t concurrency_final = atomic_load(&g_profile_stats.concurrency_final_parts);
+    uint64_t hedge_requests = atomic_load(&g_profile_stats.hedge_requests);
+    uint64_t hedge_takeovers = atomic_load(&g_profile_stats.hedge_takeovers);
 
     // Calculate percentages
     double inode_pct = total_duration_ns > 0 ? 100.0 * inode_time / total_duration_ns : 0.0;
@@ -119,6 +126,26 @@ void burst_profile_print_stats(void) {
     if (s3_time > 0) {
         printf("  Throughput: %.1f MB/s\n", calc_throughput_mbps(s3_bytes, s3_time));
     }
+    char carry_bytes_str[32];
+    format_bytes(carry_bytes, carry_bytes_str, sizeof(carry_bytes_str));
+    printf("  Copied to reassemble split frames: %s", carry_bytes_str);
+    if (s3_bytes > 0) {
+        printf(" (%.1f KB per GB downloaded)",
+               (double)carry_bytes / 1024.0 / ((double)s3_bytes / (1024.0 * 1024.0 * 1024.0)));
+    }
+    printf("\n");
+    char prefetch_bytes_str[32];
+    format_bytes(prefetch_bytes, prefetch_bytes_str, sizeof(prefetch_bytes_str));
+    printf("  Prefetched before the central directory was parsed: %lu parts, %s\n",
+           (unsigned long)prefetch_parts, prefetch_bytes_str);
+    if (concurrency_final > 0) {
+        printf("  Adaptive concurrency: %lu parts in flight at the end, %lu adjustments\n",
+               (unsigned long)concurrency_final, (unsigned long)concurrency_adjustments);
+    }
+    if (hedge_requests > 0) {
+        printf("  Hedged straggling parts: %lu duplicates, %lu took over\n",
+               (unsigned long)hedge_requests, (unsigned long)hedge_takeovers);
+    }
 
     // Show accounted vs unaccounted time
     uint64_t accounted_time = inode_time + encoded_time + unencoded_time + s3_time;
@@ -162,6 +189,13 @@ int burst_profile_write_json(const char *output_path) {
     uint64_t s3_requests = atomic_load(&g_profile_stats.s3_requests);
     uint64_t s3_time = atomic_load(&g_profile_stats.s3_time_ns);
     uint64_t s3_bytes = atomic_load(&g_profile_stats.s3_bytes);
+    uint64_t carry_bytes = atomic_load(&g_profile_stats.frame_carry_bytes);
+    uint64_t prefetch_parts = atomic_load(&g_profile_stats.prefetch_parts);
+    uint64_t prefetch_bytes = atomic_load(&g_profile_stats.prefetch_bytes);
+    uint64_t concurrency_adjustments = atomic_load(&g_profile_stats.concurrency_adjustments);
+    uint64_t concurrency_final = atomic_load(&g_profile_stats.concurrency_final_parts);
+    uint64_t hedge_requests = atomic_load(&g_profile_stats.hedge_requests);
+    uint64_t hedge_takeovers = atomic_load(&g_profile_stats.hedge_takeovers);
 
     fprintf(f, "{\n");
     fprintf(f, "  \"version\": \"1.0\",\n");
@@ -188,7 +222,14 @@ int burst_profile_write_json(const char *output_path) {
     fprintf(f, "  \"s3_network\": {\n");
     fprintf(f, "    \"requests\": %lu,\n", (unsigned long)s3_requests);
     fprintf(f, "    \"bytes\": %lu,\n", (unsigned long)s3_bytes);
-    fprintf(f, "    \"time_seconds\": %.6f\n", ns_to_seconds(s3_time));
+    fprintf(f, "    \"time_seconds\": %.6f,\n", ns_to_seconds(s3_time));
+    fprintf(f, "    \"frame_carry_bytes\": %lu,\n", (unsigned long)carry_bytes);
+    fprintf(f, "    \"prefetch_parts\": %lu,\n", (unsigned long)prefetch_parts);
+    fprintf(f, "    \"prefetch_bytes\": %lu,\n", (unsigned long)prefetch_bytes);
+    fprintf(f, "    \"concurrency_adjustments\": %lu,\n", (unsigned long)concurrency_adjustments);
+    fprintf(f, "    \"concurrency_final_parts\": %lu,\n", (unsigned long)concurrency_final);
+    fprintf(f, "    \"hedge_requests\": %lu,\n", (unsigned long)hedge_requests);
+    fprintf(f, "    \"hedge_takeovers\": %lu\n", (unsigned long)hedge_takeovers);
     fprintf(f, "  }\n");
 
     fprintf(f, "}\n");
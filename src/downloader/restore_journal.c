@@ -0,0 +1,225 @@
+#include "restore_journal.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// File layout: one header line naming the archive, then one line per part
+// written, in completion order:
+//
+//   BURST-JOURNAL 1 <archive size> <etag>
+//   <part index>
+//   ...
+#define JOURNAL_MAGIC "BURST-JOURNAL 1"
+
+struct restore_journal {
+    char path[PATH_MAX];
+    int fd;  // Opened with O_APPEND; every record is a single write()
+    pthread_mutex_t mutex;
+
+    bool *parts_done;
+    size_t num_parts;
+    size_t resumed_parts;
+};
+
+// Read the whole journal file. Returns NULL if it does not exist or cannot be read.
+static char *read_journal_file(const char *path, size_t *out_len)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return NULL;
+    }
+
+    char *data = malloc((size_t)st.st_size + 1);
+    if (!data) {
+        close(fd);
+        return NULL;
+    }
+
+    size_t len = 0;
+    while (len < (size_t)st.st_size) {
+        ssize_t n = read(fd, data + len, (size_t)st.st_size - len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        len += (size_t)n;
+    }
+    close(fd);
+
+    data[len] = '\0';
+    *out_len = len;
+    return data;
+}
+
+// Mark the parts listed after the header. Returns the length of the complete
+// lines, so a record cut off by a kill can be dropped.
+static size_t load_parts(struct restore_journal *journal, const char *data, size_t len,
+                         size_t header_len)
+{
+    size_t pos = header_len;
+    while (pos < len) {
+        const char *line = data + pos;
+        const char *newline = memchr(line, '\n', len - pos);
+        if (!newline) {
+            break;
+        }
+
+        char *end;
+        errno = 0;
+        unsigned long long part = strtoull(line, &end, 10);
+        if (end == newline && end != line && errno == 0 && part < journal->num_parts &&
+            !journal->parts_done[part]) {
+            journal->parts_done[part] = true;
+            journal->resumed_parts++;
+        }
+        pos = (size_t)(newline - data) + 1;
+    }
+    return pos;
+}
+
+struct restore_journal *restore_journal_open(const char *output_dir, const char *etag,
+                                             uint64_t archive_size, size_t num_parts)
+{
+    if (!output_dir || !etag || etag[0] == '\0' || strpbrk(etag, "\r\n") != NULL) {
+        return NULL;
+    }
+
+    struct restore_journal *journal = calloc(1, sizeof(struct restore_journal));
+    if (!journal) {
+        return NULL;
+    }
+    journal->fd = -1;
+    journal->num_parts = num_parts;
+
+    int path_len = snprintf(journal->path, sizeof(journal->path), "%s/%s",
+                            output_dir, RESTORE_JOURNAL_NAME);
+    journal->parts_done = calloc(num_parts > 0 ? num_parts : 1, sizeof(bool));
+    if (path_len < 0 || (size_t)path_len >= sizeof(journal->path) || !journal->parts_done) {
+        free(journal->parts_done);
+        free(journal);
+        return NULL;
+    }
+
+    char header[512];
+    int header_len = snprintf(header, sizeof(header), JOURNAL_MAGIC " %" PRIu64 " %s\n",
+                              archive_size, etag);
+    if (header_len < 0 || (size_t)header_len >= sizeof(header)) {
+        free(journal->parts_done);
+        free(journal);
+        return NULL;
+    }
+
+    // The journal is written before any entry, so the restore target may not exist yet
+    if (mkdir(output_dir, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "Error: Failed to create %s: %s\n", output_dir, strerror(errno));
+        free(journal->parts_done);
+        free(journal);
+        return NULL;
+    }
+
+    // Keep the records of an earlier run for this archive
+    size_t len = 0;
+    char *data = read_journal_file(journal->path, &len);
+    if (data && len >= (size_t)header_len && memcmp(data, header, (size_t)header_len) == 0) {
+        size_t valid_len = load_parts(journal, data, len, (size_t)header_len);
+        journal->fd = open(journal->path, O_WRONLY | O_APPEND | O_CLOEXEC);
+        if (journal->fd >= 0 && valid_len < len && ftruncate(journal->fd, (off_t)valid_len) != 0) {
+            close(journal->fd);
+            journal->fd = -1;
+        }
+    } else {
+        if (data) {
+            printf("Journal %s is for another archive; starting over\n", journal->path);
+        }
+        journal->fd = open(journal->path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+        if (journal->fd >= 0 && write(journal->fd, header, (size_t)header_len) != header_len) {
+            close(journal->fd);
+            journal->fd = -1;
+        }
+    }
+    free(data);
+
+    if (journal->fd < 0) {
+        fprintf(stderr, "Error: Failed to open journal %s: %s\n", journal->path, strerror(errno));
+        free(journal->parts_done);
+        free(journal);
+        return NULL;
+    }
+
+    pthread_mutex_init(&journal->mutex, NULL);
+    return journal;
+}
+
+bool restore_journal_has_part(const struct restore_journal *journal, uint32_t part_index)
+{
+    return journal && part_index < journal->num_parts && journal->parts_done[part_index];
+}
+
+size_t restore_journal_resumed_parts(const struct restore_journal *journal)
+{
+    return journal ? journal->resumed_parts : 0;
+}
+
+int restore_journal_record(struct restore_journal *journal, uint32_t part_index)
+{
+    if (!journal || part_index >= journal->num_parts) {
+        return -1;
+    }
+
+    char line[16];
+    int line_len = snprintf(line, sizeof(line), "%u\n", part_index);
+
+    pthread_mutex_lock(&journal->mutex);
+    int result = 0;
+    if (!journal->parts_done[part_index]) {
+        if (write(journal->fd, line, (size_t)line_len) != line_len) {
+            fprintf(stderr, "Warning: failed to update journal %s: %s\n",
+                    journal->path, strerror(errno));
+            result = -1;
+        } else {
+            journal->parts_done[part_index] = true;
+        }
+    }
+    pthread_mutex_unlock(&journal->mutex);
+    return result;
+}
+
+int restore_journal_remove(struct restore_journal *journal)
+{
+    if (!journal) {
+        return -1;
+    }
+    if (unlink(journal->path) != 0 && errno != ENOENT) {
+        fprintf(stderr, "Warning: failed to remove journal %s: %s\n",
+                journal->path, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+void restore_journal_close(struct restore_journal *journal)
+{
+    if (!journal) {
+        return;
+    }
+    close(journal->fd);
+    pthread_mutex_destroy(&journal->mutex);
+    free(journal->parts_done);
+    free(journal);
+}
@@ -9,6 +9,7 @@
 #include <aws/common/error.h>
 #include <aws/common/mutex.h>
 #include <aws/common/string.h>
+#include <aws/common/uri.h>
 #include <aws/io/channel_bootstrap.h>
 #include <aws/io/event_loop.h>
 #include <aws/io/host_resolver.h>
@@ -19,62 +20,9 @@
 #include <stdlib.h>
 #include <string.h>
 
-int s3_client_init(struct burst_downloader *downloader) {
-    if (!downloader) {
-        fprintf(stderr, "Error: NULL downloader\n");
-        return -1;
-    }
-
-    // Get default allocator
-    downloader->allocator = aws_default_allocator();
-
-    // Initialize S3 library
-    aws_s3_library_init(downloader->allocator);
-
-    // Create event loop group for async I/O
-    downloader->event_loop_group = aws_event_loop_group_new_default(downloader->allocator, 0, NULL);
-    if (!downloader->event_loop_group) {
-        fprintf(stderr, "Error: Failed to create event loop group: %s\n",
-                aws_error_debug_str(aws_last_error()));
-        goto error_cleanup;
-    }
-
-    // Create DNS resolver
-    struct aws_host_resolver_default_options resolver_options = {
-        .el_group = downloader->event_loop_group,
-        .max_entries = 8,
-    };
-    downloader->host_resolver = aws_host_resolver_new_default(downloader->allocator, &resolver_options);
-    if (!downloader->host_resolver) {
-        fprintf(stderr, "Error: Failed to create host resolver: %s\n",
-                aws_error_debug_str(aws_last_error()));
-        goto error_cleanup;
-    }
-
-    // Create client bootstrap
-    struct aws_client_bootstrap_options bootstrap_options = {
-        .event_loop_group = downloader->event_loop_group,
-        .host_resolver = downloader->host_resolver,
-    };
-    downloader->client_bootstrap = aws_client_bootstrap_new(downloader->allocator, &bootstrap_options);
-    if (!downloader->client_bootstrap) {
-        fprintf(stderr, "Error: Failed to create client bootstrap: %s\n",
-                aws_error_debug_str(aws_last_error()));
-        goto error_cleanup;
-    }
-
-    // Create TLS context (required for SSO and other secure providers)
-    struct aws_tls_ctx_options tls_ctx_options;
-    aws_tls_ctx_options_init_default_client(&tls_ctx_options, downloader->allocator);
-    downloader->tls_ctx = aws_tls_client_ctx_new(downloader->allocator, &tls_ctx_options);
-    aws_tls_ctx_options_clean_up(&tls_ctx_options);
-
-    if (!downloader->tls_ctx) {
-        fprintf(stderr, "Error: Failed to create TLS context: %s\n",
-                aws_error_debug_str(aws_last_error()));
-        goto error_cleanup;
-    }
-
+// Build the credentials provider chain and the SigV4 config S3 requests are
+// signed with. Returns NULL on error.
+static struct aws_signing_config_aws *create_signing_config(struct burst_downloader *downloader) {
     // Determine profile name: provided > env var > "default"
     const char *profile_to_use = downloader->profile_name;
     if (!profile_to_use) {
@@ -171,7 +119,7 @@ int s3_client_init(struct burst_downloader *downloader) {
 
     if (provider_count == 0) {
         fprintf(stderr, "Error: No credentials providers could be initialized\n");
-        goto error_cleanup;
+        return NULL;
     }
 
     struct aws_credentials_provider_chain_options chain_options = {
@@ -196,7 +144,7 @@ int s3_client_init(struct burst_downloader *downloader) {
     if (!downloader->credentials_provider) {
         fprintf(stderr, "Error: Failed to create credentials provider chain: %s\n",
                 aws_error_debug_str(aws_last_error()));
-        goto error_cleanup;
+        return NULL;
     }
 
     printf("Using AWS profile: %s\n", profile_to_use);
@@ -206,7 +154,7 @@ int s3_client_init(struct burst_downloader *downloader) {
         aws_mem_calloc(downloader->allocator, 1, sizeof(struct aws_signing_config_aws));
     if (!signing_config) {
         fprintf(stderr, "Error: Failed to allocate signing config\n");
-        goto error_cleanup;
+        return NULL;
     }
 
     aws_s3_init_default_signing_config(
@@ -216,28 +164,122 @@ int s3_client_init(struct burst_downloader *downloader) {
     );
     signing_config->flags.use_double_uri_encode = false;
 
+    return signing_config;
+}
+
+int s3_client_init(struct burst_downloader *downloader) {
+    if (!downloader) {
+        fprintf(stderr, "Error: NULL downloader\n");
+        return -1;
+    }
+
+    // Get default allocator
+    downloader->allocator = aws_default_allocator();
+
+    // Initialize S3 library
+    aws_s3_library_init(downloader->allocator);
+
+    // A local file source reads the archive itself and needs no client
+    if (downloader->source_kind == ARCHIVE_SOURCE_FILE) {
+        return 0;
+    }
+
+    // Create event loop group for async I/O
+    downloader->event_loop_group = aws_event_loop_group_new_default(downloader->allocator, 0, NULL);
+    if (!downloader->event_loop_group) {
+        fprintf(stderr, "Error: Failed to create event loop group: %s\n",
+                aws_error_debug_str(aws_last_error()));
+        goto error_cleanup;
+    }
+
+    // Create DNS resolver
+    struct aws_host_resolver_default_options resolver_options = {
+        .el_group = downloader->event_loop_group,
+        .max_entries = 8,
+    };
+    downloader->host_resolver = aws_host_resolver_new_default(downloader->allocator, &resolver_options);
+    if (!downloader->host_resolver) {
+        fprintf(stderr, "Error: Failed to create host resolver: %s\n",
+                aws_error_debug_str(aws_last_error()));
+        goto error_cleanup;
+    }
+
+    // Create client bootstrap
+    struct aws_client_bootstrap_options bootstrap_options = {
+        .event_loop_group = downloader->event_loop_group,
+        .host_resolver = downloader->host_resolver,
+    };
+    downloader->client_bootstrap = aws_client_bootstrap_new(downloader->allocator, &bootstrap_options);
+    if (!downloader->client_bootstrap) {
+        fprintf(stderr, "Error: Failed to create client bootstrap: %s\n",
+                aws_error_debug_str(aws_last_error()));
+        goto error_cleanup;
+    }
+
+    // Create TLS context (required for SSO and other secure providers)
+    struct aws_tls_ctx_options tls_ctx_options;
+    aws_tls_ctx_options_init_default_client(&tls_ctx_options, downloader->allocator);
+    downloader->tls_ctx = aws_tls_client_ctx_new(downloader->allocator, &tls_ctx_options);
+    aws_tls_ctx_options_clean_up(&tls_ctx_options);
+
+    if (!downloader->tls_ctx) {
+        fprintf(stderr, "Error: Failed to create TLS context: %s\n",
+                aws_error_debug_str(aws_last_error()));
+        goto error_cleanup;
+    }
+
+    // HTTP(S) servers get unsigned requests, over TLS only for https:// URLs
+    struct aws_signing_config_aws *signing_config = NULL;
+    enum aws_s3_meta_request_tls_mode tls_mode = AWS_MR_TLS_ENABLED;
+    if (downloader->source_kind == ARCHIVE_SOURCE_HTTP) {
+        struct aws_uri url;
+        struct aws_byte_cursor url_cursor = aws_byte_cursor_from_c_str(downloader->source_url);
+        if (aws_uri_init_parse(&url, downloader->allocator, &url_cursor) != AWS_OP_SUCCESS) {
+            fprintf(stderr, "Error: Invalid URL: %s\n", downloader->source_url);
+            goto error_cleanup;
+        }
+        if (!aws_byte_cursor_eq_c_str_ignore_case(aws_uri_scheme(&url), "https")) {
+            tls_mode = AWS_MR_TLS_DISABLED;
+        }
+        aws_uri_clean_up(&url);
+    } else {
+        signing_config = create_signing_config(downloader);
+        if (!signing_config) {
+            goto error_cleanup;
+        }
+    }
+
     // Create S3 client with optimal EC2->S3 configuration
     struct aws_s3_client_config client_config = {
         .client_bootstrap = downloader->client_bootstrap,
-        .region = aws_byte_cursor_from_c_str(downloader->region),
+        .region = aws_byte_cursor_from_c_str(downloader->region ? downloader->region : ""),
         .signing_config = signing_config,
+        .tls_mode = tls_mode,
         .max_active_connections_override = downloader->max_concurrent_connections,
         .memory_limit_in_bytes = 1024 * 1024 * 1024,  // 1 GiB (AWS CRT minimum)
-        .part_size = downloader->part_size,  // Configurable (default 8 MiB)
+        // GETs are split at the read window so each request fits in it
+        .part_size = downloader->read_window,
         .throughput_target_gbps = 10.0,  // EC2 enhanced networking
-        .enable_read_backpressure = false,
+        // Each request receives at most read_window bytes beyond what has been
+        // written to disk; body callbacks open the window as data is consumed
+        .enable_read_backpressure = true,
+        .initial_read_window = downloader->read_window,
     };
 
     downloader->s3_client = aws_s3_client_new(downloader->allocator, &client_config);
     if (!downloader->s3_client) {
         fprintf(stderr, "Error: Failed to create S3 client: %s\n",
                 aws_error_debug_str(aws_last_error()));
-        aws_mem_release(downloader->allocator, signing_config);
+        if (signing_config) {
+            aws_mem_release(downloader->allocator, signing_config);
+        }
         goto error_cleanup;
     }
 
     // Signing config is copied by aws_s3_client_new, so we can free it
-    aws_mem_release(downloader->allocator, signing_config);
+    if (signing_config) {
+        aws_mem_release(downloader->allocator, signing_config);
+    }
 
     return 0;
 
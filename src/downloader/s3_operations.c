@@ -3,18 +3,24 @@
 #include "stream_processor.h"
 #include "central_dir_parser.h"
 #include "cd_fetch.h"
+#include "io_pool.h"
 #include "profiling.h"
+#include "restore_journal.h"
+#include "part_hedge.h"
+#include "part_schedule.h"
+#include "concurrency_controller.h"
 
 #include <aws/common/byte_buf.h>
 #include <aws/common/condition_variable.h>
 #include <aws/common/mutex.h>
 #include <aws/common/string.h>
-#include <aws/http/request_response.h>
-#include <aws/s3/s3_client.h>
+#include <aws/common/task_scheduler.h>
+#include <aws/io/event_loop.h>
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 // Context structure for async GET requests
 struct get_request_context {
@@ -31,17 +37,17 @@ struct get_request_context {
     size_t buffer_capacity;
 
     // Response metadata
-    uint64_t content_length;
     uint64_t range_start;
     uint64_t range_end;
     uint64_t total_size;
+    char etag[128];
 
     // Error tracking
     int error_code;
     char error_message[256];
 
-    // Meta request handle
-    struct aws_s3_meta_request *meta_request;
+    // Request handle
+    struct source_request *request;
 };
 
 // Initialize request context
@@ -81,80 +87,41 @@ static void get_request_context_destroy(struct get_request_context *ctx) {
     aws_mem_release(ctx->downloader->allocator, ctx);
 }
 
-// Callback: Parse response headers
-static int s3_get_headers_callback(
-    struct aws_s3_meta_request *meta_request,
-    const struct aws_http_headers *headers,
-    int response_status,
-    void *user_data
-) {
-    (void)meta_request;
+// Callback: Record response metadata
+static int get_headers_callback(const struct source_response *response, void *user_data) {
     struct get_request_context *ctx = user_data;
 
     // Check HTTP status
-    if (response_status < 200 || response_status >= 300) {
+    if (response->status < 200 || response->status >= 300) {
         snprintf(ctx->error_message, sizeof(ctx->error_message),
-                "HTTP error: status code %d", response_status);
+                "HTTP error: status code %d", response->status);
         ctx->error_code = -1;
-        return AWS_OP_SUCCESS;  // Continue to get error body
-    }
-
-    // Parse Content-Length header
-    struct aws_byte_cursor content_length_name = aws_byte_cursor_from_c_str("Content-Length");
-    struct aws_byte_cursor content_length_value;
-    if (aws_http_headers_get(headers, content_length_name, &content_length_value) == AWS_OP_SUCCESS) {
-        char value_str[64];
-        size_t copy_len = content_length_value.len < sizeof(value_str) - 1
-                         ? content_length_value.len
-                         : sizeof(value_str) - 1;
-        memcpy(value_str, content_length_value.ptr, copy_len);
-        value_str[copy_len] = '\0';
-        ctx->content_length = strtoull(value_str, NULL, 10);
-    }
-
-    // Parse Content-Range header (if present)
-    // Format: "bytes START-END/TOTAL" or "bytes */TOTAL"
-    struct aws_byte_cursor content_range_name = aws_byte_cursor_from_c_str("Content-Range");
-    struct aws_byte_cursor content_range_value;
-    if (aws_http_headers_get(headers, content_range_name, &content_range_value) == AWS_OP_SUCCESS) {
-        char range_str[128];
-        size_t copy_len = content_range_value.len < sizeof(range_str) - 1
-                         ? content_range_value.len
-                         : sizeof(range_str) - 1;
-        memcpy(range_str, content_range_value.ptr, copy_len);
-        range_str[copy_len] = '\0';
-
-        // Parse: "bytes START-END/TOTAL"
-        if (sscanf(range_str, "bytes %llu-%llu/%llu",
-                   (unsigned long long *)&ctx->range_start,
-                   (unsigned long long *)&ctx->range_end,
-                   (unsigned long long *)&ctx->total_size) == 3) {
-            // Successfully parsed range
-        } else if (sscanf(range_str, "bytes */%llu",
-                          (unsigned long long *)&ctx->total_size) == 1) {
-            // Unsatisfiable range (416 response) - just got total size
-            ctx->range_start = 0;
-            ctx->range_end = 0;
-        }
+        return 0;  // Continue to get error body
+    }
+
+    ctx->range_start = response->range_start;
+    ctx->range_end = response->range_end;
+    ctx->total_size = response->total_size;
+
+    // ETag identifies this version of the object (resume journal, If-Match)
+    if (response->etag) {
+        snprintf(ctx->etag, sizeof(ctx->etag), "%s", response->etag);
     }
 
-    return AWS_OP_SUCCESS;
+    return 0;
 }
 
 // Callback: Accumulate response body data
-static int s3_get_body_callback(
-    struct aws_s3_meta_request *meta_request,
-    const struct aws_byte_cursor *body,
-    uint64_t range_start,
+static int get_body_callback(
+    struct source_request *request,
+    const uint8_t *data,
+    size_t len,
     void *user_data
 ) {
-    (void)meta_request;
-    (void)range_start;
-
     struct get_request_context *ctx = user_data;
 
     // Allocate or expand buffer as needed
-    size_t new_size = ctx->buffer_size + body->len;
+    size_t new_size = ctx->buffer_size + len;
     if (new_size > ctx->buffer_capacity) {
         size_t new_capacity = ctx->buffer_capacity == 0 ? 4096 : ctx->buffer_capacity * 2;
         while (new_capacity < new_size) {
@@ -166,7 +133,7 @@ static int s3_get_body_callback(
             snprintf(ctx->error_message, sizeof(ctx->error_message),
                     "Failed to allocate buffer (%zu bytes)", new_capacity);
             ctx->error_code = -1;
-            return AWS_OP_ERR;
+            return -1;
         }
 
         ctx->buffer = buffer_ptr;
@@ -174,28 +141,27 @@ static int s3_get_body_callback(
     }
 
     // Append data to buffer
-    memcpy(ctx->buffer + ctx->buffer_size, body->ptr, body->len);
-    ctx->buffer_size += body->len;
+    memcpy(ctx->buffer + ctx->buffer_size, data, len);
+    ctx->buffer_size += len;
+
+    // Buffered whole, so let the next bytes in straight away
+    source_request_open_window(request, len);
 
-    return AWS_OP_SUCCESS;
+    return 0;
 }
 
 // Callback: Request completion
-static void s3_get_finish_callback(
-    struct aws_s3_meta_request *meta_request,
-    const struct aws_s3_meta_request_result *result,
-    void *user_data
-) {
-    (void)meta_request;
+static void get_finish_callback(int error_code, int response_status, void *user_data) {
+    (void)response_status;
 
     struct get_request_context *ctx = user_data;
 
     aws_mutex_lock(&ctx->mutex);
 
-    if (result->error_code != AWS_ERROR_SUCCESS) {
-        ctx->error_code = result->error_code;
-        snprintf(ctx->error_message, sizeof(ctx->error_message),
-                "S3 request failed: %s", aws_error_debug_str(result->error_code));
+    if (error_code != 0 && ctx->error_code == 0) {
+        ctx->error_code = error_code;
+        snprintf(ctx->error_message, sizeof(ctx->error_message), "Request failed: %s",
+                 archive_source_error_str(ctx->downloader->source, error_code));
     }
 
     ctx->request_complete = true;
@@ -218,94 +184,74 @@ static bool wait_for_completion(struct get_request_context *ctx, uint64_t timeou
     return success && ctx->request_complete;
 }
 
-// Get object size using HEAD request or negative range
-int burst_downloader_get_object_size(struct burst_downloader *downloader) {
-    if (!downloader || !downloader->s3_client) {
-        fprintf(stderr, "Error: Invalid downloader\n");
+// Fetch one byte range into a buffer and wait for it. On success the context
+// holds the response; the caller destroys it either way.
+static int run_get_request(
+    struct get_request_context *ctx,
+    uint64_t start,
+    uint64_t end,
+    uint64_t suffix_length,
+    uint64_t timeout_ns,
+    const char *what
+) {
+    struct source_request_options options = {
+        .start = start,
+        .end = end,
+        .suffix_length = suffix_length,
+        .headers = get_headers_callback,
+        .body = get_body_callback,
+        .finish = get_finish_callback,
+        .user_data = ctx,
+    };
+
+    // Make the request
+    ctx->request = archive_source_request(ctx->downloader->source, &options);
+    if (!ctx->request) {
+        fprintf(stderr, "Error: Failed to start %s request\n", what);
         return -1;
     }
 
-    // Create request context
-    struct get_request_context *ctx = get_request_context_new(downloader);
-    if (!ctx) {
-        fprintf(stderr, "Error: Failed to allocate request context\n");
+    if (!wait_for_completion(ctx, timeout_ns)) {
+        fprintf(stderr, "Error: %s request timed out\n", what);
+        source_request_release(ctx->request);
         return -1;
     }
 
-    // Build HTTP message for HEAD request
-    struct aws_http_message *message = aws_http_message_new_request(downloader->allocator);
-    if (!message) {
-        fprintf(stderr, "Error: Failed to create HTTP message\n");
-        get_request_context_destroy(ctx);
+    // Check for errors
+    if (ctx->error_code != 0) {
+        fprintf(stderr, "Error: %s\n", ctx->error_message);
+        source_request_release(ctx->request);
         return -1;
     }
 
-    // Set method to HEAD
-    aws_http_message_set_request_method(message, aws_http_method_head);
-
-    // Set path: /KEY
-    struct aws_byte_buf path_buf;
-    aws_byte_buf_init(&path_buf, downloader->allocator, strlen(downloader->key) + 2);
-    aws_byte_buf_append_byte_dynamic(&path_buf, '/');
-    struct aws_byte_cursor key_cursor = aws_byte_cursor_from_c_str(downloader->key);
-    aws_byte_buf_append_dynamic(&path_buf, &key_cursor);
-    struct aws_byte_cursor path_cursor = aws_byte_cursor_from_buf(&path_buf);
-    aws_http_message_set_request_path(message, path_cursor);
-
-    // Set Host header: BUCKET.s3.REGION.amazonaws.com
-    char host_value[256];
-    snprintf(host_value, sizeof(host_value), "%s.s3.%s.amazonaws.com",
-             downloader->bucket, downloader->region);
-    struct aws_http_header host_header = {
-        .name = aws_byte_cursor_from_c_str("Host"),
-        .value = aws_byte_cursor_from_c_str(host_value),
-    };
-    aws_http_message_add_header(message, host_header);
-
-    // Create meta request options for HEAD
-    struct aws_s3_meta_request_options request_options = {
-        .type = AWS_S3_META_REQUEST_TYPE_DEFAULT,
-        .operation_name = aws_byte_cursor_from_c_str("HeadObject"),
-        .message = message,
-        .user_data = ctx,
-        .headers_callback = s3_get_headers_callback,
-        .finish_callback = s3_get_finish_callback,
-    };
-
-    // Make the request
-    ctx->meta_request = aws_s3_client_make_meta_request(downloader->s3_client, &request_options);
-    aws_http_message_release(message);
-    aws_byte_buf_clean_up(&path_buf);
+    source_request_release(ctx->request);
+    return 0;
+}
 
-    if (!ctx->meta_request) {
-        fprintf(stderr, "Error: Failed to create meta request: %s\n",
-                aws_error_debug_str(aws_last_error()));
-        get_request_context_destroy(ctx);
+// Get object size from the Content-Range of a one-byte suffix request
+int burst_downloader_get_object_size(struct burst_downloader *downloader) {
+    if (!downloader || !downloader->source) {
+        fprintf(stderr, "Error: Invalid downloader\n");
         return -1;
     }
 
-    // Wait for completion (60 second timeout)
-    uint64_t timeout_ns = 60 * 1000 * 1000 * 1000ULL;
-    if (!wait_for_completion(ctx, timeout_ns)) {
-        fprintf(stderr, "Error: HEAD request timed out\n");
-        aws_s3_meta_request_release(ctx->meta_request);
-        get_request_context_destroy(ctx);
+    // Create request context
+    struct get_request_context *ctx = get_request_context_new(downloader);
+    if (!ctx) {
+        fprintf(stderr, "Error: Failed to allocate request context\n");
         return -1;
     }
 
-    // Check for errors
-    if (ctx->error_code != 0) {
-        fprintf(stderr, "Error: %s\n", ctx->error_message);
-        aws_s3_meta_request_release(ctx->meta_request);
+    // Wait for completion (60 second timeout)
+    if (run_get_request(ctx, 0, 0, 1, 60 * 1000 * 1000 * 1000ULL, "Size") != 0) {
         get_request_context_destroy(ctx);
         return -1;
     }
 
-    // Store object size (from Content-Length or Content-Range)
-    downloader->object_size = ctx->total_size > 0 ? ctx->total_size : ctx->content_length;
+    // Store object size
+    downloader->object_size = ctx->total_size;
 
     // Clean up
-    aws_s3_meta_request_release(ctx->meta_request);
     get_request_context_destroy(ctx);
 
     return 0;
@@ -319,7 +265,7 @@ int burst_downloader_test_range_get(
     uint8_t **out_buffer,
     size_t *out_size
 ) {
-    if (!downloader || !downloader->s3_client || !out_buffer || !out_size) {
+    if (!downloader || !downloader->source || !out_buffer || !out_size) {
         fprintf(stderr, "Error: Invalid parameters\n");
         return -1;
     }
@@ -331,81 +277,8 @@ int burst_downloader_test_range_get(
         return -1;
     }
 
-    // Build HTTP message for GET request
-    struct aws_http_message *message = aws_http_message_new_request(downloader->allocator);
-    if (!message) {
-        fprintf(stderr, "Error: Failed to create HTTP message\n");
-        get_request_context_destroy(ctx);
-        return -1;
-    }
-
-    // Set method to GET
-    aws_http_message_set_request_method(message, aws_http_method_get);
-
-    // Set path: /KEY
-    struct aws_byte_buf path_buf;
-    aws_byte_buf_init(&path_buf, downloader->allocator, strlen(downloader->key) + 2);
-    aws_byte_buf_append_byte_dynamic(&path_buf, '/');
-    struct aws_byte_cursor key_cursor = aws_byte_cursor_from_c_str(downloader->key);
-    aws_byte_buf_append_dynamic(&path_buf, &key_cursor);
-    struct aws_byte_cursor path_cursor = aws_byte_cursor_from_buf(&path_buf);
-    aws_http_message_set_request_path(message, path_cursor);
-
-    // Set Host header: BUCKET.s3.REGION.amazonaws.com
-    char host_value[256];
-    snprintf(host_value, sizeof(host_value), "%s.s3.%s.amazonaws.com",
-             downloader->bucket, downloader->region);
-    struct aws_http_header host_header = {
-        .name = aws_byte_cursor_from_c_str("Host"),
-        .value = aws_byte_cursor_from_c_str(host_value),
-    };
-    aws_http_message_add_header(message, host_header);
-
-    // Set Range header: bytes=START-END
-    char range_value[128];
-    snprintf(range_value, sizeof(range_value), "bytes=%llu-%llu",
-             (unsigned long long)start, (unsigned long long)end);
-    struct aws_http_header range_header = {
-        .name = aws_byte_cursor_from_c_str("Range"),
-        .value = aws_byte_cursor_from_c_str(range_value),
-    };
-    aws_http_message_add_header(message, range_header);
-
-    // Create meta request options for GET
-    struct aws_s3_meta_request_options request_options = {
-        .type = AWS_S3_META_REQUEST_TYPE_GET_OBJECT,
-        .message = message,
-        .user_data = ctx,
-        .headers_callback = s3_get_headers_callback,
-        .body_callback = s3_get_body_callback,
-        .finish_callback = s3_get_finish_callback,
-    };
-
-    // Make the request
-    ctx->meta_request = aws_s3_client_make_meta_request(downloader->s3_client, &request_options);
-    aws_http_message_release(message);
-    aws_byte_buf_clean_up(&path_buf);
-
-    if (!ctx->meta_request) {
-        fprintf(stderr, "Error: Failed to create meta request: %s\n",
-                aws_error_debug_str(aws_last_error()));
-        get_request_context_destroy(ctx);
-        return -1;
-    }
-
     // Wait for completion (60 second timeout)
-    uint64_t timeout_ns = 60 * 1000 * 1000 * 1000ULL;
-    if (!wait_for_completion(ctx, timeout_ns)) {
-        fprintf(stderr, "Error: GET request timed out\n");
-        aws_s3_meta_request_release(ctx->meta_request);
-        get_request_context_destroy(ctx);
-        return -1;
-    }
-
-    // Check for errors
-    if (ctx->error_code != 0) {
-        fprintf(stderr, "Error: %s\n", ctx->error_message);
-        aws_s3_meta_request_release(ctx->meta_request);
+    if (run_get_request(ctx, start, end, 0, 60 * 1000 * 1000 * 1000ULL, "GET") != 0) {
         get_request_context_destroy(ctx);
         return -1;
     }
@@ -419,7 +292,6 @@ int burst_downloader_test_range_get(
     ctx->buffer_capacity = 0;
 
     // Clean up
-    aws_s3_meta_request_release(ctx->meta_request);
     get_request_context_destroy(ctx);
 
     return 0;
@@ -437,7 +309,7 @@ int burst_downloader_fetch_cd_part(
     uint64_t *out_start_offset,
     uint64_t *out_total_size
 ) {
-    if (!downloader || !downloader->s3_client || !out_buffer || !out_size ||
+    if (!downloader || !downloader->source || !out_buffer || !out_size ||
         !out_start_offset || !out_total_size) {
         fprintf(stderr, "Error: Invalid parameters\n");
         return -1;
@@ -450,78 +322,9 @@ int burst_downloader_fetch_cd_part(
         return -1;
     }
 
-    // Build HTTP message for GET request
-    struct aws_http_message *message = aws_http_message_new_request(downloader->allocator);
-    if (!message) {
-        fprintf(stderr, "Error: Failed to create HTTP message\n");
-        get_request_context_destroy(ctx);
-        return -1;
-    }
-
-    // Set method to GET
-    aws_http_message_set_request_method(message, aws_http_method_get);
-
-    // Set path: /KEY
-    struct aws_byte_buf path_buf;
-    aws_byte_buf_init(&path_buf, downloader->allocator, strlen(downloader->key) + 2);
-    aws_byte_buf_append_byte_dynamic(&path_buf, '/');
-    struct aws_byte_cursor key_cursor = aws_byte_cursor_from_c_str(downloader->key);
-    aws_byte_buf_append_dynamic(&path_buf, &key_cursor);
-    struct aws_byte_cursor path_cursor = aws_byte_cursor_from_buf(&path_buf);
-    aws_http_message_set_request_path(message, path_cursor);
-
-    // Set Host header: BUCKET.s3.REGION.amazonaws.com
-    char host_value[256];
-    snprintf(host_value, sizeof(host_value), "%s.s3.%s.amazonaws.com",
-             downloader->bucket, downloader->region);
-    struct aws_http_header host_header = {
-        .name = aws_byte_cursor_from_c_str("Host"),
-        .value = aws_byte_cursor_from_c_str(host_value),
-    };
-    aws_http_message_add_header(message, host_header);
-
-    // Set Range header using suffix-length syntax: bytes=-8388608 (last 8 MiB)
-    struct aws_http_header range_header = {
-        .name = aws_byte_cursor_from_c_str("Range"),
-        .value = aws_byte_cursor_from_c_str("bytes=-8388608"),
-    };
-    aws_http_message_add_header(message, range_header);
-
-    // Create meta request options for GET
-    struct aws_s3_meta_request_options request_options = {
-        .type = AWS_S3_META_REQUEST_TYPE_GET_OBJECT,
-        .message = message,
-        .user_data = ctx,
-        .headers_callback = s3_get_headers_callback,
-        .body_callback = s3_get_body_callback,
-        .finish_callback = s3_get_finish_callback,
-    };
-
-    // Make the request
-    ctx->meta_request = aws_s3_client_make_meta_request(downloader->s3_client, &request_options);
-    aws_http_message_release(message);
-    aws_byte_buf_clean_up(&path_buf);
-
-    if (!ctx->meta_request) {
-        fprintf(stderr, "Error: Failed to create meta request: %s\n",
-                aws_error_debug_str(aws_last_error()));
-        get_request_context_destroy(ctx);
-        return -1;
-    }
-
-    // Wait for completion (120 second timeout for potentially large download)
-    uint64_t timeout_ns = 120ULL * 1000 * 1000 * 1000;
-    if (!wait_for_completion(ctx, timeout_ns)) {
-        fprintf(stderr, "Error: CD fetch request timed out\n");
-        aws_s3_meta_request_release(ctx->meta_request);
-        get_request_context_destroy(ctx);
-        return -1;
-    }
-
-    // Check for errors
-    if (ctx->error_code != 0) {
-        fprintf(stderr, "Error: %s\n", ctx->error_message);
-        aws_s3_meta_request_release(ctx->meta_request);
+    // Suffix-length syntax: bytes=-8388608 (last 8 MiB, or the whole archive if smaller).
+    // 120 second timeout for potentially large download.
+    if (run_get_request(ctx, 0, 0, 8388608, 120ULL * 1000 * 1000 * 1000, "CD fetch") != 0) {
         get_request_context_destroy(ctx);
         return -1;
     }
@@ -531,13 +334,13 @@ int burst_downloader_fetch_cd_part(
     *out_size = ctx->buffer_size;
     *out_start_offset = ctx->range_start;
     *out_total_size = ctx->total_size;
+    memcpy(downloader->etag, ctx->etag, sizeof(downloader->etag));
 
     // Don't free the buffer - caller owns it now
     ctx->buffer = NULL;
     ctx->buffer_capacity = 0;
 
     // Clean up
-    aws_s3_meta_request_release(ctx->meta_request);
     get_request_context_destroy(ctx);
 
     return 0;
@@ -559,13 +362,29 @@ struct stream_part_context {
     int error_code;
     char error_message[256];
 
-    // Meta request handle
-    struct aws_s3_meta_request *meta_request;
+    // Request handle
+    struct source_request *request;
 
     // Coordinator reference
     struct download_coordinator *coordinator;
     uint32_t part_index;
 
+    // Body data is processed on an I/O worker, in order
+    struct io_stream *io;
+    struct source_request *window_request;  // Read window opened as chunks are written
+    int source_error_code;  // From the finish callback, for the I/O worker
+    int response_status;  // HTTP status of the current request, 0 until headers arrive
+
+    // Retries of a request that failed part-way
+    uint32_t retries;
+    uint64_t resume_offset;  // Archive offset the next request starts at
+    struct aws_task retry_task;
+
+    // Progress of the current request, to hedge it if it straggles
+    struct hedge_candidate hedge;
+    uint64_t first_sent_ns;  // When the part's first request started
+    bool done;  // Counted by complete_part()
+
 #ifdef BURST_PROFILE
     // Profiling: track time spent in request vs callbacks
     uint64_t request_start_ns;      // When request was initiated
@@ -582,9 +401,10 @@ struct download_coordinator {
     // Concurrency control
     size_t max_concurrent;
     size_t parts_in_flight;
-    size_t next_part_to_start;
+    size_t next_part_to_start;  // Index into part_order
     size_t total_parts;
     size_t parts_to_download;  // May be < total_parts if final part comes from CD buffer
+    const uint32_t *part_order;  // The parts_to_download parts requested from S3, in dispatch order
 
     // Completion tracking
     size_t parts_completed;
@@ -600,8 +420,18 @@ struct download_coordinator {
 
     // Per-part contexts (array of size total_parts)
     struct stream_part_context **part_contexts;
+
+    // Straggler hedging once no parts are left to start
+    double *part_rates;  // Bytes per second of each finished part
+    size_t num_part_rates;
+    struct hedge_candidate **hedge_candidates;  // Scratch, one per part
 };
 
+static int process_part_chunk(void *user_data, const uint8_t *data, size_t len);
+static void finish_part(void *user_data, int rc);
+static void complete_part(struct stream_part_context *ctx);
+static int send_part_request(struct stream_part_context *ctx);
+
 // Initialize stream context
 static struct stream_part_context *stream_part_context_new(
     struct burst_downloader *downloader,
@@ -623,6 +453,12 @@ static struct stream_part_context *stream_part_context_new(
     ctx->coordinator = coordinator;
     ctx->part_index = part_index;
 
+    ctx->io = io_stream_create(downloader->io_pool, process_part_chunk, finish_part, ctx);
+    if (!ctx->io) {
+        aws_mem_release(downloader->allocator, ctx);
+        return NULL;
+    }
+
     return ctx;
 }
 
@@ -632,63 +468,70 @@ static void stream_part_context_destroy(struct stream_part_context *ctx) {
         return;
     }
 
+    io_stream_destroy(ctx->io);
     aws_mem_release(ctx->downloader->allocator, ctx);
 }
 
-// Streaming body callback - feeds chunks directly to stream processor
-static int s3_stream_body_callback(
-    struct aws_s3_meta_request *meta_request,
-    const struct aws_byte_cursor *body,
-    uint64_t range_start,
+// Feed one chunk of body data to the stream processor (runs on an I/O worker)
+static int process_part_chunk(void *user_data, const uint8_t *data, size_t len) {
+    struct stream_part_context *ctx = user_data;
+
+    int rc = part_processor_process_data(ctx->processor, data, len);
+    if (rc != STREAM_PROC_SUCCESS) {
+        ctx->error_code = rc;
+        snprintf(ctx->error_message, sizeof(ctx->error_message),
+                 "Stream processor error: %s", part_processor_get_error(ctx->processor));
+        return rc;
+    }
+
+    // Written to disk, so the request may receive another len bytes
+    source_request_open_window(ctx->window_request, len);
+
+    return 0;
+}
+
+// Streaming body callback - hands chunks to the part's I/O stream
+static int stream_body_callback(
+    struct source_request *request,
+    const uint8_t *data,
+    size_t len,
     void *user_data
 ) {
-    (void)meta_request;
-    (void)range_start;
-
     struct stream_part_context *ctx = user_data;
+    ctx->window_request = request;
 
 #ifdef BURST_PROFILE
     uint64_t cb_start = burst_profile_get_time_ns();
-    ctx->bytes_received += body->len;
+    ctx->bytes_received += len;
 #endif
 
-    // Feed chunk directly to stream processor
-    int rc = part_processor_process_data(ctx->processor, body->ptr, body->len);
+    // Copy the chunk for an I/O worker; the event loop goes back to networking
+    int rc = io_stream_submit(ctx->io, data, len);
 
 #ifdef BURST_PROFILE
     ctx->callback_time_ns += burst_profile_get_time_ns() - cb_start;
 #endif
 
-    if (rc != STREAM_PROC_SUCCESS) {
-        ctx->error_code = rc;
-        snprintf(ctx->error_message, sizeof(ctx->error_message),
-                 "Stream processor error: %s", part_processor_get_error(ctx->processor));
-        return AWS_OP_ERR;  // Abort request
+    if (rc != 0) {
+        return -1;  // Abort request: processing already failed for this part
     }
 
-    return AWS_OP_SUCCESS;
+    return 0;
 }
 
 // Streaming headers callback - just check HTTP status
-static int s3_stream_headers_callback(
-    struct aws_s3_meta_request *meta_request,
-    const struct aws_http_headers *headers,
-    int response_status,
-    void *user_data
-) {
-    (void)meta_request;
-    (void)headers;
-
+static int stream_headers_callback(const struct source_response *response, void *user_data) {
     struct stream_part_context *ctx = user_data;
+    ctx->response_status = response->status;
 
     // Check HTTP status
-    if (response_status < 200 || response_status >= 300) {
+    if (response->status < 200 || response->status >= 300) {
         snprintf(ctx->error_message, sizeof(ctx->error_message),
-                "HTTP error: status code %d", response_status);
+                "HTTP error: status code %d", response->status);
         ctx->error_code = -1;
     }
 
-    return AWS_OP_SUCCESS;
+    return 0;
 }
 
 // Forward declaration for starting next part
@@ -697,26 +540,115 @@ static int start_part_download_async(
     uint32_t part_index
 );
 
-// Streaming finish callback - handles both blocking and coordinator modes
-static void s3_stream_finish_callback(
-    struct aws_s3_meta_request *meta_request,
-    const struct aws_s3_meta_request_result *result,
-    void *user_data
-) {
-    (void)meta_request;
+// Streaming finish callback - queues the end of the part behind its body data
+static void stream_finish_callback(int error_code, int response_status, void *user_data) {
+    (void)response_status;
 
     struct stream_part_context *ctx = user_data;
-    struct download_coordinator *coord = ctx->coordinator;
+    ctx->source_error_code = error_code;
 
 #ifdef BURST_PROFILE
-    uint64_t finish_cb_start = burst_profile_get_time_ns();
+    // Calculate and record S3 network time = total request time - callback processing time
+    uint64_t total_request_time = burst_profile_get_time_ns() - ctx->request_start_ns;
+    uint64_t network_time = (total_request_time > ctx->callback_time_ns) ?
+                            (total_request_time - ctx->callback_time_ns) : 0;
+    PROFILE_ADD(g_profile_stats.s3_time_ns, network_time);
+    PROFILE_COUNT(g_profile_stats.s3_requests);
+    PROFILE_ADD(g_profile_stats.s3_bytes, ctx->bytes_received);
 #endif
 
+    // finish_part() runs on the I/O worker once the part's data is written
+    io_stream_finish(ctx->io);
+}
+
+// Event loop task: re-request the rest of a part after its backoff delay
+static void retry_part_task(struct aws_task *task, void *arg, enum aws_task_status status) {
+    (void)task;
+    struct stream_part_context *ctx = arg;
+
+    if (status == AWS_TASK_STATUS_RUN_READY && send_part_request(ctx) == 0) {
+        return;
+    }
+
+    ctx->error_code = -1;
+    snprintf(ctx->error_message, sizeof(ctx->error_message),
+             "Failed to restart part %u download", ctx->part_index);
+    complete_part(ctx);
+}
+
+// Schedule another request for the rest of a part whose request failed
+// part-way. Returns -1 if the failure is not worth retrying.
+static int schedule_part_retry(struct stream_part_context *ctx) {
+    struct download_coordinator *coord = ctx->coordinator;
+
+    // Retries wait on an event loop, which a local file source has none of
+    if (!coord || !ctx->downloader->event_loop_group || ctx->retries >= BURST_PART_MAX_RETRIES ||
+        !part_failure_is_transient(ctx->response_status)) {
+        return -1;
+    }
+
+    aws_mutex_lock(&coord->mutex);
+    bool cancelled = coord->cancel_requested;
+    if (!cancelled) {
+        // Finished; the fail-fast loop must not cancel it again
+        source_request_release(ctx->request);
+        ctx->request = NULL;
+        ctx->hedge.request = NULL;
+    }
+    aws_mutex_unlock(&coord->mutex);
+    if (cancelled || io_stream_reopen(ctx->io) != 0) {
+        return -1;
+    }
+
+    ctx->retries++;
+    ctx->resume_offset = part_processor_rewind(ctx->processor);
+    uint64_t delay_ms = calculate_retry_delay_ms(ctx->retries, (uint32_t)rand());
+    fprintf(stderr, "Warning: part %u: %s; resuming at offset %llu in %llu ms (retry %u/%d)\n",
+            ctx->part_index, ctx->error_message, (unsigned long long)ctx->resume_offset,
+            (unsigned long long)delay_ms, ctx->retries, BURST_PART_MAX_RETRIES);
+
+    ctx->error_code = 0;
+    ctx->error_message[0] = '\0';
+    ctx->source_error_code = 0;
+    ctx->response_status = 0;
+
+    struct aws_event_loop *loop =
+        aws_event_loop_group_get_next_loop(ctx->downloader->event_loop_group);
+    uint64_t now_ns = 0;
+    aws_event_loop_current_clock_time(loop, &now_ns);
+    aws_task_init(&ctx->retry_task, retry_part_task, ctx, "burst_part_retry");
+    aws_event_loop_schedule_task_future(loop, &ctx->retry_task, now_ns + delay_ms * 1000000ULL);
+    return 0;
+}
+
+// Finalize a part and coordinate with other parts (runs on an I/O worker
+// after all of the part's body data has been processed)
+static void finish_part(void *user_data, int rc) {
+    struct stream_part_context *ctx = user_data;
+
     // Record error in context
-    if (result->error_code != AWS_ERROR_SUCCESS && ctx->error_code == 0) {
-        ctx->error_code = result->error_code;
+    if (ctx->source_error_code != 0 && ctx->error_code == 0) {
+        ctx->error_code = ctx->source_error_code;
+        snprintf(ctx->error_message, sizeof(ctx->error_message), "Request failed: %s",
+                 archive_source_error_str(ctx->downloader->source, ctx->source_error_code));
+    }
+    if (rc != 0 && ctx->error_code == 0) {
+        ctx->error_code = rc;
         snprintf(ctx->error_message, sizeof(ctx->error_message),
-                "S3 request failed: %s", aws_error_debug_str(result->error_code));
+                 "Failed to process part %u", ctx->part_index);
+    }
+
+    // A request that failed part-way continues where the processor stopped
+    if (rc == 0 && ctx->error_code != 0) {
+        uint64_t part_end = (uint64_t)(ctx->part_index + 1) * ctx->downloader->part_size;
+        if (ctx->processor->state == STATE_DONE ||
+            ctx->processor->part_start_offset + ctx->processor->bytes_processed >= part_end) {
+            // Failed after the part's last frame: nothing is missing
+            ctx->error_code = 0;
+            ctx->error_message[0] = '\0';
+        } else if (schedule_part_retry(ctx) == 0) {
+            return;
+        }
     }
 
     // Finalize the processor for this part (if no error)
@@ -729,25 +661,97 @@ static void s3_stream_finish_callback(
                     ctx->part_index, part_processor_get_error(ctx->processor));
         }
     }
+    if (ctx->error_code == 0 && ctx->downloader->journal) {
+        restore_journal_record(ctx->downloader->journal, ctx->part_index);
+    }
 
-#ifdef BURST_PROFILE
-    // Add finish callback processing time to callback time
-    ctx->callback_time_ns += burst_profile_get_time_ns() - finish_cb_start;
+    complete_part(ctx);
+}
 
-    // Calculate and record S3 network time = total request time - callback processing time
-    uint64_t total_request_time = burst_profile_get_time_ns() - ctx->request_start_ns;
-    uint64_t network_time = (total_request_time > ctx->callback_time_ns) ?
-                            (total_request_time - ctx->callback_time_ns) : 0;
-    PROFILE_ADD(g_profile_stats.s3_time_ns, network_time);
-    PROFILE_COUNT(g_profile_stats.s3_requests);
-    PROFILE_ADD(g_profile_stats.s3_bytes, ctx->bytes_received);
+// Start parts in dispatch order until the target number is in flight (called
+// with the mutex held; released while each one starts)
+static void start_parts(struct download_coordinator *coord, bool announce) {
+    while (!coord->cancel_requested && coord->parts_in_flight < coord->max_concurrent) {
+        if (coord->next_part_to_start >= coord->parts_to_download) {
+            break;
+        }
+        uint32_t next = coord->part_order[coord->next_part_to_start++];
+        coord->parts_in_flight++;
+        aws_mutex_unlock(&coord->mutex);
+
+        // Start download for next part (outside mutex)
+        if (announce) {
+            printf("Starting part %u/%zu from S3...\n", next + 1, coord->total_parts);
+        }
+        int rc = start_part_download_async(coord, next);
+        aws_mutex_lock(&coord->mutex);
+        if (rc != 0) {
+            // Failed to start - decrement in_flight and mark error
+            coord->parts_in_flight--;
+            if (!coord->cancel_requested) {
+                coord->cancel_requested = true;
+                coord->first_error_code = -1;
+                snprintf(coord->first_error_message, sizeof(coord->first_error_message),
+                         "Failed to start part %u download", next);
+            }
+        }
+    }
+}
+
+size_t burst_downloader_adapt_concurrency(struct burst_downloader *downloader, uint32_t part_index) {
+    struct concurrency_controller *ctl = downloader->concurrency;
+    if (!ctl) {
+        return downloader->max_concurrent_parts;
+    }
+
+    // The part's request ends at the part boundary or the end of the archive
+    uint64_t part_start = (uint64_t)part_index * downloader->part_size;
+    uint64_t part_bytes = downloader->part_size;
+    if (downloader->object_size > part_start && downloader->object_size - part_start < part_bytes) {
+        part_bytes = downloader->object_size - part_start;
+    }
+    downloader->concurrency_bytes_done += part_bytes;
+    downloader->concurrency_parts_done++;
+
+    struct io_pool_stats io;
+    io_pool_get_stats(downloader->io_pool, &io);
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    size_t before = ctl->target;
+    struct concurrency_sample sample = {
+        .now_ns = (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec,
+        .bytes_done = downloader->concurrency_bytes_done,
+        .parts_done = downloader->concurrency_parts_done,
+        .io_busy_ns = io.busy_ns,
+        // No more workers can be busy than there are parts in flight
+        .io_threads = io.num_threads < before ? io.num_threads : before,
+        .io_queued_bytes = io.queued_bytes,
+        .io_queue_limit = (uint64_t)before * downloader->read_window,
+    };
+    size_t target = concurrency_controller_update(ctl, &sample);
+    if (target != before) {
+        PROFILE_COUNT(g_profile_stats.concurrency_adjustments);
+        printf("Concurrent parts: %zu -> %zu (%.1f MB/s)\n", before, target,
+               ctl->last_throughput / (1024.0 * 1024.0));
+    }
+#ifdef BURST_PROFILE
+    atomic_store(&g_profile_stats.concurrency_final_parts, target);
 #endif
+    return target;
+}
+
+// Count a part as done, stopping the others if it failed, and start the next
+// ones until the target number of parts is in flight
+static void complete_part(struct stream_part_context *ctx) {
+    struct download_coordinator *coord = ctx->coordinator;
 
     // If using coordinator (async mode), coordinate with other parts
     if (coord) {
         aws_mutex_lock(&coord->mutex);
 
         coord->parts_in_flight--;
+        ctx->done = true;
 
         // Check for errors and implement fail-fast
         if (ctx->error_code != 0) {
@@ -763,42 +767,25 @@ static void s3_stream_finish_callback(
                 for (size_t i = 0; i < coord->total_parts; i++) {
                     if (coord->part_contexts[i] &&
                         coord->part_contexts[i] != ctx &&
-                        coord->part_contexts[i]->meta_request) {
-                        aws_s3_meta_request_cancel(coord->part_contexts[i]->meta_request);
+                        coord->part_contexts[i]->request) {
+                        source_request_cancel(coord->part_contexts[i]->request);
                     }
                 }
             }
         } else {
             coord->parts_completed++;
-        }
-
-        // Start next part if available and not cancelled
-        if (!coord->cancel_requested &&
-            coord->next_part_to_start < coord->parts_to_download) {
-            uint32_t next = (uint32_t)coord->next_part_to_start++;
-            coord->parts_in_flight++;
-            aws_mutex_unlock(&coord->mutex);
-
-            // Start download for next part (outside mutex)
-            if (start_part_download_async(coord, next) != 0) {
-                // Failed to start - decrement in_flight and mark error
-                aws_mutex_lock(&coord->mutex);
-                coord->parts_in_flight--;
-                if (!coord->cancel_requested) {
-                    coord->cancel_requested = true;
-                    coord->first_error_code = -1;
-                    snprintf(coord->first_error_message, sizeof(coord->first_error_message),
-                             "Failed to start part %u download", next);
-                }
-                // Signal if all done
-                if (coord->parts_in_flight == 0) {
-                    aws_condition_variable_notify_one(&coord->cv);
-                }
-                aws_mutex_unlock(&coord->mutex);
+            coord->max_concurrent = burst_downloader_adapt_concurrency(coord->downloader,
+                                                                       ctx->part_index);
+            uint64_t elapsed_ns = part_hedge_now_ns() - ctx->first_sent_ns;
+            if (elapsed_ns > 0) {
+                coord->part_rates[coord->num_part_rates++] =
+                    (double)ctx->downloader->part_size * 1e9 / (double)elapsed_ns;
             }
-            return;
         }
 
+        // One part to replace this one, or more or none when the target changed
+        start_parts(coord, false);
+
         // Signal if all parts done
         if (coord->parts_in_flight == 0) {
             aws_condition_variable_notify_one(&coord->cv);
@@ -808,6 +795,91 @@ static void s3_stream_finish_callback(
     }
 }
 
+// Once no parts are left to start, duplicate the requests of parts that fell
+// far behind the others into the idle slots (called with the mutex held)
+static void hedge_stragglers(struct download_coordinator *coord) {
+    if (coord->cancel_requested || coord->next_part_to_start < coord->parts_to_download) {
+        return;
+    }
+
+    // A hedged part takes a second slot
+    size_t busy = coord->parts_in_flight;
+    size_t count = 0;
+    for (size_t i = 0; i < coord->total_parts; i++) {
+        struct stream_part_context *ctx = coord->part_contexts[i];
+        if (!ctx || ctx->done) {
+            continue;
+        }
+        if (ctx->hedge.hedged) {
+            busy++;
+        }
+        coord->hedge_candidates[count++] = &ctx->hedge;
+    }
+    if (busy >= coord->max_concurrent || count == 0) {
+        return;
+    }
+
+    double median_rate = part_hedge_median_rate(coord->part_rates, coord->num_part_rates);
+    part_hedge_stragglers(coord->hedge_candidates, count, median_rate, part_hedge_now_ns(),
+                          coord->max_concurrent - busy);
+}
+
+// Request the part's bytes from ctx->resume_offset to its end
+static int send_part_request(struct stream_part_context *ctx) {
+    struct burst_downloader *downloader = ctx->downloader;
+    uint32_t part_index = ctx->part_index;
+
+    // Calculate byte range for this part
+    uint64_t start = ctx->resume_offset;
+    uint64_t end = (uint64_t)part_index * downloader->part_size + downloader->part_size - 1;
+
+    struct source_request_options options = {
+        .start = start,
+        .end = end,
+        // Only from the object version the central directory came from
+        .if_match = downloader->etag,
+        .headers = stream_headers_callback,
+        .body = stream_body_callback,
+        .finish = stream_finish_callback,
+        .user_data = ctx,
+    };
+
+#ifdef BURST_PROFILE
+    // Record request start time for S3 timing calculation
+    ctx->request_start_ns = burst_profile_get_time_ns();
+    ctx->callback_time_ns = 0;
+    ctx->bytes_received = 0;
+#endif
+
+    // Make the request (returns immediately). The mutex is held until the
+    // request is published, so a fail-fast from another part can cancel it
+    // and its own completion (which takes the mutex) cannot overtake it.
+    struct download_coordinator *coord = ctx->coordinator;
+    aws_mutex_lock(&coord->mutex);
+    struct source_request *request =
+        hedged_request_start(downloader->source, downloader->prefetch, &options);
+    if (!request) {
+        aws_mutex_unlock(&coord->mutex);
+        fprintf(stderr, "Error: Failed to start request for part %u\n", part_index);
+        return -1;
+    }
+    ctx->request = request;
+    ctx->hedge = (struct hedge_candidate){
+        .request = request,
+        .sent_ns = part_hedge_now_ns(),
+        .part_index = part_index,
+    };
+    if (ctx->first_sent_ns == 0) {
+        ctx->first_sent_ns = ctx->hedge.sent_ns;
+    }
+    if (coord->cancel_requested) {
+        source_request_cancel(request);
+    }
+    aws_mutex_unlock(&coord->mutex);
+
+    return 0;
+}
+
 // Start async download for a single part (helper for coordinator)
 static int start_part_download_async(
     struct download_coordinator *coord,
@@ -832,81 +904,12 @@ static int start_part_download_async(
         part_processor_destroy(processor);
         return -1;
     }
+    ctx->resume_offset = (uint64_t)part_index * downloader->part_size;
 
     // Store context in coordinator
     coord->part_contexts[part_index] = ctx;
 
-    // Calculate byte range for this part
-    uint64_t start = (uint64_t)part_index * downloader->part_size;
-    uint64_t end = start + downloader->part_size - 1;
-
-    // Build HTTP message for GET request
-    struct aws_http_message *message = aws_http_message_new_request(downloader->allocator);
-    if (!message) {
-        fprintf(stderr, "Error: Failed to create HTTP message for part %u\n", part_index);
-        coord->part_contexts[part_index] = NULL;
-        part_processor_destroy(processor);
-        stream_part_context_destroy(ctx);
-        return -1;
-    }
-
-    // Set method to GET
-    aws_http_message_set_request_method(message, aws_http_method_get);
-
-    // Set path: /KEY
-    struct aws_byte_buf path_buf;
-    aws_byte_buf_init(&path_buf, downloader->allocator, strlen(downloader->key) + 2);
-    aws_byte_buf_append_byte_dynamic(&path_buf, '/');
-    struct aws_byte_cursor key_cursor = aws_byte_cursor_from_c_str(downloader->key);
-    aws_byte_buf_append_dynamic(&path_buf, &key_cursor);
-    struct aws_byte_cursor path_cursor = aws_byte_cursor_from_buf(&path_buf);
-    aws_http_message_set_request_path(message, path_cursor);
-
-    // Set Host header
-    char host_value[256];
-    snprintf(host_value, sizeof(host_value), "%s.s3.%s.amazonaws.com",
-             downloader->bucket, downloader->region);
-    struct aws_http_header host_header = {
-        .name = aws_byte_cursor_from_c_str("Host"),
-        .value = aws_byte_cursor_from_c_str(host_value),
-    };
-    aws_http_message_add_header(message, host_header);
-
-    // Set Range header
-    char range_value[128];
-    snprintf(range_value, sizeof(range_value), "bytes=%llu-%llu",
-             (unsigned long long)start, (unsigned long long)end);
-    struct aws_http_header range_header = {
-        .name = aws_byte_cursor_from_c_str("Range"),
-        .value = aws_byte_cursor_from_c_str(range_value),
-    };
-    aws_http_message_add_header(message, range_header);
-
-    // Create meta request options
-    struct aws_s3_meta_request_options request_options = {
-        .type = AWS_S3_META_REQUEST_TYPE_GET_OBJECT,
-        .message = message,
-        .user_data = ctx,
-        .headers_callback = s3_stream_headers_callback,
-        .body_callback = s3_stream_body_callback,
-        .finish_callback = s3_stream_finish_callback,
-    };
-
-#ifdef BURST_PROFILE
-    // Record request start time for S3 timing calculation
-    ctx->request_start_ns = burst_profile_get_time_ns();
-    ctx->callback_time_ns = 0;
-    ctx->bytes_received = 0;
-#endif
-
-    // Make the request (returns immediately)
-    ctx->meta_request = aws_s3_client_make_meta_request(downloader->s3_client, &request_options);
-    aws_http_message_release(message);
-    aws_byte_buf_clean_up(&path_buf);
-
-    if (!ctx->meta_request) {
-        fprintf(stderr, "Error: Failed to create meta request for part %u: %s\n",
-                part_index, aws_error_debug_str(aws_last_error()));
+    if (send_part_request(ctx) != 0) {
         coord->part_contexts[part_index] = NULL;
         part_processor_destroy(processor);
         stream_part_context_destroy(ctx);
@@ -1014,6 +1017,133 @@ static int process_part_with_body_data(
     return result;
 }
 
+// Work on a range of files[] (stream_processor_materialize_entries() and
+// stream_processor_apply_metadata())
+typedef int (*entry_range_fn)(struct central_dir_parse_result *cd_result,
+                              const char *output_dir, size_t first, size_t count);
+
+// One slice of files[] for run_entry_slices(). The range is queued as the
+// stream's only chunk.
+struct entry_slice {
+    entry_range_fn fn;
+    struct central_dir_parse_result *cd_result;
+    const char *output_dir;
+    int rc;
+};
+
+struct entry_range {
+    size_t first;
+    size_t count;
+};
+
+static int entry_slice_chunk(void *user_data, const uint8_t *data, size_t len) {
+    struct entry_slice *slice = user_data;
+    struct entry_range range;
+    if (len != sizeof(range)) {
+        return -1;
+    }
+    memcpy(&range, data, sizeof(range));
+    return slice->fn(slice->cd_result, slice->output_dir, range.first, range.count);
+}
+
+static void entry_slice_done(void *user_data, int rc) {
+    struct entry_slice *slice = user_data;
+    slice->rc = rc;
+}
+
+// Split files[] into one slice per I/O thread, run fn on each and wait
+static int run_entry_slices(
+    struct burst_downloader *downloader,
+    struct central_dir_parse_result *cd_result,
+    entry_range_fn fn
+) {
+    if (cd_result->num_files == 0) {
+        return 0;
+    }
+
+    size_t num_slices = downloader->io_threads;
+    if (num_slices > cd_result->num_files) {
+        num_slices = cd_result->num_files;
+    }
+
+    struct entry_slice *slices = calloc(num_slices, sizeof(struct entry_slice));
+    struct io_stream **streams = calloc(num_slices, sizeof(struct io_stream *));
+    if (!slices || !streams) {
+        fprintf(stderr, "Error: Failed to allocate entry slices\n");
+        free(slices);
+        free(streams);
+        return -1;
+    }
+
+    // Contiguous slices keep entries of one directory on the same worker
+    int result = 0;
+    size_t first = 0;
+    for (size_t i = 0; i < num_slices; i++) {
+        struct entry_range range = {
+            .first = first,
+            .count = cd_result->num_files / num_slices +
+                     (i < cd_result->num_files % num_slices ? 1 : 0),
+        };
+        first += range.count;
+
+        slices[i] = (struct entry_slice){
+            .fn = fn,
+            .cd_result = cd_result,
+            .output_dir = downloader->output_dir,
+            .rc = -1,
+        };
+        streams[i] = io_stream_create(downloader->io_pool, entry_slice_chunk,
+                                      entry_slice_done, &slices[i]);
+        if (!streams[i] ||
+            io_stream_submit(streams[i], (const uint8_t *)&range, sizeof(range)) != 0) {
+            fprintf(stderr, "Error: Failed to queue entries for the I/O threads\n");
+            result = -1;
+            break;
+        }
+        io_stream_finish(streams[i]);
+    }
+
+    for (size_t i = 0; i < num_slices; i++) {
+        if (!streams[i]) {
+            continue;
+        }
+        io_stream_destroy(streams[i]);
+        if (slices[i].rc != 0) {
+            result = -1;
+        }
+    }
+
+    free(slices);
+    free(streams);
+    return result;
+}
+
+int burst_downloader_materialize_entries(
+    struct burst_downloader *downloader,
+    struct central_dir_parse_result *cd_result
+) {
+    if (!downloader || !cd_result) {
+        return -1;
+    }
+    if (!cd_result->dirs) {
+        return 0;
+    }
+    return run_entry_slices(downloader, cd_result, stream_processor_materialize_entries);
+}
+
+int burst_downloader_apply_metadata(
+    struct burst_downloader *downloader,
+    struct central_dir_parse_result *cd_result
+) {
+    if (!downloader || !cd_result) {
+        return -1;
+    }
+    if (run_entry_slices(downloader, cd_result, stream_processor_apply_metadata) != 0) {
+        return -1;
+    }
+    return stream_processor_apply_directory_metadata(cd_result, downloader->output_dir);
+}
+
 // Extract BURST archive using concurrent part downloads
 int burst_downloader_extract_concurrent(
     struct burst_downloader *downloader,
@@ -1074,9 +1204,29 @@ int burst_downloader_extract_concurrent(
         }
     }
 
+    // Parts left out of the S3 downloads: those covered by body segments and
+    // those an earlier run recorded in the resume journal
+    bool *skip_download = calloc(num_parts, sizeof(bool));
+    if (!skip_download) {
+        fprintf(stderr, "Error: Failed to allocate part tracking array\n");
+        free(part_has_full_body_data);
+        return -1;
+    }
+    size_t parts_resumed = 0;
+    for (size_t p = 0; p < num_parts; p++) {
+        if (restore_journal_has_part(downloader->journal, (uint32_t)p)) {
+            skip_download[p] = true;
+            parts_resumed++;
+            stream_processor_skip_part(cd_result, (uint32_t)p);
+        } else if (part_has_full_body_data[p]) {
+            skip_download[p] = true;
+        }
+    }
+
     // Initialize coordinator
     struct download_coordinator coord = {
-        .max_concurrent = downloader->max_concurrent_parts,
+        .max_concurrent = downloader->concurrency ? downloader->concurrency->target
+                                                  : downloader->max_concurrent_parts,
         .total_parts = num_parts,
         .parts_in_flight = 0,
         .next_part_to_start = 0,
@@ -1094,59 +1244,59 @@ int burst_downloader_extract_concurrent(
     // Allocate part context array
     coord.part_contexts = aws_mem_calloc(
         downloader->allocator, num_parts, sizeof(struct stream_part_context *));
-    if (!coord.part_contexts) {
+    coord.part_rates = calloc(num_parts, sizeof(double));
+    coord.hedge_candidates = calloc(num_parts, sizeof(struct hedge_candidate *));
+    uint32_t *part_order = calloc(num_parts, sizeof(uint32_t));
+    if (!coord.part_contexts || !coord.part_rates || !coord.hedge_candidates || !part_order) {
         fprintf(stderr, "Error: Failed to allocate part context array\n");
+        if (coord.part_contexts) {
+            aws_mem_release(downloader->allocator, coord.part_contexts);
+        }
+        free(coord.part_rates);
+        free(coord.hedge_candidates);
+        free(part_order);
         aws_mutex_clean_up(&coord.mutex);
         aws_condition_variable_clean_up(&coord.cv);
         free(part_has_full_body_data);
+        free(skip_download);
         return -1;
     }
 
-    // Count parts that need S3 download
+    // Parts that need S3 download, the most expensive to restore first and
+    // inode-heavy ones interleaved with byte-heavy ones
     coord.parts_to_download = 0;
     for (size_t p = 0; p < num_parts; p++) {
-        if (!part_has_full_body_data[p]) {
-            coord.parts_to_download++;
+        if (!skip_download[p]) {
+            part_order[coord.parts_to_download++] = (uint32_t)p;
         }
     }
+    part_schedule_order(cd_result, downloader->part_size, part_order, coord.parts_to_download,
+                        downloader->prefetch ? downloader->prefetch_parts : 0);
+    coord.part_order = part_order;
 
-    printf("Parts: %zu total, %zu from S3, %zu from buffer\n",
-           num_parts, coord.parts_to_download, num_parts - coord.parts_to_download);
+    printf("Parts: %zu total, %zu from S3, %zu from buffer, %zu already restored\n",
+           num_parts, coord.parts_to_download,
+           num_parts - coord.parts_to_download - parts_resumed, parts_resumed);
 
-    // Start downloading parts that need S3 data
-    // We iterate through parts in order, skipping those with full body data
+    // Start the first parts that need S3 data
     aws_mutex_lock(&coord.mutex);
-    size_t part_idx = 0;
-    while (coord.parts_in_flight < coord.max_concurrent && part_idx < num_parts) {
-        // Skip parts with full body data
-        while (part_idx < num_parts && part_has_full_body_data[part_idx]) {
-            part_idx++;
-        }
-        if (part_idx >= num_parts) break;
-
-        coord.parts_in_flight++;
-        coord.next_part_to_start = part_idx + 1;  // Track next part to consider
-
-        aws_mutex_unlock(&coord.mutex);
-
-        printf("Starting part %zu/%zu from S3...\n", part_idx + 1, num_parts);
-        if (start_part_download_async(&coord, (uint32_t)part_idx) != 0) {
-            aws_mutex_lock(&coord.mutex);
-            coord.parts_in_flight--;
-            coord.cancel_requested = true;
-            coord.first_error_code = -1;
-            snprintf(coord.first_error_message, sizeof(coord.first_error_message),
-                     "Failed to start part %zu download", part_idx);
-            break;
-        }
+    start_parts(&coord, true);
 
-        aws_mutex_lock(&coord.mutex);
-        part_idx++;
+    // Lay out directories and empty files while the first parts are in flight
+    aws_mutex_unlock(&coord.mutex);
+    int materialize_rc = burst_downloader_materialize_entries(downloader, cd_result);
+    aws_mutex_lock(&coord.mutex);
+    if (materialize_rc != 0 && !coord.cancel_requested) {
+        coord.cancel_requested = true;
+        coord.first_error_code = -1;
+        snprintf(coord.first_error_message, sizeof(coord.first_error_message),
+                 "Failed to create directories and empty files");
     }
 
-    // Wait for S3 downloads to complete
+    // Wait for S3 downloads to complete, hedging stragglers near the end
     while (coord.parts_in_flight > 0) {
-        aws_condition_variable_wait(&coord.cv, &coord.mutex);
+        aws_condition_variable_wait_for(&coord.cv, &coord.mutex, PART_HEDGE_CHECK_INTERVAL_NS);
+        hedge_stragglers(&coord);
     }
     aws_mutex_unlock(&coord.mutex);
 
@@ -1159,8 +1309,9 @@ int burst_downloader_extract_concurrent(
     // Process parts from body segments (after S3 downloads complete)
     if (result == 0 && num_body_segments > 0) {
         for (size_t p = 0; p < num_parts && result == 0; p++) {
-            if (!part_has_full_body_data[p]) {
-                continue;  // This part was downloaded from S3
+            if (!part_has_full_body_data[p] ||
+                restore_journal_has_part(downloader->journal, (uint32_t)p)) {
+                continue;  // Downloaded from S3, or restored by an earlier run
             }
 
             uint64_t part_start = (uint64_t)p * downloader->part_size;
@@ -1170,6 +1321,9 @@ int burst_downloader_extract_concurrent(
             if (seg) {
                 result = process_part_with_body_data(
                     downloader, cd_result, (uint32_t)p, seg, central_dir_offset);
+                if (result == 0 && downloader->journal) {
+                    restore_journal_record(downloader->journal, (uint32_t)p);
+                }
             }
         }
     }
@@ -1177,8 +1331,12 @@ int burst_downloader_extract_concurrent(
     // Cleanup: destroy all part contexts
     for (size_t i = 0; i < num_parts; i++) {
         if (coord.part_contexts[i]) {
-            if (coord.part_contexts[i]->meta_request) {
-                aws_s3_meta_request_release(coord.part_contexts[i]->meta_request);
+            // Wait for the I/O worker to let go of the part before releasing
+            // its request and freeing its processor
+            io_stream_destroy(coord.part_contexts[i]->io);
+            coord.part_contexts[i]->io = NULL;
+            if (coord.part_contexts[i]->request) {
+                source_request_release(coord.part_contexts[i]->request);
             }
             if (coord.part_contexts[i]->processor) {
                 part_processor_destroy(coord.part_contexts[i]->processor);
@@ -1187,9 +1345,13 @@ int burst_downloader_extract_concurrent(
         }
     }
     aws_mem_release(downloader->allocator, coord.part_contexts);
+    free(coord.part_rates);
+    free(coord.hedge_candidates);
     aws_mutex_clean_up(&coord.mutex);
     aws_condition_variable_clean_up(&coord.cv);
     free(part_has_full_body_data);
+    free(skip_download);
+    free(part_order);
 
     return result;
 }
@@ -0,0 +1,317 @@
+#include "archive_source.h"
+#include "burst_downloader.h"
+
+#include <aws/common/allocator.h>
+#include <aws/common/byte_buf.h>
+#include <aws/common/error.h>
+#include <aws/common/uri.h>
+#include <aws/http/request_response.h>
+#include <aws/s3/s3_client.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// S3 and HTTP(S) sources: ranged GETs through the downloader's aws-c-s3 client.
+// They differ only in where the request goes (and whether the client signs it).
+struct aws_source {
+    struct archive_source base;
+    struct burst_downloader *downloader;
+    char host[256];
+    char *path;               // "/KEY" for S3, path and query of the URL for HTTP
+    struct aws_uri endpoint;  // HTTP only: scheme and port of the URL
+    bool has_endpoint;
+};
+
+struct aws_request {
+    struct source_request base;
+    struct aws_allocator *allocator;  // Not the source's: the request may outlive it
+    struct source_request_options options;
+    struct aws_s3_meta_request *meta_request;
+    struct aws_s3_meta_request *window_request;  // Set by the body callback, for open_window()
+    char etag[128];
+};
+
+// Copy header name's value into out; returns false if absent or too long
+static bool get_header(const struct aws_http_headers *headers, const char *name,
+                       char *out, size_t out_size)
+{
+    struct aws_byte_cursor value;
+    if (aws_http_headers_get(headers, aws_byte_cursor_from_c_str(name), &value) != AWS_OP_SUCCESS ||
+        value.len >= out_size) {
+        return false;
+    }
+    memcpy(out, value.ptr, value.len);
+    out[value.len] = '\0';
+    return true;
+}
+
+static int aws_source_headers_callback(
+    struct aws_s3_meta_request *meta_request,
+    const struct aws_http_headers *headers,
+    int response_status,
+    void *user_data
+) {
+    (void)meta_request;
+    struct aws_request *req = user_data;
+    if (!req->options.headers) {
+        return AWS_OP_SUCCESS;
+    }
+
+    struct source_response response = {
+        .status = response_status,
+    };
+
+    // Content-Length: the whole object for a 200 response
+    char value[128];
+    uint64_t content_length = 0;
+    if (get_header(headers, "Content-Length", value, sizeof(value))) {
+        content_length = strtoull(value, NULL, 10);
+    }
+
+    // Content-Range: "bytes START-END/TOTAL", or "bytes */TOTAL" with a 416 response
+    if (get_header(headers, "Content-Range", value, sizeof(value))) {
+        unsigned long long start, end, total;
+        if (sscanf(value, "bytes %llu-%llu/%llu", &start, &end, &total) == 3) {
+            response.range_start = start;
+            response.range_end = end;
+            response.total_size = total;
+        } else if (sscanf(value, "bytes */%llu", &total) == 1) {
+            response.total_size = total;
+        }
+    } else if (content_length > 0) {
+        // Server ignored the Range header and sent everything
+        response.range_end = content_length - 1;
+        response.total_size = content_length;
+    }
+
+    if (get_header(headers, "ETag", req->etag, sizeof(req->etag))) {
+        response.etag = req->etag;
+    }
+
+    return req->options.headers(&response, req->options.user_data) == 0
+           ? AWS_OP_SUCCESS : AWS_OP_ERR;
+}
+
+static int aws_source_body_callback(
+    struct aws_s3_meta_request *meta_request,
+    const struct aws_byte_cursor *body,
+    uint64_t range_start,
+    void *user_data
+) {
+    (void)range_start;
+    struct aws_request *req = user_data;
+    req->window_request = meta_request;
+
+    if (!req->options.body) {
+        aws_s3_meta_request_increment_read_window(meta_request, body->len);
+        return AWS_OP_SUCCESS;
+    }
+    return req->options.body(&req->base, body->ptr, body->len, req->options.user_data) == 0
+           ? AWS_OP_SUCCESS : AWS_OP_ERR;
+}
+
+static void aws_source_finish_callback(
+    struct aws_s3_meta_request *meta_request,
+    const struct aws_s3_meta_request_result *result,
+    void *user_data
+) {
+    (void)meta_request;
+    struct aws_request *req = user_data;
+    req->options.finish(result->error_code, result->response_status, req->options.user_data);
+}
+
+// The meta request is gone, so no callback can still use req
+static void aws_source_shutdown_callback(void *user_data)
+{
+    struct aws_request *req = user_data;
+    aws_mem_release(req->allocator, req);
+}
+
+static struct source_request *aws_source_request(struct archive_source *base,
+                                                 const struct source_request_options *options)
+{
+    struct aws_source *source = (struct aws_source *)base;
+    struct burst_downloader *downloader = source->downloader;
+
+    struct aws_http_message *message = aws_http_message_new_request(downloader->allocator);
+    if (!message) {
+        fprintf(stderr, "Error: Failed to create HTTP message\n");
+        return NULL;
+    }
+    aws_http_message_set_request_method(message, aws_http_method_get);
+    aws_http_message_set_request_path(message, aws_byte_cursor_from_c_str(source->path));
+
+    struct aws_http_header host_header = {
+        .name = aws_byte_cursor_from_c_str("Host"),
+        .value = aws_byte_cursor_from_c_str(source->host),
+    };
+    aws_http_message_add_header(message, host_header);
+
+    // Suffix-length syntax (bytes=-N) for the tail, else bytes=START-END
+    char range_value[128];
+    if (options->suffix_length > 0) {
+        snprintf(range_value, sizeof(range_value), "bytes=-%llu",
+                 (unsigned long long)options->suffix_length);
+    } else {
+        snprintf(range_value, sizeof(range_value), "bytes=%llu-%llu",
+                 (unsigned long long)options->start, (unsigned long long)options->end);
+    }
+    struct aws_http_header range_header = {
+        .name = aws_byte_cursor_from_c_str("Range"),
+        .value = aws_byte_cursor_from_c_str(range_value),
+    };
+    aws_http_message_add_header(message, range_header);
+
+    if (options->if_match && options->if_match[0] != '\0') {
+        struct aws_http_header if_match_header = {
+            .name = aws_byte_cursor_from_c_str("If-Match"),
+            .value = aws_byte_cursor_from_c_str(options->if_match),
+        };
+        aws_http_message_add_header(message, if_match_header);
+    }
+
+    struct aws_request *req = aws_mem_calloc(downloader->allocator, 1, sizeof(struct aws_request));
+    if (!req) {
+        aws_http_message_release(message);
+        return NULL;
+    }
+    req->base.ops = base->ops;
+    req->allocator = downloader->allocator;
+    req->options = *options;
+
+    struct aws_s3_meta_request_options request_options = {
+        .type = AWS_S3_META_REQUEST_TYPE_GET_OBJECT,
+        .message = message,
+        .endpoint = source->has_endpoint ? &source->endpoint : NULL,
+        .user_data = req,
+        .headers_callback = aws_source_headers_callback,
+        .body_callback = aws_source_body_callback,
+        .finish_callback = aws_source_finish_callback,
+        .shutdown_callback = aws_source_shutdown_callback,
+    };
+
+    req->meta_request = aws_s3_client_make_meta_request(downloader->s3_client, &request_options);
+    aws_http_message_release(message);
+
+    if (!req->meta_request) {
+        fprintf(stderr, "Error: Failed to create meta request: %s\n",
+                aws_error_debug_str(aws_last_error()));
+        aws_mem_release(downloader->allocator, req);
+        return NULL;
+    }
+
+    return &req->base;
+}
+
+static void aws_request_open_window(struct source_request *base, size_t len)
+{
+    struct aws_request *req = (struct aws_request *)base;
+    aws_s3_meta_request_increment_read_window(req->window_request, len);
+}
+
+static void aws_request_cancel(struct source_request *base)
+{
+    aws_s3_meta_request_cancel(((struct aws_request *)base)->meta_request);
+}
+
+static void aws_request_release(struct source_request *base)
+{
+    // req itself is freed by the shutdown callback
+    aws_s3_meta_request_release(((struct aws_request *)base)->meta_request);
+}
+
+static const char *aws_source_error_str(int error_code)
+{
+    return aws_error_debug_str(error_code);
+}
+
+static void aws_source_destroy(struct archive_source *base)
+{
+    struct aws_source *source = (struct aws_source *)base;
+    if (source->has_endpoint) {
+        aws_uri_clean_up(&source->endpoint);
+    }
+    free(source->path);
+    free(source);
+}
+
+static const struct archive_source_ops aws_source_ops = {
+    .request = aws_source_request,
+    .open_window = aws_request_open_window,
+    .cancel = aws_request_cancel,
+    .release = aws_request_release,
+    .error_str = aws_source_error_str,
+    .destroy = aws_source_destroy,
+};
+
+struct archive_source *archive_source_new_s3(struct burst_downloader *downloader)
+{
+    if (!downloader || !downloader->s3_client || !downloader->bucket || !downloader->key ||
+        !downloader->region) {
+        return NULL;
+    }
+
+    struct aws_source *source = calloc(1, sizeof(struct aws_source));
+    size_t path_len = strlen(downloader->key) + 2;
+    char *path = malloc(path_len);
+    if (!source || !path) {
+        free(source);
+        free(path);
+        return NULL;
+    }
+    source->base.ops = &aws_source_ops;
+    source->base.kind = ARCHIVE_SOURCE_S3;
+    source->downloader = downloader;
+
+    // Virtual-hosted style: /KEY on BUCKET.s3.REGION.amazonaws.com
+    snprintf(source->host, sizeof(source->host), "%s.s3.%s.amazonaws.com",
+             downloader->bucket, downloader->region);
+    snprintf(path, path_len, "/%s", downloader->key);
+    source->path = path;
+
+    return &source->base;
+}
+
+struct archive_source *archive_source_new_http(struct burst_downloader *downloader,
+                                               const char *url)
+{
+    if (!downloader || !downloader->s3_client || !url) {
+        return NULL;
+    }
+
+    struct aws_source *source = calloc(1, sizeof(struct aws_source));
+    if (!source) {
+        return NULL;
+    }
+    source->base.ops = &aws_source_ops;
+    source->base.kind = ARCHIVE_SOURCE_HTTP;
+    source->downloader = downloader;
+
+    struct aws_byte_cursor url_cursor = aws_byte_cursor_from_c_str(url);
+    if (aws_uri_init_parse(&source->endpoint, downloader->allocator, &url_cursor) != AWS_OP_SUCCESS) {
+        fprintf(stderr, "Error: Invalid URL: %s\n", url);
+        free(source);
+        return NULL;
+    }
+    source->has_endpoint = true;
+
+    const struct aws_byte_cursor *authority = aws_uri_authority(&source->endpoint);
+    const struct aws_byte_cursor *path_and_query = aws_uri_path_and_query(&source->endpoint);
+    source->path = malloc(path_and_query->len + 2);
+    if (authority->len == 0 || authority->len >= sizeof(source->host) || !source->path) {
+        fprintf(stderr, "Error: Invalid URL: %s\n", url);
+        aws_source_destroy(&source->base);
+        return NULL;
+    }
+    snprintf(source->host, sizeof(source->host), "%.*s", (int)authority->len,
+             (const char *)authority->ptr);
+    if (path_and_query->len > 0) {
+        snprintf(source->path, path_and_query->len + 1, "%.*s", (int)path_and_query->len,
+                 (const char *)path_and_query->ptr);
+    } else {
+        strcpy(source->path, "/");
+    }
+
+    return &source->base;
+}
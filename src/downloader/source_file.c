@@ -0,0 +1,268 @@
+#include "archive_source.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Largest pread() per body callback, like the chunks of a network response
+#define FILE_SOURCE_CHUNK (256 * 1024)
+
+struct file_source {
+    struct archive_source base;
+    int fd;
+    uint64_t size;
+    uint64_t read_window;
+    char etag[96];  // Built from the inode, size and mtime, so a replaced file is noticed
+};
+
+struct file_request {
+    struct source_request base;
+    struct file_source *source;
+    struct source_request_options options;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t cv;       // Signalled when the window opens or the request is cancelled
+    uint64_t window;         // Bytes body() may still be given
+    bool cancelled;
+    int refs;                // Caller and reader thread
+};
+
+static void file_request_unref(struct file_request *req)
+{
+    pthread_mutex_lock(&req->mutex);
+    int refs = --req->refs;
+    pthread_mutex_unlock(&req->mutex);
+
+    if (refs == 0) {
+        pthread_mutex_destroy(&req->mutex);
+        pthread_cond_destroy(&req->cv);
+        free(req);
+    }
+}
+
+// Wait until body() may be given some bytes; returns how many (0 if cancelled)
+static uint64_t wait_for_window(struct file_request *req, uint64_t wanted)
+{
+    pthread_mutex_lock(&req->mutex);
+    while (req->window == 0 && !req->cancelled) {
+        pthread_cond_wait(&req->cv, &req->mutex);
+    }
+    uint64_t len = req->cancelled ? 0 : (req->window < wanted ? req->window : wanted);
+    req->window -= len;
+    pthread_mutex_unlock(&req->mutex);
+    return len;
+}
+
+// Deliver one request: the whole exchange runs on this thread, so callbacks
+// never overlap
+static void *file_request_thread(void *arg)
+{
+    struct file_request *req = arg;
+    struct file_source *source = req->source;
+    const struct source_request_options *options = &req->options;
+
+    int error = 0;
+    struct source_response response = {
+        .status = 206,
+        .total_size = source->size,
+        .etag = source->etag,
+    };
+
+    if (options->suffix_length > 0) {
+        response.range_start = options->suffix_length < source->size
+                               ? source->size - options->suffix_length : 0;
+        response.range_end = source->size > 0 ? source->size - 1 : 0;
+    } else {
+        response.range_start = options->start;
+        response.range_end = options->end < source->size ? options->end : source->size - 1;
+    }
+
+    if (options->if_match && options->if_match[0] != '\0' &&
+        strcmp(options->if_match, source->etag) != 0) {
+        response.status = 412;  // Precondition Failed: not the archive the caller expects
+        error = EIO;
+    } else if (source->size == 0 || response.range_start >= source->size ||
+               response.range_start > response.range_end) {
+        response.status = 416;  // Range Not Satisfiable
+        error = EIO;
+    }
+
+    if (options->headers && options->headers(&response, options->user_data) != 0 && error == 0) {
+        error = ECANCELED;
+    }
+
+    uint8_t *chunk = NULL;
+    if (error == 0 && options->body) {
+        chunk = malloc(FILE_SOURCE_CHUNK);
+        if (!chunk) {
+            error = ENOMEM;
+        }
+    }
+
+    uint64_t offset = response.range_start;
+    while (error == 0 && options->body && offset <= response.range_end) {
+        uint64_t wanted = response.range_end - offset + 1;
+        if (wanted > FILE_SOURCE_CHUNK) {
+            wanted = FILE_SOURCE_CHUNK;
+        }
+        uint64_t len = wait_for_window(req, wanted);
+        if (len == 0) {
+            error = ECANCELED;
+            break;
+        }
+
+        ssize_t n = pread(source->fd, chunk, (size_t)len, (off_t)offset);
+        if (n < 0 && errno == EINTR) {
+            pthread_mutex_lock(&req->mutex);
+            req->window += len;
+            pthread_mutex_unlock(&req->mutex);
+            continue;
+        }
+        if (n <= 0) {
+            error = n < 0 ? errno : EIO;  // EOF: the file shrank under us
+            break;
+        }
+        if ((uint64_t)n < len) {
+            pthread_mutex_lock(&req->mutex);
+            req->window += len - (uint64_t)n;
+            pthread_mutex_unlock(&req->mutex);
+        }
+
+        if (options->body(&req->base, chunk, (size_t)n, options->user_data) != 0) {
+            error = ECANCELED;
+            break;
+        }
+        offset += (uint64_t)n;
+    }
+    free(chunk);
+
+    pthread_mutex_lock(&req->mutex);
+    if (error == 0 && req->cancelled) {
+        error = ECANCELED;
+    }
+    pthread_mutex_unlock(&req->mutex);
+
+    options->finish(error, response.status, options->user_data);
+    file_request_unref(req);
+    return NULL;
+}
+
+static struct source_request *file_source_request(struct archive_source *base,
+                                                  const struct source_request_options *options)
+{
+    struct file_source *source = (struct file_source *)base;
+
+    struct file_request *req = calloc(1, sizeof(struct file_request));
+    if (!req) {
+        return NULL;
+    }
+    req->base.ops = base->ops;
+    req->source = source;
+    req->options = *options;
+    req->window = source->read_window;
+    req->refs = 2;
+    pthread_mutex_init(&req->mutex, NULL);
+    pthread_cond_init(&req->cv, NULL);
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    pthread_t thread;
+    int rc = pthread_create(&thread, &attr, file_request_thread, req);
+    pthread_attr_destroy(&attr);
+    if (rc != 0) {
+        fprintf(stderr, "Error: Failed to start file read thread: %s\n", strerror(rc));
+        pthread_mutex_destroy(&req->mutex);
+        pthread_cond_destroy(&req->cv);
+        free(req);
+        return NULL;
+    }
+
+    return &req->base;
+}
+
+static void file_request_open_window(struct source_request *base, size_t len)
+{
+    struct file_request *req = (struct file_request *)base;
+    pthread_mutex_lock(&req->mutex);
+    req->window += len;
+    pthread_cond_signal(&req->cv);
+    pthread_mutex_unlock(&req->mutex);
+}
+
+static void file_request_cancel(struct source_request *base)
+{
+    struct file_request *req = (struct file_request *)base;
+    pthread_mutex_lock(&req->mutex);
+    req->cancelled = true;
+    pthread_cond_signal(&req->cv);
+    pthread_mutex_unlock(&req->mutex);
+}
+
+static void file_request_release(struct source_request *base)
+{
+    file_request_unref((struct file_request *)base);
+}
+
+static const char *file_source_error_str(int error_code)
+{
+    return strerror(error_code);
+}
+
+static void file_source_destroy(struct archive_source *base)
+{
+    struct file_source *source = (struct file_source *)base;
+    close(source->fd);
+    free(source);
+}
+
+static const struct archive_source_ops file_source_ops = {
+    .request = file_source_request,
+    .open_window = file_request_open_window,
+    .cancel = file_request_cancel,
+    .release = file_request_release,
+    .error_str = file_source_error_str,
+    .destroy = file_source_destroy,
+};
+
+struct archive_source *archive_source_new_file(const char *path, uint64_t read_window)
+{
+    if (!path || read_window == 0) {
+        return NULL;
+    }
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        fprintf(stderr, "Error: Failed to open %s: %s\n", path, strerror(errno));
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        fprintf(stderr, "Error: %s is not a regular file\n", path);
+        close(fd);
+        return NULL;
+    }
+
+    struct file_source *source = calloc(1, sizeof(struct file_source));
+    if (!source) {
+        close(fd);
+        return NULL;
+    }
+    source->base.ops = &file_source_ops;
+    source->base.kind = ARCHIVE_SOURCE_FILE;
+    source->fd = fd;
+    source->size = (uint64_t)st.st_size;
+    source->read_window = read_window;
+    snprintf(source->etag, sizeof(source->etag), "\"%" PRIx64 "-%" PRIx64 "-%" PRIx64 ".%09ld\"",
+             (uint64_t)st.st_ino, (uint64_t)st.st_size, (uint64_t)st.st_mtim.tv_sec,
+             (long)st.st_mtim.tv_nsec);
+
+    return &source->base;
+}
@@ -1,3 +1,4 @@
+#define _GNU_SOURCE  // fallocate, copy_file_range
 #include "stream_processor.h"
 #include "frame_parser.h"
 #include "btrfs_writer.h"
@@ -10,16 +11,36 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/ioctl.h>
 #include <sys/stat.h>
 #include <unistd.h>
 #include <libgen.h>
+#include <limits.h>
+#include <pthread.h>
+
+// Share the extents of one file with another (linux/fs.h)
+#ifndef FICLONE
+#define FICLONE _IOW(0x94, 9, int)
+#endif
 
 // Initial frame buffer capacity (will grow as needed)
 #define INITIAL_FRAME_BUFFER_CAPACITY (256 * 1024)
 
+// Most bytes carried over between chunks. A BURST frame or local file header
+// is well under this (128 KiB of data, 64 KiB name and extra field), so a
+// longer incomplete frame means the stream is corrupt.
+#define MAX_FRAME_BUFFER_CARRY (1024 * 1024)
+
+// Buffer for copying a duplicate's content where copy_file_range() is unsupported
+#define CLONE_COPY_BUFFER_SIZE (128 * 1024)
+
 // BURST archives have Start-of-Part frames at 8 MiB boundaries
 #define BURST_BASE_ALIGNMENT (8 * 1024 * 1024)
 
+// Guards the shared fd fields of file_metadata (files spanning several parts).
+// Taken once per part for each such file, so one lock for all of them is enough.
+static pthread_mutex_t shared_file_lock = PTHREAD_MUTEX_INITIALIZER;
+
 // Forward declarations for internal functions
 static int handle_start_of_part_frame(struct part_processor_state *state,
                                       const uint8_t *frame_data, size_t frame_size);
@@ -34,7 +55,30 @@ static int handle_data_descriptor(struct part_processor_state *state,
 static int open_output_file(struct part_processor_state *state,
                             struct file_metadata *file_meta);
 static int close_output_file(struct part_processor_state *state);
+static int create_hardlink(struct part_processor_state *state, const char *target);
+static int make_directory(int dir_fd, const char *dir);
 static int ensure_directory_exists(const char *path);
+static int ensure_archive_dir(struct central_dir_parse_result *cd_result,
+                              const char *output_dir, size_t index);
+static int ensure_entry_parent(struct central_dir_parse_result *cd_result,
+                               const char *output_dir, const char *name);
+static bool is_empty_file(const struct file_metadata *file);
+static void dir_fd_cache_init(struct dir_fd_cache *cache);
+static void dir_fd_cache_release(struct dir_fd_cache *cache);
+static int dir_fd_cache_get(struct dir_fd_cache *cache,
+                            struct central_dir_parse_result *cd_result,
+                            const char *output_dir, size_t index);
+static const char *entry_last_component(const char *filename);
+static int dir_fd_for(struct dir_fd_cache *cache, struct central_dir_parse_result *cd_result,
+                      const char *output_dir, size_t dir_index, const char *filename,
+                      const char **name);
+static int current_file_dir_fd(struct part_processor_state *state, const char **name);
+static int entry_dir_fd(struct dir_fd_cache *cache, struct central_dir_parse_result *cd_result,
+                        const char *output_dir, const struct file_metadata *file,
+                        const char **name);
+static int open_current_file(struct part_processor_state *state);
+static int acquire_shared_fd(struct part_processor_state *state, struct file_metadata *file_meta);
+static void release_file_fd(struct file_context *file);
 
 
 struct part_processor_state *part_processor_create(
@@ -75,6 +119,8 @@ struct part_processor_state *part_processor_create(
     state->bytes_processed = 0;
     state->state = STATE_INIT;
     state->current_file = NULL;
+    dir_fd_cache_init(&state->dir_fds);
+    state->is_root = (geteuid() == 0);
     state->error_code = 0;
     state->error_message[0] = '\0';
 
@@ -89,14 +135,12 @@ void part_processor_destroy(struct part_processor_state *state)
 
     // Close any open file
     if (state->current_file != NULL) {
-        if (state->current_file->fd >= 0) {
-            close(state->current_file->fd);
-        }
+        release_file_fd(state->current_file);
         free(state->current_file->symlink_buffer);
-        free(state->current_file->filename);
         free(state->current_file);
     }
 
+    dir_fd_cache_release(&state->dir_fds);
     free(state->frame_buffer);
     free(state);
 }
@@ -109,62 +153,15 @@ const char *part_processor_get_error(const struct part_processor_state *state)
     return state->error_message;
 }
 
-int part_processor_process_data(
-    struct part_processor_state *state,
-    const uint8_t *data,
-    size_t data_len)
+// Run the state machine over work_buffer. Stops at a frame that is not
+// entirely present, setting *consumed to its offset and
+// state->frame_buffer_needed to the bytes it needs.
+static int process_buffer(struct part_processor_state *state,
+                          const uint8_t *work_buffer, size_t work_len,
+                          size_t *consumed)
 {
-    if (state == NULL || (data == NULL && data_len > 0)) {
-        return STREAM_PROC_ERR_INVALID_ARGS;
-    }
-
-    if (state->state == STATE_ERROR) {
-        return state->error_code;
-    }
-
-    if (state->state == STATE_DONE) {
-        return STREAM_PROC_SUCCESS;
-    }
-
-    // Combine buffered data with new data
-    const uint8_t *work_buffer;
-    size_t work_len;
-    bool using_frame_buffer = false;
-
-    if (state->frame_buffer_used > 0) {
-        // Need to combine buffered data with new data
-        size_t total_len = state->frame_buffer_used + data_len;
-        if (total_len > state->frame_buffer_capacity) {
-            // Grow buffer
-            size_t new_capacity = state->frame_buffer_capacity * 2;
-            while (new_capacity < total_len) {
-                new_capacity *= 2;
-            }
-            uint8_t *new_buffer = realloc(state->frame_buffer, new_capacity);
-            if (new_buffer == NULL) {
-                snprintf(state->error_message, sizeof(state->error_message),
-                         "Failed to grow frame buffer to %zu bytes", new_capacity);
-                state->state = STATE_ERROR;
-                state->error_code = STREAM_PROC_ERR_MEMORY;
-                return STREAM_PROC_ERR_MEMORY;
-            }
-            state->frame_buffer = new_buffer;
-            state->frame_buffer_capacity = new_capacity;
-        }
-
-        // Append new data to buffer
-        memcpy(state->frame_buffer + state->frame_buffer_used, data, data_len);
-        state->frame_buffer_used += data_len;
-
-        work_buffer = state->frame_buffer;
-        work_len = state->frame_buffer_used;
-        using_frame_buffer = true;
-    } else {
-        work_buffer = data;
-        work_len = data_len;
-    }
-
     size_t offset = 0;
+    size_t needed = 0;  // Set where the frame's size is already known
 
     while (offset < work_len) {
         size_t remaining = work_len - offset;
@@ -327,6 +324,7 @@ int part_processor_process_data(
             case FRAME_ZSTD_COMPRESSED:
                 // Check if we have the full frame
                 if (remaining < info.frame_size) {
+                    needed = info.frame_size;
                     goto buffer_remaining;
                 }
                 rc = handle_zstd_frame(state, ptr, info.frame_size, info.uncompressed_size);
@@ -343,6 +341,15 @@ int part_processor_process_data(
                 state->bytes_processed += info.frame_size;
                 break;
 
+            case FRAME_BURST_ZERO:
+                // The frame that follows is zeros: leave a hole instead of writing it
+                if (state->current_file != NULL) {
+                    state->current_file->next_frame_zero = true;
+                }
+                offset += info.frame_size;
+                state->bytes_processed += info.frame_size;
+                break;
+
             case FRAME_BURST_START_OF_PART: {
                 // Start-of-Part frames appear at 8 MiB boundaries in BURST archives.
                 // When downloading with part sizes larger than 8 MiB, we encounter
@@ -379,6 +386,10 @@ int part_processor_process_data(
                 } else {
                     descriptor_size = sizeof(struct zip_data_descriptor);  // 16 bytes
                 }
+                if (remaining < descriptor_size) {
+                    needed = descriptor_size;
+                    goto buffer_remaining;
+                }
 
                 rc = handle_data_descriptor(state, ptr);
                 if (rc != STREAM_PROC_SUCCESS) {
@@ -473,42 +484,124 @@ int part_processor_process_data(
         }
     }
 
-    // Successfully processed all data
-    if (using_frame_buffer) {
-        state->frame_buffer_used = 0;
-    }
+    *consumed = work_len;
     return STREAM_PROC_SUCCESS;
 
 buffer_remaining:
-    // Buffer remaining data for next call
-    if (using_frame_buffer) {
-        // Already in frame buffer, just update used count
-        memmove(state->frame_buffer, work_buffer + offset, work_len - offset);
-        state->frame_buffer_used = work_len - offset;
-    } else {
-        // Copy remaining data to frame buffer
-        size_t to_buffer = work_len - offset;
-        if (to_buffer > state->frame_buffer_capacity) {
-            size_t new_capacity = state->frame_buffer_capacity;
-            while (new_capacity < to_buffer) {
-                new_capacity *= 2;
+    if (needed <= work_len - offset) {
+        needed = frame_bytes_needed(work_buffer + offset, work_len - offset);
+    }
+    if (needed <= work_len - offset) {
+        needed = work_len - offset + 1;  // Always ask for more, so the caller makes progress
+    }
+    if (needed > MAX_FRAME_BUFFER_CARRY) {
+        snprintf(state->error_message, sizeof(state->error_message),
+                 "Incomplete frame of more than %d bytes at part %u offset %llu",
+                 MAX_FRAME_BUFFER_CARRY, state->part_index,
+                 (unsigned long long)state->bytes_processed);
+        state->state = STATE_ERROR;
+        state->error_code = STREAM_PROC_ERR_INVALID_FRAME;
+        return STREAM_PROC_ERR_INVALID_FRAME;
+    }
+    state->frame_buffer_needed = needed;
+    *consumed = offset;
+    return STREAM_PROC_NEED_MORE_DATA;
+}
+
+// Append len bytes to the frame buffer, growing it as needed
+static int carry_bytes(struct part_processor_state *state, const uint8_t *data, size_t len)
+{
+    size_t total_len = state->frame_buffer_used + len;
+    if (total_len > state->frame_buffer_capacity) {
+        size_t new_capacity = state->frame_buffer_capacity * 2;
+        while (new_capacity < total_len) {
+            new_capacity *= 2;
+        }
+        uint8_t *new_buffer = realloc(state->frame_buffer, new_capacity);
+        if (new_buffer == NULL) {
+            snprintf(state->error_message, sizeof(state->error_message),
+                     "Failed to grow frame buffer to %zu bytes", new_capacity);
+            state->state = STATE_ERROR;
+            state->error_code = STREAM_PROC_ERR_MEMORY;
+            return STREAM_PROC_ERR_MEMORY;
+        }
+        state->frame_buffer = new_buffer;
+        state->frame_buffer_capacity = new_capacity;
+    }
+
+    memcpy(state->frame_buffer + state->frame_buffer_used, data, len);
+    state->frame_buffer_used = total_len;
+    state->frame_bytes_copied += len;
+    PROFILE_ADD(g_profile_stats.frame_carry_bytes, len);
+    return STREAM_PROC_SUCCESS;
+}
+
+int part_processor_process_data(
+    struct part_processor_state *state,
+    const uint8_t *data,
+    size_t data_len)
+{
+    if (state == NULL || (data == NULL && data_len > 0)) {
+        return STREAM_PROC_ERR_INVALID_ARGS;
+    }
+
+    if (state->state == STATE_ERROR) {
+        return state->error_code;
+    }
+
+    if (state->state == STATE_DONE) {
+        return STREAM_PROC_SUCCESS;
+    }
+
+    size_t consumed;
+    int rc;
+
+    // Finish the frame carried over from the previous call. Only the bytes it
+    // still needs are copied; the rest of data is parsed where it lies.
+    while (state->frame_buffer_used > 0) {
+        if (state->frame_buffer_needed > state->frame_buffer_used) {
+            size_t take = state->frame_buffer_needed - state->frame_buffer_used;
+            if (take > data_len) {
+                take = data_len;
             }
-            uint8_t *new_buffer = realloc(state->frame_buffer, new_capacity);
-            if (new_buffer == NULL) {
-                snprintf(state->error_message, sizeof(state->error_message),
-                         "Failed to grow frame buffer");
-                state->state = STATE_ERROR;
-                state->error_code = STREAM_PROC_ERR_MEMORY;
-                return STREAM_PROC_ERR_MEMORY;
+            rc = carry_bytes(state, data, take);
+            if (rc != STREAM_PROC_SUCCESS) {
+                return rc;
+            }
+            data += take;
+            data_len -= take;
+            if (state->frame_buffer_used < state->frame_buffer_needed) {
+                return STREAM_PROC_SUCCESS;  // Still incomplete, and data is used up
             }
-            state->frame_buffer = new_buffer;
-            state->frame_buffer_capacity = new_capacity;
         }
-        memcpy(state->frame_buffer, work_buffer + offset, to_buffer);
-        state->frame_buffer_used = to_buffer;
+
+        rc = process_buffer(state, state->frame_buffer, state->frame_buffer_used, &consumed);
+        if (rc != STREAM_PROC_SUCCESS && rc != STREAM_PROC_NEED_MORE_DATA) {
+            return rc;
+        }
+        // Whatever is left is a frame whose size is only now known in full,
+        // or known one step further (e.g. up to the next Zstandard block)
+        memmove(state->frame_buffer, state->frame_buffer + consumed,
+                state->frame_buffer_used - consumed);
+        state->frame_buffer_used -= consumed;
     }
 
-    return STREAM_PROC_SUCCESS;
+    if (data_len == 0) {
+        return STREAM_PROC_SUCCESS;
+    }
+
+    rc = process_buffer(state, data, data_len, &consumed);
+    if (rc == STREAM_PROC_NEED_MORE_DATA) {
+        // Carry only the trailing partial frame
+        return carry_bytes(state, data + consumed, data_len - consumed);
+    }
+    return rc;
+}
+
+uint64_t part_processor_rewind(struct part_processor_state *state)
+{
+    state->frame_buffer_used = 0;
+    return state->part_start_offset + state->bytes_processed;
 }
 
 int part_processor_finalize(struct part_processor_state *state)
@@ -517,13 +610,16 @@ int part_processor_finalize(struct part_processor_state *state)
         return STREAM_PROC_ERR_INVALID_ARGS;
     }
 
-    // Close any open file
+    // Close any open file. One still open here continues in the next part,
+    // whose processor finishes it.
     if (state->current_file != NULL) {
+        state->current_file->continues_in_next_part = true;
         int rc = close_output_file(state);
         if (rc != STREAM_PROC_SUCCESS) {
             return rc;
         }
     }
+    dir_fd_cache_release(&state->dir_fds);
 
     // Check for unexpected buffered data
     if (state->frame_buffer_used > 0) {
@@ -639,6 +735,12 @@ static int handle_zstd_frame(struct part_processor_state *state,
                              const uint8_t *frame_data, size_t compressed_size,
                              uint64_t uncompressed_size)
 {
+    // Identical to a file written elsewhere in the archive; cloned afterwards
+    if (state->current_file != NULL && state->current_file->skip_data) {
+        state->current_file->uncompressed_offset += uncompressed_size;
+        return STREAM_PROC_SUCCESS;
+    }
+
     if (state->current_file == NULL || state->current_file->fd < 0) {
         snprintf(state->error_message, sizeof(state->error_message),
                  "Zstd frame without open output file");
@@ -647,6 +749,19 @@ static int handle_zstd_frame(struct part_processor_state *state,
         return STREAM_PROC_ERR_INVALID_FRAME;
     }
 
+    // Zeros: punch a hole (clearing anything already in the file there) and let
+    // close_output_file()'s ftruncate() set the size. Filesystems that cannot
+    // punch holes get the frame written as usual.
+    if (state->current_file->next_frame_zero) {
+        state->current_file->next_frame_zero = false;
+        if (fallocate(state->current_file->fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+                      (off_t)state->current_file->uncompressed_offset,
+                      (off_t)uncompressed_size) == 0) {
+            state->current_file->uncompressed_offset += uncompressed_size;
+            return STREAM_PROC_SUCCESS;
+        }
+    }
+
     // Write frame to BTRFS
     int rc = do_write_encoded(
         state->current_file->fd,
@@ -657,9 +772,9 @@ static int handle_zstd_frame(struct part_processor_state *state,
 
     if (rc != BTRFS_WRITER_SUCCESS) {
         snprintf(state->error_message, sizeof(state->error_message),
-                 "BTRFS write failed (rc=%d) for file '%s' at uncompressed_offset=%lu, "
+                 "BTRFS write failed (rc=%d) for file '%s/%s' at uncompressed_offset=%lu, "
                  "part=%u, part_bytes_processed=%lu",
-                 rc, state->current_file->filename,
+                 rc, state->output_dir, state->current_file->filename,
                  (unsigned long)state->current_file->uncompressed_offset,
                  state->part_index, (unsigned long)state->bytes_processed);
         state->state = STATE_ERROR;
@@ -709,31 +824,27 @@ static int open_output_file(struct part_processor_state *state,
         return STREAM_PROC_ERR_MEMORY;
     }
 
-    // Build full output path
-    size_t path_len = strlen(state->output_dir) + 1 + strlen(file_meta->filename) + 1;
-    state->current_file->filename = malloc(path_len);
-    if (state->current_file->filename == NULL) {
-        free(state->current_file);
-        state->current_file = NULL;
-        snprintf(state->error_message, sizeof(state->error_message),
-                 "Failed to allocate filename");
-        state->state = STATE_ERROR;
-        state->error_code = STREAM_PROC_ERR_MEMORY;
-        return STREAM_PROC_ERR_MEMORY;
-    }
-    snprintf(state->current_file->filename, path_len, "%s/%s",
-             state->output_dir, file_meta->filename);
+    // The file is created relative to its parent's cached fd; the full path is
+    // only spelled out in messages
+    state->current_file->filename = file_meta->filename;
 
     // Check if this is a directory entry (filename ends with '/')
     size_t filename_len = strlen(file_meta->filename);
     bool is_directory = (filename_len > 0 && file_meta->filename[filename_len - 1] == '/');
 
+    // Name within the parent directory, for the *at() calls
+    state->current_file->name = entry_last_component(file_meta->filename);
+    state->current_file->parent_dir = state->cd_result->dirs ?
+                                      file_meta->parent_dir : CENTRAL_DIR_NO_DIR;
+
     // Ensure parent directory exists (handles archives with out-of-order directory entries)
-    int rc = ensure_directory_exists(state->current_file->filename);
+    int rc = state->cd_result->dirs ?
+             ensure_archive_dir(state->cd_result, state->output_dir, file_meta->parent_dir) :
+             ensure_entry_parent(state->cd_result, state->output_dir, file_meta->filename);
     if (rc != 0) {
         snprintf(state->error_message, sizeof(state->error_message),
-                 "Failed to create parent directory for %s", state->current_file->filename);
-        free(state->current_file->filename);
+                 "Failed to create parent directory for %s/%s",
+                 state->output_dir, file_meta->filename);
         free(state->current_file);
         state->current_file = NULL;
         state->state = STATE_ERROR;
@@ -757,24 +868,27 @@ static int open_output_file(struct part_processor_state *state,
     // Copy ZIP64 tracking from central directory
     state->current_file->uses_zip64_descriptor = file_meta->uses_zip64_descriptor;
 
-    // Directories: create the directory and apply permissions, no file to open
+    // Directories: create the directory, no file to open. Permissions are
+    // applied by stream_processor_apply_directory_metadata() once everything
+    // inside exists.
     if (is_directory) {
         state->current_file->fd = -1;  // No file descriptor for directories
 
-        // Create the directory itself (parent dirs already ensured above)
-#ifdef BURST_PROFILE
-        int mkdir_result;
-        PROFILE_TIME_BLOCK(g_profile_stats.inode_time_ns, {
-            mkdir_result = mkdir(state->current_file->filename, 0755);
-        });
-        PROFILE_COUNT(g_profile_stats.inode_count);
-        if (mkdir_result != 0 && errno != EEXIST) {
-#else
-        if (mkdir(state->current_file->filename, 0755) != 0 && errno != EEXIST) {
-#endif
+        // Create the directory itself (parent dirs already ensured above),
+        // unless an earlier entry inside it already did
+        size_t dir_index = central_dir_find_dir(state->cd_result, file_meta->filename,
+                                                filename_len - 1);
+        if (dir_index != CENTRAL_DIR_NO_DIR) {
+            rc = ensure_archive_dir(state->cd_result, state->output_dir, dir_index);
+        } else {
+            const char *name;
+            int dir_fd = current_file_dir_fd(state, &name);
+            rc = make_directory(dir_fd, name);
+        }
+        if (rc != 0) {
             snprintf(state->error_message, sizeof(state->error_message),
-                     "Failed to create directory %s: %s", state->current_file->filename, strerror(errno));
-            free(state->current_file->filename);
+                     "Failed to create directory %s/%s: %s",
+                     state->output_dir, file_meta->filename, strerror(errno));
             free(state->current_file);
             state->current_file = NULL;
             state->state = STATE_ERROR;
@@ -782,37 +896,33 @@ static int open_output_file(struct part_processor_state *state,
             return STREAM_PROC_ERR_IO;
         }
 
-        // Apply Unix permissions if available
-        if (state->current_file->has_unix_mode) {
-            mode_t mode = state->current_file->unix_mode & 07777;
-#ifdef BURST_PROFILE
-            PROFILE_TIME_BLOCK(g_profile_stats.inode_time_ns, {
-                (void)chmod(state->current_file->filename, mode);
-            });
-            PROFILE_COUNT(g_profile_stats.inode_count);
-#else
-            if (chmod(state->current_file->filename, mode) != 0) {
-                fprintf(stderr, "Warning: failed to set permissions on directory %s: %s\n",
-                        state->current_file->filename, strerror(errno));
-            }
-#endif
-        }
+        return STREAM_PROC_SUCCESS;
+    }
 
-        // Apply Unix ownership if available and running as root
-        if (state->current_file->has_unix_extra && geteuid() == 0) {
-#ifdef BURST_PROFILE
-            PROFILE_TIME_BLOCK(g_profile_stats.inode_time_ns, {
-                (void)chown(state->current_file->filename, state->current_file->uid, state->current_file->gid);
-            });
-            PROFILE_COUNT(g_profile_stats.inode_count);
-#else
-            if (chown(state->current_file->filename, state->current_file->uid, state->current_file->gid) != 0) {
-                fprintf(stderr, "Warning: failed to set ownership on directory %s: %s\n",
-                        state->current_file->filename, strerror(errno));
-            }
-#endif
+    // Hardlinks: no data of their own, just another name for the target entry
+    if (file_meta->hardlink_target != NULL) {
+        state->current_file->fd = -1;
+        rc = create_hardlink(state, file_meta->hardlink_target);
+        if (rc != STREAM_PROC_SUCCESS) {
+            free(state->current_file);
+            state->current_file = NULL;
         }
+        return rc;
+    }
 
+    // Same content as an earlier entry: stream_processor_clone_duplicates()
+    // creates the file once its source is complete
+    if (file_meta->dedup_source != NULL) {
+        state->current_file->fd = -1;
+        state->current_file->skip_data = true;
+        return STREAM_PROC_SUCCESS;
+    }
+
+    // Empty files may already have been created by stream_processor_materialize_entries()
+    if (is_empty_file(file_meta) &&
+        atomic_exchange_explicit(&file_meta->created, true, memory_order_acq_rel)) {
+        state->current_file->fd = -1;
+        state->current_file->skip_data = true;
         return STREAM_PROC_SUCCESS;
     }
 
@@ -823,8 +933,8 @@ static int open_output_file(struct part_processor_state *state,
         state->current_file->symlink_buffer = malloc(state->current_file->symlink_buffer_size);
         if (state->current_file->symlink_buffer == NULL) {
             snprintf(state->error_message, sizeof(state->error_message),
-                     "Failed to allocate symlink buffer for %s", state->current_file->filename);
-            free(state->current_file->filename);
+                     "Failed to allocate symlink buffer for %s/%s",
+                     state->output_dir, file_meta->filename);
             free(state->current_file);
             state->current_file = NULL;
             state->state = STATE_ERROR;
@@ -835,23 +945,20 @@ static int open_output_file(struct part_processor_state *state,
         return STREAM_PROC_SUCCESS;
     }
 
-    // Regular file: open for writing
-    // Never use O_TRUNC - with concurrent part processing, parts may complete
-    // out of order, so we must not truncate data written by other parts
-#ifdef BURST_PROFILE
-    PROFILE_TIME_BLOCK(g_profile_stats.inode_time_ns, {
-        state->current_file->fd = open(state->current_file->filename,
-                                       O_WRONLY | O_CREAT, 0644);
-    });
-    PROFILE_COUNT(g_profile_stats.inode_count);
-#else
-    state->current_file->fd = open(state->current_file->filename,
-                                   O_WRONLY | O_CREAT, 0644);
-#endif
+    // Regular file: open for writing, or share the fd of a file spanning
+    // several parts with the processors of its other parts
+    if (file_meta->num_parts_spanned > 1) {
+        state->current_file->fd = acquire_shared_fd(state, file_meta);
+        if (state->current_file->fd >= 0) {
+            state->current_file->shared_meta = file_meta;
+        }
+    } else {
+        state->current_file->fd = open_current_file(state);
+    }
     if (state->current_file->fd < 0) {
         snprintf(state->error_message, sizeof(state->error_message),
-                 "Failed to open %s: %s", state->current_file->filename, strerror(errno));
-        free(state->current_file->filename);
+                 "Failed to open %s/%s: %s", state->output_dir, file_meta->filename,
+                 strerror(errno));
         free(state->current_file);
         state->current_file = NULL;
         state->state = STATE_ERROR;
@@ -862,6 +969,62 @@ static int open_output_file(struct part_processor_state *state,
     return STREAM_PROC_SUCCESS;
 }
 
+// Open the current regular file. Never use O_TRUNC - with concurrent part
+// processing, parts may complete out of order, so we must not truncate data
+// written by other parts.
+static int open_current_file(struct part_processor_state *state)
+{
+    const char *name;
+    int dir_fd = current_file_dir_fd(state, &name);
+    int fd;
+    PROFILE_TIME_BLOCK(g_profile_stats.inode_time_ns, {
+        fd = openat(dir_fd, name, O_WRONLY | O_CREAT, 0644);
+    });
+    PROFILE_COUNT(g_profile_stats.inode_count);
+    return fd;
+}
+
+// The fd of a file spanning several parts, opened by whichever of their
+// processors gets here first
+static int acquire_shared_fd(struct part_processor_state *state, struct file_metadata *file_meta)
+{
+    pthread_mutex_lock(&shared_file_lock);
+    if (file_meta->shared_fd < 0) {
+        file_meta->shared_fd = open_current_file(state);
+    }
+    int fd = file_meta->shared_fd;
+    if (fd >= 0) {
+        file_meta->shared_fd_holders++;
+    }
+    pthread_mutex_unlock(&shared_file_lock);
+    return fd;
+}
+
+// Close file->fd, or let go of it if shared. A shared fd is closed by the
+// last part to finish with it.
+static void release_file_fd(struct file_context *file)
+{
+    if (file->fd < 0) {
+        return;
+    }
+
+    struct file_metadata *meta = file->shared_meta;
+    if (meta == NULL) {
+        close(file->fd);
+    } else {
+        pthread_mutex_lock(&shared_file_lock);
+        meta->shared_fd_holders--;
+        meta->parts_pending--;
+        if (meta->parts_pending <= 0 && meta->shared_fd_holders == 0) {
+            close(meta->shared_fd);
+            meta->shared_fd = -1;
+        }
+        pthread_mutex_unlock(&shared_file_lock);
+        file->shared_meta = NULL;
+    }
+    file->fd = -1;
+}
+
 static int close_output_file(struct part_processor_state *state)
 {
     if (state->current_file == NULL) {
@@ -873,39 +1036,44 @@ static int close_output_file(struct part_processor_state *state)
         // Null-terminate the target path
         state->current_file->symlink_buffer[state->current_file->symlink_bytes_read] = '\0';
 
+        const char *name;
+        int dir_fd = current_file_dir_fd(state, &name);
+
         // Remove existing symlink/file if it exists
-        unlink(state->current_file->filename);
+        unlinkat(dir_fd, name, 0);
 
         // Create symlink
 #ifdef BURST_PROFILE
         int symlink_result;
         PROFILE_TIME_BLOCK(g_profile_stats.inode_time_ns, {
-            symlink_result = symlink((char *)state->current_file->symlink_buffer, state->current_file->filename);
+            symlink_result = symlinkat((char *)state->current_file->symlink_buffer, dir_fd, name);
         });
         PROFILE_COUNT(g_profile_stats.inode_count);
         if (symlink_result != 0) {
 #else
-        if (symlink((char *)state->current_file->symlink_buffer, state->current_file->filename) != 0) {
+        if (symlinkat((char *)state->current_file->symlink_buffer, dir_fd, name) != 0) {
 #endif
             // Log but don't fail (symlink may already exist from another part)
-            fprintf(stderr, "Warning: failed to create symlink %s -> %s: %s\n",
-                    state->current_file->filename,
+            fprintf(stderr, "Warning: failed to create symlink %s/%s -> %s: %s\n",
+                    state->output_dir, state->current_file->filename,
                     (char *)state->current_file->symlink_buffer,
                     strerror(errno));
         }
 
         // Apply ownership to symlink if running as root (using lchown, not fchown)
         if (state->current_file->has_unix_extra) {
-            if (geteuid() == 0) {
+            if (state->is_root) {
 #ifdef BURST_PROFILE
                 PROFILE_TIME_BLOCK(g_profile_stats.inode_time_ns, {
-                    (void)lchown(state->current_file->filename, state->current_file->uid, state->current_file->gid);
+                    (void)fchownat(dir_fd, name, state->current_file->uid, state->current_file->gid,
+                                   AT_SYMLINK_NOFOLLOW);
                 });
                 PROFILE_COUNT(g_profile_stats.inode_count);
 #else
-                if (lchown(state->current_file->filename, state->current_file->uid, state->current_file->gid) != 0) {
-                    fprintf(stderr, "Warning: failed to set ownership on symlink %s: %s\n",
-                            state->current_file->filename, strerror(errno));
+                if (fchownat(dir_fd, name, state->current_file->uid, state->current_file->gid,
+                             AT_SYMLINK_NOFOLLOW) != 0) {
+                    fprintf(stderr, "Warning: failed to set ownership on symlink %s/%s: %s\n",
+                            state->output_dir, state->current_file->filename, strerror(errno));
                 }
 #endif
             }
@@ -915,7 +1083,6 @@ static int close_output_file(struct part_processor_state *state)
         free(state->current_file->symlink_buffer);
         state->current_file->symlink_buffer = NULL;
 
-        free(state->current_file->filename);
         free(state->current_file);
         state->current_file = NULL;
 
@@ -928,41 +1095,18 @@ static int close_output_file(struct part_processor_state *state)
         uint64_t finalize_start = burst_profile_get_time_ns();
 #endif
 
-        // Truncate file to expected final size (from central directory).
-        // This handles pre-existing files that may be larger than expected,
-        // and is safe with concurrent parts since all parts truncate to the
-        // same final size (multiple truncates to same size are idempotent).
-        if (ftruncate(state->current_file->fd, (off_t)state->current_file->expected_total_size) != 0) {
+        // Set the final size (from the central directory) in the part that
+        // holds the end of the file. This handles pre-existing files that may
+        // be larger than expected and trailing holes. Permissions and ownership
+        // are applied once by stream_processor_apply_metadata().
+        if (!state->current_file->continues_in_next_part &&
+            ftruncate(state->current_file->fd, (off_t)state->current_file->expected_total_size) != 0) {
             // Log but don't fail
-            fprintf(stderr, "Warning: failed to truncate %s: %s\n",
-                    state->current_file->filename, strerror(errno));
+            fprintf(stderr, "Warning: failed to truncate %s/%s: %s\n",
+                    state->output_dir, state->current_file->filename, strerror(errno));
         }
 
-        // Apply Unix permissions if available
-        if (state->current_file->has_unix_mode) {
-            // Extract permission bits only (lower 12 bits: rwx + setuid/setgid/sticky)
-            mode_t mode = state->current_file->unix_mode & 07777;
-            if (fchmod(state->current_file->fd, mode) != 0) {
-                // Log but don't fail
-                fprintf(stderr, "Warning: failed to set permissions on %s: %s\n",
-                        state->current_file->filename, strerror(errno));
-            }
-        }
-
-        // Apply Unix ownership if available and running as root
-        if (state->current_file->has_unix_extra) {
-            if (geteuid() == 0) {
-                if (fchown(state->current_file->fd, state->current_file->uid, state->current_file->gid) != 0) {
-                    // Log error when running as root (shouldn't fail)
-                    fprintf(stderr, "Warning: failed to set ownership on %s: %s\n",
-                            state->current_file->filename, strerror(errno));
-                }
-            }
-            // Silently skip chown when not running as root
-        }
-
-        close(state->current_file->fd);
-        state->current_file->fd = -1;
+        release_file_fd(state->current_file);
 
 #ifdef BURST_PROFILE
         uint64_t finalize_elapsed = burst_profile_get_time_ns() - finalize_start;
@@ -974,26 +1118,107 @@ static int close_output_file(struct part_processor_state *state)
     // Free any allocated symlink buffer (in case of error cleanup)
     free(state->current_file->symlink_buffer);
 
-    free(state->current_file->filename);
     free(state->current_file);
     state->current_file = NULL;
 
     return STREAM_PROC_SUCCESS;
 }
 
-// Ensure all directories in the path exist
-static int ensure_directory_exists(const char *path)
+// Link the current file to target (an archive name). The target's data may
+// still be on its way in another part, so it is created empty if it does not
+// exist yet; its own processor opens it without O_TRUNC and fills in the data
+// and metadata, which both names share.
+static int create_hardlink(struct part_processor_state *state, const char *target)
 {
-    // Make a copy since we'll modify it
-    char *path_copy = strdup(path);
-    if (path_copy == NULL) {
-        return -1;
+    int rc = STREAM_PROC_SUCCESS;
+    int target_dir_fd = -1;
+    int fd = -1;
+    if (strcmp(target, state->current_file->filename) == 0) {
+        errno = EINVAL;
+        rc = STREAM_PROC_ERR_IO;
+    } else if (ensure_entry_parent(state->cd_result, state->output_dir, target) != 0) {
+        rc = STREAM_PROC_ERR_IO;
+    } else {
+        // A dup of the cached fd, which looking up the link's own directory may evict
+        const char *slash = strrchr(target, '/');
+        size_t dir_index = central_dir_find_dir(state->cd_result, target,
+                                                slash ? (size_t)(slash - target) : 0);
+        const char *target_name;
+        target_dir_fd = dir_fd_for(&state->dir_fds, state->cd_result, state->output_dir,
+                                   dir_index, target, &target_name);
+        target_dir_fd = target_dir_fd >= 0 ? dup(target_dir_fd) : -1;
+        if (target_dir_fd < 0) {
+            rc = STREAM_PROC_ERR_IO;
+        } else {
+            PROFILE_TIME_BLOCK(g_profile_stats.inode_time_ns, {
+                fd = openat(target_dir_fd, target_name, O_WRONLY | O_CREAT, 0644);
+            });
+            PROFILE_COUNT(g_profile_stats.inode_count);
+            if (fd < 0) {
+                rc = STREAM_PROC_ERR_IO;
+            } else {
+                close(fd);
+            }
+        }
+
+        if (rc == STREAM_PROC_SUCCESS) {
+            const char *name;
+            int dir_fd = current_file_dir_fd(state, &name);
+
+            // Replace whatever a previous restore left under this name
+            unlinkat(dir_fd, name, 0);
+
+            int link_result;
+            PROFILE_TIME_BLOCK(g_profile_stats.inode_time_ns, {
+                link_result = linkat(target_dir_fd, target_name, dir_fd, name, 0);
+            });
+            PROFILE_COUNT(g_profile_stats.inode_count);
+            if (link_result != 0) {
+                rc = STREAM_PROC_ERR_IO;
+            }
+        }
     }
 
-    // Get directory portion
-    char *dir = dirname(path_copy);
+    if (rc != STREAM_PROC_SUCCESS) {
+        snprintf(state->error_message, sizeof(state->error_message),
+                 "Failed to create hardlink %s/%s -> %s/%s: %s",
+                 state->output_dir, state->current_file->filename,
+                 state->output_dir, target, strerror(errno));
+        state->state = STATE_ERROR;
+        state->error_code = rc;
+    }
+
+    if (target_dir_fd >= 0) {
+        close(target_dir_fd);
+    }
+    return rc;
+}
 
-    // Build path component by component
+// Create one directory (relative to dir_fd), succeeding if it already exists
+static int make_directory(int dir_fd, const char *dir)
+{
+#ifdef BURST_PROFILE
+    int mkdir_result;
+    PROFILE_TIME_BLOCK(g_profile_stats.inode_time_ns, {
+        mkdir_result = mkdirat(dir_fd, dir, 0755);
+    });
+    PROFILE_COUNT(g_profile_stats.inode_count);
+    if (mkdir_result != 0 && errno != EEXIST) {
+#else
+    if (mkdirat(dir_fd, dir, 0755) != 0 && errno != EEXIST) {
+#endif
+        // Check if it exists as a directory
+        struct stat st;
+        if (fstatat(dir_fd, dir, &st, 0) != 0 || !S_ISDIR(st.st_mode)) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Create a directory and all of its missing ancestors
+static int make_directories(char *dir)
+{
     char *p = dir;
     while (*p == '/') p++;  // Skip leading slashes
 
@@ -1004,33 +1229,614 @@ static int ensure_directory_exists(const char *path)
             *slash = '\0';
         }
 
-        // Try to create directory
-#ifdef BURST_PROFILE
-        int mkdir_result;
+        int rc = make_directory(AT_FDCWD, dir);
+
+        if (slash) {
+            *slash = '/';
+            p = slash + 1;
+        } else {
+            p += strlen(p);
+        }
+        if (rc != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Ensure all directories in the path exist
+static int ensure_directory_exists(const char *path)
+{
+    // Make a copy since we'll modify it
+    char *path_copy = strdup(path);
+    if (path_copy == NULL) {
+        return -1;
+    }
+
+    int rc = make_directories(dirname(path_copy));
+    free(path_copy);
+    return rc;
+}
+
+// Ensure cd_result->dirs[index] exists under output_dir. Directories are shared
+// by all part processors of an extraction, so each is created by whichever
+// needs it first and afterwards costs an atomic load instead of a mkdir() per
+// path component.
+static int ensure_archive_dir(struct central_dir_parse_result *cd_result,
+                              const char *output_dir, size_t index)
+{
+    struct archive_dir *dir = &cd_result->dirs[index];
+    if (atomic_load_explicit(&dir->created, memory_order_acquire)) {
+        return 0;
+    }
+
+    int rc;
+    if (dir->parent == CENTRAL_DIR_NO_DIR) {
+        // The output directory itself, which may not exist yet either
+        char *path_copy = strdup(output_dir);
+        if (path_copy == NULL) {
+            return -1;
+        }
+        rc = make_directories(path_copy);
+        free(path_copy);
+    } else {
+        if (ensure_archive_dir(cd_result, output_dir, dir->parent) != 0) {
+            return -1;
+        }
+        char path[PATH_MAX];
+        int len = snprintf(path, sizeof(path), "%s/%s", output_dir, dir->path);
+        if (len < 0 || (size_t)len >= sizeof(path)) {
+            errno = ENAMETOOLONG;
+            return -1;
+        }
+        rc = make_directory(AT_FDCWD, path);
+    }
+
+    if (rc == 0) {
+        atomic_store_explicit(&dir->created, true, memory_order_release);
+    }
+    return rc;
+}
+
+// Ensure the parent directory of the entry named name exists
+static int ensure_entry_parent(struct central_dir_parse_result *cd_result,
+                               const char *output_dir, const char *name)
+{
+    const char *slash = strrchr(name, '/');
+    size_t index = central_dir_find_dir(cd_result, name, slash ? (size_t)(slash - name) : 0);
+    if (index != CENTRAL_DIR_NO_DIR) {
+        return ensure_archive_dir(cd_result, output_dir, index);
+    }
+
+    // Not in the directory table (or there is none): create it by path
+    char path[PATH_MAX];
+    int len = snprintf(path, sizeof(path), "%s/%s", output_dir, name);
+    if (len < 0 || (size_t)len >= sizeof(path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    return ensure_directory_exists(path);
+}
+
+static void dir_fd_cache_init(struct dir_fd_cache *cache)
+{
+    memset(cache, 0, sizeof(*cache));
+    for (size_t i = 0; i < DIR_FD_CACHE_SIZE; i++) {
+        cache->fd[i] = -1;
+    }
+    cache->root_fd = -1;
+}
+
+static void dir_fd_cache_release(struct dir_fd_cache *cache)
+{
+    for (size_t i = 0; i < DIR_FD_CACHE_SIZE; i++) {
+        if (cache->fd[i] >= 0) {
+            close(cache->fd[i]);
+            cache->fd[i] = -1;
+        }
+    }
+    if (cache->root_fd >= 0) {
+        close(cache->root_fd);
+        cache->root_fd = -1;
+    }
+}
+
+// An O_PATH fd for cd_result->dirs[index], creating the directory if needed.
+// The fd belongs to the cache and stays valid until the next call.
+static int dir_fd_cache_get(struct dir_fd_cache *cache,
+                            struct central_dir_parse_result *cd_result,
+                            const char *output_dir, size_t index)
+{
+    for (size_t i = 0; i < DIR_FD_CACHE_SIZE; i++) {
+        if (cache->fd[i] >= 0 && cache->dir_index[i] == index) {
+            cache->last_used[i] = ++cache->clock;
+            return cache->fd[i];
+        }
+    }
+
+    if (ensure_archive_dir(cd_result, output_dir, index) != 0) {
+        return -1;
+    }
+
+    // Open relative to the parent, so only the last component is looked up
+    const struct archive_dir *dir = &cd_result->dirs[index];
+    int fd;
+    if (dir->parent == CENTRAL_DIR_NO_DIR) {
+        fd = open(output_dir, O_PATH | O_DIRECTORY | O_CLOEXEC);
+    } else {
+        int parent_fd = dir_fd_cache_get(cache, cd_result, output_dir, dir->parent);
+        if (parent_fd < 0) {
+            return -1;
+        }
+        const char *slash = strrchr(dir->path, '/');
         PROFILE_TIME_BLOCK(g_profile_stats.inode_time_ns, {
-            mkdir_result = mkdir(dir, 0755);
+            fd = openat(parent_fd, slash ? slash + 1 : dir->path, O_PATH | O_DIRECTORY | O_CLOEXEC);
         });
         PROFILE_COUNT(g_profile_stats.inode_count);
-        if (mkdir_result != 0 && errno != EEXIST) {
-#else
-        if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
-#endif
-            // Check if it exists as a directory
-            struct stat st;
-            if (stat(dir, &st) != 0 || !S_ISDIR(st.st_mode)) {
-                free(path_copy);
-                return -1;
+    }
+    if (fd < 0) {
+        return -1;
+    }
+
+    // Take an unused slot, or else the least recently used one
+    size_t slot = 0;
+    for (size_t i = 0; i < DIR_FD_CACHE_SIZE; i++) {
+        if (cache->fd[i] < 0) {
+            slot = i;
+            break;
+        }
+        if (cache->last_used[i] < cache->last_used[slot]) {
+            slot = i;
+        }
+    }
+    if (cache->fd[slot] >= 0) {
+        close(cache->fd[slot]);
+    }
+    cache->dir_index[slot] = index;
+    cache->fd[slot] = fd;
+    cache->last_used[slot] = ++cache->clock;
+    return fd;
+}
+
+// Last path component of an archive name, keeping a directory's trailing
+// slash (fine for the *at() calls)
+static const char *entry_last_component(const char *filename)
+{
+    size_t len = strlen(filename);
+    if (len > 0 && filename[len - 1] == '/') {
+        len--;
+    }
+    while (len > 0 && filename[len - 1] != '/') {
+        len--;
+    }
+    return filename + len;
+}
+
+// Directory fd and name for *at() calls on the archive entry filename, whose
+// parent is cd_result->dirs[dir_index]: the parent's cached fd and the last
+// component, or an fd of output_dir and the whole archive name when there is
+// no directory table or the parent cannot be opened. The fd belongs to the
+// cache and stays valid until its next lookup.
+static int dir_fd_for(struct dir_fd_cache *cache, struct central_dir_parse_result *cd_result,
+                      const char *output_dir, size_t dir_index, const char *filename,
+                      const char **name)
+{
+    if (cd_result->dirs != NULL && dir_index != CENTRAL_DIR_NO_DIR) {
+        int fd = dir_fd_cache_get(cache, cd_result, output_dir, dir_index);
+        if (fd >= 0) {
+            *name = entry_last_component(filename);
+            return fd;
+        }
+    }
+
+    if (cache->root_fd < 0) {
+        cache->root_fd = open(output_dir, O_PATH | O_DIRECTORY | O_CLOEXEC);
+    }
+    while (*filename == '/') {
+        filename++;  // Relative to output_dir, as output_dir/filename would be
+    }
+    *name = filename;
+    return cache->root_fd;
+}
+
+// Directory fd and name for *at() calls on the current file
+static int current_file_dir_fd(struct part_processor_state *state, const char **name)
+{
+    struct file_context *file = state->current_file;
+    return dir_fd_for(&state->dir_fds, state->cd_result, state->output_dir,
+                      file->parent_dir, file->filename, name);
+}
+
+// A regular file with no content that is restored under its own name, so it
+// can be created from the central directory alone
+static bool is_empty_file(const struct file_metadata *file)
+{
+    size_t len = strlen(file->filename);
+    return file->uncompressed_size == 0 &&
+           !(len > 0 && file->filename[len - 1] == '/') &&
+           !file->is_symlink &&
+           file->hardlink_target == NULL &&
+           file->dedup_source == NULL &&
+           !file->data_omitted;
+}
+
+// Create an empty file (name relative to dir_fd, output_dir and archive name for messages)
+static int create_empty_file(int dir_fd, const char *name,
+                             const char *output_dir, const char *filename)
+{
+    int fd;
+    PROFILE_TIME_BLOCK(g_profile_stats.inode_time_ns, {
+        fd = openat(dir_fd, name, O_WRONLY | O_CREAT, 0644);
+    });
+    PROFILE_COUNT(g_profile_stats.inode_count);
+    if (fd < 0) {
+        return -1;
+    }
+
+    // Replace the content of a file left by a previous restore
+    if (ftruncate(fd, 0) != 0) {
+        fprintf(stderr, "Warning: failed to truncate %s/%s: %s\n",
+                output_dir, filename, strerror(errno));
+    }
+
+    close(fd);
+    return 0;
+}
+
+int stream_processor_materialize_entries(struct central_dir_parse_result *cd_result,
+                                         const char *output_dir,
+                                         size_t first, size_t count)
+{
+    if (cd_result == NULL || output_dir == NULL || cd_result->dirs == NULL ||
+        first > cd_result->num_files || count > cd_result->num_files - first) {
+        return -1;
+    }
+
+    struct dir_fd_cache dir_fds;
+    dir_fd_cache_init(&dir_fds);
+
+    int result = 0;
+    for (size_t i = first; i < first + count; i++) {
+        struct file_metadata *file = &cd_result->files[i];
+        size_t len = strlen(file->filename);
+
+        if (len > 0 && file->filename[len - 1] == '/') {
+            // The directory itself; its permissions are applied by
+            // stream_processor_apply_directory_metadata() once every part
+            // is done, after everything inside exists
+            size_t index = central_dir_find_dir(cd_result, file->filename, len - 1);
+            if (index != CENTRAL_DIR_NO_DIR &&
+                ensure_archive_dir(cd_result, output_dir, index) != 0) {
+                fprintf(stderr, "Failed to create directory %s/%s: %s\n",
+                        output_dir, file->filename, strerror(errno));
+                result = -1;
             }
+            continue;
         }
 
-        if (slash) {
-            *slash = '/';
-            p = slash + 1;
-        } else {
+        int dir_fd = dir_fd_cache_get(&dir_fds, cd_result, output_dir, file->parent_dir);
+        if (dir_fd < 0) {
+            fprintf(stderr, "Failed to create parent directory for %s/%s: %s\n",
+                    output_dir, file->filename, strerror(errno));
+            result = -1;
+            continue;
+        }
+
+        if (!is_empty_file(file) ||
+            atomic_exchange_explicit(&file->created, true, memory_order_acq_rel)) {
+            continue;
+        }
+
+        if (create_empty_file(dir_fd, entry_last_component(file->filename),
+                              output_dir, file->filename) != 0) {
+            fprintf(stderr, "Failed to create %s/%s: %s\n",
+                    output_dir, file->filename, strerror(errno));
+            result = -1;
+        }
+    }
+
+    dir_fd_cache_release(&dir_fds);
+    return result;
+}
+
+// Copy size bytes from offset in src_fd to the same offset in dst_fd through
+// a buffer. Returns 0 or -1 with errno set.
+static int copy_file_content(int src_fd, int dst_fd, off_t offset, uint64_t size)
+{
+    uint8_t *buffer = malloc(CLONE_COPY_BUFFER_SIZE);
+    if (buffer == NULL) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    int rc = 0;
+    while (size > 0) {
+        size_t len = size < CLONE_COPY_BUFFER_SIZE ? (size_t)size : CLONE_COPY_BUFFER_SIZE;
+        ssize_t n = pread(src_fd, buffer, len, offset);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            if (n == 0) {
+                errno = EIO;  // Source shorter than its central directory size
+            }
+            rc = -1;
             break;
         }
+        for (ssize_t done = 0; done < n;) {
+            ssize_t written = pwrite(dst_fd, buffer + done, (size_t)(n - done), offset + done);
+            if (written < 0 && errno == EINTR) {
+                continue;
+            }
+            if (written < 0) {
+                rc = -1;
+                break;
+            }
+            done += written;
+        }
+        if (rc != 0) {
+            break;
+        }
+        offset += n;
+        size -= (uint64_t)n;
     }
 
-    free(path_copy);
+    free(buffer);
+    return rc;
+}
+
+// Fill dst_fd with the first size bytes of src_fd. Returns 0 or -1 with errno set.
+static int clone_file_content(int src_fd, int dst_fd, uint64_t size)
+{
+    if (ioctl(dst_fd, FICLONE, src_fd) == 0) {
+        return 0;
+    }
+
+    // No shared extents here (other filesystem, or across mounts): copy in the
+    // kernel, or through a buffer where the kernel cannot copy between the two
+    uint64_t remaining = size;
+    off_t src_off = 0;
+    off_t dst_off = 0;
+    while (remaining > 0) {
+        ssize_t copied = copy_file_range(src_fd, &src_off, dst_fd, &dst_off, (size_t)remaining, 0);
+        if (copied < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == ENOSYS || errno == EXDEV || errno == EINVAL || errno == EOPNOTSUPP) {
+                return copy_file_content(src_fd, dst_fd, src_off, remaining);
+            }
+            return -1;
+        }
+        if (copied == 0) {
+            errno = EIO;  // Source shorter than its central directory size
+            return -1;
+        }
+        remaining -= (uint64_t)copied;
+    }
+    return 0;
+}
+
+// A part that will not run no longer keeps meta's shared fd open
+static void skip_shared_file(struct file_metadata *meta)
+{
+    if (meta == NULL || meta->num_parts_spanned <= 1) {
+        return;
+    }
+    meta->parts_pending--;
+    if (meta->parts_pending <= 0 && meta->shared_fd_holders == 0 && meta->shared_fd >= 0) {
+        close(meta->shared_fd);
+        meta->shared_fd = -1;
+    }
+}
+
+void stream_processor_skip_part(struct central_dir_parse_result *cd_result, uint32_t part_index)
+{
+    if (cd_result == NULL || part_index >= cd_result->num_parts) {
+        return;
+    }
+
+    struct part_files *part = &cd_result->parts[part_index];
+    pthread_mutex_lock(&shared_file_lock);
+    skip_shared_file(part->continuing_file);
+    for (size_t i = 0; i < part->num_entries; i++) {
+        skip_shared_file(&cd_result->files[part->entries[i].file_index]);
+    }
+    pthread_mutex_unlock(&shared_file_lock);
+}
+
+int stream_processor_clone_duplicates(struct central_dir_parse_result *cd_result,
+                                      const char *output_dir)
+{
+    if (cd_result == NULL || output_dir == NULL) {
+        return -1;
+    }
+
+    struct dir_fd_cache dir_fds;
+    dir_fd_cache_init(&dir_fds);
+
+    int result = 0;
+    for (size_t i = 0; i < cd_result->num_files; i++) {
+        const struct file_metadata *file = &cd_result->files[i];
+        if (file->dedup_source == NULL) {
+            if (file->data_omitted) {
+                fprintf(stderr, "Warning: no entry holds the content of %s; restored empty\n",
+                        file->filename);
+            }
+            continue;
+        }
+
+        if (ensure_entry_parent(cd_result, output_dir, file->filename) != 0) {
+            fprintf(stderr, "Failed to create parent directory for %s/%s\n",
+                    output_dir, file->filename);
+            result = -1;
+            continue;
+        }
+
+        // Each file is opened before the next lookup, which may evict its directory's fd
+        const char *name;
+        int src_fd = -1;
+        int dst_fd = -1;
+        int rc = -1;
+        PROFILE_TIME_BLOCK(g_profile_stats.inode_time_ns, {
+            int dir_fd = entry_dir_fd(&dir_fds, cd_result, output_dir, file->dedup_source, &name);
+            src_fd = openat(dir_fd, name, O_RDONLY);
+            // Truncate in place rather than replace, so hardlinks to this name keep working
+            dir_fd = entry_dir_fd(&dir_fds, cd_result, output_dir, file, &name);
+            dst_fd = openat(dir_fd, name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            rc = (src_fd >= 0 && dst_fd >= 0) ?
+                 clone_file_content(src_fd, dst_fd, file->dedup_source->uncompressed_size) : -1;
+        });
+        PROFILE_COUNT(g_profile_stats.inode_count);
+        if (rc != 0) {
+            fprintf(stderr, "Failed to copy %s/%s to %s/%s: %s\n",
+                    output_dir, file->dedup_source->filename, output_dir, file->filename,
+                    strerror(errno));
+            result = -1;
+        }
+
+        if (src_fd >= 0) {
+            close(src_fd);
+        }
+        if (dst_fd >= 0) {
+            close(dst_fd);
+        }
+    }
+
+    dir_fd_cache_release(&dir_fds);
+    return result;
+}
+
+// Directory fd and name for *at() calls on an entry (see dir_fd_for())
+static int entry_dir_fd(struct dir_fd_cache *cache, struct central_dir_parse_result *cd_result,
+                        const char *output_dir, const struct file_metadata *file,
+                        const char **name)
+{
+    return dir_fd_for(cache, cd_result, output_dir, file->parent_dir, file->filename, name);
+}
+
+// Apply ownership, then permissions (chown() clears set-user-ID bits), to an entry
+static void apply_entry_metadata(struct dir_fd_cache *cache,
+                                 struct central_dir_parse_result *cd_result,
+                                 const char *output_dir, const struct file_metadata *file,
+                                 bool is_root)
+{
+    if (!file->has_unix_mode && !(file->has_unix_extra && is_root)) {
+        return;
+    }
+
+    const char *name;
+    int dir_fd = entry_dir_fd(cache, cd_result, output_dir, file, &name);
+
+    if (file->has_unix_extra && is_root) {
+        int rc;
+        PROFILE_TIME_BLOCK(g_profile_stats.inode_time_ns, {
+            rc = fchownat(dir_fd, name, file->uid, file->gid, AT_SYMLINK_NOFOLLOW);
+        });
+        PROFILE_COUNT(g_profile_stats.inode_count);
+        if (rc != 0) {
+            fprintf(stderr, "Warning: failed to set ownership on %s/%s: %s\n",
+                    output_dir, file->filename, strerror(errno));
+        }
+    }
+
+    if (file->has_unix_mode) {
+        int rc;
+        PROFILE_TIME_BLOCK(g_profile_stats.inode_time_ns, {
+            rc = fchmodat(dir_fd, name, file->unix_mode & 07777, 0);
+        });
+        PROFILE_COUNT(g_profile_stats.inode_count);
+        if (rc != 0) {
+            fprintf(stderr, "Warning: failed to set permissions on %s/%s: %s\n",
+                    output_dir, file->filename, strerror(errno));
+        }
+    }
+}
+
+int stream_processor_apply_metadata(struct central_dir_parse_result *cd_result,
+                                    const char *output_dir,
+                                    size_t first, size_t count)
+{
+    if (cd_result == NULL || output_dir == NULL ||
+        first > cd_result->num_files || count > cd_result->num_files - first) {
+        return -1;
+    }
+
+    struct dir_fd_cache dir_fds;
+    dir_fd_cache_init(&dir_fds);
+    bool is_root = (geteuid() == 0);
+
+    for (size_t i = first; i < first + count; i++) {
+        const struct file_metadata *file = &cd_result->files[i];
+        size_t len = strlen(file->filename);
+
+        // Directories come last; symlinks get their owner when created, and
+        // hardlinks share the inode of their target
+        if ((len > 0 && file->filename[len - 1] == '/') ||
+            file->is_symlink || file->hardlink_target != NULL) {
+            continue;
+        }
+        apply_entry_metadata(&dir_fds, cd_result, output_dir, file, is_root);
+    }
+
+    dir_fd_cache_release(&dir_fds);
+    return 0;
+}
+
+struct dir_depth {
+    size_t file_index;
+    size_t depth;
+};
+
+static int compare_dir_depth_desc(const void *a, const void *b)
+{
+    const struct dir_depth *da = a;
+    const struct dir_depth *db = b;
+    if (da->depth != db->depth) {
+        return da->depth < db->depth ? 1 : -1;
+    }
+    return da->file_index < db->file_index ? -1 : (da->file_index > db->file_index);
+}
+
+int stream_processor_apply_directory_metadata(struct central_dir_parse_result *cd_result,
+                                              const char *output_dir)
+{
+    if (cd_result == NULL || output_dir == NULL) {
+        return -1;
+    }
+
+    struct dir_depth *order = malloc((cd_result->num_files + 1) * sizeof(struct dir_depth));
+    if (order == NULL) {
+        return -1;
+    }
+
+    size_t num_dirs = 0;
+    for (size_t i = 0; i < cd_result->num_files; i++) {
+        const char *name = cd_result->files[i].filename;
+        size_t len = strlen(name);
+        if (len == 0 || name[len - 1] != '/') {
+            continue;
+        }
+        size_t depth = 0;
+        for (size_t j = 0; j + 1 < len; j++) {
+            depth += (name[j] == '/');
+        }
+        order[num_dirs++] = (struct dir_depth){ i, depth };
+    }
+
+    // Children first, so a read-only mode never stops a parent being entered
+    qsort(order, num_dirs, sizeof(struct dir_depth), compare_dir_depth_desc);
+
+    struct dir_fd_cache dir_fds;
+    dir_fd_cache_init(&dir_fds);
+    bool is_root = (geteuid() == 0);
+
+    for (size_t i = 0; i < num_dirs; i++) {
+        apply_entry_metadata(&dir_fds, cd_result, output_dir,
+                             &cd_result->files[order[i].file_index], is_root);
+    }
+
+    dir_fd_cache_release(&dir_fds);
+    free(order);
     return 0;
 }
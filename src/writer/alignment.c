@@ -104,6 +104,29 @@ int alignment_write_padding_frame(struct burst_writer *writer, size_t padding_si
     return 0;
 }
 
+// Write zero marker frame
+int alignment_write_zero_marker(struct burst_writer *writer) {
+    // Zero marker frame format:
+    // - Magic: 0x184D2A5B (4 bytes)
+    // - Frame size: 1 byte (4 bytes)
+    // - BURST info type flag: 0x02 (1 byte)
+    // Decoders that do not know the type skip it like padding and decompress
+    // the zero frame that follows as usual.
+    uint8_t marker[BURST_ZERO_MARKER_SIZE];
+    uint32_t magic = BURST_MAGIC_NUMBER;
+    uint32_t frame_size = 1;
+    memcpy(marker, &magic, sizeof(magic));
+    memcpy(marker + 4, &frame_size, sizeof(frame_size));
+    marker[8] = BURST_TYPE_ZERO_FRAME;
+
+    if (burst_writer_write(writer, marker, sizeof(marker)) != 0) {
+        return -1;
+    }
+    writer->padding_bytes += sizeof(marker);
+
+    return 0;
+}
+
 // Write Start-of-Part metadata frame
 int alignment_write_start_of_part_frame(struct burst_writer *writer,
                                         uint64_t uncompressed_offset) {
@@ -0,0 +1,388 @@
+#include "base_archive.h"
+#include "burst_writer.h"
+#include "zip_structures.h"
+#include "central_dir_parser.h"
+#include "frame_parser.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <zlib.h>
+#include <zstd.h>
+
+// Enough of the tail to hold the EOCD records and the longest possible comment
+#define BASE_TAIL_SIZE (128 * 1024)
+
+// Read window for copying frames; must hold at least one worst-case frame
+#define BASE_WINDOW_SIZE (1024 * 1024)
+
+#define EMPTY_SLOT SIZE_MAX
+
+struct base_archive {
+    int fd;
+    uint64_t size;
+    struct central_dir_parse_result cd;
+
+    // Open-addressing hash table of file indices, keyed by filename
+    size_t *slots;
+    size_t num_slots;            // Power of two
+};
+
+struct base_frame_reader {
+    int fd;
+    uint64_t pos;                // Next archive offset to parse
+    uint64_t end;                // End of the file's compressed data
+    uint64_t uncompressed_done;
+    uint64_t uncompressed_total;
+    uint32_t crc32;
+    const uint8_t *content_hash;  // Into the base's central directory, NULL if none
+
+    // Buffered window [window_start, window_start + window_len) of the archive
+    uint8_t *window;
+    uint64_t window_start;
+    size_t window_len;
+};
+
+static uint64_t hash_name(const char *name) {
+    // FNV-1a
+    uint64_t h = 1469598103934665603ULL;
+    for (const unsigned char *p = (const unsigned char *)name; *p; p++) {
+        h ^= *p;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+static int pread_fully(int fd, void *buf, size_t len, uint64_t offset) {
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = pread(fd, (uint8_t *)buf + done, len - done, (off_t)(offset + done));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        if (n == 0) {
+            errno = EIO;
+            return -1;
+        }
+        done += (size_t)n;
+    }
+    return 0;
+}
+
+static int build_name_index(struct base_archive *base) {
+    size_t num_slots = 16;
+    while (num_slots < base->cd.num_files * 2) {
+        num_slots *= 2;
+    }
+
+    base->slots = malloc(num_slots * sizeof(size_t));
+    if (!base->slots) {
+        return -1;
+    }
+    for (size_t i = 0; i < num_slots; i++) {
+        base->slots[i] = EMPTY_SLOT;
+    }
+    base->num_slots = num_slots;
+
+    for (size_t i = 0; i < base->cd.num_files; i++) {
+        size_t slot = hash_name(base->cd.files[i].filename) & (num_slots - 1);
+        while (base->slots[slot] != EMPTY_SLOT) {
+            slot = (slot + 1) & (num_slots - 1);
+        }
+        base->slots[slot] = i;
+    }
+    return 0;
+}
+
+struct base_archive *base_archive_open(const char *path) {
+    struct base_archive *base = calloc(1, sizeof(struct base_archive));
+    if (!base) {
+        return NULL;
+    }
+
+    base->fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (base->fd < 0) {
+        fprintf(stderr, "Error: Cannot open base archive %s (%s)\n", path, strerror(errno));
+        free(base);
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(base->fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        fprintf(stderr, "Error: Base archive is not a regular file: %s\n", path);
+        close(base->fd);
+        free(base);
+        return NULL;
+    }
+    base->size = (uint64_t)st.st_size;
+
+    size_t tail_size = base->size < BASE_TAIL_SIZE ? (size_t)base->size : BASE_TAIL_SIZE;
+    uint8_t *tail = malloc(tail_size > 0 ? tail_size : 1);
+    if (!tail || pread_fully(base->fd, tail, tail_size, base->size - tail_size) != 0) {
+        fprintf(stderr, "Error: Cannot read base archive %s\n", path);
+        free(tail);
+        base_archive_close(base);
+        return NULL;
+    }
+
+    uint64_t cd_offset = 0;
+    uint64_t cd_size = 0;
+    bool is_zip64 = false;
+    char error_msg[256] = {0};
+    int rc = central_dir_parse_eocd_only(tail, tail_size, base->size,
+                                         &cd_offset, &cd_size, NULL, &is_zip64,
+                                         NULL, error_msg);
+    free(tail);
+    if (rc != CENTRAL_DIR_PARSE_SUCCESS) {
+        fprintf(stderr, "Error: Cannot parse base archive %s: %s\n", path, error_msg);
+        base_archive_close(base);
+        return NULL;
+    }
+
+    uint8_t *cd_buffer = malloc(cd_size > 0 ? (size_t)cd_size : 1);
+    if (!cd_buffer || pread_fully(base->fd, cd_buffer, (size_t)cd_size, cd_offset) != 0) {
+        fprintf(stderr, "Error: Cannot read central directory of base archive %s\n", path);
+        free(cd_buffer);
+        base_archive_close(base);
+        return NULL;
+    }
+
+    rc = central_dir_parse_from_cd_buffer(cd_buffer, (size_t)cd_size, cd_offset, cd_size,
+                                          base->size, BURST_BASE_PART_SIZE, is_zip64,
+                                          &base->cd);
+    free(cd_buffer);
+    if (rc != CENTRAL_DIR_PARSE_SUCCESS) {
+        fprintf(stderr, "Error: Cannot parse central directory of base archive %s: %s\n",
+                path, base->cd.error_message);
+        base_archive_close(base);
+        return NULL;
+    }
+
+    if (build_name_index(base) != 0) {
+        base_archive_close(base);
+        return NULL;
+    }
+
+    return base;
+}
+
+void base_archive_close(struct base_archive *base) {
+    if (!base) {
+        return;
+    }
+    if (base->fd >= 0) {
+        close(base->fd);
+    }
+    central_dir_parse_result_free(&base->cd);
+    free(base->slots);
+    free(base);
+}
+
+size_t base_archive_num_files(const struct base_archive *base) {
+    return base ? base->cd.num_files : 0;
+}
+
+const struct file_metadata *base_archive_find_unchanged(struct base_archive *base,
+                                                        const char *name,
+                                                        const struct stat *st) {
+    if (!base || !name || !st || !S_ISREG(st->st_mode) || st->st_size <= 0) {
+        return NULL;
+    }
+
+    size_t slot = hash_name(name) & (base->num_slots - 1);
+    const struct file_metadata *file = NULL;
+    while (base->slots[slot] != EMPTY_SLOT) {
+        const struct file_metadata *candidate = &base->cd.files[base->slots[slot]];
+        if (strcmp(candidate->filename, name) == 0) {
+            file = candidate;
+            break;
+        }
+        slot = (slot + 1) & (base->num_slots - 1);
+    }
+    if (!file) {
+        return NULL;
+    }
+
+    if (file->compression_method != ZIP_METHOD_ZSTD || file->is_symlink ||
+        file->uncompressed_size != (uint64_t)st->st_size) {
+        return NULL;
+    }
+
+    // The DOS time in the headers has 2 second resolution and no time zone, so
+    // only entries that recorded the precise stat of their source are trusted
+    if (!file->has_source_stat ||
+        file->mtime_sec != (int64_t)st->st_mtim.tv_sec ||
+        file->mtime_nsec != (uint32_t)st->st_mtim.tv_nsec ||
+        file->ctime_sec != (int64_t)st->st_ctim.tv_sec ||
+        file->ctime_nsec != (uint32_t)st->st_ctim.tv_nsec ||
+        file->ino != (uint64_t)st->st_ino) {
+        return NULL;
+    }
+
+    return file;
+}
+
+int base_archive_verify_crc(const struct file_metadata *file, const char *path) {
+    FILE *input = fopen(path, "rb");
+    if (!input) {
+        return -1;
+    }
+
+    uint8_t *buffer = malloc(BURST_FRAME_SIZE);
+    if (!buffer) {
+        fclose(input);
+        return -1;
+    }
+
+    uint32_t crc = 0;
+    uint64_t total = 0;
+    size_t n;
+    while ((n = fread(buffer, 1, BURST_FRAME_SIZE, input)) > 0) {
+        crc = crc32(crc, buffer, n);
+        total += n;
+    }
+    bool read_error = ferror(input) != 0;
+
+    free(buffer);
+    fclose(input);
+
+    if (read_error || total != file->uncompressed_size || crc != file->crc32) {
+        return -1;
+    }
+    return 0;
+}
+
+// Make at least need bytes at reader->pos available in the window
+// (fewer if the file's data ends first). Returns the bytes available.
+static size_t window_fill(struct base_frame_reader *reader, size_t need) {
+    uint64_t available_to_end = reader->end - reader->pos;
+    if (need > available_to_end) {
+        need = (size_t)available_to_end;
+    }
+
+    if (reader->pos >= reader->window_start &&
+        reader->pos + need <= reader->window_start + reader->window_len) {
+        return (size_t)(reader->window_start + reader->window_len - reader->pos);
+    }
+
+    size_t len = available_to_end < BASE_WINDOW_SIZE ? (size_t)available_to_end : BASE_WINDOW_SIZE;
+    if (pread_fully(reader->fd, reader->window, len, reader->pos) != 0) {
+        reader->window_len = 0;
+        return 0;
+    }
+    reader->window_start = reader->pos;
+    reader->window_len = len;
+    return len;
+}
+
+struct base_frame_reader *base_frame_reader_open(struct base_archive *base,
+                                                 const struct file_metadata *file) {
+    struct zip_local_header lfh;
+    if (pread_fully(base->fd, &lfh, sizeof(lfh), file->local_header_offset) != 0 ||
+        lfh.signature != ZIP_LOCAL_FILE_HEADER_SIG ||
+        lfh.compression_method != ZIP_METHOD_ZSTD) {
+        fprintf(stderr, "Error: Base archive has no valid local header for %s\n", file->filename);
+        return NULL;
+    }
+
+    uint64_t data_start = file->local_header_offset + sizeof(lfh) +
+                          lfh.filename_length + lfh.extra_field_length;
+    if (data_start + file->compressed_size > base->size) {
+        fprintf(stderr, "Error: Base archive data for %s is truncated\n", file->filename);
+        return NULL;
+    }
+
+    struct base_frame_reader *reader = calloc(1, sizeof(struct base_frame_reader));
+    if (!reader) {
+        return NULL;
+    }
+    reader->window = malloc(BASE_WINDOW_SIZE);
+    if (!reader->window) {
+        free(reader);
+        return NULL;
+    }
+    reader->fd = base->fd;
+    reader->pos = data_start;
+    reader->end = data_start + file->compressed_size;
+    reader->uncompressed_total = file->uncompressed_size;
+    reader->crc32 = file->crc32;
+    reader->content_hash = file->has_content_hash ? file->content_hash : NULL;
+    return reader;
+}
+
+void base_frame_reader_close(struct base_frame_reader *reader) {
+    if (!reader) {
+        return;
+    }
+    free(reader->window);
+    free(reader);
+}
+
+int base_frame_reader_next(struct base_frame_reader *reader, struct base_frame *frame) {
+    if (reader->uncompressed_done >= reader->uncompressed_total) {
+        return 0;  // Anything left is trailing padding or Start-of-Part metadata
+    }
+
+    bool zero = false;
+    for (;;) {
+        size_t available = window_fill(reader, 8);
+        if (available < 8) {
+            return -1;
+        }
+        const uint8_t *ptr = reader->window + (reader->pos - reader->window_start);
+
+        uint32_t magic;
+        memcpy(&magic, ptr, sizeof(magic));
+        if (magic == BURST_SKIPPABLE_MAGIC) {
+            // Padding or Start-of-Part: the writer lays out its own.
+            // A zero marker is kept as a flag on the frame that follows.
+            uint32_t payload_size;
+            memcpy(&payload_size, ptr + 4, sizeof(payload_size));
+            zero = false;
+            if (payload_size == 1 && window_fill(reader, 9) >= 9) {
+                ptr = reader->window + (reader->pos - reader->window_start);
+                zero = ptr[8] == BURST_TYPE_ZERO_FRAME;
+            }
+            reader->pos += 8 + (uint64_t)payload_size;
+            if (reader->pos > reader->end) {
+                return -1;
+            }
+            continue;
+        }
+
+        available = window_fill(reader, ZSTD_compressBound(BURST_FRAME_SIZE));
+        ptr = reader->window + (reader->pos - reader->window_start);
+
+        struct frame_info info;
+        if (parse_next_frame(ptr, available, &info) != STREAM_PROC_SUCCESS ||
+            info.type != FRAME_ZSTD_COMPRESSED ||
+            info.uncompressed_size > BURST_FRAME_SIZE ||
+            reader->uncompressed_done + info.uncompressed_size > reader->uncompressed_total) {
+            return -1;
+        }
+
+        reader->pos += info.frame_size;
+        reader->uncompressed_done += info.uncompressed_size;
+
+        frame->data = ptr;
+        frame->compressed_size = info.frame_size;
+        frame->uncompressed_size = (size_t)info.uncompressed_size;
+        frame->at_eof = reader->uncompressed_done == reader->uncompressed_total;
+        frame->is_zero = zero;
+        return 1;
+    }
+}
+
+uint32_t base_frame_reader_crc32(const struct base_frame_reader *reader) {
+    return reader->crc32;
+}
+
+const uint8_t *base_frame_reader_content_hash(const struct base_frame_reader *reader) {
+    return reader->content_hash;
+}
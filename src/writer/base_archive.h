@@ -0,0 +1,72 @@
+#ifndef BURST_BASE_ARCHIVE_H
+#define BURST_BASE_ARCHIVE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/stat.h>
+
+/*
+ * Previous BURST archive used as the base of an incremental run (--base).
+ *
+ * The base's central directory is parsed with the downloader's
+ * central_dir_parse code. A regular file whose name, size, modification and
+ * change times (to the nanosecond) and inode match a base entry is considered
+ * unchanged, and its Zstandard frames
+ * are copied from the base instead of being recompressed. The writer re-runs
+ * its alignment logic around the copied frames, so the new archive is a
+ * complete, standalone BURST archive.
+ */
+
+struct base_archive;
+struct base_frame_reader;
+struct file_metadata;
+
+// One Zstandard frame copied from the base, valid until the next read
+struct base_frame {
+    const uint8_t *data;
+    size_t compressed_size;
+    size_t uncompressed_size;
+    bool at_eof;                 // Last frame of the file
+    bool is_zero;                // Preceded by a zero marker: decompresses to zeros
+};
+
+// Open path and parse its central directory. Returns NULL (with a message) on error.
+struct base_archive *base_archive_open(const char *path);
+
+void base_archive_close(struct base_archive *base);
+
+size_t base_archive_num_files(const struct base_archive *base);
+
+/*
+ * Look up name in the base. Returns its metadata if it is a non-empty
+ * Zstandard-compressed regular file with the same size as st, and its BURST
+ * source stat extra field has the same mtime, ctime and inode. Returns NULL
+ * if it has to be archived from scratch, including for entries written
+ * without a source stat.
+ */
+const struct file_metadata *base_archive_find_unchanged(struct base_archive *base,
+                                                        const char *name,
+                                                        const struct stat *st);
+
+// Read path and check it against file's CRC32 and size.
+// Returns 0 if they match, -1 otherwise.
+int base_archive_verify_crc(const struct file_metadata *file, const char *path);
+
+// Iterate over the Zstandard frames of a base file, skipping padding and
+// Start-of-Part frames. Returns NULL if the local header does not match.
+struct base_frame_reader *base_frame_reader_open(struct base_archive *base,
+                                                 const struct file_metadata *file);
+
+void base_frame_reader_close(struct base_frame_reader *reader);
+
+// Returns 1 with *frame filled, 0 after the last frame, -1 if the base is corrupt.
+int base_frame_reader_next(struct base_frame_reader *reader, struct base_frame *frame);
+
+// CRC32 of the file's uncompressed data, as recorded in the base
+uint32_t base_frame_reader_crc32(const struct base_frame_reader *reader);
+
+// SHA-256 of the file's data as recorded in the base, or NULL if it has none
+const uint8_t *base_frame_reader_content_hash(const struct base_frame_reader *reader);
+
+#endif // BURST_BASE_ARCHIVE_H
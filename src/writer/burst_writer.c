@@ -1,13 +1,22 @@
+#define _GNU_SOURCE  // SEEK_DATA, SEEK_HOLE
 #include "burst_writer.h"
 #include "zip_structures.h"
 #include "compression.h"
 #include "alignment.h"
+#include "compress_pool.h"
+#include "encoded_reader.h"
+#include "base_archive.h"
+#include "content_hash.h"
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 #define INITIAL_FILES_CAPACITY 16
 #define WRITE_BUFFER_SIZE (64 * 1024)  // 64 KiB write buffer
+#define ZSTD_CHUNK_SIZE BURST_FRAME_SIZE  // 128 KiB chunks (BTRFS maximum)
+#define COMPRESS_JOBS_PER_THREAD 2     // Chunks in flight per compression thread
 
 // Test mode: Force padding LFH at specific offsets for testing
 #ifdef BURST_TEST_FORCE_PADDING_LFH
@@ -31,19 +40,20 @@ static bool should_force_padding(uint64_t current_offset) {
 }
 #endif
 
-struct burst_writer* burst_writer_create(FILE *output, int compression_level) {
-    if (!output) {
-        return NULL;
-    }
-
+static struct burst_writer* writer_create(FILE *output,
+                                          burst_output_fn output_fn, void *output_ctx,
+                                          int compression_level) {
     struct burst_writer *writer = calloc(1, sizeof(struct burst_writer));
     if (!writer) {
         return NULL;
     }
 
     writer->output = output;
+    writer->output_fn = output_fn;
+    writer->output_ctx = output_ctx;
     writer->current_offset = 0;
     writer->compression_level = compression_level;
+    writer->num_threads = 1;
 
     // Allocate file tracking array
     writer->files_capacity = INITIAL_FILES_CAPACITY;
@@ -74,6 +84,21 @@ struct burst_writer* burst_writer_create(FILE *output, int compression_level) {
     return writer;
 }
 
+struct burst_writer* burst_writer_create(FILE *output, int compression_level) {
+    if (!output) {
+        return NULL;
+    }
+    return writer_create(output, NULL, NULL, compression_level);
+}
+
+struct burst_writer* burst_writer_create_with_sink(burst_output_fn output_fn, void *output_ctx,
+                                                   int compression_level) {
+    if (!output_fn) {
+        return NULL;
+    }
+    return writer_create(NULL, output_fn, output_ctx, compression_level);
+}
+
 void burst_writer_destroy(struct burst_writer *writer) {
     if (!writer) {
         return;
@@ -83,6 +108,7 @@ void burst_writer_destroy(struct burst_writer *writer) {
     if (writer->files) {
         for (size_t i = 0; i < writer->num_files; i++) {
             free(writer->files[i].filename);
+            free(writer->files[i].hardlink_target);
         }
         free(writer->files);
     }
@@ -95,9 +121,53 @@ void burst_writer_destroy(struct burst_writer *writer) {
         ZSTD_freeCCtx(writer->zstd_ctx);
     }
 
+    compress_pool_destroy(writer->compress_pool);
+
+    free(writer->zero_frame);
+
     free(writer);
 }
 
+int burst_writer_set_threads(struct burst_writer *writer, int num_threads) {
+    if (!writer || num_threads < 1) {
+        return -1;
+    }
+
+    compress_pool_destroy(writer->compress_pool);
+    writer->compress_pool = NULL;
+    writer->num_threads = 1;
+
+    if (num_threads == 1) {
+        return 0;
+    }
+
+    writer->compress_pool = compress_pool_create(
+        num_threads, (size_t)num_threads * COMPRESS_JOBS_PER_THREAD);
+    if (!writer->compress_pool) {
+        fprintf(stderr, "Failed to create compression thread pool\n");
+        return -1;
+    }
+    writer->num_threads = num_threads;
+
+    return 0;
+}
+
+int burst_writer_set_encoded_read(struct burst_writer *writer, bool enable) {
+    if (!writer) {
+        return -1;
+    }
+    writer->encoded_read = enable;
+    return 0;
+}
+
+int burst_writer_set_content_hashing(struct burst_writer *writer, bool enable) {
+    if (!writer) {
+        return -1;
+    }
+    writer->hash_content = enable;
+    return 0;
+}
+
 int burst_writer_write(struct burst_writer *writer, const void *data, size_t len) {
     if (!writer || !data) {
         return -1;
@@ -131,10 +201,17 @@ int burst_writer_flush(struct burst_writer *writer) {
         return 0;
     }
 
-    size_t written = fwrite(writer->write_buffer, 1, writer->buffer_used, writer->output);
-    if (written != writer->buffer_used) {
-        fprintf(stderr, "Failed to write to output: %s\n", strerror(errno));
-        return -1;
+    if (writer->output_fn) {
+        if (writer->output_fn(writer->output_ctx, writer->write_buffer, writer->buffer_used) != 0) {
+            fprintf(stderr, "Failed to write to output\n");
+            return -1;
+        }
+    } else {
+        size_t written = fwrite(writer->write_buffer, 1, writer->buffer_used, writer->output);
+        if (written != writer->buffer_used) {
+            fprintf(stderr, "Failed to write to output: %s\n", strerror(errno));
+            return -1;
+        }
     }
 
     writer->current_offset += writer->buffer_used;
@@ -235,80 +312,235 @@ static int check_alignment_and_pad(struct burst_writer *writer,
 }
 
 /*
-burst_writer_add_file adds a file to the BURST archive.
-It may write a number of structures to the output in the process:
-- Local File Header (from caller)
-- Zstandard frames representing some compressed file data
-- Zip Data Descriptor
-- Zstandard skippable padding frames
-- Zstandard Start-of-Part metadata frames
-- Unlisted padding Local File Header (for alignment of header-only files)
+ * Write one compressed frame of the current file, preceded or followed by
+ * whatever padding and Start-of-Part frames the 8 MiB alignment rules require.
+ * uncompressed_before is the file's uncompressed offset at the start of the frame.
+ * zero frames are preceded by a zero marker, kept in the same part as the frame.
+ */
+static int emit_frame(struct burst_writer *writer,
+                      const uint8_t *frame,
+                      size_t frame_size,
+                      uint64_t uncompressed_before,
+                      size_t chunk_size,
+                      bool at_eof,
+                      bool zero) {
+    // Phase 3: Check alignment before writing frame
+    uint64_t write_pos = alignment_get_write_position(writer);
 
-It is responsible for ensuring that it does not write any type of data
-other than a Start-of-Part frame or a Local File Header at an 8MiB part boundary,
-and for ensuring that sufficient free space to the next boundary exists for a minimal
-local file header.
-*/
-int burst_writer_add_file(struct burst_writer *writer,
-                          FILE *input_file,
-                          struct zip_local_header *lfh,
-                          int lfh_len,
-                          bool is_header_only,
-                          uint32_t unix_mode,
-                          uint32_t uid,
-                          uint32_t gid) {
-    if (!writer || !input_file || !lfh || lfh_len <= 0) {
+    struct alignment_decision decision = alignment_decide(
+        write_pos,
+        frame_size + (zero ? BURST_ZERO_MARKER_SIZE : 0),
+        at_eof
+    );
+
+    // Execute alignment actions
+    if (decision.action == ALIGNMENT_PAD_THEN_FRAME) {
+        // Write padding to reach boundary
+        if (alignment_write_padding_frame(writer, decision.padding_size) != 0) {
+            return -1;
+        }
+    } else if (decision.action == ALIGNMENT_PAD_THEN_METADATA) {
+        // Write padding, then Start-of-Part metadata
+        if (alignment_write_padding_frame(writer, decision.padding_size) != 0) {
+            return -1;
+        }
+
+        // Write Start-of-Part frame with current uncompressed offset
+        if (alignment_write_start_of_part_frame(writer, uncompressed_before) != 0) {
+            return -1;
+        }
+    }
+
+    if (zero) {
+        if (alignment_write_zero_marker(writer) != 0) {
+            return -1;
+        }
+        writer->zero_frames++;
+    }
+
+    // Write compressed frame
+    if (burst_writer_write(writer, frame, frame_size) < 0) {
         return -1;
     }
 
-    // Get file size
-    long file_size = 0;
-    if (!is_header_only) {
-        if (fseek(input_file, 0, SEEK_END) != 0) {
-            fprintf(stderr, "Failed to seek input file: %s\n", strerror(errno));
+    // Handle exact-fit mid-file case: write Start-of-Part at boundary
+    if (decision.action == ALIGNMENT_WRITE_FRAME_THEN_METADATA) {
+        if (alignment_write_start_of_part_frame(writer, uncompressed_before + chunk_size) != 0) {
             return -1;
         }
-        if (file_size < 0) {
-            fprintf(stderr, "Failed to get file size: %s\n", strerror(errno));
+    }
+
+    return 0;
+}
+
+bool burst_buffer_is_zero(const uint8_t *data, size_t len) {
+    return len > 0 && data[0] == 0 && memcmp(data, data + 1, len - 1) == 0;
+}
+
+// Source of zeros for hole chunks, which are never read
+static uint8_t zero_chunk[ZSTD_CHUNK_SIZE];
+
+/*
+ * Emit chunk_size zero bytes of the current file: a zero marker, then the
+ * frame compress_chunk() produces for zeros, so other extractors see an
+ * ordinary frame. The frame for a full chunk is compressed once per writer.
+ */
+static int emit_zero_frame(struct burst_writer *writer,
+                           uint64_t uncompressed_before,
+                           size_t chunk_size,
+                           bool at_eof) {
+    const uint8_t *frame = writer->zero_frame;
+    size_t frame_size = writer->zero_frame_size;
+    uint8_t *scratch = NULL;
+
+    if (chunk_size != ZSTD_CHUNK_SIZE || !writer->zero_frame) {
+        scratch = malloc(ZSTD_compressBound(ZSTD_CHUNK_SIZE));
+        if (!scratch) {
+            fprintf(stderr, "Failed to allocate compression buffer\n");
             return -1;
         }
-        rewind(input_file);
+
+        struct compression_result comp_result = compress_chunk(
+            scratch, ZSTD_compressBound(ZSTD_CHUNK_SIZE),
+            zero_chunk, chunk_size,
+            writer->compression_level);
+        if (comp_result.error) {
+            fprintf(stderr, "Zstandard compression error: %s\n",
+                    comp_result.error_message);
+            free(scratch);
+            return -1;
+        }
+
+        frame = scratch;
+        frame_size = comp_result.compressed_size;
+        if (chunk_size == ZSTD_CHUNK_SIZE) {
+            writer->zero_frame = scratch;
+            writer->zero_frame_size = frame_size;
+            scratch = NULL;
+        }
     }
 
-    if (ensure_file_capacity(writer) != 0) {
-        return -1;
+    int rc = emit_frame(writer, frame, frame_size, uncompressed_before,
+                        chunk_size, at_eof, true);
+    free(scratch);
+    return rc;
+}
+
+/*
+ * Holes of a sparse input file, located with SEEK_DATA/SEEK_HOLE so chunks
+ * inside them are skipped rather than read. Only used for files that occupy
+ * fewer blocks than their size.
+ */
+struct hole_finder {
+    FILE *input;                 // NULL if the file has no holes
+    uint64_t file_size;
+    uint64_t data_start;         // Next data at or after the last lookup
+    uint64_t data_end;           // End of that data
+};
+
+static void hole_finder_init(struct hole_finder *holes, FILE *input_file) {
+    struct stat st;
+
+    memset(holes, 0, sizeof(*holes));
+    if (fstat(fileno(input_file), &st) == 0 && S_ISREG(st.st_mode) &&
+        (uint64_t)st.st_blocks * 512 < (uint64_t)st.st_size) {
+        holes->input = input_file;
+        holes->file_size = (uint64_t)st.st_size;
     }
+}
 
-    struct file_entry *entry = allocate_file_entry(writer, lfh);
-    if (!entry) {
-        return -1;
+// True if [pos, pos + len) lies entirely in a hole.
+static bool hole_finder_is_hole(struct hole_finder *holes, uint64_t pos, size_t len) {
+    if (!holes->input || pos + len > holes->file_size) {
+        return false;
     }
 
-    // Files have unknown content size at this point (content_size=0) and use data descriptors
-    if (check_alignment_and_pad(writer, (size_t)lfh_len, 0, true) != 0) {
-        free(entry->filename);
-        return -1;
+    if (pos >= holes->data_end) {
+        int fd = fileno(holes->input);
+        off_t data = lseek(fd, (off_t)pos, SEEK_DATA);
+        if (data < 0) {
+            if (errno != ENXIO) {
+                // SEEK_DATA not supported here: read everything
+                holes->input = NULL;
+                return false;
+            }
+            // No data up to end of file
+            holes->data_start = UINT64_MAX;
+            holes->data_end = UINT64_MAX;
+        } else {
+            off_t hole = lseek(fd, data, SEEK_HOLE);
+            holes->data_start = (uint64_t)data;
+            holes->data_end = hole < 0 ? UINT64_MAX : (uint64_t)hole;
+        }
+
+        // The lookups moved the descriptor under the stream
+        if (fseeko(holes->input, (off_t)pos, SEEK_SET) != 0) {
+            holes->input = NULL;
+            return false;
+        }
     }
 
-    populate_entry_metadata(entry, lfh,
-                           writer->current_offset + writer->buffer_used,
-                           unix_mode, uid, gid);
+    return pos + len <= holes->data_start;
+}
 
-    // Write the pre-constructed local file header directly
-    if (burst_writer_write(writer, lfh, lfh_len) < 0) {
-        free(entry->filename);
-        return -1;
+/*
+ * Fetch the chunk of input_file at uncompressed offset pos into buffer.
+ * Returns the chunk size, 0 at end of file. Chunks in a hole are skipped
+ * without reading (*in_hole, buffer untouched); *zero is set for any chunk
+ * of zeros. *at_eof follows the same test as a plain fread() loop.
+ */
+static size_t read_chunk(struct burst_writer *writer,
+                         FILE *input_file,
+                         struct hole_finder *holes,
+                         uint64_t pos,
+                         uint8_t *buffer,
+                         bool *in_hole,
+                         bool *zero,
+                         bool *at_eof) {
+    if (holes->input && pos < holes->file_size) {
+        uint64_t remaining = holes->file_size - pos;
+        size_t len = remaining < ZSTD_CHUNK_SIZE ? (size_t)remaining : ZSTD_CHUNK_SIZE;
+
+        if (hole_finder_is_hole(holes, pos, len) &&
+            fseeko(input_file, (off_t)(pos + len), SEEK_SET) == 0) {
+            writer->hole_bytes += len;
+            *in_hole = true;
+            *zero = true;
+            *at_eof = len < ZSTD_CHUNK_SIZE;
+            return len;
+        }
     }
 
-    entry->compressed_start_offset = writer->current_offset + writer->buffer_used;
-    entry->uncompressed_start_offset = 0;  // Will be set by alignment logic in Phase 3
+    size_t bytes_read = fread(buffer, 1, ZSTD_CHUNK_SIZE, input_file);
+    *in_hole = false;
+    *zero = burst_buffer_is_zero(buffer, bytes_read);
+    *at_eof = (bytes_read < ZSTD_CHUNK_SIZE) || feof(input_file);
+    return bytes_read;
+}
 
-    // Read and compress file data
+// CRC32 of the file so far extended by len zeros, without rereading zeros
+// for every full chunk of a hole
+static uint32_t crc32_zeros(struct burst_writer *writer, uint32_t crc, size_t len) {
+    if (len != ZSTD_CHUNK_SIZE) {
+        return crc32(crc, zero_chunk, len);
+    }
+    if (writer->zero_chunk_crc == 0) {
+        writer->zero_chunk_crc = crc32(0, zero_chunk, ZSTD_CHUNK_SIZE);
+    }
+    return crc32_combine(crc, writer->zero_chunk_crc, ZSTD_CHUNK_SIZE);
+}
+
+// Read, compress and emit all frames of input_file on the calling thread.
+// The data is also fed to hash, unless it is NULL.
+static int write_frames_serial(struct burst_writer *writer,
+                               FILE *input_file,
+                               struct content_hash_ctx *hash,
+                               uint32_t *crc_out,
+                               uint64_t *total_uncompressed_out) {
     uint32_t crc = 0;
     uint64_t total_uncompressed = 0;
 
     // ZSTD method: compress in 128 KiB chunks
-    #define ZSTD_CHUNK_SIZE (128 * 1024)  // 128 KiB chunks (BTRFS maximum)
     uint8_t *input_buffer = malloc(ZSTD_CHUNK_SIZE);
     uint8_t *output_buffer = malloc(ZSTD_compressBound(ZSTD_CHUNK_SIZE));
 
@@ -316,29 +548,37 @@ int burst_writer_add_file(struct burst_writer *writer,
         fprintf(stderr, "Failed to allocate compression buffers\n");
         free(input_buffer);
         free(output_buffer);
-        free(entry->filename);
         return -1;
     }
 
-    size_t bytes_read;
-
-    // Handle header-only files (empty files with STORE method, symlinks)
-    // These have no data to compress, so skip directly to the data descriptor
-    if (is_header_only) {
-        // For STORE method empty files: no data bytes at all
-        // The CRC is 0, sizes are 0, and we just write the data descriptor
-        free(input_buffer);
-        free(output_buffer);
-        goto write_descriptor;
-    }
-
-    // Otherwise this is a regular and non-empty file, so start writing compressed zstandard frames.
+    struct hole_finder holes;
+    hole_finder_init(&holes, input_file);
 
-    while ((bytes_read = fread(input_buffer, 1, ZSTD_CHUNK_SIZE, input_file)) > 0) {
+    size_t bytes_read;
+    bool in_hole, zero, at_eof;
+    while ((bytes_read = read_chunk(writer, input_file, &holes, total_uncompressed,
+                                    input_buffer, &in_hole, &zero, &at_eof)) > 0) {
         // Compute CRC32 of uncompressed data
-        crc = crc32(crc, input_buffer, bytes_read);
+        if (in_hole) {
+            crc = crc32_zeros(writer, crc, bytes_read);
+        } else {
+            crc = crc32(crc, input_buffer, bytes_read);
+        }
+        if (hash) {
+            content_hash_update(hash, in_hole ? zero_chunk : input_buffer, bytes_read);
+        }
         total_uncompressed += bytes_read;
 
+        if (zero) {
+            if (emit_zero_frame(writer, total_uncompressed - bytes_read,
+                                bytes_read, at_eof) != 0) {
+                free(input_buffer);
+                free(output_buffer);
+                return -1;
+            }
+            continue;
+        }
+
         // Compress chunk using mockable API
         struct compression_result comp_result = compress_chunk(
             output_buffer, ZSTD_compressBound(ZSTD_CHUNK_SIZE),
@@ -350,7 +590,6 @@ int burst_writer_add_file(struct burst_writer *writer,
                     comp_result.error_message);
             free(input_buffer);
             free(output_buffer);
-            free(entry->filename);
             return -1;
         }
 
@@ -360,76 +599,411 @@ int burst_writer_add_file(struct burst_writer *writer,
                                        bytes_read) != 0) {
             free(input_buffer);
             free(output_buffer);
-            free(entry->filename);
             return -1;
         }
 #endif
 
-        // Phase 3: Check alignment before writing frame
-        uint64_t write_pos = alignment_get_write_position(writer);
-        bool at_eof = (bytes_read < ZSTD_CHUNK_SIZE) || feof(input_file);
+        if (emit_frame(writer, output_buffer, comp_result.compressed_size,
+                       total_uncompressed - bytes_read, bytes_read, at_eof, false) != 0) {
+            free(input_buffer);
+            free(output_buffer);
+            return -1;
+        }
+    } // file fully written out. Caller responsible for closing.
+
+    free(input_buffer);
+    free(output_buffer);
+
+    if (ferror(input_file)) {
+        fprintf(stderr, "Error reading input file: %s\n", strerror(errno));
+        return -1;
+    }
+
+    *crc_out = crc;
+    *total_uncompressed_out = total_uncompressed;
+    return 0;
+}
 
-        struct alignment_decision decision = alignment_decide(
-            write_pos,
-            comp_result.compressed_size,
-            at_eof
-        );
+/*
+ * Read input_file on the calling thread and hand 128 KiB chunks to the
+ * compression pool, keeping up to one chunk per pool job in flight.
+ * Compressed frames are collected in submission order and emitted through
+ * emit_frame(), so the output is identical to write_frames_serial(). Chunks
+ * of zeros take the same slots in the ring but are never submitted.
+ */
+static int write_frames_parallel(struct burst_writer *writer,
+                                 FILE *input_file,
+                                 struct content_hash_ctx *hash,
+                                 uint32_t *crc_out,
+                                 uint64_t *total_uncompressed_out) {
+    struct compress_pool *pool = writer->compress_pool;
+    size_t num_jobs = compress_pool_num_jobs(pool);
 
-        // Execute alignment actions
-        if (decision.action == ALIGNMENT_PAD_THEN_FRAME) {
-            // Write padding to reach boundary
-            if (alignment_write_padding_frame(writer, decision.padding_size) != 0) {
-                free(input_buffer);
-                free(output_buffer);
-                free(entry->filename);
-                return -1;
+    uint32_t crc = 0;
+    uint64_t total_read = 0;
+    uint64_t total_emitted = 0;
+    size_t next_submit = 0;  // Ring index of next job to fill
+    size_t next_emit = 0;    // Ring index of oldest in-flight job
+    size_t in_flight = 0;
+    bool input_done = false;
+    int rc = 0;
+
+    struct hole_finder holes;
+    hole_finder_init(&holes, input_file);
+
+    while (rc == 0) {
+        // Keep every job busy while there is input left
+        while (!input_done && in_flight < num_jobs) {
+            struct compress_job *job = compress_pool_get_job(pool, next_submit);
+            bool in_hole;
+            size_t bytes_read = read_chunk(writer, input_file, &holes, total_read,
+                                           job->input, &in_hole, &job->is_zero,
+                                           &job->at_eof);
+            if (bytes_read == 0) {
+                input_done = true;
+                break;
             }
-        } else if (decision.action == ALIGNMENT_PAD_THEN_METADATA) {
-            // Write padding, then Start-of-Part metadata
-            if (alignment_write_padding_frame(writer, decision.padding_size) != 0) {
-                free(input_buffer);
-                free(output_buffer);
-                free(entry->filename);
-                return -1;
+
+            if (in_hole) {
+                crc = crc32_zeros(writer, crc, bytes_read);
+            } else {
+                crc = crc32(crc, job->input, bytes_read);
+            }
+            if (hash) {
+                content_hash_update(hash, in_hole ? zero_chunk : job->input, bytes_read);
             }
+            total_read += bytes_read;
 
-            // Write Start-of-Part frame with current uncompressed offset
-            if (alignment_write_start_of_part_frame(writer, total_uncompressed - bytes_read) != 0) {
-                free(input_buffer);
-                free(output_buffer);
-                free(entry->filename);
-                return -1;
+            job->input_size = bytes_read;
+            job->compression_level = writer->compression_level;
+            if (!job->is_zero && compress_pool_submit(pool, job) != 0) {
+                rc = -1;
+                break;
             }
+            next_submit = (next_submit + 1) % num_jobs;
+            in_flight++;
         }
 
-        // Write compressed frame
-        if (burst_writer_write(writer, output_buffer, comp_result.compressed_size) < 0) {
-            free(input_buffer);
-            free(output_buffer);
-            free(entry->filename);
-            return -1;
+        if (rc != 0 || in_flight == 0) {
+            break;
         }
 
-        // Handle exact-fit mid-file case: write Start-of-Part at boundary
-        if (decision.action == ALIGNMENT_WRITE_FRAME_THEN_METADATA) {
-            if (alignment_write_start_of_part_frame(writer, total_uncompressed) != 0) {
-                free(input_buffer);
-                free(output_buffer);
-                free(entry->filename);
-                return -1;
+        // Emit the oldest frame
+        struct compress_job *job = compress_pool_get_job(pool, next_emit);
+        next_emit = (next_emit + 1) % num_jobs;
+        in_flight--;
+
+        if (job->is_zero) {
+            if (emit_zero_frame(writer, total_emitted, job->input_size, job->at_eof) != 0) {
+                rc = -1;
+                break;
             }
+            total_emitted += job->input_size;
+            continue;
         }
-    } // file fully written out. Caller responsible for closing.
 
-    free(input_buffer);
-    free(output_buffer);
+        compress_pool_wait(pool, job);
+
+        if (job->error) {
+            fprintf(stderr, "Zstandard compression error: %s\n", job->error_message);
+            rc = -1;
+            break;
+        }
+
+#ifdef DEBUG
+        if (verify_frame_content_size(job->output, job->compressed_size,
+                                       job->input_size) != 0) {
+            rc = -1;
+            break;
+        }
+#endif
+
+        if (emit_frame(writer, job->output, job->compressed_size,
+                       total_emitted, job->input_size, job->at_eof, false) != 0) {
+            rc = -1;
+            break;
+        }
+        total_emitted += job->input_size;
+    }
+
+    // Drain jobs still owned by workers before returning on error
+    while (in_flight > 0) {
+        struct compress_job *job = compress_pool_get_job(pool, next_emit);
+        if (!job->is_zero) {
+            compress_pool_wait(pool, job);
+        }
+        next_emit = (next_emit + 1) % num_jobs;
+        in_flight--;
+    }
+
+    if (rc != 0) {
+        return -1;
+    }
 
     if (ferror(input_file)) {
         fprintf(stderr, "Error reading input file: %s\n", strerror(errno));
+        return -1;
+    }
+
+    *crc_out = crc;
+    *total_uncompressed_out = total_read;
+    return 0;
+}
+
+// Emit frames that were compressed ahead of time, in file order.
+static int write_frames_precompressed(struct burst_writer *writer,
+                                      const struct compressed_file *compressed,
+                                      uint32_t *crc_out,
+                                      uint64_t *total_uncompressed_out) {
+    uint64_t total_emitted = 0;
+
+    for (size_t i = 0; i < compressed->num_frames; i++) {
+        const struct compressed_frame *frame = &compressed->frames[i];
+
+        if (emit_frame(writer, compressed->data + frame->offset, frame->compressed_size,
+                       total_emitted, frame->uncompressed_size, frame->at_eof,
+                       frame->is_zero) != 0) {
+            return -1;
+        }
+        total_emitted += frame->uncompressed_size;
+    }
+
+    *crc_out = compressed->crc32;
+    *total_uncompressed_out = total_emitted;
+    return 0;
+}
+
+// Emit frames from a BTRFS encoded reader: reused extents where possible,
+// recompressed chunks elsewhere.
+static int write_frames_encoded(struct burst_writer *writer,
+                                struct encoded_reader *reader,
+                                struct content_hash_ctx *hash,
+                                uint32_t *crc_out,
+                                uint64_t *total_uncompressed_out) {
+    uint32_t crc = 0;
+    uint64_t total_emitted = 0;
+    struct encoded_frame frame;
+    int rc;
+
+    while ((rc = encoded_reader_next(reader, &frame)) > 0) {
+        crc = crc32(crc, frame.uncompressed, frame.uncompressed_size);
+        if (hash) {
+            content_hash_update(hash, frame.uncompressed, frame.uncompressed_size);
+        }
+
+#ifdef DEBUG
+        if (verify_frame_content_size(frame.data, frame.compressed_size,
+                                       frame.uncompressed_size) != 0) {
+            return -1;
+        }
+#endif
+
+        if (emit_frame(writer, frame.data, frame.compressed_size,
+                       total_emitted, frame.uncompressed_size, frame.at_eof, false) != 0) {
+            return -1;
+        }
+        total_emitted += frame.uncompressed_size;
+
+        if (frame.reused) {
+            writer->encoded_frames_reused++;
+        } else {
+            writer->encoded_frames_recompressed++;
+        }
+    }
+
+    if (rc < 0) {
+        return -1;
+    }
+
+    *crc_out = crc;
+    *total_uncompressed_out = total_emitted;
+    return 0;
+}
+
+// Emit frames copied from a base archive.
+static int write_frames_base(struct burst_writer *writer,
+                             struct base_frame_reader *reader,
+                             uint32_t *crc_out,
+                             uint64_t *total_uncompressed_out) {
+    uint64_t total_emitted = 0;
+    struct base_frame frame;
+    int rc;
+
+    while ((rc = base_frame_reader_next(reader, &frame)) > 0) {
+#ifdef DEBUG
+        if (verify_frame_content_size(frame.data, frame.compressed_size,
+                                       frame.uncompressed_size) != 0) {
+            return -1;
+        }
+#endif
+
+        if (emit_frame(writer, frame.data, frame.compressed_size,
+                       total_emitted, frame.uncompressed_size, frame.at_eof,
+                       frame.is_zero) != 0) {
+            return -1;
+        }
+        total_emitted += frame.uncompressed_size;
+    }
+
+    if (rc < 0) {
+        fprintf(stderr, "Error: Corrupt frame data in base archive\n");
+        return -1;
+    }
+
+    *crc_out = base_frame_reader_crc32(reader);
+    *total_uncompressed_out = total_emitted;
+    return 0;
+}
+
+// Open an encoded reader for input_file if encoded reads are enabled.
+// Turns them off for the rest of the run if the source cannot support them.
+static struct encoded_reader *open_encoded_reader(struct burst_writer *writer,
+                                                  FILE *input_file) {
+    if (!writer->encoded_read || !input_file) {
+        return NULL;
+    }
+
+    int fd = fileno(input_file);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        return NULL;
+    }
+
+    bool unsupported = false;
+    struct encoded_reader *reader = encoded_reader_create(fd, (uint64_t)st.st_size,
+                                                          writer->compression_level,
+                                                          &unsupported);
+    if (!reader && unsupported) {
+        fprintf(stderr, "Warning: BTRFS encoded reads unavailable (%s), compressing normally\n",
+                strerror(errno));
+        writer->encoded_read = false;
+    }
+    return reader;
+}
+
+/*
+burst_writer_add_file adds a file to the BURST archive.
+It may write a number of structures to the output in the process:
+- Local File Header (from caller)
+- Zstandard frames representing some compressed file data
+- Zip Data Descriptor
+- Zstandard skippable padding frames
+- Zstandard Start-of-Part metadata frames
+- Unlisted padding Local File Header (for alignment of header-only files)
+
+It is responsible for ensuring that it does not write any type of data
+other than a Start-of-Part frame or a Local File Header at an 8MiB part boundary,
+and for ensuring that sufficient free space to the next boundary exists for a minimal
+local file header.
+
+Frame data comes from input_file, or from compressed when the file was compressed
+ahead of time (burst_writer_add_compressed_file), or from base_frames when the
+file is unchanged since a base archive (burst_writer_add_base_file). All produce
+the same layout. With encoded reads enabled, input_file's zstd extents on BTRFS are reused as frames.
+*/
+static int add_file_entry(struct burst_writer *writer,
+                          FILE *input_file,
+                          const struct compressed_file *compressed,
+                          struct base_frame_reader *base_frames,
+                          struct zip_local_header *lfh,
+                          int lfh_len,
+                          bool is_header_only,
+                          uint32_t unix_mode,
+                          uint32_t uid,
+                          uint32_t gid) {
+    // Get file size
+    long file_size = 0;
+    if (!is_header_only && input_file) {
+        if (fseek(input_file, 0, SEEK_END) != 0) {
+            fprintf(stderr, "Failed to seek input file: %s\n", strerror(errno));
+            return -1;
+        }
+        if (file_size < 0) {
+            fprintf(stderr, "Failed to get file size: %s\n", strerror(errno));
+            return -1;
+        }
+        rewind(input_file);
+    }
+
+    if (ensure_file_capacity(writer) != 0) {
+        return -1;
+    }
+
+    struct file_entry *entry = allocate_file_entry(writer, lfh);
+    if (!entry) {
+        return -1;
+    }
+
+    // Files have unknown content size at this point (content_size=0) and use data descriptors
+    if (check_alignment_and_pad(writer, (size_t)lfh_len, 0, true) != 0) {
         free(entry->filename);
         return -1;
     }
 
+    populate_entry_metadata(entry, lfh,
+                           writer->current_offset + writer->buffer_used,
+                           unix_mode, uid, gid);
+
+    // Write the pre-constructed local file header directly
+    if (burst_writer_write(writer, lfh, lfh_len) < 0) {
+        free(entry->filename);
+        return -1;
+    }
+
+    entry->compressed_start_offset = writer->current_offset + writer->buffer_used;
+    entry->uncompressed_start_offset = 0;  // Will be set by alignment logic in Phase 3
+
+    // Read and compress file data
+    uint32_t crc = 0;
+    uint64_t total_uncompressed = 0;
+    struct content_hash_ctx hash_ctx;
+    struct content_hash_ctx *hash = writer->hash_content ? &hash_ctx : NULL;
+
+    // Handle header-only files (empty files with STORE method, symlinks)
+    // These have no data to compress, so skip directly to the data descriptor
+    if (is_header_only) {
+        // For STORE method empty files: no data bytes at all
+        // The CRC is 0, sizes are 0, and we just write the data descriptor
+        goto write_descriptor;
+    }
+
+    // Otherwise this is a regular and non-empty file, so start writing compressed zstandard frames.
+    // Data read here is hashed as it is compressed; frames compressed ahead of
+    // time or copied from a base archive bring the hash of their data along.
+    int frames_rc;
+    const uint8_t *known_hash = NULL;
+    struct encoded_reader *encoded = open_encoded_reader(writer, input_file);
+    if (hash) {
+        content_hash_init(hash);
+    }
+    if (compressed) {
+        frames_rc = write_frames_precompressed(writer, compressed, &crc, &total_uncompressed);
+        known_hash = compressed->has_content_hash ? compressed->content_hash : NULL;
+    } else if (base_frames) {
+        frames_rc = write_frames_base(writer, base_frames, &crc, &total_uncompressed);
+        known_hash = base_frame_reader_content_hash(base_frames);
+        writer->base_files_reused++;
+    } else if (encoded) {
+        frames_rc = write_frames_encoded(writer, encoded, hash, &crc, &total_uncompressed);
+        encoded_reader_destroy(encoded);
+    } else if (writer->compress_pool) {
+        frames_rc = write_frames_parallel(writer, input_file, hash, &crc, &total_uncompressed);
+    } else {
+        frames_rc = write_frames_serial(writer, input_file, hash, &crc, &total_uncompressed);
+    }
+    if (frames_rc != 0) {
+        free(entry->filename);
+        return -1;
+    }
+
+    if (hash && known_hash) {
+        memcpy(entry->content_hash, known_hash, BURST_CONTENT_HASH_SIZE);
+        entry->has_content_hash = true;
+    } else if (hash && !compressed && !base_frames) {
+        content_hash_final(hash, entry->content_hash);
+        entry->has_content_hash = true;
+    }
+
     // Calculate actual compressed size (includes padding and metadata frames)
     // This is the total bytes written between local header and data descriptor
     uint64_t current_pos = writer->current_offset + writer->buffer_used;
@@ -506,6 +1080,137 @@ write_descriptor:
     return 0;
 }
 
+int burst_writer_add_file(struct burst_writer *writer,
+                          FILE *input_file,
+                          struct zip_local_header *lfh,
+                          int lfh_len,
+                          bool is_header_only,
+                          uint32_t unix_mode,
+                          uint32_t uid,
+                          uint32_t gid) {
+    if (!writer || !input_file || !lfh || lfh_len <= 0) {
+        return -1;
+    }
+
+    return add_file_entry(writer, input_file, NULL, NULL, lfh, lfh_len, is_header_only,
+                          unix_mode, uid, gid);
+}
+
+int burst_writer_add_compressed_file(struct burst_writer *writer,
+                                     const struct compressed_file *compressed,
+                                     struct zip_local_header *lfh,
+                                     int lfh_len,
+                                     uint32_t unix_mode,
+                                     uint32_t uid,
+                                     uint32_t gid) {
+    if (!writer || !compressed || !lfh || lfh_len <= 0) {
+        return -1;
+    }
+
+    return add_file_entry(writer, NULL, compressed, NULL, lfh, lfh_len, false,
+                          unix_mode, uid, gid);
+}
+
+int burst_writer_add_base_file(struct burst_writer *writer,
+                               struct base_frame_reader *frames,
+                               struct zip_local_header *lfh,
+                               int lfh_len,
+                               uint32_t unix_mode,
+                               uint32_t uid,
+                               uint32_t gid) {
+    if (!writer || !frames || !lfh || lfh_len <= 0) {
+        return -1;
+    }
+
+    return add_file_entry(writer, NULL, NULL, frames, lfh, lfh_len, false,
+                          unix_mode, uid, gid);
+}
+
+int burst_writer_add_hardlink(struct burst_writer *writer,
+                              struct zip_local_header *lfh,
+                              int lfh_len,
+                              const char *target,
+                              uint32_t unix_mode,
+                              uint32_t uid,
+                              uint32_t gid) {
+    if (!writer || !lfh || lfh_len <= 0 || !target || target[0] == '\0') {
+        return -1;
+    }
+
+    char *target_copy = strdup(target);
+    if (!target_copy) {
+        return -1;
+    }
+
+    if (add_file_entry(writer, NULL, NULL, NULL, lfh, lfh_len, true,
+                       unix_mode, uid, gid) != 0) {
+        free(target_copy);
+        return -1;
+    }
+
+    writer->files[writer->num_files - 1].hardlink_target = target_copy;
+    writer->hardlinks++;
+    return 0;
+}
+
+int burst_writer_set_content_hash(struct burst_writer *writer,
+                                  const uint8_t hash[BURST_CONTENT_HASH_SIZE]) {
+    if (!writer || !hash || writer->num_files == 0) {
+        return -1;
+    }
+
+    struct file_entry *entry = &writer->files[writer->num_files - 1];
+    memcpy(entry->content_hash, hash, BURST_CONTENT_HASH_SIZE);
+    entry->has_content_hash = true;
+    return 0;
+}
+
+const uint8_t *burst_writer_content_hash(const struct burst_writer *writer) {
+    if (!writer || writer->num_files == 0 || !writer->files[writer->num_files - 1].has_content_hash) {
+        return NULL;
+    }
+    return writer->files[writer->num_files - 1].content_hash;
+}
+
+int burst_writer_set_source_stat(struct burst_writer *writer, const struct stat *st) {
+    if (!writer || !st || writer->num_files == 0) {
+        return -1;
+    }
+
+    struct file_entry *entry = &writer->files[writer->num_files - 1];
+    entry->mtime_sec = (int64_t)st->st_mtim.tv_sec;
+    entry->mtime_nsec = (uint32_t)st->st_mtim.tv_nsec;
+    entry->ctime_sec = (int64_t)st->st_ctim.tv_sec;
+    entry->ctime_nsec = (uint32_t)st->st_ctim.tv_nsec;
+    entry->ino = (uint64_t)st->st_ino;
+    entry->has_source_stat = true;
+    return 0;
+}
+
+int burst_writer_add_duplicate(struct burst_writer *writer,
+                               struct zip_local_header *lfh,
+                               int lfh_len,
+                               const uint8_t hash[BURST_CONTENT_HASH_SIZE],
+                               uint64_t size,
+                               uint32_t unix_mode,
+                               uint32_t uid,
+                               uint32_t gid) {
+    if (!writer || !lfh || lfh_len <= 0 || !hash) {
+        return -1;
+    }
+
+    if (add_file_entry(writer, NULL, NULL, NULL, lfh, lfh_len, true,
+                       unix_mode, uid, gid) != 0) {
+        return -1;
+    }
+
+    burst_writer_set_content_hash(writer, hash);
+    writer->files[writer->num_files - 1].content_hash_flags = BURST_CONTENT_HASH_FLAG_DATA_OMITTED;
+    writer->duplicates++;
+    writer->duplicate_bytes += size;
+    return 0;
+}
+
 /*
 burst_writer_add_symlink adds a symbolic link to the BURST archive.
 Unlike burst_writer_add_file, symlinks:
@@ -678,6 +1383,18 @@ static size_t calculate_cdfh_size(const struct file_entry *entry) {
         if (entry->local_header_offset > 0xFFFFFFFF) size += 8;
     }
 
+    if (entry->has_content_hash) {
+        size += BURST_CONTENT_HASH_EXTRA_SIZE;
+    }
+
+    if (entry->has_source_stat) {
+        size += BURST_SOURCE_STAT_EXTRA_SIZE;
+    }
+
+    if (entry->hardlink_target) {
+        size += BURST_HARDLINK_EXTRA_HEADER_SIZE + strlen(entry->hardlink_target);
+    }
+
     return size;
 }
 
@@ -802,5 +1519,25 @@ void burst_writer_print_stats(const struct burst_writer *writer) {
         printf("  Compression ratio: %.1f%%\n", ratio);
     }
     printf("  Padding bytes: %lu\n", (unsigned long)writer->padding_bytes);
+    if (writer->encoded_frames_reused > 0 || writer->encoded_frames_recompressed > 0) {
+        printf("  BTRFS extents reused: %lu of %lu frames\n",
+               (unsigned long)writer->encoded_frames_reused,
+               (unsigned long)(writer->encoded_frames_reused +
+                               writer->encoded_frames_recompressed));
+    }
+    if (writer->base_files_reused > 0) {
+        printf("  Files reused from base: %lu\n", (unsigned long)writer->base_files_reused);
+    }
+    if (writer->hardlinks > 0) {
+        printf("  Hardlinks: %lu\n", (unsigned long)writer->hardlinks);
+    }
+    if (writer->duplicates > 0) {
+        printf("  Duplicate files stored once: %lu (%lu bytes)\n",
+               (unsigned long)writer->duplicates, (unsigned long)writer->duplicate_bytes);
+    }
+    if (writer->zero_frames > 0) {
+        printf("  Zero frames: %lu (%lu hole bytes not read)\n",
+               (unsigned long)writer->zero_frames, (unsigned long)writer->hole_bytes);
+    }
     printf("  Final size: %lu bytes\n", (unsigned long)writer->current_offset);
 }
@@ -0,0 +1,193 @@
+#include "compress_pool.h"
+#include "burst_writer.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <zstd.h>
+
+struct compress_pool {
+    pthread_mutex_t mutex;
+    pthread_cond_t work_cv;   // Signalled when a job is queued or on shutdown
+    pthread_cond_t done_cv;   // Signalled when a job completes
+
+    // FIFO of submitted jobs waiting for a worker
+    struct compress_job *queue_head;
+    struct compress_job *queue_tail;
+    bool shutdown;
+
+    pthread_t *threads;
+    int num_workers;
+
+    struct compress_job *jobs;
+    size_t num_jobs;
+};
+
+static void *compress_worker(void *arg) {
+    struct compress_pool *pool = arg;
+
+    ZSTD_CCtx *cctx = ZSTD_createCCtx();
+
+    pthread_mutex_lock(&pool->mutex);
+    for (;;) {
+        while (!pool->queue_head && !pool->shutdown) {
+            pthread_cond_wait(&pool->work_cv, &pool->mutex);
+        }
+        if (!pool->queue_head) {
+            break;  // Shutdown with empty queue
+        }
+
+        struct compress_job *job = pool->queue_head;
+        pool->queue_head = job->next;
+        if (!pool->queue_head) {
+            pool->queue_tail = NULL;
+        }
+        pthread_mutex_unlock(&pool->mutex);
+
+        if (!cctx) {
+            job->compressed_size = 0;
+            job->error = -1;
+            job->error_message = "Failed to create compression context";
+        } else {
+            job->compressed_size = ZSTD_compressCCtx(cctx,
+                                                     job->output, job->output_capacity,
+                                                     job->input, job->input_size,
+                                                     job->compression_level);
+            if (ZSTD_isError(job->compressed_size)) {
+                job->error = -1;
+                job->error_message = ZSTD_getErrorName(job->compressed_size);
+            }
+        }
+
+        pthread_mutex_lock(&pool->mutex);
+        job->done = true;
+        pthread_cond_broadcast(&pool->done_cv);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    ZSTD_freeCCtx(cctx);
+    return NULL;
+}
+
+struct compress_pool *compress_pool_create(int num_workers, size_t num_jobs) {
+    if (num_workers < 1 || num_jobs < 1) {
+        return NULL;
+    }
+
+    struct compress_pool *pool = calloc(1, sizeof(struct compress_pool));
+    if (!pool) {
+        return NULL;
+    }
+
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->work_cv, NULL);
+    pthread_cond_init(&pool->done_cv, NULL);
+
+    size_t output_capacity = ZSTD_compressBound(BURST_FRAME_SIZE);
+    pool->jobs = calloc(num_jobs, sizeof(struct compress_job));
+    if (!pool->jobs) {
+        goto error;
+    }
+    pool->num_jobs = num_jobs;
+
+    for (size_t i = 0; i < num_jobs; i++) {
+        pool->jobs[i].input = malloc(BURST_FRAME_SIZE);
+        pool->jobs[i].output = malloc(output_capacity);
+        pool->jobs[i].output_capacity = output_capacity;
+        if (!pool->jobs[i].input || !pool->jobs[i].output) {
+            fprintf(stderr, "Failed to allocate compression buffers\n");
+            goto error;
+        }
+    }
+
+    pool->threads = calloc((size_t)num_workers, sizeof(pthread_t));
+    if (!pool->threads) {
+        goto error;
+    }
+
+    for (int i = 0; i < num_workers; i++) {
+        if (pthread_create(&pool->threads[i], NULL, compress_worker, pool) != 0) {
+            fprintf(stderr, "Failed to start compression worker thread\n");
+            goto error;
+        }
+        pool->num_workers++;
+    }
+
+    return pool;
+
+error:
+    compress_pool_destroy(pool);
+    return NULL;
+}
+
+void compress_pool_destroy(struct compress_pool *pool) {
+    if (!pool) {
+        return;
+    }
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->shutdown = true;
+    pthread_cond_broadcast(&pool->work_cv);
+    pthread_mutex_unlock(&pool->mutex);
+
+    for (int i = 0; i < pool->num_workers; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    free(pool->threads);
+
+    if (pool->jobs) {
+        for (size_t i = 0; i < pool->num_jobs; i++) {
+            free(pool->jobs[i].input);
+            free(pool->jobs[i].output);
+        }
+        free(pool->jobs);
+    }
+
+    pthread_mutex_destroy(&pool->mutex);
+    pthread_cond_destroy(&pool->work_cv);
+    pthread_cond_destroy(&pool->done_cv);
+
+    free(pool);
+}
+
+size_t compress_pool_num_jobs(const struct compress_pool *pool) {
+    return pool ? pool->num_jobs : 0;
+}
+
+struct compress_job *compress_pool_get_job(struct compress_pool *pool, size_t index) {
+    if (!pool || index >= pool->num_jobs) {
+        return NULL;
+    }
+    return &pool->jobs[index];
+}
+
+int compress_pool_submit(struct compress_pool *pool, struct compress_job *job) {
+    if (!pool || !job || job->input_size > BURST_FRAME_SIZE) {
+        return -1;
+    }
+
+    job->compressed_size = 0;
+    job->error = 0;
+    job->error_message = NULL;
+    job->done = false;
+    job->next = NULL;
+
+    pthread_mutex_lock(&pool->mutex);
+    if (pool->queue_tail) {
+        pool->queue_tail->next = job;
+    } else {
+        pool->queue_head = job;
+    }
+    pool->queue_tail = job;
+    pthread_cond_signal(&pool->work_cv);
+    pthread_mutex_unlock(&pool->mutex);
+
+    return 0;
+}
+
+void compress_pool_wait(struct compress_pool *pool, struct compress_job *job) {
+    pthread_mutex_lock(&pool->mutex);
+    while (!job->done) {
+        pthread_cond_wait(&pool->done_cv, &pool->mutex);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+}
@@ -0,0 +1,62 @@
+#ifndef BURST_COMPRESS_POOL_H
+#define BURST_COMPRESS_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Worker thread pool for compressing 128 KiB chunks ahead of the writer.
+ *
+ * The pool owns a fixed ring of jobs, each with its own input and output
+ * buffers. The writer thread fills a job's input, submits it, and later waits
+ * on jobs in the same order it submitted them, so all layout decisions
+ * (alignment, padding, Start-of-Part frames) remain on a single thread.
+ *
+ * Each worker holds its own ZSTD_CCtx. Compressing a chunk with a reused
+ * context at a given level produces the same frame as ZSTD_compress(), so
+ * archives are byte-identical to the serial path.
+ */
+
+struct compress_pool;
+
+struct compress_job {
+    // Filled by the submitter
+    uint8_t *input;              // Owned by the pool, capacity BURST_FRAME_SIZE
+    size_t input_size;
+    int compression_level;
+    bool at_eof;                 // Caller bookkeeping, not used by the pool
+    bool is_zero;                // Caller bookkeeping: all zeros, not submitted to the pool
+
+    // Filled by the worker
+    uint8_t *output;             // Owned by the pool, capacity output_capacity
+    size_t output_capacity;
+    size_t compressed_size;
+    int error;
+    const char *error_message;
+
+    // Internal state
+    bool done;
+    struct compress_job *next;
+};
+
+// Create a pool with num_workers threads and num_jobs preallocated jobs.
+// Returns NULL on failure.
+struct compress_pool *compress_pool_create(int num_workers, size_t num_jobs);
+
+// Stop worker threads and free all jobs. Jobs must not be in flight.
+void compress_pool_destroy(struct compress_pool *pool);
+
+// Number of jobs in the pool's ring
+size_t compress_pool_num_jobs(const struct compress_pool *pool);
+
+// Get job by ring index (0 <= index < compress_pool_num_jobs)
+struct compress_job *compress_pool_get_job(struct compress_pool *pool, size_t index);
+
+// Queue a job for compression. Returns 0 on success, -1 on error.
+int compress_pool_submit(struct compress_pool *pool, struct compress_job *job);
+
+// Block until a submitted job has been compressed.
+void compress_pool_wait(struct compress_pool *pool, struct compress_job *job);
+
+#endif // BURST_COMPRESS_POOL_H
@@ -0,0 +1,245 @@
+#include "content_hash.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CONTENT_HASH_READ_SIZE (128 * 1024)
+
+// SHA-256 (FIPS 180-4)
+
+static const uint32_t sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+#define ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static void sha256_block(uint32_t state[8], const uint8_t block[64]) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++) {
+        w[i] = ((uint32_t)block[i * 4] << 24) | ((uint32_t)block[i * 4 + 1] << 16) |
+               ((uint32_t)block[i * 4 + 2] << 8) | (uint32_t)block[i * 4 + 3];
+    }
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = ROTR(w[i - 15], 7) ^ ROTR(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = ROTR(w[i - 2], 17) ^ ROTR(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+    for (int i = 0; i < 64; i++) {
+        uint32_t s1 = ROTR(e, 6) ^ ROTR(e, 11) ^ ROTR(e, 25);
+        uint32_t ch = (e & f) ^ (~e & g);
+        uint32_t t1 = h + s1 + ch + sha256_k[i] + w[i];
+        uint32_t s0 = ROTR(a, 2) ^ ROTR(a, 13) ^ ROTR(a, 22);
+        uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+        uint32_t t2 = s0 + maj;
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+}
+
+void content_hash_init(struct content_hash_ctx *ctx) {
+    static const uint32_t initial[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+    };
+    memcpy(ctx->state, initial, sizeof(initial));
+    ctx->length = 0;
+    ctx->block_used = 0;
+}
+
+void content_hash_update(struct content_hash_ctx *ctx, const void *data, size_t len) {
+    const uint8_t *p = data;
+    ctx->length += len;
+
+    if (ctx->block_used > 0) {
+        size_t take = 64 - ctx->block_used;
+        if (take > len) {
+            take = len;
+        }
+        memcpy(ctx->block + ctx->block_used, p, take);
+        ctx->block_used += take;
+        p += take;
+        len -= take;
+        if (ctx->block_used < 64) {
+            return;
+        }
+        sha256_block(ctx->state, ctx->block);
+        ctx->block_used = 0;
+    }
+
+    while (len >= 64) {
+        sha256_block(ctx->state, p);
+        p += 64;
+        len -= 64;
+    }
+
+    memcpy(ctx->block, p, len);
+    ctx->block_used = len;
+}
+
+void content_hash_final(struct content_hash_ctx *ctx, uint8_t out[CONTENT_HASH_SIZE]) {
+    uint64_t bit_length = ctx->length * 8;
+
+    // Padding: 0x80, zeros, then the 64-bit big-endian message length
+    ctx->block[ctx->block_used++] = 0x80;
+    if (ctx->block_used > 56) {
+        memset(ctx->block + ctx->block_used, 0, 64 - ctx->block_used);
+        sha256_block(ctx->state, ctx->block);
+        ctx->block_used = 0;
+    }
+    memset(ctx->block + ctx->block_used, 0, 56 - ctx->block_used);
+    for (int i = 0; i < 8; i++) {
+        ctx->block[56 + i] = (uint8_t)(bit_length >> (56 - 8 * i));
+    }
+    sha256_block(ctx->state, ctx->block);
+
+    for (int i = 0; i < 8; i++) {
+        out[i * 4] = (uint8_t)(ctx->state[i] >> 24);
+        out[i * 4 + 1] = (uint8_t)(ctx->state[i] >> 16);
+        out[i * 4 + 2] = (uint8_t)(ctx->state[i] >> 8);
+        out[i * 4 + 3] = (uint8_t)ctx->state[i];
+    }
+}
+
+int content_hash_file(const char *path, uint8_t out[CONTENT_HASH_SIZE]) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return -1;
+    }
+
+    uint8_t *buffer = malloc(CONTENT_HASH_READ_SIZE);
+    if (!buffer) {
+        fclose(f);
+        errno = ENOMEM;
+        return -1;
+    }
+
+    struct content_hash_ctx ctx;
+    content_hash_init(&ctx);
+    size_t n;
+    while ((n = fread(buffer, 1, CONTENT_HASH_READ_SIZE, f)) > 0) {
+        content_hash_update(&ctx, buffer, n);
+    }
+
+    int rc = 0;
+    if (ferror(f)) {
+        errno = errno ? errno : EIO;
+        rc = -1;
+    } else {
+        content_hash_final(&ctx, out);
+    }
+
+    free(buffer);
+    fclose(f);
+    return rc;
+}
+
+// Open-addressing hash table keyed by content hash, at most half full
+
+struct content_slot {
+    uint8_t hash[CONTENT_HASH_SIZE];
+    char *name;                  // NULL for an empty slot
+};
+
+struct content_index {
+    struct content_slot *slots;
+    size_t num_slots;            // Power of two
+    size_t num_used;
+};
+
+static struct content_slot *find_slot(struct content_slot *slots, size_t num_slots,
+                                      const uint8_t hash[CONTENT_HASH_SIZE]) {
+    // The key is already a uniformly distributed hash
+    uint64_t start;
+    memcpy(&start, hash, sizeof(start));
+    size_t slot = (size_t)start & (num_slots - 1);
+    while (slots[slot].name && memcmp(slots[slot].hash, hash, CONTENT_HASH_SIZE) != 0) {
+        slot = (slot + 1) & (num_slots - 1);
+    }
+    return &slots[slot];
+}
+
+static int grow(struct content_index *index) {
+    size_t num_slots = index->num_slots ? index->num_slots * 2 : 64;
+    struct content_slot *slots = calloc(num_slots, sizeof(struct content_slot));
+    if (!slots) {
+        return -1;
+    }
+    for (size_t i = 0; i < index->num_slots; i++) {
+        if (index->slots[i].name) {
+            *find_slot(slots, num_slots, index->slots[i].hash) = index->slots[i];
+        }
+    }
+    free(index->slots);
+    index->slots = slots;
+    index->num_slots = num_slots;
+    return 0;
+}
+
+struct content_index *content_index_create(void) {
+    return calloc(1, sizeof(struct content_index));
+}
+
+void content_index_destroy(struct content_index *index) {
+    if (!index) {
+        return;
+    }
+    for (size_t i = 0; i < index->num_slots; i++) {
+        free(index->slots[i].name);
+    }
+    free(index->slots);
+    free(index);
+}
+
+const char *content_index_find(const struct content_index *index,
+                               const uint8_t hash[CONTENT_HASH_SIZE]) {
+    if (!index || index->num_used == 0) {
+        return NULL;
+    }
+    return find_slot(index->slots, index->num_slots, hash)->name;
+}
+
+int content_index_add(struct content_index *index, const uint8_t hash[CONTENT_HASH_SIZE],
+                      const char *name) {
+    if ((index->num_used + 1) * 2 > index->num_slots && grow(index) != 0) {
+        return -1;
+    }
+
+    struct content_slot *slot = find_slot(index->slots, index->num_slots, hash);
+    if (slot->name) {
+        return 0;  // Keep the first name
+    }
+    slot->name = strdup(name);
+    if (!slot->name) {
+        return -1;
+    }
+    memcpy(slot->hash, hash, CONTENT_HASH_SIZE);
+    index->num_used++;
+    return 0;
+}
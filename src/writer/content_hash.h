@@ -0,0 +1,56 @@
+#ifndef BURST_CONTENT_HASH_H
+#define BURST_CONTENT_HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "burst_writer.h"
+
+/*
+ * Content hashes of regular files (--content-hash, --dedup).
+ *
+ * Each file's SHA-256 is stored in a BURST content hash extra field of its
+ * central directory record. The downloader groups entries with equal hashes,
+ * writes the content once and clones it to the other names. With --dedup the
+ * writer also stores the data of identical files only once: later copies are
+ * header-only entries whose extra field marks the data as omitted.
+ *
+ * SHA-256 is used because it needs no library beyond what the writer already
+ * links, and a collision would silently restore the wrong content.
+ */
+
+#define CONTENT_HASH_SIZE BURST_CONTENT_HASH_SIZE
+
+struct content_hash_ctx {
+    uint32_t state[8];
+    uint64_t length;             // Bytes hashed so far
+    uint8_t block[64];
+    size_t block_used;
+};
+
+void content_hash_init(struct content_hash_ctx *ctx);
+void content_hash_update(struct content_hash_ctx *ctx, const void *data, size_t len);
+void content_hash_final(struct content_hash_ctx *ctx, uint8_t out[CONTENT_HASH_SIZE]);
+
+// Hash the file at path. Returns 0 on success, -1 (with errno set) on error.
+int content_hash_file(const char *path, uint8_t out[CONTENT_HASH_SIZE]);
+
+/*
+ * Archive names of stored file contents, keyed by content hash (--dedup).
+ */
+struct content_index;
+
+struct content_index *content_index_create(void);
+
+void content_index_destroy(struct content_index *index);
+
+// Archive name of the entry holding the content with this hash, or NULL
+const char *content_index_find(const struct content_index *index,
+                               const uint8_t hash[CONTENT_HASH_SIZE]);
+
+// Record name as holding the content with this hash (the first name is kept).
+// Returns 0 on success, -1 on allocation failure.
+int content_index_add(struct content_index *index, const uint8_t hash[CONTENT_HASH_SIZE],
+                      const char *name);
+
+#endif // BURST_CONTENT_HASH_H
@@ -0,0 +1,635 @@
+/*
+ * Directory Scanner - Parallel, fd-relative directory tree walk
+ *
+ * See dir_scanner.h for the ordering guarantees.
+ */
+#include "dir_scanner.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <limits.h>
+
+#define NO_TARGET SIZE_MAX
+
+// Workers stop picking up new directories while this many scanned entries
+// are waiting to be emitted, so memory stays bounded on huge trees
+#define DIR_SCANNER_MAX_BUFFERED_ENTRIES 65536
+
+struct scan_dir;
+
+// One child of a scanned directory. Strings live in the directory's name arena.
+struct scan_entry {
+    size_t name_offset;
+    size_t target_offset;     // NO_TARGET unless this is a symlink
+    struct stat st;
+    struct scan_dir *subdir;  // Non-NULL for directories
+};
+
+struct scan_dir {
+    struct scan_dir *parent;
+    char *name;               // Name within parent (NULL for the root)
+
+    // Open while this directory is read and until every subdirectory has
+    // been opened relative to it
+    DIR *dir;
+    atomic_int open_refs;
+
+    struct scan_entry *entries;
+    size_t num_entries;
+    size_t entries_capacity;
+
+    char *names;              // Arena of NUL-terminated names and symlink targets
+    size_t names_len;
+    size_t names_capacity;
+
+    atomic_bool claimed;      // Set by whichever thread scans this directory
+    atomic_int refs;          // Held by the tree and, while queued, by a deque
+    bool scanned;             // Guarded by dir_scanner.mutex
+    int error;                // errno from opening the directory, 0 on success
+};
+
+// Per-worker deque: the owner pushes and pops at the tail, thieves take from the head
+struct scan_deque {
+    pthread_mutex_t mutex;
+    struct scan_dir **items;
+    size_t head;
+    size_t tail;
+    size_t capacity;
+};
+
+struct dir_scanner {
+    const char *root_path;
+
+    struct scan_deque *deques;
+    pthread_t *threads;
+    int num_workers;
+
+    atomic_size_t queued;     // Directories sitting in deques
+    atomic_size_t pending;    // Directories queued or being scanned
+    atomic_size_t buffered;   // Scanned entries not yet emitted
+    atomic_bool abort;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t work_cv;     // Signalled when work is queued or all work is done
+    pthread_cond_t scanned_cv;  // Signalled when a directory finishes scanning
+};
+
+struct scan_worker {
+    struct dir_scanner *scanner;
+    int index;
+};
+
+// Growable string used to build paths and archive names during emission
+struct path_buf {
+    char *buf;
+    size_t len;
+    size_t capacity;
+};
+
+static int path_buf_append(struct path_buf *pb, const char *str, size_t len) {
+    if (pb->len + len + 1 > pb->capacity) {
+        size_t new_capacity = pb->capacity ? pb->capacity * 2 : 256;
+        while (new_capacity < pb->len + len + 1) {
+            new_capacity *= 2;
+        }
+        char *new_buf = realloc(pb->buf, new_capacity);
+        if (!new_buf) {
+            return -1;
+        }
+        pb->buf = new_buf;
+        pb->capacity = new_capacity;
+    }
+    memcpy(pb->buf + pb->len, str, len);
+    pb->len += len;
+    pb->buf[pb->len] = '\0';
+    return 0;
+}
+
+static void path_buf_truncate(struct path_buf *pb, size_t len) {
+    pb->len = len;
+    pb->buf[len] = '\0';
+}
+
+// Copy a string into the directory's arena, returning its offset or NO_TARGET
+static size_t scan_dir_store_string(struct scan_dir *d, const char *str, size_t len) {
+    if (d->names_len + len + 1 > d->names_capacity) {
+        size_t new_capacity = d->names_capacity ? d->names_capacity * 2 : 1024;
+        while (new_capacity < d->names_len + len + 1) {
+            new_capacity *= 2;
+        }
+        char *new_names = realloc(d->names, new_capacity);
+        if (!new_names) {
+            return NO_TARGET;
+        }
+        d->names = new_names;
+        d->names_capacity = new_capacity;
+    }
+    size_t offset = d->names_len;
+    memcpy(d->names + offset, str, len);
+    d->names[offset + len] = '\0';
+    d->names_len += len + 1;
+    return offset;
+}
+
+static struct scan_entry *scan_dir_add_entry(struct scan_dir *d) {
+    if (d->num_entries >= d->entries_capacity) {
+        size_t new_capacity = d->entries_capacity ? d->entries_capacity * 2 : 16;
+        struct scan_entry *new_entries = realloc(d->entries,
+                                                 new_capacity * sizeof(struct scan_entry));
+        if (!new_entries) {
+            return NULL;
+        }
+        d->entries = new_entries;
+        d->entries_capacity = new_capacity;
+    }
+    struct scan_entry *e = &d->entries[d->num_entries];
+    memset(e, 0, sizeof(*e));
+    e->target_offset = NO_TARGET;
+    return e;
+}
+
+// Drop one reference to the node itself; the last one frees it
+static void scan_dir_put(struct scan_dir *d) {
+    if (atomic_fetch_sub(&d->refs, 1) != 1) {
+        return;
+    }
+    if (d->dir) {
+        closedir(d->dir);
+    }
+    free(d->entries);
+    free(d->names);
+    free(d->name);
+    free(d);
+}
+
+// Drop the tree's references to d and everything below it. Nodes still
+// sitting in a deque are freed by the worker that pops them.
+static void scan_dir_free(struct scan_dir *d) {
+    if (!d) {
+        return;
+    }
+    for (size_t i = 0; i < d->num_entries; i++) {
+        scan_dir_free(d->entries[i].subdir);
+    }
+    scan_dir_put(d);
+}
+
+// Drop one reference to d's directory stream; the last one closes it
+static void scan_dir_release(struct scan_dir *d) {
+    if (atomic_fetch_sub(&d->open_refs, 1) == 1) {
+        closedir(d->dir);
+        d->dir = NULL;
+    }
+}
+
+// Full on-disk path of name inside d (for warnings only). Caller frees.
+static char *scan_dir_path(const struct dir_scanner *s, const struct scan_dir *d,
+                           const char *name) {
+    if (!d->parent) {
+        size_t len = strlen(s->root_path) + 1 + strlen(name) + 1;
+        char *path = malloc(len);
+        if (path) {
+            snprintf(path, len, "%s/%s", s->root_path, name);
+        }
+        return path;
+    }
+
+    char *parent_path = scan_dir_path(s, d->parent, d->name);
+    if (!parent_path) {
+        return NULL;
+    }
+    size_t len = strlen(parent_path) + 1 + strlen(name) + 1;
+    char *path = malloc(len);
+    if (path) {
+        snprintf(path, len, "%s/%s", parent_path, name);
+    }
+    free(parent_path);
+    return path;
+}
+
+static int deque_push(struct scan_deque *dq, struct scan_dir *d) {
+    pthread_mutex_lock(&dq->mutex);
+    if (dq->head == dq->tail) {
+        dq->head = dq->tail = 0;
+    }
+    if (dq->tail >= dq->capacity) {
+        size_t new_capacity = dq->capacity ? dq->capacity * 2 : 64;
+        struct scan_dir **new_items = realloc(dq->items, new_capacity * sizeof(struct scan_dir *));
+        if (!new_items) {
+            pthread_mutex_unlock(&dq->mutex);
+            return -1;
+        }
+        dq->items = new_items;
+        dq->capacity = new_capacity;
+    }
+    dq->items[dq->tail++] = d;
+    pthread_mutex_unlock(&dq->mutex);
+    return 0;
+}
+
+static struct scan_dir *deque_pop(struct scan_deque *dq) {
+    struct scan_dir *d = NULL;
+    pthread_mutex_lock(&dq->mutex);
+    if (dq->tail > dq->head) {
+        d = dq->items[--dq->tail];
+    }
+    pthread_mutex_unlock(&dq->mutex);
+    return d;
+}
+
+static struct scan_dir *deque_steal(struct scan_deque *dq) {
+    struct scan_dir *d = NULL;
+    pthread_mutex_lock(&dq->mutex);
+    if (dq->tail > dq->head) {
+        d = dq->items[dq->head++];
+    }
+    pthread_mutex_unlock(&dq->mutex);
+    return d;
+}
+
+static void mark_scanned(struct dir_scanner *s, struct scan_dir *d) {
+    pthread_mutex_lock(&s->mutex);
+    d->scanned = true;
+    pthread_cond_broadcast(&s->scanned_cv);
+    pthread_mutex_unlock(&s->mutex);
+}
+
+static void queue_dir(struct dir_scanner *s, int worker, struct scan_dir *d) {
+    atomic_store(&d->refs, 2);
+    atomic_fetch_add(&s->pending, 1);
+    atomic_fetch_add(&s->queued, 1);
+    if (deque_push(&s->deques[worker], d) != 0) {
+        // Could not queue: report the directory as unreadable instead
+        atomic_fetch_sub(&s->queued, 1);
+        atomic_fetch_sub(&s->pending, 1);
+        atomic_store(&d->refs, 1);
+        d->error = ENOMEM;
+        scan_dir_release(d->parent);
+        mark_scanned(s, d);
+        return;
+    }
+
+    pthread_mutex_lock(&s->mutex);
+    pthread_cond_broadcast(&s->work_cv);
+    pthread_mutex_unlock(&s->mutex);
+}
+
+// Read one directory, stat its children and queue its subdirectories
+static void scan_directory(struct dir_scanner *s, int worker, struct scan_dir *d) {
+    if (d->parent) {
+        if (atomic_load(&s->abort)) {
+            d->error = ECANCELED;
+        } else {
+            int fd = openat(dirfd(d->parent->dir), d->name,
+                            O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+            if (fd < 0) {
+                d->error = errno;
+            } else {
+                d->dir = fdopendir(fd);
+                if (!d->dir) {
+                    d->error = errno;
+                    close(fd);
+                }
+            }
+        }
+        scan_dir_release(d->parent);
+    }
+
+    if (!d->dir) {
+        mark_scanned(s, d);
+        return;
+    }
+
+    int fd = dirfd(d->dir);
+    size_t num_subdirs = 0;
+    struct dirent *de;
+    while (!atomic_load(&s->abort) && (de = readdir(d->dir)) != NULL) {
+        // Skip . and ..
+        if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0) {
+            continue;
+        }
+
+        struct stat st;
+        if (fstatat(fd, de->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+            int err = errno;
+            char *path = scan_dir_path(s, d, de->d_name);
+            fprintf(stderr, "Warning: Cannot stat %s (%s)\n",
+                    path ? path : de->d_name, strerror(err));
+            free(path);
+            continue;
+        }
+
+        if (!S_ISDIR(st.st_mode) && !S_ISREG(st.st_mode) && !S_ISLNK(st.st_mode)) {
+            // Skip other file types (devices, sockets, etc.)
+            continue;
+        }
+
+        char target_buf[PATH_MAX];
+        ssize_t target_len = -1;
+        if (S_ISLNK(st.st_mode)) {
+            target_len = readlinkat(fd, de->d_name, target_buf, sizeof(target_buf) - 1);
+            if (target_len < 0) {
+                int err = errno;
+                char *path = scan_dir_path(s, d, de->d_name);
+                fprintf(stderr, "Warning: Cannot read symlink %s (%s)\n",
+                        path ? path : de->d_name, strerror(err));
+                free(path);
+                continue;
+            }
+        }
+
+        struct scan_entry *e = scan_dir_add_entry(d);
+        if (!e) {
+            d->error = ENOMEM;
+            break;
+        }
+        e->st = st;
+        e->name_offset = scan_dir_store_string(d, de->d_name, strlen(de->d_name));
+        if (e->name_offset == NO_TARGET) {
+            d->error = ENOMEM;
+            break;
+        }
+        if (target_len >= 0) {
+            e->target_offset = scan_dir_store_string(d, target_buf, (size_t)target_len);
+            if (e->target_offset == NO_TARGET) {
+                d->error = ENOMEM;
+                break;
+            }
+        }
+
+        if (S_ISDIR(st.st_mode)) {
+            e->subdir = calloc(1, sizeof(struct scan_dir));
+            if (e->subdir) {
+                e->subdir->name = strdup(de->d_name);
+            }
+            if (!e->subdir || !e->subdir->name) {
+                free(e->subdir);
+                e->subdir = NULL;
+                d->error = ENOMEM;
+                break;
+            }
+            e->subdir->parent = d;
+            num_subdirs++;
+        }
+        d->num_entries++;
+    }
+
+    // Each subdirectory holds a reference until it has opened itself
+    atomic_store(&d->open_refs, (int)num_subdirs + 1);
+    for (size_t i = 0; i < d->num_entries; i++) {
+        if (d->entries[i].subdir) {
+            queue_dir(s, worker, d->entries[i].subdir);
+        }
+    }
+    scan_dir_release(d);
+
+    atomic_fetch_add(&s->buffered, d->num_entries);
+    mark_scanned(s, d);
+}
+
+// True while workers should leave queued directories alone
+static bool scan_throttled(struct dir_scanner *s) {
+    return !atomic_load(&s->abort) &&
+           atomic_load(&s->buffered) >= DIR_SCANNER_MAX_BUFFERED_ENTRIES;
+}
+
+static void *scan_worker_main(void *arg) {
+    struct scan_worker *w = arg;
+    struct dir_scanner *s = w->scanner;
+
+    for (;;) {
+        struct scan_dir *d = NULL;
+        if (!scan_throttled(s)) {
+            d = deque_pop(&s->deques[w->index]);
+            for (int i = 1; !d && i < s->num_workers; i++) {
+                d = deque_steal(&s->deques[(w->index + i) % s->num_workers]);
+            }
+        }
+
+        if (d) {
+            atomic_fetch_sub(&s->queued, 1);
+            // The emitting thread may have scanned it already
+            if (!atomic_exchange(&d->claimed, true)) {
+                scan_directory(s, w->index, d);
+            }
+            scan_dir_put(d);
+            if (atomic_fetch_sub(&s->pending, 1) == 1) {
+                pthread_mutex_lock(&s->mutex);
+                pthread_cond_broadcast(&s->work_cv);
+                pthread_mutex_unlock(&s->mutex);
+            }
+            continue;
+        }
+
+        pthread_mutex_lock(&s->mutex);
+        while (atomic_load(&s->pending) > 0 &&
+               (atomic_load(&s->queued) == 0 || scan_throttled(s))) {
+            pthread_cond_wait(&s->work_cv, &s->mutex);
+        }
+        bool done = atomic_load(&s->pending) == 0;
+        pthread_mutex_unlock(&s->mutex);
+
+        if (done) {
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+// Emit the children of d (and their subtrees) in pre-order.
+// path and name hold d's on-disk path and archive name on entry and on return.
+static int emit_dir(struct dir_scanner *s, struct scan_dir *d,
+                    struct path_buf *path, struct path_buf *name,
+                    dir_scanner_emit_fn emit, void *ctx) {
+    // Scan the directory here if no worker has started on it yet; this also
+    // keeps emission moving while workers are throttled
+    if (!atomic_exchange(&d->claimed, true)) {
+        scan_directory(s, 0, d);
+    }
+
+    pthread_mutex_lock(&s->mutex);
+    while (!d->scanned) {
+        pthread_cond_wait(&s->scanned_cv, &s->mutex);
+    }
+    pthread_mutex_unlock(&s->mutex);
+
+    if (d->error) {
+        fprintf(stderr, "Warning: Cannot open directory: %s (%s)\n",
+                path->buf, strerror(d->error));
+        return -1;
+    }
+
+    size_t path_len = path->len;
+    size_t name_len = name->len;
+
+    for (size_t i = 0; i < d->num_entries; i++) {
+        struct scan_entry *e = &d->entries[i];
+        const char *entry_name = d->names + e->name_offset;
+        size_t entry_name_len = strlen(entry_name);
+
+        if (path_buf_append(path, "/", 1) != 0 ||
+            path_buf_append(path, entry_name, entry_name_len) != 0 ||
+            (name_len > 0 && path_buf_append(name, "/", 1) != 0) ||
+            path_buf_append(name, entry_name, entry_name_len) != 0) {
+            return -1;
+        }
+
+        int rc;
+        if (e->subdir) {
+            // Directory entry (with trailing slash) BEFORE its children (pre-order)
+            size_t dir_name_len = name->len;
+            if (path_buf_append(name, "/", 1) != 0) {
+                return -1;
+            }
+            rc = emit(ctx, path->buf, name->buf, &e->st, NULL, true);
+            path_buf_truncate(name, dir_name_len);
+
+            if (rc == 0) {
+                rc = emit_dir(s, e->subdir, path, name, emit, ctx);
+            }
+            if (rc == 0) {
+                scan_dir_free(e->subdir);
+                e->subdir = NULL;
+            }
+        } else {
+            const char *target = e->target_offset == NO_TARGET ? NULL : d->names + e->target_offset;
+            rc = emit(ctx, path->buf, name->buf, &e->st, target, false);
+        }
+
+        path_buf_truncate(path, path_len);
+        path_buf_truncate(name, name_len);
+
+        if (rc != 0) {
+            return rc;
+        }
+    }
+
+    // Let throttled workers resume once enough entries have been emitted
+    size_t before = atomic_fetch_sub(&s->buffered, d->num_entries);
+    if (before >= DIR_SCANNER_MAX_BUFFERED_ENTRIES &&
+        before - d->num_entries < DIR_SCANNER_MAX_BUFFERED_ENTRIES) {
+        pthread_mutex_lock(&s->mutex);
+        pthread_cond_broadcast(&s->work_cv);
+        pthread_mutex_unlock(&s->mutex);
+    }
+
+    return 0;
+}
+
+int dir_scanner_scan(const char *root_dir,
+                     int num_threads,
+                     dir_scanner_emit_fn emit,
+                     void *ctx) {
+    if (!root_dir || !emit || num_threads < 1) {
+        return -1;
+    }
+
+    struct scan_dir *root = calloc(1, sizeof(struct scan_dir));
+    if (!root) {
+        return -1;
+    }
+    atomic_init(&root->refs, 1);
+    root->dir = opendir(root_dir);
+    if (!root->dir) {
+        fprintf(stderr, "Warning: Cannot open directory: %s (%s)\n",
+                root_dir, strerror(errno));
+        free(root);
+        return -1;
+    }
+
+    struct dir_scanner s;
+    memset(&s, 0, sizeof(s));
+    s.root_path = root_dir;
+    s.num_workers = num_threads;
+    atomic_init(&s.queued, 0);
+    atomic_init(&s.pending, 0);
+    atomic_init(&s.buffered, 0);
+    atomic_init(&s.abort, false);
+    pthread_mutex_init(&s.mutex, NULL);
+    pthread_cond_init(&s.work_cv, NULL);
+    pthread_cond_init(&s.scanned_cv, NULL);
+
+    int rc = 0;
+    int started = 0;
+    struct scan_worker *workers = calloc((size_t)num_threads, sizeof(struct scan_worker));
+    s.deques = calloc((size_t)num_threads, sizeof(struct scan_deque));
+    s.threads = calloc((size_t)num_threads, sizeof(pthread_t));
+    if (!workers || !s.deques || !s.threads) {
+        rc = -1;
+        goto cleanup;
+    }
+    for (int i = 0; i < num_threads; i++) {
+        pthread_mutex_init(&s.deques[i].mutex, NULL);
+    }
+
+    // Read the root here; workers start on its subdirectories
+    atomic_store(&root->claimed, true);
+    scan_directory(&s, 0, root);
+
+    for (int i = 0; i < num_threads; i++) {
+        workers[i].scanner = &s;
+        workers[i].index = i;
+        if (pthread_create(&s.threads[i], NULL, scan_worker_main, &workers[i]) != 0) {
+            fprintf(stderr, "Failed to start directory scanner thread\n");
+            break;
+        }
+        started++;
+    }
+
+    if (started == 0) {
+        rc = -1;
+        goto cleanup;
+    }
+
+    struct path_buf path = {0};
+    struct path_buf name = {0};
+    if (path_buf_append(&path, root_dir, strlen(root_dir)) != 0 ||
+        path_buf_append(&name, "", 0) != 0) {
+        rc = -1;
+    } else {
+        rc = emit_dir(&s, root, &path, &name, emit, ctx);
+    }
+    free(path.buf);
+    free(name.buf);
+
+cleanup:
+    // Let workers drain whatever is still queued without reading it
+    pthread_mutex_lock(&s.mutex);
+    atomic_store(&s.abort, true);
+    pthread_cond_broadcast(&s.work_cv);
+    pthread_mutex_unlock(&s.mutex);
+    for (int i = 0; i < started; i++) {
+        pthread_join(s.threads[i], NULL);
+    }
+
+    if (s.deques) {
+        for (int i = 0; i < num_threads; i++) {
+            // Only left over if no worker could be started
+            struct scan_dir *d;
+            while ((d = deque_pop(&s.deques[i])) != NULL) {
+                scan_dir_put(d);
+            }
+            pthread_mutex_destroy(&s.deques[i].mutex);
+            free(s.deques[i].items);
+        }
+    }
+    free(s.deques);
+    free(s.threads);
+    free(workers);
+
+    scan_dir_free(root);
+
+    pthread_mutex_destroy(&s.mutex);
+    pthread_cond_destroy(&s.work_cv);
+    pthread_cond_destroy(&s.scanned_cv);
+
+    return rc;
+}
@@ -0,0 +1,58 @@
+/*
+ * Directory Scanner - Parallel, fd-relative directory tree walk
+ *
+ * Worker threads read directories with openat/fstatat/readlinkat relative to
+ * their parent directory's fd, so the kernel never re-resolves full paths.
+ * Subdirectories are distributed over per-worker deques with work stealing.
+ *
+ * Results are emitted on the calling thread in the same deterministic
+ * pre-order the archive uses: each directory before its children, siblings
+ * in readdir order. Emission starts as soon as the directories it needs have
+ * been scanned, and each directory's entries are freed once emitted.
+ *
+ * Workers pause while too many scanned entries are waiting to be emitted, so
+ * memory use does not grow with the size of the tree. The calling thread
+ * scans a directory itself when it gets there before any worker does.
+ */
+#ifndef DIR_SCANNER_H
+#define DIR_SCANNER_H
+
+#include <stdbool.h>
+#include <sys/stat.h>
+
+/*
+ * Called once per entry, in archive order.
+ *
+ * Parameters:
+ *   ctx            - Caller context passed to dir_scanner_scan
+ *   path           - Full path on disk (root_dir + "/" + relative path)
+ *   name           - Archive name (relative path, trailing '/' for directories)
+ *   st             - lstat-equivalent information for the entry
+ *   symlink_target - Target for symlinks, NULL otherwise
+ *   is_dir         - true for directory entries
+ *
+ * The strings are only valid for the duration of the call.
+ * Return 0 to continue, non-zero to stop the scan.
+ */
+typedef int (*dir_scanner_emit_fn)(void *ctx,
+                                   const char *path,
+                                   const char *name,
+                                   const struct stat *st,
+                                   const char *symlink_target,
+                                   bool is_dir);
+
+/*
+ * Scan root_dir recursively with num_threads worker threads.
+ * Regular files, directories and symlinks are emitted; other types are skipped.
+ *
+ * Returns:
+ *   0 on success
+ *  -1 if a directory could not be opened or memory ran out
+ *   the emit callback's non-zero return value if it stopped the scan
+ */
+int dir_scanner_scan(const char *root_dir,
+                     int num_threads,
+                     dir_scanner_emit_fn emit,
+                     void *ctx);
+
+#endif /* DIR_SCANNER_H */
@@ -0,0 +1,306 @@
+#include "encoded_reader.h"
+#include "burst_writer.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/uio.h>
+
+// Same approach as the downloader's btrfs_writer.c: prefer <btrfs/ioctl.h>,
+// otherwise define the encoded I/O structures inline
+#ifdef __has_include
+#if __has_include(<btrfs/ioctl.h>)
+#include <btrfs/ioctl.h>
+#define HAVE_BTRFS_IOCTL_H 1
+#endif
+#endif
+
+#ifndef HAVE_BTRFS_IOCTL_H
+// These match the kernel definitions
+
+#define BTRFS_IOC_ENCODED_READ _IOR(0x94, 64, struct btrfs_ioctl_encoded_io_args)
+
+#define BTRFS_ENCODED_IO_COMPRESSION_NONE 0
+#define BTRFS_ENCODED_IO_COMPRESSION_ZSTD 2
+#define BTRFS_ENCODED_IO_ENCRYPTION_NONE 0
+
+struct btrfs_ioctl_encoded_io_args {
+    const struct iovec *iov;
+    unsigned long iovcnt;
+    int64_t offset;
+    uint64_t flags;
+    uint64_t len;
+    uint64_t unencoded_len;
+    uint64_t unencoded_offset;
+    uint32_t compression;
+    uint32_t encryption;
+    uint8_t reserved[64];
+};
+#endif
+
+// Sector size the downloader's encoded writes must stay aligned to
+#define ENCODED_SECTOR_SIZE 4096
+
+// Compressed extents occupy at most 128 KiB on disk, sector padded
+#define ENCODED_BUFFER_SIZE (BURST_FRAME_SIZE + ENCODED_SECTOR_SIZE)
+
+struct encoded_reader {
+    int fd;
+    uint64_t file_size;
+    uint64_t offset;          // Next file offset to produce
+    uint64_t fallback_end;    // Recompress [offset, fallback_end) without encoded reads
+    int compression_level;
+
+    uint8_t *encoded;         // ENCODED_BUFFER_SIZE, ioctl output
+    uint8_t *plain;           // BURST_FRAME_SIZE, decoded or read data
+    uint8_t *compressed;      // ZSTD_compressBound(BURST_FRAME_SIZE)
+    ZSTD_DCtx *dctx;
+    ZSTD_CCtx *cctx;
+
+    // Result of the probe in encoded_reader_create(), consumed by the first read
+    bool have_probe;
+    ssize_t probe_ret;
+    struct btrfs_ioctl_encoded_io_args probe_args;
+};
+
+static ssize_t encoded_read(struct encoded_reader *reader, uint64_t offset,
+                            struct btrfs_ioctl_encoded_io_args *args) {
+    struct iovec iov;
+    iov.iov_base = reader->encoded;
+    iov.iov_len = ENCODED_BUFFER_SIZE;
+
+    memset(args, 0, sizeof(*args));
+    args->iov = &iov;
+    args->iovcnt = 1;
+    args->offset = (int64_t)offset;
+
+    return ioctl(reader->fd, BTRFS_IOC_ENCODED_READ, args);
+}
+
+size_t encoded_extent_usable(const struct encoded_extent *extent,
+                             uint64_t offset,
+                             uint64_t file_size,
+                             ZSTD_DCtx *dctx,
+                             uint8_t *plain) {
+    if (extent->compression != BTRFS_ENCODED_IO_COMPRESSION_ZSTD ||
+        extent->encryption != BTRFS_ENCODED_IO_ENCRYPTION_NONE) {
+        return 0;
+    }
+
+    // The frame must decode to exactly the file bytes at offset, no more
+    if (extent->unencoded_offset != 0 || extent->len == 0 ||
+        extent->len != extent->unencoded_len || extent->len > BURST_FRAME_SIZE ||
+        offset + extent->len > file_size) {
+        return 0;
+    }
+
+    // Later frames must start on a sector boundary for encoded writes on restore
+    if (offset + extent->len < file_size && extent->len % ENCODED_SECTOR_SIZE != 0) {
+        return 0;
+    }
+
+    // Exactly one frame, followed only by the extent's sector padding
+    size_t frame_len = ZSTD_findFrameCompressedSize(extent->data, extent->data_len);
+    if (ZSTD_isError(frame_len)) {
+        return 0;
+    }
+    for (size_t i = frame_len; i < extent->data_len; i++) {
+        if (extent->data[i] != 0) {
+            return 0;
+        }
+    }
+
+    // The downloader sizes frames from the header, so the content size must be present
+    unsigned long long content_size = ZSTD_getFrameContentSize(extent->data, frame_len);
+    if (content_size != extent->len) {
+        return 0;
+    }
+
+    size_t decoded = ZSTD_decompressDCtx(dctx, plain, BURST_FRAME_SIZE,
+                                         extent->data, frame_len);
+    if (ZSTD_isError(decoded) || decoded != extent->len) {
+        return 0;
+    }
+
+    return frame_len;
+}
+
+struct encoded_reader *encoded_reader_create(int fd, uint64_t file_size,
+                                             int compression_level,
+                                             bool *unsupported) {
+    if (unsupported) {
+        *unsupported = false;
+    }
+    if (fd < 0) {
+        return NULL;
+    }
+
+    struct encoded_reader *reader = calloc(1, sizeof(struct encoded_reader));
+    if (!reader) {
+        return NULL;
+    }
+    reader->fd = fd;
+    reader->file_size = file_size;
+    reader->compression_level = compression_level;
+    reader->encoded = malloc(ENCODED_BUFFER_SIZE);
+    reader->plain = malloc(BURST_FRAME_SIZE);
+    reader->compressed = malloc(ZSTD_compressBound(BURST_FRAME_SIZE));
+    reader->dctx = ZSTD_createDCtx();
+    reader->cctx = ZSTD_createCCtx();
+    if (!reader->encoded || !reader->plain || !reader->compressed ||
+        !reader->dctx || !reader->cctx) {
+        encoded_reader_destroy(reader);
+        return NULL;
+    }
+
+    if (file_size == 0) {
+        return reader;
+    }
+
+    // Probe with the first real read; errors here mean encoded reads are off the table
+    reader->probe_ret = encoded_read(reader, 0, &reader->probe_args);
+    if (reader->probe_ret < 0) {
+        int err = errno;
+        if (unsupported && (err == ENOTTY || err == EOPNOTSUPP || err == EPERM ||
+                            err == EACCES || err == EINVAL)) {
+            *unsupported = true;
+        }
+        encoded_reader_destroy(reader);
+        errno = err;
+        return NULL;
+    }
+    reader->have_probe = true;
+
+    return reader;
+}
+
+void encoded_reader_destroy(struct encoded_reader *reader) {
+    if (!reader) {
+        return;
+    }
+    free(reader->encoded);
+    free(reader->plain);
+    free(reader->compressed);
+    ZSTD_freeDCtx(reader->dctx);
+    ZSTD_freeCCtx(reader->cctx);
+    free(reader);
+}
+
+// pread exactly len bytes at offset into buf
+static int read_fully(int fd, uint8_t *buf, size_t len, uint64_t offset) {
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = pread(fd, buf + done, len - done, (off_t)(offset + done));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        if (n == 0) {
+            errno = EIO;  // File shrank while it was being archived
+            return -1;
+        }
+        done += (size_t)n;
+    }
+    return 0;
+}
+
+int encoded_reader_next(struct encoded_reader *reader, struct encoded_frame *frame) {
+    if (reader->offset >= reader->file_size) {
+        return 0;
+    }
+
+    // Data for the next chunk that the ioctl already returned, if any
+    size_t plain_ready = 0;
+
+    if (reader->offset >= reader->fallback_end) {
+        struct btrfs_ioctl_encoded_io_args args;
+        ssize_t ret;
+        if (reader->have_probe) {
+            args = reader->probe_args;
+            ret = reader->probe_ret;
+            reader->have_probe = false;
+        } else {
+            ret = encoded_read(reader, reader->offset, &args);
+        }
+
+        uint64_t fallback_len = BURST_FRAME_SIZE;
+        if (ret >= 0) {
+            struct encoded_extent extent = {
+                .data = reader->encoded,
+                .data_len = (size_t)ret,
+                .compression = args.compression,
+                .encryption = args.encryption,
+                .len = args.len,
+                .unencoded_len = args.unencoded_len,
+                .unencoded_offset = args.unencoded_offset,
+            };
+
+            size_t frame_len = encoded_extent_usable(&extent, reader->offset,
+                                                     reader->file_size,
+                                                     reader->dctx, reader->plain);
+            if (frame_len > 0) {
+                frame->data = reader->encoded;
+                frame->compressed_size = frame_len;
+                frame->uncompressed = reader->plain;
+                frame->uncompressed_size = (size_t)args.len;
+                frame->at_eof = reader->offset + args.len >= reader->file_size;
+                frame->reused = true;
+                reader->offset += args.len;
+                return 1;
+            }
+
+            if (args.len > 0) {
+                fallback_len = args.len;
+            }
+
+            // Plain extents come back as file data; no need to read them twice
+            if (args.compression == BTRFS_ENCODED_IO_COMPRESSION_NONE &&
+                args.encryption == BTRFS_ENCODED_IO_ENCRYPTION_NONE &&
+                args.unencoded_offset == 0 && ret > 0) {
+                plain_ready = (size_t)ret;
+            }
+        }
+        // A failed read (e.g. ENOBUFS for a large plain extent) just means this
+        // range is read normally
+
+        reader->fallback_end = reader->offset + fallback_len;
+        if (reader->fallback_end > reader->file_size) {
+            reader->fallback_end = reader->file_size;
+        }
+    }
+
+    uint64_t remaining = reader->fallback_end - reader->offset;
+    size_t chunk = remaining < BURST_FRAME_SIZE ? (size_t)remaining : BURST_FRAME_SIZE;
+
+    if (plain_ready >= chunk) {
+        memcpy(reader->plain, reader->encoded, chunk);
+    } else if (read_fully(reader->fd, reader->plain, chunk, reader->offset) != 0) {
+        fprintf(stderr, "Error reading input file: %s\n", strerror(errno));
+        return -1;
+    }
+
+    size_t compressed_size = ZSTD_compressCCtx(reader->cctx,
+                                               reader->compressed,
+                                               ZSTD_compressBound(BURST_FRAME_SIZE),
+                                               reader->plain, chunk,
+                                               reader->compression_level);
+    if (ZSTD_isError(compressed_size)) {
+        fprintf(stderr, "Zstandard compression error: %s\n",
+                ZSTD_getErrorName(compressed_size));
+        return -1;
+    }
+
+    frame->data = reader->compressed;
+    frame->compressed_size = compressed_size;
+    frame->uncompressed = reader->plain;
+    frame->uncompressed_size = chunk;
+    frame->at_eof = reader->offset + chunk >= reader->file_size;
+    frame->reused = false;
+    reader->offset += chunk;
+    return 1;
+}
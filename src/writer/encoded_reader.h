@@ -0,0 +1,71 @@
+#ifndef BURST_ENCODED_READER_H
+#define BURST_ENCODED_READER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <zstd.h>
+
+/*
+ * Frame source for files on zstd-compressed BTRFS volumes.
+ *
+ * Extents are read with BTRFS_IOC_ENCODED_READ. An extent that is already a
+ * single zstd frame of at most 128 KiB, covering whole sectors of the file,
+ * is passed through as a BURST frame without recompression. This is the
+ * inverse of the downloader's do_write_encoded(). Everything else (inline,
+ * uncompressed, zlib/lzo or partially referenced extents) is read normally
+ * and compressed in chunks of up to 128 KiB.
+ *
+ * Encoded reads need CAP_SYS_ADMIN and a BTRFS filesystem.
+ */
+
+struct encoded_reader;
+
+// One frame of the file, valid until the next call to encoded_reader_next()
+struct encoded_frame {
+    const uint8_t *data;           // Zstandard frame
+    size_t compressed_size;
+    const uint8_t *uncompressed;   // Decoded data (for the CRC)
+    size_t uncompressed_size;
+    bool at_eof;                   // Last frame of the file
+    bool reused;                   // Taken verbatim from an on-disk extent
+};
+
+// Description of an extent returned by BTRFS_IOC_ENCODED_READ
+struct encoded_extent {
+    const uint8_t *data;           // Encoded bytes returned by the ioctl
+    size_t data_len;
+    uint32_t compression;          // BTRFS_ENCODED_IO_COMPRESSION_*
+    uint32_t encryption;
+    uint64_t len;                  // File bytes covered, starting at the read offset
+    uint64_t unencoded_len;
+    uint64_t unencoded_offset;
+};
+
+/*
+ * Open a reader on fd (a regular file of file_size bytes).
+ * Returns NULL if encoded reads are unavailable for this file; *unsupported
+ * is then true when the filesystem or permissions rule them out entirely.
+ */
+struct encoded_reader *encoded_reader_create(int fd, uint64_t file_size,
+                                             int compression_level,
+                                             bool *unsupported);
+
+void encoded_reader_destroy(struct encoded_reader *reader);
+
+// Produce the next frame. Returns 1 with *frame filled, 0 at end of file, -1 on error.
+int encoded_reader_next(struct encoded_reader *reader, struct encoded_frame *frame);
+
+/*
+ * Decide whether an extent read at file offset can be emitted as a BURST frame.
+ * On success decodes it with dctx into plain (at least BURST_FRAME_SIZE bytes) and returns
+ * the length of the zstd frame within extent->data; returns 0 if it must be
+ * recompressed instead.
+ */
+size_t encoded_extent_usable(const struct encoded_extent *extent,
+                             uint64_t offset,
+                             uint64_t file_size,
+                             ZSTD_DCtx *dctx,
+                             uint8_t *plain);
+
+#endif // BURST_ENCODED_READER_H
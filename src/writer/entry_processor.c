@@ -17,13 +17,14 @@
 /*
  * Build a local file header for a regular file.
  * Files use Zstandard compression (or STORE for empty files) and data descriptors.
+ * The file's mtime is recorded so later incremental runs (--base) can spot changes.
  */
 static struct zip_local_header* build_local_file_header(const char *filename, bool is_empty,
                                                          uint32_t uid, uint32_t gid,
+                                                         time_t mtime,
                                                          int *lfh_len_out) {
-    time_t now = time(NULL);
     uint16_t mod_time, mod_date;
-    dos_datetime_from_time_t(now, &mod_time, &mod_date);
+    dos_datetime_from_time_t(mtime, &mod_time, &mod_date);
 
     uint8_t extra_field[16];
     size_t extra_field_len = build_unix_extra_field(extra_field, sizeof(extra_field), uid, gid);
@@ -243,7 +244,7 @@ int process_entry(struct burst_writer *writer,
         int lfh_len = 0;
         struct zip_local_header *lfh = build_local_file_header(archive_name, is_empty,
                                                                 file_stat->st_uid, file_stat->st_gid,
-                                                                &lfh_len);
+                                                                file_stat->st_mtime, &lfh_len);
         if (!lfh) {
             fprintf(stderr, "Failed to build local file header\n");
             fclose(input);
@@ -252,6 +253,7 @@ int process_entry(struct burst_writer *writer,
 
         if (burst_writer_add_file(writer, input, lfh, lfh_len, is_empty,
                                   file_stat->st_mode, file_stat->st_uid, file_stat->st_gid) == 0) {
+            burst_writer_set_source_stat(writer, file_stat);
             success = 1;
         } else {
             fprintf(stderr, "Failed to add file: %s\n", input_path);
@@ -264,3 +266,119 @@ int process_entry(struct burst_writer *writer,
 
     return success;
 }
+
+int process_compressed_entry(struct burst_writer *writer,
+                             const char *input_path,
+                             const char *archive_name,
+                             const struct stat *file_stat,
+                             const struct compressed_file *compressed) {
+    int success = 0;
+
+    int lfh_len = 0;
+    struct zip_local_header *lfh = build_local_file_header(archive_name, false,
+                                                            file_stat->st_uid, file_stat->st_gid,
+                                                            file_stat->st_mtime, &lfh_len);
+    if (!lfh) {
+        fprintf(stderr, "Failed to build local file header\n");
+        return 0;
+    }
+
+    if (burst_writer_add_compressed_file(writer, compressed, lfh, lfh_len,
+                                         file_stat->st_mode, file_stat->st_uid,
+                                         file_stat->st_gid) == 0) {
+        burst_writer_set_source_stat(writer, file_stat);
+        success = 1;
+    } else {
+        fprintf(stderr, "Failed to add file: %s\n", input_path);
+    }
+
+    free(lfh);
+    return success;
+}
+
+int process_base_entry(struct burst_writer *writer,
+                       const char *input_path,
+                       const char *archive_name,
+                       const struct stat *file_stat,
+                       struct base_frame_reader *frames) {
+    int success = 0;
+
+    int lfh_len = 0;
+    struct zip_local_header *lfh = build_local_file_header(archive_name, false,
+                                                            file_stat->st_uid, file_stat->st_gid,
+                                                            file_stat->st_mtime, &lfh_len);
+    if (!lfh) {
+        fprintf(stderr, "Failed to build local file header\n");
+        return 0;
+    }
+
+    if (burst_writer_add_base_file(writer, frames, lfh, lfh_len,
+                                   file_stat->st_mode, file_stat->st_uid,
+                                   file_stat->st_gid) == 0) {
+        burst_writer_set_source_stat(writer, file_stat);
+        success = 1;
+    } else {
+        fprintf(stderr, "Failed to add file: %s\n", input_path);
+    }
+
+    free(lfh);
+    return success;
+}
+
+int process_hardlink_entry(struct burst_writer *writer,
+                           const char *input_path,
+                           const char *archive_name,
+                           const struct stat *file_stat,
+                           const char *target_name) {
+    int success = 0;
+
+    // Laid out like an empty file; the data stays with target_name
+    int lfh_len = 0;
+    struct zip_local_header *lfh = build_local_file_header(archive_name, true,
+                                                            file_stat->st_uid, file_stat->st_gid,
+                                                            file_stat->st_mtime, &lfh_len);
+    if (!lfh) {
+        fprintf(stderr, "Failed to build local file header\n");
+        return 0;
+    }
+
+    if (burst_writer_add_hardlink(writer, lfh, lfh_len, target_name,
+                                  file_stat->st_mode, file_stat->st_uid,
+                                  file_stat->st_gid) == 0) {
+        success = 1;
+    } else {
+        fprintf(stderr, "Failed to add hardlink: %s\n", input_path);
+    }
+
+    free(lfh);
+    return success;
+}
+
+int process_duplicate_entry(struct burst_writer *writer,
+                            const char *input_path,
+                            const char *archive_name,
+                            const struct stat *file_stat,
+                            const uint8_t *hash) {
+    int success = 0;
+
+    // Laid out like an empty file; the data is stored under the first name with this hash
+    int lfh_len = 0;
+    struct zip_local_header *lfh = build_local_file_header(archive_name, true,
+                                                            file_stat->st_uid, file_stat->st_gid,
+                                                            file_stat->st_mtime, &lfh_len);
+    if (!lfh) {
+        fprintf(stderr, "Failed to build local file header\n");
+        return 0;
+    }
+
+    if (burst_writer_add_duplicate(writer, lfh, lfh_len, hash, (uint64_t)file_stat->st_size,
+                                   file_stat->st_mode, file_stat->st_uid,
+                                   file_stat->st_gid) == 0) {
+        success = 1;
+    } else {
+        fprintf(stderr, "Failed to add duplicate file: %s\n", input_path);
+    }
+
+    free(lfh);
+    return success;
+}
@@ -8,9 +8,12 @@
 #define ENTRY_PROCESSOR_H
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <sys/stat.h>
 
 struct burst_writer;
+struct compressed_file;
+struct base_frame_reader;
 
 /*
  * Process a single file system entry and add it to the archive.
@@ -34,4 +37,88 @@ int process_entry(struct burst_writer *writer,
                   const struct stat *file_stat,
                   bool is_dir);
 
+/*
+ * Add a non-empty regular file whose data was already compressed off the
+ * writer thread (see prefetch_pool.h).
+ *
+ * Parameters:
+ *   writer       - The burst_writer instance
+ *   input_path   - Full path to the file on disk (for messages)
+ *   archive_name - Name to use in the archive
+ *   file_stat    - stat structure for the entry
+ *   compressed   - Compressed frames, CRC and size of the file's data
+ *
+ * Returns:
+ *   1 on success (entry was added to archive)
+ *   0 on failure (entry was skipped)
+ */
+int process_compressed_entry(struct burst_writer *writer,
+                             const char *input_path,
+                             const char *archive_name,
+                             const struct stat *file_stat,
+                             const struct compressed_file *compressed);
+
+/*
+ * Add a non-empty regular file that is unchanged since the base archive,
+ * copying its compressed frames instead of reading the file (see base_archive.h).
+ *
+ * Parameters:
+ *   writer       - The burst_writer instance
+ *   input_path   - Full path to the file on disk (for messages)
+ *   archive_name - Name to use in the archive
+ *   file_stat    - stat structure for the entry
+ *   frames       - Reader over the file's frames in the base archive
+ *
+ * Returns:
+ *   1 on success (entry was added to archive)
+ *   0 on failure (entry was skipped)
+ */
+int process_base_entry(struct burst_writer *writer,
+                       const char *input_path,
+                       const char *archive_name,
+                       const struct stat *file_stat,
+                       struct base_frame_reader *frames);
+
+/*
+ * Add another name of a regular file that is already in the archive as a
+ * hardlink entry (no data, see hardlink_map.h).
+ *
+ * Parameters:
+ *   writer       - The burst_writer instance
+ *   input_path   - Full path to the file on disk (for messages)
+ *   archive_name - Name to use in the archive
+ *   file_stat    - stat structure for the entry
+ *   target_name  - Archive name of the entry that holds the file's data
+ *
+ * Returns:
+ *   1 on success (entry was added to archive)
+ *   0 on failure (entry was skipped)
+ */
+int process_hardlink_entry(struct burst_writer *writer,
+                           const char *input_path,
+                           const char *archive_name,
+                           const struct stat *file_stat,
+                           const char *target_name);
+
+/*
+ * Add a regular file whose content is already in the archive under another
+ * name as a duplicate entry (no data, see content_hash.h).
+ *
+ * Parameters:
+ *   writer       - The burst_writer instance
+ *   input_path   - Full path to the file on disk (for messages)
+ *   archive_name - Name to use in the archive
+ *   file_stat    - stat structure for the entry
+ *   hash         - SHA-256 of the file's content
+ *
+ * Returns:
+ *   1 on success (entry was added to archive)
+ *   0 on failure (entry was skipped)
+ */
+int process_duplicate_entry(struct burst_writer *writer,
+                            const char *input_path,
+                            const char *archive_name,
+                            const struct stat *file_stat,
+                            const uint8_t *hash);
+
 #endif /* ENTRY_PROCESSOR_H */
@@ -0,0 +1,201 @@
+#include "entry_stream.h"
+#include "dir_scanner.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct entry_stream {
+    pthread_mutex_t mutex;
+    pthread_cond_t not_full;   // Signalled when the consumer pops or on cancel
+    pthread_cond_t not_empty;  // Signalled when the producer pushes or closes
+
+    // Ring of entries; slots [head, head + count) are live
+    struct stream_entry *slots;
+    size_t capacity;
+    size_t head;
+    size_t count;
+
+    bool closed;
+    bool cancelled;
+    int status;
+
+    // Background scan, if started
+    pthread_t scan_thread;
+    bool scan_started;
+    char *scan_root;
+    int scan_threads;
+};
+
+static void stream_entry_free(struct stream_entry *entry) {
+    free(entry->path);
+    free(entry->name);
+    free(entry->target);
+    memset(entry, 0, sizeof(*entry));
+}
+
+struct entry_stream *entry_stream_create(size_t capacity) {
+    if (capacity == 0) {
+        return NULL;
+    }
+
+    struct entry_stream *stream = calloc(1, sizeof(struct entry_stream));
+    if (!stream) {
+        return NULL;
+    }
+    stream->slots = calloc(capacity, sizeof(struct stream_entry));
+    if (!stream->slots) {
+        free(stream);
+        return NULL;
+    }
+    stream->capacity = capacity;
+
+    pthread_mutex_init(&stream->mutex, NULL);
+    pthread_cond_init(&stream->not_full, NULL);
+    pthread_cond_init(&stream->not_empty, NULL);
+    return stream;
+}
+
+void entry_stream_destroy(struct entry_stream *stream) {
+    if (!stream) {
+        return;
+    }
+
+    entry_stream_cancel(stream);
+    if (stream->scan_started) {
+        pthread_join(stream->scan_thread, NULL);
+    }
+
+    for (size_t i = 0; i < stream->count; i++) {
+        stream_entry_free(&stream->slots[(stream->head + i) % stream->capacity]);
+    }
+
+    pthread_mutex_destroy(&stream->mutex);
+    pthread_cond_destroy(&stream->not_full);
+    pthread_cond_destroy(&stream->not_empty);
+    free(stream->scan_root);
+    free(stream->slots);
+    free(stream);
+}
+
+int entry_stream_push(struct entry_stream *stream,
+                      const char *path,
+                      const char *name,
+                      const struct stat *st,
+                      const char *target,
+                      bool is_dir) {
+    // Copy strings before taking the lock
+    struct stream_entry entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.path = strdup(path);
+    entry.name = strdup(name);
+    entry.target = target ? strdup(target) : NULL;
+    if (!entry.path || !entry.name || (target && !entry.target)) {
+        stream_entry_free(&entry);
+        return -1;
+    }
+    entry.st = *st;
+    entry.is_dir = is_dir;
+
+    pthread_mutex_lock(&stream->mutex);
+    while (stream->count == stream->capacity && !stream->cancelled) {
+        pthread_cond_wait(&stream->not_full, &stream->mutex);
+    }
+    if (stream->cancelled || stream->closed) {
+        pthread_mutex_unlock(&stream->mutex);
+        stream_entry_free(&entry);
+        return -1;
+    }
+    stream->slots[(stream->head + stream->count) % stream->capacity] = entry;
+    stream->count++;
+    pthread_cond_broadcast(&stream->not_empty);
+    pthread_mutex_unlock(&stream->mutex);
+    return 0;
+}
+
+void entry_stream_close(struct entry_stream *stream, int status) {
+    pthread_mutex_lock(&stream->mutex);
+    stream->closed = true;
+    stream->status = status;
+    pthread_cond_broadcast(&stream->not_empty);
+    pthread_mutex_unlock(&stream->mutex);
+}
+
+static int push_scanned_entry(void *ctx, const char *path, const char *name,
+                              const struct stat *st, const char *symlink_target,
+                              bool is_dir) {
+    return entry_stream_push((struct entry_stream *)ctx, path, name, st,
+                             symlink_target, is_dir);
+}
+
+static void *scan_thread_main(void *arg) {
+    struct entry_stream *stream = arg;
+    int rc = dir_scanner_scan(stream->scan_root, stream->scan_threads,
+                              push_scanned_entry, stream);
+    entry_stream_close(stream, rc);
+    return NULL;
+}
+
+int entry_stream_start_scan(struct entry_stream *stream,
+                            const char *root_dir,
+                            int num_threads) {
+    if (!stream || !root_dir || stream->scan_started) {
+        return -1;
+    }
+
+    stream->scan_root = strdup(root_dir);
+    if (!stream->scan_root) {
+        return -1;
+    }
+    stream->scan_threads = num_threads;
+
+    if (pthread_create(&stream->scan_thread, NULL, scan_thread_main, stream) != 0) {
+        fprintf(stderr, "Failed to start directory scan thread\n");
+        return -1;
+    }
+    stream->scan_started = true;
+    return 0;
+}
+
+struct stream_entry *entry_stream_peek(struct entry_stream *stream, size_t ahead, bool wait) {
+    if (ahead >= stream->capacity) {
+        return NULL;
+    }
+
+    pthread_mutex_lock(&stream->mutex);
+    while (wait && stream->count <= ahead && !stream->closed) {
+        pthread_cond_wait(&stream->not_empty, &stream->mutex);
+    }
+    struct stream_entry *entry = NULL;
+    if (stream->count > ahead) {
+        // The producer never touches live slots, so this stays valid until popped
+        entry = &stream->slots[(stream->head + ahead) % stream->capacity];
+    }
+    pthread_mutex_unlock(&stream->mutex);
+    return entry;
+}
+
+void entry_stream_pop(struct entry_stream *stream) {
+    pthread_mutex_lock(&stream->mutex);
+    if (stream->count > 0) {
+        stream_entry_free(&stream->slots[stream->head]);
+        stream->head = (stream->head + 1) % stream->capacity;
+        stream->count--;
+        pthread_cond_signal(&stream->not_full);
+    }
+    pthread_mutex_unlock(&stream->mutex);
+}
+
+void entry_stream_cancel(struct entry_stream *stream) {
+    pthread_mutex_lock(&stream->mutex);
+    stream->cancelled = true;
+    pthread_cond_broadcast(&stream->not_full);
+    pthread_mutex_unlock(&stream->mutex);
+}
+
+int entry_stream_status(struct entry_stream *stream) {
+    pthread_mutex_lock(&stream->mutex);
+    int status = stream->status;
+    pthread_mutex_unlock(&stream->mutex);
+    return status;
+}
@@ -0,0 +1,73 @@
+#ifndef BURST_ENTRY_STREAM_H
+#define BURST_ENTRY_STREAM_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <sys/stat.h>
+
+/*
+ * Bounded FIFO of archive entries between a producer and the archiving loop.
+ *
+ * In directory mode a background thread runs dir_scanner_scan() and pushes
+ * each entry as it is emitted, so compression starts right away and only
+ * `capacity` entries are ever held in memory. Entries keep the scanner's
+ * pre-order (directories before their children).
+ *
+ * The consumer peeks at the head (and a little ahead, for prefetching) and
+ * pops entries once they have been written.
+ */
+
+#define ENTRY_STREAM_DEFAULT_CAPACITY 4096
+
+struct entry_stream;
+
+struct stream_entry {
+    char *path;          // Full path on disk
+    char *name;          // Archive name (trailing '/' for directories)
+    char *target;        // Symlink target, NULL otherwise
+    struct stat st;
+    bool is_dir;
+    void *user_data;     // Owned by the consumer; NULL when pushed
+};
+
+// Create an empty stream holding at most capacity entries.
+struct entry_stream *entry_stream_create(size_t capacity);
+
+// Cancel any producer, wait for it to exit and free all entries.
+void entry_stream_destroy(struct entry_stream *stream);
+
+// Append an entry, blocking while the stream is full.
+// Returns 0 on success, -1 on allocation failure or if the stream was cancelled.
+int entry_stream_push(struct entry_stream *stream,
+                      const char *path,
+                      const char *name,
+                      const struct stat *st,
+                      const char *target,
+                      bool is_dir);
+
+// Mark the end of input. status is reported by entry_stream_status().
+void entry_stream_close(struct entry_stream *stream, int status);
+
+// Start a background thread that scans root_dir with num_threads scanner
+// workers, pushes every entry and closes the stream with the scan result.
+int entry_stream_start_scan(struct entry_stream *stream,
+                            const char *root_dir,
+                            int num_threads);
+
+// Return the entry `ahead` positions after the head. If wait is true, block
+// until it has been pushed; otherwise return NULL if it is not there yet.
+// Returns NULL once the stream is closed and has fewer entries.
+// ahead must be less than the stream capacity.
+struct stream_entry *entry_stream_peek(struct entry_stream *stream, size_t ahead, bool wait);
+
+// Free the head entry and make room for the producer.
+void entry_stream_pop(struct entry_stream *stream);
+
+// Stop the producer: pending and future pushes fail.
+void entry_stream_cancel(struct entry_stream *stream);
+
+// Status passed to entry_stream_close(). Only meaningful once peek(0, true)
+// has returned NULL.
+int entry_stream_status(struct entry_stream *stream);
+
+#endif // BURST_ENTRY_STREAM_H
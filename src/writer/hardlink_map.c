@@ -0,0 +1,106 @@
+#include "hardlink_map.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct hardlink_slot {
+    dev_t dev;
+    ino_t ino;
+    char *name;                  // NULL for an empty slot
+};
+
+struct hardlink_map {
+    // Open-addressing hash table, at most half full
+    struct hardlink_slot *slots;
+    size_t num_slots;            // Power of two
+    size_t num_used;
+};
+
+static bool is_multi_link_file(const struct stat *st) {
+    return S_ISREG(st->st_mode) && st->st_nlink > 1;
+}
+
+static uint64_t hash_inode(dev_t dev, ino_t ino) {
+    // FNV-1a over both keys
+    uint64_t h = 1469598103934665603ULL;
+    uint64_t keys[2] = {(uint64_t)dev, (uint64_t)ino};
+    const unsigned char *p = (const unsigned char *)keys;
+    for (size_t i = 0; i < sizeof(keys); i++) {
+        h ^= p[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+static struct hardlink_slot *find_slot(struct hardlink_slot *slots, size_t num_slots,
+                                       dev_t dev, ino_t ino) {
+    size_t slot = hash_inode(dev, ino) & (num_slots - 1);
+    while (slots[slot].name &&
+           (slots[slot].dev != dev || slots[slot].ino != ino)) {
+        slot = (slot + 1) & (num_slots - 1);
+    }
+    return &slots[slot];
+}
+
+static int grow(struct hardlink_map *map) {
+    size_t num_slots = map->num_slots ? map->num_slots * 2 : 64;
+    struct hardlink_slot *slots = calloc(num_slots, sizeof(struct hardlink_slot));
+    if (!slots) {
+        return -1;
+    }
+    for (size_t i = 0; i < map->num_slots; i++) {
+        if (map->slots[i].name) {
+            *find_slot(slots, num_slots, map->slots[i].dev, map->slots[i].ino) = map->slots[i];
+        }
+    }
+    free(map->slots);
+    map->slots = slots;
+    map->num_slots = num_slots;
+    return 0;
+}
+
+struct hardlink_map *hardlink_map_create(void) {
+    return calloc(1, sizeof(struct hardlink_map));
+}
+
+void hardlink_map_destroy(struct hardlink_map *map) {
+    if (!map) {
+        return;
+    }
+    for (size_t i = 0; i < map->num_slots; i++) {
+        free(map->slots[i].name);
+    }
+    free(map->slots);
+    free(map);
+}
+
+const char *hardlink_map_find(const struct hardlink_map *map, const struct stat *st) {
+    if (!map || map->num_used == 0 || !is_multi_link_file(st)) {
+        return NULL;
+    }
+    return find_slot(map->slots, map->num_slots, st->st_dev, st->st_ino)->name;
+}
+
+int hardlink_map_add(struct hardlink_map *map, const struct stat *st, const char *name) {
+    if (!is_multi_link_file(st)) {
+        return 0;
+    }
+    if ((map->num_used + 1) * 2 > map->num_slots && grow(map) != 0) {
+        return -1;
+    }
+
+    struct hardlink_slot *slot = find_slot(map->slots, map->num_slots, st->st_dev, st->st_ino);
+    if (slot->name) {
+        return 0;  // Keep the first name
+    }
+    slot->name = strdup(name);
+    if (!slot->name) {
+        return -1;
+    }
+    slot->dev = st->st_dev;
+    slot->ino = st->st_ino;
+    map->num_used++;
+    return 0;
+}
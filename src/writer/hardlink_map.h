@@ -0,0 +1,29 @@
+#ifndef BURST_HARDLINK_MAP_H
+#define BURST_HARDLINK_MAP_H
+
+#include <sys/stat.h>
+
+/*
+ * Regular files with more than one link, keyed by (st_dev, st_ino).
+ *
+ * The first name of an inode is archived with its data and recorded here.
+ * Later names of the same inode are archived as header-only entries that
+ * carry a hardlink extra field naming the first one, so the data is stored
+ * once and the downloader recreates the links with link().
+ */
+
+struct hardlink_map;
+
+struct hardlink_map *hardlink_map_create(void);
+
+void hardlink_map_destroy(struct hardlink_map *map);
+
+// Archive name already recorded for st's inode, or NULL if there is none
+// (or st is not a regular file with several links).
+const char *hardlink_map_find(const struct hardlink_map *map, const struct stat *st);
+
+// Record name as the archived copy of st's inode. Files with a single link
+// are ignored. Returns 0 on success, -1 on allocation failure.
+int hardlink_map_add(struct hardlink_map *map, const struct stat *st, const char *name);
+
+#endif // BURST_HARDLINK_MAP_H
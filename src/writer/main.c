@@ -1,101 +1,24 @@
 #include "burst_writer.h"
 #include "zip_structures.h"
 #include "entry_processor.h"
+#include "prefetch_pool.h"
+#include "entry_stream.h"
+#include "base_archive.h"
+#include "hardlink_map.h"
+#include "content_hash.h"
+#ifdef BUILD_WITH_AWS
+#include "s3_uploader.h"
+#endif
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <getopt.h>
 #include <time.h>
 #include <sys/stat.h>
-#include <dirent.h>
 #include <errno.h>
 #include <unistd.h>
 #include <limits.h>
 
-// Dynamic array of file paths for directory recursion
-struct file_list {
-    char **paths;      // Array of file paths (full paths)
-    char **names;      // Array of archive names (relative paths)
-    char **targets;    // Array of symlink targets (NULL for non-symlinks)
-    struct stat *stats;  // Array of stat info for each file
-    bool *is_directory;  // Array of directory flags
-    size_t count;
-    size_t capacity;
-};
-
-static struct file_list *file_list_create(void) {
-    struct file_list *list = malloc(sizeof(struct file_list));
-    if (!list) return NULL;
-    list->capacity = 64;
-    list->count = 0;
-    list->paths = malloc(list->capacity * sizeof(char *));
-    list->names = malloc(list->capacity * sizeof(char *));
-    list->targets = malloc(list->capacity * sizeof(char *));
-    list->stats = malloc(list->capacity * sizeof(struct stat));
-    list->is_directory = malloc(list->capacity * sizeof(bool));
-    if (!list->paths || !list->names || !list->targets || !list->stats || !list->is_directory) {
-        free(list->paths);
-        free(list->names);
-        free(list->targets);
-        free(list->stats);
-        free(list->is_directory);
-        free(list);
-        return NULL;
-    }
-    return list;
-}
-
-static void file_list_destroy(struct file_list *list) {
-    if (!list) return;
-    for (size_t i = 0; i < list->count; i++) {
-        free(list->paths[i]);
-        free(list->names[i]);
-        free(list->targets[i]);  // May be NULL, free(NULL) is safe
-    }
-    free(list->paths);
-    free(list->names);
-    free(list->targets);
-    free(list->stats);
-    free(list->is_directory);
-    free(list);
-}
-
-// target may be NULL for non-symlinks, is_dir indicates if this is a directory entry
-static int file_list_add(struct file_list *list, const char *path, const char *name,
-                          const struct stat *st, const char *target, bool is_dir) {
-    if (list->count >= list->capacity) {
-        size_t new_capacity = list->capacity * 2;
-        char **new_paths = realloc(list->paths, new_capacity * sizeof(char *));
-        char **new_names = realloc(list->names, new_capacity * sizeof(char *));
-        char **new_targets = realloc(list->targets, new_capacity * sizeof(char *));
-        struct stat *new_stats = realloc(list->stats, new_capacity * sizeof(struct stat));
-        bool *new_is_directory = realloc(list->is_directory, new_capacity * sizeof(bool));
-        if (!new_paths || !new_names || !new_targets || !new_stats || !new_is_directory) {
-            return -1;
-        }
-        list->paths = new_paths;
-        list->names = new_names;
-        list->targets = new_targets;
-        list->stats = new_stats;
-        list->is_directory = new_is_directory;
-        list->capacity = new_capacity;
-    }
-    list->paths[list->count] = strdup(path);
-    list->names[list->count] = strdup(name);
-    list->targets[list->count] = target ? strdup(target) : NULL;
-    if (!list->paths[list->count] || !list->names[list->count] ||
-        (target && !list->targets[list->count])) {
-        free(list->paths[list->count]);
-        free(list->names[list->count]);
-        free(list->targets[list->count]);
-        return -1;
-    }
-    list->stats[list->count] = *st;  // Copy stat struct
-    list->is_directory[list->count] = is_dir;
-    list->count++;
-    return 0;
-}
-
 // Check if path is a directory
 static int is_directory(const char *path) {
     struct stat st;
@@ -105,128 +28,53 @@ static int is_directory(const char *path) {
     return S_ISDIR(st.st_mode);
 }
 
-// Recursively collect files from a directory
-// base_dir: the original directory path (for calculating relative names)
-// current_dir: the current directory being scanned
-// prefix: the relative path prefix for archive names
-static int collect_files_recursive(struct file_list *list,
-                                   const char *current_dir,
-                                   const char *prefix) {
-    DIR *dir = opendir(current_dir);
-    if (!dir) {
-        fprintf(stderr, "Warning: Cannot open directory: %s (%s)\n",
-                current_dir, strerror(errno));
-        return -1;
-    }
-
-    struct dirent *entry;
-    while ((entry = readdir(dir)) != NULL) {
-        // Skip . and ..
-        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
-            continue;
-        }
+// Where the archive goes: a local file, or an S3 upload for s3://BUCKET/KEY
+struct archive_output {
+    FILE *file;
+#ifdef BUILD_WITH_AWS
+    struct s3_uploader *uploader;
+#endif
+};
 
-        // Build full path
-        size_t path_len = strlen(current_dir) + 1 + strlen(entry->d_name) + 1;
-        char *full_path = malloc(path_len);
-        if (!full_path) {
-            closedir(dir);
-            return -1;
-        }
-        snprintf(full_path, path_len, "%s/%s", current_dir, entry->d_name);
-
-        // Use lstat to get file info (doesn't follow symlinks)
-        struct stat st;
-        if (lstat(full_path, &st) != 0) {
-            fprintf(stderr, "Warning: Cannot stat %s (%s)\n", full_path, strerror(errno));
-            free(full_path);
-            continue;
-        }
+// Split s3://BUCKET/KEY. Returns false if path is not an S3 URL.
+static bool parse_s3_url(const char *path, char *bucket, size_t bucket_size, const char **key) {
+    if (strncmp(path, "s3://", 5) != 0) {
+        return false;
+    }
+    const char *start = path + 5;
+    const char *slash = strchr(start, '/');
+    if (!slash || slash == start || slash[1] == '\0' || (size_t)(slash - start) >= bucket_size) {
+        return false;
+    }
+    memcpy(bucket, start, (size_t)(slash - start));
+    bucket[slash - start] = '\0';
+    *key = slash + 1;
+    return true;
+}
 
-        // Build archive name (relative path)
-        size_t name_len = (prefix ? strlen(prefix) + 1 : 0) + strlen(entry->d_name) + 1;
-        char *archive_name = malloc(name_len);
-        if (!archive_name) {
-            free(full_path);
-            closedir(dir);
-            return -1;
+// Close the archive output. An upload is completed only if complete is set,
+// otherwise it is aborted. Returns 0 on success, -1 on error.
+static int close_output(struct archive_output *output, bool complete) {
+    int rc = 0;
+    if (output->file) {
+        if (fclose(output->file) != 0 && complete) {
+            perror("Failed to close output file");
+            rc = -1;
         }
-        if (prefix && prefix[0]) {
-            snprintf(archive_name, name_len, "%s/%s", prefix, entry->d_name);
-        } else {
-            snprintf(archive_name, name_len, "%s", entry->d_name);
-        }
-
-        if (S_ISDIR(st.st_mode)) {
-            // Build directory archive name with trailing slash
-            size_t dir_name_len = name_len + 2;  // +1 for slash, +1 for null
-            char *dir_archive_name = malloc(dir_name_len);
-            if (!dir_archive_name) {
-                free(full_path);
-                free(archive_name);
-                closedir(dir);
-                return -1;
-            }
-            snprintf(dir_archive_name, dir_name_len, "%s/", archive_name);
-
-            // Add directory entry to list BEFORE recursing into it (pre-order)
-            if (file_list_add(list, full_path, dir_archive_name, &st, NULL, true) != 0) {
-                free(full_path);
-                free(archive_name);
-                free(dir_archive_name);
-                closedir(dir);
-                return -1;
-            }
-            free(dir_archive_name);
-
-            // Now recurse into subdirectory
-            int rc = collect_files_recursive(list, full_path, archive_name);
-            free(full_path);
-            free(archive_name);
-            if (rc != 0) {
-                closedir(dir);
-                return rc;
-            }
-        } else if (S_ISREG(st.st_mode)) {
-            // Add regular file to list
-            if (file_list_add(list, full_path, archive_name, &st, NULL, false) != 0) {
-                free(full_path);
-                free(archive_name);
-                closedir(dir);
-                return -1;
-            }
-            free(full_path);
-            free(archive_name);
-        } else if (S_ISLNK(st.st_mode)) {
-            // Read symlink target
-            char target_buf[PATH_MAX];
-            ssize_t target_len = readlink(full_path, target_buf, sizeof(target_buf) - 1);
-            if (target_len < 0) {
-                fprintf(stderr, "Warning: Cannot read symlink %s (%s)\n", full_path, strerror(errno));
-                free(full_path);
-                free(archive_name);
-                continue;
-            }
-            target_buf[target_len] = '\0';
-
-            // Add symlink to list
-            if (file_list_add(list, full_path, archive_name, &st, target_buf, false) != 0) {
-                free(full_path);
-                free(archive_name);
-                closedir(dir);
-                return -1;
-            }
-            free(full_path);
-            free(archive_name);
-        } else {
-            // Skip other file types (devices, sockets, etc.)
-            free(full_path);
-            free(archive_name);
+        output->file = NULL;
+    }
+#ifdef BUILD_WITH_AWS
+    if (output->uploader) {
+        if (complete && s3_uploader_complete(output->uploader) != 0) {
+            rc = -1;
         }
+        s3_uploader_destroy(output->uploader);
+        output->uploader = NULL;
     }
-
-    closedir(dir);
-    return 0;
+#else
+    (void)complete;
+#endif
+    return rc;
 }
 
 static void print_usage(const char *program_name) {
@@ -237,26 +85,66 @@ static void print_usage(const char *program_name) {
     printf("  If a directory is given, all files are recursively added.\n");
     printf("  Directory mode does not allow mixing with individual files.\n");
     printf("\nOptions:\n");
-    printf("  -o, --output FILE     Output archive file (required)\n");
+    printf("  -o, --output FILE     Output archive file (required); s3://BUCKET/KEY\n");
+    printf("                        uploads the archive while it is written\n");
     printf("  -l, --level LEVEL     Zstandard compression level (-15 to 22, default: 3)\n");
     printf("                        Use 0 for uncompressed STORE method\n");
+    printf("  -j, --jobs N          Scan and compression threads (1 to 256, default: 1)\n");
+    printf("  -m, --inflight-mb MB  Memory budget for files compressed ahead of the\n");
+    printf("                        writer when -j > 1 (default: 256)\n");
+    printf("  -e, --encoded-read    Copy zstd extents from BTRFS sources without\n");
+    printf("                        recompressing them (needs CAP_SYS_ADMIN)\n");
+    printf("  -b, --base FILE       Previous BURST archive of the same input; frames of\n");
+    printf("                        files with unchanged size, mtime, ctime and inode\n");
+    printf("                        are copied from it instead of being recompressed\n");
+    printf("      --verify-base     With --base, also check each reused file against\n");
+    printf("                        the CRC-32 recorded in the base\n");
+    printf("  -H, --content-hash    Store the SHA-256 of each regular file, so the\n");
+    printf("                        downloader writes identical files only once\n");
+    printf("  -D, --dedup           Like -H, and store the data of identical files\n");
+    printf("                        only once\n");
+    printf("      --region REGION   AWS region for s3:// output (default: $AWS_REGION\n");
+    printf("                        or us-east-1)\n");
+    printf("      --endpoint URL    S3-compatible endpoint for s3:// output, e.g.\n");
+    printf("                        http://localhost:9000 (path-style addressing)\n");
+    printf("      --profile NAME    AWS profile for s3:// output credentials\n");
     printf("  -h, --help            Show this help message\n");
 }
 
 int main(int argc, char **argv) {
     const char *output_path = NULL;
     int compression_level = 3;
+    int num_threads = 1;
+    long inflight_mb = 256;
+    bool encoded_read = false;
+    const char *base_path = NULL;
+    bool verify_base = false;
+    bool content_hash = false;
+    bool dedup = false;
+    const char *region = getenv("AWS_REGION");
+    const char *endpoint = NULL;
+    const char *profile_name = NULL;
 
     // Parse command-line options
     static struct option long_options[] = {
         {"output", required_argument, 0, 'o'},
         {"level", required_argument, 0, 'l'},
+        {"jobs", required_argument, 0, 'j'},
+        {"inflight-mb", required_argument, 0, 'm'},
+        {"encoded-read", no_argument, 0, 'e'},
+        {"base", required_argument, 0, 'b'},
+        {"verify-base", no_argument, 0, 'V'},
+        {"content-hash", no_argument, 0, 'H'},
+        {"dedup", no_argument, 0, 'D'},
+        {"region", required_argument, 0, 'R'},
+        {"endpoint", required_argument, 0, 'E'},
+        {"profile", required_argument, 0, 'P'},
         {"help", no_argument, 0, 'h'},
         {0, 0, 0, 0}
     };
 
     int opt;
-    while ((opt = getopt_long(argc, argv, "o:l:h", long_options, NULL)) != -1) {
+    while ((opt = getopt_long(argc, argv, "o:l:j:m:eb:HDh", long_options, NULL)) != -1) {
         switch (opt) {
             case 'o':
                 output_path = optarg;
@@ -268,6 +156,45 @@ int main(int argc, char **argv) {
                     return 1;
                 }
                 break;
+            case 'j':
+                num_threads = atoi(optarg);
+                if (num_threads < 1 || num_threads > 256) {
+                    fprintf(stderr, "Error: Jobs must be between 1 and 256\n");
+                    return 1;
+                }
+                break;
+            case 'm':
+                inflight_mb = atol(optarg);
+                if (inflight_mb < 1) {
+                    fprintf(stderr, "Error: In-flight budget must be at least 1 MB\n");
+                    return 1;
+                }
+                break;
+            case 'e':
+                encoded_read = true;
+                break;
+            case 'b':
+                base_path = optarg;
+                break;
+            case 'V':
+                verify_base = true;
+                break;
+            case 'H':
+                content_hash = true;
+                break;
+            case 'D':
+                content_hash = true;
+                dedup = true;
+                break;
+            case 'R':
+                region = optarg;
+                break;
+            case 'E':
+                endpoint = optarg;
+                break;
+            case 'P':
+                profile_name = optarg;
+                break;
             case 'h':
                 print_usage(argv[0]);
                 return 0;
@@ -290,37 +217,84 @@ int main(int argc, char **argv) {
         return 1;
     }
 
-    // Build file list - handle directory vs individual files
-    struct file_list *files = file_list_create();
-    if (!files) {
-        fprintf(stderr, "Error: Failed to allocate file list\n");
+    char s3_bucket[256];
+    const char *s3_key = NULL;
+    bool s3_output = parse_s3_url(output_path, s3_bucket, sizeof(s3_bucket), &s3_key);
+    if (!s3_output && strncmp(output_path, "s3://", 5) == 0) {
+        fprintf(stderr, "Error: S3 output must be of the form s3://BUCKET/KEY\n");
+        return 1;
+    }
+#ifndef BUILD_WITH_AWS
+    if (s3_output) {
+        fprintf(stderr, "Error: burst-writer was built without S3 support\n");
         return 1;
     }
+    (void)endpoint;
+    (void)profile_name;
+#endif
+    if (!region) {
+        region = "us-east-1";
+    }
+
+    if (verify_base && !base_path) {
+        fprintf(stderr, "Error: --verify-base requires --base\n");
+        return 1;
+    }
+
+    // Opening the output truncates it, so it cannot double as the base
+    if (base_path && !s3_output) {
+        struct stat base_st, output_st;
+        if (stat(base_path, &base_st) == 0 && stat(output_path, &output_st) == 0 &&
+            base_st.st_dev == output_st.st_dev && base_st.st_ino == output_st.st_ino) {
+            fprintf(stderr, "Error: Base archive must not be the output file\n");
+            return 1;
+        }
+    }
+
+    // Entries flow through a bounded stream: in directory mode a background
+    // scan fills it while the loop below is already compressing.
+    struct entry_stream *entries = NULL;
+    bool directory_mode = false;
 
     const char *first_input = argv[optind];
     if (is_directory(first_input)) {
         // Directory mode: only one argument allowed
         if (optind + 1 < argc) {
             fprintf(stderr, "Error: When input is a directory, no other inputs are allowed\n");
-            file_list_destroy(files);
+            return 1;
+        }
+        directory_mode = true;
+
+        entries = entry_stream_create(ENTRY_STREAM_DEFAULT_CAPACITY);
+        if (!entries) {
+            fprintf(stderr, "Error: Failed to allocate entry queue\n");
             return 1;
         }
 
         printf("Scanning directory: %s\n", first_input);
-        if (collect_files_recursive(files, first_input, "") != 0) {
+        if (entry_stream_start_scan(entries, first_input, num_threads) != 0) {
             fprintf(stderr, "Error: Failed to scan directory\n");
-            file_list_destroy(files);
+            entry_stream_destroy(entries);
             return 1;
         }
 
-        if (files->count == 0) {
-            fprintf(stderr, "Error: No files or directories found in directory\n");
-            file_list_destroy(files);
+        if (!entry_stream_peek(entries, 0, true)) {
+            if (entry_stream_status(entries) != 0) {
+                fprintf(stderr, "Error: Failed to scan directory\n");
+            } else {
+                fprintf(stderr, "Error: No files or directories found in directory\n");
+            }
+            entry_stream_destroy(entries);
             return 1;
         }
-        printf("Found %zu entries (files and directories)\n\n", files->count);
     } else {
-        // Individual files mode
+        // Individual files mode: every input fits, so pushes never block
+        entries = entry_stream_create((size_t)(argc - optind));
+        if (!entries) {
+            fprintf(stderr, "Error: Failed to allocate entry queue\n");
+            return 1;
+        }
+
         for (int i = optind; i < argc; i++) {
             const char *input_path = argv[i];
 
@@ -328,13 +302,13 @@ int main(int argc, char **argv) {
             struct stat st;
             if (lstat(input_path, &st) != 0) {
                 fprintf(stderr, "Error: Cannot stat %s (%s)\n", input_path, strerror(errno));
-                file_list_destroy(files);
+                entry_stream_destroy(entries);
                 return 1;
             }
 
             if (S_ISDIR(st.st_mode)) {
                 fprintf(stderr, "Error: Cannot mix directories with individual files: %s\n", input_path);
-                file_list_destroy(files);
+                entry_stream_destroy(entries);
                 return 1;
             }
 
@@ -348,20 +322,20 @@ int main(int argc, char **argv) {
                 ssize_t target_len = readlink(input_path, target_buf, sizeof(target_buf) - 1);
                 if (target_len < 0) {
                     fprintf(stderr, "Error: Cannot read symlink %s (%s)\n", input_path, strerror(errno));
-                    file_list_destroy(files);
+                    entry_stream_destroy(entries);
                     return 1;
                 }
                 target_buf[target_len] = '\0';
 
-                if (file_list_add(files, input_path, filename, &st, target_buf, false) != 0) {
+                if (entry_stream_push(entries, input_path, filename, &st, target_buf, false) != 0) {
                     fprintf(stderr, "Error: Failed to add symlink to list\n");
-                    file_list_destroy(files);
+                    entry_stream_destroy(entries);
                     return 1;
                 }
             } else if (S_ISREG(st.st_mode)) {
-                if (file_list_add(files, input_path, filename, &st, NULL, false) != 0) {
+                if (entry_stream_push(entries, input_path, filename, &st, NULL, false) != 0) {
                     fprintf(stderr, "Error: Failed to add file to list\n");
-                    file_list_destroy(files);
+                    entry_stream_destroy(entries);
                     return 1;
                 }
             } else {
@@ -369,20 +343,51 @@ int main(int argc, char **argv) {
                 continue;
             }
         }
+        entry_stream_close(entries, 0);
 
-        if (files->count == 0) {
+        if (!entry_stream_peek(entries, 0, false)) {
             fprintf(stderr, "Error: No valid input files\n");
-            file_list_destroy(files);
+            entry_stream_destroy(entries);
             return 1;
         }
     }
 
-    // Open output file
-    FILE *output = fopen(output_path, "wb");
-    if (!output) {
-        perror("Failed to open output file");
-        file_list_destroy(files);
-        return 1;
+    struct base_archive *base = NULL;
+    if (base_path) {
+        base = base_archive_open(base_path);
+        if (!base) {
+            entry_stream_destroy(entries);
+            return 1;
+        }
+    }
+
+    // Open output file, or start the upload
+    struct archive_output output = {0};
+#ifdef BUILD_WITH_AWS
+    if (s3_output) {
+        struct s3_uploader_options upload_options = {
+            .bucket = s3_bucket,
+            .key = s3_key,
+            .region = region,
+            .endpoint = endpoint,
+            .profile_name = profile_name,
+        };
+        output.uploader = s3_uploader_create(&upload_options);
+        if (!output.uploader) {
+            base_archive_close(base);
+            entry_stream_destroy(entries);
+            return 1;
+        }
+    } else
+#endif
+    {
+        output.file = fopen(output_path, "wb");
+        if (!output.file) {
+            perror("Failed to open output file");
+            base_archive_close(base);
+            entry_stream_destroy(entries);
+            return 1;
+        }
     }
 
     // Create BURST writer
@@ -392,34 +397,252 @@ int main(int argc, char **argv) {
     } else {
         printf("Compression level: %d (using Zstandard compression)\n", compression_level);
     }
+    if (num_threads > 1) {
+        printf("Compression threads: %d\n", num_threads);
+    }
+    if (encoded_read) {
+        printf("Reusing zstd extents via BTRFS encoded reads\n");
+    }
+    if (base) {
+        printf("Base archive: %s (%zu entries)\n", base_path, base_archive_num_files(base));
+    }
+    if (dedup) {
+        printf("Storing identical files once (SHA-256)\n");
+    } else if (content_hash) {
+        printf("Storing SHA-256 content hashes\n");
+    }
     printf("\n");
 
-    struct burst_writer *writer = burst_writer_create(output, compression_level);
+    struct burst_writer *writer;
+#ifdef BUILD_WITH_AWS
+    if (output.uploader) {
+        writer = burst_writer_create_with_sink(s3_uploader_write, output.uploader,
+                                               compression_level);
+    } else
+#endif
+    {
+        writer = burst_writer_create(output.file, compression_level);
+    }
     if (!writer) {
         fprintf(stderr, "Failed to create BURST writer\n");
-        fclose(output);
-        file_list_destroy(files);
+        close_output(&output, false);
+        base_archive_close(base);
+        entry_stream_destroy(entries);
+        return 1;
+    }
+
+    if (burst_writer_set_threads(writer, num_threads) != 0 ||
+        burst_writer_set_encoded_read(writer, encoded_read) != 0 ||
+        burst_writer_set_content_hashing(writer, content_hash) != 0) {
+        burst_writer_destroy(writer);
+        close_output(&output, false);
+        base_archive_close(base);
+        entry_stream_destroy(entries);
         return 1;
     }
 
-    // Add each file from the list
+    // With multiple threads, small regular files are read and compressed ahead
+    // of the writer by a prefetch pool, bounded by the in-flight byte budget
+    // and by how far the entry stream has been filled. Encoded reads skip it:
+    // reused extents need no compression, and the writer reads them itself.
+    struct prefetch_pool *prefetch = NULL;
+    if (num_threads > 1 && !encoded_read) {
+        prefetch = prefetch_pool_create(num_threads, (uint64_t)inflight_mb * 1024 * 1024,
+                                        compression_level);
+        if (!prefetch) {
+            fprintf(stderr, "Failed to create prefetch pool\n");
+            burst_writer_destroy(writer);
+            close_output(&output, false);
+            base_archive_close(base);
+            entry_stream_destroy(entries);
+            return 1;
+        }
+        prefetch_pool_set_content_hash(prefetch, content_hash);
+    }
+
+    // Regular files with several links: later names are stored as links to the first
+    struct hardlink_map *hardlinks = hardlink_map_create();
+    if (!hardlinks) {
+        fprintf(stderr, "Failed to allocate hardlink map\n");
+        prefetch_pool_destroy(prefetch);
+        burst_writer_destroy(writer);
+        close_output(&output, false);
+        base_archive_close(base);
+        entry_stream_destroy(entries);
+        return 1;
+    }
+
+    // With --dedup: first archive name stored for each content hash
+    struct content_index *contents = NULL;
+    if (dedup) {
+        contents = content_index_create();
+        if (!contents) {
+            fprintf(stderr, "Failed to allocate content index\n");
+            hardlink_map_destroy(hardlinks);
+            prefetch_pool_destroy(prefetch);
+            burst_writer_destroy(writer);
+            close_output(&output, false);
+            base_archive_close(base);
+            entry_stream_destroy(entries);
+            return 1;
+        }
+    }
+
+    // Add each entry as it arrives
     int num_added = 0;
-    for (size_t i = 0; i < files->count; i++) {
-        if (process_entry(writer,
-                          files->paths[i],
-                          files->names[i],
-                          files->targets[i],
-                          &files->stats[i],
-                          files->is_directory[i])) {
+    size_t num_entries = 0;
+    size_t next_prefetch = 0;  // Offset from the head of the next entry to consider
+    struct stream_entry *entry;
+    while ((entry = entry_stream_peek(entries, 0, true)) != NULL) {
+        // Queue upcoming small files that are already scanned until the budget is used up
+        while (prefetch) {
+            struct stream_entry *ahead = entry_stream_peek(entries, next_prefetch, false);
+            if (!ahead) {
+                break;
+            }
+            bool eligible = !ahead->is_dir &&
+                            S_ISREG(ahead->st.st_mode) &&
+                            ahead->st.st_size > 0 &&
+                            ahead->st.st_size <= PREFETCH_MAX_FILE_SIZE &&
+                            !hardlink_map_find(hardlinks, &ahead->st) &&
+                            !base_archive_find_unchanged(base, ahead->name, &ahead->st);
+            if (eligible) {
+                ahead->user_data = prefetch_pool_submit(prefetch, ahead->path,
+                                                        (uint64_t)ahead->st.st_size);
+                if (!ahead->user_data) {
+                    break;  // Budget exhausted, retry after the writer catches up
+                }
+            }
+            next_prefetch++;
+        }
+
+        // Another name of a file already in the archive: store a link to it
+        const char *link_target = entry->is_dir ? NULL : hardlink_map_find(hardlinks, &entry->st);
+
+        struct prefetch_item *item = entry->user_data;
+
+        // Unchanged since the base archive: copy its frames instead
+        const struct file_metadata *base_file = NULL;
+        if (base && !entry->is_dir && !item && !link_target) {
+            base_file = base_archive_find_unchanged(base, entry->name, &entry->st);
+            if (base_file && verify_base && base_archive_verify_crc(base_file, entry->path) != 0) {
+                printf("Changed since base (CRC mismatch): %s\n", entry->path);
+                base_file = NULL;
+            }
+        }
+
+        // With --dedup, a duplicate has to be known before its header is
+        // written. Prefetched files were hashed by the worker as it compressed
+        // them; others are read once more here, ahead of the writer. The hash
+        // recorded for data the writer stores is computed alongside its CRC32,
+        // so it matches that data even if the file changed in between.
+        bool has_hash = false;
+        uint8_t hash[CONTENT_HASH_SIZE];
+        if (dedup && !link_target && !base_file && !entry->is_dir &&
+            S_ISREG(entry->st.st_mode) && entry->st.st_size > 0) {
+            if (item) {
+                if (prefetch_pool_wait(prefetch, item) == 0 && item->compressed.has_content_hash) {
+                    memcpy(hash, item->compressed.content_hash, CONTENT_HASH_SIZE);
+                    has_hash = true;
+                }
+            } else if (content_hash_file(entry->path, hash) == 0) {
+                has_hash = true;
+            }
+        }
+
+        // Same content as a file already in the archive: store it without data
+        const char *duplicate_of = has_hash ? content_index_find(contents, hash) : NULL;
+
+        struct base_frame_reader *base_frames = base_file ? base_frame_reader_open(base, base_file) : NULL;
+
+        int added;
+        if (link_target || duplicate_of) {
+            if (item) {
+                // Read ahead before its first copy was written; not needed after all
+                prefetch_pool_wait(prefetch, item);
+                prefetch_pool_release(prefetch, item);
+                entry->user_data = NULL;
+            }
+            if (link_target) {
+                added = process_hardlink_entry(writer, entry->path, entry->name, &entry->st,
+                                               link_target);
+            } else {
+                added = process_duplicate_entry(writer, entry->path, entry->name, &entry->st,
+                                                hash);
+            }
+        } else if (item) {
+            if (prefetch_pool_wait(prefetch, item) == 0) {
+                added = process_compressed_entry(writer,
+                                                 entry->path,
+                                                 entry->name,
+                                                 &entry->st,
+                                                 &item->compressed);
+            } else {
+                fprintf(stderr, "Failed to read file: %s (%s)\n",
+                        entry->path, item->error_message);
+                added = 0;
+            }
+            prefetch_pool_release(prefetch, item);
+            entry->user_data = NULL;
+        } else if (base_frames) {
+            added = process_base_entry(writer, entry->path, entry->name, &entry->st, base_frames);
+            base_frame_reader_close(base_frames);
+        } else {
+            added = process_entry(writer,
+                                  entry->path,
+                                  entry->name,
+                                  entry->target,
+                                  &entry->st,
+                                  entry->is_dir);
+        }
+        if (added) {
             num_added++;
+            if (!link_target && !entry->is_dir &&
+                hardlink_map_add(hardlinks, &entry->st, entry->name) != 0) {
+                fprintf(stderr, "Warning: Out of memory tracking hardlinks; "
+                        "other links to %s are stored as copies\n", entry->path);
+            }
+            // Later copies of the content this entry stored are stored without data
+            const uint8_t *stored_hash = burst_writer_content_hash(writer);
+            if (contents && !duplicate_of && stored_hash &&
+                content_index_add(contents, stored_hash, entry->name) != 0) {
+                fprintf(stderr, "Warning: Out of memory tracking file contents; "
+                        "copies of %s are stored in full\n", entry->path);
+            }
+        }
+
+        entry_stream_pop(entries);
+        num_entries++;
+        if (next_prefetch > 0) {
+            next_prefetch--;
+        }
+    }
+
+    content_index_destroy(contents);
+    hardlink_map_destroy(hardlinks);
+    prefetch_pool_destroy(prefetch);
+    base_archive_close(base);
+
+    // A scan error part way through leaves an incomplete archive behind
+    int scan_status = entry_stream_status(entries);
+    entry_stream_destroy(entries);
+    if (scan_status != 0) {
+        fprintf(stderr, "Error: Failed to scan directory\n");
+        burst_writer_destroy(writer);
+        close_output(&output, false);
+        if (!s3_output) {
+            unlink(output_path);
         }
+        return 1;
+    }
+    if (directory_mode) {
+        printf("\nFound %zu entries (files and directories)\n", num_entries);
     }
 
     if (num_added == 0) {
         fprintf(stderr, "Error: No files or directories were added to archive\n");
         burst_writer_destroy(writer);
-        fclose(output);
-        file_list_destroy(files);
+        close_output(&output, false);
         return 1;
     }
 
@@ -430,8 +653,7 @@ int main(int argc, char **argv) {
     if (burst_writer_finalize(writer) != 0) {
         fprintf(stderr, "Failed to finalize archive\n");
         burst_writer_destroy(writer);
-        fclose(output);
-        file_list_destroy(files);
+        close_output(&output, false);
         return 1;
     }
 
@@ -440,11 +662,15 @@ int main(int argc, char **argv) {
 
     // Cleanup
     burst_writer_destroy(writer);
-    fclose(output);
-    file_list_destroy(files);
+    if (close_output(&output, true) != 0) {
+        fprintf(stderr, "Failed to write archive: %s\n", output_path);
+        return 1;
+    }
 
     printf("\nArchive created successfully: %s\n", output_path);
-    printf("\nTest with: 7zz x %s\n", output_path);
+    if (!s3_output) {
+        printf("\nTest with: 7zz x %s\n", output_path);
+    }
 
     return 0;
 }
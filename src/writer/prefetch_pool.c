@@ -0,0 +1,315 @@
+#include "prefetch_pool.h"
+#include "content_hash.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <zlib.h>
+#include <zstd.h>
+
+#define PREFETCH_CHUNK_SIZE BURST_FRAME_SIZE
+#define PREFETCH_ITEM_OVERHEAD 4096  // Per-file bookkeeping charged to the budget
+
+struct prefetch_pool {
+    pthread_mutex_t mutex;
+    pthread_cond_t work_cv;   // Signalled when an item is queued or on shutdown
+    pthread_cond_t done_cv;   // Signalled when an item completes
+
+    // FIFO of submitted items waiting for a worker
+    struct prefetch_item *queue_head;
+    struct prefetch_item *queue_tail;
+    bool shutdown;
+
+    pthread_t *threads;
+    int num_workers;
+    int compression_level;
+    bool hash_content;
+
+    uint64_t budget_bytes;
+    uint64_t reserved_bytes;  // Sum of reservations of unreleased items
+};
+
+void compressed_file_free(struct compressed_file *compressed) {
+    if (!compressed) {
+        return;
+    }
+    free(compressed->data);
+    free(compressed->frames);
+    memset(compressed, 0, sizeof(*compressed));
+}
+
+// Make room for one more frame of up to max_frame_size bytes
+static int compressed_file_reserve(struct compressed_file *cf, size_t max_frame_size) {
+    if (cf->data_size + max_frame_size > cf->data_capacity) {
+        size_t new_capacity = cf->data_capacity ? cf->data_capacity * 2 : max_frame_size;
+        while (new_capacity < cf->data_size + max_frame_size) {
+            new_capacity *= 2;
+        }
+        uint8_t *new_data = realloc(cf->data, new_capacity);
+        if (!new_data) {
+            return -1;
+        }
+        cf->data = new_data;
+        cf->data_capacity = new_capacity;
+    }
+
+    if (cf->num_frames >= cf->frames_capacity) {
+        size_t new_capacity = cf->frames_capacity ? cf->frames_capacity * 2 : 4;
+        struct compressed_frame *new_frames =
+            realloc(cf->frames, new_capacity * sizeof(struct compressed_frame));
+        if (!new_frames) {
+            return -1;
+        }
+        cf->frames = new_frames;
+        cf->frames_capacity = new_capacity;
+    }
+
+    return 0;
+}
+
+// Read and compress one file into item->compressed using the same chunking
+// and end-of-file rules as burst_writer_add_file.
+static void prefetch_compress_item(struct prefetch_item *item, ZSTD_CCtx *cctx,
+                                   uint8_t *input_buffer, int compression_level,
+                                   bool hash_content) {
+    struct compressed_file *cf = &item->compressed;
+    size_t frame_bound = ZSTD_compressBound(PREFETCH_CHUNK_SIZE);
+    struct content_hash_ctx hash_ctx;
+    content_hash_init(&hash_ctx);
+
+    FILE *input = fopen(item->path, "rb");
+    if (!input) {
+        item->error = errno;
+        item->error_message = strerror(item->error);
+        return;
+    }
+
+    size_t bytes_read;
+    while ((bytes_read = fread(input_buffer, 1, PREFETCH_CHUNK_SIZE, input)) > 0) {
+        cf->crc32 = crc32(cf->crc32, input_buffer, bytes_read);
+        if (hash_content) {
+            content_hash_update(&hash_ctx, input_buffer, bytes_read);
+        }
+
+        if (compressed_file_reserve(cf, frame_bound) != 0) {
+            item->error = ENOMEM;
+            item->error_message = "Failed to allocate compressed frame buffer";
+            break;
+        }
+
+        size_t compressed_size = ZSTD_compressCCtx(cctx,
+                                                   cf->data + cf->data_size, frame_bound,
+                                                   input_buffer, bytes_read,
+                                                   compression_level);
+        if (ZSTD_isError(compressed_size)) {
+            item->error = EIO;
+            item->error_message = ZSTD_getErrorName(compressed_size);
+            break;
+        }
+
+        struct compressed_frame *frame = &cf->frames[cf->num_frames++];
+        frame->offset = cf->data_size;
+        frame->compressed_size = compressed_size;
+        frame->uncompressed_size = bytes_read;
+        frame->at_eof = (bytes_read < PREFETCH_CHUNK_SIZE) || feof(input);
+        frame->is_zero = burst_buffer_is_zero(input_buffer, bytes_read);
+
+        cf->data_size += compressed_size;
+        cf->uncompressed_size += bytes_read;
+    }
+
+    if (item->error == 0 && ferror(input)) {
+        item->error = errno ? errno : EIO;
+        item->error_message = strerror(item->error);
+    }
+
+    if (item->error == 0 && hash_content) {
+        content_hash_final(&hash_ctx, cf->content_hash);
+        cf->has_content_hash = true;
+    }
+
+    fclose(input);
+}
+
+static void *prefetch_worker(void *arg) {
+    struct prefetch_pool *pool = arg;
+
+    ZSTD_CCtx *cctx = ZSTD_createCCtx();
+    uint8_t *input_buffer = malloc(PREFETCH_CHUNK_SIZE);
+
+    pthread_mutex_lock(&pool->mutex);
+    for (;;) {
+        while (!pool->queue_head && !pool->shutdown) {
+            pthread_cond_wait(&pool->work_cv, &pool->mutex);
+        }
+        if (!pool->queue_head) {
+            break;  // Shutdown with empty queue
+        }
+
+        struct prefetch_item *item = pool->queue_head;
+        pool->queue_head = item->next;
+        if (!pool->queue_head) {
+            pool->queue_tail = NULL;
+        }
+        pthread_mutex_unlock(&pool->mutex);
+
+        if (!cctx || !input_buffer) {
+            item->error = ENOMEM;
+            item->error_message = "Failed to allocate compression context";
+        } else {
+            prefetch_compress_item(item, cctx, input_buffer, pool->compression_level,
+                                   pool->hash_content);
+        }
+
+        pthread_mutex_lock(&pool->mutex);
+        item->done = true;
+        pthread_cond_broadcast(&pool->done_cv);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    free(input_buffer);
+    ZSTD_freeCCtx(cctx);
+    return NULL;
+}
+
+struct prefetch_pool *prefetch_pool_create(int num_workers,
+                                           uint64_t budget_bytes,
+                                           int compression_level) {
+    if (num_workers < 1 || budget_bytes == 0) {
+        return NULL;
+    }
+
+    struct prefetch_pool *pool = calloc(1, sizeof(struct prefetch_pool));
+    if (!pool) {
+        return NULL;
+    }
+
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->work_cv, NULL);
+    pthread_cond_init(&pool->done_cv, NULL);
+    pool->budget_bytes = budget_bytes;
+    pool->compression_level = compression_level;
+
+    pool->threads = calloc((size_t)num_workers, sizeof(pthread_t));
+    if (!pool->threads) {
+        prefetch_pool_destroy(pool);
+        return NULL;
+    }
+
+    for (int i = 0; i < num_workers; i++) {
+        if (pthread_create(&pool->threads[i], NULL, prefetch_worker, pool) != 0) {
+            fprintf(stderr, "Failed to start prefetch worker thread\n");
+            prefetch_pool_destroy(pool);
+            return NULL;
+        }
+        pool->num_workers++;
+    }
+
+    return pool;
+}
+
+void prefetch_pool_destroy(struct prefetch_pool *pool) {
+    if (!pool) {
+        return;
+    }
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->shutdown = true;
+    pthread_cond_broadcast(&pool->work_cv);
+    pthread_mutex_unlock(&pool->mutex);
+
+    for (int i = 0; i < pool->num_workers; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    free(pool->threads);
+
+    pthread_mutex_destroy(&pool->mutex);
+    pthread_cond_destroy(&pool->work_cv);
+    pthread_cond_destroy(&pool->done_cv);
+
+    free(pool);
+}
+
+void prefetch_pool_set_content_hash(struct prefetch_pool *pool, bool enabled) {
+    if (pool) {
+        pool->hash_content = enabled;
+    }
+}
+
+struct prefetch_item *prefetch_pool_submit(struct prefetch_pool *pool,
+                                           const char *path,
+                                           uint64_t expected_size) {
+    if (!pool || !path) {
+        return NULL;
+    }
+
+    uint64_t chunks = (expected_size + PREFETCH_CHUNK_SIZE - 1) / PREFETCH_CHUNK_SIZE;
+    uint64_t reservation = chunks * ZSTD_compressBound(PREFETCH_CHUNK_SIZE) +
+                           PREFETCH_ITEM_OVERHEAD;
+
+    pthread_mutex_lock(&pool->mutex);
+    // Always admit one item so a single file larger than the budget still progresses
+    bool fits = pool->reserved_bytes == 0 ||
+                pool->reserved_bytes + reservation <= pool->budget_bytes;
+    if (fits) {
+        pool->reserved_bytes += reservation;
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    if (!fits) {
+        return NULL;
+    }
+
+    struct prefetch_item *item = calloc(1, sizeof(struct prefetch_item));
+    if (item) {
+        item->path = strdup(path);
+    }
+    if (!item || !item->path) {
+        free(item);
+        pthread_mutex_lock(&pool->mutex);
+        pool->reserved_bytes -= reservation;
+        pthread_mutex_unlock(&pool->mutex);
+        return NULL;
+    }
+    item->reserved_bytes = reservation;
+
+    pthread_mutex_lock(&pool->mutex);
+    if (pool->queue_tail) {
+        pool->queue_tail->next = item;
+    } else {
+        pool->queue_head = item;
+    }
+    pool->queue_tail = item;
+    pthread_cond_signal(&pool->work_cv);
+    pthread_mutex_unlock(&pool->mutex);
+
+    return item;
+}
+
+int prefetch_pool_wait(struct prefetch_pool *pool, struct prefetch_item *item) {
+    pthread_mutex_lock(&pool->mutex);
+    while (!item->done) {
+        pthread_cond_wait(&pool->done_cv, &pool->mutex);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    return item->error == 0 ? 0 : -1;
+}
+
+void prefetch_pool_release(struct prefetch_pool *pool, struct prefetch_item *item) {
+    if (!pool || !item) {
+        return;
+    }
+
+    // Workers may still hold the item; never free it out from under them
+    prefetch_pool_wait(pool, item);
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->reserved_bytes -= item->reserved_bytes;
+    pthread_mutex_unlock(&pool->mutex);
+
+    compressed_file_free(&item->compressed);
+    free(item->path);
+    free(item);
+}
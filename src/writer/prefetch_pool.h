@@ -0,0 +1,70 @@
+#ifndef BURST_PREFETCH_POOL_H
+#define BURST_PREFETCH_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "burst_writer.h"
+
+/*
+ * Cross-file compression workers for trees of many small files.
+ *
+ * The writer thread queues upcoming regular files in archive order. Workers
+ * open, read, CRC (and optionally hash) and compress each file into an in-memory compressed_file,
+ * which the writer later lays out with burst_writer_add_compressed_file().
+ *
+ * Memory is bounded by an in-flight byte budget: each queued file reserves
+ * ZSTD_compressBound(expected size) until it is released, and submissions
+ * that would exceed the budget are refused (unless nothing is in flight).
+ */
+
+// Largest file worth compressing whole in memory; bigger files go through
+// burst_writer_add_file and its per-chunk compression pool instead.
+#define PREFETCH_MAX_FILE_SIZE BURST_PART_SIZE
+
+struct prefetch_pool;
+
+struct prefetch_item {
+    // Set at submit time
+    char *path;
+    uint64_t reserved_bytes;
+
+    // Filled by the worker
+    struct compressed_file compressed;  // With its content hash if the pool hashes content
+    int error;                   // errno-style code, 0 on success
+    const char *error_message;
+
+    // Internal state
+    bool done;
+    struct prefetch_item *next;
+};
+
+// Create a pool of num_workers threads with the given in-flight byte budget.
+struct prefetch_pool *prefetch_pool_create(int num_workers,
+                                           uint64_t budget_bytes,
+                                           int compression_level);
+
+// Stop workers and free the pool. All items must have been released.
+void prefetch_pool_destroy(struct prefetch_pool *pool);
+
+// Also compute the SHA-256 of each file's content (--content-hash). Must be
+// set before the first submission.
+void prefetch_pool_set_content_hash(struct prefetch_pool *pool, bool enabled);
+
+// Queue path for compression. expected_size is the size from stat().
+// Returns NULL if the budget is exhausted or on allocation failure.
+struct prefetch_item *prefetch_pool_submit(struct prefetch_pool *pool,
+                                           const char *path,
+                                           uint64_t expected_size);
+
+// Block until the item is compressed. Returns 0 on success, -1 if the
+// worker failed (see item->error and item->error_message).
+int prefetch_pool_wait(struct prefetch_pool *pool, struct prefetch_item *item);
+
+// Free a completed item and return its reservation to the budget.
+void prefetch_pool_release(struct prefetch_pool *pool, struct prefetch_item *item);
+
+// Free the buffers of a compressed_file (not the struct itself).
+void compressed_file_free(struct compressed_file *compressed);
+
+#endif // BURST_PREFETCH_POOL_H
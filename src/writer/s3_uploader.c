@@ -0,0 +1,374 @@
+#include "s3_uploader.h"
+#include "burst_writer.h"
+
+#include <aws/auth/credentials.h>
+#include <aws/common/allocator.h>
+#include <aws/common/byte_buf.h>
+#include <aws/common/condition_variable.h>
+#include <aws/common/error.h>
+#include <aws/common/mutex.h>
+#include <aws/common/uri.h>
+#include <aws/http/request_response.h>
+#include <aws/io/channel_bootstrap.h>
+#include <aws/io/event_loop.h>
+#include <aws/io/future.h>
+#include <aws/io/host_resolver.h>
+#include <aws/io/tls_channel_handler.h>
+#include <aws/s3/s3_client.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// How long to wait on the CRT before printing that the upload is stalled
+#define WAIT_INTERVAL_NS (60 * 1000 * 1000 * 1000ULL)
+
+struct s3_uploader {
+    struct aws_allocator *allocator;
+    struct aws_event_loop_group *event_loop_group;
+    struct aws_host_resolver *host_resolver;
+    struct aws_client_bootstrap *client_bootstrap;
+    struct aws_tls_ctx *tls_ctx;
+    struct aws_credentials_provider *credentials_provider;
+    struct aws_s3_client *s3_client;
+    struct aws_s3_meta_request *meta_request;
+
+    struct aws_uri endpoint;
+    bool has_endpoint;
+
+    uint64_t bytes_written;      // Handed to the CRT (writer thread only)
+    bool failed;                 // A write failed; no further writes are attempted
+
+    // Completion state, set from the CRT's event loop thread
+    struct aws_mutex mutex;
+    struct aws_condition_variable condition_variable;
+    bool finished;
+    int error_code;
+    int response_status;
+};
+
+static void upload_finish_callback(struct aws_s3_meta_request *meta_request,
+                                   const struct aws_s3_meta_request_result *result,
+                                   void *user_data) {
+    (void)meta_request;
+    struct s3_uploader *uploader = user_data;
+
+    aws_mutex_lock(&uploader->mutex);
+    uploader->error_code = result->error_code;
+    uploader->response_status = result->response_status;
+    uploader->finished = true;
+    aws_condition_variable_notify_all(&uploader->condition_variable);
+    aws_mutex_unlock(&uploader->mutex);
+}
+
+static bool is_finished(void *user_data) {
+    struct s3_uploader *uploader = user_data;
+    return uploader->finished;
+}
+
+static void wait_for_finish(struct s3_uploader *uploader) {
+    aws_mutex_lock(&uploader->mutex);
+    aws_condition_variable_wait_pred(&uploader->condition_variable, &uploader->mutex,
+                                     is_finished, uploader);
+    aws_mutex_unlock(&uploader->mutex);
+}
+
+static int create_client(struct s3_uploader *uploader,
+                         const struct s3_uploader_options *options) {
+    struct aws_allocator *allocator = uploader->allocator;
+
+    uploader->event_loop_group = aws_event_loop_group_new_default(allocator, 0, NULL);
+    if (!uploader->event_loop_group) {
+        return -1;
+    }
+
+    struct aws_host_resolver_default_options resolver_options = {
+        .el_group = uploader->event_loop_group,
+        .max_entries = 8,
+    };
+    uploader->host_resolver = aws_host_resolver_new_default(allocator, &resolver_options);
+    if (!uploader->host_resolver) {
+        return -1;
+    }
+
+    struct aws_client_bootstrap_options bootstrap_options = {
+        .event_loop_group = uploader->event_loop_group,
+        .host_resolver = uploader->host_resolver,
+    };
+    uploader->client_bootstrap = aws_client_bootstrap_new(allocator, &bootstrap_options);
+    if (!uploader->client_bootstrap) {
+        return -1;
+    }
+
+    struct aws_tls_ctx_options tls_ctx_options;
+    aws_tls_ctx_options_init_default_client(&tls_ctx_options, allocator);
+    uploader->tls_ctx = aws_tls_client_ctx_new(allocator, &tls_ctx_options);
+    aws_tls_ctx_options_clean_up(&tls_ctx_options);
+    if (!uploader->tls_ctx) {
+        return -1;
+    }
+
+    const char *profile_to_use = options->profile_name;
+    if (!profile_to_use) {
+        profile_to_use = getenv("AWS_PROFILE");
+    }
+    if (!profile_to_use) {
+        profile_to_use = "default";
+    }
+
+    // Environment, profile, web identity, ECS and IMDS credentials
+    struct aws_credentials_provider_chain_default_options credentials_options = {
+        .bootstrap = uploader->client_bootstrap,
+        .tls_ctx = uploader->tls_ctx,
+        .profile_name_override = aws_byte_cursor_from_c_str(profile_to_use),
+    };
+    uploader->credentials_provider =
+        aws_credentials_provider_new_chain_default(allocator, &credentials_options);
+    if (!uploader->credentials_provider) {
+        return -1;
+    }
+
+    struct aws_signing_config_aws signing_config;
+    aws_s3_init_default_signing_config(&signing_config,
+                                       aws_byte_cursor_from_c_str(options->region),
+                                       uploader->credentials_provider);
+    signing_config.flags.use_double_uri_encode = false;
+
+    // Plain-HTTP endpoints (e.g. a local MinIO) must not be spoken to over TLS
+    bool use_tls = true;
+    if (uploader->has_endpoint) {
+        use_tls = aws_byte_cursor_eq_c_str_ignore_case(aws_uri_scheme(&uploader->endpoint), "https");
+    }
+
+    struct aws_s3_client_config client_config = {
+        .client_bootstrap = uploader->client_bootstrap,
+        .region = aws_byte_cursor_from_c_str(options->region),
+        .signing_config = &signing_config,
+        .tls_mode = use_tls ? AWS_MR_TLS_ENABLED : AWS_MR_TLS_DISABLED,
+        .max_active_connections_override = (uint32_t)options->max_connections,
+        .memory_limit_in_bytes = 1024 * 1024 * 1024,  // 1 GiB (AWS CRT minimum)
+        .part_size = BURST_PART_SIZE,
+        .throughput_target_gbps = 10.0,
+    };
+
+    uploader->s3_client = aws_s3_client_new(allocator, &client_config);
+    if (!uploader->s3_client) {
+        return -1;
+    }
+
+    return 0;
+}
+
+static int start_upload(struct s3_uploader *uploader,
+                        const struct s3_uploader_options *options) {
+    struct aws_allocator *allocator = uploader->allocator;
+
+    struct aws_http_message *message = aws_http_message_new_request(allocator);
+    if (!message) {
+        return -1;
+    }
+    aws_http_message_set_request_method(message, aws_http_method_put);
+
+    // Custom endpoints use path-style addressing: /BUCKET/KEY on the endpoint's host.
+    // AWS uses virtual-hosted style like the downloader: /KEY on BUCKET.s3.REGION.amazonaws.com.
+    char host_value[256];
+    size_t path_len = strlen(options->bucket) + strlen(options->key) + 3;
+    char *path = malloc(path_len);
+    if (!path) {
+        aws_http_message_release(message);
+        return -1;
+    }
+    if (uploader->has_endpoint) {
+        const struct aws_byte_cursor *authority = aws_uri_authority(&uploader->endpoint);
+        snprintf(host_value, sizeof(host_value), "%.*s", (int)authority->len, (const char *)authority->ptr);
+        snprintf(path, path_len, "/%s/%s", options->bucket, options->key);
+    } else {
+        snprintf(host_value, sizeof(host_value), "%s.s3.%s.amazonaws.com",
+                 options->bucket, options->region);
+        snprintf(path, path_len, "/%s", options->key);
+    }
+    aws_http_message_set_request_path(message, aws_byte_cursor_from_c_str(path));
+
+    struct aws_http_header host_header = {
+        .name = aws_byte_cursor_from_c_str("Host"),
+        .value = aws_byte_cursor_from_c_str(host_value),
+    };
+    aws_http_message_add_header(message, host_header);
+
+    struct aws_http_header content_type_header = {
+        .name = aws_byte_cursor_from_c_str("Content-Type"),
+        .value = aws_byte_cursor_from_c_str("application/zip"),
+    };
+    aws_http_message_add_header(message, content_type_header);
+
+    struct aws_s3_meta_request_options request_options = {
+        .type = AWS_S3_META_REQUEST_TYPE_PUT_OBJECT,
+        .message = message,
+        .send_using_async_writes = true,
+        .part_size = BURST_PART_SIZE,
+        .endpoint = uploader->has_endpoint ? &uploader->endpoint : NULL,
+        .user_data = uploader,
+        .finish_callback = upload_finish_callback,
+    };
+
+    uploader->meta_request = aws_s3_client_make_meta_request(uploader->s3_client, &request_options);
+    aws_http_message_release(message);
+    free(path);
+
+    return uploader->meta_request ? 0 : -1;
+}
+
+struct s3_uploader *s3_uploader_create(const struct s3_uploader_options *options) {
+    if (!options || !options->bucket || !options->key || !options->region) {
+        return NULL;
+    }
+
+    struct aws_allocator *allocator = aws_default_allocator();
+    aws_s3_library_init(allocator);
+
+    struct s3_uploader *uploader = aws_mem_calloc(allocator, 1, sizeof(struct s3_uploader));
+    if (!uploader) {
+        aws_s3_library_clean_up();
+        return NULL;
+    }
+    uploader->allocator = allocator;
+    aws_mutex_init(&uploader->mutex);
+    aws_condition_variable_init(&uploader->condition_variable);
+
+    if (options->endpoint) {
+        struct aws_byte_cursor endpoint_cursor = aws_byte_cursor_from_c_str(options->endpoint);
+        if (aws_uri_init_parse(&uploader->endpoint, allocator, &endpoint_cursor) != AWS_OP_SUCCESS) {
+            fprintf(stderr, "Error: Invalid endpoint URL: %s\n", options->endpoint);
+            s3_uploader_destroy(uploader);
+            return NULL;
+        }
+        uploader->has_endpoint = true;
+    }
+
+    if (create_client(uploader, options) != 0) {
+        fprintf(stderr, "Error: Failed to create S3 client: %s\n",
+                aws_error_debug_str(aws_last_error()));
+        s3_uploader_destroy(uploader);
+        return NULL;
+    }
+
+    if (start_upload(uploader, options) != 0) {
+        fprintf(stderr, "Error: Failed to start upload: %s\n",
+                aws_error_debug_str(aws_last_error()));
+        s3_uploader_destroy(uploader);
+        return NULL;
+    }
+
+    return uploader;
+}
+
+// Hand data to the meta request and wait until the CRT has consumed it
+static int upload_write(struct s3_uploader *uploader, struct aws_byte_cursor data, bool eof) {
+    if (uploader->failed) {
+        return -1;
+    }
+
+    struct aws_future_void *future = aws_s3_meta_request_write(uploader->meta_request, data, eof);
+    while (!aws_future_void_wait(future, WAIT_INTERVAL_NS)) {
+        fprintf(stderr, "Waiting for S3 upload to accept more data...\n");
+    }
+    int error_code = aws_future_void_get_error(future);
+    aws_future_void_release(future);
+
+    if (error_code != AWS_ERROR_SUCCESS) {
+        fprintf(stderr, "Error: S3 upload failed: %s\n", aws_error_debug_str(error_code));
+        uploader->failed = true;
+        return -1;
+    }
+
+    uploader->bytes_written += data.len;
+    return 0;
+}
+
+int s3_uploader_write(void *ctx, const uint8_t *data, size_t len) {
+    struct s3_uploader *uploader = ctx;
+    if (!uploader || !data) {
+        return -1;
+    }
+    return upload_write(uploader, aws_byte_cursor_from_array(data, len), false);
+}
+
+int s3_uploader_complete(struct s3_uploader *uploader) {
+    if (!uploader) {
+        return -1;
+    }
+
+    struct aws_byte_cursor empty = {0};
+    if (upload_write(uploader, empty, true) != 0) {
+        s3_uploader_abort(uploader);
+        return -1;
+    }
+
+    wait_for_finish(uploader);
+
+    if (uploader->error_code != AWS_ERROR_SUCCESS) {
+        fprintf(stderr, "Error: S3 upload failed: %s (HTTP %d)\n",
+                aws_error_debug_str(uploader->error_code), uploader->response_status);
+        return -1;
+    }
+
+    return 0;
+}
+
+void s3_uploader_abort(struct s3_uploader *uploader) {
+    if (!uploader || !uploader->meta_request) {
+        return;
+    }
+
+    aws_s3_meta_request_cancel(uploader->meta_request);
+    wait_for_finish(uploader);
+}
+
+void s3_uploader_destroy(struct s3_uploader *uploader) {
+    if (!uploader) {
+        return;
+    }
+
+    // An upload that was never completed must not leave parts behind
+    if (uploader->meta_request) {
+        aws_mutex_lock(&uploader->mutex);
+        bool finished = uploader->finished;
+        aws_mutex_unlock(&uploader->mutex);
+        if (!finished) {
+            s3_uploader_abort(uploader);
+        }
+        aws_s3_meta_request_release(uploader->meta_request);
+    }
+
+    if (uploader->s3_client) {
+        aws_s3_client_release(uploader->s3_client);
+    }
+    if (uploader->credentials_provider) {
+        aws_credentials_provider_release(uploader->credentials_provider);
+    }
+    if (uploader->tls_ctx) {
+        aws_tls_ctx_release(uploader->tls_ctx);
+    }
+    if (uploader->client_bootstrap) {
+        aws_client_bootstrap_release(uploader->client_bootstrap);
+    }
+    if (uploader->host_resolver) {
+        aws_host_resolver_release(uploader->host_resolver);
+    }
+    if (uploader->event_loop_group) {
+        aws_event_loop_group_release(uploader->event_loop_group);
+    }
+    if (uploader->has_endpoint) {
+        aws_uri_clean_up(&uploader->endpoint);
+    }
+
+    aws_condition_variable_clean_up(&uploader->condition_variable);
+    aws_mutex_clean_up(&uploader->mutex);
+    aws_mem_release(uploader->allocator, uploader);
+
+    aws_s3_library_clean_up();
+}
+
+uint64_t s3_uploader_bytes_written(const struct s3_uploader *uploader) {
+    return uploader ? uploader->bytes_written : 0;
+}
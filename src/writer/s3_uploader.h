@@ -0,0 +1,49 @@
+#ifndef BURST_S3_UPLOADER_H
+#define BURST_S3_UPLOADER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Streaming S3 upload of the archive as it is written (-o s3://BUCKET/KEY).
+ *
+ * The archive is sent with a single aws-c-s3 PutObject meta request fed by
+ * asynchronous writes, so the CRT turns it into a multipart upload with
+ * 8 MiB parts (BURST_PART_SIZE) as data arrives. Each write waits until the
+ * CRT has taken the data, which bounds memory to the parts in flight and
+ * makes compression wait for the network when it gets ahead.
+ *
+ * Only available when burst-writer is built with the AWS CRT (BUILD_WITH_AWS).
+ */
+
+struct s3_uploader;
+
+struct s3_uploader_options {
+    const char *bucket;
+    const char *key;
+    const char *region;
+    const char *endpoint;        // e.g. http://localhost:9000 for S3-compatible servers; NULL for AWS
+    const char *profile_name;    // NULL for $AWS_PROFILE or "default"
+    size_t max_connections;      // 0 for the CRT default
+};
+
+// Start an upload. Returns NULL (with a message) on error.
+struct s3_uploader *s3_uploader_create(const struct s3_uploader_options *options);
+
+// burst_output_fn for burst_writer_create_with_sink(): append len bytes to the object.
+// Returns 0 on success, -1 if the upload failed.
+int s3_uploader_write(void *uploader, const uint8_t *data, size_t len);
+
+// Send the last part and complete the multipart upload. Returns 0 on success, -1 on error.
+int s3_uploader_complete(struct s3_uploader *uploader);
+
+// Cancel an upload that has not completed; the CRT aborts the multipart upload.
+void s3_uploader_abort(struct s3_uploader *uploader);
+
+void s3_uploader_destroy(struct s3_uploader *uploader);
+
+// Bytes handed to the upload so far
+uint64_t s3_uploader_bytes_written(const struct s3_uploader *uploader);
+
+#endif // BURST_S3_UPLOADER_H
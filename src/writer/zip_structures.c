@@ -107,7 +107,8 @@ int write_central_directory(struct burst_writer *writer) {
 
         // Build extra fields for central directory
         // Buffer holds Unix extra field (15 bytes) + ZIP64 extra field (up to 28 bytes)
-        uint8_t extra_field[64];
+        // + content hash extra field (39 bytes) + source stat extra field (37 bytes)
+        uint8_t extra_field[128];
         size_t extra_field_len = 0;
 
         // Add Unix extra field
@@ -136,6 +137,50 @@ int write_central_directory(struct burst_writer *writer) {
             extra_field_len += zip64_len;
         }
 
+        // Add content hash extra field if the entry has one
+        if (entry->has_content_hash) {
+            size_t hash_len = build_content_hash_extra_field(
+                extra_field + extra_field_len,
+                sizeof(extra_field) - extra_field_len,
+                entry->content_hash,
+                entry->content_hash_flags);
+            if (hash_len == 0) {
+                fprintf(stderr, "Failed to build content hash extra field for %s\n", entry->filename);
+                return -1;
+            }
+            extra_field_len += hash_len;
+        }
+
+        // Add source stat extra field if the entry has one
+        if (entry->has_source_stat) {
+            size_t stat_len = build_source_stat_extra_field(
+                extra_field + extra_field_len,
+                sizeof(extra_field) - extra_field_len,
+                entry);
+            if (stat_len == 0) {
+                fprintf(stderr, "Failed to build source stat extra field for %s\n", entry->filename);
+                return -1;
+            }
+            extra_field_len += stat_len;
+        }
+
+        // Hardlinks name the entry holding their data; written after the fixed fields
+        size_t hardlink_len = 0;
+        uint8_t *hardlink_field = NULL;
+        if (entry->hardlink_target) {
+            size_t hardlink_size = BURST_HARDLINK_EXTRA_HEADER_SIZE + strlen(entry->hardlink_target);
+            hardlink_field = malloc(hardlink_size);
+            if (hardlink_field) {
+                hardlink_len = build_hardlink_extra_field(hardlink_field, hardlink_size,
+                                                          entry->hardlink_target);
+            }
+            if (hardlink_len == 0 || extra_field_len + hardlink_len > 0xFFFF) {
+                fprintf(stderr, "Failed to build hardlink extra field for %s\n", entry->filename);
+                free(hardlink_field);
+                return -1;
+            }
+        }
+
         header.signature = ZIP_CENTRAL_DIR_HEADER_SIG;
         header.version_made_by = (3 << 8) | 63;  // Unix (3) + version 6.3
         header.version_needed = entry->version_needed;
@@ -165,27 +210,27 @@ int write_central_directory(struct burst_writer *writer) {
         }
 
         header.filename_length = strlen(entry->filename);
-        header.extra_field_length = extra_field_len;
+        header.extra_field_length = extra_field_len + hardlink_len;
         header.file_comment_length = 0;
         header.disk_number_start = 0;
         header.internal_file_attributes = 0;
         header.external_file_attributes = entry->unix_mode << 16;  // Unix mode in upper 16 bits
 
-        // Write central directory header
-        if (burst_writer_write(writer, &header, sizeof(header)) != 0) {
-            return -1;
+        // Write central directory header, filename and extra fields
+        // (Unix, then ZIP64, content hash and hardlink if present)
+        int rc = burst_writer_write(writer, &header, sizeof(header));
+        if (rc == 0) {
+            rc = burst_writer_write(writer, entry->filename, header.filename_length);
         }
-
-        // Write filename
-        if (burst_writer_write(writer, entry->filename, header.filename_length) != 0) {
-            return -1;
+        if (rc == 0 && extra_field_len > 0) {
+            rc = burst_writer_write(writer, extra_field, extra_field_len);
         }
-
-        // Write extra field (Unix + ZIP64 if present)
-        if (extra_field_len > 0) {
-            if (burst_writer_write(writer, extra_field, extra_field_len) != 0) {
-                return -1;
-            }
+        if (rc == 0 && hardlink_len > 0) {
+            rc = burst_writer_write(writer, hardlink_field, hardlink_len);
+        }
+        free(hardlink_field);
+        if (rc != 0) {
+            return -1;
         }
     }
 
@@ -461,3 +506,83 @@ size_t build_zip64_extra_field(uint8_t *buffer, size_t buffer_size,
 
     return total_size;
 }
+
+size_t build_hardlink_extra_field(uint8_t *buffer, size_t buffer_size, const char *target) {
+    // BURST hardlink extra field (0x4C48) format:
+    //   Header ID:  0x4C48 (2 bytes)
+    //   TSize:      Total data size (2 bytes)
+    //   Version:    1 (1 byte)
+    //   Target:     Archive name of the entry holding the data (TSize - 1 bytes, no NUL)
+    size_t target_len = strlen(target);
+    size_t extra_field_size = BURST_HARDLINK_EXTRA_HEADER_SIZE + target_len;
+    if (target_len == 0 || target_len + 1 > 0xFFFF || buffer_size < extra_field_size) {
+        return 0;
+    }
+
+    uint16_t tsize = (uint16_t)(target_len + 1);
+    buffer[0] = ZIP_EXTRA_BURST_HARDLINK_ID & 0xFF;
+    buffer[1] = (ZIP_EXTRA_BURST_HARDLINK_ID >> 8) & 0xFF;
+    buffer[2] = tsize & 0xFF;
+    buffer[3] = (tsize >> 8) & 0xFF;
+    buffer[4] = BURST_HARDLINK_EXTRA_VERSION;
+    memcpy(buffer + BURST_HARDLINK_EXTRA_HEADER_SIZE, target, target_len);
+
+    return extra_field_size;
+}
+
+size_t build_content_hash_extra_field(uint8_t *buffer, size_t buffer_size,
+                                      const uint8_t hash[BURST_CONTENT_HASH_SIZE],
+                                      uint8_t flags) {
+    // BURST content hash extra field (0x4843) format:
+    //   Header ID:  0x4843 (2 bytes)
+    //   TSize:      Total data size (2 bytes)
+    //   Version:    1 (1 byte)
+    //   Algorithm:  1 = SHA-256 (1 byte)
+    //   Flags:      Bit 0 set if the data is omitted from this entry (1 byte)
+    //   Hash:       Digest of the uncompressed content (32 bytes)
+    if (buffer_size < BURST_CONTENT_HASH_EXTRA_SIZE) {
+        return 0;
+    }
+
+    uint16_t tsize = BURST_CONTENT_HASH_EXTRA_SIZE - 4;
+    buffer[0] = ZIP_EXTRA_BURST_CONTENT_HASH_ID & 0xFF;
+    buffer[1] = (ZIP_EXTRA_BURST_CONTENT_HASH_ID >> 8) & 0xFF;
+    buffer[2] = tsize & 0xFF;
+    buffer[3] = (tsize >> 8) & 0xFF;
+    buffer[4] = BURST_CONTENT_HASH_EXTRA_VERSION;
+    buffer[5] = BURST_CONTENT_HASH_ALGO_SHA256;
+    buffer[6] = flags;
+    memcpy(buffer + 7, hash, BURST_CONTENT_HASH_SIZE);
+
+    return BURST_CONTENT_HASH_EXTRA_SIZE;
+}
+
+size_t build_source_stat_extra_field(uint8_t *buffer, size_t buffer_size,
+                                     const struct file_entry *entry) {
+    // BURST source stat extra field (0x5453) format:
+    //   Header ID:   0x5453 (2 bytes)
+    //   TSize:       Total data size (2 bytes)
+    //   Version:     1 (1 byte)
+    //   Mtime:       Seconds since the epoch, UTC (8 bytes, signed)
+    //   Mtime nsec:  Nanoseconds (4 bytes)
+    //   Ctime:       Seconds since the epoch, UTC (8 bytes, signed)
+    //   Ctime nsec:  Nanoseconds (4 bytes)
+    //   Inode:       Inode number (8 bytes)
+    if (buffer_size < BURST_SOURCE_STAT_EXTRA_SIZE) {
+        return 0;
+    }
+
+    uint16_t tsize = BURST_SOURCE_STAT_EXTRA_SIZE - 4;
+    buffer[0] = ZIP_EXTRA_BURST_SOURCE_STAT_ID & 0xFF;
+    buffer[1] = (ZIP_EXTRA_BURST_SOURCE_STAT_ID >> 8) & 0xFF;
+    buffer[2] = tsize & 0xFF;
+    buffer[3] = (tsize >> 8) & 0xFF;
+    buffer[4] = BURST_SOURCE_STAT_EXTRA_VERSION;
+    memcpy(buffer + 5, &entry->mtime_sec, 8);
+    memcpy(buffer + 13, &entry->mtime_nsec, 4);
+    memcpy(buffer + 17, &entry->ctime_sec, 8);
+    memcpy(buffer + 25, &entry->ctime_nsec, 4);
+    memcpy(buffer + 29, &entry->ino, 8);
+
+    return BURST_SOURCE_STAT_EXTRA_SIZE;
+}
@@ -0,0 +1,257 @@
+/**
+ * Bytes copied to reassemble split frames, per GiB of archive restored
+ *
+ * Writes a multi-part BURST archive of mixed small and large files, then
+ * feeds every part through the part processor in random-sized chunks, as
+ * S3 body callbacks arrive, and reports the bytes copied into the frame
+ * buffer (what BURST_PROFILE counts as frame_carry_bytes) per GiB.
+ *
+ * Encoded writes are stubbed out, so this runs on any filesystem.
+ */
+
+#include "unity.h"
+#include "burst_writer.h"
+#include "zip_structures.h"
+#include "central_dir_parser.h"
+#include "stream_processor.h"
+#include "btrfs_writer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#define MiB (1024 * 1024)
+#define PART_SIZE (8 * MiB)
+
+#define NUM_LARGE_FILES 6
+#define LARGE_FILE_SIZE (6 * MiB)
+#define NUM_SMALL_FILES 400
+#define SMALL_PER_LARGE (NUM_SMALL_FILES / NUM_LARGE_FILES)
+
+// A callback-sized reassembly may copy at most about one frame per frame
+#define MAX_COPIED_PER_GIB 1.25
+
+static char archive_path[256];
+static char output_dir[256];
+static uint8_t *archive;
+static size_t archive_size;
+static struct central_dir_parse_result cd;
+
+// Stand-ins for the BTRFS writer: accept frames without writing them
+int do_write_encoded(int fd, const uint8_t *zstd_frame, size_t frame_len,
+                     uint64_t uncompressed_len, uint64_t file_offset) {
+    (void)fd;
+    (void)zstd_frame;
+    (void)frame_len;
+    (void)uncompressed_len;
+    (void)file_offset;
+    return BTRFS_WRITER_SUCCESS;
+}
+
+int do_write_unencoded(int fd, const uint8_t *zstd_frame, size_t frame_len,
+                       uint64_t uncompressed_len, uint64_t file_offset) {
+    return do_write_encoded(fd, zstd_frame, frame_len, uncompressed_len, file_offset);
+}
+
+bool is_btrfs_filesystem(int fd) {
+    (void)fd;
+    return true;
+}
+
+static uint64_t rng_state = 0x9e3779b97f4a7c15ULL;
+
+static uint64_t next_random(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+// Data that compresses to about half: runs of noise between runs of text
+static void fill_data(uint8_t *data, size_t len) {
+    for (size_t i = 0; i < len; i += 64) {
+        size_t run = len - i < 64 ? len - i : 64;
+        if (next_random() % 2) {
+            for (size_t j = 0; j < run; j++) {
+                data[i + j] = (uint8_t)next_random();
+            }
+        } else {
+            memset(data + i, 'a' + (int)(i / 64 % 26), run);
+        }
+    }
+}
+
+static int add_file(struct burst_writer *writer, const char *name, size_t size) {
+    uint8_t *data = malloc(size);
+    if (!data) {
+        return -1;
+    }
+    fill_data(data, size);
+    FILE *input = fmemopen(data, size, "rb");
+    if (!input) {
+        free(data);
+        return -1;
+    }
+
+    size_t name_len = strlen(name);
+    int lfh_len = (int)(sizeof(struct zip_local_header) + name_len);
+    struct zip_local_header *lfh = calloc(1, (size_t)lfh_len);
+    if (!lfh) {
+        fclose(input);
+        free(data);
+        return -1;
+    }
+    lfh->signature = ZIP_LOCAL_FILE_HEADER_SIG;
+    lfh->version_needed = ZIP_VERSION_ZSTD;
+    lfh->flags = ZIP_FLAG_DATA_DESCRIPTOR;
+    lfh->compression_method = ZIP_METHOD_ZSTD;
+    lfh->last_mod_time = 0x4000;
+    lfh->last_mod_date = 0x5721;
+    lfh->filename_length = (uint16_t)name_len;
+    memcpy((uint8_t *)lfh + sizeof(struct zip_local_header), name, name_len);
+
+    int rc = burst_writer_add_file(writer, input, lfh, lfh_len, false, 0100644, 0, 0);
+    free(lfh);
+    fclose(input);
+    free(data);
+    return rc;
+}
+
+static void write_archive(void) {
+    // The writer reports every file it adds
+    fflush(stdout);
+    int saved_stdout = dup(STDOUT_FILENO);
+    int devnull = open("/dev/null", O_WRONLY);
+    dup2(devnull, STDOUT_FILENO);
+    close(devnull);
+
+    FILE *out = fopen(archive_path, "wb");
+    TEST_ASSERT_NOT_NULL(out);
+    struct burst_writer *writer = burst_writer_create(out, 3);
+    TEST_ASSERT_NOT_NULL(writer);
+
+    char name[64];
+    for (int i = 0; i < NUM_SMALL_FILES; i++) {
+        // Small files between the large ones, so some large ones start mid-part
+        if (i % SMALL_PER_LARGE == 0 && i / SMALL_PER_LARGE < NUM_LARGE_FILES) {
+            snprintf(name, sizeof(name), "large_%d.bin", i);
+            TEST_ASSERT_EQUAL(0, add_file(writer, name, LARGE_FILE_SIZE));
+        }
+        snprintf(name, sizeof(name), "small_%d.bin", i);
+        TEST_ASSERT_EQUAL(0, add_file(writer, name, 4096 + next_random() % (36 * 1024)));
+    }
+
+    TEST_ASSERT_EQUAL(0, burst_writer_finalize(writer));
+    burst_writer_destroy(writer);
+    fclose(out);
+
+    fflush(stdout);
+    dup2(saved_stdout, STDOUT_FILENO);
+    close(saved_stdout);
+}
+
+static void load_archive(void) {
+    FILE *in = fopen(archive_path, "rb");
+    TEST_ASSERT_NOT_NULL(in);
+    fseek(in, 0, SEEK_END);
+    archive_size = (size_t)ftell(in);
+    fseek(in, 0, SEEK_SET);
+    archive = malloc(archive_size);
+    TEST_ASSERT_NOT_NULL(archive);
+    TEST_ASSERT_EQUAL(archive_size, fread(archive, 1, archive_size, in));
+    fclose(in);
+
+    memset(&cd, 0, sizeof(cd));
+    TEST_ASSERT_EQUAL(CENTRAL_DIR_PARSE_SUCCESS,
+                      central_dir_parse(archive, archive_size, archive_size, PART_SIZE, &cd));
+    TEST_ASSERT_GREATER_THAN(2, cd.num_parts);
+}
+
+// The same archive is restored with each chunk size
+void setUp(void) {
+    snprintf(output_dir, sizeof(output_dir), "/tmp/bench_frame_copy_%d", getpid());
+    TEST_ASSERT_EQUAL(0, mkdir(output_dir, 0755));
+    if (!archive) {
+        snprintf(archive_path, sizeof(archive_path), "/tmp/bench_frame_copy_%d.zip", getpid());
+        write_archive();
+        load_archive();
+    }
+}
+
+void tearDown(void) {
+    char cmd[512];
+    snprintf(cmd, sizeof(cmd), "rm -rf %s", output_dir);
+    system(cmd);
+}
+
+// Restore every part from chunks of 1 to max_chunk bytes; returns the bytes
+// copied per GiB of part data fed in
+static double copied_per_gib(size_t max_chunk) {
+    uint64_t fed = 0;
+    uint64_t copied = 0;
+
+    for (size_t p = 0; p < cd.num_parts; p++) {
+        uint64_t start = (uint64_t)p * PART_SIZE;
+        uint64_t end = start + PART_SIZE;
+        if (end > cd.central_dir_offset) {
+            end = cd.central_dir_offset;
+        }
+        if (start >= end) {
+            continue;
+        }
+
+        struct part_processor_state *state =
+            part_processor_create((uint32_t)p, &cd, output_dir, PART_SIZE);
+        TEST_ASSERT_NOT_NULL(state);
+        for (uint64_t pos = start; pos < end;) {
+            size_t len = 1 + (size_t)(next_random() % max_chunk);
+            if (len > end - pos) {
+                len = (size_t)(end - pos);
+            }
+            TEST_ASSERT_EQUAL_MESSAGE(STREAM_PROC_SUCCESS,
+                                      part_processor_process_data(state, archive + pos, len),
+                                      part_processor_get_error(state));
+            pos += len;
+        }
+        TEST_ASSERT_EQUAL(STREAM_PROC_SUCCESS, part_processor_finalize(state));
+        fed += end - start;
+        copied += state->frame_bytes_copied;
+        part_processor_destroy(state);
+    }
+
+    double per_gib = (double)copied / (double)fed;
+    printf("chunks of 1..%zu B: %llu of %llu bytes copied, %.2f GiB per GiB restored\n",
+           max_chunk, (unsigned long long)copied, (unsigned long long)fed, per_gib);
+    return per_gib;
+}
+
+void test_large_chunks(void) {
+    TEST_ASSERT_TRUE(copied_per_gib(300000) <= MAX_COPIED_PER_GIB);
+}
+
+void test_chunks_smaller_than_frames(void) {
+    TEST_ASSERT_TRUE(copied_per_gib(16 * 1024) <= MAX_COPIED_PER_GIB);
+}
+
+void test_tiny_chunks(void) {
+    TEST_ASSERT_TRUE(copied_per_gib(777) <= MAX_COPIED_PER_GIB);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    printf("Archive: %d x %d MiB and %d small files, %d MiB parts\n",
+           NUM_LARGE_FILES, LARGE_FILE_SIZE / MiB, NUM_SMALL_FILES, PART_SIZE / MiB);
+    RUN_TEST(test_large_chunks);
+    RUN_TEST(test_chunks_smaller_than_frames);
+    RUN_TEST(test_tiny_chunks);
+    int failures = UNITY_END();
+
+    if (archive) {
+        central_dir_parse_result_free(&cd);
+        free(archive);
+        unlink(archive_path);
+    }
+    return failures;
+}
@@ -0,0 +1,84 @@
+#!/bin/bash
+# Test hardlink detection in burst-writer
+# Verifies that later links to a file are stored once, as header-only entries,
+# and that the archive stays valid for 7-Zip and alignment checks
+
+set -e  # Exit on error
+
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+PROJECT_ROOT="$(cd "$SCRIPT_DIR/../.." && pwd)"
+BUILD_DIR="$PROJECT_ROOT/build"
+TEST_TMP="$PROJECT_ROOT/tests/tmp/writer_hardlinks"
+
+# Use native 7zz with Zstandard support
+function run_7z() {
+    7zz "$@"
+}
+
+# Clean and create test directory
+rm -rf "$TEST_TMP"
+mkdir -p "$TEST_TMP/input/a" "$TEST_TMP/input/b"
+cd "$TEST_TMP"
+
+echo "=== Test: Hardlinks ==="
+echo
+
+# Incompressible data spanning several parts, with three names
+head -c $((12 * 1024 * 1024)) /dev/urandom > input/a/data.bin
+ln input/a/data.bin input/b/data-link1.bin
+ln input/a/data.bin input/data-link2.bin
+echo "small" > input/a/small.txt
+ln input/a/small.txt input/b/small-link.txt
+touch input/empty.txt
+ln input/empty.txt input/b/empty-link.txt
+
+"$BUILD_DIR/burst-writer" -o links.zip input > links_out.txt 2>&1
+
+echo "Test 1: Later links are recorded as hardlinks..."
+grep -q "Hardlinks: 4" links_out.txt || {
+    echo "❌ Failed: Expected 4 hardlinks"
+    cat links_out.txt
+    exit 1
+}
+echo "✓ 4 hardlinks detected"
+
+echo "Test 2: Data is stored once..."
+ARCHIVE_SIZE=$(stat -c %s links.zip)
+if [ "$ARCHIVE_SIZE" -gt $((16 * 1024 * 1024)) ]; then
+    echo "❌ Failed: Archive is $ARCHIVE_SIZE bytes, data seems to be stored more than once"
+    exit 1
+fi
+echo "✓ Archive is $ARCHIVE_SIZE bytes"
+
+echo "Test 3: Archive is valid..."
+run_7z t links.zip 2>&1 | grep -q "Everything is Ok" || {
+    echo "❌ Failed: Archive with hardlinks invalid"
+    exit 1
+}
+python3 "$PROJECT_ROOT/tests/integration/verify_alignment.py" links.zip || {
+    echo "❌ Failed: Alignment violation detected"
+    exit 1
+}
+echo "✓ 7-Zip and alignment checks pass"
+
+echo "Test 4: Exactly one name of each file carries the data..."
+mkdir -p extract
+run_7z x -oextract links.zip > /dev/null 2>&1
+FULL_COPIES=0
+for f in a/data.bin b/data-link1.bin data-link2.bin; do
+    if cmp -s "input/$f" "extract/input/$f"; then
+        FULL_COPIES=$((FULL_COPIES + 1))
+    elif [ -s "extract/input/$f" ]; then
+        echo "❌ Failed: $f is neither the data nor an empty link entry"
+        exit 1
+    fi
+done
+if [ "$FULL_COPIES" -ne 1 ]; then
+    echo "❌ Failed: Expected 1 full copy of data.bin, found $FULL_COPIES"
+    exit 1
+fi
+echo "✓ Data stored under a single name"
+
+echo
+echo "All hardlink tests passed"
+rm -rf "$TEST_TMP"
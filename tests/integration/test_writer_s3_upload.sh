@@ -0,0 +1,127 @@
+#!/bin/bash
+#
+# Integration test for burst-writer streaming upload (-o s3://BUCKET/KEY)
+#
+# Writes the same inputs once to a local file and once straight to S3, then
+# downloads the uploaded object and checks it is byte-identical. The inputs
+# span several 8 MiB parts so the upload is a real multipart upload.
+#
+# Runs against AWS S3 by default. Set BURST_TEST_S3_ENDPOINT to use a local
+# S3-compatible server instead, e.g.:
+#   BURST_TEST_S3_ENDPOINT=http://localhost:9000 BURST_TEST_BUCKET=burst-test
+#
+
+set -e  # Exit on error
+
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+PROJECT_ROOT="$(cd "$SCRIPT_DIR/../.." && pwd)"
+BUILD_DIR="$PROJECT_ROOT/build"
+BURST_WRITER="$BUILD_DIR/burst-writer"
+TEST_TMP="$PROJECT_ROOT/tests/tmp/writer_s3_upload_test"
+
+# Colors for output
+RED='\033[0;31m'
+GREEN='\033[0;32m'
+NC='\033[0m' # No Color
+
+echo "================================================"
+echo "BURST Writer S3 Upload Integration Test"
+echo "================================================"
+echo ""
+
+# Load configuration from .env if it exists
+if [ -f "$PROJECT_ROOT/.env" ]; then
+    echo "Loading configuration from .env..."
+    # shellcheck source=/dev/null
+    source "$PROJECT_ROOT/.env"
+fi
+
+TEST_BUCKET="${BURST_TEST_BUCKET:-burst-integration-tests}"
+AWS_REGION="${AWS_REGION:-us-east-1}"
+TEST_KEY="writer-upload-test/$(date +%s)-$$.zip"
+
+echo "Configuration:"
+echo "  Test Bucket:  $TEST_BUCKET"
+echo "  Key:          $TEST_KEY"
+echo "  AWS Region:   $AWS_REGION"
+if [ -n "$BURST_TEST_S3_ENDPOINT" ]; then
+    echo "  Endpoint:     $BURST_TEST_S3_ENDPOINT"
+fi
+echo ""
+
+WRITER_ARGS=(--region "$AWS_REGION")
+AWS_ARGS=(--region "$AWS_REGION")
+if [ -n "$BURST_TEST_S3_ENDPOINT" ]; then
+    WRITER_ARGS+=(--endpoint "$BURST_TEST_S3_ENDPOINT")
+    AWS_ARGS+=(--endpoint-url "$BURST_TEST_S3_ENDPOINT")
+fi
+if [ -n "$AWS_PROFILE" ]; then
+    WRITER_ARGS+=(--profile "$AWS_PROFILE")
+fi
+
+# Check prerequisites
+if [ ! -f "$BURST_WRITER" ]; then
+    echo -e "${RED}ERROR: burst-writer not found at $BURST_WRITER${NC}"
+    exit 1
+fi
+if ! command -v aws &> /dev/null; then
+    echo -e "${RED}ERROR: aws CLI not found${NC}"
+    exit 1
+fi
+
+cleanup() {
+    local exit_code=$?
+    echo ""
+    echo "Cleaning up..."
+    aws s3 rm "s3://$TEST_BUCKET/$TEST_KEY" "${AWS_ARGS[@]}" >/dev/null 2>&1 || true
+    rm -rf "$TEST_TMP"
+    if [ $exit_code -ne 0 ]; then
+        echo -e "${RED}✗ Test failed with exit code $exit_code${NC}"
+    fi
+}
+trap cleanup EXIT
+
+rm -rf "$TEST_TMP"
+mkdir -p "$TEST_TMP/input"
+cd "$TEST_TMP"
+
+# Incompressible data so the archive spans several parts
+head -c $((20 * 1024 * 1024)) /dev/urandom > input/random.bin
+seq 1 500000 > input/numbers.txt
+echo "small" > input/small.txt
+
+# Individual files only: their headers carry the files' mtimes, so both runs
+# produce identical bytes
+echo "Writing local archive..."
+"$BURST_WRITER" -o local.zip input/random.bin input/numbers.txt input/small.txt > /dev/null
+echo -e "${GREEN}✓${NC} Local archive: $(stat -c %s local.zip) bytes"
+
+echo "Uploading archive..."
+"$BURST_WRITER" "${WRITER_ARGS[@]}" -o "s3://$TEST_BUCKET/$TEST_KEY" \
+    input/random.bin input/numbers.txt input/small.txt
+echo -e "${GREEN}✓${NC} Upload completed"
+
+aws s3 cp "s3://$TEST_BUCKET/$TEST_KEY" uploaded.zip "${AWS_ARGS[@]}" > /dev/null
+
+if ! cmp -s local.zip uploaded.zip; then
+    echo -e "${RED}✗ FAILED: Uploaded object differs from local archive${NC}"
+    exit 1
+fi
+echo -e "${GREEN}✓${NC} Uploaded object is identical to local archive"
+
+# A run that fails must not leave an object behind
+echo "Checking that a failed upload leaves no object..."
+FAIL_KEY="$TEST_KEY.failed"
+if "$BURST_WRITER" "${WRITER_ARGS[@]}" -o "s3://$TEST_BUCKET/$FAIL_KEY" \
+        input/does-not-exist > /dev/null 2>&1; then
+    echo -e "${RED}✗ FAILED: burst-writer succeeded with a missing input${NC}"
+    exit 1
+fi
+if aws s3api head-object --bucket "$TEST_BUCKET" --key "$FAIL_KEY" "${AWS_ARGS[@]}" > /dev/null 2>&1; then
+    echo -e "${RED}✗ FAILED: Object exists after failed upload${NC}"
+    exit 1
+fi
+echo -e "${GREEN}✓${NC} No object after failed upload"
+
+echo ""
+echo -e "${GREEN}All S3 upload tests passed${NC}"
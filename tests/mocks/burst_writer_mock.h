@@ -23,6 +23,39 @@ int burst_writer_add_file(void *writer,
                           uint32_t uid,
                           uint32_t gid);
 
+int burst_writer_add_compressed_file(void *writer,
+                                     const void *compressed,
+                                     void *lfh,
+                                     int lfh_len,
+                                     uint32_t unix_mode,
+                                     uint32_t uid,
+                                     uint32_t gid);
+
+int burst_writer_add_base_file(void *writer,
+                               void *frames,
+                               void *lfh,
+                               int lfh_len,
+                               uint32_t unix_mode,
+                               uint32_t uid,
+                               uint32_t gid);
+
+int burst_writer_add_hardlink(void *writer,
+                              void *lfh,
+                              int lfh_len,
+                              const char *target,
+                              uint32_t unix_mode,
+                              uint32_t uid,
+                              uint32_t gid);
+
+int burst_writer_add_duplicate(void *writer,
+                               void *lfh,
+                               int lfh_len,
+                               const uint8_t *hash,
+                               uint64_t size,
+                               uint32_t unix_mode,
+                               uint32_t uid,
+                               uint32_t gid);
+
 int burst_writer_add_symlink(void *writer,
                               void *lfh,
                               int lfh_len,
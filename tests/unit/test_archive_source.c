@@ -0,0 +1,288 @@
+/*
+ * Unit tests for archive source locations and the local file source.
+ */
+
+#include "unity.h"
+#include "test_helpers.h"
+#include "archive_source.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define FILE_SIZE (1024 * 1024 + 123)
+
+static char test_file[256];
+static uint8_t expected[FILE_SIZE];
+
+void setUp(void) {
+    snprintf(test_file, sizeof(test_file), "/tmp/burst_source_test_%d.zip", getpid());
+    for (size_t i = 0; i < FILE_SIZE; i++) {
+        expected[i] = (uint8_t)(i * 7 + (i >> 11));
+    }
+    FILE *f = fopen(test_file, "wb");
+    TEST_ASSERT_NOT_NULL(f);
+    TEST_ASSERT_EQUAL(FILE_SIZE, fwrite(expected, 1, FILE_SIZE, f));
+    fclose(f);
+}
+
+void tearDown(void) {
+    unlink(test_file);
+}
+
+// Collects one request's callbacks and lets the test wait for finish()
+struct collector {
+    struct collector_sync sync;
+    int error_code;
+    int status;
+    struct source_response response;
+    char etag[128];
+    uint8_t *data;
+    size_t len;
+    size_t body_calls;
+    bool open_window;  // Reopen the window as each chunk arrives
+    size_t abort_after;  // Fail body() once this many bytes arrived (0 = never)
+};
+
+static void collector_init(struct collector *c) {
+    memset(c, 0, sizeof(*c));
+    collector_sync_init(&c->sync);
+    c->data = malloc(FILE_SIZE);
+    c->open_window = true;
+}
+
+static void collector_free(struct collector *c) {
+    free(c->data);
+    collector_sync_destroy(&c->sync);
+}
+
+static int on_headers(const struct source_response *response, void *user_data) {
+    struct collector *c = user_data;
+    c->response = *response;
+    snprintf(c->etag, sizeof(c->etag), "%s", response->etag ? response->etag : "");
+    return 0;
+}
+
+static int on_body(struct source_request *request, const uint8_t *data, size_t len, void *user_data) {
+    struct collector *c = user_data;
+    memcpy(c->data + c->len, data, len);
+    pthread_mutex_lock(&c->sync.mutex);
+    c->len += len;
+    c->body_calls++;
+    pthread_cond_broadcast(&c->sync.cv);
+    pthread_mutex_unlock(&c->sync.mutex);
+    if (c->abort_after && c->len >= c->abort_after) {
+        return -1;
+    }
+    if (c->open_window) {
+        source_request_open_window(request, len);
+    }
+    return 0;
+}
+
+static void on_finish(int error_code, int response_status, void *user_data) {
+    struct collector *c = user_data;
+    pthread_mutex_lock(&c->sync.mutex);
+    c->error_code = error_code;
+    c->status = response_status;
+    c->sync.finished = true;
+    pthread_cond_broadcast(&c->sync.cv);
+    pthread_mutex_unlock(&c->sync.mutex);
+}
+
+static struct source_request *start(struct archive_source *source, struct collector *c,
+                                    uint64_t start, uint64_t end, uint64_t suffix,
+                                    const char *if_match) {
+    struct source_request_options options = {
+        .start = start,
+        .end = end,
+        .suffix_length = suffix,
+        .if_match = if_match,
+        .headers = on_headers,
+        .body = on_body,
+        .finish = on_finish,
+        .user_data = c,
+    };
+    struct source_request *request = archive_source_request(source, &options);
+    TEST_ASSERT_NOT_NULL(request);
+    return request;
+}
+
+void test_parse_location(void) {
+    enum archive_source_kind kind;
+    const char *path;
+
+    TEST_ASSERT_EQUAL(0, archive_source_parse_location("https://example.com/a.zip", &kind, &path));
+    TEST_ASSERT_EQUAL(ARCHIVE_SOURCE_HTTP, kind);
+    TEST_ASSERT_EQUAL(0, archive_source_parse_location("HTTP://example.com:8080/a.zip", &kind, &path));
+    TEST_ASSERT_EQUAL(ARCHIVE_SOURCE_HTTP, kind);
+
+    TEST_ASSERT_EQUAL(0, archive_source_parse_location("file:///mnt/nfs/a.zip", &kind, &path));
+    TEST_ASSERT_EQUAL(ARCHIVE_SOURCE_FILE, kind);
+    TEST_ASSERT_EQUAL_STRING("/mnt/nfs/a.zip", path);
+    TEST_ASSERT_EQUAL(0, archive_source_parse_location("backups/a.zip", &kind, &path));
+    TEST_ASSERT_EQUAL(ARCHIVE_SOURCE_FILE, kind);
+    TEST_ASSERT_EQUAL_STRING("backups/a.zip", path);
+    TEST_ASSERT_EQUAL(0, archive_source_parse_location("./odd://name.zip", &kind, &path));
+    TEST_ASSERT_EQUAL(ARCHIVE_SOURCE_FILE, kind);
+
+    TEST_ASSERT_EQUAL(-1, archive_source_parse_location("s3://bucket/a.zip", &kind, &path));
+    TEST_ASSERT_EQUAL(-1, archive_source_parse_location("file://host/a.zip", &kind, &path));
+    TEST_ASSERT_EQUAL(-1, archive_source_parse_location("", &kind, &path));
+}
+
+void test_file_range_in_order(void) {
+    // A window smaller than a chunk: every body() waits for the previous one to reopen it
+    struct archive_source *source = archive_source_new_file(test_file, 100000);
+    TEST_ASSERT_NOT_NULL(source);
+
+    struct collector c;
+    collector_init(&c);
+    struct source_request *request = start(source, &c, 1000, 900999, 0, NULL);
+    wait_finished(&c.sync);
+    source_request_release(request);
+
+    TEST_ASSERT_EQUAL(0, c.error_code);
+    TEST_ASSERT_EQUAL(206, c.status);
+    TEST_ASSERT_EQUAL_UINT64(1000, c.response.range_start);
+    TEST_ASSERT_EQUAL_UINT64(900999, c.response.range_end);
+    TEST_ASSERT_EQUAL_UINT64(FILE_SIZE, c.response.total_size);
+    TEST_ASSERT_EQUAL_size_t(900000, c.len);
+    TEST_ASSERT_EQUAL(9, c.body_calls);
+    TEST_ASSERT_EQUAL_MEMORY(expected + 1000, c.data, c.len);
+
+    collector_free(&c);
+    archive_source_destroy(source);
+}
+
+void test_file_suffix_and_etag(void) {
+    struct archive_source *source = archive_source_new_file(test_file, 8 * 1024 * 1024);
+    TEST_ASSERT_NOT_NULL(source);
+
+    struct collector c;
+    collector_init(&c);
+    struct source_request *request = start(source, &c, 0, 0, 5000, NULL);
+    wait_finished(&c.sync);
+    source_request_release(request);
+
+    TEST_ASSERT_EQUAL(0, c.error_code);
+    TEST_ASSERT_EQUAL_UINT64(FILE_SIZE - 5000, c.response.range_start);
+    TEST_ASSERT_EQUAL_size_t(5000, c.len);
+    TEST_ASSERT_EQUAL_MEMORY(expected + FILE_SIZE - 5000, c.data, c.len);
+    TEST_ASSERT_TRUE(strlen(c.etag) > 2);
+
+    // A suffix longer than the file returns all of it; If-Match with the ETag passes
+    struct collector all;
+    collector_init(&all);
+    request = start(source, &all, 0, 0, 8 * 1024 * 1024, c.etag);
+    wait_finished(&all.sync);
+    source_request_release(request);
+    TEST_ASSERT_EQUAL(0, all.error_code);
+    TEST_ASSERT_EQUAL_UINT64(0, all.response.range_start);
+    TEST_ASSERT_EQUAL_size_t(FILE_SIZE, all.len);
+
+    // Any other ETag is a precondition failure
+    struct collector other;
+    collector_init(&other);
+    request = start(source, &other, 0, 99, 0, "\"not-this-one\"");
+    wait_finished(&other.sync);
+    source_request_release(request);
+    TEST_ASSERT_NOT_EQUAL(0, other.error_code);
+    TEST_ASSERT_EQUAL(412, other.status);
+    TEST_ASSERT_EQUAL_size_t(0, other.len);
+
+    collector_free(&c);
+    collector_free(&all);
+    collector_free(&other);
+    archive_source_destroy(source);
+}
+
+void test_file_range_past_end(void) {
+    struct archive_source *source = archive_source_new_file(test_file, 8 * 1024 * 1024);
+    TEST_ASSERT_NOT_NULL(source);
+
+    // Clamped to the end of the file, like an HTTP server does
+    struct collector c;
+    collector_init(&c);
+    struct source_request *request = start(source, &c, FILE_SIZE - 10, FILE_SIZE + 1000, 0, NULL);
+    wait_finished(&c.sync);
+    source_request_release(request);
+    TEST_ASSERT_EQUAL(0, c.error_code);
+    TEST_ASSERT_EQUAL_size_t(10, c.len);
+
+    struct collector past;
+    collector_init(&past);
+    request = start(source, &past, FILE_SIZE, FILE_SIZE + 10, 0, NULL);
+    wait_finished(&past.sync);
+    source_request_release(request);
+    TEST_ASSERT_NOT_EQUAL(0, past.error_code);
+    TEST_ASSERT_EQUAL(416, past.status);
+
+    collector_free(&c);
+    collector_free(&past);
+    archive_source_destroy(source);
+}
+
+void test_file_backpressure_and_cancel(void) {
+    struct archive_source *source = archive_source_new_file(test_file, 4096);
+    TEST_ASSERT_NOT_NULL(source);
+
+    // Nothing reopens the window, so the request stalls after 4096 bytes
+    struct collector c;
+    collector_init(&c);
+    c.open_window = false;
+    struct source_request *request = start(source, &c, 0, FILE_SIZE - 1, 0, NULL);
+
+    pthread_mutex_lock(&c.sync.mutex);
+    while (c.len < 4096) {
+        pthread_cond_wait(&c.sync.cv, &c.sync.mutex);
+    }
+    pthread_mutex_unlock(&c.sync.mutex);
+    usleep(20000);
+    TEST_ASSERT_FALSE(c.sync.finished);
+    TEST_ASSERT_EQUAL_size_t(4096, c.len);
+
+    source_request_cancel(request);
+    wait_finished(&c.sync);
+    source_request_release(request);
+    TEST_ASSERT_EQUAL(ECANCELED, c.error_code);
+    TEST_ASSERT_EQUAL_size_t(4096, c.len);
+
+    collector_free(&c);
+    archive_source_destroy(source);
+}
+
+void test_file_body_abort(void) {
+    struct archive_source *source = archive_source_new_file(test_file, 8 * 1024 * 1024);
+    TEST_ASSERT_NOT_NULL(source);
+
+    struct collector c;
+    collector_init(&c);
+    c.abort_after = 1;
+    struct source_request *request = start(source, &c, 0, FILE_SIZE - 1, 0, NULL);
+    wait_finished(&c.sync);
+    source_request_release(request);
+    TEST_ASSERT_NOT_EQUAL(0, c.error_code);
+    TEST_ASSERT_EQUAL(1, c.body_calls);
+
+    collector_free(&c);
+    archive_source_destroy(source);
+}
+
+void test_file_missing(void) {
+    TEST_ASSERT_NULL(archive_source_new_file("/nonexistent/burst.zip", 4096));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_parse_location);
+    RUN_TEST(test_file_range_in_order);
+    RUN_TEST(test_file_suffix_and_etag);
+    RUN_TEST(test_file_range_past_end);
+    RUN_TEST(test_file_backpressure_and_cancel);
+    RUN_TEST(test_file_body_abort);
+    RUN_TEST(test_file_missing);
+    return UNITY_END();
+}
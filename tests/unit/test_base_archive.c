@@ -0,0 +1,415 @@
+/*
+ * Unit tests for incremental archives built on a base archive (--base).
+ *
+ * Archives are written to temporary files with burst_writer, reopened as a
+ * base, and their frames copied into new archives.
+ */
+
+#include "unity.h"
+#include "test_helpers.h"
+#include "burst_writer.h"
+#include "zip_structures.h"
+#include "central_dir_parser.h"
+#include "../../src/writer/base_archive.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <zlib.h>
+#include <zstd.h>
+
+#define TEST_MTIME 1700000000
+#define TEST_MTIME_NSEC 123456789
+#define TEST_INO 4242
+
+// Larger than a part, so the base contains padding and Start-of-Part frames
+#define BIG_FILE_SIZE (10 * 1024 * 1024 + 12345)
+
+static char base_path[64];
+static char out_path[64];
+static char input_path[64];
+static bool hash_archives;  // Write archives with content hashes (--content-hash)
+static bool stat_archives;  // Record the source stat of each file, as burst-writer does
+
+static void make_temp_path(char *path, size_t size) {
+    snprintf(path, size, "/tmp/test_base_archive_XXXXXX");
+    int fd = mkstemp(path);
+    TEST_ASSERT_TRUE(fd >= 0);
+    close(fd);
+}
+
+void setUp(void) {
+    make_temp_path(base_path, sizeof(base_path));
+    make_temp_path(out_path, sizeof(out_path));
+    make_temp_path(input_path, sizeof(input_path));
+    hash_archives = false;
+    stat_archives = true;
+}
+
+void tearDown(void) {
+    unlink(base_path);
+    unlink(out_path);
+    unlink(input_path);
+}
+
+static uint8_t *make_test_data(size_t len, uint32_t seed) {
+    uint8_t *buf = malloc(len);
+    uint32_t x = seed;
+    for (size_t i = 0; i < len; i++) {
+        x = x * 1103515245 + 12345;
+        buf[i] = (uint8_t)((x >> 16) & 0x0F) + 'a';
+    }
+    return buf;
+}
+
+static void write_input_file(const uint8_t *data, size_t len) {
+    FILE *f = fopen(input_path, "wb");
+    TEST_ASSERT_NOT_NULL(f);
+    TEST_ASSERT_EQUAL(len, fwrite(data, 1, len, f));
+    fclose(f);
+}
+
+static struct stat file_stat(size_t len, time_t mtime) {
+    struct stat st;
+    memset(&st, 0, sizeof(st));
+    st.st_mode = S_IFREG | 0644;
+    st.st_size = (off_t)len;
+    st.st_mtim.tv_sec = mtime;
+    st.st_mtim.tv_nsec = TEST_MTIME_NSEC;
+    st.st_ctim = st.st_mtim;
+    st.st_ino = TEST_INO;
+    return st;
+}
+
+// create_test_lfh() dated mtime
+static void create_dated_lfh(uint8_t *buffer, const char *filename, time_t mtime,
+                             struct zip_local_header **lfh_out, int *lfh_len_out) {
+    create_test_lfh(buffer, filename, false, lfh_out, lfh_len_out);
+    uint16_t mod_time, mod_date;
+    dos_datetime_from_time_t(mtime, &mod_time, &mod_date);
+    (*lfh_out)->last_mod_time = mod_time;
+    (*lfh_out)->last_mod_date = mod_date;
+}
+
+/*
+ * Write an archive of the given files to path. Files named in reuse are
+ * copied from base instead of being compressed.
+ */
+static void write_archive(const char *path, size_t num_files,
+                          const char **names, uint8_t **datas, const size_t *lens,
+                          struct base_archive *base, const bool *reuse) {
+    FILE *out = fopen(path, "wb");
+    TEST_ASSERT_NOT_NULL(out);
+    struct burst_writer *writer = burst_writer_create(out, 3);
+    TEST_ASSERT_NOT_NULL(writer);
+    TEST_ASSERT_EQUAL(0, burst_writer_set_content_hashing(writer, hash_archives));
+
+    for (size_t i = 0; i < num_files; i++) {
+        uint8_t lfh_buf[128];
+        struct zip_local_header *lfh;
+        int lfh_len;
+        create_dated_lfh(lfh_buf, names[i], TEST_MTIME, &lfh, &lfh_len);
+        struct stat st = file_stat(lens[i], TEST_MTIME);
+
+        if (base && reuse[i]) {
+            const struct file_metadata *file = base_archive_find_unchanged(base, names[i], &st);
+            TEST_ASSERT_NOT_NULL(file);
+            struct base_frame_reader *frames = base_frame_reader_open(base, file);
+            TEST_ASSERT_NOT_NULL(frames);
+            TEST_ASSERT_EQUAL(0, burst_writer_add_base_file(writer, frames, lfh, lfh_len,
+                                                            0100644, 0, 0));
+            base_frame_reader_close(frames);
+        } else {
+            write_input_file(datas[i], lens[i]);
+            FILE *in = fopen(input_path, "rb");
+            TEST_ASSERT_NOT_NULL(in);
+            TEST_ASSERT_EQUAL(0, burst_writer_add_file(writer, in, lfh, lfh_len, false,
+                                                       0100644, 0, 0));
+            fclose(in);
+        }
+        if (stat_archives) {
+            TEST_ASSERT_EQUAL(0, burst_writer_set_source_stat(writer, &st));
+        }
+    }
+
+    TEST_ASSERT_EQUAL(0, burst_writer_finalize(writer));
+    burst_writer_destroy(writer);
+    fclose(out);
+}
+
+static uint8_t *read_whole_file(const char *path, long *size_out) {
+    FILE *f = fopen(path, "rb");
+    TEST_ASSERT_NOT_NULL(f);
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    rewind(f);
+    uint8_t *buf = malloc((size_t)size);
+    TEST_ASSERT_EQUAL((size_t)size, fread(buf, 1, (size_t)size, f));
+    fclose(f);
+    *size_out = size;
+    return buf;
+}
+
+// Decode every frame of name in the archive at path and compare with expected
+static void assert_file_decodes(const char *path, const char *name,
+                                const uint8_t *expected, size_t len) {
+    struct base_archive *archive = base_archive_open(path);
+    TEST_ASSERT_NOT_NULL(archive);
+    struct stat st = file_stat(len, TEST_MTIME);
+    const struct file_metadata *file = base_archive_find_unchanged(archive, name, &st);
+    TEST_ASSERT_NOT_NULL(file);
+
+    struct base_frame_reader *frames = base_frame_reader_open(archive, file);
+    TEST_ASSERT_NOT_NULL(frames);
+
+    uint8_t *actual = malloc(len);
+    size_t pos = 0;
+    struct base_frame frame;
+    int rc;
+    while ((rc = base_frame_reader_next(frames, &frame)) > 0) {
+        size_t n = ZSTD_decompress(actual + pos, len - pos, frame.data, frame.compressed_size);
+        TEST_ASSERT_FALSE(ZSTD_isError(n));
+        TEST_ASSERT_EQUAL(frame.uncompressed_size, n);
+        pos += n;
+        TEST_ASSERT_EQUAL(pos == len, frame.at_eof);
+    }
+    TEST_ASSERT_EQUAL(0, rc);
+    TEST_ASSERT_EQUAL(len, pos);
+    TEST_ASSERT_EQUAL_MEMORY(expected, actual, len);
+    TEST_ASSERT_EQUAL_HEX32(crc32(0, expected, (uInt)len), base_frame_reader_crc32(frames));
+
+    free(actual);
+    base_frame_reader_close(frames);
+    base_archive_close(archive);
+}
+
+// =============================================================================
+// Lookup Tests
+// =============================================================================
+
+void test_find_unchanged_matches_name_size_and_stat(void) {
+    const char *names[] = {"a.txt", "dir/b.txt"};
+    size_t lens[] = {1000, 5000};
+    uint8_t *datas[] = {make_test_data(lens[0], 1), make_test_data(lens[1], 2)};
+    write_archive(base_path, 2, names, datas, lens, NULL, NULL);
+
+    struct base_archive *base = base_archive_open(base_path);
+    TEST_ASSERT_NOT_NULL(base);
+    TEST_ASSERT_EQUAL(2, base_archive_num_files(base));
+
+    struct stat st = file_stat(5000, TEST_MTIME);
+    const struct file_metadata *file = base_archive_find_unchanged(base, "dir/b.txt", &st);
+    TEST_ASSERT_NOT_NULL(file);
+    TEST_ASSERT_EQUAL_STRING("dir/b.txt", file->filename);
+
+    // Different size
+    st = file_stat(5001, TEST_MTIME);
+    TEST_ASSERT_NULL(base_archive_find_unchanged(base, "dir/b.txt", &st));
+
+    // Touched since the base was written
+    st = file_stat(5000, TEST_MTIME + 10);
+    TEST_ASSERT_NULL(base_archive_find_unchanged(base, "dir/b.txt", &st));
+
+    // Touched within the same DOS time (2 second resolution)
+    st = file_stat(5000, TEST_MTIME);
+    st.st_mtim.tv_nsec++;
+    TEST_ASSERT_NULL(base_archive_find_unchanged(base, "dir/b.txt", &st));
+
+    // Written and then set back to its old mtime (touch -d, rsync -t)
+    st = file_stat(5000, TEST_MTIME);
+    st.st_ctim.tv_sec += 60;
+    TEST_ASSERT_NULL(base_archive_find_unchanged(base, "dir/b.txt", &st));
+
+    // Replaced by another file (mv over it)
+    st = file_stat(5000, TEST_MTIME);
+    st.st_ino++;
+    TEST_ASSERT_NULL(base_archive_find_unchanged(base, "dir/b.txt", &st));
+
+    // Not in the base
+    st = file_stat(1000, TEST_MTIME);
+    TEST_ASSERT_NULL(base_archive_find_unchanged(base, "c.txt", &st));
+    TEST_ASSERT_NOT_NULL(base_archive_find_unchanged(base, "a.txt", &st));
+
+    // Not a regular file
+    st.st_mode = S_IFLNK | 0777;
+    TEST_ASSERT_NULL(base_archive_find_unchanged(base, "a.txt", &st));
+
+    base_archive_close(base);
+    free(datas[0]);
+    free(datas[1]);
+}
+
+// Without a source stat only the DOS time is known, which is not enough
+void test_find_unchanged_needs_source_stat(void) {
+    const char *names[] = {"a.txt"};
+    size_t lens[] = {1000};
+    uint8_t *datas[] = {make_test_data(lens[0], 1)};
+    stat_archives = false;
+    write_archive(base_path, 1, names, datas, lens, NULL, NULL);
+
+    struct base_archive *base = base_archive_open(base_path);
+    TEST_ASSERT_NOT_NULL(base);
+    struct stat st = file_stat(lens[0], TEST_MTIME);
+    TEST_ASSERT_NULL(base_archive_find_unchanged(base, "a.txt", &st));
+
+    base_archive_close(base);
+    free(datas[0]);
+}
+
+void test_open_rejects_non_archive(void) {
+    uint8_t *data = make_test_data(4096, 3);
+    write_input_file(data, 4096);
+    TEST_ASSERT_NULL(base_archive_open(input_path));
+    TEST_ASSERT_NULL(base_archive_open("/nonexistent/base.zip"));
+    free(data);
+}
+
+void test_verify_crc_detects_same_size_change(void) {
+    const char *names[] = {"a.txt"};
+    size_t lens[] = {70000};
+    uint8_t *datas[] = {make_test_data(lens[0], 4)};
+    write_archive(base_path, 1, names, datas, lens, NULL, NULL);
+
+    struct base_archive *base = base_archive_open(base_path);
+    TEST_ASSERT_NOT_NULL(base);
+    struct stat st = file_stat(lens[0], TEST_MTIME);
+    const struct file_metadata *file = base_archive_find_unchanged(base, "a.txt", &st);
+    TEST_ASSERT_NOT_NULL(file);
+
+    write_input_file(datas[0], lens[0]);
+    TEST_ASSERT_EQUAL(0, base_archive_verify_crc(file, input_path));
+
+    datas[0][12345] ^= 0x01;
+    write_input_file(datas[0], lens[0]);
+    TEST_ASSERT_EQUAL(-1, base_archive_verify_crc(file, input_path));
+
+    base_archive_close(base);
+    free(datas[0]);
+}
+
+// =============================================================================
+// Frame Reuse Tests
+// =============================================================================
+
+// Frames come back in order across part boundaries, without the base's padding
+void test_frames_decode_across_parts(void) {
+    const char *names[] = {"big.bin"};
+    size_t lens[] = {BIG_FILE_SIZE};
+    uint8_t *datas[] = {make_test_data(lens[0], 5)};
+    write_archive(base_path, 1, names, datas, lens, NULL, NULL);
+
+    assert_file_decodes(base_path, "big.bin", datas[0], lens[0]);
+
+    free(datas[0]);
+}
+
+// An unchanged tree produces the same archive whether frames are copied or not
+void test_reused_archive_matches_fresh(void) {
+    const char *names[] = {"small.txt", "big.bin", "last.txt"};
+    size_t lens[] = {3000, BIG_FILE_SIZE, 200000};
+    uint8_t *datas[] = {make_test_data(lens[0], 6), make_test_data(lens[1], 7),
+                        make_test_data(lens[2], 8)};
+    bool reuse[] = {true, true, true};
+    write_archive(base_path, 3, names, datas, lens, NULL, NULL);
+
+    struct base_archive *base = base_archive_open(base_path);
+    TEST_ASSERT_NOT_NULL(base);
+    write_archive(out_path, 3, names, datas, lens, base, reuse);
+    base_archive_close(base);
+
+    long base_size, out_size;
+    uint8_t *base_bytes = read_whole_file(base_path, &base_size);
+    uint8_t *out_bytes = read_whole_file(out_path, &out_size);
+    TEST_ASSERT_EQUAL(base_size, out_size);
+    TEST_ASSERT_EQUAL_MEMORY(base_bytes, out_bytes, (size_t)base_size);
+
+    free(base_bytes);
+    free(out_bytes);
+    for (int i = 0; i < 3; i++) {
+        free(datas[i]);
+    }
+}
+
+// A changed file ahead of a reused one shifts its frames; alignment is redone
+void test_reused_frames_realigned_after_change(void) {
+    const char *names[] = {"changed.txt", "big.bin"};
+    size_t lens[] = {3000, BIG_FILE_SIZE};
+    uint8_t *datas[] = {make_test_data(lens[0], 9), make_test_data(lens[1], 10)};
+    write_archive(base_path, 2, names, datas, lens, NULL, NULL);
+
+    free(datas[0]);
+    lens[0] = 4 * 1024 * 1024 + 999;
+    datas[0] = make_test_data(lens[0], 11);
+    bool reuse[] = {false, true};
+
+    struct base_archive *base = base_archive_open(base_path);
+    TEST_ASSERT_NOT_NULL(base);
+    write_archive(out_path, 2, names, datas, lens, base, reuse);
+    base_archive_close(base);
+
+    assert_file_decodes(out_path, "changed.txt", datas[0], lens[0]);
+    assert_file_decodes(out_path, "big.bin", datas[1], lens[1]);
+
+    free(datas[0]);
+    free(datas[1]);
+}
+
+// Copied frames keep the content hash the base recorded for them
+void test_reused_file_keeps_content_hash(void) {
+    const char *names[] = {"small.txt", "big.bin"};
+    size_t lens[] = {3000, BIG_FILE_SIZE};
+    uint8_t *datas[] = {make_test_data(lens[0], 12), make_test_data(lens[1], 13)};
+    bool reuse[] = {true, true};
+    hash_archives = true;
+    write_archive(base_path, 2, names, datas, lens, NULL, NULL);
+
+    struct base_archive *base = base_archive_open(base_path);
+    TEST_ASSERT_NOT_NULL(base);
+    write_archive(out_path, 2, names, datas, lens, base, reuse);
+    base_archive_close(base);
+
+    // Same bytes as the base, central directory and its hashes included
+    long base_size, out_size;
+    uint8_t *base_bytes = read_whole_file(base_path, &base_size);
+    uint8_t *out_bytes = read_whole_file(out_path, &out_size);
+    TEST_ASSERT_EQUAL(base_size, out_size);
+    TEST_ASSERT_EQUAL_MEMORY(base_bytes, out_bytes, (size_t)base_size);
+
+    struct central_dir_parse_result result;
+    TEST_ASSERT_EQUAL(CENTRAL_DIR_PARSE_SUCCESS,
+                      central_dir_parse(out_bytes, (size_t)out_size, (uint64_t)out_size,
+                                        BURST_PART_SIZE, &result));
+    TEST_ASSERT_TRUE(result.files[0].has_content_hash);
+    TEST_ASSERT_TRUE(result.files[1].has_content_hash);
+    central_dir_parse_result_free(&result);
+
+    free(base_bytes);
+    free(out_bytes);
+    free(datas[0]);
+    free(datas[1]);
+}
+
+void test_add_base_file_null_args(void) {
+    uint8_t lfh_buf[128];
+    struct zip_local_header *lfh;
+    int lfh_len;
+    create_dated_lfh(lfh_buf, "a", TEST_MTIME, &lfh, &lfh_len);
+    TEST_ASSERT_EQUAL(-1, burst_writer_add_base_file(NULL, NULL, lfh, lfh_len, 0100644, 0, 0));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_find_unchanged_matches_name_size_and_stat);
+    RUN_TEST(test_find_unchanged_needs_source_stat);
+    RUN_TEST(test_open_rejects_non_archive);
+    RUN_TEST(test_verify_crc_detects_same_size_change);
+
+    RUN_TEST(test_frames_decode_across_parts);
+    RUN_TEST(test_reused_archive_matches_fresh);
+    RUN_TEST(test_reused_frames_realigned_after_change);
+    RUN_TEST(test_reused_file_keeps_content_hash);
+    RUN_TEST(test_add_base_file_null_args);
+
+    return UNITY_END();
+}
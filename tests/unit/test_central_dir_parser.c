@@ -535,6 +535,12 @@ void test_continuing_file_detection(void) {
     TEST_ASSERT_NOT_NULL(result.parts[1].continuing_file);
     TEST_ASSERT_EQUAL_STRING("a.txt", result.parts[1].continuing_file->filename);
 
+    // a.txt is written by two parts, which share its fd
+    TEST_ASSERT_EQUAL_UINT32(2, result.parts[1].continuing_file->num_parts_spanned);
+    TEST_ASSERT_EQUAL_INT(2, result.parts[1].continuing_file->parts_pending);
+    TEST_ASSERT_EQUAL_INT(-1, result.parts[1].continuing_file->shared_fd);
+    TEST_ASSERT_EQUAL_UINT32(1, result.files[result.parts[1].entries[0].file_index].num_parts_spanned);
+
     central_dir_parse_result_free(&result);
 }
 
@@ -1010,6 +1016,78 @@ void test_partial_cd_parse_invalid_part_size(void) {
     TEST_ASSERT_EQUAL_INT(CENTRAL_DIR_PARSE_ERR_INVALID_BUFFER, rc);
 }
 
+// =============================================================================
+// Directory Table Tests
+// =============================================================================
+
+// Append a minimal central directory header for name at buffer, return its size
+static size_t append_cdfh(uint8_t *buffer, const char *name, uint32_t local_offset) {
+    size_t name_len = strlen(name);
+    memset(buffer, 0, 46);
+    buffer[0] = 0x50; buffer[1] = 0x4b; buffer[2] = 0x01; buffer[3] = 0x02;  // signature
+    buffer[4] = 0x14;                                                         // version made by
+    buffer[6] = 0x0a;                                                         // version needed
+    buffer[28] = (uint8_t)name_len;                                           // filename length
+    memcpy(buffer + 42, &local_offset, 4);
+    memcpy(buffer + 46, name, name_len);
+    return 46 + name_len;
+}
+
+static void assert_dir(const struct central_dir_parse_result *result, size_t index,
+                       const char *path, const char *parent) {
+    TEST_ASSERT_EQUAL_STRING(path, result->dirs[index].path);
+    if (parent == NULL) {
+        TEST_ASSERT_EQUAL_size_t(CENTRAL_DIR_NO_DIR, result->dirs[index].parent);
+    } else {
+        TEST_ASSERT_EQUAL_STRING(parent, result->dirs[result->dirs[index].parent].path);
+    }
+    TEST_ASSERT_FALSE(atomic_load(&result->dirs[index].created));
+}
+
+/**
+ * Test: Every directory an entry lives in or names is listed once, with its
+ * ancestors, and each entry points at its parent.
+ */
+void test_dir_table(void) {
+    const char *names[] = {
+        "a/b/c.txt", "a/b/d.txt", "x/", "top.txt", "x/y/z/deep.txt"
+    };
+    uint8_t buffer[512];
+    size_t cd_size = 0;
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        cd_size += append_cdfh(buffer + cd_size, names[i], (uint32_t)(i * 100));
+    }
+
+    struct central_dir_parse_result result;
+    int rc = central_dir_parse_from_cd_buffer(buffer, cd_size, 1000, cd_size,
+                                              1000 + cd_size, BURST_BASE_PART_SIZE,
+                                              false, &result);
+    TEST_ASSERT_EQUAL_INT(CENTRAL_DIR_PARSE_SUCCESS, rc);
+    TEST_ASSERT_EQUAL_size_t(5, result.num_files);
+
+    // "x/y" is only implied by "x/y/z/deep.txt"
+    TEST_ASSERT_EQUAL_size_t(6, result.num_dirs);
+    assert_dir(&result, 0, "", NULL);
+    assert_dir(&result, 1, "a", "");
+    assert_dir(&result, 2, "a/b", "a");
+    assert_dir(&result, 3, "x", "");
+    assert_dir(&result, 4, "x/y", "x");
+    assert_dir(&result, 5, "x/y/z", "x/y");
+
+    TEST_ASSERT_EQUAL_size_t(2, result.files[0].parent_dir);  // a/b/c.txt
+    TEST_ASSERT_EQUAL_size_t(2, result.files[1].parent_dir);  // a/b/d.txt
+    TEST_ASSERT_EQUAL_size_t(0, result.files[2].parent_dir);  // x/
+    TEST_ASSERT_EQUAL_size_t(0, result.files[3].parent_dir);  // top.txt
+    TEST_ASSERT_EQUAL_size_t(5, result.files[4].parent_dir);  // x/y/z/deep.txt
+
+    TEST_ASSERT_EQUAL_size_t(0, central_dir_find_dir(&result, "", 0));
+    TEST_ASSERT_EQUAL_size_t(4, central_dir_find_dir(&result, "x/y/z/deep.txt", 3));
+    TEST_ASSERT_EQUAL_size_t(CENTRAL_DIR_NO_DIR, central_dir_find_dir(&result, "a/c", 3));
+
+    central_dir_parse_result_free(&result);
+    TEST_ASSERT_NULL(result.dirs);
+}
+
 // =============================================================================
 // Main
 // =============================================================================
@@ -1052,6 +1130,9 @@ int main(void) {
     RUN_TEST(test_continuing_file_detection);
     RUN_TEST(test_no_continuing_file);
 
+    // Directory table tests
+    RUN_TEST(test_dir_table);
+
     // Error handling tests
     RUN_TEST(test_null_buffer);
     RUN_TEST(test_zero_size);
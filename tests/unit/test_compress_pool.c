@@ -0,0 +1,197 @@
+/*
+ * Unit tests for the parallel compression pool and the burst_writer -j path.
+ */
+
+#include "unity.h"
+#include "test_helpers.h"
+#include "burst_writer.h"
+#include "zip_structures.h"
+#include "../../src/writer/compress_pool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zstd.h>
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+// Write len bytes of test data to a temporary file and rewind it
+static FILE *create_input_file(size_t len, uint32_t seed) {
+    FILE *f = tmpfile();
+    TEST_ASSERT_NOT_NULL(f);
+    uint8_t *data = malloc(len);
+    TEST_ASSERT_NOT_NULL(data);
+    fill_test_data(data, len, seed);
+    TEST_ASSERT_EQUAL(len, fwrite(data, 1, len, f));
+    free(data);
+    rewind(f);
+    return f;
+}
+
+// Build an archive of the given file sizes and return its bytes
+static uint8_t *build_archive(int num_threads, const size_t *sizes, size_t num_sizes,
+                              size_t *archive_len) {
+    FILE *out = tmpfile();
+    TEST_ASSERT_NOT_NULL(out);
+    struct burst_writer *writer = burst_writer_create(out, 3);
+    TEST_ASSERT_NOT_NULL(writer);
+    TEST_ASSERT_EQUAL(0, burst_writer_set_threads(writer, num_threads));
+
+    for (size_t i = 0; i < num_sizes; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "file%zu.bin", i);
+        uint8_t lfh_buf[128];
+        struct zip_local_header *lfh;
+        int lfh_len;
+        create_test_lfh(lfh_buf, name, false, &lfh, &lfh_len);
+
+        FILE *in = create_input_file(sizes[i], (uint32_t)i + 1);
+        TEST_ASSERT_EQUAL(0, burst_writer_add_file(writer, in, lfh, lfh_len, false,
+                                                   0100644, 0, 0));
+        fclose(in);
+    }
+    TEST_ASSERT_EQUAL(0, burst_writer_finalize(writer));
+    burst_writer_destroy(writer);
+
+    long len = ftell(out);
+    TEST_ASSERT_TRUE(len > 0);
+    uint8_t *bytes = malloc((size_t)len);
+    TEST_ASSERT_NOT_NULL(bytes);
+    rewind(out);
+    TEST_ASSERT_EQUAL((size_t)len, fread(bytes, 1, (size_t)len, out));
+    fclose(out);
+
+    *archive_len = (size_t)len;
+    return bytes;
+}
+
+// =============================================================================
+// compress_pool Tests
+// =============================================================================
+
+void test_pool_create_invalid_args(void) {
+    TEST_ASSERT_NULL(compress_pool_create(0, 4));
+    TEST_ASSERT_NULL(compress_pool_create(2, 0));
+}
+
+void test_pool_get_job_bounds(void) {
+    struct compress_pool *pool = compress_pool_create(2, 4);
+    TEST_ASSERT_NOT_NULL(pool);
+    TEST_ASSERT_EQUAL(4, compress_pool_num_jobs(pool));
+    TEST_ASSERT_NOT_NULL(compress_pool_get_job(pool, 3));
+    TEST_ASSERT_NULL(compress_pool_get_job(pool, 4));
+    compress_pool_destroy(pool);
+}
+
+void test_pool_output_matches_zstd_compress(void) {
+    struct compress_pool *pool = compress_pool_create(3, 6);
+    TEST_ASSERT_NOT_NULL(pool);
+
+    size_t sizes[6] = {BURST_FRAME_SIZE, 1, 4096, BURST_FRAME_SIZE, 77777, BURST_FRAME_SIZE};
+    for (size_t i = 0; i < 6; i++) {
+        struct compress_job *job = compress_pool_get_job(pool, i);
+        fill_test_data(job->input, sizes[i], (uint32_t)i);
+        job->input_size = sizes[i];
+        job->compression_level = 3;
+        TEST_ASSERT_EQUAL(0, compress_pool_submit(pool, job));
+    }
+
+    size_t bound = ZSTD_compressBound(BURST_FRAME_SIZE);
+    uint8_t *expected = malloc(bound);
+    TEST_ASSERT_NOT_NULL(expected);
+
+    for (size_t i = 0; i < 6; i++) {
+        struct compress_job *job = compress_pool_get_job(pool, i);
+        compress_pool_wait(pool, job);
+        TEST_ASSERT_EQUAL(0, job->error);
+
+        size_t expected_size = ZSTD_compress(expected, bound, job->input, job->input_size, 3);
+        TEST_ASSERT_FALSE(ZSTD_isError(expected_size));
+        TEST_ASSERT_EQUAL(expected_size, job->compressed_size);
+        TEST_ASSERT_EQUAL_MEMORY(expected, job->output, expected_size);
+        TEST_ASSERT_EQUAL(job->input_size,
+                          ZSTD_getFrameContentSize(job->output, job->compressed_size));
+    }
+
+    free(expected);
+    compress_pool_destroy(pool);
+}
+
+void test_pool_rejects_oversized_input(void) {
+    struct compress_pool *pool = compress_pool_create(1, 1);
+    TEST_ASSERT_NOT_NULL(pool);
+    struct compress_job *job = compress_pool_get_job(pool, 0);
+    job->input_size = BURST_FRAME_SIZE + 1;
+    TEST_ASSERT_EQUAL(-1, compress_pool_submit(pool, job));
+    compress_pool_destroy(pool);
+}
+
+// =============================================================================
+// burst_writer -j Tests
+// =============================================================================
+
+void test_set_threads_invalid(void) {
+    FILE *out = tmpfile();
+    struct burst_writer *writer = burst_writer_create(out, 3);
+    TEST_ASSERT_EQUAL(-1, burst_writer_set_threads(writer, 0));
+    TEST_ASSERT_EQUAL(-1, burst_writer_set_threads(NULL, 2));
+    TEST_ASSERT_NULL(writer->compress_pool);
+    burst_writer_destroy(writer);
+    fclose(out);
+}
+
+void test_set_threads_back_to_serial(void) {
+    FILE *out = tmpfile();
+    struct burst_writer *writer = burst_writer_create(out, 3);
+    TEST_ASSERT_EQUAL(0, burst_writer_set_threads(writer, 4));
+    TEST_ASSERT_NOT_NULL(writer->compress_pool);
+    TEST_ASSERT_EQUAL(4, writer->num_threads);
+    TEST_ASSERT_EQUAL(0, burst_writer_set_threads(writer, 1));
+    TEST_ASSERT_NULL(writer->compress_pool);
+    TEST_ASSERT_EQUAL(1, writer->num_threads);
+    burst_writer_destroy(writer);
+    fclose(out);
+}
+
+// Parallel output must be byte-identical to serial output, including across
+// 8 MiB part boundaries (padding and Start-of-Part frames) and for files that
+// are an exact multiple of the frame size.
+void test_parallel_archive_identical_to_serial(void) {
+    size_t sizes[] = {
+        1000,
+        BURST_FRAME_SIZE,
+        3 * BURST_FRAME_SIZE,
+        BURST_PART_SIZE + 12345,
+        0x1F0000,
+        BURST_PART_SIZE,
+    };
+    size_t num_sizes = sizeof(sizes) / sizeof(sizes[0]);
+
+    size_t serial_len, parallel_len;
+    uint8_t *serial = build_archive(1, sizes, num_sizes, &serial_len);
+    uint8_t *parallel = build_archive(4, sizes, num_sizes, &parallel_len);
+
+    TEST_ASSERT_TRUE(serial_len > BURST_PART_SIZE);
+    TEST_ASSERT_EQUAL(serial_len, parallel_len);
+    TEST_ASSERT_EQUAL_MEMORY(serial, parallel, serial_len);
+
+    free(serial);
+    free(parallel);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_pool_create_invalid_args);
+    RUN_TEST(test_pool_get_job_bounds);
+    RUN_TEST(test_pool_output_matches_zstd_compress);
+    RUN_TEST(test_pool_rejects_oversized_input);
+    RUN_TEST(test_set_threads_invalid);
+    RUN_TEST(test_set_threads_back_to_serial);
+    RUN_TEST(test_parallel_archive_identical_to_serial);
+
+    return UNITY_END();
+}
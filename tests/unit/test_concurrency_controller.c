@@ -0,0 +1,188 @@
+/*
+ * Unit tests for the adaptive part concurrency controller.
+ */
+
+#include "unity.h"
+#include "concurrency_controller.h"
+#include <string.h>
+
+#define MB (1024ULL * 1024ULL)
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+// A simulated restore, advanced one sample window at a time
+struct sim {
+    struct concurrency_sample sample;
+    double per_part_rate;  // Bytes per second each part in flight adds...
+    double rate_cap;  // ...up to this (the network's limit)
+    double busy;  // Fraction of the window the I/O workers are busy
+    double backlog;  // Fraction of the read windows waiting to be written
+};
+
+static void sim_init(struct sim *sim, double per_part_rate, double rate_cap) {
+    memset(sim, 0, sizeof(*sim));
+    sim->sample.io_threads = 4;
+    sim->per_part_rate = per_part_rate;
+    sim->rate_cap = rate_cap;
+}
+
+static size_t sim_window(struct concurrency_controller *ctl, struct sim *sim) {
+    size_t target = ctl->target;
+    double rate = sim->per_part_rate * (double)target;
+    if (rate > sim->rate_cap) {
+        rate = sim->rate_cap;
+    }
+
+    sim->sample.now_ns += CONCURRENCY_SAMPLE_NS;
+    sim->sample.bytes_done += (uint64_t)rate;
+    sim->sample.parts_done += target;
+    sim->sample.io_busy_ns += (uint64_t)(sim->busy * CONCURRENCY_SAMPLE_NS * sim->sample.io_threads);
+    sim->sample.io_queue_limit = target * 8 * MB;
+    sim->sample.io_queued_bytes = (uint64_t)(sim->backlog * (double)sim->sample.io_queue_limit);
+    return concurrency_controller_update(ctl, &sim->sample);
+}
+
+void test_init_clamps(void) {
+    struct concurrency_controller ctl;
+    concurrency_controller_init(&ctl, 1, 32, 8);
+    TEST_ASSERT_EQUAL(8, ctl.target);
+    concurrency_controller_init(&ctl, 2, 4, 8);
+    TEST_ASSERT_EQUAL(4, ctl.target);
+    concurrency_controller_init(&ctl, 0, 0, 0);
+    TEST_ASSERT_EQUAL(1, ctl.target);
+    TEST_ASSERT_EQUAL(1, ctl.max_parts);
+}
+
+void test_waits_for_a_full_window(void) {
+    struct concurrency_controller ctl;
+    concurrency_controller_init(&ctl, 1, 32, 8);
+    struct concurrency_sample sample = {.io_threads = 4};
+    TEST_ASSERT_EQUAL(8, concurrency_controller_update(&ctl, &sample));
+
+    // Not a second yet
+    sample.now_ns = CONCURRENCY_SAMPLE_NS / 2;
+    sample.parts_done = 100;
+    sample.bytes_done = 800 * MB;
+    TEST_ASSERT_EQUAL(8, concurrency_controller_update(&ctl, &sample));
+
+    // Two seconds, but fewer parts finished than are in flight
+    concurrency_controller_init(&ctl, 1, 32, 8);
+    memset(&sample, 0, sizeof(sample));
+    sample.io_threads = 4;
+    concurrency_controller_update(&ctl, &sample);
+    sample.now_ns = 2 * CONCURRENCY_SAMPLE_NS;
+    sample.parts_done = 5;
+    sample.bytes_done = 40 * MB;
+    TEST_ASSERT_EQUAL(8, concurrency_controller_update(&ctl, &sample));
+    TEST_ASSERT_EQUAL(0, ctl.adjustments);
+}
+
+void test_climbs_to_network_limit(void) {
+    // 50 MB/s per part up to 600 MB/s: 12 parts saturate the network
+    struct concurrency_controller ctl;
+    concurrency_controller_init(&ctl, 1, 64, 4);
+    struct sim sim;
+    sim_init(&sim, 50.0 * MB, 600.0 * MB);
+    concurrency_controller_update(&ctl, &sim.sample);
+
+    size_t highest = 0;
+    for (int i = 0; i < 200; i++) {
+        size_t target = sim_window(&ctl, &sim);
+        if (i >= 50 && target > highest) {
+            highest = target;
+        }
+        if (i >= 50) {
+            // Settled around the knee, probing one above it now and then
+            TEST_ASSERT_TRUE(target >= 11 && target <= 13);
+        }
+    }
+    TEST_ASSERT_EQUAL(13, highest);
+    TEST_ASSERT_EQUAL(4, ctl.lowest);
+    TEST_ASSERT_TRUE(ctl.best_throughput >= 600.0 * MB * 0.99);
+}
+
+void test_never_exceeds_max(void) {
+    struct concurrency_controller ctl;
+    concurrency_controller_init(&ctl, 1, 6, 2);
+    struct sim sim;
+    sim_init(&sim, 50.0 * MB, 10000.0 * MB);
+    concurrency_controller_update(&ctl, &sim.sample);
+
+    for (int i = 0; i < 50; i++) {
+        TEST_ASSERT_TRUE(sim_window(&ctl, &sim) <= 6);
+    }
+    TEST_ASSERT_EQUAL(6, ctl.target);
+    TEST_ASSERT_EQUAL(6, ctl.highest);
+}
+
+void test_busy_disk_decreases_multiplicatively(void) {
+    struct concurrency_controller ctl;
+    concurrency_controller_init(&ctl, 2, 64, 32);
+    struct sim sim;
+    sim_init(&sim, 50.0 * MB, 10000.0 * MB);
+    sim.busy = 0.95;
+    concurrency_controller_update(&ctl, &sim.sample);
+
+    TEST_ASSERT_EQUAL(24, sim_window(&ctl, &sim));
+    TEST_ASSERT_EQUAL(18, sim_window(&ctl, &sim));
+    TEST_ASSERT_EQUAL(14, sim_window(&ctl, &sim));
+    for (int i = 0; i < 20; i++) {
+        sim_window(&ctl, &sim);
+    }
+    TEST_ASSERT_EQUAL(2, ctl.target);
+    TEST_ASSERT_EQUAL(2, ctl.lowest);
+}
+
+void test_write_backlog_decreases(void) {
+    struct concurrency_controller ctl;
+    concurrency_controller_init(&ctl, 1, 64, 16);
+    struct sim sim;
+    sim_init(&sim, 50.0 * MB, 10000.0 * MB);
+    sim.busy = 0.5;
+    sim.backlog = 0.8;
+    concurrency_controller_update(&ctl, &sim.sample);
+
+    TEST_ASSERT_EQUAL(12, sim_window(&ctl, &sim));
+
+    // Once writes keep up again it waits a little, then probes upwards
+    sim.backlog = 0.1;
+    size_t target = 12;
+    for (int i = 0; i < CONCURRENCY_HOLD_WINDOWS / 2; i++) {
+        target = sim_window(&ctl, &sim);
+        TEST_ASSERT_EQUAL(12, target);
+    }
+    TEST_ASSERT_EQUAL(13, sim_window(&ctl, &sim));
+}
+
+void test_holds_after_unprofitable_increase(void) {
+    // The network is already saturated at 4 parts
+    struct concurrency_controller ctl;
+    concurrency_controller_init(&ctl, 1, 64, 4);
+    struct sim sim;
+    sim_init(&sim, 100.0 * MB, 400.0 * MB);
+    concurrency_controller_update(&ctl, &sim.sample);
+
+    TEST_ASSERT_EQUAL(5, sim_window(&ctl, &sim));  // Probe
+    TEST_ASSERT_EQUAL(4, sim_window(&ctl, &sim));  // No gain: step back
+    for (int i = 0; i < CONCURRENCY_HOLD_WINDOWS; i++) {
+        TEST_ASSERT_EQUAL(4, sim_window(&ctl, &sim));
+    }
+    TEST_ASSERT_EQUAL(5, sim_window(&ctl, &sim));  // Probe again
+    TEST_ASSERT_EQUAL(3, ctl.adjustments);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_init_clamps);
+    RUN_TEST(test_waits_for_a_full_window);
+    RUN_TEST(test_climbs_to_network_limit);
+    RUN_TEST(test_never_exceeds_max);
+    RUN_TEST(test_busy_disk_decreases_multiplicatively);
+    RUN_TEST(test_write_backlog_decreases);
+    RUN_TEST(test_holds_after_unprofitable_increase);
+    return UNITY_END();
+}
@@ -0,0 +1,333 @@
+/*
+ * Unit tests for content hashing (content_hash) and duplicate entries.
+ *
+ * The round-trip test writes an archive with burst_writer and parses its
+ * central directory with the downloader's parser to check the content hash
+ * extra field and the grouping of identical files.
+ */
+
+#include "unity.h"
+#include "test_helpers.h"
+#include "burst_writer.h"
+#include "zip_structures.h"
+#include "central_dir_parser.h"
+#include "../../src/writer/content_hash.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static void hash_string(const char *data, uint8_t out[CONTENT_HASH_SIZE]) {
+    struct content_hash_ctx ctx;
+    content_hash_init(&ctx);
+    content_hash_update(&ctx, data, strlen(data));
+    content_hash_final(&ctx, out);
+}
+
+static void parse_hex(const char *hex, uint8_t out[CONTENT_HASH_SIZE]) {
+    for (size_t i = 0; i < CONTENT_HASH_SIZE; i++) {
+        unsigned int byte;
+        sscanf(hex + 2 * i, "%2x", &byte);
+        out[i] = (uint8_t)byte;
+    }
+}
+
+// FIPS 180-4 example vectors
+void test_sha256_known_vectors(void) {
+    uint8_t expected[CONTENT_HASH_SIZE];
+    uint8_t actual[CONTENT_HASH_SIZE];
+
+    hash_string("", actual);
+    parse_hex("e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855", expected);
+    TEST_ASSERT_EQUAL_MEMORY(expected, actual, CONTENT_HASH_SIZE);
+
+    hash_string("abc", actual);
+    parse_hex("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad", expected);
+    TEST_ASSERT_EQUAL_MEMORY(expected, actual, CONTENT_HASH_SIZE);
+
+    // 56 bytes: padding spills into a second block
+    hash_string("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", actual);
+    parse_hex("248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1", expected);
+    TEST_ASSERT_EQUAL_MEMORY(expected, actual, CONTENT_HASH_SIZE);
+}
+
+void test_sha256_incremental_updates(void) {
+    // One million 'a's, fed in uneven pieces
+    static char chunk[1000];
+    memset(chunk, 'a', sizeof(chunk));
+
+    struct content_hash_ctx ctx;
+    content_hash_init(&ctx);
+    size_t remaining = 1000000;
+    size_t piece = 1;
+    while (remaining > 0) {
+        size_t len = piece < remaining ? piece : remaining;
+        content_hash_update(&ctx, chunk, len);
+        remaining -= len;
+        piece = piece % 937 + 63;  // Stays within chunk
+    }
+
+    uint8_t expected[CONTENT_HASH_SIZE];
+    uint8_t actual[CONTENT_HASH_SIZE];
+    content_hash_final(&ctx, actual);
+    parse_hex("cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0", expected);
+    TEST_ASSERT_EQUAL_MEMORY(expected, actual, CONTENT_HASH_SIZE);
+}
+
+void test_hash_file_matches_hash_of_content(void) {
+    char path[] = "/tmp/burst_content_hash_XXXXXX";
+    int fd = mkstemp(path);
+    TEST_ASSERT_TRUE(fd >= 0);
+    FILE *f = fdopen(fd, "w");
+    for (int i = 0; i < 50000; i++) {
+        fprintf(f, "line %d\n", i);
+    }
+    fclose(f);
+
+    // Same bytes hashed in memory
+    f = fopen(path, "rb");
+    struct content_hash_ctx ctx;
+    content_hash_init(&ctx);
+    uint8_t buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0) {
+        content_hash_update(&ctx, buffer, n);
+    }
+    fclose(f);
+    uint8_t expected[CONTENT_HASH_SIZE];
+    content_hash_final(&ctx, expected);
+
+    uint8_t actual[CONTENT_HASH_SIZE];
+    TEST_ASSERT_EQUAL(0, content_hash_file(path, actual));
+    TEST_ASSERT_EQUAL_MEMORY(expected, actual, CONTENT_HASH_SIZE);
+
+    unlink(path);
+    TEST_ASSERT_EQUAL(-1, content_hash_file(path, actual));
+}
+
+void test_index_keeps_first_name(void) {
+    struct content_index *index = content_index_create();
+    TEST_ASSERT_NOT_NULL(index);
+
+    uint8_t a[CONTENT_HASH_SIZE];
+    uint8_t b[CONTENT_HASH_SIZE];
+    hash_string("a", a);
+    hash_string("b", b);
+
+    TEST_ASSERT_NULL(content_index_find(index, a));
+    TEST_ASSERT_EQUAL(0, content_index_add(index, a, "first.txt"));
+    TEST_ASSERT_EQUAL(0, content_index_add(index, a, "second.txt"));
+    TEST_ASSERT_EQUAL_STRING("first.txt", content_index_find(index, a));
+    TEST_ASSERT_NULL(content_index_find(index, b));
+
+    content_index_destroy(index);
+    TEST_ASSERT_NULL(content_index_find(NULL, a));
+    content_index_destroy(NULL);
+}
+
+void test_index_grows(void) {
+    struct content_index *index = content_index_create();
+    char name[32];
+    uint8_t hash[CONTENT_HASH_SIZE];
+
+    for (int i = 0; i < 5000; i++) {
+        snprintf(name, sizeof(name), "file%d", i);
+        hash_string(name, hash);
+        TEST_ASSERT_EQUAL(0, content_index_add(index, hash, name));
+    }
+    for (int i = 0; i < 5000; i++) {
+        snprintf(name, sizeof(name), "file%d", i);
+        hash_string(name, hash);
+        TEST_ASSERT_EQUAL_STRING(name, content_index_find(index, hash));
+    }
+
+    content_index_destroy(index);
+}
+
+void test_build_content_hash_extra_field(void) {
+    uint8_t hash[CONTENT_HASH_SIZE];
+    hash_string("abc", hash);
+
+    uint8_t buffer[64];
+    size_t len = build_content_hash_extra_field(buffer, sizeof(buffer), hash,
+                                                BURST_CONTENT_HASH_FLAG_DATA_OMITTED);
+
+    TEST_ASSERT_EQUAL(BURST_CONTENT_HASH_EXTRA_SIZE, len);
+    TEST_ASSERT_EQUAL_HEX8(ZIP_EXTRA_BURST_CONTENT_HASH_ID & 0xFF, buffer[0]);
+    TEST_ASSERT_EQUAL_HEX8(ZIP_EXTRA_BURST_CONTENT_HASH_ID >> 8, buffer[1]);
+    TEST_ASSERT_EQUAL(BURST_CONTENT_HASH_EXTRA_SIZE - 4, buffer[2] | (buffer[3] << 8));
+    TEST_ASSERT_EQUAL(BURST_CONTENT_HASH_EXTRA_VERSION, buffer[4]);
+    TEST_ASSERT_EQUAL(BURST_CONTENT_HASH_ALGO_SHA256, buffer[5]);
+    TEST_ASSERT_EQUAL(BURST_CONTENT_HASH_FLAG_DATA_OMITTED, buffer[6]);
+    TEST_ASSERT_EQUAL_MEMORY(hash, buffer + 7, CONTENT_HASH_SIZE);
+
+    TEST_ASSERT_EQUAL(0, build_content_hash_extra_field(buffer, BURST_CONTENT_HASH_EXTRA_SIZE - 1,
+                                                        hash, 0));
+}
+
+static void add_file_with_hash(struct burst_writer *writer, const char *name,
+                               const char *content) {
+    FILE *in = tmpfile();
+    fputs(content, in);
+    rewind(in);
+    uint8_t lfh_buf[128];
+    struct zip_local_header *lfh;
+    int lfh_len;
+    create_test_lfh(lfh_buf, name, false, &lfh, &lfh_len);
+    TEST_ASSERT_EQUAL(0, burst_writer_add_file(writer, in, lfh, lfh_len, false, 0100644, 0, 0));
+    fclose(in);
+
+    uint8_t hash[CONTENT_HASH_SIZE];
+    hash_string(content, hash);
+    TEST_ASSERT_EQUAL(0, burst_writer_set_content_hash(writer, hash));
+}
+
+void test_duplicate_entries_round_trip(void) {
+    const char *shared = "identical content identical content identical content\n";
+    const char *other = "something else entirely\n";
+
+    FILE *out = tmpfile();
+    TEST_ASSERT_NOT_NULL(out);
+    struct burst_writer *writer = burst_writer_create(out, 3);
+    TEST_ASSERT_NOT_NULL(writer);
+
+    // No entry to attach a hash to yet
+    uint8_t hash[CONTENT_HASH_SIZE];
+    hash_string(shared, hash);
+    TEST_ASSERT_EQUAL(-1, burst_writer_set_content_hash(writer, hash));
+
+    add_file_with_hash(writer, "a/original.txt", shared);    // 0: source
+    add_file_with_hash(writer, "b/unique.txt", other);       // 1: no duplicates
+    add_file_with_hash(writer, "c/copy.txt", shared);        // 2: stored again (-H only)
+
+    // 3: stored without data (--dedup)
+    uint8_t lfh_buf[128];
+    struct zip_local_header *lfh;
+    int lfh_len;
+    create_test_lfh(lfh_buf, "d/omitted.txt", true, &lfh, &lfh_len);
+    TEST_ASSERT_EQUAL(0, burst_writer_add_duplicate(writer, lfh, lfh_len, hash,
+                                                    strlen(shared), 0100600, 0, 0));
+    TEST_ASSERT_EQUAL(1, writer->duplicates);
+    TEST_ASSERT_EQUAL(strlen(shared), writer->duplicate_bytes);
+
+    TEST_ASSERT_EQUAL(0, burst_writer_finalize(writer));
+    burst_writer_destroy(writer);
+
+    long size = ftell(out);
+    uint8_t *archive = malloc((size_t)size);
+    rewind(out);
+    TEST_ASSERT_EQUAL((size_t)size, fread(archive, 1, (size_t)size, out));
+    fclose(out);
+
+    struct central_dir_parse_result result;
+    TEST_ASSERT_EQUAL(CENTRAL_DIR_PARSE_SUCCESS,
+                      central_dir_parse(archive, (size_t)size, (uint64_t)size,
+                                        BURST_BASE_PART_SIZE, &result));
+    TEST_ASSERT_EQUAL(4, result.num_files);
+
+    for (size_t i = 0; i < 4; i++) {
+        TEST_ASSERT_TRUE(result.files[i].has_content_hash);
+        TEST_ASSERT_TRUE(result.files[i].has_unix_extra);  // Other extra fields still parsed
+    }
+    TEST_ASSERT_EQUAL_MEMORY(hash, result.files[0].content_hash, CONTENT_HASH_SIZE);
+    TEST_ASSERT_FALSE(result.files[0].data_omitted);
+    TEST_ASSERT_NULL(result.files[0].dedup_source);
+    TEST_ASSERT_NULL(result.files[1].dedup_source);
+
+    TEST_ASSERT_FALSE(result.files[2].data_omitted);
+    TEST_ASSERT_EQUAL_PTR(&result.files[0], result.files[2].dedup_source);
+
+    TEST_ASSERT_EQUAL_STRING("d/omitted.txt", result.files[3].filename);
+    TEST_ASSERT_TRUE(result.files[3].data_omitted);
+    TEST_ASSERT_EQUAL(0, result.files[3].uncompressed_size);
+    TEST_ASSERT_EQUAL(ZIP_METHOD_STORE, result.files[3].compression_method);
+    TEST_ASSERT_EQUAL_PTR(&result.files[0], result.files[3].dedup_source);
+
+    central_dir_parse_result_free(&result);
+    free(archive);
+}
+
+// With hashing on, the writer hashes what it compresses, on one thread or several
+void test_writer_hashes_compressed_data(void) {
+    // Three chunks, the middle one all zeros (stored behind a zero marker)
+    size_t len = 3 * BURST_FRAME_SIZE + 1000;
+    uint8_t *content = malloc(len);
+    for (size_t i = 0; i < len; i++) {
+        content[i] = (uint8_t)(i * 7 + (i >> 11));
+    }
+    memset(content + BURST_FRAME_SIZE, 0, BURST_FRAME_SIZE);
+
+    struct content_hash_ctx ctx;
+    uint8_t expected[CONTENT_HASH_SIZE];
+    content_hash_init(&ctx);
+    content_hash_update(&ctx, content, len);
+    content_hash_final(&ctx, expected);
+
+    for (int threads = 1; threads <= 2; threads++) {
+        FILE *out = tmpfile();
+        struct burst_writer *writer = burst_writer_create(out, 3);
+        TEST_ASSERT_NOT_NULL(writer);
+        TEST_ASSERT_EQUAL(0, burst_writer_set_threads(writer, threads));
+        TEST_ASSERT_EQUAL(0, burst_writer_set_content_hashing(writer, true));
+
+        FILE *in = tmpfile();
+        TEST_ASSERT_EQUAL(len, fwrite(content, 1, len, in));
+        rewind(in);
+        uint8_t lfh_buf[128];
+        struct zip_local_header *lfh;
+        int lfh_len;
+        create_test_lfh(lfh_buf, "data.bin", false, &lfh, &lfh_len);
+        TEST_ASSERT_EQUAL(0, burst_writer_add_file(writer, in, lfh, lfh_len, false, 0100644, 0, 0));
+        fclose(in);
+
+        TEST_ASSERT_NOT_NULL(burst_writer_content_hash(writer));
+        TEST_ASSERT_EQUAL_MEMORY(expected, burst_writer_content_hash(writer), CONTENT_HASH_SIZE);
+        TEST_ASSERT_EQUAL(1, writer->zero_frames);
+
+        TEST_ASSERT_EQUAL(0, burst_writer_finalize(writer));
+        burst_writer_destroy(writer);
+        fclose(out);
+    }
+    free(content);
+}
+
+// Without hashing, entries carry no hash unless one is attached
+void test_writer_hashing_off_by_default(void) {
+    FILE *out = tmpfile();
+    struct burst_writer *writer = burst_writer_create(out, 3);
+    TEST_ASSERT_NOT_NULL(writer);
+    TEST_ASSERT_NULL(burst_writer_content_hash(writer));
+
+    FILE *in = tmpfile();
+    fputs("some content\n", in);
+    rewind(in);
+    uint8_t lfh_buf[128];
+    struct zip_local_header *lfh;
+    int lfh_len;
+    create_test_lfh(lfh_buf, "plain.txt", false, &lfh, &lfh_len);
+    TEST_ASSERT_EQUAL(0, burst_writer_add_file(writer, in, lfh, lfh_len, false, 0100644, 0, 0));
+    fclose(in);
+    TEST_ASSERT_NULL(burst_writer_content_hash(writer));
+
+    burst_writer_destroy(writer);
+    fclose(out);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_sha256_known_vectors);
+    RUN_TEST(test_sha256_incremental_updates);
+    RUN_TEST(test_hash_file_matches_hash_of_content);
+    RUN_TEST(test_index_keeps_first_name);
+    RUN_TEST(test_index_grows);
+    RUN_TEST(test_build_content_hash_extra_field);
+    RUN_TEST(test_duplicate_entries_round_trip);
+    RUN_TEST(test_writer_hashes_compressed_data);
+    RUN_TEST(test_writer_hashing_off_by_default);
+
+    return UNITY_END();
+}
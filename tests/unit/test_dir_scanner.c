@@ -0,0 +1,293 @@
+/*
+ * Unit tests for the parallel directory scanner.
+ */
+
+#include "unity.h"
+#include "../../src/writer/dir_scanner.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <limits.h>
+
+#define MAX_ENTRIES 1024
+
+static char test_dir[] = "/tmp/burst_scanner_test_XXXXXX";
+
+struct emitted {
+    char *paths[MAX_ENTRIES];
+    char *names[MAX_ENTRIES];
+    char *targets[MAX_ENTRIES];
+    bool is_dir[MAX_ENTRIES];
+    off_t sizes[MAX_ENTRIES];
+    int count;
+    int stop_after;  // Return 42 once this many entries were seen (0 = never)
+};
+
+static int record_entry(void *ctx, const char *path, const char *name,
+                        const struct stat *st, const char *symlink_target, bool is_dir) {
+    struct emitted *e = ctx;
+    TEST_ASSERT_TRUE(e->count < MAX_ENTRIES);
+    e->paths[e->count] = strdup(path);
+    e->names[e->count] = strdup(name);
+    e->targets[e->count] = symlink_target ? strdup(symlink_target) : NULL;
+    e->is_dir[e->count] = is_dir;
+    e->sizes[e->count] = st->st_size;
+    e->count++;
+    if (e->stop_after && e->count >= e->stop_after) {
+        return 42;
+    }
+    return 0;
+}
+
+static void emitted_free(struct emitted *e) {
+    for (int i = 0; i < e->count; i++) {
+        free(e->paths[i]);
+        free(e->names[i]);
+        free(e->targets[i]);
+    }
+    memset(e, 0, sizeof(*e));
+}
+
+// Sequential reference walk with the ordering the archive has always used
+static void reference_walk(struct emitted *e, const char *dir_path, const char *prefix) {
+    DIR *dir = opendir(dir_path);
+    TEST_ASSERT_NOT_NULL(dir);
+    struct dirent *de;
+    while ((de = readdir(dir)) != NULL) {
+        if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0) {
+            continue;
+        }
+        char path[PATH_MAX];
+        char name[PATH_MAX];
+        snprintf(path, sizeof(path), "%s/%s", dir_path, de->d_name);
+        if (prefix[0]) {
+            snprintf(name, sizeof(name), "%s/%s", prefix, de->d_name);
+        } else {
+            snprintf(name, sizeof(name), "%s", de->d_name);
+        }
+
+        struct stat st;
+        TEST_ASSERT_EQUAL(0, lstat(path, &st));
+        if (S_ISDIR(st.st_mode)) {
+            char dir_name[PATH_MAX + 1];
+            snprintf(dir_name, sizeof(dir_name), "%s/", name);
+            record_entry(e, path, dir_name, &st, NULL, true);
+            reference_walk(e, path, name);
+        } else if (S_ISLNK(st.st_mode)) {
+            char target[PATH_MAX];
+            ssize_t len = readlink(path, target, sizeof(target) - 1);
+            TEST_ASSERT_TRUE(len >= 0);
+            target[len] = '\0';
+            record_entry(e, path, name, &st, target, false);
+        } else if (S_ISREG(st.st_mode)) {
+            record_entry(e, path, name, &st, NULL, false);
+        }
+    }
+    closedir(dir);
+}
+
+static void make_path(const char *rel, char *out, size_t out_size) {
+    snprintf(out, out_size, "%s/%s", test_dir, rel);
+}
+
+static void make_dir(const char *rel) {
+    char path[PATH_MAX];
+    make_path(rel, path, sizeof(path));
+    TEST_ASSERT_EQUAL(0, mkdir(path, 0755));
+}
+
+static void make_file(const char *rel, size_t size) {
+    char path[PATH_MAX];
+    make_path(rel, path, sizeof(path));
+    FILE *f = fopen(path, "wb");
+    TEST_ASSERT_NOT_NULL(f);
+    for (size_t i = 0; i < size; i++) {
+        fputc('a' + (int)(i % 26), f);
+    }
+    fclose(f);
+}
+
+static void remove_tree(const char *path) {
+    DIR *dir = opendir(path);
+    if (!dir) {
+        return;
+    }
+    struct dirent *de;
+    while ((de = readdir(dir)) != NULL) {
+        if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0) {
+            continue;
+        }
+        char child[PATH_MAX];
+        snprintf(child, sizeof(child), "%s/%s", path, de->d_name);
+        struct stat st;
+        if (lstat(child, &st) == 0 && S_ISDIR(st.st_mode)) {
+            remove_tree(child);
+        } else {
+            unlink(child);
+        }
+    }
+    closedir(dir);
+    rmdir(path);
+}
+
+void setUp(void) {
+    TEST_ASSERT_NOT_NULL(mkdtemp(test_dir));
+
+    // A mix of wide and deep directories, files, symlinks and empty dirs
+    make_file("top.txt", 10);
+    make_dir("empty");
+    make_dir("deep");
+    make_dir("deep/a");
+    make_dir("deep/a/b");
+    make_dir("deep/a/b/c");
+    make_file("deep/a/b/c/leaf.txt", 100);
+    make_file("deep/a/mid.txt", 5);
+    make_dir("wide");
+    for (int i = 0; i < 20; i++) {
+        char rel[64];
+        snprintf(rel, sizeof(rel), "wide/d%02d", i);
+        make_dir(rel);
+        for (int j = 0; j < 5; j++) {
+            snprintf(rel, sizeof(rel), "wide/d%02d/f%d", i, j);
+            make_file(rel, (size_t)(i * 5 + j));
+        }
+    }
+
+    char link_path[PATH_MAX];
+    make_path("deep/link", link_path, sizeof(link_path));
+    TEST_ASSERT_EQUAL(0, symlink("a/mid.txt", link_path));
+}
+
+void tearDown(void) {
+    remove_tree(test_dir);
+    strcpy(test_dir, "/tmp/burst_scanner_test_XXXXXX");
+}
+
+static void assert_same_walk(const struct emitted *expected, const struct emitted *actual) {
+    TEST_ASSERT_EQUAL(expected->count, actual->count);
+    for (int i = 0; i < expected->count; i++) {
+        TEST_ASSERT_EQUAL_STRING(expected->paths[i], actual->paths[i]);
+        TEST_ASSERT_EQUAL_STRING(expected->names[i], actual->names[i]);
+        TEST_ASSERT_EQUAL(expected->is_dir[i], actual->is_dir[i]);
+        TEST_ASSERT_EQUAL(expected->sizes[i], actual->sizes[i]);
+        if (expected->targets[i]) {
+            TEST_ASSERT_EQUAL_STRING(expected->targets[i], actual->targets[i]);
+        } else {
+            TEST_ASSERT_NULL(actual->targets[i]);
+        }
+    }
+}
+
+// =============================================================================
+// dir_scanner_scan Tests
+// =============================================================================
+
+void test_scan_invalid_args(void) {
+    struct emitted e = {0};
+    TEST_ASSERT_EQUAL(-1, dir_scanner_scan(NULL, 1, record_entry, &e));
+    TEST_ASSERT_EQUAL(-1, dir_scanner_scan(test_dir, 0, record_entry, &e));
+    TEST_ASSERT_EQUAL(-1, dir_scanner_scan(test_dir, 1, NULL, &e));
+    TEST_ASSERT_EQUAL(0, e.count);
+}
+
+void test_scan_missing_root_fails(void) {
+    struct emitted e = {0};
+    TEST_ASSERT_EQUAL(-1, dir_scanner_scan("/nonexistent/burst/dir", 2, record_entry, &e));
+    TEST_ASSERT_EQUAL(0, e.count);
+}
+
+void test_scan_single_thread_matches_sequential_walk(void) {
+    struct emitted expected = {0};
+    struct emitted actual = {0};
+    reference_walk(&expected, test_dir, "");
+
+    TEST_ASSERT_EQUAL(0, dir_scanner_scan(test_dir, 1, record_entry, &actual));
+    assert_same_walk(&expected, &actual);
+
+    emitted_free(&expected);
+    emitted_free(&actual);
+}
+
+void test_scan_order_independent_of_thread_count(void) {
+    struct emitted expected = {0};
+    reference_walk(&expected, test_dir, "");
+
+    const int thread_counts[] = {2, 4, 16};
+    for (size_t t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]); t++) {
+        for (int run = 0; run < 5; run++) {
+            struct emitted actual = {0};
+            TEST_ASSERT_EQUAL(0, dir_scanner_scan(test_dir, thread_counts[t], record_entry, &actual));
+            assert_same_walk(&expected, &actual);
+            emitted_free(&actual);
+        }
+    }
+
+    emitted_free(&expected);
+}
+
+void test_scan_directories_precede_children(void) {
+    struct emitted e = {0};
+    TEST_ASSERT_EQUAL(0, dir_scanner_scan(test_dir, 4, record_entry, &e));
+
+    for (int i = 0; i < e.count; i++) {
+        const char *slash = strrchr(e.names[i], '/');
+        if (e.is_dir[i]) {
+            TEST_ASSERT_EQUAL('/', e.names[i][strlen(e.names[i]) - 1]);
+            continue;
+        }
+        if (!slash) {
+            continue;
+        }
+        // The parent directory entry must appear earlier
+        size_t parent_len = (size_t)(slash - e.names[i]) + 1;
+        bool found = false;
+        for (int j = 0; j < i && !found; j++) {
+            found = e.is_dir[j] && strlen(e.names[j]) == parent_len &&
+                    strncmp(e.names[j], e.names[i], parent_len) == 0;
+        }
+        TEST_ASSERT_TRUE_MESSAGE(found, e.names[i]);
+    }
+
+    emitted_free(&e);
+}
+
+void test_scan_reports_symlink_target(void) {
+    struct emitted e = {0};
+    TEST_ASSERT_EQUAL(0, dir_scanner_scan(test_dir, 3, record_entry, &e));
+
+    bool found = false;
+    for (int i = 0; i < e.count; i++) {
+        if (strcmp(e.names[i], "deep/link") == 0) {
+            TEST_ASSERT_FALSE(e.is_dir[i]);
+            TEST_ASSERT_EQUAL_STRING("a/mid.txt", e.targets[i]);
+            found = true;
+        }
+    }
+    TEST_ASSERT_TRUE(found);
+
+    emitted_free(&e);
+}
+
+void test_scan_callback_can_stop(void) {
+    struct emitted e = {0};
+    e.stop_after = 3;
+    TEST_ASSERT_EQUAL(42, dir_scanner_scan(test_dir, 4, record_entry, &e));
+    TEST_ASSERT_EQUAL(3, e.count);
+    emitted_free(&e);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_scan_invalid_args);
+    RUN_TEST(test_scan_missing_root_fails);
+    RUN_TEST(test_scan_single_thread_matches_sequential_walk);
+    RUN_TEST(test_scan_order_independent_of_thread_count);
+    RUN_TEST(test_scan_directories_precede_children);
+    RUN_TEST(test_scan_reports_symlink_target);
+    RUN_TEST(test_scan_callback_can_stop);
+
+    return UNITY_END();
+}
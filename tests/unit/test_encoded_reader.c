@@ -0,0 +1,289 @@
+/*
+ * Unit tests for BTRFS encoded-read frame reuse.
+ *
+ * The extent checks run anywhere. Reading real extents needs a BTRFS volume
+ * and CAP_SYS_ADMIN, so on other filesystems the reader tests check the
+ * fallback to normal compression instead.
+ */
+
+#include "unity.h"
+#include "test_helpers.h"
+#include "burst_writer.h"
+#include "zip_structures.h"
+#include "../../src/writer/encoded_reader.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+#include <zstd.h>
+
+#define BTRFS_COMPRESSION_NONE 0
+#define BTRFS_COMPRESSION_ZSTD 2
+
+static ZSTD_DCtx *dctx;
+static uint8_t *plain;
+
+void setUp(void) {
+    dctx = ZSTD_createDCtx();
+    plain = malloc(BURST_FRAME_SIZE);
+}
+
+void tearDown(void) {
+    ZSTD_freeDCtx(dctx);
+    free(plain);
+}
+
+// Compress len bytes into a frame followed by zero padding up to a 4 KiB sector,
+// the way BTRFS stores compressed extents
+static uint8_t *make_extent(size_t len, bool content_size, size_t *frame_len, size_t *extent_len) {
+    uint8_t *data = malloc(len);
+    fill_test_data(data, len, (uint32_t)len);
+
+    size_t bound = ZSTD_compressBound(len) + 4096;
+    uint8_t *extent = calloc(1, bound);
+    ZSTD_CCtx *cctx = ZSTD_createCCtx();
+    ZSTD_CCtx_setParameter(cctx, ZSTD_c_contentSizeFlag, content_size ? 1 : 0);
+    *frame_len = ZSTD_compress2(cctx, extent, bound, data, len);
+    TEST_ASSERT_FALSE(ZSTD_isError(*frame_len));
+    ZSTD_freeCCtx(cctx);
+    free(data);
+
+    *extent_len = (*frame_len + 4095) / 4096 * 4096;
+    return extent;
+}
+
+static struct encoded_extent zstd_extent(const uint8_t *data, size_t data_len, uint64_t len) {
+    struct encoded_extent extent = {
+        .data = data,
+        .data_len = data_len,
+        .compression = BTRFS_COMPRESSION_ZSTD,
+        .encryption = 0,
+        .len = len,
+        .unencoded_len = len,
+        .unencoded_offset = 0,
+    };
+    return extent;
+}
+
+// =============================================================================
+// encoded_extent_usable Tests
+// =============================================================================
+
+void test_extent_full_frame_is_usable(void) {
+    size_t frame_len, extent_len;
+    uint8_t *extent = make_extent(BURST_FRAME_SIZE, true, &frame_len, &extent_len);
+    struct encoded_extent e = zstd_extent(extent, extent_len, BURST_FRAME_SIZE);
+
+    TEST_ASSERT_EQUAL(frame_len, encoded_extent_usable(&e, 0, 4 * BURST_FRAME_SIZE, dctx, plain));
+
+    uint8_t *expected = malloc(BURST_FRAME_SIZE);
+    fill_test_data(expected, BURST_FRAME_SIZE, BURST_FRAME_SIZE);
+    TEST_ASSERT_EQUAL_MEMORY(expected, plain, BURST_FRAME_SIZE);
+
+    free(expected);
+    free(extent);
+}
+
+void test_extent_other_compression_not_usable(void) {
+    size_t frame_len, extent_len;
+    uint8_t *extent = make_extent(BURST_FRAME_SIZE, true, &frame_len, &extent_len);
+    struct encoded_extent e = zstd_extent(extent, extent_len, BURST_FRAME_SIZE);
+
+    e.compression = BTRFS_COMPRESSION_NONE;
+    TEST_ASSERT_EQUAL(0, encoded_extent_usable(&e, 0, BURST_FRAME_SIZE, dctx, plain));
+    e.compression = 1;  // zlib
+    TEST_ASSERT_EQUAL(0, encoded_extent_usable(&e, 0, BURST_FRAME_SIZE, dctx, plain));
+
+    free(extent);
+}
+
+void test_extent_partial_reference_not_usable(void) {
+    size_t frame_len, extent_len;
+    uint8_t *extent = make_extent(BURST_FRAME_SIZE, true, &frame_len, &extent_len);
+
+    // Read started inside the extent
+    struct encoded_extent e = zstd_extent(extent, extent_len, BURST_FRAME_SIZE - 4096);
+    e.unencoded_offset = 4096;
+    TEST_ASSERT_EQUAL(0, encoded_extent_usable(&e, 4096, BURST_FRAME_SIZE, dctx, plain));
+
+    // File references only the start of the extent
+    e = zstd_extent(extent, extent_len, 64 * 1024);
+    e.unencoded_len = BURST_FRAME_SIZE;
+    TEST_ASSERT_EQUAL(0, encoded_extent_usable(&e, 0, BURST_FRAME_SIZE, dctx, plain));
+
+    // Extent extends beyond the end of the file
+    e = zstd_extent(extent, extent_len, BURST_FRAME_SIZE);
+    TEST_ASSERT_EQUAL(0, encoded_extent_usable(&e, 0, BURST_FRAME_SIZE - 1, dctx, plain));
+
+    free(extent);
+}
+
+void test_extent_unaligned_length_only_at_eof(void) {
+    size_t frame_len, extent_len;
+    uint8_t *extent = make_extent(5000, true, &frame_len, &extent_len);
+    struct encoded_extent e = zstd_extent(extent, extent_len, 5000);
+
+    TEST_ASSERT_EQUAL(0, encoded_extent_usable(&e, 0, 10000, dctx, plain));
+    TEST_ASSERT_EQUAL(frame_len, encoded_extent_usable(&e, 0, 5000, dctx, plain));
+    TEST_ASSERT_EQUAL(frame_len, encoded_extent_usable(&e, 8192, 13192, dctx, plain));
+
+    free(extent);
+}
+
+void test_extent_without_content_size_not_usable(void) {
+    size_t frame_len, extent_len;
+    uint8_t *extent = make_extent(BURST_FRAME_SIZE, false, &frame_len, &extent_len);
+    struct encoded_extent e = zstd_extent(extent, extent_len, BURST_FRAME_SIZE);
+
+    TEST_ASSERT_EQUAL(0, encoded_extent_usable(&e, 0, BURST_FRAME_SIZE, dctx, plain));
+
+    free(extent);
+}
+
+void test_extent_trailing_data_not_usable(void) {
+    size_t frame_len, extent_len;
+    uint8_t *extent = make_extent(BURST_FRAME_SIZE, true, &frame_len, &extent_len);
+    TEST_ASSERT_TRUE(extent_len > frame_len);
+    extent[frame_len] = 0x28;  // Something after the frame that is not padding
+    struct encoded_extent e = zstd_extent(extent, extent_len, BURST_FRAME_SIZE);
+
+    TEST_ASSERT_EQUAL(0, encoded_extent_usable(&e, 0, BURST_FRAME_SIZE, dctx, plain));
+
+    free(extent);
+}
+
+void test_extent_content_size_mismatch_not_usable(void) {
+    size_t frame_len, extent_len;
+    uint8_t *extent = make_extent(64 * 1024, true, &frame_len, &extent_len);
+    struct encoded_extent e = zstd_extent(extent, extent_len, 68 * 1024);
+
+    TEST_ASSERT_EQUAL(0, encoded_extent_usable(&e, 0, BURST_FRAME_SIZE, dctx, plain));
+
+    free(extent);
+}
+
+// =============================================================================
+// Reader and writer Tests
+// =============================================================================
+
+static FILE *create_input_file(size_t len) {
+    FILE *f = tmpfile();
+    TEST_ASSERT_NOT_NULL(f);
+    uint8_t *data = malloc(len);
+    fill_test_data(data, len, 99);
+    TEST_ASSERT_EQUAL(len, fwrite(data, 1, len, f));
+    fflush(f);
+    free(data);
+    rewind(f);
+    return f;
+}
+
+// Whatever the filesystem, the frames the reader produces must decode to the file
+void test_reader_frames_decode_to_file(void) {
+    const size_t len = 3 * BURST_FRAME_SIZE + 1234;
+    FILE *f = create_input_file(len);
+
+    bool unsupported = false;
+    struct encoded_reader *reader = encoded_reader_create(fileno(f), len, 3, &unsupported);
+    if (!reader) {
+        TEST_ASSERT_TRUE(unsupported);
+        fclose(f);
+        TEST_IGNORE_MESSAGE("BTRFS encoded reads not available here");
+    }
+
+    uint8_t *expected = malloc(len);
+    uint8_t *actual = malloc(len);
+    fill_test_data(expected, len, 99);
+
+    size_t pos = 0;
+    struct encoded_frame frame;
+    while (encoded_reader_next(reader, &frame) > 0) {
+        TEST_ASSERT_TRUE(frame.uncompressed_size <= BURST_FRAME_SIZE);
+        size_t n = ZSTD_decompress(actual + pos, len - pos, frame.data, frame.compressed_size);
+        TEST_ASSERT_FALSE(ZSTD_isError(n));
+        TEST_ASSERT_EQUAL(frame.uncompressed_size, n);
+        pos += n;
+        TEST_ASSERT_EQUAL(pos == len, frame.at_eof);
+    }
+    TEST_ASSERT_EQUAL(len, pos);
+    TEST_ASSERT_EQUAL_MEMORY(expected, actual, len);
+
+    free(expected);
+    free(actual);
+    encoded_reader_destroy(reader);
+    fclose(f);
+}
+
+void test_reader_invalid_fd(void) {
+    bool unsupported = true;
+    TEST_ASSERT_NULL(encoded_reader_create(-1, 100, 3, &unsupported));
+    TEST_ASSERT_FALSE(unsupported);
+}
+
+void test_set_encoded_read_null_writer(void) {
+    TEST_ASSERT_EQUAL(-1, burst_writer_set_encoded_read(NULL, true));
+}
+
+// Without BTRFS support the writer falls back to its normal path, byte for byte
+void test_writer_falls_back_without_btrfs(void) {
+    const size_t len = 2 * BURST_FRAME_SIZE + 77;
+    FILE *probe = create_input_file(len);
+    bool unsupported = false;
+    struct encoded_reader *reader = encoded_reader_create(fileno(probe), len, 3, &unsupported);
+    fclose(probe);
+    if (reader) {
+        encoded_reader_destroy(reader);
+        TEST_IGNORE_MESSAGE("BTRFS encoded reads available; fallback not exercised");
+    }
+
+    uint8_t *archives[2];
+    long sizes[2];
+    for (int mode = 0; mode < 2; mode++) {
+        FILE *out = tmpfile();
+        struct burst_writer *writer = burst_writer_create(out, 3);
+        TEST_ASSERT_NOT_NULL(writer);
+        TEST_ASSERT_EQUAL(0, burst_writer_set_encoded_read(writer, mode == 1));
+
+        uint8_t lfh_buf[128];
+        struct zip_local_header *lfh;
+        int lfh_len;
+        create_test_lfh(lfh_buf, "file", false, &lfh, &lfh_len);
+
+        FILE *in = create_input_file(len);
+        TEST_ASSERT_EQUAL(0, burst_writer_add_file(writer, in, lfh, lfh_len, false, 0100644, 0, 0));
+        fclose(in);
+        TEST_ASSERT_FALSE(writer->encoded_read);  // Turned off after the failed probe
+        TEST_ASSERT_EQUAL(0, writer->encoded_frames_reused);
+        TEST_ASSERT_EQUAL(0, burst_writer_finalize(writer));
+
+        sizes[mode] = ftell(out);
+        archives[mode] = malloc((size_t)sizes[mode]);
+        rewind(out);
+        TEST_ASSERT_EQUAL((size_t)sizes[mode], fread(archives[mode], 1, (size_t)sizes[mode], out));
+        burst_writer_destroy(writer);
+        fclose(out);
+    }
+
+    TEST_ASSERT_EQUAL(sizes[0], sizes[1]);
+    TEST_ASSERT_EQUAL_MEMORY(archives[0], archives[1], (size_t)sizes[0]);
+    free(archives[0]);
+    free(archives[1]);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_extent_full_frame_is_usable);
+    RUN_TEST(test_extent_other_compression_not_usable);
+    RUN_TEST(test_extent_partial_reference_not_usable);
+    RUN_TEST(test_extent_unaligned_length_only_at_eof);
+    RUN_TEST(test_extent_without_content_size_not_usable);
+    RUN_TEST(test_extent_trailing_data_not_usable);
+    RUN_TEST(test_extent_content_size_mismatch_not_usable);
+    RUN_TEST(test_reader_frames_decode_to_file);
+    RUN_TEST(test_reader_invalid_fd);
+    RUN_TEST(test_set_encoded_read_null_writer);
+    RUN_TEST(test_writer_falls_back_without_btrfs);
+
+    return UNITY_END();
+}
@@ -92,11 +92,45 @@ void test_symlink_add_success(void) {
     TEST_ASSERT_EQUAL(1, result);
 }
 
+/*
+ * Test that a failure adding a precompressed file is reported and not fatal.
+ */
+void test_compressed_file_add_failure(void) {
+    struct stat st;
+    memset(&st, 0, sizeof(st));
+    st.st_mode = S_IFREG | 0644;
+    st.st_size = 100;
+
+    burst_writer_add_compressed_file_IgnoreAndReturn(-1);
+
+    int result = process_compressed_entry(NULL, "/test/file", "file", &st, NULL);
+    TEST_ASSERT_EQUAL(0, result);
+}
+
+/*
+ * Test that precompressed file add success returns 1 and records the
+ * file's stat for later --base runs.
+ */
+void test_compressed_file_add_success(void) {
+    struct stat st;
+    memset(&st, 0, sizeof(st));
+    st.st_mode = S_IFREG | 0644;
+    st.st_size = 100;
+
+    burst_writer_add_compressed_file_IgnoreAndReturn(0);
+    burst_writer_set_source_stat_ExpectAndReturn(NULL, &st, 0);
+
+    int result = process_compressed_entry(NULL, "/test/file", "file", &st, NULL);
+    TEST_ASSERT_EQUAL(1, result);
+}
+
 int main(void) {
     UNITY_BEGIN();
     RUN_TEST(test_directory_add_failure_no_double_free);
     RUN_TEST(test_symlink_add_failure_no_double_free);
     RUN_TEST(test_directory_add_success);
     RUN_TEST(test_symlink_add_success);
+    RUN_TEST(test_compressed_file_add_failure);
+    RUN_TEST(test_compressed_file_add_success);
     return UNITY_END();
 }
@@ -0,0 +1,182 @@
+/*
+ * Unit tests for the bounded entry stream between the scanner and the writer loop.
+ */
+
+#include "unity.h"
+#include "../../src/writer/entry_stream.h"
+#include "../../src/writer/dir_scanner.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <limits.h>
+
+#define NUM_DIRS 30
+#define FILES_PER_DIR 20
+
+static char test_dir[] = "/tmp/burst_stream_test_XXXXXX";
+
+void setUp(void) {
+    TEST_ASSERT_NOT_NULL(mkdtemp(test_dir));
+    for (int i = 0; i < NUM_DIRS; i++) {
+        char path[PATH_MAX];
+        snprintf(path, sizeof(path), "%s/d%02d", test_dir, i);
+        TEST_ASSERT_EQUAL(0, mkdir(path, 0755));
+        for (int j = 0; j < FILES_PER_DIR; j++) {
+            snprintf(path, sizeof(path), "%s/d%02d/f%02d", test_dir, i, j);
+            FILE *f = fopen(path, "w");
+            TEST_ASSERT_NOT_NULL(f);
+            fprintf(f, "%d-%d", i, j);
+            fclose(f);
+        }
+    }
+}
+
+void tearDown(void) {
+    for (int i = 0; i < NUM_DIRS; i++) {
+        char path[PATH_MAX];
+        for (int j = 0; j < FILES_PER_DIR; j++) {
+            snprintf(path, sizeof(path), "%s/d%02d/f%02d", test_dir, i, j);
+            unlink(path);
+        }
+        snprintf(path, sizeof(path), "%s/d%02d", test_dir, i);
+        rmdir(path);
+    }
+    rmdir(test_dir);
+    strcpy(test_dir, "/tmp/burst_stream_test_XXXXXX");
+}
+
+struct name_list {
+    char *names[NUM_DIRS * (FILES_PER_DIR + 1)];
+    int count;
+};
+
+static int collect_name(void *ctx, const char *path, const char *name,
+                        const struct stat *st, const char *symlink_target, bool is_dir) {
+    (void)path;
+    (void)st;
+    (void)symlink_target;
+    (void)is_dir;
+    struct name_list *list = ctx;
+    list->names[list->count++] = strdup(name);
+    return 0;
+}
+
+static void push_simple(struct entry_stream *stream, const char *name) {
+    struct stat st;
+    memset(&st, 0, sizeof(st));
+    st.st_mode = S_IFREG | 0644;
+    TEST_ASSERT_EQUAL(0, entry_stream_push(stream, name, name, &st, NULL, false));
+}
+
+// =============================================================================
+// entry_stream Tests
+// =============================================================================
+
+void test_stream_create_zero_capacity(void) {
+    TEST_ASSERT_NULL(entry_stream_create(0));
+}
+
+void test_stream_fifo_and_peek_ahead(void) {
+    struct entry_stream *stream = entry_stream_create(4);
+    TEST_ASSERT_NOT_NULL(stream);
+
+    push_simple(stream, "a");
+    push_simple(stream, "b");
+
+    struct stat st;
+    memset(&st, 0, sizeof(st));
+    TEST_ASSERT_EQUAL(0, entry_stream_push(stream, "/x/link", "link", &st, "target", false));
+
+    TEST_ASSERT_EQUAL_STRING("a", entry_stream_peek(stream, 0, false)->name);
+    TEST_ASSERT_EQUAL_STRING("b", entry_stream_peek(stream, 1, false)->name);
+    TEST_ASSERT_EQUAL_STRING("target", entry_stream_peek(stream, 2, false)->target);
+    TEST_ASSERT_NULL(entry_stream_peek(stream, 3, false));
+    TEST_ASSERT_NULL(entry_stream_peek(stream, 4, false));  // Beyond capacity
+
+    entry_stream_pop(stream);
+    TEST_ASSERT_EQUAL_STRING("b", entry_stream_peek(stream, 0, false)->name);
+
+    entry_stream_close(stream, 0);
+    entry_stream_pop(stream);
+    entry_stream_pop(stream);
+    TEST_ASSERT_NULL(entry_stream_peek(stream, 0, true));
+    TEST_ASSERT_EQUAL(0, entry_stream_status(stream));
+
+    entry_stream_destroy(stream);
+}
+
+void test_stream_push_after_cancel_fails(void) {
+    struct entry_stream *stream = entry_stream_create(2);
+    TEST_ASSERT_NOT_NULL(stream);
+    entry_stream_cancel(stream);
+
+    struct stat st;
+    memset(&st, 0, sizeof(st));
+    TEST_ASSERT_EQUAL(-1, entry_stream_push(stream, "a", "a", &st, NULL, false));
+
+    entry_stream_destroy(stream);
+}
+
+// Scanned entries arrive in the scanner's order through a stream much smaller than the tree
+void test_stream_scan_preserves_order(void) {
+    struct name_list expected = {0};
+    TEST_ASSERT_EQUAL(0, dir_scanner_scan(test_dir, 1, collect_name, &expected));
+    TEST_ASSERT_EQUAL(NUM_DIRS * (FILES_PER_DIR + 1), expected.count);
+
+    struct entry_stream *stream = entry_stream_create(8);
+    TEST_ASSERT_NOT_NULL(stream);
+    TEST_ASSERT_EQUAL(0, entry_stream_start_scan(stream, test_dir, 4));
+
+    int count = 0;
+    struct stream_entry *entry;
+    while ((entry = entry_stream_peek(stream, 0, true)) != NULL) {
+        TEST_ASSERT_TRUE(count < expected.count);
+        TEST_ASSERT_EQUAL_STRING(expected.names[count], entry->name);
+        TEST_ASSERT_NULL(entry->user_data);
+        entry_stream_pop(stream);
+        count++;
+    }
+    TEST_ASSERT_EQUAL(expected.count, count);
+    TEST_ASSERT_EQUAL(0, entry_stream_status(stream));
+
+    entry_stream_destroy(stream);
+    for (int i = 0; i < expected.count; i++) {
+        free(expected.names[i]);
+    }
+}
+
+void test_stream_scan_missing_dir_reports_error(void) {
+    struct entry_stream *stream = entry_stream_create(8);
+    TEST_ASSERT_NOT_NULL(stream);
+    TEST_ASSERT_EQUAL(0, entry_stream_start_scan(stream, "/nonexistent/burst/dir", 2));
+
+    TEST_ASSERT_NULL(entry_stream_peek(stream, 0, true));
+    TEST_ASSERT_EQUAL(-1, entry_stream_status(stream));
+
+    entry_stream_destroy(stream);
+}
+
+// Destroying the stream while the scanner is blocked on a full queue must not hang
+void test_stream_destroy_stops_blocked_scan(void) {
+    struct entry_stream *stream = entry_stream_create(2);
+    TEST_ASSERT_NOT_NULL(stream);
+    TEST_ASSERT_EQUAL(0, entry_stream_start_scan(stream, test_dir, 2));
+
+    TEST_ASSERT_NOT_NULL(entry_stream_peek(stream, 1, true));
+    entry_stream_destroy(stream);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_stream_create_zero_capacity);
+    RUN_TEST(test_stream_fifo_and_peek_ahead);
+    RUN_TEST(test_stream_push_after_cancel_fails);
+    RUN_TEST(test_stream_scan_preserves_order);
+    RUN_TEST(test_stream_scan_missing_dir_reports_error);
+    RUN_TEST(test_stream_destroy_stops_blocked_scan);
+
+    return UNITY_END();
+}
@@ -2,8 +2,10 @@
 #include "frame_parser.h"
 #include "stream_processor.h"
 
+#include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#include <zstd.h>
 
 // ZIP format constants
 #define ZIP_LOCAL_FILE_HEADER_SIG 0x04034b50
@@ -244,6 +246,30 @@ void test_parse_burst_start_of_part(void) {
     TEST_ASSERT_EQUAL(uncompressed_offset, info.start_of_part_offset);
 }
 
+void test_parse_burst_zero_marker(void) {
+    uint8_t buffer[16];
+    uint32_t magic = BURST_MAGIC;
+    uint32_t payload_size = 1;
+    memcpy(buffer, &magic, 4);
+    memcpy(buffer + 4, &payload_size, 4);
+    buffer[8] = 0x02;  // Zero frame type byte
+
+    struct frame_info info;
+    int rc = parse_next_frame(buffer, 9, &info);
+
+    TEST_ASSERT_EQUAL(STREAM_PROC_SUCCESS, rc);
+    TEST_ASSERT_EQUAL(FRAME_BURST_ZERO, info.type);
+    TEST_ASSERT_EQUAL(9, info.frame_size);
+
+    // Type 0x02 with any other payload size is padding
+    payload_size = 4;
+    memcpy(buffer + 4, &payload_size, 4);
+    memset(buffer + 9, 0, 3);
+    rc = parse_next_frame(buffer, 12, &info);
+    TEST_ASSERT_EQUAL(STREAM_PROC_SUCCESS, rc);
+    TEST_ASSERT_EQUAL(FRAME_BURST_PADDING, info.type);
+}
+
 void test_parse_zero_payload_burst(void) {
     uint8_t buffer[8];
     size_t frame_size = create_padding_frame(buffer, 0);
@@ -453,6 +479,65 @@ void test_parse_start_of_part_wrong_payload_size(void) {
     TEST_ASSERT_EQUAL(FRAME_BURST_PADDING, info.type);
 }
 
+// =============================================================================
+// Bytes Needed to Complete a Split Frame
+// =============================================================================
+
+void test_bytes_needed_zstd_frame_prefixes(void) {
+    // Incompressible data spread over several blocks, with a checksum
+    size_t src_len = 300 * 1024;
+    uint8_t *src = malloc(src_len);
+    TEST_ASSERT_NOT_NULL(src);
+    uint32_t x = 12345;
+    for (size_t i = 0; i < src_len; i++) {
+        x = x * 1103515245 + 12345;
+        src[i] = (uint8_t)(x >> 16);
+    }
+    ZSTD_CCtx *cctx = ZSTD_createCCtx();
+    ZSTD_CCtx_setParameter(cctx, ZSTD_c_checksumFlag, 1);
+    size_t dst_cap = ZSTD_compressBound(src_len);
+    uint8_t *dst = malloc(dst_cap);
+    TEST_ASSERT_NOT_NULL(dst);
+    size_t frame_len = ZSTD_compress2(cctx, dst, dst_cap, src, src_len);
+    TEST_ASSERT_FALSE(ZSTD_isError(frame_len));
+    ZSTD_freeCCtx(cctx);
+
+    // Every prefix asks for more than it has but never more than the frame
+    size_t steps = 0;
+    size_t len = 0;
+    while (len < frame_len) {
+        size_t needed = frame_bytes_needed(dst, len);
+        TEST_ASSERT_GREATER_THAN(len, needed);
+        TEST_ASSERT_LESS_OR_EQUAL(frame_len, needed);
+        len = needed;
+        steps++;
+    }
+    TEST_ASSERT_EQUAL(frame_len, len);
+    TEST_ASSERT_EQUAL(frame_len, frame_bytes_needed(dst, frame_len));
+    TEST_ASSERT_LESS_THAN(10, steps);  // Header, then one step per block
+
+    free(dst);
+    free(src);
+}
+
+void test_bytes_needed_local_header(void) {
+    uint8_t buffer[256];
+    size_t header_len = create_zip_local_header(buffer, "some/dir/file.txt");
+
+    TEST_ASSERT_EQUAL(4, frame_bytes_needed(buffer, 2));
+    TEST_ASSERT_EQUAL(30, frame_bytes_needed(buffer, 10));
+    TEST_ASSERT_EQUAL(header_len, frame_bytes_needed(buffer, 30));
+}
+
+void test_bytes_needed_burst_frame(void) {
+    uint8_t buffer[128];
+    size_t frame_len = create_padding_frame(buffer, 100);
+
+    TEST_ASSERT_EQUAL(8, frame_bytes_needed(buffer, 6));
+    TEST_ASSERT_EQUAL(frame_len, frame_bytes_needed(buffer, 8));
+    TEST_ASSERT_EQUAL(frame_len, frame_bytes_needed(buffer, 50));
+}
+
 // =============================================================================
 // Main
 // =============================================================================
@@ -468,6 +553,7 @@ int main(void) {
     RUN_TEST(test_parse_zstd_frame);
     RUN_TEST(test_parse_burst_padding);
     RUN_TEST(test_parse_burst_start_of_part);
+    RUN_TEST(test_parse_burst_zero_marker);
     RUN_TEST(test_parse_zero_payload_burst);
 
     // NEED_MORE_DATA Returns
@@ -490,5 +576,10 @@ int main(void) {
     RUN_TEST(test_parse_burst_with_non_standard_type_byte);
     RUN_TEST(test_parse_start_of_part_wrong_payload_size);
 
+    // Bytes Needed to Complete a Split Frame
+    RUN_TEST(test_bytes_needed_zstd_frame_prefixes);
+    RUN_TEST(test_bytes_needed_local_header);
+    RUN_TEST(test_bytes_needed_burst_frame);
+
     return UNITY_END();
 }
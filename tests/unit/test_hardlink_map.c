@@ -0,0 +1,191 @@
+/*
+ * Unit tests for hardlink detection (hardlink_map) and hardlink entries.
+ *
+ * The round-trip tests write archives with burst_writer and parse their
+ * central directory with the downloader's parser to check the hardlink
+ * extra field.
+ */
+
+#include "unity.h"
+#include "test_helpers.h"
+#include "burst_writer.h"
+#include "zip_structures.h"
+#include "central_dir_parser.h"
+#include "../../src/writer/hardlink_map.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static struct stat inode_stat(dev_t dev, ino_t ino, nlink_t nlink) {
+    struct stat st;
+    memset(&st, 0, sizeof(st));
+    st.st_mode = S_IFREG | 0644;
+    st.st_dev = dev;
+    st.st_ino = ino;
+    st.st_nlink = nlink;
+    return st;
+}
+
+void test_find_returns_first_name(void) {
+    struct hardlink_map *map = hardlink_map_create();
+    TEST_ASSERT_NOT_NULL(map);
+
+    struct stat st = inode_stat(1, 42, 2);
+    TEST_ASSERT_NULL(hardlink_map_find(map, &st));
+    TEST_ASSERT_EQUAL(0, hardlink_map_add(map, &st, "a/first.txt"));
+    TEST_ASSERT_EQUAL_STRING("a/first.txt", hardlink_map_find(map, &st));
+
+    // A later name does not replace the first
+    TEST_ASSERT_EQUAL(0, hardlink_map_add(map, &st, "b/second.txt"));
+    TEST_ASSERT_EQUAL_STRING("a/first.txt", hardlink_map_find(map, &st));
+
+    hardlink_map_destroy(map);
+}
+
+void test_single_link_files_are_ignored(void) {
+    struct hardlink_map *map = hardlink_map_create();
+
+    struct stat st = inode_stat(1, 7, 1);
+    TEST_ASSERT_EQUAL(0, hardlink_map_add(map, &st, "only.txt"));
+    TEST_ASSERT_NULL(hardlink_map_find(map, &st));
+
+    hardlink_map_destroy(map);
+}
+
+void test_non_regular_files_are_ignored(void) {
+    struct hardlink_map *map = hardlink_map_create();
+
+    struct stat st = inode_stat(1, 8, 3);
+    st.st_mode = S_IFDIR | 0755;
+    TEST_ASSERT_EQUAL(0, hardlink_map_add(map, &st, "dir/"));
+    TEST_ASSERT_NULL(hardlink_map_find(map, &st));
+
+    hardlink_map_destroy(map);
+}
+
+void test_device_is_part_of_key(void) {
+    struct hardlink_map *map = hardlink_map_create();
+
+    struct stat on_dev1 = inode_stat(1, 100, 2);
+    struct stat on_dev2 = inode_stat(2, 100, 2);
+    TEST_ASSERT_EQUAL(0, hardlink_map_add(map, &on_dev1, "dev1.txt"));
+    TEST_ASSERT_NULL(hardlink_map_find(map, &on_dev2));
+    TEST_ASSERT_EQUAL(0, hardlink_map_add(map, &on_dev2, "dev2.txt"));
+    TEST_ASSERT_EQUAL_STRING("dev1.txt", hardlink_map_find(map, &on_dev1));
+    TEST_ASSERT_EQUAL_STRING("dev2.txt", hardlink_map_find(map, &on_dev2));
+
+    hardlink_map_destroy(map);
+}
+
+void test_map_grows(void) {
+    struct hardlink_map *map = hardlink_map_create();
+    char name[32];
+
+    for (ino_t ino = 1; ino <= 5000; ino++) {
+        struct stat st = inode_stat(3, ino, 2);
+        snprintf(name, sizeof(name), "file%lu", (unsigned long)ino);
+        TEST_ASSERT_EQUAL(0, hardlink_map_add(map, &st, name));
+    }
+    for (ino_t ino = 1; ino <= 5000; ino++) {
+        struct stat st = inode_stat(3, ino, 2);
+        snprintf(name, sizeof(name), "file%lu", (unsigned long)ino);
+        TEST_ASSERT_EQUAL_STRING(name, hardlink_map_find(map, &st));
+    }
+
+    hardlink_map_destroy(map);
+}
+
+void test_find_in_null_map(void) {
+    struct stat st = inode_stat(1, 1, 2);
+    TEST_ASSERT_NULL(hardlink_map_find(NULL, &st));
+    hardlink_map_destroy(NULL);
+}
+
+void test_build_hardlink_extra_field(void) {
+    uint8_t buffer[32];
+    size_t len = build_hardlink_extra_field(buffer, sizeof(buffer), "dir/a.txt");
+
+    TEST_ASSERT_EQUAL(BURST_HARDLINK_EXTRA_HEADER_SIZE + 9, len);
+    TEST_ASSERT_EQUAL_HEX8(ZIP_EXTRA_BURST_HARDLINK_ID & 0xFF, buffer[0]);
+    TEST_ASSERT_EQUAL_HEX8(ZIP_EXTRA_BURST_HARDLINK_ID >> 8, buffer[1]);
+    TEST_ASSERT_EQUAL(10, buffer[2] | (buffer[3] << 8));
+    TEST_ASSERT_EQUAL(BURST_HARDLINK_EXTRA_VERSION, buffer[4]);
+    TEST_ASSERT_EQUAL_MEMORY("dir/a.txt", buffer + 5, 9);
+
+    // Too small a buffer, or no target
+    TEST_ASSERT_EQUAL(0, build_hardlink_extra_field(buffer, 8, "dir/a.txt"));
+    TEST_ASSERT_EQUAL(0, build_hardlink_extra_field(buffer, sizeof(buffer), ""));
+}
+
+void test_hardlink_entry_round_trip(void) {
+    FILE *out = tmpfile();
+    TEST_ASSERT_NOT_NULL(out);
+    struct burst_writer *writer = burst_writer_create(out, 3);
+    TEST_ASSERT_NOT_NULL(writer);
+
+    // The data, once
+    const char *content = "shared content shared content shared content\n";
+    FILE *in = tmpfile();
+    fputs(content, in);
+    rewind(in);
+    uint8_t lfh_buf[128];
+    struct zip_local_header *lfh;
+    int lfh_len;
+    create_test_lfh(lfh_buf, "pkg/data.txt", false, &lfh, &lfh_len);
+    TEST_ASSERT_EQUAL(0, burst_writer_add_file(writer, in, lfh, lfh_len, false, 0100644, 0, 0));
+    fclose(in);
+
+    // A second name for it
+    create_test_lfh(lfh_buf, "other/link.txt", true, &lfh, &lfh_len);
+    TEST_ASSERT_EQUAL(0, burst_writer_add_hardlink(writer, lfh, lfh_len, "pkg/data.txt",
+                                                   0100644, 0, 0));
+    TEST_ASSERT_EQUAL(1, writer->hardlinks);
+    TEST_ASSERT_EQUAL(-1, burst_writer_add_hardlink(writer, lfh, lfh_len, "", 0100644, 0, 0));
+
+    TEST_ASSERT_EQUAL(0, burst_writer_finalize(writer));
+    burst_writer_destroy(writer);
+
+    long size = ftell(out);
+    uint8_t *archive = malloc((size_t)size);
+    rewind(out);
+    TEST_ASSERT_EQUAL((size_t)size, fread(archive, 1, (size_t)size, out));
+    fclose(out);
+
+    struct central_dir_parse_result result;
+    TEST_ASSERT_EQUAL(CENTRAL_DIR_PARSE_SUCCESS,
+                      central_dir_parse(archive, (size_t)size, (uint64_t)size,
+                                        BURST_BASE_PART_SIZE, &result));
+    TEST_ASSERT_EQUAL(2, result.num_files);
+
+    TEST_ASSERT_EQUAL_STRING("pkg/data.txt", result.files[0].filename);
+    TEST_ASSERT_NULL(result.files[0].hardlink_target);
+    TEST_ASSERT_EQUAL(strlen(content), result.files[0].uncompressed_size);
+
+    // No data of its own; other extractors see an empty file
+    TEST_ASSERT_EQUAL_STRING("other/link.txt", result.files[1].filename);
+    TEST_ASSERT_EQUAL_STRING("pkg/data.txt", result.files[1].hardlink_target);
+    TEST_ASSERT_EQUAL(0, result.files[1].uncompressed_size);
+    TEST_ASSERT_EQUAL(ZIP_METHOD_STORE, result.files[1].compression_method);
+    TEST_ASSERT_TRUE(result.files[1].has_unix_extra);
+
+    central_dir_parse_result_free(&result);
+    free(archive);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_find_returns_first_name);
+    RUN_TEST(test_single_link_files_are_ignored);
+    RUN_TEST(test_non_regular_files_are_ignored);
+    RUN_TEST(test_device_is_part_of_key);
+    RUN_TEST(test_map_grows);
+    RUN_TEST(test_find_in_null_map);
+    RUN_TEST(test_build_hardlink_extra_field);
+    RUN_TEST(test_hardlink_entry_round_trip);
+
+    return UNITY_END();
+}
@@ -0,0 +1,49 @@
+/*
+ * Helpers shared by the unit tests.
+ */
+
+#include "test_helpers.h"
+#include <string.h>
+
+void fill_test_data(uint8_t *buf, size_t len, uint32_t seed) {
+    uint32_t x = seed;
+    for (size_t i = 0; i < len; i++) {
+        x = x * 1103515245 + 12345;
+        buf[i] = (uint8_t)((x >> 16) & 0x0F) + 'a';
+    }
+}
+
+void create_test_lfh(uint8_t *buffer, const char *filename, bool is_empty,
+                     struct zip_local_header **lfh_out, int *lfh_len_out) {
+    struct zip_local_header *lfh = (struct zip_local_header *)buffer;
+    memset(lfh, 0, sizeof(struct zip_local_header));
+
+    lfh->signature = ZIP_LOCAL_FILE_HEADER_SIG;
+    lfh->version_needed = is_empty ? ZIP_VERSION_STORE : ZIP_VERSION_ZSTD;
+    lfh->flags = ZIP_FLAG_DATA_DESCRIPTOR;
+    lfh->compression_method = is_empty ? ZIP_METHOD_STORE : ZIP_METHOD_ZSTD;
+    lfh->filename_length = strlen(filename);
+    memcpy(buffer + sizeof(struct zip_local_header), filename, strlen(filename));
+
+    *lfh_out = lfh;
+    *lfh_len_out = sizeof(struct zip_local_header) + strlen(filename);
+}
+
+void collector_sync_init(struct collector_sync *sync) {
+    pthread_mutex_init(&sync->mutex, NULL);
+    pthread_cond_init(&sync->cv, NULL);
+    sync->finished = false;
+}
+
+void collector_sync_destroy(struct collector_sync *sync) {
+    pthread_mutex_destroy(&sync->mutex);
+    pthread_cond_destroy(&sync->cv);
+}
+
+void wait_finished(struct collector_sync *sync) {
+    pthread_mutex_lock(&sync->mutex);
+    while (!sync->finished) {
+        pthread_cond_wait(&sync->cv, &sync->mutex);
+    }
+    pthread_mutex_unlock(&sync->mutex);
+}
@@ -0,0 +1,56 @@
+#ifndef TEST_HELPERS_H
+#define TEST_HELPERS_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "zip_structures.h"
+
+/**
+ * Helpers shared by the unit tests.
+ */
+
+/**
+ * Fill buf with lowercase letters from a seeded LCG: repeatable, and
+ * compressible enough to exercise the zstd paths.
+ */
+void fill_test_data(uint8_t *buf, size_t len, uint32_t seed);
+
+/**
+ * Build a local file header for filename in buffer, followed by the name.
+ *
+ * The entry uses a data descriptor and is zstd compressed, or stored when
+ * is_empty. Tests needing other fields set them through *lfh_out.
+ *
+ * @param buffer       Space for the header and the name
+ * @param filename     Entry name
+ * @param is_empty     Store the entry instead of compressing it
+ * @param lfh_out      Set to the header in buffer
+ * @param lfh_len_out  Set to the length of header and name
+ */
+void create_test_lfh(uint8_t *buffer, const char *filename, bool is_empty,
+                     struct zip_local_header **lfh_out, int *lfh_len_out);
+
+/**
+ * Lets a test wait for a source request's finish() callback.
+ *
+ * Collectors embed this as their sync member; their callbacks take mutex
+ * around the fields they update and broadcast cv, and finish() sets finished.
+ */
+struct collector_sync {
+    pthread_mutex_t mutex;
+    pthread_cond_t cv;
+    bool finished;
+};
+
+void collector_sync_init(struct collector_sync *sync);
+void collector_sync_destroy(struct collector_sync *sync);
+
+/**
+ * Block until sync->finished is set.
+ */
+void wait_finished(struct collector_sync *sync);
+
+#endif // TEST_HELPERS_H
@@ -0,0 +1,283 @@
+/*
+ * Unit tests for the downloader's I/O worker pool.
+ */
+
+#include "unity.h"
+#include "io_pool.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+#define NUM_STREAMS 16
+#define CHUNKS_PER_STREAM 200
+
+struct stream_state {
+    uint32_t next_expected;  // Sequence number of the next chunk
+    size_t chunks_seen;
+    int fail_at;             // Chunk index that fails, or -1
+    int done_calls;
+    int done_rc;
+    size_t chunks_at_done;
+    bool out_of_order;
+    bool concurrent;
+    int active;              // Workers currently in process() for this stream
+    struct io_stream *reopen;  // Reopened by the first done() when set
+};
+
+static pthread_mutex_t state_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static int process_chunk(void *ctx, const uint8_t *data, size_t len) {
+    struct stream_state *s = ctx;
+    uint32_t seq;
+    TEST_ASSERT_EQUAL(sizeof(seq), len);
+    memcpy(&seq, data, sizeof(seq));
+
+    pthread_mutex_lock(&state_mutex);
+    if (s->active++ != 0) {
+        s->concurrent = true;
+    }
+    pthread_mutex_unlock(&state_mutex);
+
+    if (seq != s->next_expected) {
+        s->out_of_order = true;
+    }
+    s->next_expected = seq + 1;
+    s->chunks_seen++;
+
+    pthread_mutex_lock(&state_mutex);
+    s->active--;
+    pthread_mutex_unlock(&state_mutex);
+
+    return (int)seq == s->fail_at ? -7 : 0;
+}
+
+static void stream_done(void *ctx, int rc) {
+    struct stream_state *s = ctx;
+    if (s->reopen && s->done_calls == 0) {
+        TEST_ASSERT_EQUAL(0, io_stream_reopen(s->reopen));
+    }
+    pthread_mutex_lock(&state_mutex);
+    s->done_calls++;
+    s->done_rc = rc;
+    s->chunks_at_done = s->chunks_seen;
+    pthread_mutex_unlock(&state_mutex);
+}
+
+static void submit_seq(struct io_stream *stream, uint32_t seq) {
+    TEST_ASSERT_EQUAL(0, io_stream_submit(stream, (const uint8_t *)&seq, sizeof(seq)));
+}
+
+void test_create_rejects_zero_threads(void) {
+    TEST_ASSERT_NULL(io_pool_create(0));
+}
+
+void test_chunks_processed_in_order_per_stream(void) {
+    struct io_pool *pool = io_pool_create(4);
+    TEST_ASSERT_NOT_NULL(pool);
+
+    struct stream_state states[NUM_STREAMS];
+    struct io_stream *streams[NUM_STREAMS];
+    memset(states, 0, sizeof(states));
+    for (int i = 0; i < NUM_STREAMS; i++) {
+        states[i].fail_at = -1;
+        streams[i] = io_stream_create(pool, process_chunk, stream_done, &states[i]);
+        TEST_ASSERT_NOT_NULL(streams[i]);
+    }
+
+    // Interleave submissions the way concurrent part downloads do
+    for (uint32_t seq = 0; seq < CHUNKS_PER_STREAM; seq++) {
+        for (int i = 0; i < NUM_STREAMS; i++) {
+            submit_seq(streams[i], seq);
+        }
+    }
+    for (int i = 0; i < NUM_STREAMS; i++) {
+        io_stream_finish(streams[i]);
+    }
+
+    for (int i = 0; i < NUM_STREAMS; i++) {
+        io_stream_destroy(streams[i]);
+        TEST_ASSERT_FALSE(states[i].out_of_order);
+        TEST_ASSERT_FALSE(states[i].concurrent);
+        TEST_ASSERT_EQUAL(CHUNKS_PER_STREAM, states[i].chunks_seen);
+        TEST_ASSERT_EQUAL(1, states[i].done_calls);
+        TEST_ASSERT_EQUAL(0, states[i].done_rc);
+        TEST_ASSERT_EQUAL(CHUNKS_PER_STREAM, states[i].chunks_at_done);
+    }
+
+    io_pool_destroy(pool);
+}
+
+void test_error_drops_later_chunks(void) {
+    struct io_pool *pool = io_pool_create(2);
+    TEST_ASSERT_NOT_NULL(pool);
+
+    struct stream_state state;
+    memset(&state, 0, sizeof(state));
+    state.fail_at = 3;
+    struct io_stream *stream = io_stream_create(pool, process_chunk, stream_done, &state);
+    TEST_ASSERT_NOT_NULL(stream);
+
+    for (uint32_t seq = 0; seq < 10; seq++) {
+        uint32_t copy = seq;
+        io_stream_submit(stream, (const uint8_t *)&copy, sizeof(copy));
+    }
+    io_stream_finish(stream);
+    io_stream_destroy(stream);
+
+    TEST_ASSERT_EQUAL(4, state.chunks_seen);
+    TEST_ASSERT_EQUAL(1, state.done_calls);
+    TEST_ASSERT_EQUAL(-7, state.done_rc);
+
+    io_pool_destroy(pool);
+}
+
+void test_submit_fails_after_error(void) {
+    struct io_pool *pool = io_pool_create(1);
+    TEST_ASSERT_NOT_NULL(pool);
+
+    struct stream_state state;
+    memset(&state, 0, sizeof(state));
+    state.fail_at = 0;
+    struct io_stream *stream = io_stream_create(pool, process_chunk, stream_done, &state);
+    TEST_ASSERT_NOT_NULL(stream);
+
+    submit_seq(stream, 0);
+    io_stream_finish(stream);
+    io_stream_destroy(stream);
+    TEST_ASSERT_EQUAL(-7, state.done_rc);
+
+    // A fresh stream on the same pool is unaffected
+    memset(&state, 0, sizeof(state));
+    state.fail_at = -1;
+    stream = io_stream_create(pool, process_chunk, stream_done, &state);
+    TEST_ASSERT_NOT_NULL(stream);
+    submit_seq(stream, 0);
+    io_stream_finish(stream);
+    io_stream_destroy(stream);
+    TEST_ASSERT_EQUAL(0, state.done_rc);
+    TEST_ASSERT_EQUAL(1, state.chunks_seen);
+
+    io_pool_destroy(pool);
+}
+
+void test_destroy_unfinished_stream(void) {
+    struct io_pool *pool = io_pool_create(2);
+    TEST_ASSERT_NOT_NULL(pool);
+
+    struct stream_state state;
+    memset(&state, 0, sizeof(state));
+    state.fail_at = -1;
+    struct io_stream *stream = io_stream_create(pool, process_chunk, stream_done, &state);
+    TEST_ASSERT_NOT_NULL(stream);
+
+    // Destroy waits for queued chunks even if the stream is never finished
+    for (uint32_t seq = 0; seq < 50; seq++) {
+        submit_seq(stream, seq);
+    }
+    io_stream_destroy(stream);
+
+    TEST_ASSERT_EQUAL(50, state.chunks_seen);
+    TEST_ASSERT_EQUAL(0, state.done_calls);
+
+    io_pool_destroy(pool);
+}
+
+void test_reopen_from_done(void) {
+    struct io_pool *pool = io_pool_create(2);
+    TEST_ASSERT_NOT_NULL(pool);
+
+    struct stream_state state;
+    memset(&state, 0, sizeof(state));
+    state.fail_at = -1;
+    struct io_stream *stream = io_stream_create(pool, process_chunk, stream_done, &state);
+    TEST_ASSERT_NOT_NULL(stream);
+    state.reopen = stream;
+
+    for (uint32_t seq = 0; seq < 5; seq++) {
+        submit_seq(stream, seq);
+    }
+    io_stream_finish(stream);
+
+    // A retried request feeds the same stream once the first one is done
+    for (;;) {
+        pthread_mutex_lock(&state_mutex);
+        int calls = state.done_calls;
+        pthread_mutex_unlock(&state_mutex);
+        if (calls == 1) {
+            break;
+        }
+        sched_yield();
+    }
+    TEST_ASSERT_EQUAL(5, state.chunks_at_done);
+
+    for (uint32_t seq = 5; seq < 10; seq++) {
+        submit_seq(stream, seq);
+    }
+    io_stream_finish(stream);
+    io_stream_destroy(stream);
+
+    TEST_ASSERT_FALSE(state.out_of_order);
+    TEST_ASSERT_EQUAL(10, state.chunks_seen);
+    TEST_ASSERT_EQUAL(2, state.done_calls);
+    TEST_ASSERT_EQUAL(0, state.done_rc);
+    TEST_ASSERT_EQUAL(10, state.chunks_at_done);
+
+    io_pool_destroy(pool);
+}
+
+static int slow_chunk(void *ctx, const uint8_t *data, size_t len) {
+    (void)ctx;
+    (void)data;
+    (void)len;
+    usleep(2000);
+    return 0;
+}
+
+void test_stats_count_queued_bytes_and_busy_time(void) {
+    struct io_pool *pool = io_pool_create(1);
+    TEST_ASSERT_NOT_NULL(pool);
+
+    struct stream_state state;
+    memset(&state, 0, sizeof(state));
+    struct io_stream *stream = io_stream_create(pool, slow_chunk, stream_done, &state);
+    TEST_ASSERT_NOT_NULL(stream);
+
+    // Chunks count as queued until processed, and the worker is busy for each
+    for (uint32_t seq = 0; seq < 10; seq++) {
+        submit_seq(stream, seq);
+    }
+    struct io_pool_stats stats;
+    io_pool_get_stats(pool, &stats);
+    TEST_ASSERT_EQUAL(1, stats.num_threads);
+    TEST_ASSERT_TRUE(stats.queued_bytes > 0);
+    TEST_ASSERT_TRUE(stats.queued_bytes <= 10 * sizeof(uint32_t));
+
+    io_stream_finish(stream);
+    io_stream_destroy(stream);
+
+    io_pool_get_stats(pool, &stats);
+    TEST_ASSERT_EQUAL_UINT64(0, stats.queued_bytes);
+    TEST_ASSERT_TRUE(stats.busy_ns >= 10 * 2000000ULL);
+
+    io_pool_destroy(pool);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_create_rejects_zero_threads);
+    RUN_TEST(test_chunks_processed_in_order_per_stream);
+    RUN_TEST(test_error_drops_later_chunks);
+    RUN_TEST(test_submit_fails_after_error);
+    RUN_TEST(test_destroy_unfinished_stream);
+    RUN_TEST(test_reopen_from_done);
+    RUN_TEST(test_stats_count_queued_bytes_and_busy_time);
+    return UNITY_END();
+}
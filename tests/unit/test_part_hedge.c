@@ -0,0 +1,284 @@
+/*
+ * Unit tests for hedged part requests, using the local file source.
+ */
+
+#include "unity.h"
+#include "test_helpers.h"
+#include "part_hedge.h"
+#include "part_prefetch.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define PART_SIZE (1024 * 1024)
+#define WINDOW (256 * 1024)
+
+static char test_file[256];
+static uint8_t expected[PART_SIZE];
+
+void setUp(void) {
+    snprintf(test_file, sizeof(test_file), "/tmp/burst_hedge_test_%d.zip", getpid());
+    for (size_t i = 0; i < PART_SIZE; i++) {
+        expected[i] = (uint8_t)(i * 7 + (i >> 11));
+    }
+    FILE *f = fopen(test_file, "wb");
+    TEST_ASSERT_NOT_NULL(f);
+    TEST_ASSERT_EQUAL(PART_SIZE, fwrite(expected, 1, PART_SIZE, f));
+    fclose(f);
+}
+
+void tearDown(void) {
+    unlink(test_file);
+}
+
+// The caller's side of a hedged request. While hold is set it stops
+// reopening the window, like a part whose connection has stalled.
+struct collector {
+    struct collector_sync sync;
+    bool hold;
+    size_t held;
+    int error_code;
+    uint8_t data[PART_SIZE];
+    size_t len;
+    size_t headers_calls;
+    size_t finish_calls;
+};
+
+static void collector_init(struct collector *c) {
+    memset(c, 0, sizeof(*c));
+    collector_sync_init(&c->sync);
+}
+
+static void collector_free(struct collector *c) {
+    collector_sync_destroy(&c->sync);
+}
+
+static int on_headers(const struct source_response *response, void *user_data) {
+    (void)response;
+    struct collector *c = user_data;
+    c->headers_calls++;
+    return 0;
+}
+
+static int on_body(struct source_request *request, const uint8_t *data, size_t len, void *user_data) {
+    struct collector *c = user_data;
+    pthread_mutex_lock(&c->sync.mutex);
+    if (c->len + len > sizeof(c->data)) {
+        pthread_mutex_unlock(&c->sync.mutex);
+        return -1;  // A byte delivered twice
+    }
+    memcpy(c->data + c->len, data, len);
+    c->len += len;
+    bool hold = c->hold;
+    if (hold) {
+        c->held += len;
+    }
+    pthread_cond_broadcast(&c->sync.cv);
+    pthread_mutex_unlock(&c->sync.mutex);
+
+    if (!hold) {
+        source_request_open_window(request, len);
+    }
+    return 0;
+}
+
+static void on_finish(int error_code, int response_status, void *user_data) {
+    (void)response_status;
+    struct collector *c = user_data;
+    pthread_mutex_lock(&c->sync.mutex);
+    c->error_code = error_code;
+    c->sync.finished = true;
+    c->finish_calls++;
+    pthread_cond_broadcast(&c->sync.cv);
+    pthread_mutex_unlock(&c->sync.mutex);
+}
+
+static void wait_len(struct collector *c, size_t len) {
+    pthread_mutex_lock(&c->sync.mutex);
+    while (c->len < len) {
+        pthread_cond_wait(&c->sync.cv, &c->sync.mutex);
+    }
+    pthread_mutex_unlock(&c->sync.mutex);
+}
+
+// Let the caller's held window go
+static void release_hold(struct collector *c, struct source_request *request) {
+    pthread_mutex_lock(&c->sync.mutex);
+    c->hold = false;
+    size_t held = c->held;
+    c->held = 0;
+    pthread_mutex_unlock(&c->sync.mutex);
+    source_request_open_window(request, held);
+}
+
+static struct source_request_options part_options(struct collector *c) {
+    struct source_request_options options = {
+        .start = 0,
+        .end = PART_SIZE - 1,
+        .headers = on_headers,
+        .body = on_body,
+        .finish = on_finish,
+        .user_data = c,
+    };
+    return options;
+}
+
+static void assert_single_response(struct collector *c) {
+    TEST_ASSERT_EQUAL(0, c->error_code);
+    TEST_ASSERT_EQUAL(1, c->headers_calls);
+    TEST_ASSERT_EQUAL(1, c->finish_calls);
+    TEST_ASSERT_EQUAL_size_t(PART_SIZE, c->len);
+    TEST_ASSERT_EQUAL_MEMORY(expected, c->data, c->len);
+}
+
+void test_unhedged_request(void) {
+    struct archive_source *source = archive_source_new_file(test_file, WINDOW);
+    TEST_ASSERT_NOT_NULL(source);
+
+    struct collector c;
+    collector_init(&c);
+    struct source_request_options options = part_options(&c);
+    struct source_request *request = hedged_request_start(source, NULL, &options);
+    TEST_ASSERT_NOT_NULL(request);
+    wait_finished(&c.sync);
+
+    assert_single_response(&c);
+    TEST_ASSERT_EQUAL_UINT64(PART_SIZE, hedged_request_progress(request));
+
+    // Nothing left to hedge
+    TEST_ASSERT_EQUAL(-1, hedged_request_hedge(request));
+    source_request_release(request);
+
+    collector_free(&c);
+    archive_source_destroy(source);
+}
+
+void test_duplicate_takes_over_stalled_request(void) {
+    struct archive_source *source = archive_source_new_file(test_file, WINDOW);
+    TEST_ASSERT_NOT_NULL(source);
+
+    // The original delivers one window and stalls
+    struct collector c;
+    collector_init(&c);
+    c.hold = true;
+    struct source_request_options options = part_options(&c);
+    struct source_request *request = hedged_request_start(source, NULL, &options);
+    TEST_ASSERT_NOT_NULL(request);
+    wait_len(&c, WINDOW);
+    TEST_ASSERT_EQUAL_UINT64(WINDOW, hedged_request_progress(request));
+
+    // The duplicate's first bytes are past the original's, so it takes over
+    TEST_ASSERT_EQUAL(0, hedged_request_hedge(request));
+    TEST_ASSERT_EQUAL(-1, hedged_request_hedge(request));
+    wait_len(&c, WINDOW + 1);
+
+    // The window held for the original is not passed to the duplicate
+    release_hold(&c, request);
+    wait_finished(&c.sync);
+    source_request_release(request);
+
+    assert_single_response(&c);
+    collector_free(&c);
+    archive_source_destroy(source);
+}
+
+void test_racing_requests_deliver_once(void) {
+    struct archive_source *source = archive_source_new_file(test_file, WINDOW);
+    TEST_ASSERT_NOT_NULL(source);
+
+    // Whichever finishes first, the caller sees every byte once, in order
+    for (int i = 0; i < 20; i++) {
+        struct collector c;
+        collector_init(&c);
+        struct source_request_options options = part_options(&c);
+        struct source_request *request = hedged_request_start(source, NULL, &options);
+        TEST_ASSERT_NOT_NULL(request);
+        hedged_request_hedge(request);
+        wait_finished(&c.sync);
+        source_request_release(request);
+
+        assert_single_response(&c);
+        collector_free(&c);
+    }
+
+    archive_source_destroy(source);
+}
+
+void test_cancel_hedged_request(void) {
+    struct archive_source *source = archive_source_new_file(test_file, WINDOW);
+    TEST_ASSERT_NOT_NULL(source);
+
+    struct collector c;
+    collector_init(&c);
+    c.hold = true;
+    struct source_request_options options = part_options(&c);
+    struct source_request *request = hedged_request_start(source, NULL, &options);
+    TEST_ASSERT_NOT_NULL(request);
+    wait_len(&c, WINDOW);
+    TEST_ASSERT_EQUAL(0, hedged_request_hedge(request));
+
+    // Both legs stop; finish() is passed on once
+    source_request_cancel(request);
+    wait_finished(&c.sync);
+    usleep(20000);
+    TEST_ASSERT_NOT_EQUAL(0, c.error_code);
+    TEST_ASSERT_EQUAL(1, c.finish_calls);
+    TEST_ASSERT_EQUAL(-1, hedged_request_hedge(request));
+    source_request_release(request);
+
+    collector_free(&c);
+    archive_source_destroy(source);
+}
+
+void test_adopts_prefetch(void) {
+    struct archive_source *source = archive_source_new_file(test_file, WINDOW);
+    TEST_ASSERT_NOT_NULL(source);
+    struct part_prefetch *prefetch = part_prefetch_start(source, PART_SIZE, 1);
+    TEST_ASSERT_NOT_NULL(prefetch);
+    usleep(20000);
+
+    struct collector c;
+    collector_init(&c);
+    struct source_request_options options = part_options(&c);
+    struct source_request *request = hedged_request_start(source, prefetch, &options);
+    TEST_ASSERT_NOT_NULL(request);
+    wait_finished(&c.sync);
+    source_request_release(request);
+    assert_single_response(&c);
+
+    collector_free(&c);
+    part_prefetch_destroy(prefetch);
+    archive_source_destroy(source);
+}
+
+void test_straggler_policy(void) {
+    double rates[] = {40.0e6, 10.0e6, 30.0e6, 20.0e6};
+    TEST_ASSERT_TRUE(part_hedge_median_rate(rates, 4) == 25.0e6);
+    TEST_ASSERT_TRUE(part_hedge_median_rate(rates, 3) == 20.0e6);
+    TEST_ASSERT_TRUE(part_hedge_median_rate(rates, PART_HEDGE_MIN_SAMPLES - 1) == 0.0);
+
+    uint64_t elapsed = PART_HEDGE_MIN_ELAPSED_NS;
+    double median = 20.0e6 * PART_HEDGE_SLOWDOWN * 2;
+
+    // 20 MB/s against a median eight times faster
+    TEST_ASSERT_TRUE(part_hedge_is_straggler(40000000, elapsed, median));
+    TEST_ASSERT_TRUE(part_hedge_is_straggler(0, elapsed, median));
+
+    // Too early to tell, within the slowdown, or nothing to compare against
+    TEST_ASSERT_FALSE(part_hedge_is_straggler(0, elapsed - 1, median));
+    TEST_ASSERT_FALSE(part_hedge_is_straggler(200000000, elapsed, median));
+    TEST_ASSERT_FALSE(part_hedge_is_straggler(0, elapsed, 0.0));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_unhedged_request);
+    RUN_TEST(test_duplicate_takes_over_stalled_request);
+    RUN_TEST(test_racing_requests_deliver_once);
+    RUN_TEST(test_cancel_hedged_request);
+    RUN_TEST(test_adopts_prefetch);
+    RUN_TEST(test_straggler_policy);
+    return UNITY_END();
+}
@@ -0,0 +1,267 @@
+/*
+ * Unit tests for part prefetch and adoption, using the local file source.
+ */
+
+#include "unity.h"
+#include "test_helpers.h"
+#include "part_prefetch.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define PART_SIZE (64 * 1024)
+#define FILE_SIZE (2 * PART_SIZE + 1000)
+
+static char test_file[256];
+static uint8_t expected[FILE_SIZE];
+
+void setUp(void) {
+    snprintf(test_file, sizeof(test_file), "/tmp/burst_prefetch_test_%d.zip", getpid());
+    for (size_t i = 0; i < FILE_SIZE; i++) {
+        expected[i] = (uint8_t)(i * 13 + (i >> 9));
+    }
+    FILE *f = fopen(test_file, "wb");
+    TEST_ASSERT_NOT_NULL(f);
+    TEST_ASSERT_EQUAL(FILE_SIZE, fwrite(expected, 1, FILE_SIZE, f));
+    fclose(f);
+}
+
+void tearDown(void) {
+    unlink(test_file);
+}
+
+// The adopter's side of a part request
+struct collector {
+    struct collector_sync sync;
+    int error_code;
+    int headers_status;
+    char etag[128];
+    uint8_t data[PART_SIZE];
+    size_t len;
+    size_t headers_calls;
+    size_t finish_calls;
+};
+
+static void collector_init(struct collector *c) {
+    memset(c, 0, sizeof(*c));
+    collector_sync_init(&c->sync);
+}
+
+static void collector_free(struct collector *c) {
+    collector_sync_destroy(&c->sync);
+}
+
+static int on_headers(const struct source_response *response, void *user_data) {
+    struct collector *c = user_data;
+    c->headers_status = response->status;
+    snprintf(c->etag, sizeof(c->etag), "%s", response->etag ? response->etag : "");
+    c->headers_calls++;
+    return 0;
+}
+
+static int on_body(struct source_request *request, const uint8_t *data, size_t len, void *user_data) {
+    struct collector *c = user_data;
+    if (c->len + len > sizeof(c->data)) {
+        return -1;  // More than the part asked for
+    }
+    memcpy(c->data + c->len, data, len);
+    c->len += len;
+    source_request_open_window(request, len);
+    return 0;
+}
+
+static void on_finish(int error_code, int response_status, void *user_data) {
+    (void)response_status;
+    struct collector *c = user_data;
+    pthread_mutex_lock(&c->sync.mutex);
+    c->error_code = error_code;
+    c->sync.finished = true;
+    c->finish_calls++;
+    pthread_cond_broadcast(&c->sync.cv);
+    pthread_mutex_unlock(&c->sync.mutex);
+}
+
+static struct source_request_options part_options(uint32_t part, const char *if_match,
+                                                  struct collector *c) {
+    struct source_request_options options = {
+        .start = (uint64_t)part * PART_SIZE,
+        .end = (uint64_t)part * PART_SIZE + PART_SIZE - 1,
+        .if_match = if_match,
+        .headers = on_headers,
+        .body = on_body,
+        .finish = on_finish,
+        .user_data = c,
+    };
+    return options;
+}
+
+void test_adopt_after_prefetch_finished(void) {
+    struct archive_source *source = archive_source_new_file(test_file, 1024 * 1024);
+    TEST_ASSERT_NOT_NULL(source);
+    struct part_prefetch *prefetch = part_prefetch_start(source, PART_SIZE, 2);
+    TEST_ASSERT_NOT_NULL(prefetch);
+    usleep(50000);  // Both parts are buffered and finished
+
+    for (uint32_t part = 0; part < 2; part++) {
+        struct collector c;
+        collector_init(&c);
+        struct source_request_options options = part_options(part, NULL, &c);
+        struct source_request *request = part_prefetch_adopt(prefetch, &options);
+        TEST_ASSERT_NOT_NULL(request);
+        wait_finished(&c.sync);
+        source_request_release(request);
+
+        TEST_ASSERT_EQUAL(0, c.error_code);
+        TEST_ASSERT_EQUAL(206, c.headers_status);
+        TEST_ASSERT_EQUAL(1, c.headers_calls);
+        TEST_ASSERT_EQUAL(1, c.finish_calls);
+        TEST_ASSERT_EQUAL_size_t(PART_SIZE, c.len);
+        TEST_ASSERT_EQUAL_MEMORY(expected + part * PART_SIZE, c.data, c.len);
+
+        // Adopted once only
+        TEST_ASSERT_NULL(part_prefetch_adopt(prefetch, &options));
+        collector_free(&c);
+    }
+
+    part_prefetch_destroy(prefetch);
+    archive_source_destroy(source);
+}
+
+void test_adopt_stalled_prefetch(void) {
+    // The window is smaller than a part, so the prefetch buffers 4096 bytes and stalls
+    struct archive_source *source = archive_source_new_file(test_file, 4096);
+    TEST_ASSERT_NOT_NULL(source);
+    struct part_prefetch *prefetch = part_prefetch_start(source, PART_SIZE, 1);
+    TEST_ASSERT_NOT_NULL(prefetch);
+    usleep(20000);
+
+    struct collector c;
+    collector_init(&c);
+    struct source_request_options options = part_options(0, NULL, &c);
+    struct source_request *request = part_prefetch_adopt(prefetch, &options);
+    TEST_ASSERT_NOT_NULL(request);
+    wait_finished(&c.sync);
+    source_request_release(request);
+
+    // Replayed data and the rest arrive in order, through the adopter's window
+    TEST_ASSERT_EQUAL(0, c.error_code);
+    TEST_ASSERT_EQUAL(1, c.headers_calls);
+    TEST_ASSERT_EQUAL_size_t(PART_SIZE, c.len);
+    TEST_ASSERT_EQUAL_MEMORY(expected, c.data, c.len);
+
+    collector_free(&c);
+    part_prefetch_destroy(prefetch);
+    archive_source_destroy(source);
+}
+
+void test_adopt_checks_range_and_etag(void) {
+    struct archive_source *source = archive_source_new_file(test_file, 1024 * 1024);
+    TEST_ASSERT_NOT_NULL(source);
+    struct part_prefetch *prefetch = part_prefetch_start(source, PART_SIZE, 2);
+    TEST_ASSERT_NOT_NULL(prefetch);
+    usleep(50000);
+
+    struct collector c;
+    collector_init(&c);
+
+    // Only whole prefetched parts
+    struct source_request_options options = part_options(0, NULL, &c);
+    options.start = 100;
+    TEST_ASSERT_NULL(part_prefetch_adopt(prefetch, &options));
+    options = part_options(0, NULL, &c);
+    options.end = PART_SIZE * 2 - 1;
+    TEST_ASSERT_NULL(part_prefetch_adopt(prefetch, &options));
+    options = part_options(2, NULL, &c);
+    TEST_ASSERT_NULL(part_prefetch_adopt(prefetch, &options));
+
+    // Another archive's ETag: the prefetch is dropped, not replayed
+    options = part_options(0, "\"some-other-archive\"", &c);
+    TEST_ASSERT_NULL(part_prefetch_adopt(prefetch, &options));
+    options = part_options(0, NULL, &c);
+    TEST_ASSERT_NULL(part_prefetch_adopt(prefetch, &options));
+    TEST_ASSERT_EQUAL(0, c.headers_calls);
+    TEST_ASSERT_EQUAL_size_t(0, c.len);
+    TEST_ASSERT_EQUAL(0, c.finish_calls);
+
+    // Discarded parts are not adopted
+    part_prefetch_discard_from(prefetch, PART_SIZE);
+    options = part_options(1, NULL, &c);
+    TEST_ASSERT_NULL(part_prefetch_adopt(prefetch, &options));
+
+    TEST_ASSERT_NULL(part_prefetch_adopt(NULL, &options));
+
+    collector_free(&c);
+    part_prefetch_destroy(prefetch);
+    archive_source_destroy(source);
+}
+
+void test_adopt_with_matching_etag(void) {
+    struct archive_source *source = archive_source_new_file(test_file, 1024 * 1024);
+    TEST_ASSERT_NOT_NULL(source);
+    struct part_prefetch *prefetch = part_prefetch_start(source, PART_SIZE, 1);
+    TEST_ASSERT_NOT_NULL(prefetch);
+
+    // The ETag, as the tail fetch would see it
+    struct collector e;
+    collector_init(&e);
+    struct source_request_options etag_options = {
+        .suffix_length = 1,
+        .headers = on_headers,
+        .finish = on_finish,
+        .user_data = &e,
+    };
+    struct source_request *request = archive_source_request(source, &etag_options);
+    TEST_ASSERT_NOT_NULL(request);
+    wait_finished(&e.sync);
+    source_request_release(request);
+    TEST_ASSERT_TRUE(strlen(e.etag) > 2);
+
+    struct collector c;
+    collector_init(&c);
+    struct source_request_options options = part_options(0, e.etag, &c);
+    request = part_prefetch_adopt(prefetch, &options);
+    TEST_ASSERT_NOT_NULL(request);
+    wait_finished(&c.sync);
+    source_request_release(request);
+    TEST_ASSERT_EQUAL(0, c.error_code);
+    TEST_ASSERT_EQUAL_size_t(PART_SIZE, c.len);
+
+    collector_free(&c);
+    collector_free(&e);
+    part_prefetch_destroy(prefetch);
+    archive_source_destroy(source);
+}
+
+void test_parts_past_end_and_unadopted(void) {
+    // Parts 0-3 of a three-part archive, all with a small window: nothing is
+    // adopted, so destroy() has stalled requests to cancel
+    struct archive_source *source = archive_source_new_file(test_file, 4096);
+    TEST_ASSERT_NOT_NULL(source);
+    struct part_prefetch *prefetch = part_prefetch_start(source, PART_SIZE, 4);
+    TEST_ASSERT_NOT_NULL(prefetch);
+    usleep(20000);
+
+    // Part 3 starts past the end (416)
+    struct collector c;
+    collector_init(&c);
+    struct source_request_options options = part_options(3, NULL, &c);
+    TEST_ASSERT_NULL(part_prefetch_adopt(prefetch, &options));
+    TEST_ASSERT_EQUAL(0, c.headers_calls);
+
+    collector_free(&c);
+    part_prefetch_destroy(prefetch);
+    part_prefetch_destroy(NULL);
+    archive_source_destroy(source);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_adopt_after_prefetch_finished);
+    RUN_TEST(test_adopt_stalled_prefetch);
+    RUN_TEST(test_adopt_checks_range_and_etag);
+    RUN_TEST(test_adopt_with_matching_etag);
+    RUN_TEST(test_parts_past_end_and_unadopted);
+    return UNITY_END();
+}
@@ -0,0 +1,159 @@
+/*
+ * Unit tests for the part dispatch order.
+ */
+
+#include "unity.h"
+#include "part_schedule.h"
+#include <string.h>
+
+#define MiB (1024 * 1024)
+#define PART_SIZE (8 * MiB)
+#define NUM_PARTS 8
+
+static struct file_metadata files[16];
+static struct part_files parts[NUM_PARTS];
+static struct central_dir_parse_result cd;
+
+void setUp(void) {
+    memset(files, 0, sizeof(files));
+    memset(parts, 0, sizeof(parts));
+    memset(&cd, 0, sizeof(cd));
+    cd.files = files;
+    cd.parts = parts;
+    cd.num_parts = NUM_PARTS;
+}
+
+void tearDown(void) {
+}
+
+static struct file_metadata *add_file(uint64_t offset, uint64_t compressed, uint64_t uncompressed) {
+    struct file_metadata *file = &files[cd.num_files++];
+    file->local_header_offset = offset;
+    file->compressed_size = compressed;
+    file->uncompressed_size = uncompressed;
+    file->part_index = (uint32_t)(offset / PART_SIZE);
+    parts[file->part_index].num_entries++;
+    return file;
+}
+
+// A part of num_entries entries, writing bytes (all from its first entry)
+static void set_cost(uint32_t part, size_t num_entries, uint64_t bytes) {
+    if (bytes > 0) {
+        add_file((uint64_t)part * PART_SIZE, MiB, bytes);
+    }
+    parts[part].num_entries = num_entries;
+}
+
+static void order_all(uint32_t *order, size_t prefetched) {
+    for (uint32_t p = 0; p < NUM_PARTS; p++) {
+        order[p] = p;
+    }
+    part_schedule_order(&cd, PART_SIZE, order, NUM_PARTS, prefetched);
+}
+
+void test_costs_spread_spanning_file(void) {
+    struct part_cost costs[NUM_PARTS];
+
+    // Half in part 0, all of part 1, a quarter of part 2
+    add_file(4 * MiB, 14 * MiB, 28 * MiB);
+    add_file(10 * MiB, 2 * MiB, 6 * MiB)->hardlink_target = "a";
+    add_file(11 * MiB, 1 * MiB, 5 * MiB)->data_omitted = true;
+    add_file(12 * MiB, 1 * MiB, 5 * MiB)->is_symlink = true;
+    add_file(20 * MiB, 0, 0);
+    part_schedule_costs(&cd, PART_SIZE, costs);
+
+    TEST_ASSERT_EQUAL_UINT64(1, costs[0].entries);
+    TEST_ASSERT_EQUAL_UINT64(8 * MiB, costs[0].bytes);
+    TEST_ASSERT_EQUAL_UINT64(3, costs[1].entries);
+    TEST_ASSERT_EQUAL_UINT64(16 * MiB, costs[1].bytes);
+    TEST_ASSERT_EQUAL_UINT64(1, costs[2].entries);
+    TEST_ASSERT_EQUAL_UINT64(4 * MiB, costs[2].bytes);
+    TEST_ASSERT_EQUAL_UINT64(0, costs[3].bytes);
+
+    TEST_ASSERT_FALSE(part_cost_inode_heavy(&costs[0]));
+    struct part_cost small_files = { .entries = 8000, .bytes = 8 * MiB };
+    TEST_ASSERT_TRUE(part_cost_inode_heavy(&small_files));
+    TEST_ASSERT_TRUE(part_cost_seconds(&small_files) > part_cost_seconds(&costs[0]));
+}
+
+void test_costs_skip_cloned_copies(void) {
+    struct part_cost costs[NUM_PARTS];
+
+    // The copy in part 1 is cloned from the file in part 0 after the restore
+    struct file_metadata *source = add_file(0, MiB, 4 * MiB);
+    add_file(9 * MiB, MiB, 4 * MiB)->dedup_source = source;
+    part_schedule_costs(&cd, PART_SIZE, costs);
+
+    TEST_ASSERT_EQUAL_UINT64(4 * MiB, costs[0].bytes);
+    TEST_ASSERT_EQUAL_UINT64(1, costs[1].entries);
+    TEST_ASSERT_EQUAL_UINT64(0, costs[1].bytes);
+}
+
+void test_order_interleaves_most_expensive_first(void) {
+    uint32_t order[NUM_PARTS];
+
+    // Inode-heavy parts 1, 3, 5, 7 and byte-heavy 0, 2, 4, 6, of rising cost
+    for (uint32_t p = 0; p < NUM_PARTS; p++) {
+        if (p % 2) {
+            set_cost(p, 1000 * (p + 1), 0);
+        } else {
+            set_cost(p, 1, 10ULL * MiB * (p + 1));
+        }
+    }
+    order_all(order, 0);
+
+    uint32_t expected[NUM_PARTS] = {7, 6, 5, 4, 3, 2, 1, 0};
+    TEST_ASSERT_EQUAL_UINT32_ARRAY(expected, order, NUM_PARTS);
+}
+
+void test_order_in_proportion_to_cost(void) {
+    uint32_t order[NUM_PARTS];
+
+    // Two inode-heavy parts, 0.8 s and 0.4 s, against five byte-heavy ones
+    // of 0.2 s each, and part 7 with nothing to restore
+    set_cost(0, 40000, 0);
+    set_cost(1, 20000, 0);
+    for (uint32_t p = 2; p < NUM_PARTS - 1; p++) {
+        set_cost(p, 0, 200ULL * MiB);
+    }
+    order_all(order, 0);
+
+    // Part 1 waits until as large a share of the byte-heavy parts has started
+    uint32_t expected[NUM_PARTS] = {0, 2, 3, 4, 5, 1, 6, 7};
+    TEST_ASSERT_EQUAL_UINT32_ARRAY(expected, order, NUM_PARTS);
+}
+
+void test_order_keeps_prefetched_parts_first(void) {
+    uint32_t order[NUM_PARTS];
+
+    for (uint32_t p = 0; p < NUM_PARTS; p++) {
+        set_cost(p, 0, (uint64_t)MiB * (p + 1));
+    }
+    order_all(order, 3);
+
+    uint32_t expected[NUM_PARTS] = {0, 1, 2, 7, 6, 5, 4, 3};
+    TEST_ASSERT_EQUAL_UINT32_ARRAY(expected, order, NUM_PARTS);
+}
+
+void test_order_subset(void) {
+    uint32_t order[] = {1, 4, 6};
+
+    set_cost(1, 0, MiB);
+    set_cost(4, 0, 3 * MiB);
+    set_cost(6, 0, 2 * MiB);
+    part_schedule_order(&cd, PART_SIZE, order, 3, 0);
+
+    uint32_t expected[] = {4, 6, 1};
+    TEST_ASSERT_EQUAL_UINT32_ARRAY(expected, order, 3);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_costs_spread_spanning_file);
+    RUN_TEST(test_costs_skip_cloned_copies);
+    RUN_TEST(test_order_interleaves_most_expensive_first);
+    RUN_TEST(test_order_in_proportion_to_cost);
+    RUN_TEST(test_order_keeps_prefetched_parts_first);
+    RUN_TEST(test_order_subset);
+    return UNITY_END();
+}
@@ -22,6 +22,15 @@ extern void calculate_parts_to_download(
     bool *process_final_from_buffer
 );
 
+extern uint64_t calculate_read_window(
+    uint64_t memory_limit,
+    size_t max_concurrent_parts,
+    uint64_t part_size
+);
+
+extern uint64_t calculate_retry_delay_ms(uint32_t attempt, uint32_t random);
+extern bool part_failure_is_transient(int response_status);
+
 void setUp(void) {
     // Nothing to set up
 }
@@ -227,6 +236,70 @@ void test_final_part_exactly_at_boundary(void) {
     TEST_ASSERT_TRUE(process_final_from_buffer);
 }
 
+// =============================================================================
+// Test Cases: read window for a memory limit
+// =============================================================================
+
+// No limit -> one whole part per concurrent part
+void test_read_window_default(void) {
+    TEST_ASSERT_EQUAL_UINT64(8 * MiB, calculate_read_window(0, 8, 8 * MiB));
+    TEST_ASSERT_EQUAL_UINT64(32 * MiB, calculate_read_window(0, 8, 32 * MiB));
+}
+
+// 64 MiB across 16 parts -> 4 MiB each
+void test_read_window_split_evenly(void) {
+    TEST_ASSERT_EQUAL_UINT64(4 * MiB, calculate_read_window(64 * MiB, 16, 8 * MiB));
+}
+
+// 100 MiB across 8 parts -> 12.5 MiB, rounded down to 12 MiB
+void test_read_window_rounds_down_to_mib(void) {
+    TEST_ASSERT_EQUAL_UINT64(12 * MiB, calculate_read_window(100 * MiB, 8, 16 * MiB));
+}
+
+// A generous limit never gives a part more than its own size
+void test_read_window_capped_at_part_size(void) {
+    TEST_ASSERT_EQUAL_UINT64(8 * MiB, calculate_read_window(4096ULL * MiB, 8, 8 * MiB));
+}
+
+// Less than 1 MiB per part is rejected
+void test_read_window_too_small(void) {
+    TEST_ASSERT_EQUAL_UINT64(0, calculate_read_window(7 * MiB, 8, 8 * MiB));
+    TEST_ASSERT_EQUAL_UINT64(1 * MiB, calculate_read_window(8 * MiB, 8, 8 * MiB));
+}
+
+// =============================================================================
+// Test Cases: retry backoff
+// =============================================================================
+
+// Lowest and highest random values bound each step to its upper half
+void test_retry_delay_doubles(void) {
+    TEST_ASSERT_EQUAL_UINT64(100, calculate_retry_delay_ms(1, 0));
+    TEST_ASSERT_EQUAL_UINT64(200, calculate_retry_delay_ms(1, 100));
+    TEST_ASSERT_EQUAL_UINT64(200, calculate_retry_delay_ms(2, 0));
+    TEST_ASSERT_EQUAL_UINT64(400, calculate_retry_delay_ms(2, 200));
+    TEST_ASSERT_EQUAL_UINT64(1600, calculate_retry_delay_ms(5, 0));
+}
+
+// Later attempts stay at 20 s, including ones far past the shift width
+void test_retry_delay_capped(void) {
+    TEST_ASSERT_EQUAL_UINT64(10000, calculate_retry_delay_ms(10, 0));
+    TEST_ASSERT_EQUAL_UINT64(20000, calculate_retry_delay_ms(10, 10000));
+    TEST_ASSERT_EQUAL_UINT64(10000, calculate_retry_delay_ms(100, 0));
+    TEST_ASSERT_LESS_OR_EQUAL_UINT64(20000, calculate_retry_delay_ms(1000, 0xffffffff));
+}
+
+// Dropped connections, throttling and server errors are retried; the rest are not
+void test_transient_failures(void) {
+    TEST_ASSERT_TRUE(part_failure_is_transient(0));
+    TEST_ASSERT_TRUE(part_failure_is_transient(206));
+    TEST_ASSERT_TRUE(part_failure_is_transient(429));
+    TEST_ASSERT_TRUE(part_failure_is_transient(500));
+    TEST_ASSERT_TRUE(part_failure_is_transient(503));
+    TEST_ASSERT_FALSE(part_failure_is_transient(403));
+    TEST_ASSERT_FALSE(part_failure_is_transient(404));
+    TEST_ASSERT_FALSE(part_failure_is_transient(416));
+}
+
 // =============================================================================
 // Main
 // =============================================================================
@@ -252,5 +325,17 @@ int main(void) {
     RUN_TEST(test_zero_parts);
     RUN_TEST(test_final_part_exactly_at_boundary);
 
+    // Read window
+    RUN_TEST(test_read_window_default);
+    RUN_TEST(test_read_window_split_evenly);
+    RUN_TEST(test_read_window_rounds_down_to_mib);
+    RUN_TEST(test_read_window_capped_at_part_size);
+    RUN_TEST(test_read_window_too_small);
+
+    // Retry backoff
+    RUN_TEST(test_retry_delay_doubles);
+    RUN_TEST(test_retry_delay_capped);
+    RUN_TEST(test_transient_failures);
+
     return UNITY_END();
 }
@@ -0,0 +1,249 @@
+/*
+ * Unit tests for the cross-file prefetch pool and burst_writer_add_compressed_file.
+ */
+
+#include "unity.h"
+#include "test_helpers.h"
+#include "burst_writer.h"
+#include "zip_structures.h"
+#include "../../src/writer/prefetch_pool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <zlib.h>
+#include <zstd.h>
+
+#define NUM_TEST_FILES 5
+
+static char test_dir[] = "/tmp/burst_prefetch_test_XXXXXX";
+static char test_paths[NUM_TEST_FILES][256];
+static const size_t test_sizes[NUM_TEST_FILES] = {
+    1,
+    5000,
+    BURST_FRAME_SIZE,
+    2 * BURST_FRAME_SIZE + 17,
+    BURST_PART_SIZE - 100,
+};
+
+void setUp(void) {
+    TEST_ASSERT_NOT_NULL(mkdtemp(test_dir));
+    for (int i = 0; i < NUM_TEST_FILES; i++) {
+        snprintf(test_paths[i], sizeof(test_paths[i]), "%s/file%d", test_dir, i);
+        uint8_t *data = malloc(test_sizes[i]);
+        TEST_ASSERT_NOT_NULL(data);
+        fill_test_data(data, test_sizes[i], (uint32_t)i + 7);
+        FILE *f = fopen(test_paths[i], "wb");
+        TEST_ASSERT_NOT_NULL(f);
+        TEST_ASSERT_EQUAL(test_sizes[i], fwrite(data, 1, test_sizes[i], f));
+        fclose(f);
+        free(data);
+    }
+}
+
+void tearDown(void) {
+    for (int i = 0; i < NUM_TEST_FILES; i++) {
+        unlink(test_paths[i]);
+    }
+    rmdir(test_dir);
+    strcpy(test_dir, "/tmp/burst_prefetch_test_XXXXXX");
+}
+
+static uint8_t *read_back(FILE *out, size_t *len_out) {
+    long len = ftell(out);
+    TEST_ASSERT_TRUE(len > 0);
+    uint8_t *bytes = malloc((size_t)len);
+    TEST_ASSERT_NOT_NULL(bytes);
+    rewind(out);
+    TEST_ASSERT_EQUAL((size_t)len, fread(bytes, 1, (size_t)len, out));
+    *len_out = (size_t)len;
+    return bytes;
+}
+
+// =============================================================================
+// prefetch_pool Tests
+// =============================================================================
+
+void test_prefetch_create_invalid_args(void) {
+    TEST_ASSERT_NULL(prefetch_pool_create(0, 1024 * 1024, 3));
+    TEST_ASSERT_NULL(prefetch_pool_create(2, 0, 3));
+}
+
+void test_prefetch_compresses_file(void) {
+    struct prefetch_pool *pool = prefetch_pool_create(2, 64 * 1024 * 1024, 3);
+    TEST_ASSERT_NOT_NULL(pool);
+
+    struct prefetch_item *item = prefetch_pool_submit(pool, test_paths[3], test_sizes[3]);
+    TEST_ASSERT_NOT_NULL(item);
+    TEST_ASSERT_EQUAL(0, prefetch_pool_wait(pool, item));
+
+    struct compressed_file *cf = &item->compressed;
+    TEST_ASSERT_EQUAL(test_sizes[3], cf->uncompressed_size);
+    TEST_ASSERT_EQUAL(3, cf->num_frames);
+    TEST_ASSERT_FALSE(cf->frames[0].at_eof);
+    TEST_ASSERT_FALSE(cf->frames[1].at_eof);
+    TEST_ASSERT_TRUE(cf->frames[2].at_eof);
+    TEST_ASSERT_EQUAL(17, cf->frames[2].uncompressed_size);
+
+    // Decompressing all frames must give back the file with a matching CRC
+    uint8_t *expected = malloc(test_sizes[3]);
+    uint8_t *actual = malloc(test_sizes[3]);
+    fill_test_data(expected, test_sizes[3], 3 + 7);
+    size_t pos = 0;
+    for (size_t i = 0; i < cf->num_frames; i++) {
+        size_t n = ZSTD_decompress(actual + pos, test_sizes[3] - pos,
+                                   cf->data + cf->frames[i].offset,
+                                   cf->frames[i].compressed_size);
+        TEST_ASSERT_FALSE(ZSTD_isError(n));
+        TEST_ASSERT_EQUAL(cf->frames[i].uncompressed_size, n);
+        pos += n;
+    }
+    TEST_ASSERT_EQUAL(test_sizes[3], pos);
+    TEST_ASSERT_EQUAL_MEMORY(expected, actual, test_sizes[3]);
+    TEST_ASSERT_EQUAL_HEX32(crc32(0, expected, test_sizes[3]), cf->crc32);
+
+    free(expected);
+    free(actual);
+    prefetch_pool_release(pool, item);
+    prefetch_pool_destroy(pool);
+}
+
+void test_prefetch_missing_file_reports_error(void) {
+    struct prefetch_pool *pool = prefetch_pool_create(1, 1024 * 1024, 3);
+    TEST_ASSERT_NOT_NULL(pool);
+
+    struct prefetch_item *item = prefetch_pool_submit(pool, "/nonexistent/burst/file", 10);
+    TEST_ASSERT_NOT_NULL(item);
+    TEST_ASSERT_EQUAL(-1, prefetch_pool_wait(pool, item));
+    TEST_ASSERT_NOT_EQUAL(0, item->error);
+    TEST_ASSERT_NOT_NULL(item->error_message);
+
+    prefetch_pool_release(pool, item);
+    prefetch_pool_destroy(pool);
+}
+
+void test_prefetch_budget_limits_inflight(void) {
+    // Budget fits roughly one 128 KiB file at a time
+    struct prefetch_pool *pool = prefetch_pool_create(2, 200 * 1024, 3);
+    TEST_ASSERT_NOT_NULL(pool);
+
+    struct prefetch_item *first = prefetch_pool_submit(pool, test_paths[2], test_sizes[2]);
+    TEST_ASSERT_NOT_NULL(first);
+    TEST_ASSERT_NULL(prefetch_pool_submit(pool, test_paths[2], test_sizes[2]));
+
+    // Releasing the first item frees its reservation
+    TEST_ASSERT_EQUAL(0, prefetch_pool_wait(pool, first));
+    prefetch_pool_release(pool, first);
+
+    struct prefetch_item *second = prefetch_pool_submit(pool, test_paths[2], test_sizes[2]);
+    TEST_ASSERT_NOT_NULL(second);
+    prefetch_pool_release(pool, second);
+
+    prefetch_pool_destroy(pool);
+}
+
+void test_prefetch_admits_oversized_file_when_idle(void) {
+    struct prefetch_pool *pool = prefetch_pool_create(1, 1024, 3);
+    TEST_ASSERT_NOT_NULL(pool);
+
+    struct prefetch_item *item = prefetch_pool_submit(pool, test_paths[4], test_sizes[4]);
+    TEST_ASSERT_NOT_NULL(item);
+    TEST_ASSERT_EQUAL(0, prefetch_pool_wait(pool, item));
+    TEST_ASSERT_EQUAL(test_sizes[4], item->compressed.uncompressed_size);
+
+    prefetch_pool_release(pool, item);
+    prefetch_pool_destroy(pool);
+}
+
+// =============================================================================
+// burst_writer_add_compressed_file Tests
+// =============================================================================
+
+void test_add_compressed_file_null_args(void) {
+    FILE *out = tmpfile();
+    struct burst_writer *writer = burst_writer_create(out, 3);
+    struct compressed_file cf;
+    memset(&cf, 0, sizeof(cf));
+    uint8_t lfh_buf[128];
+    struct zip_local_header *lfh;
+    int lfh_len;
+    create_test_lfh(lfh_buf, "x", false, &lfh, &lfh_len);
+
+    TEST_ASSERT_EQUAL(-1, burst_writer_add_compressed_file(NULL, &cf, lfh, lfh_len, 0100644, 0, 0));
+    TEST_ASSERT_EQUAL(-1, burst_writer_add_compressed_file(writer, NULL, lfh, lfh_len, 0100644, 0, 0));
+    TEST_ASSERT_EQUAL(-1, burst_writer_add_compressed_file(writer, &cf, NULL, lfh_len, 0100644, 0, 0));
+
+    burst_writer_destroy(writer);
+    fclose(out);
+}
+
+// Files laid out from prefetched frames must be byte-identical to files
+// read and compressed by burst_writer_add_file.
+void test_prefetched_archive_identical_to_serial(void) {
+    FILE *serial_out = tmpfile();
+    FILE *prefetch_out = tmpfile();
+    struct burst_writer *serial = burst_writer_create(serial_out, 3);
+    struct burst_writer *prefetched = burst_writer_create(prefetch_out, 3);
+    struct prefetch_pool *pool = prefetch_pool_create(3, 64 * 1024 * 1024, 3);
+    TEST_ASSERT_NOT_NULL(serial);
+    TEST_ASSERT_NOT_NULL(prefetched);
+    TEST_ASSERT_NOT_NULL(pool);
+
+    struct prefetch_item *items[NUM_TEST_FILES];
+    for (int i = 0; i < NUM_TEST_FILES; i++) {
+        items[i] = prefetch_pool_submit(pool, test_paths[i], test_sizes[i]);
+        TEST_ASSERT_NOT_NULL(items[i]);
+    }
+
+    for (int i = 0; i < NUM_TEST_FILES; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "file%d", i);
+        uint8_t lfh_buf[128];
+        struct zip_local_header *lfh;
+        int lfh_len;
+        create_test_lfh(lfh_buf, name, false, &lfh, &lfh_len);
+
+        FILE *in = fopen(test_paths[i], "rb");
+        TEST_ASSERT_NOT_NULL(in);
+        TEST_ASSERT_EQUAL(0, burst_writer_add_file(serial, in, lfh, lfh_len, false,
+                                                   0100644, 0, 0));
+        fclose(in);
+
+        TEST_ASSERT_EQUAL(0, prefetch_pool_wait(pool, items[i]));
+        TEST_ASSERT_EQUAL(0, burst_writer_add_compressed_file(prefetched, &items[i]->compressed,
+                                                              lfh, lfh_len, 0100644, 0, 0));
+        prefetch_pool_release(pool, items[i]);
+    }
+
+    TEST_ASSERT_EQUAL(0, burst_writer_finalize(serial));
+    TEST_ASSERT_EQUAL(0, burst_writer_finalize(prefetched));
+    TEST_ASSERT_EQUAL(serial->num_files, prefetched->num_files);
+
+    size_t serial_len, prefetch_len;
+    uint8_t *serial_bytes = read_back(serial_out, &serial_len);
+    uint8_t *prefetch_bytes = read_back(prefetch_out, &prefetch_len);
+    TEST_ASSERT_EQUAL(serial_len, prefetch_len);
+    TEST_ASSERT_EQUAL_MEMORY(serial_bytes, prefetch_bytes, serial_len);
+
+    free(serial_bytes);
+    free(prefetch_bytes);
+    prefetch_pool_destroy(pool);
+    burst_writer_destroy(serial);
+    burst_writer_destroy(prefetched);
+    fclose(serial_out);
+    fclose(prefetch_out);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_prefetch_create_invalid_args);
+    RUN_TEST(test_prefetch_compresses_file);
+    RUN_TEST(test_prefetch_missing_file_reports_error);
+    RUN_TEST(test_prefetch_budget_limits_inflight);
+    RUN_TEST(test_prefetch_admits_oversized_file_when_idle);
+    RUN_TEST(test_add_compressed_file_null_args);
+    RUN_TEST(test_prefetched_archive_identical_to_serial);
+
+    return UNITY_END();
+}
@@ -0,0 +1,145 @@
+/*
+ * Unit tests for the downloader's restore journal.
+ */
+
+#include "unity.h"
+#include "restore_journal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define ETAG "\"3858f62230ac3c915f300c664312c11f-12\""
+#define ARCHIVE_SIZE 100000000ULL
+#define NUM_PARTS 12
+
+static char test_output_dir[256];
+static char journal_path[512];
+
+void setUp(void) {
+    snprintf(test_output_dir, sizeof(test_output_dir), "/tmp/burst_journal_test_%d", getpid());
+    mkdir(test_output_dir, 0755);
+    snprintf(journal_path, sizeof(journal_path), "%s/%s", test_output_dir, RESTORE_JOURNAL_NAME);
+}
+
+void tearDown(void) {
+    char cmd[512];
+    snprintf(cmd, sizeof(cmd), "rm -rf %s", test_output_dir);
+    system(cmd);
+}
+
+static void append_to_journal(const char *text) {
+    FILE *f = fopen(journal_path, "a");
+    TEST_ASSERT_NOT_NULL(f);
+    fputs(text, f);
+    fclose(f);
+}
+
+void test_new_journal_is_empty(void) {
+    struct restore_journal *journal =
+        restore_journal_open(test_output_dir, ETAG, ARCHIVE_SIZE, NUM_PARTS);
+    TEST_ASSERT_NOT_NULL(journal);
+    TEST_ASSERT_EQUAL_size_t(0, restore_journal_resumed_parts(journal));
+    for (uint32_t p = 0; p < NUM_PARTS; p++) {
+        TEST_ASSERT_FALSE(restore_journal_has_part(journal, p));
+    }
+    restore_journal_close(journal);
+    TEST_ASSERT_EQUAL(0, access(journal_path, F_OK));
+}
+
+void test_parts_survive_reopen(void) {
+    struct restore_journal *journal =
+        restore_journal_open(test_output_dir, ETAG, ARCHIVE_SIZE, NUM_PARTS);
+    TEST_ASSERT_NOT_NULL(journal);
+    TEST_ASSERT_EQUAL(0, restore_journal_record(journal, 7));
+    TEST_ASSERT_EQUAL(0, restore_journal_record(journal, 0));
+    TEST_ASSERT_EQUAL(0, restore_journal_record(journal, 7));  // Recorded once
+    TEST_ASSERT_TRUE(restore_journal_has_part(journal, 7));
+    TEST_ASSERT_EQUAL(-1, restore_journal_record(journal, NUM_PARTS));
+    restore_journal_close(journal);
+
+    journal = restore_journal_open(test_output_dir, ETAG, ARCHIVE_SIZE, NUM_PARTS);
+    TEST_ASSERT_NOT_NULL(journal);
+    TEST_ASSERT_EQUAL_size_t(2, restore_journal_resumed_parts(journal));
+    TEST_ASSERT_TRUE(restore_journal_has_part(journal, 0));
+    TEST_ASSERT_TRUE(restore_journal_has_part(journal, 7));
+    TEST_ASSERT_FALSE(restore_journal_has_part(journal, 1));
+    TEST_ASSERT_FALSE(restore_journal_has_part(journal, NUM_PARTS));
+    restore_journal_close(journal);
+}
+
+void test_other_archive_starts_over(void) {
+    struct restore_journal *journal =
+        restore_journal_open(test_output_dir, ETAG, ARCHIVE_SIZE, NUM_PARTS);
+    TEST_ASSERT_NOT_NULL(journal);
+    TEST_ASSERT_EQUAL(0, restore_journal_record(journal, 3));
+    restore_journal_close(journal);
+
+    // Same ETag, different size
+    journal = restore_journal_open(test_output_dir, ETAG, ARCHIVE_SIZE + 1, NUM_PARTS);
+    TEST_ASSERT_NOT_NULL(journal);
+    TEST_ASSERT_EQUAL_size_t(0, restore_journal_resumed_parts(journal));
+    TEST_ASSERT_EQUAL(0, restore_journal_record(journal, 4));
+    restore_journal_close(journal);
+
+    // Different ETag: part 4 belongs to the previous object
+    journal = restore_journal_open(test_output_dir, "\"other\"", ARCHIVE_SIZE + 1, NUM_PARTS);
+    TEST_ASSERT_NOT_NULL(journal);
+    TEST_ASSERT_EQUAL_size_t(0, restore_journal_resumed_parts(journal));
+    TEST_ASSERT_FALSE(restore_journal_has_part(journal, 4));
+    restore_journal_close(journal);
+}
+
+void test_cut_off_record_is_dropped(void) {
+    struct restore_journal *journal =
+        restore_journal_open(test_output_dir, ETAG, ARCHIVE_SIZE, NUM_PARTS);
+    TEST_ASSERT_NOT_NULL(journal);
+    TEST_ASSERT_EQUAL(0, restore_journal_record(journal, 2));
+    restore_journal_close(journal);
+
+    // Killed in the middle of writing "11\n", plus lines that are not parts
+    append_to_journal("junk\n99\n1");
+
+    journal = restore_journal_open(test_output_dir, ETAG, ARCHIVE_SIZE, NUM_PARTS);
+    TEST_ASSERT_NOT_NULL(journal);
+    TEST_ASSERT_EQUAL_size_t(1, restore_journal_resumed_parts(journal));
+    TEST_ASSERT_FALSE(restore_journal_has_part(journal, 1));
+    TEST_ASSERT_EQUAL(0, restore_journal_record(journal, 5));
+    restore_journal_close(journal);
+
+    // The partial line did not merge with the next record
+    journal = restore_journal_open(test_output_dir, ETAG, ARCHIVE_SIZE, NUM_PARTS);
+    TEST_ASSERT_NOT_NULL(journal);
+    TEST_ASSERT_EQUAL_size_t(2, restore_journal_resumed_parts(journal));
+    TEST_ASSERT_TRUE(restore_journal_has_part(journal, 2));
+    TEST_ASSERT_TRUE(restore_journal_has_part(journal, 5));
+    TEST_ASSERT_FALSE(restore_journal_has_part(journal, 1));
+    restore_journal_close(journal);
+}
+
+void test_remove_deletes_file(void) {
+    struct restore_journal *journal =
+        restore_journal_open(test_output_dir, ETAG, ARCHIVE_SIZE, NUM_PARTS);
+    TEST_ASSERT_NOT_NULL(journal);
+    TEST_ASSERT_EQUAL(0, restore_journal_remove(journal));
+    restore_journal_close(journal);
+    TEST_ASSERT_NOT_EQUAL(0, access(journal_path, F_OK));
+}
+
+void test_open_rejects_missing_etag(void) {
+    TEST_ASSERT_NULL(restore_journal_open(test_output_dir, "", ARCHIVE_SIZE, NUM_PARTS));
+    TEST_ASSERT_NULL(restore_journal_open(test_output_dir, NULL, ARCHIVE_SIZE, NUM_PARTS));
+    TEST_ASSERT_NULL(restore_journal_open(test_output_dir, "a\nb", ARCHIVE_SIZE, NUM_PARTS));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_new_journal_is_empty);
+    RUN_TEST(test_parts_survive_reopen);
+    RUN_TEST(test_other_archive_starts_over);
+    RUN_TEST(test_cut_off_record_is_dropped);
+    RUN_TEST(test_remove_deletes_file);
+    RUN_TEST(test_open_rejects_missing_etag);
+    return UNITY_END();
+}
@@ -0,0 +1,348 @@
+/*
+ * Unit tests for zero chunks and sparse input files.
+ *
+ * Chunks of zeros are written as a zero marker followed by an ordinary
+ * Zstandard frame. Holes of sparse files are found with SEEK_DATA/SEEK_HOLE
+ * and skipped without reading, producing the same archive as the file's
+ * dense equivalent.
+ */
+
+#include "unity.h"
+#include "burst_writer.h"
+#include "zip_structures.h"
+#include "central_dir_parser.h"
+#include "frame_parser.h"
+#include "../../src/writer/base_archive.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <zlib.h>
+#include <zstd.h>
+
+#define TEST_MTIME 1700000000
+#define CHUNK BURST_FRAME_SIZE
+
+static char archive_path[64];
+static char archive2_path[64];
+static char input_path[64];
+
+static void make_temp_path(char *path, size_t size) {
+    snprintf(path, size, "/tmp/test_sparse_files_XXXXXX");
+    int fd = mkstemp(path);
+    TEST_ASSERT_TRUE(fd >= 0);
+    close(fd);
+}
+
+void setUp(void) {
+    make_temp_path(archive_path, sizeof(archive_path));
+    make_temp_path(archive2_path, sizeof(archive2_path));
+    make_temp_path(input_path, sizeof(input_path));
+}
+
+void tearDown(void) {
+    unlink(archive_path);
+    unlink(archive2_path);
+    unlink(input_path);
+}
+
+// Zeros except for a little data at each offset in data_at
+static uint8_t *make_test_data(size_t len, const size_t *data_at, size_t num_data) {
+    uint8_t *buf = calloc(1, len);
+    for (size_t i = 0; i < num_data; i++) {
+        for (size_t j = 0; j < 1000 && data_at[i] + j < len; j++) {
+            buf[data_at[i] + j] = (uint8_t)('a' + j % 26);
+        }
+    }
+    return buf;
+}
+
+// Write data to input_path, leaving holes for zero ranges if sparse
+static void write_input_file(const uint8_t *data, size_t len, bool sparse) {
+    int fd = open(input_path, O_WRONLY | O_TRUNC);
+    TEST_ASSERT_TRUE(fd >= 0);
+    if (sparse) {
+        TEST_ASSERT_EQUAL(0, ftruncate(fd, (off_t)len));
+        for (size_t pos = 0; pos < len; pos += 4096) {
+            size_t n = len - pos < 4096 ? len - pos : 4096;
+            if (!burst_buffer_is_zero(data + pos, n)) {
+                TEST_ASSERT_EQUAL((ssize_t)n, pwrite(fd, data + pos, n, (off_t)pos));
+            }
+        }
+    } else {
+        TEST_ASSERT_EQUAL((ssize_t)len, write(fd, data, len));
+    }
+    close(fd);
+}
+
+// Source stat recorded for "f.bin", so base_archive_find_unchanged() finds it
+static struct stat input_stat(size_t len) {
+    struct stat st;
+    memset(&st, 0, sizeof(st));
+    st.st_mode = S_IFREG | 0644;
+    st.st_size = (off_t)len;
+    st.st_mtim.tv_sec = TEST_MTIME;
+    st.st_ctim.tv_sec = TEST_MTIME;
+    return st;
+}
+
+// Archive input_path as "f.bin" into path; returns the writer's zero frame and hole counts
+static void write_archive(const char *path, int threads,
+                          uint64_t *zero_frames_out, uint64_t *hole_bytes_out) {
+    FILE *out = fopen(path, "wb");
+    TEST_ASSERT_NOT_NULL(out);
+    struct burst_writer *writer = burst_writer_create(out, 3);
+    TEST_ASSERT_NOT_NULL(writer);
+    if (threads > 1) {
+        TEST_ASSERT_EQUAL(0, burst_writer_set_threads(writer, threads));
+    }
+
+    uint8_t lfh_buf[128];
+    struct zip_local_header *lfh = (struct zip_local_header *)lfh_buf;
+    memset(lfh, 0, sizeof(struct zip_local_header));
+    lfh->signature = ZIP_LOCAL_FILE_HEADER_SIG;
+    lfh->version_needed = 63;
+    lfh->flags = 0x0008;
+    lfh->compression_method = ZIP_METHOD_ZSTD;
+    uint16_t mod_time, mod_date;
+    dos_datetime_from_time_t(TEST_MTIME, &mod_time, &mod_date);
+    lfh->last_mod_time = mod_time;
+    lfh->last_mod_date = mod_date;
+    lfh->filename_length = 5;
+    memcpy(lfh_buf + sizeof(struct zip_local_header), "f.bin", 5);
+
+    FILE *in = fopen(input_path, "rb");
+    TEST_ASSERT_NOT_NULL(in);
+    TEST_ASSERT_EQUAL(0, burst_writer_add_file(writer, in, lfh,
+                                               sizeof(struct zip_local_header) + 5,
+                                               false, 0100644, 0, 0));
+    fclose(in);
+    struct stat st;
+    TEST_ASSERT_EQUAL(0, stat(input_path, &st));
+    st = input_stat((size_t)st.st_size);
+    TEST_ASSERT_EQUAL(0, burst_writer_set_source_stat(writer, &st));
+
+    TEST_ASSERT_EQUAL(0, burst_writer_finalize(writer));
+    if (zero_frames_out) {
+        *zero_frames_out = writer->zero_frames;
+    }
+    if (hole_bytes_out) {
+        *hole_bytes_out = writer->hole_bytes;
+    }
+    burst_writer_destroy(writer);
+    fclose(out);
+}
+
+static uint8_t *read_whole_file(const char *path, long *size_out) {
+    FILE *f = fopen(path, "rb");
+    TEST_ASSERT_NOT_NULL(f);
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    rewind(f);
+    uint8_t *buf = malloc((size_t)size);
+    TEST_ASSERT_EQUAL((size_t)size, fread(buf, 1, (size_t)size, f));
+    fclose(f);
+    *size_out = size;
+    return buf;
+}
+
+static bool input_has_holes(void) {
+    struct stat st;
+    TEST_ASSERT_EQUAL(0, stat(input_path, &st));
+    return (uint64_t)st.st_blocks * 512 < (uint64_t)st.st_size;
+}
+
+/*
+ * Decode "f.bin" from the archive at path, checking it against expected and
+ * checking that exactly the all-zero frames were marked. Returns the number
+ * of marked frames.
+ */
+static size_t assert_archive_decodes(const char *path, const uint8_t *expected, size_t len) {
+    struct base_archive *archive = base_archive_open(path);
+    TEST_ASSERT_NOT_NULL(archive);
+    struct stat st = input_stat(len);
+    const struct file_metadata *file = base_archive_find_unchanged(archive, "f.bin", &st);
+    TEST_ASSERT_NOT_NULL(file);
+    TEST_ASSERT_EQUAL_HEX32(crc32(0, expected, (uInt)len), file->crc32);
+
+    struct base_frame_reader *frames = base_frame_reader_open(archive, file);
+    TEST_ASSERT_NOT_NULL(frames);
+
+    uint8_t *actual = malloc(len);
+    size_t pos = 0;
+    size_t zero_frames = 0;
+    struct base_frame frame;
+    int rc;
+    while ((rc = base_frame_reader_next(frames, &frame)) > 0) {
+        size_t n = ZSTD_decompress(actual + pos, len - pos, frame.data, frame.compressed_size);
+        TEST_ASSERT_FALSE(ZSTD_isError(n));
+        TEST_ASSERT_EQUAL(frame.uncompressed_size, n);
+        TEST_ASSERT_EQUAL(burst_buffer_is_zero(actual + pos, n), frame.is_zero);
+        zero_frames += frame.is_zero;
+        pos += n;
+    }
+    TEST_ASSERT_EQUAL(0, rc);
+    TEST_ASSERT_EQUAL(len, pos);
+    TEST_ASSERT_EQUAL_MEMORY(expected, actual, len);
+
+    free(actual);
+    base_frame_reader_close(frames);
+    base_archive_close(archive);
+    return zero_frames;
+}
+
+// =============================================================================
+// Zero Chunk Tests
+// =============================================================================
+
+void test_buffer_is_zero(void) {
+    uint8_t buf[64] = {0};
+    TEST_ASSERT_TRUE(burst_buffer_is_zero(buf, sizeof(buf)));
+    TEST_ASSERT_TRUE(burst_buffer_is_zero(buf, 1));
+    TEST_ASSERT_FALSE(burst_buffer_is_zero(buf, 0));
+    buf[63] = 1;
+    TEST_ASSERT_FALSE(burst_buffer_is_zero(buf, sizeof(buf)));
+    TEST_ASSERT_TRUE(burst_buffer_is_zero(buf, 63));
+}
+
+void test_zero_chunks_are_marked(void) {
+    // Data, two chunks of zeros, data, then a partial chunk of zeros
+    size_t len = 4 * CHUNK + 5000;
+    size_t data_at[] = {10, 3 * CHUNK + 20};
+    uint8_t *data = make_test_data(len, data_at, 2);
+    write_input_file(data, len, false);
+
+    uint64_t zero_frames;
+    write_archive(archive_path, 1, &zero_frames, NULL);
+    TEST_ASSERT_EQUAL(3, zero_frames);
+    TEST_ASSERT_EQUAL(3, assert_archive_decodes(archive_path, data, len));
+
+    // The marker is a 1-byte skippable frame directly before the zero frame
+    long size;
+    uint8_t *archive = read_whole_file(archive_path, &size);
+    const uint8_t marker[] = {0x5B, 0x2A, 0x4D, 0x18, 0x01, 0x00, 0x00, 0x00,
+                              BURST_TYPE_ZERO_FRAME};
+    size_t markers = 0;
+    for (long i = 0; i + (long)sizeof(marker) + 4 <= size; i++) {
+        if (memcmp(archive + i, marker, sizeof(marker)) == 0) {
+            uint32_t magic;
+            memcpy(&magic, archive + i + sizeof(marker), sizeof(magic));
+            TEST_ASSERT_EQUAL_HEX32(ZSTD_MAGICNUMBER, magic);
+            markers++;
+        }
+    }
+    TEST_ASSERT_EQUAL(3, markers);
+
+    free(archive);
+    free(data);
+}
+
+void test_no_markers_without_zero_chunks(void) {
+    size_t len = 2 * CHUNK;
+    uint8_t *data = malloc(len);
+    memset(data, 'A', len);
+    data[CHUNK + 7] = 0;  // A zero byte does not make a zero chunk
+    write_input_file(data, len, false);
+
+    uint64_t zero_frames;
+    write_archive(archive_path, 1, &zero_frames, NULL);
+    TEST_ASSERT_EQUAL(0, zero_frames);
+    TEST_ASSERT_EQUAL(0, assert_archive_decodes(archive_path, data, len));
+
+    free(data);
+}
+
+// =============================================================================
+// Sparse File Tests
+// =============================================================================
+
+void test_sparse_file_matches_dense_file(void) {
+    // Holes before, between and after the data, ending exactly on a chunk
+    size_t len = 40 * CHUNK;
+    size_t data_at[] = {5 * CHUNK + 100, 6 * CHUNK - 10, 30 * CHUNK};
+    uint8_t *data = make_test_data(len, data_at, 3);
+
+    write_input_file(data, len, false);
+    write_archive(archive2_path, 1, NULL, NULL);
+
+    write_input_file(data, len, true);
+    uint64_t zero_frames, hole_bytes;
+    write_archive(archive_path, 1, &zero_frames, &hole_bytes);
+    if (input_has_holes()) {
+        TEST_ASSERT_TRUE(hole_bytes >= 30 * CHUNK);
+    }
+    TEST_ASSERT_EQUAL(37, zero_frames);
+
+    long size1, size2;
+    uint8_t *sparse_archive = read_whole_file(archive_path, &size1);
+    uint8_t *dense_archive = read_whole_file(archive2_path, &size2);
+    TEST_ASSERT_EQUAL(size2, size1);
+    TEST_ASSERT_EQUAL_MEMORY(dense_archive, sparse_archive, (size_t)size1);
+    TEST_ASSERT_EQUAL(37, assert_archive_decodes(archive_path, data, len));
+
+    free(sparse_archive);
+    free(dense_archive);
+    free(data);
+}
+
+void test_sparse_file_ending_in_partial_hole(void) {
+    size_t len = 3 * CHUNK + 777;
+    size_t data_at[] = {CHUNK};
+    uint8_t *data = make_test_data(len, data_at, 1);
+    write_input_file(data, len, true);
+
+    uint64_t zero_frames;
+    write_archive(archive_path, 1, &zero_frames, NULL);
+    TEST_ASSERT_EQUAL(3, zero_frames);
+    TEST_ASSERT_EQUAL(3, assert_archive_decodes(archive_path, data, len));
+
+    free(data);
+}
+
+void test_sparse_file_parallel_matches_serial(void) {
+    // Zero chunks on both sides of data that crosses an 8 MiB part boundary
+    size_t len = 100 * CHUNK + 12345;
+    size_t data_at[] = {0, 50 * CHUNK + 3, 99 * CHUNK};
+    uint8_t *data = make_test_data(len, data_at, 3);
+    uint32_t x = 1;
+    for (size_t i = 10 * CHUNK; i < 90 * CHUNK; i++) {
+        x = x * 1103515245 + 12345;
+        data[i] = (uint8_t)(x >> 16);  // Incompressible, so the archive spans parts
+    }
+    write_input_file(data, len, true);
+
+    write_archive(archive_path, 1, NULL, NULL);
+    write_archive(archive2_path, 4, NULL, NULL);
+
+    long size1, size2;
+    uint8_t *serial = read_whole_file(archive_path, &size1);
+    uint8_t *parallel = read_whole_file(archive2_path, &size2);
+    TEST_ASSERT_EQUAL(size1, size2);
+    TEST_ASSERT_EQUAL_MEMORY(serial, parallel, (size_t)size1);
+    assert_archive_decodes(archive2_path, data, len);
+
+    free(serial);
+    free(parallel);
+    free(data);
+}
+
+// =============================================================================
+// Main
+// =============================================================================
+
+int main(void) {
+    UNITY_BEGIN();
+
+    // Zero Chunk Tests
+    RUN_TEST(test_buffer_is_zero);
+    RUN_TEST(test_zero_chunks_are_marked);
+    RUN_TEST(test_no_markers_without_zero_chunks);
+
+    // Sparse File Tests
+    RUN_TEST(test_sparse_file_matches_dense_file);
+    RUN_TEST(test_sparse_file_ending_in_partial_hole);
+    RUN_TEST(test_sparse_file_parallel_matches_serial);
+
+    return UNITY_END();
+}
@@ -1283,6 +1283,115 @@ void test_split_at_multiple_boundaries(void) {
     free_test_cd_result(cd);
 }
 
+// Frames larger than the callbacks: only the split frames' bytes are copied,
+// each at most once, and whatever follows them is parsed in place
+void test_split_frames_copy_only_what_they_need(void) {
+    enum { NUM_FRAMES = 32, PAYLOAD = 1000, CHUNK = 700 };
+    static uint8_t buffer[NUM_FRAMES * (PAYLOAD + 16) + 256];
+    size_t offset = 0;
+
+    offset += create_local_header(buffer + offset, "test.txt");
+    size_t frames_start = offset;
+    for (int i = 0; i < NUM_FRAMES; i++) {
+        size_t frame_len = create_test_zstd_frame(buffer + offset, sizeof(buffer) - offset,
+                                                  PAYLOAD);
+        // Turn the empty raw block into one holding PAYLOAD bytes
+        uint32_t block_header = 1 | ((uint32_t)PAYLOAD << 3);
+        buffer[offset + frame_len - 3] = (uint8_t)block_header;
+        buffer[offset + frame_len - 2] = (uint8_t)(block_header >> 8);
+        buffer[offset + frame_len - 1] = (uint8_t)(block_header >> 16);
+        memset(buffer + offset + frame_len, 'x', PAYLOAD);
+        offset += frame_len + PAYLOAD;
+    }
+    size_t frames_len = offset - frames_start;
+    offset += create_data_descriptor(buffer + offset, 0, (uint32_t)frames_len,
+                                     NUM_FRAMES * PAYLOAD);
+
+    struct central_dir_parse_result *cd = create_test_cd_result(
+        "test.txt", 0, frames_len, NUM_FRAMES * PAYLOAD);
+    struct part_processor_state *state = part_processor_create(0, cd, test_output_dir, BURST_BASE_PART_SIZE);
+    TEST_ASSERT_NOT_NULL(state);
+
+    size_t chunks = 0;
+    for (size_t pos = 0; pos < offset; pos += CHUNK) {
+        size_t to_send = (offset - pos < CHUNK) ? offset - pos : CHUNK;
+        TEST_ASSERT_EQUAL(STREAM_PROC_SUCCESS,
+                          part_processor_process_data(state, buffer + pos, to_send));
+        chunks++;
+    }
+    TEST_ASSERT_EQUAL(STREAM_PROC_SUCCESS, part_processor_finalize(state));
+    TEST_ASSERT_EQUAL(NUM_FRAMES, write_encoded_call_count);
+    TEST_ASSERT_EQUAL(NUM_FRAMES * PAYLOAD, total_uncompressed_bytes);
+
+    // Appending whole callbacks to the carried bytes would copy several
+    // times the archive; completing frames copies less than it once
+    TEST_ASSERT_LESS_THAN(offset, state->frame_bytes_copied);
+    TEST_ASSERT_GREATER_THAN(0, state->frame_bytes_copied);
+    TEST_ASSERT_LESS_OR_EQUAL(chunks * (PAYLOAD + 16), state->frame_bytes_copied);
+
+    part_processor_destroy(state);
+    free_test_cd_result(cd);
+}
+
+// A frame whose header claims more than the carry limit is rejected instead
+// of being buffered until it completes
+void test_frame_larger_than_carry_limit(void) {
+    uint8_t buffer[64];
+    size_t offset = create_padding_frame(buffer, 16);
+    uint32_t claimed_size = 2 * 1024 * 1024;
+    memcpy(buffer + 4, &claimed_size, 4);
+
+    struct central_dir_parse_result *cd = create_test_cd_result("test.txt", 0, 100, 100);
+    struct part_processor_state *state = part_processor_create(0, cd, test_output_dir, BURST_BASE_PART_SIZE);
+    TEST_ASSERT_NOT_NULL(state);
+
+    int rc = part_processor_process_data(state, buffer, offset);
+    TEST_ASSERT_EQUAL(STREAM_PROC_ERR_INVALID_FRAME, rc);
+    TEST_ASSERT_NOT_NULL(strstr(part_processor_get_error(state), "Incomplete frame"));
+    TEST_ASSERT_EQUAL(0, state->frame_buffer_used);
+
+    part_processor_destroy(state);
+    free_test_cd_result(cd);
+}
+
+// A request that dies mid-frame is resumed from the last frame boundary
+void test_rewind_resumes_at_frame_boundary(void) {
+    uint8_t buffer[1024];
+    size_t offset = 0;
+
+    offset += create_local_header(buffer + offset, "test.txt");
+    size_t zstd1_size = create_test_zstd_frame(buffer + offset, sizeof(buffer) - offset, 100);
+    offset += zstd1_size;
+    size_t frame2_start = offset;
+    size_t zstd2_size = create_test_zstd_frame(buffer + offset, sizeof(buffer) - offset, 50);
+    offset += zstd2_size;
+    offset += create_data_descriptor(buffer + offset, 0, (uint32_t)(zstd1_size + zstd2_size), 150);
+
+    struct central_dir_parse_result *cd = create_test_cd_result("test.txt", 0,
+                                                                zstd1_size + zstd2_size, 150);
+    struct part_processor_state *state = part_processor_create(0, cd, test_output_dir, BURST_BASE_PART_SIZE);
+    TEST_ASSERT_NOT_NULL(state);
+
+    // First request: the header, the first frame and part of the second
+    int rc = part_processor_process_data(state, buffer, frame2_start + 5);
+    TEST_ASSERT_EQUAL(STREAM_PROC_SUCCESS, rc);
+    TEST_ASSERT_EQUAL(1, write_encoded_call_count);
+    TEST_ASSERT_EQUAL_UINT64(frame2_start, part_processor_rewind(state));
+
+    // Second request from the returned offset
+    rc = part_processor_process_data(state, buffer + frame2_start, offset - frame2_start);
+    TEST_ASSERT_EQUAL(STREAM_PROC_SUCCESS, rc);
+    rc = part_processor_finalize(state);
+    TEST_ASSERT_EQUAL(STREAM_PROC_SUCCESS, rc);
+
+    TEST_ASSERT_EQUAL(2, write_encoded_call_count);
+    TEST_ASSERT_EQUAL(150, total_uncompressed_bytes);
+    TEST_ASSERT_EQUAL(100, last_file_offset);
+
+    part_processor_destroy(state);
+    free_test_cd_result(cd);
+}
+
 // =============================================================================
 // Central Directory Detection Tests
 // =============================================================================
@@ -1425,6 +1534,222 @@ void test_central_directory_in_processing_frames_state(void) {
     free_test_cd_result(cd);
 }
 
+// Empty files are created from the central directory and skipped in the stream
+void test_materialize_entries_creates_empty_file(void) {
+    uint8_t buffer[1024];
+    size_t offset = 0;
+    offset += create_local_header(buffer + offset, "sub/empty.txt");
+    size_t zstd_size = create_test_zstd_frame(buffer + offset, sizeof(buffer) - offset, 0);
+    offset += zstd_size;
+    offset += create_data_descriptor(buffer + offset, 0, (uint32_t)zstd_size, 0);
+
+    struct central_dir_parse_result *cd = create_test_cd_result("sub/empty.txt", 0, zstd_size, 0);
+    cd->files[0].unix_mode = 0100600;
+    cd->files[0].has_unix_mode = true;
+    cd->files[0].parent_dir = 1;
+
+    struct archive_dir dirs[2] = {
+        { .path = "", .parent = CENTRAL_DIR_NO_DIR },
+        { .path = "sub", .parent = 0 },
+    };
+    cd->dirs = dirs;
+    cd->num_dirs = 2;
+
+    TEST_ASSERT_EQUAL(0, stream_processor_materialize_entries(cd, test_output_dir, 0, 1));
+
+    char path[512];
+    snprintf(path, sizeof(path), "%s/sub/empty.txt", test_output_dir);
+    struct stat st;
+    TEST_ASSERT_EQUAL(0, stat(path, &st));
+    TEST_ASSERT_TRUE(S_ISREG(st.st_mode));
+    TEST_ASSERT_EQUAL(0, st.st_size);
+    TEST_ASSERT_TRUE(atomic_load(&dirs[1].created));
+
+    // The part processor finds the file already created and writes nothing
+    struct part_processor_state *state = part_processor_create(0, cd, test_output_dir, BURST_BASE_PART_SIZE);
+    TEST_ASSERT_NOT_NULL(state);
+    TEST_ASSERT_EQUAL(STREAM_PROC_SUCCESS, part_processor_process_data(state, buffer, offset));
+    TEST_ASSERT_EQUAL(STREAM_PROC_SUCCESS, part_processor_finalize(state));
+    TEST_ASSERT_EQUAL(0, write_encoded_call_count);
+    TEST_ASSERT_EQUAL(0, stat(path, &st));
+
+    // Permissions are applied in the final pass
+    TEST_ASSERT_EQUAL(0, stream_processor_apply_metadata(cd, test_output_dir, 0, 1));
+    TEST_ASSERT_EQUAL(0, stat(path, &st));
+    TEST_ASSERT_EQUAL_HEX(0600, st.st_mode & 07777);
+
+    part_processor_destroy(state);
+    cd->dirs = NULL;
+    free_test_cd_result(cd);
+}
+
+void test_materialize_entries_invalid_range(void) {
+    struct central_dir_parse_result *cd = create_test_cd_result("a.txt", 0, 0, 0);
+    struct archive_dir dirs[1] = { { .path = "", .parent = CENTRAL_DIR_NO_DIR } };
+
+    // No directory table
+    TEST_ASSERT_EQUAL(-1, stream_processor_materialize_entries(cd, test_output_dir, 0, 1));
+
+    cd->dirs = dirs;
+    cd->num_dirs = 1;
+    TEST_ASSERT_EQUAL(-1, stream_processor_materialize_entries(cd, test_output_dir, 0, 2));
+    TEST_ASSERT_EQUAL(-1, stream_processor_materialize_entries(cd, test_output_dir, 2, 0));
+    TEST_ASSERT_EQUAL(0, stream_processor_materialize_entries(cd, test_output_dir, 1, 0));
+
+    cd->dirs = NULL;
+    free_test_cd_result(cd);
+}
+
+// The processors of the parts a file spans share one fd, closed by the last
+void test_spanning_file_shares_fd(void) {
+    uint8_t part0[512];
+    size_t part0_len = create_local_header(part0, "spanning.txt");
+    part0_len += create_test_zstd_frame(part0 + part0_len, sizeof(part0) - part0_len, 100);
+
+    uint8_t part1[512];
+    size_t part1_len = create_start_of_part_frame(part1, 100);
+    size_t zstd_size = create_test_zstd_frame(part1 + part1_len, sizeof(part1) - part1_len, 100);
+    part1_len += zstd_size;
+    part1_len += create_data_descriptor(part1 + part1_len, 0, (uint32_t)zstd_size, 200);
+
+    struct central_dir_parse_result *cd = create_test_cd_result("spanning.txt", 0, 2 * zstd_size, 200);
+    free(cd->parts[0].entries);
+    free(cd->parts);
+    cd->num_parts = 2;
+    cd->parts = calloc(2, sizeof(struct part_files));
+    cd->parts[0].num_entries = 1;
+    cd->parts[0].entries = calloc(1, sizeof(struct part_file_entry));
+    cd->parts[1].continuing_file = &cd->files[0];
+    cd->files[0].num_parts_spanned = 2;
+    cd->files[0].parts_pending = 2;
+    cd->files[0].shared_fd = -1;
+
+    struct part_processor_state *first = part_processor_create(0, cd, test_output_dir, BURST_BASE_PART_SIZE);
+    struct part_processor_state *second = part_processor_create(1, cd, test_output_dir, BURST_BASE_PART_SIZE);
+    TEST_ASSERT_NOT_NULL(first);
+    TEST_ASSERT_NOT_NULL(second);
+
+    // Both parts in flight at once
+    TEST_ASSERT_EQUAL(STREAM_PROC_SUCCESS, part_processor_process_data(first, part0, part0_len));
+    TEST_ASSERT_NOT_NULL(first->current_file);
+    int fd = first->current_file->fd;
+    TEST_ASSERT_TRUE(fd >= 0);
+    TEST_ASSERT_EQUAL(fd, cd->files[0].shared_fd);
+
+    TEST_ASSERT_EQUAL(STREAM_PROC_SUCCESS, part_processor_process_data(second, part1, part1_len));
+    TEST_ASSERT_EQUAL(STREAM_PROC_SUCCESS, part_processor_finalize(second));
+    TEST_ASSERT_EQUAL(2, write_encoded_call_count);
+
+    // The first part still holds the fd
+    TEST_ASSERT_EQUAL(fd, cd->files[0].shared_fd);
+    TEST_ASSERT_EQUAL(1, cd->files[0].parts_pending);
+
+    TEST_ASSERT_EQUAL(STREAM_PROC_SUCCESS, part_processor_finalize(first));
+    TEST_ASSERT_EQUAL(-1, cd->files[0].shared_fd);
+    TEST_ASSERT_EQUAL(0, cd->files[0].shared_fd_holders);
+
+    // The part holding the end of the file set its size
+    char path[512];
+    snprintf(path, sizeof(path), "%s/spanning.txt", test_output_dir);
+    struct stat st;
+    TEST_ASSERT_EQUAL(0, stat(path, &st));
+    TEST_ASSERT_EQUAL(200, st.st_size);
+
+    part_processor_destroy(first);
+    part_processor_destroy(second);
+    free(cd->parts[1].entries);
+    free_test_cd_result(cd);
+}
+
+// A part restored by an earlier run does not keep the shared fd open
+void test_skipped_part_releases_shared_fd(void) {
+    uint8_t part0[512];
+    size_t part0_len = create_local_header(part0, "spanning.txt");
+    size_t zstd_size = create_test_zstd_frame(part0 + part0_len, sizeof(part0) - part0_len, 100);
+    part0_len += zstd_size;
+
+    struct central_dir_parse_result *cd = create_test_cd_result("spanning.txt", 0, 2 * zstd_size, 200);
+    free(cd->parts[0].entries);
+    free(cd->parts);
+    cd->num_parts = 2;
+    cd->parts = calloc(2, sizeof(struct part_files));
+    cd->parts[0].num_entries = 1;
+    cd->parts[0].entries = calloc(1, sizeof(struct part_file_entry));
+    cd->parts[1].continuing_file = &cd->files[0];
+    cd->files[0].num_parts_spanned = 2;
+    cd->files[0].parts_pending = 2;
+    cd->files[0].shared_fd = -1;
+
+    // Part 1 is in the resume journal
+    stream_processor_skip_part(cd, 1);
+    TEST_ASSERT_EQUAL(1, cd->files[0].parts_pending);
+
+    struct part_processor_state *first = part_processor_create(0, cd, test_output_dir, BURST_BASE_PART_SIZE);
+    TEST_ASSERT_NOT_NULL(first);
+    TEST_ASSERT_EQUAL(STREAM_PROC_SUCCESS, part_processor_process_data(first, part0, part0_len));
+    TEST_ASSERT_TRUE(cd->files[0].shared_fd >= 0);
+    TEST_ASSERT_EQUAL(STREAM_PROC_SUCCESS, part_processor_finalize(first));
+
+    // Closed by the only part that ran
+    TEST_ASSERT_EQUAL(-1, cd->files[0].shared_fd);
+    TEST_ASSERT_EQUAL(0, cd->files[0].parts_pending);
+
+    part_processor_destroy(first);
+    free_test_cd_result(cd);
+}
+
+// Directory modes are applied after file modes, deepest first
+void test_apply_metadata_directories_last(void) {
+    struct central_dir_parse_result cd;
+    memset(&cd, 0, sizeof(cd));
+    struct file_metadata files[3];
+    memset(files, 0, sizeof(files));
+    files[0] = (struct file_metadata){ .filename = "d/", .unix_mode = 040555,
+                                       .has_unix_mode = true, .parent_dir = 0 };
+    files[1] = (struct file_metadata){ .filename = "d/e/", .unix_mode = 040500,
+                                       .has_unix_mode = true, .parent_dir = 1 };
+    files[2] = (struct file_metadata){ .filename = "d/e/f.txt", .unix_mode = 0100640,
+                                       .has_unix_mode = true, .parent_dir = 2 };
+    struct archive_dir dirs[3] = {
+        { .path = "", .parent = CENTRAL_DIR_NO_DIR },
+        { .path = "d", .parent = 0 },
+        { .path = "d/e", .parent = 1 },
+    };
+    cd.files = files;
+    cd.num_files = 3;
+    cd.dirs = dirs;
+    cd.num_dirs = 3;
+
+    TEST_ASSERT_EQUAL(0, stream_processor_materialize_entries(&cd, test_output_dir, 0, 3));
+
+    char path[512];
+    struct stat st;
+    snprintf(path, sizeof(path), "%s/d", test_output_dir);
+    TEST_ASSERT_EQUAL(0, stat(path, &st));
+    TEST_ASSERT_EQUAL_HEX(0755, st.st_mode & 07777);
+
+    // Regular files only
+    TEST_ASSERT_EQUAL(0, stream_processor_apply_metadata(&cd, test_output_dir, 0, 3));
+    TEST_ASSERT_EQUAL(0, stat(path, &st));
+    TEST_ASSERT_EQUAL_HEX(0755, st.st_mode & 07777);
+    snprintf(path, sizeof(path), "%s/d/e/f.txt", test_output_dir);
+    TEST_ASSERT_EQUAL(0, stat(path, &st));
+    TEST_ASSERT_EQUAL_HEX(0640, st.st_mode & 07777);
+
+    TEST_ASSERT_EQUAL(0, stream_processor_apply_directory_metadata(&cd, test_output_dir));
+    snprintf(path, sizeof(path), "%s/d/e", test_output_dir);
+    TEST_ASSERT_EQUAL(0, stat(path, &st));
+    TEST_ASSERT_EQUAL_HEX(0500, st.st_mode & 07777);
+    snprintf(path, sizeof(path), "%s/d", test_output_dir);
+    TEST_ASSERT_EQUAL(0, stat(path, &st));
+    TEST_ASSERT_EQUAL_HEX(0555, st.st_mode & 07777);
+
+    // Let tearDown remove the tree
+    chmod(path, 0755);
+    snprintf(path, sizeof(path), "%s/d/e", test_output_dir);
+    chmod(path, 0755);
+}
+
 int main(void) {
     UNITY_BEGIN();
 
@@ -1471,6 +1796,9 @@ int main(void) {
     RUN_TEST(test_split_mid_burst_skippable_payload);
     RUN_TEST(test_split_mid_local_header_variable_fields);
     RUN_TEST(test_split_at_multiple_boundaries);
+    RUN_TEST(test_split_frames_copy_only_what_they_need);
+    RUN_TEST(test_frame_larger_than_carry_limit);
+    RUN_TEST(test_rewind_resumes_at_frame_boundary);
 
     // Central Directory detection tests
     RUN_TEST(test_central_directory_at_expected_offset);
@@ -1478,5 +1806,12 @@ int main(void) {
     RUN_TEST(test_central_directory_after_expected_offset);
     RUN_TEST(test_central_directory_in_processing_frames_state);
 
+    // Up-front materialization from the central directory
+    RUN_TEST(test_materialize_entries_creates_empty_file);
+    RUN_TEST(test_materialize_entries_invalid_range);
+    RUN_TEST(test_apply_metadata_directories_last);
+    RUN_TEST(test_spanning_file_shares_fd);
+    RUN_TEST(test_skipped_part_releases_shared_fd);
+
     return UNITY_END();
 }
@@ -0,0 +1,803 @@
+/*
+ * Restores archives written by burst_writer through the part processor and
+ * checks the files it leaves behind. Unlike test_stream_processor, nothing is
+ * mocked: off BTRFS, encoded writes fall back to plain writes. One test reads
+ * the archive through a file source and the I/O pool, as the downloader does.
+ *
+ * Linked with --wrap=ioctl, --wrap=copy_file_range and --wrap=fallocate so
+ * tests can make FICLONE, copy_file_range() and hole punching fail as they do
+ * on other filesystems, and with --wrap=fchmodat to see which names the
+ * metadata pass touches.
+ */
+
+#define _GNU_SOURCE  // copy_file_range, fallocate, SEEK_HOLE
+#include "unity.h"
+#include "burst_writer.h"
+#include "central_dir_parser.h"
+#include "stream_processor.h"
+#include "entry_processor.h"
+#include "content_hash.h"
+#include "archive_source.h"
+#include "io_pool.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+
+#ifndef FICLONE
+#define FICLONE _IOW(0x94, 9, int)
+#endif
+
+static char work_dir[256];
+static char source_dir[512];
+static char output_dir[512];
+
+static FILE *archive_file;
+static struct burst_writer *writer;
+static uint8_t *archive;
+static size_t archive_size;
+static struct central_dir_parse_result cd;
+
+// Failures injected into the clone of duplicate content and into hole punching
+static bool fail_ficlone;
+static bool fail_copy_file_range;
+static bool fail_fallocate;
+static int ficlone_calls;
+static int copy_file_range_calls;
+static int fallocate_calls;
+
+// fchmodat() calls on names ending in chmod_watch_name
+static const char *chmod_watch_name;
+static int chmod_watch_calls;
+
+int __real_ioctl(int fd, unsigned long request, ...);
+ssize_t __real_copy_file_range(int fd_in, off_t *off_in, int fd_out, off_t *off_out,
+                               size_t len, unsigned int flags);
+int __real_fallocate(int fd, int mode, off_t offset, off_t len);
+int __real_fchmodat(int dirfd, const char *pathname, mode_t mode, int flags);
+
+int __wrap_ioctl(int fd, unsigned long request, ...) {
+    va_list args;
+    va_start(args, request);
+    void *arg = va_arg(args, void *);
+    va_end(args);
+
+    if (request == FICLONE) {
+        ficlone_calls++;
+        if (fail_ficlone) {
+            errno = EOPNOTSUPP;
+            return -1;
+        }
+    }
+    return __real_ioctl(fd, request, arg);
+}
+
+ssize_t __wrap_copy_file_range(int fd_in, off_t *off_in, int fd_out, off_t *off_out,
+                               size_t len, unsigned int flags) {
+    copy_file_range_calls++;
+    if (fail_copy_file_range) {
+        errno = EXDEV;
+        return -1;
+    }
+    return __real_copy_file_range(fd_in, off_in, fd_out, off_out, len, flags);
+}
+
+int __wrap_fallocate(int fd, int mode, off_t offset, off_t len) {
+    fallocate_calls++;
+    if (fail_fallocate) {
+        errno = EOPNOTSUPP;
+        return -1;
+    }
+    return __real_fallocate(fd, mode, offset, len);
+}
+
+int __wrap_fchmodat(int dirfd, const char *pathname, mode_t mode, int flags) {
+    if (chmod_watch_name) {
+        size_t len = strlen(pathname);
+        size_t watch_len = strlen(chmod_watch_name);
+        if (len >= watch_len && strcmp(pathname + len - watch_len, chmod_watch_name) == 0) {
+            chmod_watch_calls++;
+        }
+    }
+    return __real_fchmodat(dirfd, pathname, mode, flags);
+}
+
+void setUp(void) {
+    snprintf(work_dir, sizeof(work_dir), "/tmp/burst_restore_%d", getpid());
+    snprintf(source_dir, sizeof(source_dir), "%s/src", work_dir);
+    snprintf(output_dir, sizeof(output_dir), "%s/out", work_dir);
+    TEST_ASSERT_EQUAL(0, mkdir(work_dir, 0755));
+    TEST_ASSERT_EQUAL(0, mkdir(source_dir, 0755));
+    TEST_ASSERT_EQUAL(0, mkdir(output_dir, 0755));
+
+    fail_ficlone = false;
+    fail_copy_file_range = false;
+    fail_fallocate = false;
+    ficlone_calls = 0;
+    copy_file_range_calls = 0;
+    fallocate_calls = 0;
+    chmod_watch_name = NULL;
+    chmod_watch_calls = 0;
+
+    archive_file = tmpfile();
+    TEST_ASSERT_NOT_NULL(archive_file);
+    writer = burst_writer_create(archive_file, 3);
+    TEST_ASSERT_NOT_NULL(writer);
+    archive = NULL;
+    memset(&cd, 0, sizeof(cd));
+}
+
+void tearDown(void) {
+    if (writer) {
+        burst_writer_destroy(writer);
+        writer = NULL;
+    }
+    if (archive) {
+        central_dir_parse_result_free(&cd);
+        free(archive);
+        archive = NULL;
+    }
+    fclose(archive_file);
+
+    char cmd[512];
+    snprintf(cmd, sizeof(cmd), "rm -rf %s", work_dir);
+    system(cmd);
+}
+
+// Recognizable content: byte i of a file is derived from i and seed
+static void fill_pattern(uint8_t *data, size_t len, uint32_t seed) {
+    for (size_t i = 0; i < len; i++) {
+        data[i] = (uint8_t)((i * 31 + seed) ^ (i >> 9));
+    }
+}
+
+// Write data to name under the source directory (creating its parents) and
+// stat it into st
+static void write_source(const char *name, const uint8_t *data, size_t len, struct stat *st) {
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/%s", source_dir, name);
+    for (char *slash = strchr(path + strlen(source_dir) + 1, '/'); slash;
+         slash = strchr(slash + 1, '/')) {
+        *slash = '\0';
+        mkdir(path, 0755);
+        *slash = '/';
+    }
+
+    FILE *f = fopen(path, "wb");
+    TEST_ASSERT_NOT_NULL(f);
+    TEST_ASSERT_EQUAL(len, fwrite(data, 1, len, f));
+    fclose(f);
+    TEST_ASSERT_EQUAL(0, stat(path, st));
+}
+
+// Content that does not compress, to fill parts of the archive
+static void fill_random(uint8_t *data, size_t len, uint32_t seed) {
+    uint32_t x = seed | 1;
+    for (size_t i = 0; i < len; i++) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        data[i] = (uint8_t)x;
+    }
+}
+
+static void source_path(char *path, size_t size, const char *name) {
+    snprintf(path, size, "%s/%s", source_dir, name);
+}
+
+// Add name to the archive with the given content, as burst-writer does
+static void archive_file_content(const char *name, const uint8_t *data, size_t len) {
+    struct stat st;
+    char path[1024];
+    write_source(name, data, len, &st);
+    source_path(path, sizeof(path), name);
+    TEST_ASSERT_EQUAL(1, process_entry(writer, path, name, NULL, &st, false));
+}
+
+// Finish the archive and parse its central directory
+static void finish_archive(void) {
+    TEST_ASSERT_EQUAL(0, burst_writer_finalize(writer));
+    burst_writer_destroy(writer);
+    writer = NULL;
+
+    archive_size = (size_t)ftell(archive_file);
+    archive = malloc(archive_size);
+    TEST_ASSERT_NOT_NULL(archive);
+    rewind(archive_file);
+    TEST_ASSERT_EQUAL(archive_size, fread(archive, 1, archive_size, archive_file));
+
+    TEST_ASSERT_EQUAL(CENTRAL_DIR_PARSE_SUCCESS,
+                      central_dir_parse(archive, archive_size, archive_size,
+                                        BURST_PART_SIZE, &cd));
+}
+
+// Feed part p, described by result, to a part processor in chunks of
+// chunk_size bytes
+static void restore_part_from(struct central_dir_parse_result *result, uint32_t p,
+                              size_t chunk_size) {
+    uint64_t start = (uint64_t)p * BURST_PART_SIZE;
+    uint64_t end = start + BURST_PART_SIZE;
+    if (end > result->central_dir_offset) {
+        end = result->central_dir_offset;
+    }
+
+    struct part_processor_state *state = part_processor_create(p, result, output_dir,
+                                                               BURST_PART_SIZE);
+    TEST_ASSERT_NOT_NULL(state);
+    for (uint64_t pos = start; pos < end; pos += chunk_size) {
+        size_t len = end - pos < chunk_size ? (size_t)(end - pos) : chunk_size;
+        TEST_ASSERT_EQUAL_MESSAGE(STREAM_PROC_SUCCESS,
+                                  part_processor_process_data(state, archive + pos, len),
+                                  part_processor_get_error(state));
+    }
+    TEST_ASSERT_EQUAL_MESSAGE(STREAM_PROC_SUCCESS, part_processor_finalize(state),
+                              part_processor_get_error(state));
+    part_processor_destroy(state);
+}
+
+static void restore_part(uint32_t p, size_t chunk_size) {
+    restore_part_from(&cd, p, chunk_size);
+}
+
+// Restore every part in index order
+static void restore_parts(void) {
+    for (uint32_t p = 0; p < cd.num_parts; p++) {
+        restore_part(p, 64 * 1024);
+    }
+}
+
+static void output_path(char *path, size_t size, const char *name) {
+    snprintf(path, size, "%s/%s", output_dir, name);
+}
+
+static void assert_restored(const char *name, const uint8_t *data, size_t len) {
+    char path[1024];
+    output_path(path, sizeof(path), name);
+    FILE *f = fopen(path, "rb");
+    TEST_ASSERT_NOT_NULL_MESSAGE(f, path);
+
+    uint8_t *actual = malloc(len + 1);
+    TEST_ASSERT_NOT_NULL(actual);
+    size_t n = fread(actual, 1, len + 1, f);
+    fclose(f);
+    TEST_ASSERT_EQUAL_MESSAGE(len, n, path);
+    TEST_ASSERT_EQUAL_MEMORY_MESSAGE(data, actual, len, path);
+    free(actual);
+}
+
+static bool restored_exists(const char *name) {
+    char path[1024];
+    struct stat st;
+    output_path(path, sizeof(path), name);
+    return lstat(path, &st) == 0;
+}
+
+#define DUPLICATE_SIZE (300 * 1024)
+
+// An archive of one content under three names: stored, stored again (-H) and
+// stored without data (-D)
+static void archive_duplicates(uint8_t *content) {
+    fill_pattern(content, DUPLICATE_SIZE, 7);
+    TEST_ASSERT_EQUAL(0, burst_writer_set_content_hashing(writer, true));
+
+    archive_file_content("a/original.bin", content, DUPLICATE_SIZE);
+    archive_file_content("c/stored_copy.bin", content, DUPLICATE_SIZE);
+
+    struct stat st;
+    char path[1024];
+    uint8_t hash[CONTENT_HASH_SIZE];
+    write_source("d/omitted_copy.bin", content, DUPLICATE_SIZE, &st);
+    source_path(path, sizeof(path), "d/omitted_copy.bin");
+    TEST_ASSERT_EQUAL(0, content_hash_file(path, hash));
+    TEST_ASSERT_EQUAL(1, process_duplicate_entry(writer, path, "d/omitted_copy.bin", &st, hash));
+
+    finish_archive();
+    TEST_ASSERT_EQUAL_PTR(&cd.files[0], cd.files[1].dedup_source);
+    TEST_ASSERT_EQUAL_PTR(&cd.files[0], cd.files[2].dedup_source);
+    TEST_ASSERT_TRUE(cd.files[2].data_omitted);
+}
+
+// Restore the archive from archive_duplicates() and check every name
+static void restore_duplicates(const uint8_t *content) {
+    restore_parts();
+
+    // Copies are left to stream_processor_clone_duplicates(), even the stored one
+    assert_restored("a/original.bin", content, DUPLICATE_SIZE);
+    TEST_ASSERT_FALSE(restored_exists("c/stored_copy.bin"));
+    TEST_ASSERT_FALSE(restored_exists("d/omitted_copy.bin"));
+
+    TEST_ASSERT_EQUAL(0, stream_processor_clone_duplicates(&cd, output_dir));
+    assert_restored("a/original.bin", content, DUPLICATE_SIZE);
+    assert_restored("c/stored_copy.bin", content, DUPLICATE_SIZE);
+    assert_restored("d/omitted_copy.bin", content, DUPLICATE_SIZE);
+}
+
+void test_duplicates_cloned(void) {
+    uint8_t *content = malloc(DUPLICATE_SIZE);
+    archive_duplicates(content);
+    restore_duplicates(content);
+    TEST_ASSERT_EQUAL(2, ficlone_calls);
+    free(content);
+}
+
+void test_duplicates_copied_in_kernel_without_ficlone(void) {
+    uint8_t *content = malloc(DUPLICATE_SIZE);
+    archive_duplicates(content);
+    fail_ficlone = true;
+    restore_duplicates(content);
+    TEST_ASSERT_TRUE(copy_file_range_calls >= 2);
+    free(content);
+}
+
+void test_duplicates_copied_through_buffer_without_copy_file_range(void) {
+    uint8_t *content = malloc(DUPLICATE_SIZE);
+    archive_duplicates(content);
+    fail_ficlone = true;
+    fail_copy_file_range = true;
+    restore_duplicates(content);
+    TEST_ASSERT_EQUAL(2, copy_file_range_calls);
+    free(content);
+}
+
+#define LINK_TARGET_SIZE (3 * 1024 * 1024 + 17)
+#define LINK_FILLER_SIZE (10 * 1024 * 1024)
+
+// A file, enough data to move on to the next part, and a second name of the file
+static void archive_hardlink(uint8_t *content, uint8_t *filler) {
+    fill_pattern(content, LINK_TARGET_SIZE, 31);
+    fill_random(filler, LINK_FILLER_SIZE, 32);
+
+    char target_path[1024];
+    char link_path[1024];
+    struct stat st;
+    write_source("a/target.bin", content, LINK_TARGET_SIZE, &st);
+    source_path(target_path, sizeof(target_path), "a/target.bin");
+    TEST_ASSERT_EQUAL(0, chmod(target_path, 0640));
+    TEST_ASSERT_EQUAL(0, stat(target_path, &st));
+    TEST_ASSERT_EQUAL(1, process_entry(writer, target_path, "a/target.bin", NULL, &st, false));
+
+    archive_file_content("filler.bin", filler, LINK_FILLER_SIZE);
+
+    source_path(link_path, sizeof(link_path), "b");
+    TEST_ASSERT_EQUAL(0, mkdir(link_path, 0755));
+    source_path(link_path, sizeof(link_path), "b/link.bin");
+    TEST_ASSERT_EQUAL(0, link(target_path, link_path));
+    TEST_ASSERT_EQUAL(0, stat(link_path, &st));
+    TEST_ASSERT_EQUAL(1, process_hardlink_entry(writer, link_path, "b/link.bin", &st,
+                                                "a/target.bin"));
+    finish_archive();
+
+    TEST_ASSERT_EQUAL_STRING("b/link.bin", cd.files[2].filename);
+    TEST_ASSERT_EQUAL_STRING("a/target.bin", cd.files[2].hardlink_target);
+    TEST_ASSERT_TRUE(cd.files[2].part_index > cd.files[0].part_index);
+}
+
+// Both names are one inode with the file's content, and the metadata pass
+// chmods it through the target's name only
+static void assert_hardlink_restored(const uint8_t *content) {
+    chmod_watch_name = "link.bin";
+    TEST_ASSERT_EQUAL(0, stream_processor_apply_metadata(&cd, output_dir, 0, cd.num_files));
+    TEST_ASSERT_EQUAL(0, chmod_watch_calls);
+
+    assert_restored("a/target.bin", content, LINK_TARGET_SIZE);
+    assert_restored("b/link.bin", content, LINK_TARGET_SIZE);
+
+    char path[1024];
+    struct stat target_st, link_st;
+    output_path(path, sizeof(path), "a/target.bin");
+    TEST_ASSERT_EQUAL(0, stat(path, &target_st));
+    output_path(path, sizeof(path), "b/link.bin");
+    TEST_ASSERT_EQUAL(0, stat(path, &link_st));
+    TEST_ASSERT_EQUAL(target_st.st_ino, link_st.st_ino);
+    TEST_ASSERT_EQUAL(2, link_st.st_nlink);
+    TEST_ASSERT_EQUAL_HEX(0640, link_st.st_mode & 07777);
+}
+
+void test_hardlink_restored_after_its_target(void) {
+    uint8_t *content = malloc(LINK_TARGET_SIZE);
+    uint8_t *filler = malloc(LINK_FILLER_SIZE);
+    archive_hardlink(content, filler);
+
+    restore_parts();
+    assert_hardlink_restored(content);
+
+    free(content);
+    free(filler);
+}
+
+// The link's part comes in first: the target is created empty for it, and
+// its data is written later into the same inode
+void test_hardlink_restored_before_its_target(void) {
+    uint8_t *content = malloc(LINK_TARGET_SIZE);
+    uint8_t *filler = malloc(LINK_FILLER_SIZE);
+    archive_hardlink(content, filler);
+
+    for (uint32_t p = cd.num_parts; p-- > 0;) {
+        restore_part(p, 64 * 1024);
+        if (p == cd.files[2].part_index) {
+            char path[1024];
+            struct stat st;
+            output_path(path, sizeof(path), "b/link.bin");
+            TEST_ASSERT_EQUAL(0, stat(path, &st));
+            TEST_ASSERT_EQUAL(2, st.st_nlink);
+        }
+    }
+    assert_hardlink_restored(content);
+
+    free(content);
+    free(filler);
+}
+
+#define ZERO_CHUNKS 5  // Data, three chunks of zeros, data
+
+// Two files with runs of zeros the writer marks: one with zeros between
+// data, one ending in them
+static void archive_zero_runs(uint8_t *middle, uint8_t *tail) {
+    memset(middle, 0, ZERO_CHUNKS * BURST_FRAME_SIZE);
+    fill_pattern(middle, BURST_FRAME_SIZE, 21);
+    fill_pattern(middle + 4 * BURST_FRAME_SIZE, BURST_FRAME_SIZE, 22);
+    memset(tail, 0, 3 * BURST_FRAME_SIZE);
+    fill_pattern(tail, BURST_FRAME_SIZE, 23);
+
+    archive_file_content("zeros/middle.bin", middle, ZERO_CHUNKS * BURST_FRAME_SIZE);
+    archive_file_content("zeros/tail.bin", tail, 3 * BURST_FRAME_SIZE);
+    TEST_ASSERT_EQUAL(5, writer->zero_frames);
+    finish_archive();
+}
+
+// Offset of the first hole at or after offset in the restored file name
+static off_t restored_hole(const char *name, off_t offset) {
+    char path[1024];
+    output_path(path, sizeof(path), name);
+    int fd = open(path, O_RDONLY);
+    TEST_ASSERT_TRUE(fd >= 0);
+    off_t hole = lseek(fd, offset, SEEK_HOLE);
+    close(fd);
+    return hole;
+}
+
+static off_t restored_size(const char *name) {
+    char path[1024];
+    struct stat st;
+    output_path(path, sizeof(path), name);
+    TEST_ASSERT_EQUAL(0, stat(path, &st));
+    return st.st_size;
+}
+
+// Marked frames become holes, over whatever an earlier restore left there
+void test_zero_frames_restored_as_holes(void) {
+    uint8_t *middle = malloc(ZERO_CHUNKS * BURST_FRAME_SIZE);
+    uint8_t *tail = malloc(3 * BURST_FRAME_SIZE);
+    archive_zero_runs(middle, tail);
+
+    // Stale, larger files from a previous restore
+    uint8_t *stale = malloc(8 * BURST_FRAME_SIZE);
+    memset(stale, 0xFF, 8 * BURST_FRAME_SIZE);
+    char path[1024];
+    output_path(path, sizeof(path), "zeros");
+    TEST_ASSERT_EQUAL(0, mkdir(path, 0755));
+    const char *names[] = {"zeros/middle.bin", "zeros/tail.bin"};
+    for (int i = 0; i < 2; i++) {
+        output_path(path, sizeof(path), names[i]);
+        FILE *f = fopen(path, "wb");
+        TEST_ASSERT_NOT_NULL(f);
+        TEST_ASSERT_EQUAL(8 * BURST_FRAME_SIZE, fwrite(stale, 1, 8 * BURST_FRAME_SIZE, f));
+        fclose(f);
+    }
+
+    restore_parts();
+    assert_restored("zeros/middle.bin", middle, ZERO_CHUNKS * BURST_FRAME_SIZE);
+    assert_restored("zeros/tail.bin", tail, 3 * BURST_FRAME_SIZE);
+    TEST_ASSERT_EQUAL(ZERO_CHUNKS * BURST_FRAME_SIZE, restored_size("zeros/middle.bin"));
+    TEST_ASSERT_EQUAL(3 * BURST_FRAME_SIZE, restored_size("zeros/tail.bin"));
+    TEST_ASSERT_EQUAL(5, fallocate_calls);
+
+    // Where the filesystem reports holes, they cover exactly the marked frames
+    off_t hole = restored_hole("zeros/middle.bin", 0);
+    if (hole != ZERO_CHUNKS * BURST_FRAME_SIZE) {
+        TEST_ASSERT_EQUAL(BURST_FRAME_SIZE, hole);
+        output_path(path, sizeof(path), "zeros/middle.bin");
+        int fd = open(path, O_RDONLY);
+        TEST_ASSERT_TRUE(fd >= 0);
+        TEST_ASSERT_EQUAL(4 * BURST_FRAME_SIZE, lseek(fd, BURST_FRAME_SIZE, SEEK_DATA));
+        close(fd);
+        TEST_ASSERT_EQUAL(BURST_FRAME_SIZE, restored_hole("zeros/tail.bin", 0));
+    }
+
+    free(stale);
+    free(middle);
+    free(tail);
+}
+
+// Without hole punching, the zeros are written like any other frame
+void test_zero_frames_written_without_punch_hole(void) {
+    uint8_t *middle = malloc(ZERO_CHUNKS * BURST_FRAME_SIZE);
+    uint8_t *tail = malloc(3 * BURST_FRAME_SIZE);
+    archive_zero_runs(middle, tail);
+    fail_fallocate = true;
+
+    restore_parts();
+    assert_restored("zeros/middle.bin", middle, ZERO_CHUNKS * BURST_FRAME_SIZE);
+    assert_restored("zeros/tail.bin", tail, 3 * BURST_FRAME_SIZE);
+    TEST_ASSERT_EQUAL(ZERO_CHUNKS * BURST_FRAME_SIZE, restored_size("zeros/middle.bin"));
+    TEST_ASSERT_EQUAL(3 * BURST_FRAME_SIZE, restored_size("zeros/tail.bin"));
+    TEST_ASSERT_EQUAL(5, fallocate_calls);
+
+    free(middle);
+    free(tail);
+}
+
+#define SWITCH_OVER_SIZE (20 * 1024 * 1024)
+
+// The hybrid downloader starts parts against the partial CD and switches to
+// the full CD once it is parsed. A file spanning the switch-over is written
+// by parts of both results, and each result counts the other's as skipped.
+void test_file_spanning_cd_switch_over(void) {
+    uint8_t *content = malloc(SWITCH_OVER_SIZE);
+    fill_random(content, SWITCH_OVER_SIZE, 17);
+    archive_file_content("spanning.bin", content, SWITCH_OVER_SIZE);
+    finish_archive();
+    TEST_ASSERT_EQUAL(3, cd.num_parts);
+    TEST_ASSERT_EQUAL(3, cd.files[0].num_parts_spanned);
+
+    // cd stands in for the partial CD
+    struct central_dir_parse_result full_cd;
+    TEST_ASSERT_EQUAL(CENTRAL_DIR_PARSE_SUCCESS,
+                      central_dir_parse(archive, archive_size, archive_size,
+                                        BURST_PART_SIZE, &full_cd));
+
+    restore_part_from(&cd, 0, 64 * 1024);
+    TEST_ASSERT_TRUE(cd.files[0].shared_fd >= 0);
+
+    // Full CD parsed: part 0 ran against the partial CD, parts 1 and 2 will not
+    stream_processor_skip_part(&full_cd, 0);
+    stream_processor_skip_part(&cd, 1);
+    stream_processor_skip_part(&cd, 2);
+    TEST_ASSERT_EQUAL(-1, cd.files[0].shared_fd);
+
+    restore_part_from(&full_cd, 2, 64 * 1024);
+    TEST_ASSERT_TRUE(full_cd.files[0].shared_fd >= 0);
+    restore_part_from(&full_cd, 1, 64 * 1024);
+    TEST_ASSERT_EQUAL(-1, full_cd.files[0].shared_fd);
+
+    assert_restored("spanning.bin", content, SWITCH_OVER_SIZE);
+
+    central_dir_parse_result_free(&full_cd);
+    free(content);
+}
+
+#define WINDOW_TEST_SIZE (2 * 1024 * 1024)
+#define WINDOW_TEST_WINDOW (384 * 1024)
+
+// One part downloaded as the downloader does: the source's body() hands
+// chunks to an I/O stream, whose worker feeds them to the part processor and
+// only then reopens the read window. The worker waits for gate_open first.
+struct window_part {
+    struct part_processor_state *processor;
+    struct io_stream *io;
+    pthread_mutex_t mutex;
+    pthread_cond_t cv;
+    bool gate_open;
+    uint64_t received;      // Bytes given to body()
+    uint64_t processed;     // Bytes consumed by the part processor
+    uint64_t max_buffered;  // Most bytes received and not yet processed
+    bool done;
+    int rc;
+};
+
+static int window_body(struct source_request *request, const uint8_t *data, size_t len,
+                       void *user_data) {
+    (void)request;
+    struct window_part *w = user_data;
+    pthread_mutex_lock(&w->mutex);
+    w->received += len;
+    if (w->received - w->processed > w->max_buffered) {
+        w->max_buffered = w->received - w->processed;
+    }
+    pthread_cond_broadcast(&w->cv);
+    pthread_mutex_unlock(&w->mutex);
+    return io_stream_submit(w->io, data, len);
+}
+
+static struct source_request *window_request;
+
+static int window_process_chunk(void *ctx, const uint8_t *data, size_t len) {
+    struct window_part *w = ctx;
+    pthread_mutex_lock(&w->mutex);
+    while (!w->gate_open) {
+        pthread_cond_wait(&w->cv, &w->mutex);
+    }
+    pthread_mutex_unlock(&w->mutex);
+
+    int rc = part_processor_process_data(w->processor, data, len);
+    pthread_mutex_lock(&w->mutex);
+    w->processed += len;
+    pthread_mutex_unlock(&w->mutex);
+    if (rc != STREAM_PROC_SUCCESS) {
+        return rc;
+    }
+    source_request_open_window(window_request, len);
+    return 0;
+}
+
+static void window_finish(int error_code, int response_status, void *user_data) {
+    (void)response_status;
+    struct window_part *w = user_data;
+    if (error_code != 0) {
+        pthread_mutex_lock(&w->mutex);
+        w->rc = error_code;
+        pthread_mutex_unlock(&w->mutex);
+    }
+    io_stream_finish(w->io);
+}
+
+static void window_done(void *ctx, int rc) {
+    struct window_part *w = ctx;
+    if (rc == 0) {
+        rc = part_processor_finalize(w->processor);
+    }
+    pthread_mutex_lock(&w->mutex);
+    if (w->rc == 0) {
+        w->rc = rc;
+    }
+    w->done = true;
+    pthread_cond_broadcast(&w->cv);
+    pthread_mutex_unlock(&w->mutex);
+}
+
+// Wait up to 5 seconds for body() to have been given at least bytes
+static void wait_received(struct window_part *w, uint64_t bytes) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += 5;
+    pthread_mutex_lock(&w->mutex);
+    while (w->received < bytes &&
+           pthread_cond_timedwait(&w->cv, &w->mutex, &deadline) == 0) {
+    }
+    uint64_t received = w->received;
+    pthread_mutex_unlock(&w->mutex);
+    TEST_ASSERT_EQUAL_UINT64(bytes, received);
+}
+
+// A part's read stops at the read window until the processor has consumed
+// what was delivered, so no more than a window is ever buffered
+void test_read_window_limits_buffered_bytes(void) {
+    uint8_t *content = malloc(WINDOW_TEST_SIZE);
+    fill_random(content, WINDOW_TEST_SIZE, 41);
+    archive_file_content("window.bin", content, WINDOW_TEST_SIZE);
+    finish_archive();
+    TEST_ASSERT_EQUAL(1, cd.num_parts);
+    TEST_ASSERT_TRUE(cd.central_dir_offset > 2 * WINDOW_TEST_WINDOW);
+
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/archive.zip", work_dir);
+    FILE *f = fopen(path, "wb");
+    TEST_ASSERT_NOT_NULL(f);
+    TEST_ASSERT_EQUAL(archive_size, fwrite(archive, 1, archive_size, f));
+    fclose(f);
+
+    struct archive_source *source = archive_source_new_file(path, WINDOW_TEST_WINDOW);
+    TEST_ASSERT_NOT_NULL(source);
+    struct io_pool *pool = io_pool_create(2);
+    TEST_ASSERT_NOT_NULL(pool);
+
+    struct window_part w;
+    memset(&w, 0, sizeof(w));
+    pthread_mutex_init(&w.mutex, NULL);
+    pthread_cond_init(&w.cv, NULL);
+    w.processor = part_processor_create(0, &cd, output_dir, BURST_PART_SIZE);
+    TEST_ASSERT_NOT_NULL(w.processor);
+    w.io = io_stream_create(pool, window_process_chunk, window_done, &w);
+    TEST_ASSERT_NOT_NULL(w.io);
+
+    struct source_request_options options = {
+        .start = 0,
+        .end = cd.central_dir_offset - 1,
+        .body = window_body,
+        .finish = window_finish,
+        .user_data = &w,
+    };
+    window_request = archive_source_request(source, &options);
+    TEST_ASSERT_NOT_NULL(window_request);
+
+    // With the processor held up, the read stops after one window
+    wait_received(&w, WINDOW_TEST_WINDOW);
+    usleep(100 * 1000);
+    pthread_mutex_lock(&w.mutex);
+    TEST_ASSERT_EQUAL_UINT64(WINDOW_TEST_WINDOW, w.received);
+    TEST_ASSERT_EQUAL_UINT64(0, w.processed);
+    w.gate_open = true;
+    pthread_cond_broadcast(&w.cv);
+    while (!w.done) {
+        pthread_cond_wait(&w.cv, &w.mutex);
+    }
+    pthread_mutex_unlock(&w.mutex);
+
+    TEST_ASSERT_EQUAL(0, w.rc);
+    TEST_ASSERT_EQUAL_UINT64(cd.central_dir_offset, w.received);
+    TEST_ASSERT_EQUAL_UINT64(cd.central_dir_offset, w.processed);
+    TEST_ASSERT_EQUAL_UINT64(WINDOW_TEST_WINDOW, w.max_buffered);
+    assert_restored("window.bin", content, WINDOW_TEST_SIZE);
+
+    source_request_release(window_request);
+    io_stream_destroy(w.io);
+    io_pool_destroy(pool);
+    archive_source_destroy(source);
+    part_processor_destroy(w.processor);
+    pthread_mutex_destroy(&w.mutex);
+    pthread_cond_destroy(&w.cv);
+    free(content);
+}
+
+#define SPREAD_DIRS (2 * DIR_FD_CACHE_SIZE)
+#define SPREAD_ROUNDS 3
+#define SPREAD_FILE_SIZE 1000
+
+static void spread_name(char *name, size_t size, int round, int dir) {
+    // Every other directory one level deeper, so parents are looked up too
+    if (dir % 2) {
+        snprintf(name, size, "d%02d/sub/f%d.bin", dir, round);
+    } else {
+        snprintf(name, size, "d%02d/f%d.bin", dir, round);
+    }
+}
+
+// Files visit more directories than the processor keeps fds for, round-robin,
+// so every directory's fd is evicted and reopened between its files. The last
+// round repeats the content of the first, for stream_processor_clone_duplicates().
+void test_files_spread_over_more_dirs_than_cached(void) {
+    uint8_t content[SPREAD_ROUNDS][SPREAD_DIRS][SPREAD_FILE_SIZE];
+    char name[64];
+    TEST_ASSERT_EQUAL(0, burst_writer_set_content_hashing(writer, true));
+    for (int round = 0; round < SPREAD_ROUNDS; round++) {
+        for (int dir = 0; dir < SPREAD_DIRS; dir++) {
+            int seed = round == SPREAD_ROUNDS - 1 ? dir : round * SPREAD_DIRS + dir;
+            fill_pattern(content[round][dir], SPREAD_FILE_SIZE, (uint32_t)seed);
+            spread_name(name, sizeof(name), round, dir);
+            archive_file_content(name, content[round][dir], SPREAD_FILE_SIZE);
+        }
+    }
+    finish_archive();
+
+    restore_parts();
+    TEST_ASSERT_EQUAL(0, stream_processor_clone_duplicates(&cd, output_dir));
+
+    for (int round = 0; round < SPREAD_ROUNDS; round++) {
+        for (int dir = 0; dir < SPREAD_DIRS; dir++) {
+            spread_name(name, sizeof(name), round, dir);
+            assert_restored(name, content[round][dir], SPREAD_FILE_SIZE);
+        }
+    }
+
+    // Nothing landed at the top level or in the wrong directory
+    char path[1024];
+    for (int round = 0; round < SPREAD_ROUNDS; round++) {
+        snprintf(path, sizeof(path), "f%d.bin", round);
+        TEST_ASSERT_FALSE(restored_exists(path));
+        snprintf(path, sizeof(path), "d00/sub/f%d.bin", round);
+        TEST_ASSERT_FALSE(restored_exists(path));
+    }
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_duplicates_cloned);
+    RUN_TEST(test_duplicates_copied_in_kernel_without_ficlone);
+    RUN_TEST(test_duplicates_copied_through_buffer_without_copy_file_range);
+    RUN_TEST(test_hardlink_restored_after_its_target);
+    RUN_TEST(test_hardlink_restored_before_its_target);
+    RUN_TEST(test_zero_frames_restored_as_holes);
+    RUN_TEST(test_zero_frames_written_without_punch_hole);
+    RUN_TEST(test_files_spread_over_more_dirs_than_cached);
+    RUN_TEST(test_file_spanning_cd_switch_over);
+    RUN_TEST(test_read_window_limits_buffered_bytes);
+    return UNITY_END();
+}
@@ -122,6 +122,66 @@ void test_writer_buffer_overflow(void) {
     fclose(tmp);
 }
 
+// Sink that collects output in memory, optionally failing
+struct test_sink {
+    uint8_t data[128 * 1024];
+    size_t len;
+    int calls;
+    bool fail;
+};
+
+static int test_sink_write(void *ctx, const uint8_t *data, size_t len) {
+    struct test_sink *sink = ctx;
+    sink->calls++;
+    if (sink->fail || sink->len + len > sizeof(sink->data)) {
+        return -1;
+    }
+    memcpy(sink->data + sink->len, data, len);
+    sink->len += len;
+    return 0;
+}
+
+// Test writer with an output sink instead of a FILE
+void test_writer_sink_receives_output_in_order(void) {
+    static struct test_sink sink;
+    memset(&sink, 0, sizeof(sink));
+
+    TEST_ASSERT_NULL(burst_writer_create_with_sink(NULL, &sink, 3));
+
+    struct burst_writer *writer = burst_writer_create_with_sink(test_sink_write, &sink, 3);
+    TEST_ASSERT_NOT_NULL(writer);
+
+    char large_data[70000];
+    for (size_t i = 0; i < sizeof(large_data); i++) {
+        large_data[i] = (char)(i % 251);
+    }
+    TEST_ASSERT_EQUAL(0, burst_writer_write(writer, large_data, sizeof(large_data)));
+    TEST_ASSERT_EQUAL(1, sink.calls);  // One full buffer so far
+    TEST_ASSERT_EQUAL(0, burst_writer_flush(writer));
+
+    TEST_ASSERT_EQUAL(sizeof(large_data), sink.len);
+    TEST_ASSERT_EQUAL(sizeof(large_data), writer->current_offset);
+    TEST_ASSERT_EQUAL_MEMORY(large_data, sink.data, sizeof(large_data));
+
+    burst_writer_destroy(writer);
+}
+
+// Test sink errors are reported by flush
+void test_writer_sink_error(void) {
+    static struct test_sink sink;
+    memset(&sink, 0, sizeof(sink));
+    sink.fail = true;
+
+    struct burst_writer *writer = burst_writer_create_with_sink(test_sink_write, &sink, 3);
+    TEST_ASSERT_NOT_NULL(writer);
+
+    TEST_ASSERT_EQUAL(0, burst_writer_write(writer, "abc", 3));
+    TEST_ASSERT_EQUAL(-1, burst_writer_flush(writer));
+    TEST_ASSERT_EQUAL(0, writer->current_offset);
+
+    burst_writer_destroy(writer);
+}
+
 int main(void) {
     UNITY_BEGIN();
 
@@ -133,6 +193,8 @@ int main(void) {
     RUN_TEST(test_writer_write_null);
     RUN_TEST(test_writer_write_zero_bytes);
     RUN_TEST(test_writer_buffer_overflow);
+    RUN_TEST(test_writer_sink_receives_output_in_order);
+    RUN_TEST(test_writer_sink_error);
 
     return UNITY_END();
 }
@@ -5,7 +5,11 @@
  * to gain access to them for testing.
  */
 
+// burst_writer.c needs it (SEEK_DATA, SEEK_HOLE), before any system header
+#define _GNU_SOURCE
+
 #include "unity.h"
+#include "test_helpers.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -35,27 +39,6 @@ void tearDown(void) {
     }
 }
 
-// Helper to create a minimal LFH with a given filename
-static void create_test_lfh(uint8_t *buffer, const char *filename, struct zip_local_header **lfh_out, int *lfh_len_out) {
-    struct zip_local_header *lfh = (struct zip_local_header *)buffer;
-    memset(lfh, 0, sizeof(struct zip_local_header));
-
-    lfh->signature = ZIP_LOCAL_FILE_HEADER_SIG;
-    lfh->version_needed = 63;
-    lfh->flags = 0x0008;
-    lfh->compression_method = ZIP_METHOD_ZSTD;
-    lfh->last_mod_time = 0x1234;
-    lfh->last_mod_date = 0x5678;
-    lfh->filename_length = strlen(filename);
-    lfh->extra_field_length = 0;
-
-    // Copy filename after header
-    memcpy(buffer + sizeof(struct zip_local_header), filename, strlen(filename));
-
-    *lfh_out = lfh;
-    *lfh_len_out = sizeof(struct zip_local_header) + strlen(filename);
-}
-
 // =============================================================================
 // ensure_file_capacity() Tests
 // =============================================================================
@@ -114,7 +97,7 @@ void test_allocate_entry_success(void) {
     uint8_t buffer[512];
     struct zip_local_header *lfh;
     int lfh_len;
-    create_test_lfh(buffer, "test.txt", &lfh, &lfh_len);
+    create_test_lfh(buffer, "test.txt", false, &lfh, &lfh_len);
 
     struct file_entry *entry = allocate_file_entry(writer, lfh);
 
@@ -134,7 +117,7 @@ void test_allocate_entry_long_filename(void) {
 
     struct zip_local_header *lfh;
     int lfh_len;
-    create_test_lfh(buffer, long_name, &lfh, &lfh_len);
+    create_test_lfh(buffer, long_name, false, &lfh, &lfh_len);
 
     struct file_entry *entry = allocate_file_entry(writer, lfh);
 
@@ -166,7 +149,7 @@ void test_allocate_entry_zeroes_struct(void) {
     uint8_t buffer[512];
     struct zip_local_header *lfh;
     int lfh_len;
-    create_test_lfh(buffer, "test.txt", &lfh, &lfh_len);
+    create_test_lfh(buffer, "test.txt", false, &lfh, &lfh_len);
 
     // Pre-fill the entry slot with garbage
     struct file_entry *entry_slot = &writer->files[writer->num_files];
@@ -188,7 +171,7 @@ void test_allocate_entry_path_with_directories(void) {
     uint8_t buffer[512];
     struct zip_local_header *lfh;
     int lfh_len;
-    create_test_lfh(buffer, "path/to/file.txt", &lfh, &lfh_len);
+    create_test_lfh(buffer, "path/to/file.txt", false, &lfh, &lfh_len);
 
     struct file_entry *entry = allocate_file_entry(writer, lfh);
 
@@ -206,7 +189,7 @@ void test_populate_metadata_all_fields(void) {
     uint8_t buffer[512];
     struct zip_local_header *lfh;
     int lfh_len;
-    create_test_lfh(buffer, "test.txt", &lfh, &lfh_len);
+    create_test_lfh(buffer, "test.txt", false, &lfh, &lfh_len);
 
     // Set specific values in LFH
     lfh->compression_method = ZIP_METHOD_ZSTD;
@@ -235,7 +218,7 @@ void test_populate_metadata_unix_mode(void) {
     uint8_t buffer[512];
     struct zip_local_header *lfh;
     int lfh_len;
-    create_test_lfh(buffer, "test.txt", &lfh, &lfh_len);
+    create_test_lfh(buffer, "test.txt", false, &lfh, &lfh_len);
 
     struct file_entry entry;
     memset(&entry, 0, sizeof(entry));
@@ -259,7 +242,7 @@ void test_populate_metadata_uid_gid(void) {
     uint8_t buffer[512];
     struct zip_local_header *lfh;
     int lfh_len;
-    create_test_lfh(buffer, "test.txt", &lfh, &lfh_len);
+    create_test_lfh(buffer, "test.txt", false, &lfh, &lfh_len);
 
     struct file_entry entry;
     memset(&entry, 0, sizeof(entry));
@@ -281,7 +264,7 @@ void test_populate_metadata_offset(void) {
     uint8_t buffer[512];
     struct zip_local_header *lfh;
     int lfh_len;
-    create_test_lfh(buffer, "test.txt", &lfh, &lfh_len);
+    create_test_lfh(buffer, "test.txt", false, &lfh, &lfh_len);
 
     struct file_entry entry;
     memset(&entry, 0, sizeof(entry));